@@ -0,0 +1,14 @@
+PLATFORM=linux
+DYNAMIC_LIB_EXT=.so
+ARCH=x86_64
+PREFIX=/root/repo
+WITH_EIGEN=yes
+CXXSTANDARD=c++17
+GCC_VER=-12
+BUILD_DIR=x86_64-linux-gcc-12
+CXXFLAGS+=-Wmisleading-indentation  -Wlogical-op -Wduplicated-cond -Wduplicated-branches  -Wformat-signedness
+CFLAGS+=-Wmisleading-indentation  -Wlogical-op -Wduplicated-cond -Wduplicated-branches
+SSE+=-msse -msse2 -mfpmath=sse
+OPTIM=-O3 $(SSE) -fomit-frame-pointer
+CXXFLAGS+=-Wall -Wextra -Wnon-virtual-dtor -Wformat -Werror -std=$(CXXSTANDARD) -fPIC $(OPTIM) -g
+CFLAGS+=-Wall -Wextra -Werror -std=gnu11 -fPIC $(OPTIM) -g
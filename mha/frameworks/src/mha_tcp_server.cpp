@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2018 2019 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -16,6 +17,11 @@
 #include "mha_tcp_server.hh"
 #include <asio/read_until.hpp>
 #include <asio/write.hpp>
+#include <asio/strand.hpp>
+#include <asio/post.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/steady_timer.hpp>
+#include <thread>
 
 namespace mha_tcp {
     server_t::server_t(const std::string & interface,
@@ -48,9 +54,18 @@ namespace mha_tcp {
         return num_accepted_connections;
     }
 
-    void server_t::run() {
-        trigger_accept();
+    void server_t::run(unsigned num_threads) {
+        {
+            std::lock_guard<std::mutex> lock(acceptor_mutex);
+            trigger_accept();
+        }
+        std::vector<std::thread> threads;
+        for (unsigned k = 1U; k < num_threads; ++k)
+            threads.emplace_back([this](){get_context().run();});
         get_context().run();
+        // When the event loop is stopped, all threads return from run.
+        for (auto & thread : threads)
+            thread.join();
     }
 
     bool server_t::on_received_line(std::shared_ptr<buffered_socket_t> c,
@@ -74,9 +89,9 @@ namespace mha_tcp {
                                    " progress");
         }
         // We need to allocate the socket to be used for the future accepted
-        // connection in advance
+        // connection in advance.  Its handlers are serialized by a strand.
         std::shared_ptr<buffered_socket_t> connection =
-            std::make_shared<buffered_socket_t>(get_context());
+            std::make_shared<buffered_socket_t>(asio::make_strand(get_context()));
 
         // Set flag that we have a pending acceptance job in asio
         async_accept_has_been_triggered = true;
@@ -87,6 +102,8 @@ namespace mha_tcp {
                                [this,connection](const asio::error_code& ec) {
                                    // When this handler is called, then asio
                                    // has finished the async_accept request
+                                   std::lock_guard<std::mutex>
+                                       lock(acceptor_mutex);
                                    async_accept_has_been_triggered = false;
                                    if (!ec) {
                                        // in the absence of errors we have a new
@@ -95,8 +112,10 @@ namespace mha_tcp {
                                        ++num_accepted_connections;
                                        add_connection(connection);
                                    }
-                                   // Trigger acceptance of the next connection
-                                   trigger_accept();
+                                   // Trigger acceptance of the next
+                                   // connection unless we shut down
+                                   if (acceptor->is_open())
+                                       trigger_accept();
                                });
     }
 
@@ -104,7 +123,12 @@ namespace mha_tcp {
     {
         // Call trigger_read_line with a detour through asio's scheduler
         // to avoid starving other connections when one connection floods us
-        asio::post(get_context(),[this,c](){trigger_read_line(c);});
+        asio::post(c->get_executor(),[this,c](){trigger_read_line(c);});
+    }
+
+    void server_t::resume_reading(std::shared_ptr<buffered_socket_t> c)
+    {
+        post_trigger_read_line(c);
     }
 
     void server_t::trigger_read_line(std::shared_ptr<buffered_socket_t> c)
@@ -153,19 +177,23 @@ namespace mha_tcp {
 
     void server_t::shutdown()
     {
+        std::lock_guard<std::mutex> lock(acceptor_mutex);
         // refuse any new connections
         acceptor->close();
         // close the input data side on all connections.  No new commands
-        // will be received.
+        // will be received.  Sockets may only be used in their strand.
         for (auto weak_connection : connections) {
-            if (weak_connection.use_count()) {
-                auto connection = weak_connection.lock();
-                try{
-                connection->shutdown(asio::ip::tcp::socket::shutdown_receive);
-                }
-                // Ignore asio errors during connection shutdown as we are going away anyway
-                catch(asio::system_error& e){}
-                }
+            if (auto connection = weak_connection.lock()) {
+                asio::dispatch(connection->get_executor(), [connection]() {
+                    try{
+                        connection->
+                            shutdown(asio::ip::tcp::socket::shutdown_receive);
+                    }
+                    // Ignore asio errors during connection shutdown as we
+                    // are going away anyway
+                    catch(asio::system_error& e){}
+                });
+            }
         }
         // in 1 second, terminate the event loop. This should give us enough
         // time to respond to the cmd=quit command with a "success" message.
@@ -176,6 +204,42 @@ namespace mha_tcp {
     }
 
     void buffered_socket_t::queue_write(const std::string & message) {
+        pending_bytes += message.size();
+        dispatch_write(message);
+    }
+
+    bool buffered_socket_t::queue_write_bounded(const std::string & message,
+                                                size_t max_pending) {
+        // Reserve the bytes before the message is dispatched, so that
+        // concurrent callers cannot exceed the limit together.
+        size_t pending = pending_bytes.load();
+        do {
+            if (pending + message.size() > max_pending)
+                return false;
+        } while (!pending_bytes.compare_exchange_weak(pending,
+                                                      pending +
+                                                      message.size()));
+        dispatch_write(message);
+        return true;
+    }
+
+    void buffered_socket_t::dispatch_write(const std::string & message) {
+        try {
+            std::shared_ptr<buffered_socket_t> self =
+                this->shared_from_this();
+            // Executes immediately if we are already in this connection's
+            // strand, else it is scheduled there.
+            asio::dispatch(get_executor(),
+                           [self,this,message](){start_write(message);});
+        }
+        catch (...) {
+            // The message will not be sent: release its reservation
+            pending_bytes -= message.size();
+            throw;
+        }
+    }
+
+    void buffered_socket_t::start_write(const std::string & message) {
         std::shared_ptr<buffered_socket_t> self = this->shared_from_this();
         next_message += message;
         if (next_message.size() && current_message.empty()) {
@@ -190,15 +254,95 @@ namespace mha_tcp {
                                 // Connection closed?  Do not re-register for
                                 // writing.
                             } else {
+                                pending_bytes -= current_message.size();
                                 current_message.clear();
                                 if (next_message.size()) {
                                     // We already have a next message, send it
-                                    queue_write("");
+                                    start_write("");
                                 }
                             }
                         });
         }
     }
+
+    snapshot_cache_t::snapshot_cache_t(size_t max_entries,
+                                       std::chrono::steady_clock::duration
+                                       expiry)
+        : snapshot(std::make_shared<const snapshot_t>()),
+          max_entries(max_entries),
+          expiry(expiry.count())
+    {}
+
+    int64_t snapshot_cache_t::now()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    bool snapshot_cache_t::lookup(const std::string & query,
+                                  std::string & response) const
+    {
+        std::shared_ptr<const snapshot_t> current = std::atomic_load(&snapshot);
+        auto it = current->find(query);
+        if (it == current->end() || !it->second.valid)
+            return false;
+        it->second.last_use->store(now(), std::memory_order_relaxed);
+        response = it->second.response;
+        return true;
+    }
+
+    void snapshot_cache_t::add(const std::string & query,
+                               const std::string & response)
+    {
+        std::shared_ptr<const snapshot_t> current = std::atomic_load(&snapshot);
+        if (current->size() >= max_entries && !current->count(query))
+            return;
+        auto next = std::make_shared<snapshot_t>(*current);
+        entry_t & entry = (*next)[query];
+        entry.response = response;
+        entry.valid = true;
+        if (!entry.last_use)
+            entry.last_use = std::make_shared<std::atomic<int64_t> >();
+        entry.last_use->store(now(), std::memory_order_relaxed);
+        std::atomic_store(&snapshot,
+                          std::shared_ptr<const snapshot_t>(std::move(next)));
+    }
+
+    void snapshot_cache_t::refresh(const evaluator_t & evaluate)
+    {
+        std::shared_ptr<const snapshot_t> current = std::atomic_load(&snapshot);
+        if (current->empty())
+            return;
+        // All queries are evaluated in one go by the writer thread, so the
+        // responses in the new snapshot are consistent with each other.
+        auto next = std::make_shared<snapshot_t>();
+        const int64_t oldest = now() - expiry;
+        for (const auto & query : *current) {
+            if (query.second.last_use->load(std::memory_order_relaxed) < oldest)
+                continue;
+            entry_t entry = {"", query.second.last_use, true};
+            if (evaluate(query.first, entry.response))
+                next->emplace(query.first, std::move(entry));
+        }
+        std::atomic_store(&snapshot,
+                          std::shared_ptr<const snapshot_t>(std::move(next)));
+    }
+
+    void snapshot_cache_t::invalidate()
+    {
+        std::shared_ptr<const snapshot_t> current = std::atomic_load(&snapshot);
+        if (current->empty())
+            return;
+        auto next = std::make_shared<snapshot_t>(*current);
+        for (auto & query : *next)
+            query.second.valid = false;
+        std::atomic_store(&snapshot,
+                          std::shared_ptr<const snapshot_t>(std::move(next)));
+    }
+
+    size_t snapshot_cache_t::size() const
+    {
+        return std::atomic_load(&snapshot)->size();
+    }
 }
 
 /*
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -18,6 +19,11 @@
 
 #include <string>
 #include <memory>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
 #include <asio/ip/tcp.hpp>
 #include <asio/streambuf.hpp>
 
@@ -29,7 +35,9 @@ namespace mha_tcp {
      * connection objects is managed with shared pointers registered together
      * with callbacks in the asio event loop.  This is a common idiom in asio.
      * To support this, we inherit from enable_shared_from_this which is also
-     * common in code that uses asio. */
+     * common in code that uses asio.  Each connection uses its own strand
+     * as executor, so that its handlers never run concurrently even when
+     * the event loop is run by several threads. */
     class buffered_socket_t :
         public asio::ip::tcp::socket,
         public std::enable_shared_from_this<buffered_socket_t>
@@ -42,16 +50,95 @@ namespace mha_tcp {
         /** A buffer for the next  message(s) that must be sent back to
          * the client after the sending of current_message has completed. */
         std::string next_message;
+        /** Number of bytes queued for sending but not yet sent. */
+        std::atomic<size_t> pending_bytes = {0U};
     public:
         /** Access to associated streambuf.  Needed to invoke async_read.
          * @return associated streambuf object by reference */
         asio::streambuf & get_buffer() {return streambuf;}
 
         /** Send the given message through this connection to the client
-         * asynchronously.
+         * asynchronously.  May be called from any thread.
          * @param message The text to send. Method copies the message before
          *                returning. */
         void queue_write(const std::string & message);
+
+        /** Send the given message unless the data waiting to be sent
+         * through this connection would exceed a limit.  Used for
+         * unsolicited messages which may be dropped when the client does
+         * not keep up.  May be called from any thread.
+         * @param message The text to send.
+         * @param max_pending Maximum number of unsent bytes including
+         *                    this message.
+         * @return true if the message was queued, false if dropped. */
+        bool queue_write_bounded(const std::string & message,
+                                 size_t max_pending);
+
+        /** @return Number of bytes queued but not yet sent. */
+        size_t get_pending_bytes() const {return pending_bytes.load();}
+    private:
+        /** Schedule start_write in the strand of this connection.  The
+         * caller has added the message size to pending_bytes, which is
+         * released again if scheduling fails. */
+        void dispatch_write(const std::string & message);
+        /** Append message to the outgoing data and start sending if no
+         * send operation is in progress.  Executes in the strand. */
+        void start_write(const std::string & message);
+    };
+
+    /** Read-consistent snapshot of the responses to a set of read-only
+     * queries, e.g. monitor variable reads.  The snapshot is produced by
+     * a single writer thread, which executes the queries serialized with
+     * all other commands, and can be read concurrently by any number of
+     * threads without blocking the writer.  Queries that are not
+     * requested for longer than the expiry time are removed when the
+     * snapshot is refreshed. */
+    class snapshot_cache_t {
+    public:
+        /** Evaluates a query.  Returns false if the query failed and must
+         * not be cached, else stores the response in the second argument. */
+        using evaluator_t = std::function<bool(const std::string &,
+                                               std::string &)>;
+        /** @param max_entries Maximum number of cached queries
+         *  @param expiry Time after the last request of a query after
+         *                which the query is dropped from the cache */
+        explicit snapshot_cache_t(size_t max_entries = 256U,
+                                  std::chrono::steady_clock::duration expiry
+                                  = std::chrono::seconds(10));
+        /** Look up the response to a query in the current snapshot.  Thread
+         * safe and lock free except for the reference counting of the
+         * snapshot.
+         * @return true if the query is cached, false otherwise. */
+        bool lookup(const std::string & query, std::string & response) const;
+        /** Add a query and its response to the snapshot.  Writer thread
+         * only.  Ignored if the cache is full. */
+        void add(const std::string & query, const std::string & response);
+        /** Re-evaluate all cached queries and publish the results as the
+         * new snapshot.  Writer thread only.
+         * @param evaluate Called for every cached query in turn. */
+        void refresh(const evaluator_t & evaluate);
+        /** Mark all responses as outdated.  Lookups fail until the next
+         * refresh re-evaluates the queries, the queries themselves are
+         * kept.  Writer thread only. */
+        void invalidate();
+        /** @return number of cached queries */
+        size_t size() const;
+    private:
+        struct entry_t {
+            std::string response;
+            /// Time of last lookup in steady_clock ticks, shared by all
+            /// snapshot generations of this query.
+            std::shared_ptr<std::atomic<int64_t> > last_use;
+            /// False after invalidate() until the next refresh
+            bool valid;
+        };
+        using snapshot_t = std::map<std::string, entry_t>;
+        static int64_t now();
+        /** Current snapshot.  Replaced as a whole by the writer, accessed
+         * with the atomic shared_ptr functions. */
+        std::shared_ptr<const snapshot_t> snapshot;
+        size_t max_entries;
+        int64_t expiry;
     };
 
     /** Class for accepting TCP connections from clients */
@@ -60,11 +147,14 @@ namespace mha_tcp {
         asio::io_context io_context;
         /// The underlying asio object used to accept incoming TCP connections
         std::shared_ptr<asio::ip::tcp::acceptor> acceptor;
+        /// Protects acceptor and connections when the event loop is run
+        /// by several threads.
+        std::mutex acceptor_mutex;
         /// Set to true when async_acceptance is triggered in trigger_accept
         /// (Only one accept can be in process at any time).
         bool async_accept_has_been_triggered = false;
         /// Number of accepted connections (not necessarily still existing)
-        size_t num_accepted_connections = 0U;
+        std::atomic<size_t> num_accepted_connections = {0U};
         /// Weak pointers to the existing connections. Needed to shutdown
         /// the active connections for incoming data when server shuts down.
         std::vector<std::weak_ptr<buffered_socket_t> > connections;
@@ -96,8 +186,12 @@ namespace mha_tcp {
         size_t get_num_accepted_connections() const;
 
         /** Accepts connections on the TCP port and serves them.  Triggers
-         * the acceptance of the next connection to start things off. */
-        void run();
+         * the acceptance of the next connection to start things off.
+         * @param num_threads Number of threads running the event loop,
+         *                    including the calling thread.  With more than
+         *                    one thread, on_received_line can be invoked
+         *                    concurrently for different connections. */
+        void run(unsigned num_threads = 1U);
 
         /** This method is invoked when a line of text is received on one of
          * the accepted connections. Override this method to process the
@@ -105,16 +199,25 @@ namespace mha_tcp {
          * @param c the connection that has received this line
          * @param l the line that has been received, without the line ending
          * @return client should return true when client wants to read another
-         *         line of text, else false.        */
+         *         line of text, else false.  A client that processes the
+         *         line asynchronously returns false, keeps the connection
+         *         alive by holding c, and calls resume_reading(c) when done.
+         */
         virtual bool on_received_line(std::shared_ptr<buffered_socket_t> c,
                                       const std::string & l);
 
+        /** Continue reading lines from a connection after on_received_line
+         * has returned false.  May be called from any thread.
+         * @param c The connection to read the next line from. */
+        void resume_reading(std::shared_ptr<buffered_socket_t> c);
+
         /** Shuts down the server: Close the acceptor (no new connections),
          * shuts down the receiving direction of all accepted connections
          * (no new commands, but responses can still be finished), registers
          * a timer event that will cause event loop termination and return from
          * the run() method 1 second in the future, giving us reasonably
-         * enough time for the pending responses to be sent out. */
+         * enough time for the pending responses to be sent out.
+         * May be called from any thread. */
         virtual void shutdown();
 
         /** Make destructor virtual */
@@ -143,6 +246,7 @@ namespace mha_tcp {
         /** Add new connection to the list of connections, retire stale pointers
          */
         void add_connection(std::shared_ptr<buffered_socket_t> connection) {
+            // caller holds acceptor_mutex
             connections.push_back(connection);
             // remove pointers whose connection has expired
             connections.
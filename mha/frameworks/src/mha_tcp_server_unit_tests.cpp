@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2018 2019 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -19,6 +20,7 @@
 #include <asio/connect.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
+#include <asio/read_until.hpp>
 #include <thread>
 
 using mha_tcp::server_t;
@@ -332,6 +334,227 @@ TEST(server_test, server_shutdown_refuses_connections)
   server.run();
 }
 
+TEST(server_test, deferred_line_does_not_block_other_connections)
+{
+  // Lines "slow" are processed in a separate thread, all other lines are
+  // answered immediately by the event loop threads.
+  class deferring_server_t : public server_t {
+  public:
+    using server_t::server_t; // constructor is unmodified
+    std::vector<std::thread> workers;
+    bool on_received_line(std::shared_ptr<mha_tcp::buffered_socket_t> c,
+                          const std::string & line) override {
+      if (line != "slow") {
+        c->queue_write(line + " done\n");
+        return true;
+      }
+      workers.emplace_back([this,c]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        c->queue_write("slow done\n");
+        resume_reading(c);
+      });
+      return false;
+    }
+  };
+
+  deferring_server_t server("127.0.0.1",any_port);
+  std::thread server_thread([&server](){server.run(2U);});
+
+  asio::io_context client_context;
+  auto endpoints = asio::ip::tcp::resolver(client_context).
+    resolve("127.0.0.1", std::to_string(server.get_port()));
+  asio::ip::tcp::socket slow_client(client_context), fast_client(client_context);
+  asio::connect(slow_client, endpoints);
+  asio::connect(fast_client, endpoints);
+  auto read_line = [](asio::ip::tcp::socket & socket, asio::streambuf & buf) {
+    asio::read_until(socket, buf, '\n');
+    std::string line;
+    std::istream istream(&buf);
+    std::getline(istream, line);
+    return line;
+  };
+  asio::streambuf slow_buf, fast_buf;
+
+  asio::write(slow_client, asio::buffer(std::string("slow\n")));
+  // The fast client is served while the slow command is still processed
+  auto start = std::chrono::steady_clock::now();
+  asio::write(fast_client, asio::buffer(std::string("fast\n")));
+  EXPECT_EQ("fast done", read_line(fast_client, fast_buf));
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(250));
+  EXPECT_EQ("slow done", read_line(slow_client, slow_buf));
+  // After resume_reading, the slow connection accepts the next line
+  asio::write(slow_client, asio::buffer(std::string("next\n")));
+  EXPECT_EQ("next done", read_line(slow_client, slow_buf));
+
+  server.shutdown();
+  server_thread.join();
+  for (auto & worker : server.workers)
+    worker.join();
+}
+
+TEST(server_test, bounded_write_drops_messages_exceeding_limit)
+{
+  class bounded_server_t : public server_t {
+  public:
+    using server_t::server_t; // constructor is unmodified
+    std::vector<bool> queued;
+    bool on_received_line(std::shared_ptr<mha_tcp::buffered_socket_t> c,
+                          const std::string &) override {
+      // The first message is not sent before this handler returns
+      queued.push_back(c->queue_write_bounded("12345\n", 10U));
+      queued.push_back(c->queue_write_bounded("67890\n", 10U));
+      queued.push_back(c->queue_write_bounded("abc\n", 10U));
+      EXPECT_EQ(10U, c->get_pending_bytes());
+      return true;
+    }
+  };
+
+  bounded_server_t server("127.0.0.1",any_port);
+  asio::ip::tcp::socket client(server.get_context());
+  asio::async_connect(client, asio::ip::tcp::resolver(server.get_context()).
+                      resolve("127.0.0.1", std::to_string(server.get_port())),
+                      [&client](const asio::error_code & ec,
+                         const asio::ip::tcp::endpoint &) {
+                        ASSERT_FALSE(ec);
+                        asio::write(client,asio::buffer(std::string("x\n")));
+                      });
+  asio::steady_timer t(server.get_context(), std::chrono::seconds(1));
+  t.async_wait([&server](const asio::error_code&)
+               {server.get_context().stop();});
+  server.run();
+
+  EXPECT_EQ((std::vector<bool>{true, false, true}), server.queued);
+  std::string actual_responses(10U, '\0');
+  asio::read(client, asio::buffer(actual_responses));
+  EXPECT_EQ("12345\nabc\n", actual_responses);
+}
+
+TEST(server_test, concurrent_bounded_writes_respect_limit)
+{
+  class bounded_server_t : public server_t {
+  public:
+    using server_t::server_t; // constructor is unmodified
+    std::atomic<unsigned> queued = {0U};
+    bool on_received_line(std::shared_ptr<mha_tcp::buffered_socket_t> c,
+                          const std::string &) override {
+      // No message is sent before this handler returns, so only one
+      // message fits into the limit, whichever thread queues it.
+      std::vector<std::thread> threads;
+      for (unsigned k = 0U; k < 4U; ++k)
+        threads.emplace_back([this,c]() {
+          for (unsigned n = 0U; n < 1000U; ++n)
+            if (c->queue_write_bounded("12345\n", 10U))
+              ++queued;
+        });
+      for (auto & thread : threads)
+        thread.join();
+      EXPECT_EQ(6U, c->get_pending_bytes());
+      return true;
+    }
+  };
+
+  bounded_server_t server("127.0.0.1",any_port);
+  asio::ip::tcp::socket client(server.get_context());
+  asio::async_connect(client, asio::ip::tcp::resolver(server.get_context()).
+                      resolve("127.0.0.1", std::to_string(server.get_port())),
+                      [&client](const asio::error_code & ec,
+                         const asio::ip::tcp::endpoint &) {
+                        ASSERT_FALSE(ec);
+                        asio::write(client,asio::buffer(std::string("x\n")));
+                      });
+  asio::steady_timer t(server.get_context(), std::chrono::seconds(1));
+  t.async_wait([&server](const asio::error_code&)
+               {server.get_context().stop();});
+  server.run();
+
+  EXPECT_EQ(1U, server.queued.load());
+  std::string actual_responses(6U, '\0');
+  asio::read(client, asio::buffer(actual_responses));
+  EXPECT_EQ("12345\n", actual_responses);
+}
+
+TEST(snapshot_cache_test, lookup_returns_added_responses)
+{
+  mha_tcp::snapshot_cache_t cache;
+  std::string response = "unchanged";
+  EXPECT_FALSE(cache.lookup("a?val", response));
+  EXPECT_EQ("unchanged", response);
+  cache.add("a?val", "1\n");
+  cache.add("b?val", "2\n");
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  EXPECT_EQ("1\n", response);
+  cache.add("a?val", "3\n");
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  EXPECT_EQ("3\n", response);
+}
+
+TEST(snapshot_cache_test, refresh_reevaluates_and_drops_failing_queries)
+{
+  mha_tcp::snapshot_cache_t cache;
+  cache.add("a?val", "1\n");
+  cache.add("b?val", "2\n");
+  std::vector<std::string> evaluated;
+  cache.refresh([&evaluated](const std::string & query,
+                             std::string & response) {
+                  evaluated.push_back(query);
+                  response = query + " refreshed";
+                  return query != "b?val";
+                });
+  EXPECT_EQ((std::vector<std::string>{"a?val", "b?val"}), evaluated);
+  std::string response;
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  EXPECT_EQ("a?val refreshed", response);
+  EXPECT_FALSE(cache.lookup("b?val", response));
+  EXPECT_EQ(1U, cache.size());
+}
+
+TEST(snapshot_cache_test, limits_size_and_expires_unused_queries)
+{
+  mha_tcp::snapshot_cache_t cache(2U, std::chrono::milliseconds(50));
+  cache.add("a?val", "1");
+  cache.add("b?val", "2");
+  cache.add("c?val", "3");
+  std::string response;
+  EXPECT_FALSE(cache.lookup("c?val", response));
+  EXPECT_EQ(2U, cache.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  auto evaluate = [](const std::string &, std::string & r){r = "x"; return true;};
+  cache.refresh(evaluate);
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  EXPECT_EQ("x", response);
+}
+
+TEST(snapshot_cache_test, invalidated_responses_are_not_served_until_refresh)
+{
+  mha_tcp::snapshot_cache_t cache;
+  cache.add("a?val", "1\n");
+  cache.add("b?val", "2\n");
+  cache.invalidate();
+  std::string response;
+  EXPECT_FALSE(cache.lookup("a?val", response));
+  EXPECT_FALSE(cache.lookup("b?val", response));
+  EXPECT_EQ(2U, cache.size());
+  // a query executed after the invalidation is served again
+  cache.add("b?val", "3\n");
+  EXPECT_TRUE(cache.lookup("b?val", response));
+  EXPECT_EQ("3\n", response);
+  std::vector<std::string> evaluated;
+  cache.refresh([&evaluated](const std::string & query,
+                             std::string & response) {
+                  evaluated.push_back(query);
+                  response = query + " refreshed";
+                  return true;
+                });
+  EXPECT_EQ((std::vector<std::string>{"a?val", "b?val"}), evaluated);
+  EXPECT_TRUE(cache.lookup("a?val", response));
+  EXPECT_EQ("a?val refreshed", response);
+}
+
 // Local Variables:
 // compile-command: "make -C .. unit-tests"
 // coding: utf-8-unix
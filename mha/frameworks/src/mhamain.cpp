@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2006 2007 2008 2009 2010 2011 2012 2013 HörTech gGmbH
 // Copyright © 2014 2016 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2024 Hörzentrum Oldenburg gGmbH
+// Copyright © 2024 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -21,10 +21,21 @@
 #include <getopt.h>
 #include <fstream>
 #include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <asio/connect.hpp>
 #include <asio/write.hpp>
 #include <asio/read_until.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/executor_work_guard.hpp>
 #include <thread>
+#include <mutex>
+#include <map>
+#include <sstream>
+#include <algorithm>
 
 #ifdef _WIN32
 #define getpid(x) _getpid(x)
@@ -50,9 +61,36 @@ class mhaserver_t : public fw_t {
         virtual bool
         on_received_line(std::shared_ptr <mha_tcp::buffered_socket_t> c,
                          const std::string & l) override
+        {
+            if (mha->query_threads == 0U)
+                return execute(c, l);
+            // Read-only queries are answered from the snapshot by the
+            // network thread, everything else is executed in order by the
+            // configuration thread.  Reading from this connection resumes
+            // after the response has been queued, so that responses keep
+            // the order of the commands.
+            std::string response;
+            if (mha->snapshot_lookup(l, response)) {
+                c->queue_write(response);
+                return true;
+            }
+            asio::post(mha->config_context, [this,c,l]() {
+                    if (execute(c, l))
+                        resume_reading(c);
+                });
+            return false;
+        }
+    private:
+        /** Execute a command line and queue the response.
+         * @return false when the command caused an exit request. */
+        bool execute(std::shared_ptr <mha_tcp::buffered_socket_t> c,
+                     const std::string & l)
         {
             bool old_exit_request = mha->exit_request();
-            c->queue_write(mha->on_received_line(l));
+            if (is_subscription_command(l))
+                c->queue_write(mha->on_subscription_command(c, l));
+            else
+                c->queue_write(mha->on_received_line(l));
             bool new_exit_request = mha->exit_request();
             if (new_exit_request && !old_exit_request) {
                 shutdown();
@@ -86,18 +124,95 @@ public:
     virtual void set_announce_port(unsigned short announce_port);
     /** Log a message to log file */
     inline void logstring(const std::string&);
+    /** Answer read-only queries concurrently from a snapshot.
+        @param threads Number of network threads, 0 executes all commands
+                       in the network thread in the order of arrival.
+        @param interval_ms Period for refreshing the snapshot */
+    void set_query_threads(unsigned threads, unsigned interval_ms);
     /** Accept network connections and act on commands.
         Calls #acceptor_started() when the TCP port is opened.
         Calls on_received_line for every line received.
         @return exit code that can be used as process exit code */
     int run(unsigned short port, const std::string & _interface);
 private:
+    /** Look up a query in the snapshot.  Called by the network threads.
+        @return true if the response was found in the snapshot */
+    bool snapshot_lookup(const std::string & line, std::string & response);
+    /** Whether the response to a command line may be served from the
+        snapshot: value queries without side effects. */
+    static bool is_snapshot_query(const std::string & line);
+    /** Execute a query for the snapshot without logging.
+        @return false if the query fails */
+    bool evaluate_query(const std::string & query, std::string & response);
+    /** Re-evaluate all queries of the snapshot.  Executes in the
+        configuration thread. */
+    void refresh_snapshot();
+    /** Refresh the snapshot periodically in the configuration thread */
+    void schedule_snapshot_refresh(std::shared_ptr<asio::steady_timer> t);
+    /** Periodic push of monitor values to one connection */
+    struct subscription_t {
+        subscription_t(asio::io_context & context)
+            : timer(context) {}
+        std::weak_ptr<mha_tcp::buffered_socket_t> connection;
+        /// Key of this subscription in the subscriptions map
+        const mha_tcp::buffered_socket_t * key = nullptr;
+        /// Paths of the subscribed variables
+        std::vector<std::string> paths;
+        /// Value types of the subscribed variables as returned by ?type
+        std::vector<std::string> types;
+        bool binary = false;
+        std::chrono::milliseconds interval;
+        asio::steady_timer timer;
+        /// Number of the next update
+        uint64_t sequence = 0U;
+        /// Number of updates dropped because the client did not keep up
+        uint64_t dropped = 0U;
+    };
+    /** Whether a line is a subscribe or unsubscribe command, which are
+        handled by the server instead of the parser. */
+    static bool is_subscription_command(const std::string & line);
+    /** Execute a subscribe or unsubscribe command for a connection.
+        @return The response including the acknowledgement string */
+    std::string on_subscription_command(std::shared_ptr<mha_tcp::
+                                        buffered_socket_t> c,
+                                        const std::string & line);
+    /** The event loop executing parser commands */
+    asio::io_context & command_context();
+    /** Send the current values of a subscription and schedule the next
+        update.  Executes in the command context. */
+    void push_update(std::weak_ptr<subscription_t> weak_subscription,
+                     const asio::error_code & ec);
+    /** Format one update of a subscription.
+        @throw MHA_Error if a variable cannot be read anymore */
+    std::string format_update(subscription_t & subscription);
     std::string ack_ok;
     std::string ack_fail;
     std::string logfile;
     unsigned short announce_port;
     bool b_interactive;
     MHAParser::int_mon_t pid_mon;
+    /// Number of network threads answering queries from the snapshot
+    unsigned query_threads = 0U;
+    /// Refresh period of the snapshot in milliseconds
+    unsigned snapshot_interval_ms = 50U;
+    /// Event loop of the configuration thread which executes all commands
+    /// that are not answered from the snapshot.
+    asio::io_context config_context;
+    /// Responses to recent value queries, refreshed by the configuration
+    /// thread periodically and after other commands.
+    mha_tcp::snapshot_cache_t snapshot;
+    /// A refresh of the outdated snapshot is queued in the configuration
+    /// thread.  Only accessed by the configuration thread.
+    bool snapshot_refresh_pending = false;
+    /// Serializes log file access of several network threads
+    std::mutex log_mutex;
+    /// Active subscriptions by connection.  Only accessed in the command
+    /// context.
+    std::map<const mha_tcp::buffered_socket_t *,
+             std::shared_ptr<subscription_t> > subscriptions;
+    /// Maximum number of unsent bytes per connection before updates of
+    /// subscriptions are dropped
+    static constexpr size_t max_push_pending = 65536U;
 public:
     MHAParser::int_t port;
 };
@@ -105,6 +220,7 @@ public:
 inline void mhaserver_t::logstring(const std::string& s)
 {
     if( logfile.size() ){
+        std::lock_guard<std::mutex> lock(log_mutex);
         std::ofstream lf(logfile.c_str(),std::ios_base::app);
         if( lf.fail() )
             throw MHA_Error(__FILE__,__LINE__,
@@ -244,7 +360,20 @@ int mhaserver_t::run(unsigned short port, const std::string & _interface)
               _interface + ":" + std::to_string(tcpserver->get_port()) + "\n");
     acceptor_started();
 
-    tcpserver->run();
+    if (query_threads) {
+        // All commands that are not answered from the snapshot are
+        // executed by the configuration thread.
+        auto work = asio::make_work_guard(config_context);
+        schedule_snapshot_refresh(std::make_shared<asio::steady_timer>
+                                  (config_context));
+        std::thread config_thread([this](){config_context.run();});
+        tcpserver->run(query_threads);
+        config_context.stop();
+        config_thread.join();
+    } else {
+        tcpserver->run();
+    }
+    subscriptions.clear();
 
     logstring("exit request, closing server.\n");
     tcpserver = nullptr; // closes server
@@ -256,6 +385,65 @@ int mhaserver_t::run(unsigned short port, const std::string & _interface)
 void mhaserver_t::set_announce_port(unsigned short announce_port)
 { this->announce_port = announce_port; }
 
+void mhaserver_t::set_query_threads(unsigned threads, unsigned interval_ms)
+{
+    query_threads = threads;
+    snapshot_interval_ms = std::max(interval_ms, 1U);
+}
+
+bool mhaserver_t::is_snapshot_query(const std::string & line)
+{
+    const std::string suffix = "?val";
+    std::string query = MHAUtils::strip(line);
+    if (query.size() <= suffix.size() ||
+        query.compare(query.size() - suffix.size(), suffix.size(), suffix))
+        return false;
+    // Exclude other operators, substitutions and environment variables
+    return query.find_first_of("=?$ ") == query.size() - suffix.size();
+}
+
+bool mhaserver_t::snapshot_lookup(const std::string & line,
+                                  std::string & response)
+{
+    if (!is_snapshot_query(line) || !snapshot.lookup(line, response))
+        return false;
+    logstring("received: \""+line+"\"\n");
+    logstring(response);
+    return true;
+}
+
+bool mhaserver_t::evaluate_query(const std::string & query,
+                                 std::string & response)
+{
+    try{
+        response = parse(query);
+        if( response.size() && (response[response.size()-1] != '\n') )
+            response += '\n';
+        response += ack_ok;
+        return true;
+    }
+    catch(std::exception& e){
+        return false;
+    }
+}
+
+void mhaserver_t::refresh_snapshot()
+{
+    snapshot.refresh([this](const std::string & q, std::string & r)
+                     {return evaluate_query(q, r);});
+}
+
+void mhaserver_t::schedule_snapshot_refresh(std::shared_ptr<asio::steady_timer> t)
+{
+    t->expires_after(std::chrono::milliseconds(snapshot_interval_ms));
+    t->async_wait([this,t](const asio::error_code & ec) {
+            if (ec)
+                return;
+            refresh_snapshot();
+            schedule_snapshot_refresh(t);
+        });
+}
+
 mhaserver_t::mhaserver_t(const std::string& ao,const std::string& af,const std::string& lf, bool b_interactive_)
     : tcpserver(0),
       ack_ok(ao),
@@ -296,6 +484,7 @@ std::string mhaserver_t::on_received_line(const std::string& cmd)
     }
 
     logstring("received: \""+lcmd+"\"\n");
+    bool success = false;
     try{
         if( lcmd.size() ){
             retv += parse(lcmd);
@@ -303,6 +492,7 @@ std::string mhaserver_t::on_received_line(const std::string& cmd)
                 retv += '\n';
         }
         retv += ack_ok;
+        success = true;
     }
     catch(std::exception& e){
         retv += e.what();
@@ -311,9 +501,204 @@ std::string mhaserver_t::on_received_line(const std::string& cmd)
         retv += ack_fail;
     }
     logstring(retv);
+    if (query_threads) {
+        if (is_snapshot_query(lcmd)) {
+            // This includes values that plugins compute in read access
+            // callbacks, e.g. levelmeter levels.  The refresh computes
+            // them only while clients keep asking for them.
+            if (success)
+                snapshot.add(lcmd, retv);
+        } else {
+            // The command may have changed any value: Queries are
+            // executed by this thread until the snapshot has been
+            // refreshed, so that this client reads its own writes.  The
+            // refresh is queued once after the commands already waiting.
+            snapshot.invalidate();
+            if (!snapshot_refresh_pending) {
+                snapshot_refresh_pending = true;
+                asio::post(config_context, [this]() {
+                        snapshot_refresh_pending = false;
+                        refresh_snapshot();
+                    });
+            }
+        }
+    }
+    return retv;
+}
+
+bool mhaserver_t::is_subscription_command(const std::string & line)
+{
+    std::string command = MHAUtils::strip(line);
+    command = command.substr(0, command.find(' '));
+    return command == "subscribe" || command == "subscribe_binary" ||
+        command == "unsubscribe";
+}
+
+asio::io_context & mhaserver_t::command_context()
+{
+    return query_threads ? config_context : tcpserver->get_context();
+}
+
+std::string mhaserver_t::on_subscription_command(std::shared_ptr<mha_tcp::
+                                                 buffered_socket_t> c,
+                                                 const std::string & line)
+{
+    logstring("received: \""+line+"\"\n");
+    std::string retv;
+    try{
+        std::istringstream words(line);
+        std::string command;
+        words >> command;
+        subscriptions.erase(c.get());
+        if (command != "unsubscribe") {
+            int interval_ms = 0;
+            words >> interval_ms;
+            if (words.fail() || interval_ms < 1)
+                throw MHA_Error(__FILE__,__LINE__,
+                                "Usage: %s <interval in ms> <path>"
+                                " [<path> ...]", command.c_str());
+            auto subscription =
+                std::make_shared<subscription_t>(command_context());
+            subscription->connection = c;
+            subscription->key = c.get();
+            subscription->binary = (command == "subscribe_binary");
+            subscription->interval = std::chrono::milliseconds(interval_ms);
+            std::string path;
+            while (words >> path) {
+                // Fails for paths that do not exist
+                std::string type = parse(path + "?type");
+                if (subscription->binary &&
+                    (type.find("complex") != std::string::npos ||
+                     type.find("string") != std::string::npos ||
+                     type == "keyword_list" || type == "parser"))
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "Cannot subscribe to %s of type %s"
+                                    " in binary format", path.c_str(),
+                                    type.c_str());
+                subscription->paths.push_back(path);
+                subscription->types.push_back(type);
+            }
+            if (subscription->paths.empty())
+                throw MHA_Error(__FILE__,__LINE__,
+                                "No variables to subscribe to");
+            // Fails for values that cannot be formatted
+            format_update(*subscription);
+            subscriptions[c.get()] = subscription;
+            subscription->timer.expires_after(subscription->interval);
+            std::weak_ptr<subscription_t> weak_subscription = subscription;
+            subscription->timer.async_wait([this,weak_subscription]
+                                           (const asio::error_code & ec)
+                                           {push_update(weak_subscription,
+                                                        ec);});
+        }
+        retv = ack_ok;
+    }
+    catch(std::exception& e){
+        retv = e.what();
+        if( retv.size() && (retv[retv.size()-1] != '\n') )
+            retv += '\n';
+        retv += ack_fail;
+    }
+    logstring(retv);
     return retv;
 }
 
+std::string mhaserver_t::format_update(subscription_t & subscription)
+{
+    using MHAParser::StrCnv::str2val;
+    const size_t n = subscription.paths.size();
+    if (!subscription.binary) {
+        std::string update = "(MHA:push " +
+            std::to_string(subscription.sequence) + " " +
+            std::to_string(subscription.dropped) + ")\n";
+        for (size_t k = 0U; k < n; ++k)
+            update += subscription.paths[k] + " = " +
+                parse(subscription.paths[k] + "?val") + "\n";
+        return update + "(MHA:push-end)\n";
+    }
+    // Binary payload: for each variable the number of values as uint32,
+    // followed by the values as doubles, matrices in row-major order.
+    std::string payload;
+    std::vector<double> values;
+    for (size_t k = 0U; k < n; ++k) {
+        const std::string & type = subscription.types[k];
+        const std::string value = parse(subscription.paths[k] + "?val");
+        values.clear();
+        if (type == "bool") {
+            bool scalar = false;
+            str2val(value, scalar);
+            values.push_back(scalar);
+        } else {
+            // Convert the digits printed by the parser directly to double,
+            // a float in between would round e.g. large integers.
+            // Matrices are printed row by row.
+            std::string numbers = value;
+            std::replace_if(numbers.begin(), numbers.end(),
+                            [](char c){return c == '[' || c == ']' ||
+                                    c == ';' || c == ',';}, ' ');
+            const char * next = numbers.c_str();
+            while (*next) {
+                if (isspace(static_cast<unsigned char>(*next))) {
+                    ++next;
+                    continue;
+                }
+                char * end = nullptr;
+                values.push_back(strtod(next, &end));
+                if (end == next)
+                    throw MHA_Error(__FILE__,__LINE__,
+                                    "Cannot convert value \"%s\" of %s"
+                                    " to numbers", value.c_str(),
+                                    subscription.paths[k].c_str());
+                next = end;
+            }
+        }
+        uint32_t count = values.size();
+        payload.append(reinterpret_cast<const char *>(&count), sizeof(count));
+        payload.append(reinterpret_cast<const char *>(values.data()),
+                       values.size() * sizeof(double));
+    }
+    return "(MHA:push-binary " + std::to_string(subscription.sequence) + " "
+        + std::to_string(subscription.dropped) + " "
+        + std::to_string(payload.size()) + ")\n" + payload;
+}
+
+void mhaserver_t::push_update(std::weak_ptr<subscription_t> weak_subscription,
+                              const asio::error_code & ec)
+{
+    auto subscription = weak_subscription.lock();
+    if (ec || !subscription)
+        return; // unsubscribed
+    auto connection = subscription->connection.lock();
+    if (!connection) {
+        // client has disconnected
+        subscriptions.erase(subscription->key);
+        return;
+    }
+    try{
+        if (connection->queue_write_bounded(format_update(*subscription),
+                                            max_push_pending))
+            ++subscription->sequence;
+        else
+            ++subscription->dropped;
+    }
+    catch(std::exception& e){
+        // A subscribed variable has disappeared, e.g. a plugin was unloaded.
+        connection->queue_write("(MHA:push-error) " + std::string(e.what())
+                                + "\n");
+        subscriptions.erase(subscription->key);
+        return;
+    }
+    // Keep the update rate without accumulating delays, but skip updates
+    // that are already overdue.
+    auto next = subscription->timer.expiry() + subscription->interval;
+    if (next < std::chrono::steady_clock::now())
+        next = std::chrono::steady_clock::now() + subscription->interval;
+    subscription->timer.expires_at(next);
+    subscription->timer.async_wait([this,weak_subscription]
+                                   (const asio::error_code & ec)
+                                   {push_update(weak_subscription, ec);});
+}
+
 #define HELP_TEXT \
 "\n"\
 "Usage:\n"\
@@ -329,6 +714,10 @@ std::string mhaserver_t::on_received_line(const std::string& cmd)
 " --ok-ack=str | -o str     set ok acknowledgement string\n"\
 " --fail-ack=str | -f str   set failure acknowledgement string\n"\
 " --log=logfile             activate logging to logfile\n"\
+" --query-threads=n         answer value queries (?val) in n network threads\n"\
+"                           from a snapshot, execute other commands in a\n"\
+"                           separate thread (default: 0, all in one thread)\n"\
+" --snapshot-interval=ms    refresh period of the query snapshot (default: 50)\n"\
 " --help | -h               show this help screen\n"\
 
 #ifndef NORELEASE_WARNING // This is not a release build. Add warning to output.
@@ -362,6 +751,28 @@ BUILDHOST_INFO \
 "under the terms of the GNU AFFERO GENERAL PUBLIC LICENSE, Version 3; \n"\
 "for details see file COPYING.\n\n"
 
+/** Convert the value of a numeric command line option.
+    @param option Option name for the error message
+    @param value Option value
+    @param min_value Smallest allowed value
+    @param max_value Largest allowed value
+    @throw MHA_Error if the value is not an integer in the allowed range */
+static unsigned parse_unsigned_option(const char * option, const char * value,
+                                      unsigned min_value, unsigned max_value)
+{
+    char * end = nullptr;
+    errno = 0;
+    // strtoul accepts and negates a leading minus sign
+    const unsigned long result = strtoul(value, &end, 10);
+    if (errno || end == value || *end || strchr(value, '-') ||
+        result < min_value || result > max_value)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Invalid value \"%s\" of option --%s: expected an"
+                        " integer from %u to %u.",
+                        value, option, min_value, max_value);
+    return result;
+}
+
 extern "C" int mhamain(int argc, char* argv[])
 {
     unsigned short port(33337);
@@ -375,6 +786,8 @@ extern "C" int mhamain(int argc, char* argv[])
         unsigned short announce_port(0);
         std::string interface_("127.0.0.1");
         std::string logfile("");
+        unsigned query_threads(0);
+        unsigned snapshot_interval_ms(50);
         // command line interface...
         int option;
         static struct option long_options[] = {
@@ -388,6 +801,8 @@ extern "C" int mhamain(int argc, char* argv[])
             {"fail-ack",   1, NULL, 'f'},
             {"log",        1, NULL, 'm'},
             {"daemon",     0, NULL, 'd'},
+            {"query-threads",     1, NULL, 'Q'},
+            {"snapshot-interval", 1, NULL, 'S'},
             {NULL,         0, NULL, 0  }
         };
         static char short_options[] = "qhp:a:o:f:i:dm:";
@@ -432,6 +847,15 @@ extern "C" int mhamain(int argc, char* argv[])
             case 't':
                 b_interactive = true;
                 break;
+            case 'Q':
+                query_threads = parse_unsigned_option("query-threads",
+                                                      optarg, 0U, 256U);
+                break;
+            case 'S':
+                snapshot_interval_ms =
+                    parse_unsigned_option("snapshot-interval",
+                                          optarg, 1U, 60000U);
+                break;
             };
         }
         if(!b_quiet) {
@@ -447,6 +871,7 @@ extern "C" int mhamain(int argc, char* argv[])
         do{
             server = new mhaserver_t(ack_ok,ack_fail,logfile,b_interactive);
             server->set_announce_port(announce_port);
+            server->set_query_threads(query_threads, snapshot_interval_ms);
             if( !b_quiet )
                 for(int k=optind;k<argc;k++){
                     server->logstring("Parsing command line argument \""+std::string(argv[k])+"\", please wait.\n");
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2009 2013 2016 2017 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -30,6 +31,26 @@ std::vector<mha_real_t> convert_f2logf(const std::vector<mha_real_t>& vF)
     return ret;
 }
 
+/** Test if the samples in v are equidistant and increasing.
+ * @param v Samples
+ * @param xmin Value of first sample, set if uniform.
+ * @param xstep Sample distance, set if uniform.
+ * @return true if v has at least two entries with equal distance. */
+static bool is_uniform_grid(const std::vector<mha_real_t>& v,mha_real_t& xmin,mha_real_t& xstep)
+{
+    if( v.size() < 2 )
+        return false;
+    const double step = ((double)v.back() - v.front())/(v.size()-1);
+    if( !(step > 0) )
+        return false;
+    for(unsigned int k=0;k<v.size();k++)
+        if( fabs(v[k] - (v.front() + k*step)) > 1e-4*step )
+            return false;
+    xmin = v.front();
+    xstep = step;
+    return true;
+}
+
 gaintable_t::gaintable_t(const std::vector<mha_real_t>& LInput,const std::vector<mha_real_t>& FCenter,unsigned int channels)
     : num_L(LInput.size()),
       num_F(FCenter.size()),
@@ -47,6 +68,23 @@ gaintable_t::gaintable_t(const std::vector<mha_real_t>& LInput,const std::vector
                 data[ch][kf][kl] = 0;
         }
     }
+    update_grid();
+}
+
+void gaintable_t::update_grid()
+{
+    grid_L.clear();
+    grid_FL.clear();
+    mha_real_t Lmin, Lstep, Fmin, Fstep;
+    if( !is_uniform_grid(vL,Lmin,Lstep) )
+        return;
+    for(unsigned int ch=0;ch<num_channels;ch++)
+        for(unsigned int kf=0;kf<num_F;kf++)
+            grid_L.add_band(data[ch][kf],Lmin,Lstep);
+    if( !is_uniform_grid(vFlog,Fmin,Fstep) )
+        return;
+    for(unsigned int ch=0;ch<num_channels;ch++)
+        grid_FL.push_back(MHATableLookup::uniform_grid_table2d_t(data[ch],Fmin,Fstep,Lmin,Lstep));
 }
 
 gaintable_t::~gaintable_t()
@@ -65,11 +103,15 @@ std::vector<std::vector<mha_real_t> > gaintable_t::get_iofun() const
 
 mha_real_t gaintable_t::get_gain(mha_real_t Lin,mha_real_t Fin,unsigned int channel)
 {
+    if( grid_FL.size() )
+        return grid_FL[channel].interp(log(Fin),Lin);
     return interp2(vFlog,vL,data[channel],log(Fin),Lin);
 }
 
 mha_real_t gaintable_t::get_gain(mha_real_t Lin, unsigned int band, unsigned int channel)
 {
+    if( grid_L.nbands() )
+        return grid_L.interp(num_F*channel+band,Lin);
     return interp1(vL,data[channel][band],Lin);
 }
 
@@ -78,6 +120,11 @@ void gaintable_t::get_gain(const mha_wave_t& Lin,mha_wave_t& Gain)
     MHA_assert_equal(Lin.num_channels,num_channels*num_F);
     MHA_assert_equal(Lin.num_channels,Gain.num_channels);
     MHA_assert_equal(Lin.num_frames,Gain.num_frames);
+    if( grid_L.nbands() ){
+        for(unsigned int kt=0;kt<Lin.num_frames;kt++)
+            grid_L.interp(Lin.buf+kt*Lin.num_channels,Gain.buf+kt*Gain.num_channels);
+        return;
+    }
     for(unsigned int ch=0;ch<num_channels;ch++)
         for(unsigned int kf=0;kf<num_F;kf++)
             for(unsigned int kt=0;kt<Lin.num_frames;kt++)
@@ -118,6 +165,7 @@ void gaintable_t::update(std::vector<std::vector<std::vector<mha_real_t> > > new
         }
     }
     data = newGain;
+    update_grid();
 }
 
 mha_real_t DynComp::interp1(const std::vector<mha_real_t>& vX, const std::vector<mha_real_t>& vY, mha_real_t X)
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2009 2013 2016 2017 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -19,6 +20,7 @@
 #include "mha_defs.h"
 #include "mha_error.hh"
 #include "auditory_profile.h"
+#include "mha_tablelookup.hh"
 
 //#define DEBUG(x) std::cerr << __FILE__ << ":" << __LINE__ << " " << #x " = " << x << std::endl
 
@@ -57,6 +59,14 @@ namespace DynComp {
        given in the constructor. The gain entries can be updated with
        the update() member function via a gain prescription rule from
        an auditory profile.
+
+       If the input level samples are equidistant, the gain entries are
+       additionally kept in cached uniform grid tables
+       (MHATableLookup::uniform_grid_table_t), and the level lookup uses
+       direct index computation instead of a linear search.  The same
+       applies to the frequency dimension if the logarithmic frequency
+       samples are equidistant.  Non-uniform tables use interp1() and
+       interp2().
      */
     class gaintable_t
     {
@@ -124,6 +134,15 @@ namespace DynComp {
         std::vector<mha_real_t> vF;
         std::vector<mha_real_t> vFlog;
         std::vector<std::vector<std::vector<mha_real_t> > > data;
+        /** Rebuild cached uniform grid tables from data. */
+        void update_grid();
+        /** Uniform level grid, one band for each channel and
+         * frequency (index num_F*channel+band), empty if vL is not
+         * equidistant. */
+        MHATableLookup::uniform_grid_table_t grid_L;
+        /** Uniform frequency-level grid, one for each channel, empty if
+         * vL or vFlog are not equidistant. */
+        std::vector<MHATableLookup::uniform_grid_table2d_t> grid_FL;
     };
 
 }
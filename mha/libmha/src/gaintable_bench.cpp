@@ -0,0 +1,82 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the gain lookup on a uniform level grid with the linear
+// search of interp1.
+
+#include "gaintable.h"
+#include "mha_signal.hh"
+#include <chrono>
+#include <iostream>
+#include <math.h>
+
+namespace {
+  /// Gain table content with some structure in level and frequency
+  std::vector<std::vector<std::vector<mha_real_t> > >
+  make_gains(unsigned channels, unsigned bands, unsigned levels)
+  {
+    std::vector<std::vector<std::vector<mha_real_t> > > g(channels);
+    for (unsigned ch = 0; ch < channels; ++ch) {
+      g[ch].resize(bands);
+      for (unsigned kf = 0; kf < bands; ++kf)
+        for (unsigned kl = 0; kl < levels; ++kl)
+          g[ch][kf].push_back(30.0f - 0.3f * kl * kl / levels
+                              + 2.0f * kf + 5.0f * ch
+                              + 3.0f * sinf(kl + kf));
+    }
+    return g;
+  }
+}
+
+int main()
+{
+  const unsigned bands = 32, channels = 2, frames = 64, blocks = 2000;
+  std::vector<mha_real_t> vL, vF;
+  for (unsigned kl = 0; kl < 121; ++kl)
+    vL.push_back(kl);
+  for (unsigned kf = 0; kf < bands; ++kf)
+    vF.push_back(100.0f * powf(2.0f, kf / 4.0f));
+  DynComp::gaintable_t gt(vL, vF, channels);
+  auto g = make_gains(channels, bands, vL.size());
+  gt.update(g);
+  MHASignal::waveform_t Lin(frames, channels * bands);
+  MHASignal::waveform_t Gain(frames, channels * bands);
+  for (unsigned k = 0; k < size(Lin); ++k)
+    Lin.buf[k] = (k * 37) % 120;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned b = 0; b < blocks; ++b)
+    gt.get_gain(Lin, Gain);
+  auto t1 = std::chrono::steady_clock::now();
+  for (unsigned b = 0; b < blocks; ++b)
+    for (unsigned ch = 0; ch < channels; ++ch)
+      for (unsigned kf = 0; kf < bands; ++kf)
+        for (unsigned kt = 0; kt < frames; ++kt)
+          Gain.value(kt, bands * ch + kf) =
+            DynComp::interp1(vL, g[ch][kf], Lin.value(kt, bands * ch + kf));
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << "uniform grid: "
+            << std::chrono::duration<double,std::micro>(t1-t0).count()/blocks
+            << " us/block, linear search: "
+            << std::chrono::duration<double,std::micro>(t2-t1).count()/blocks
+            << " us/block" << std::endl;
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,107 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gaintable.h"
+#include "mha_signal.hh"
+#include <gtest/gtest.h>
+#include <math.h>
+
+namespace {
+  /// Gain table content with some structure in level and frequency
+  std::vector<std::vector<std::vector<mha_real_t> > >
+  make_gains(unsigned channels, unsigned bands, unsigned levels)
+  {
+    std::vector<std::vector<std::vector<mha_real_t> > > g(channels);
+    for (unsigned ch = 0; ch < channels; ++ch) {
+      g[ch].resize(bands);
+      for (unsigned kf = 0; kf < bands; ++kf)
+        for (unsigned kl = 0; kl < levels; ++kl)
+          g[ch][kf].push_back(30.0f - 0.3f * kl * kl / levels
+                              + 2.0f * kf + 5.0f * ch
+                              + 3.0f * sinf(kl + kf));
+    }
+    return g;
+  }
+  std::vector<mha_real_t> uniform(mha_real_t first, mha_real_t step, unsigned n)
+  {
+    std::vector<mha_real_t> v;
+    for (unsigned k = 0; k < n; ++k)
+      v.push_back(first + step * k);
+    return v;
+  }
+}
+
+TEST(gaintable_t, uniform_level_grid_matches_interp1)
+{
+  const std::vector<mha_real_t> vL = uniform(0, 5, 25);
+  const std::vector<mha_real_t> vF = {250, 500, 1000, 2000, 4000, 8000};
+  DynComp::gaintable_t gt(vL, vF, 2);
+  auto g = make_gains(2, vF.size(), vL.size());
+  gt.update(g);
+  MHASignal::waveform_t Lin(3, 2 * vF.size()), Gain(3, 2 * vF.size());
+  for (mha_real_t L = -20; L < 140; L += 1.3f) {
+    for (unsigned ch = 0; ch < 2; ++ch)
+      for (unsigned kf = 0; kf < vF.size(); ++kf) {
+        mha_real_t expected = DynComp::interp1(vL, g[ch][kf], L);
+        EXPECT_NEAR(expected, gt.get_gain(L, kf, ch), 1e-3f) << L;
+        for (unsigned kt = 0; kt < Lin.num_frames; ++kt)
+          Lin.value(kt, vF.size() * ch + kf) = L + kt;
+      }
+    gt.get_gain(Lin, Gain);
+    for (unsigned ch = 0; ch < 2; ++ch)
+      for (unsigned kf = 0; kf < vF.size(); ++kf)
+        for (unsigned kt = 0; kt < Lin.num_frames; ++kt)
+          EXPECT_NEAR(DynComp::interp1(vL, g[ch][kf], L + kt),
+                      Gain.value(kt, vF.size() * ch + kf), 1e-3f);
+  }
+}
+
+TEST(gaintable_t, uniform_frequency_level_grid_matches_interp2)
+{
+  // octave spaced frequencies are uniform on the logarithmic axis
+  const std::vector<mha_real_t> vL = uniform(10, 10, 10);
+  const std::vector<mha_real_t> vF = {250, 500, 1000, 2000, 4000, 8000};
+  DynComp::gaintable_t gt(vL, vF, 2);
+  auto g = make_gains(2, vF.size(), vL.size());
+  gt.update(g);
+  std::vector<mha_real_t> vFlog;
+  for (auto f : vF)
+    vFlog.push_back(log(f));
+  for (unsigned ch = 0; ch < 2; ++ch)
+    for (mha_real_t F : {100.0f, 250.0f, 700.0f, 1000.0f, 3000.0f, 8000.0f})
+      for (mha_real_t L : {5.0f, 10.0f, 33.0f, 67.5f, 100.0f})
+        EXPECT_NEAR(DynComp::interp2(vFlog, vL, g[ch], log(F), L),
+                    gt.get_gain(L, F, ch), 1e-3f) << F << " Hz, " << L << " dB";
+}
+
+TEST(gaintable_t, non_uniform_grid_uses_linear_search)
+{
+  const std::vector<mha_real_t> vL = {0, 10, 30, 60, 100};
+  const std::vector<mha_real_t> vF = {500, 1000, 3000};
+  DynComp::gaintable_t gt(vL, vF, 1);
+  auto g = make_gains(1, vF.size(), vL.size());
+  gt.update(g);
+  for (mha_real_t L : {-5.0f, 0.0f, 17.0f, 45.0f, 99.0f, 120.0f})
+    for (unsigned kf = 0; kf < vF.size(); ++kf)
+      EXPECT_FLOAT_EQ(DynComp::interp1(vL, g[0][kf], L),
+                      gt.get_gain(L, kf, 0));
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
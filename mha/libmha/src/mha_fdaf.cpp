@@ -0,0 +1,169 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_fdaf.hh"
+#include "mha_error.hh"
+#include <algorithm>
+
+namespace {
+    void check_block(const mha_wave_t & s, unsigned frames, unsigned channels,
+                     const char * method)
+    {
+        if (s.num_frames != frames || s.num_channels != channels)
+            throw MHA_Error(__FILE__, __LINE__,
+                            "MHAFDAF::pbfdaf_t::%s: Expected a block of %u"
+                            " frames and %u channels, got %u frames and %u"
+                            " channels.", method, frames, channels,
+                            s.num_frames, s.num_channels);
+    }
+}
+
+MHAFDAF::pbfdaf_t::input_t::input_t(unsigned nfft, unsigned nbins,
+                                    unsigned channels, unsigned npart)
+    : win(nfft, channels),
+      spec(npart, MHASignal::spectrum_t(nbins, channels)),
+      head(0)
+{
+}
+
+MHAFDAF::pbfdaf_t::pbfdaf_t(unsigned ntaps_, unsigned frames_,
+                            unsigned channels_, unsigned ninputs)
+    : ntaps(ntaps_),
+      frames(frames_),
+      channels(channels_),
+      npart(frames_ ? (ntaps_ + frames_ - 1) / frames_ : 0),
+      nfft(2 * frames_),
+      nbins(frames_ + 1),
+      fft(nullptr),
+      inputs(ninputs, input_t(nfft, nbins, channels, npart)),
+      W(npart, MHASignal::spectrum_t(nbins, channels)),
+      S(nbins, channels),
+      y_win(nfft, channels),
+      e_win(nfft, channels),
+      E(nbins, channels),
+      taps_(ntaps, channels)
+{
+    if (ntaps == 0 || frames == 0 || channels == 0 || ninputs == 0)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "MHAFDAF::pbfdaf_t: ntaps (%u), frames (%u),"
+                        " channels (%u) and inputs (%u) must be positive.",
+                        ntaps, frames, channels, ninputs);
+    fft = mha_fft_new(nfft);
+}
+
+MHAFDAF::pbfdaf_t::~pbfdaf_t()
+{
+    mha_fft_free(fft);
+}
+
+void MHAFDAF::pbfdaf_t::check(unsigned input) const
+{
+    if (input >= inputs.size())
+        throw MHA_Error(__FILE__, __LINE__,
+                        "MHAFDAF::pbfdaf_t: Input %u does not exist,"
+                        " there are %zu inputs.", input, inputs.size());
+}
+
+void MHAFDAF::pbfdaf_t::push(unsigned input, const mha_wave_t & s)
+{
+    check(input);
+    check_block(s, frames, channels, "push");
+    input_t & in = inputs[input];
+    std::copy(in.win.buf + frames * channels, in.win.buf + nfft * channels,
+              in.win.buf);
+    std::copy(s.buf, s.buf + frames * channels, in.win.buf + frames * channels);
+    // the newest spectrum replaces the oldest partition
+    in.head = (in.head + npart - 1) % npart;
+    mha_fft_wave2spec_scale(fft, &in.win, &in.spec[in.head]);
+}
+
+void MHAFDAF::pbfdaf_t::filter(unsigned input, mha_wave_t & y)
+{
+    check(input);
+    check_block(y, frames, channels, "filter");
+    const input_t & in = inputs[input];
+    clear(S);
+    for (unsigned p = 0; p < npart; ++p) {
+        const mha_complex_t * x = in.spec[(in.head + p) % npart].buf;
+        const mha_complex_t * w = W[p].buf;
+        for (unsigned k = 0; k < nbins * channels; ++k)
+            S.buf[k] += w[k] * x[k];
+    }
+    mha_fft_spec2wave_scale(fft, &S, &y_win);
+    // overlap-save: the second half is the linear convolution
+    std::copy(y_win.buf + frames * channels, y_win.buf + nfft * channels, y.buf);
+}
+
+MHASignal::spectrum_t & MHAFDAF::pbfdaf_t::transform_error(const mha_wave_t & e)
+{
+    check_block(e, frames, channels, "transform_error");
+    std::copy(e.buf, e.buf + frames * channels, e_win.buf + frames * channels);
+    mha_fft_wave2spec_scale(fft, &e_win, &E);
+    return E;
+}
+
+void MHAFDAF::pbfdaf_t::adapt(unsigned input)
+{
+    check(input);
+    const input_t & in = inputs[input];
+    for (unsigned p = 0; p < npart; ++p) {
+        const mha_complex_t * x = in.spec[(in.head + p) % npart].buf;
+        for (unsigned k = 0; k < nbins * channels; ++k)
+            W[p].buf[k] += _conjugate(x[k]) * E.buf[k];
+        mha_fft_spec2wave_scale(fft, &W[p], &y_win);
+        for (unsigned kf = 0; kf < frames; ++kf) {
+            const unsigned tap = p * frames + kf;
+            for (unsigned ch = 0; ch < channels; ++ch) {
+                mha_real_t & w = y_win(kf, ch);
+                if (tap < ntaps) {
+                    w = std::min(std::max(w, -1.0e20f), 1.0e20f);
+                    taps_(tap, ch) = w;
+                }
+                else
+                    w = 0;
+                y_win(frames + kf, ch) = 0;
+            }
+        }
+        mha_fft_wave2spec_scale(fft, &y_win, &W[p]);
+    }
+}
+
+MHAFDAF::power_t::power_t(unsigned length, unsigned channels)
+    : history(length, channels), pos(0), power(channels, 0.0f)
+{
+}
+
+void MHAFDAF::power_t::push(const mha_wave_t & s)
+{
+    for (unsigned kf = 0; kf < s.num_frames; ++kf) {
+        for (unsigned ch = 0; ch < history.num_channels; ++ch)
+            history(pos, ch) = value(s, kf, ch);
+        pos = (pos + 1) % history.num_frames;
+    }
+    // summed anew for each block, a running sum would accumulate
+    // rounding errors
+    for (unsigned ch = 0; ch < history.num_channels; ++ch) {
+        power[ch] = 0.0f;
+        for (unsigned k = 0; k < history.num_frames; ++k)
+            power[ch] += history(k, ch) * history(k, ch);
+    }
+}
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
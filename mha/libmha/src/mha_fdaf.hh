@@ -0,0 +1,166 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_FDAF_HH
+#define MHA_FDAF_HH
+
+#include "mha.hh"
+#include "mha_signal.hh"
+#include <vector>
+
+/**
+    \ingroup mhatoolbox
+    \file mha_fdaf.hh
+    \brief Partitioned block frequency domain adaptive filter
+    for adaptive filtering plugins
+*/
+
+/** \ingroup mhatoolbox
+    \brief Namespace for frequency domain adaptive filters
+*/
+namespace MHAFDAF {
+
+    /** Partitioned block frequency domain adaptive filter (multi-delay
+     * filter) with partitions of one block.
+     *
+     * The filter of ntaps taps is split into
+     * \f$P = \lceil ntaps / B \rceil\f$ partitions of the block length
+     * B, each applied in the frequency domain with FFTs of length 2B
+     * by overlap-save.  Per block and channel, filtering costs one FFT
+     * pair plus P complex multiply-adds per bin, and an update one FFT
+     * for the error plus one FFT pair per partition for the gradient
+     * constraint, instead of O(B ntaps) multiply-adds in the time
+     * domain.
+     *
+     * The engine keeps the spectra of the last P windows of a number
+     * of input signals, which share the filter.  A block is processed
+     * in this order: push() each input, filter() the inputs whose
+     * output is needed, then transform_error() and adapt() with the
+     * input that the error belongs to.  The step size and the
+     * normalization are up to the caller: the error block passed to
+     * transform_error() is already scaled, and the returned spectrum
+     * can be scaled further per frequency bin.
+     */
+    class pbfdaf_t {
+    public:
+        /** @param ntaps    Length of the adaptive filter
+         *  @param frames   Block length, also the partition length
+         *  @param channels Number of independent channels
+         *  @param inputs   Number of input signals filtered with the
+         *                  same filter */
+        pbfdaf_t(unsigned ntaps, unsigned frames, unsigned channels,
+                 unsigned inputs = 1);
+        ~pbfdaf_t();
+        pbfdaf_t(const pbfdaf_t &) = delete;
+        pbfdaf_t & operator=(const pbfdaf_t &) = delete;
+
+        /** Appends one block to the history of an input signal.
+         * @param input Index of the input signal
+         * @param s     Block of frames x channels samples
+         * @throw MHA_Error if the dimensions do not match */
+        void push(unsigned input, const mha_wave_t & s);
+
+        /** Filters the history of an input with the current filter.
+         * @param input Index of the input signal
+         * @param y     Output, the filtered last block, frames x channels */
+        void filter(unsigned input, mha_wave_t & y);
+
+        /** Spectrum of the newest window of an input, two blocks long.
+         * @param input Index of the input signal */
+        const MHASignal::spectrum_t & spectrum(unsigned input) const
+        {check(input); return inputs[input].spec[inputs[input].head];}
+
+        /** Transforms a block of the scaled error signal, zero padded
+         * in front to two blocks.
+         * @param e Error block, frames x channels
+         * @return Spectrum of the error, which adapt() uses and which
+         *         the caller may scale per bin for the normalization */
+        MHASignal::spectrum_t & transform_error(const mha_wave_t & e);
+
+        /** Adds the gradient of the last error to the filter.
+         *
+         * The gradient of each partition, \f$X^*_p E\f$, is
+         * constrained to the first half of the window, so that the
+         * partitions form a linear filter of ntaps taps.  Tap values
+         * are limited to \f$\pm 10^{20}\f$.
+         * @param input Index of the input signal that caused the error */
+        void adapt(unsigned input);
+
+        /// Time domain taps of the filter, ntaps x channels
+        const mha_wave_t & taps() const {return taps_;}
+        /// Number of partitions
+        unsigned partitions() const {return npart;}
+        /// FFT length, two blocks
+        unsigned fftlen() const {return nfft;}
+    private:
+        /// Windows and spectra of one input signal
+        struct input_t {
+            input_t(unsigned nfft, unsigned nbins, unsigned channels,
+                    unsigned npart);
+            /// The last two blocks
+            MHASignal::waveform_t win;
+            /// Spectra of the last npart windows, newest at head
+            std::vector<MHASignal::spectrum_t> spec;
+            unsigned head;
+        };
+        /// @throw MHA_Error if there is no input with this index
+        void check(unsigned input) const;
+        unsigned ntaps;
+        unsigned frames;
+        unsigned channels;
+        unsigned npart;
+        unsigned nfft;
+        unsigned nbins;
+        mha_fft_t fft;
+        std::vector<input_t> inputs;
+        /// Filter partitions
+        std::vector<MHASignal::spectrum_t> W;
+        /// Scratch: product spectrum and time window
+        MHASignal::spectrum_t S;
+        MHASignal::waveform_t y_win;
+        /// Error window, zeros followed by the error block, and its spectrum
+        MHASignal::waveform_t e_win;
+        MHASignal::spectrum_t E;
+        MHASignal::waveform_t taps_;
+    };
+
+    /** Power of a signal over the last length samples, per channel,
+     * evaluated once per block for the step size normalization of
+     * #MHAFDAF::pbfdaf_t. */
+    class power_t {
+    public:
+        /** @param length   Number of samples in the power sum
+         *  @param channels Number of channels */
+        power_t(unsigned length, unsigned channels);
+        /// Appends a block of samples and updates the power
+        void push(const mha_wave_t & s);
+        /// Sum of the squares of the last length samples in channel ch
+        mha_real_t operator[](unsigned ch) const {return power[ch];}
+    private:
+        /// The last length samples, ring buffer
+        MHASignal::waveform_t history;
+        unsigned pos;
+        std::vector<mha_real_t> power;
+    };
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,177 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_fdaf.hh"
+#include "mha_error.hh"
+#include <cmath>
+
+namespace {
+    /// Reproducible white noise in [-1,1]
+    class noise_t {
+    public:
+        mha_real_t operator()() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+    private:
+        uint32_t state = 12345U;
+    };
+
+    /// Impulse response of the unknown system, channel ch gets gain ch+1
+    mha_real_t response(unsigned tap, unsigned ch) {
+        return (ch + 1) * std::exp(-0.1f * tap) * std::cos(0.9f * tap);
+    }
+
+    /// Feeds noise through the unknown system of ntaps taps
+    class system_t {
+    public:
+        system_t(unsigned frames, unsigned channels, unsigned ntaps)
+            : u(frames, channels), d(frames, channels),
+              history(ntaps, channels)
+        {}
+        void next_block() {
+            for (unsigned k = 0; k < u.num_frames; ++k)
+                for (unsigned ch = 0; ch < u.num_channels; ++ch) {
+                    for (unsigned tap = history.num_frames - 1; tap > 0; --tap)
+                        history(tap, ch) = history(tap - 1, ch);
+                    history(0, ch) = u(k, ch) = noise();
+                    d(k, ch) = 0;
+                    for (unsigned tap = 0; tap < history.num_frames; ++tap)
+                        d(k, ch) += response(tap, ch) * history(tap, ch);
+                }
+        }
+        MHASignal::waveform_t u, d;
+    private:
+        MHASignal::waveform_t history;
+        noise_t noise;
+    };
+
+    /// One block of normalized LMS: error, step size, gradient
+    void nlms_block(MHAFDAF::pbfdaf_t & fdaf, MHAFDAF::power_t & power,
+                    const system_t & sys, MHASignal::waveform_t & e,
+                    mha_real_t stepsize)
+    {
+        fdaf.push(0, sys.u);
+        power.push(sys.u);
+        fdaf.filter(0, e);
+        for (unsigned k = 0; k < e.num_frames; ++k)
+            for (unsigned ch = 0; ch < e.num_channels; ++ch)
+                e(k, ch) = stepsize * (sys.d(k, ch) - e(k, ch)) /
+                    (power[ch] + 1e-5f);
+        fdaf.transform_error(e);
+        fdaf.adapt(0);
+    }
+}
+
+TEST(pbfdaf_t, identifies_system)
+{
+    // 40 taps in partitions of 16: the last partition is incomplete
+    const unsigned frames = 16, channels = 2, ntaps = 40;
+    system_t sys(frames, channels, ntaps);
+    MHAFDAF::pbfdaf_t fdaf(ntaps, frames, channels);
+    MHAFDAF::power_t power(ntaps, channels);
+    MHASignal::waveform_t e(frames, channels);
+    EXPECT_EQ(3U, fdaf.partitions());
+    EXPECT_EQ(32U, fdaf.fftlen());
+    for (unsigned b = 0; b < 400; ++b) {
+        sys.next_block();
+        nlms_block(fdaf, power, sys, e, 0.5f);
+    }
+    for (unsigned ch = 0; ch < channels; ++ch)
+        for (unsigned tap = 0; tap < ntaps; ++tap)
+            EXPECT_NEAR(response(tap, ch), value(fdaf.taps(), tap, ch), 1e-3f)
+                << "channel " << ch << " tap " << tap;
+}
+
+TEST(pbfdaf_t, filter_is_linear_convolution_with_taps)
+{
+    const unsigned frames = 8, channels = 1, ntaps = 20;
+    system_t sys(frames, channels, ntaps);
+    MHAFDAF::pbfdaf_t fdaf(ntaps, frames, channels, 2);
+    MHAFDAF::power_t power(ntaps, channels);
+    MHASignal::waveform_t e(frames, channels), y(frames, channels);
+    for (unsigned b = 0; b < 5; ++b) {
+        sys.next_block();
+        nlms_block(fdaf, power, sys, e, 0.5f);
+    }
+    // filter a second input with the frozen filter, keep its history
+    noise_t noise;
+    std::vector<mha_real_t> x_history;
+    MHASignal::waveform_t x(frames, channels);
+    for (unsigned b = 0; b < 6; ++b) {
+        for (unsigned k = 0; k < frames; ++k)
+            x_history.push_back(x(k, 0) = noise());
+        fdaf.push(1, x);
+        fdaf.filter(1, y);
+        // the history starts with silence
+        const unsigned n0 = x_history.size() - frames;
+        for (unsigned k = 0; k < frames; ++k) {
+            mha_real_t expected = 0;
+            for (unsigned tap = 0; tap < ntaps && tap <= n0 + k; ++tap)
+                expected += value(fdaf.taps(), tap, 0) * x_history[n0 + k - tap];
+            EXPECT_NEAR(expected, y(k, 0), 1e-5f) << b << " " << k;
+        }
+    }
+}
+
+TEST(pbfdaf_t, checks_dimensions)
+{
+    EXPECT_THROW(MHAFDAF::pbfdaf_t(0, 8, 1), MHA_Error);
+    EXPECT_THROW(MHAFDAF::pbfdaf_t(8, 0, 1), MHA_Error);
+    MHAFDAF::pbfdaf_t fdaf(20, 8, 2);
+    EXPECT_EQ(3U, fdaf.partitions());
+    MHASignal::waveform_t block(8, 2), short_block(4, 2), mono(8, 1);
+    EXPECT_NO_THROW(fdaf.push(0, block));
+    EXPECT_THROW(fdaf.push(1, block), MHA_Error);
+    EXPECT_THROW(fdaf.push(0, short_block), MHA_Error);
+    EXPECT_THROW(fdaf.filter(0, mono), MHA_Error);
+    EXPECT_THROW(fdaf.transform_error(short_block), MHA_Error);
+    EXPECT_THROW(fdaf.adapt(1), MHA_Error);
+}
+
+TEST(power_t, sums_squares_of_last_samples)
+{
+    // one power shorter and one longer than the block
+    MHAFDAF::power_t short_power(5, 2), long_power(20, 2);
+    MHASignal::waveform_t block(8, 2);
+    std::vector<mha_real_t> history;
+    for (unsigned b = 0; b < 4; ++b) {
+        for (unsigned k = 0; k < 8; ++k) {
+            history.push_back(b * 8.0f + k);
+            block(k, 0) = history.back();
+            block(k, 1) = -2.0f * history.back();
+        }
+        short_power.push(block);
+        long_power.push(block);
+        for (unsigned length : {5U, 20U}) {
+            mha_real_t expected = 0;
+            for (unsigned k = 0; k < length && k < history.size(); ++k)
+                expected += history[history.size() - 1 - k] *
+                    history[history.size() - 1 - k];
+            const MHAFDAF::power_t & power =
+                length == 5 ? short_power : long_power;
+            EXPECT_FLOAT_EQ(expected, power[0]) << b << " " << length;
+            EXPECT_FLOAT_EQ(4.0f * expected, power[1]) << b << " " << length;
+        }
+    }
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
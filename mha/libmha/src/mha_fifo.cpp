@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2006 2008 2009 2010 2011 2013 2014 2016 2017 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -14,10 +15,111 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
+#include <cstring>
 #include <algorithm>
 #include "mha.hh"
 #include "mha_error.hh"
 #include "mha_fifo.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+#ifdef _WIN32
+mha_fifo_wakeup_t::mha_fifo_wakeup_t()
+    : armed(false),
+      event(CreateEvent(NULL, FALSE, FALSE, NULL))
+{
+    if (event == NULL)
+        throw MHA_Error(__FILE__,__LINE__,"Unable to create wakeup event");
+}
+
+mha_fifo_wakeup_t::~mha_fifo_wakeup_t()
+{
+    CloseHandle(event);
+}
+
+void mha_fifo_wakeup_t::signal()
+{
+    SetEvent(event);
+}
+
+void mha_fifo_wakeup_t::wait(unsigned timeout_ms)
+{
+    WaitForSingleObject(event, timeout_ms);
+}
+
+void mha_fifo_wakeup_t::wait()
+{
+    WaitForSingleObject(event, INFINITE);
+}
+#else
+mha_fifo_wakeup_t::mha_fifo_wakeup_t()
+    : armed(false)
+{
+#ifdef __linux__
+    fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fds[0] < 0)
+        throw MHA_Error(__FILE__,__LINE__,"Unable to create eventfd: %s",
+                        strerror(errno));
+#else
+    if (pipe(fds) != 0)
+        throw MHA_Error(__FILE__,__LINE__,"Unable to create pipe: %s",
+                        strerror(errno));
+    for (int fd : fds)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+mha_fifo_wakeup_t::~mha_fifo_wakeup_t()
+{
+    close(fds[0]);
+    if (fds[1] != fds[0])
+        close(fds[1]);
+}
+
+void mha_fifo_wakeup_t::signal()
+{
+    // A full eventfd counter or pipe already holds a pending wakeup, so
+    // a failing non-blocking write can be ignored.
+#ifdef __linux__
+    uint64_t one = 1U;
+#else
+    char one = 1;
+#endif
+    if (write(fds[1], &one, sizeof(one)) < 0) {}
+}
+
+namespace {
+    /// Waits for a wakeup on fd and consumes all pending wakeups.
+    /// @param timeout_ms Maximum waiting time, negative for no timeout.
+    void wait_and_consume(int fd, int timeout_ms)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            char buf[64];
+            while (read(fd, buf, sizeof(buf)) > 0) {}
+        }
+    }
+}
+
+void mha_fifo_wakeup_t::wait(unsigned timeout_ms)
+{
+    wait_and_consume(fds[0], static_cast<int>(timeout_ms));
+}
+
+void mha_fifo_wakeup_t::wait()
+{
+    wait_and_consume(fds[0], -1);
+}
+#endif
 
 template <class T>
 void mha_fifo_lw_t<T>::write(const T * data, unsigned count)
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2006 2008 2009 2010 2011 2013 2016 2017 2018 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -179,6 +180,54 @@ public:
 };
 
 
+/**
+ * Wakes up the consumer thread of a lock-free FIFO from the producer thread
+ * without polling.  The consumer calls arm() before it checks whether there
+ * is enough data to process, and wait() if there is not.  The producer calls
+ * notify() after writing, e.g. when the fill count crosses a watermark.
+ * notify() is real-time safe: it takes no locks, does not allocate memory,
+ * and performs at most one non-blocking system call per arm().
+ * Works only with single producer and single consumer.
+ */
+class mha_fifo_wakeup_t {
+public:
+    mha_fifo_wakeup_t();
+    ~mha_fifo_wakeup_t();
+    mha_fifo_wakeup_t(const mha_fifo_wakeup_t &) = delete;
+    mha_fifo_wakeup_t & operator=(const mha_fifo_wakeup_t &) = delete;
+    /** Consumer announces that it may wait.  Must be called before the
+     * consumer checks the condition it waits for, so that no notification
+     * can be lost. */
+    void arm() {armed.store(true);}
+    /** Producer wakes up the consumer if it has called arm() since the last
+     * notification.  Real-time safe. */
+    void notify() {
+        if (armed.load() && armed.exchange(false))
+            signal();
+    }
+    /** Wake up the consumer unconditionally, e.g. to request termination. */
+    void signal();
+    /** Consumer waits until notify() or signal() is called or until the
+     * timeout expires.  Returns immediately if a notification has arrived
+     * since the last wait.
+     * @param timeout_ms Maximum waiting time in milliseconds. */
+    void wait(unsigned timeout_ms);
+    /** Consumer waits without timeout until notify() or signal() is
+     * called.  Returns immediately if a notification has arrived since the
+     * last wait. */
+    void wait();
+private:
+    /** Whether the consumer wants to be notified */
+    std::atomic<bool> armed;
+#ifdef _WIN32
+    /** auto-reset event */
+    void * event;
+#else
+    /** eventfd (Linux, fds[0]==fds[1]) or pipe (other platforms) */
+    int fds[2];
+#endif
+};
+
 // forward reference for the friend test class.
 class Test_mha_drifter_fifo_t;
 
@@ -187,6 +236,8 @@ class Test_mha_drifter_fifo_t;
  * Features: 
  * delay concept (desired, minimum and maximum delay),
  * drifting support by throwing away data or inserting zeroes.
+ * MHAFilter::drift_compensating_fifo_t compensates drift by resampling
+ * instead.
  */
 template <class T>
 class mha_drifter_fifo_t : public mha_fifo_t<T> {
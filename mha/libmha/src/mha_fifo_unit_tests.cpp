@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2006 2008 2011 2013 2015 2018 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 // All rights reserved.
 
 #include "mha.hh"
@@ -7,6 +8,8 @@
 #include "mha_fifo.h"
 #include <gtest/gtest.h>
 #include <thread>
+#include <chrono>
+#include <atomic>
 
 class Test_mha_fifo_lf_t : public ::testing::Test
 {
@@ -800,6 +803,83 @@ void Test_mha_rt_fifo_t::test_remove_all(void)
 }
 TEST_F(Test_mha_rt_fifo_t,test_remove_all) {test_remove_all();}
 
+TEST(mha_fifo_wakeup_t, notify_wakes_only_armed_consumer)
+{
+    using clock = std::chrono::steady_clock;
+    mha_fifo_wakeup_t wakeup;
+    // Not armed: notification is not delivered, wait runs into timeout
+    wakeup.notify();
+    auto start = clock::now();
+    wakeup.wait(50);
+    EXPECT_GE(clock::now() - start, std::chrono::milliseconds(40));
+    // Armed: only the first notification is delivered
+    wakeup.arm();
+    wakeup.notify();
+    wakeup.notify();
+    start = clock::now();
+    wakeup.wait(10000);
+    EXPECT_LT(clock::now() - start, std::chrono::milliseconds(5000));
+    start = clock::now();
+    wakeup.wait(50);
+    EXPECT_GE(clock::now() - start, std::chrono::milliseconds(40));
+}
+
+TEST(mha_fifo_wakeup_t, consumer_thread_sleeps_until_watermark)
+{
+    mha_fifo_lf_t<double> fifo(1000);
+    mha_fifo_wakeup_t wakeup;
+    const unsigned watermark = 100;
+    std::atomic<bool> done(false);
+    unsigned wakeups = 0, received = 0;
+    std::thread consumer([&]() {
+        double buf[1000];
+        while (!done.load()) {
+            wakeup.arm();
+            if (fifo.get_fill_count() < watermark && !done.load())
+                wakeup.wait(10000);
+            ++wakeups;
+            unsigned n = fifo.get_fill_count();
+            fifo.read(buf, n);
+            received += n;
+        }
+        unsigned n = fifo.get_fill_count();
+        fifo.read(buf, n);
+        received += n;
+    });
+    const double data[10] = {0};
+    unsigned sent = 0;
+    for (unsigned k = 0; k < 1000; ++k) {
+        while (fifo.get_available_space() < 10)
+            std::this_thread::yield();
+        fifo.write(data, 10);
+        sent += 10;
+        if (fifo.get_max_fill_count() - fifo.get_available_space()
+            >= watermark)
+            wakeup.notify();
+    }
+    done.store(true);
+    wakeup.signal();
+    consumer.join();
+    EXPECT_EQ(sent, received);
+    // The consumer wakes up about once per watermark, not once per write.
+    // A stale notification can cause one additional early wakeup.
+    EXPECT_LE(wakeups, 2 * sent / watermark + 2);
+}
+
+TEST(mha_fifo_wakeup_t, untimed_wait_returns_after_signal)
+{
+    mha_fifo_wakeup_t wakeup;
+    // A signal before the wait is not lost
+    wakeup.signal();
+    wakeup.wait();
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        wakeup.signal();
+    });
+    wakeup.wait();
+    producer.join();
+}
+
 // Local Variables:
 // compile-command: "make -C .. unit-tests"
 // coding: utf-8-unix
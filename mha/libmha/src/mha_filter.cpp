@@ -1,6 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2003 2004 2005 2006 2007 2008 2009 2010 2011 HörTech gGmbH
 // Copyright © 2012 2013 2014 2016 2017 2018 2019 2020 2021 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -16,12 +17,14 @@
 
 #include "mha_defs.h"
 #include "mha_filter.hh"
+#include "mha_simd.hh"
 #include <cmath>
 #include <math.h>
 #include <limits>
 #include <valarray>
 #include <algorithm>
 #include <memory>
+#include <complex>
 using namespace MHAFilter;
 
 MHAFilter::filter_t::filter_t(unsigned int ch,
@@ -354,7 +357,356 @@ void MHAFilter::adapt_filter_state_t::filter(mha_wave_t y,mha_wave_t e,mha_wave_
 }
 
 
-MHAFilter::iir_filter_state_t::iir_filter_state_t(unsigned int channels,std::vector<float> cf_A,std::vector<float> cf_B)
+namespace {
+    typedef std::complex<double> cplx_t;
+
+    /** Evaluate polynomial c[0] + c[1]*w + ... and its derivative at w. */
+    void polyval(const std::vector<double>& c,cplx_t w,cplx_t& p,cplx_t& dp)
+    {
+        p = c.back();
+        dp = 0;
+        for(unsigned int k=c.size()-1;k>0;k--){
+            dp = dp * w + p;
+            p = p * w + c[k-1];
+        }
+    }
+
+    /** Find all roots of the polynomial c[0] + c[1]*w + ... + c[n]*w^n,
+     * c[n] != 0, by simultaneous Aberth-Ehrlich iteration. */
+    std::vector<cplx_t> polyroots(const std::vector<double>& c)
+    {
+        const unsigned int n = c.size()-1;
+        std::vector<cplx_t> r(n);
+        if( n == 0 )
+            return r;
+        // initial guesses on a circle with radius given by the Fujiwara bound
+        double radius = 0;
+        for(unsigned int k=0;k<n;k++)
+            radius = std::max(radius,std::pow(std::abs(c[k]/c[n]),1.0/(n-k)));
+        radius = std::max(radius,1e-3);
+        for(unsigned int k=0;k<n;k++)
+            r[k] = std::polar(radius,2*M_PI*k/n+0.4);
+        for(unsigned int iter=0;iter<1000;iter++){
+            double maxcorr = 0;
+            for(unsigned int i=0;i<n;i++){
+                cplx_t p, dp;
+                polyval(c,r[i],p,dp);
+                if( p == 0.0 )
+                    continue;
+                cplx_t ratio = p / dp;
+                cplx_t sum = 0;
+                for(unsigned int j=0;j<n;j++)
+                    if( j != i )
+                        sum += 1.0 / (r[i] - r[j]);
+                cplx_t corr = ratio / (1.0 - ratio * sum);
+                r[i] -= corr;
+                maxcorr = std::max(maxcorr,std::abs(corr)/std::max(1.0,std::abs(r[i])));
+            }
+            if( maxcorr < 1e-15 )
+                break;
+        }
+        return r;
+    }
+
+    /** Real factor of degree 1 or 2 of a polynomial in w=z^-1,
+     * with constant coefficient 1. */
+    struct factor_t {
+        double c1 = 0; ///< coefficient of w
+        double c2 = 0; ///< coefficient of w^2
+        double radius = 0; ///< largest magnitude of the z-plane roots
+        unsigned int degree = 0;
+        cplx_t root = 0; ///< one z-plane root of this factor
+    };
+
+    /** Factorize c[0] + c[1]*w + ..., c[0] != 0, into real factors of
+     * degree <= 2.  Real roots are combined pairwise, ordered by their
+     * magnitude. */
+    std::vector<factor_t> factorize(const std::vector<double>& c)
+    {
+        std::vector<factor_t> factors;
+        std::vector<cplx_t> wroots = polyroots(c);
+        // z-plane roots q = 1/w: c(w) = c[0] * prod(1 - q*w)
+        std::vector<cplx_t> roots;
+        for(auto w : wroots)
+            roots.push_back(1.0 / w);
+        // Match complex roots with their conjugates, beginning with the
+        // largest imaginary part.  Each complex root with positive
+        // imaginary part in complex_roots represents a conjugate pair.
+        std::sort(roots.begin(),roots.end(),
+                  [](cplx_t a,cplx_t b){return std::abs(a.imag()) > std::abs(b.imag());});
+        std::vector<cplx_t> complex_roots;
+        std::vector<double> real_roots;
+        while( roots.size() ){
+            cplx_t q = roots.front();
+            roots.erase(roots.begin());
+            if( roots.empty() ||
+                (std::abs(q.imag()) <= 1e-9 * std::max(1.0,std::abs(q))) ){
+                real_roots.push_back(q.real());
+                continue;
+            }
+            unsigned int kbest = 0;
+            for(unsigned int k=1;k<roots.size();k++)
+                if( std::abs(roots[k]-std::conj(q)) < std::abs(roots[kbest]-std::conj(q)) )
+                    kbest = k;
+            q = 0.5 * (q + std::conj(roots[kbest]));
+            roots.erase(roots.begin()+kbest);
+            complex_roots.push_back(cplx_t(q.real(),std::abs(q.imag())));
+        }
+        for(auto q : complex_roots){
+            factor_t f;
+            f.c1 = -2*q.real();
+            f.c2 = std::norm(q);
+            f.radius = std::abs(q);
+            f.degree = 2;
+            f.root = q;
+            factors.push_back(f);
+        }
+        std::sort(real_roots.begin(),real_roots.end(),
+                  [](double a,double b){return std::abs(a) < std::abs(b);});
+        for(unsigned int k=0;k<real_roots.size();k+=2){
+            factor_t f;
+            f.root = real_roots[k];
+            f.radius = std::abs(real_roots[k]);
+            if( k+1 < real_roots.size() ){
+                f.c1 = -(real_roots[k]+real_roots[k+1]);
+                f.c2 = real_roots[k]*real_roots[k+1];
+                f.radius = std::max(f.radius,std::abs(real_roots[k+1]));
+                f.degree = 2;
+            }else{
+                f.c1 = -real_roots[k];
+                f.degree = 1;
+            }
+            factors.push_back(f);
+        }
+        return factors;
+    }
+
+    /** Copy coefficients to double precision, drop trailing zeros. */
+    std::vector<double> trim_poly(const std::vector<mha_real_t>& v)
+    {
+        std::vector<double> c(v.begin(),v.end());
+        while( c.size() && (c.back() == 0) )
+            c.pop_back();
+        return c;
+    }
+}
+
+std::vector<std::vector<mha_real_t> >
+MHAFilter::tf2sos(const std::vector<mha_real_t>& vA,const std::vector<mha_real_t>& vB)
+{
+    if( vA.empty() || (vA[0] == 0) )
+        throw MHA_Error(__FILE__,__LINE__,"tf2sos: First recursive filter coefficient must not be zero.");
+    std::vector<double> a = trim_poly(vA);
+    std::vector<double> b = trim_poly(vB);
+    std::vector<std::vector<mha_real_t> > sos;
+    if( b.empty() ){
+        sos.push_back({0,0,0,1,0,0});
+        return sos;
+    }
+    // leading zeros of B are pure delays
+    unsigned int delay = 0;
+    while( b[delay] == 0 )
+        delay++;
+    b.erase(b.begin(),b.begin()+delay);
+    const double b_0 = b[0];
+    const double gain = b_0 / a[0];
+    for(auto & c : b) c /= b_0;
+    for(unsigned int k=a.size();k>0;k--) a[k-1] /= a[0];
+    std::vector<factor_t> poles = factorize(a);
+    std::vector<factor_t> zeros = factorize(b);
+    // combine delays and first order zero factors into factors of degree 2
+    for(unsigned int k=0;k<delay;k++){
+        factor_t f;
+        f.degree = 1;
+        f.radius = std::numeric_limits<double>::infinity();
+        // a delay factor is the polynomial 0 + 1*w, it has no finite
+        // z-plane root and is marked by an infinite radius
+        zeros.push_back(f);
+    }
+    auto poly_of = [](const factor_t& f){
+        if( std::isinf(f.radius) )
+            return std::vector<double>{0.0,1.0,0.0};
+        return std::vector<double>{1.0,f.c1,f.c2};
+    };
+    auto merge_first_order = [&](std::vector<factor_t>& v,
+                                 std::vector<std::vector<double> >& polys){
+        std::vector<std::vector<double> > first;
+        std::vector<factor_t> firstf;
+        for(auto & f : v){
+            if( f.degree == 2 ){
+                polys.push_back(poly_of(f));
+            }else{
+                first.push_back(poly_of(f));
+                firstf.push_back(f);
+            }
+        }
+        std::vector<factor_t> merged;
+        for(auto & f : v)
+            if( f.degree == 2 )
+                merged.push_back(f);
+        for(unsigned int k=0;k<first.size();k+=2){
+            factor_t f = firstf[k];
+            if( k+1 < first.size() ){
+                const std::vector<double>& p = first[k];
+                const std::vector<double>& q = first[k+1];
+                polys.push_back({p[0]*q[0],p[0]*q[1]+p[1]*q[0],p[1]*q[1]});
+                f.radius = std::max(f.radius,firstf[k+1].radius);
+                f.degree = 2;
+            }else{
+                polys.push_back(first[k]);
+            }
+            merged.push_back(f);
+        }
+        v = merged;
+    };
+    std::vector<std::vector<double> > ppolys, zpolys;
+    merge_first_order(poles,ppolys);
+    merge_first_order(zeros,zpolys);
+    const unsigned int nsec = std::max<unsigned int>(1,std::max(ppolys.size(),zpolys.size()));
+    // order pole factors by increasing radius; pad with trivial factors
+    std::vector<unsigned int> porder(ppolys.size());
+    for(unsigned int k=0;k<porder.size();k++) porder[k] = k;
+    std::sort(porder.begin(),porder.end(),
+              [&](unsigned int i,unsigned int j){return poles[i].radius < poles[j].radius;});
+    std::vector<bool> zused(zpolys.size(),false);
+    std::vector<std::vector<double> > num(nsec,{1.0,0.0,0.0}), den(nsec,{1.0,0.0,0.0});
+    // Pole factors not present (FIR parts) come first, so that the most
+    // resonant poles end up in the last sections.
+    const unsigned int offset = nsec - ppolys.size();
+    for(unsigned int s=0;s<ppolys.size();s++)
+        den[offset+s] = ppolys[porder[s]];
+    // Assign zeros: beginning with the most resonant poles, pick the
+    // closest unused zero factor.
+    for(unsigned int s=nsec;s>offset;s--){
+        const factor_t& pf = poles[porder[s-1-offset]];
+        double best = std::numeric_limits<double>::infinity();
+        unsigned int kbest = zpolys.size();
+        for(unsigned int k=0;k<zpolys.size();k++){
+            if( zused[k] )
+                continue;
+            double d = std::isinf(zeros[k].radius) ?
+                std::numeric_limits<double>::max() :
+                std::abs(zeros[k].root - pf.root);
+            if( (kbest == zpolys.size()) || (d < best) ){
+                best = d;
+                kbest = k;
+            }
+        }
+        if( kbest < zpolys.size() ){
+            zused[kbest] = true;
+            num[s-1] = zpolys[kbest];
+        }
+    }
+    unsigned int s = 0;
+    for(unsigned int k=0;k<zpolys.size();k++){
+        if( zused[k] )
+            continue;
+        while( (num[s][0] != 1.0) || (num[s][1] != 0.0) || (num[s][2] != 0.0) )
+            s++;
+        num[s] = zpolys[k];
+    }
+    for(auto & c : num[0])
+        c *= gain;
+    for(unsigned int k=0;k<nsec;k++)
+        sos.push_back({mha_real_t(num[k][0]),mha_real_t(num[k][1]),mha_real_t(num[k][2]),
+                       1.0f,mha_real_t(den[k][1]),mha_real_t(den[k][2])});
+    return sos;
+}
+
+MHAFilter::sos_filter_t::sos_filter_t(unsigned int channels_,
+                                      const std::vector<std::vector<mha_real_t> >& sos)
+    : channels(channels_),
+      nsections(sos.size()),
+      z1(sos.size(),channels_),
+      z2(sos.size(),channels_)
+{
+    if( channels == 0 )
+        throw MHA_Error(__FILE__,__LINE__,"sos_filter_t: The number of channels must not be zero.");
+    if( nsections == 0 )
+        throw MHA_Error(__FILE__,__LINE__,"sos_filter_t: At least one section is required.");
+    for(unsigned int k=0;k<nsections;k++){
+        if( sos[k].size() != 6 )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "sos_filter_t: Section %u has %zu coefficients, expected 6.",
+                            k,sos[k].size());
+        const mha_real_t a0 = sos[k][3];
+        if( a0 == 0 )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "sos_filter_t: Coefficient a0 of section %u is zero.",k);
+        b0.push_back(sos[k][0]/a0);
+        b1.push_back(sos[k][1]/a0);
+        b2.push_back(sos[k][2]/a0);
+        a1.push_back(sos[k][4]/a0);
+        a2.push_back(sos[k][5]/a0);
+    }
+}
+
+MHAFilter::sos_filter_t::sos_filter_t(unsigned int channels_,
+                                      const std::vector<mha_real_t>& A,
+                                      const std::vector<mha_real_t>& B)
+    : sos_filter_t(channels_,MHAFilter::tf2sos(A,B))
+{
+}
+
+void MHAFilter::sos_filter_t::filter(mha_wave_t* y,const mha_wave_t* x)
+{
+    if( (x->num_channels != channels) || (y->num_channels != channels) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mismatching number of channels (in:%u out:%u filter:%u)",
+                        x->num_channels,y->num_channels,channels);
+    if( y->num_frames != x->num_frames )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "mismatching number of frames (in:%u out:%u)",
+                        x->num_frames,y->num_frames);
+    const unsigned int nch = channels;
+    for(unsigned int fr=0;fr<x->num_frames;fr++){
+        mha_real_t* out = y->buf + fr*nch;
+        if( out != x->buf + fr*nch )
+            std::copy(x->buf + fr*nch,x->buf + (fr+1)*nch,out);
+        // transposed direct form II, all channels of a section together
+        for(unsigned int s=0;s<nsections;s++){
+            mha_real_t* __restrict s1 = z1.buf + s*nch;
+            mha_real_t* __restrict s2 = z2.buf + s*nch;
+            const mha_real_t cb0 = b0[s], cb1 = b1[s], cb2 = b2[s];
+            const mha_real_t ca1 = a1[s], ca2 = a2[s];
+            for(unsigned int ch=0;ch<nch;ch++){
+                const mha_real_t v = out[ch];
+                const mha_real_t o = cb0 * v + s1[ch];
+                s1[ch] = cb1 * v - ca1 * o + s2[ch];
+                s2[ch] = cb2 * v - ca2 * o;
+                out[ch] = o;
+            }
+        }
+    }
+    // flush denormals and non-finite values from the states once per block
+    const mha_real_t fmin = std::numeric_limits<mha_real_t>::min();
+    const mha_real_t fmax = std::numeric_limits<mha_real_t>::max();
+    for(unsigned int k=0;k<nsections*nch;k++){
+        const mha_real_t av1 = std::fabs(z1.buf[k]);
+        z1.buf[k] = ((av1 >= fmin) & (av1 <= fmax)) ? z1.buf[k] : 0.0f;
+        const mha_real_t av2 = std::fabs(z2.buf[k]);
+        z2.buf[k] = ((av2 >= fmin) & (av2 <= fmax)) ? z2.buf[k] : 0.0f;
+    }
+}
+
+mha_real_t MHAFilter::sos_filter_t::filter(mha_real_t x,unsigned int ch)
+{
+    if( ch >= channels )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "The filter channel is out of range (got %u, %u channels).",
+                        ch,channels);
+    for(unsigned int s=0;s<nsections;s++){
+        const mha_real_t o = b0[s] * x + z1(s,ch);
+        z1(s,ch) = b1[s] * x - a1[s] * o + z2(s,ch);
+        z2(s,ch) = b2[s] * x - a2[s] * o;
+        make_friendly_number(z1(s,ch));
+        make_friendly_number(z2(s,ch));
+        x = o;
+    }
+    return x;
+}
+
+MHAFilter::iir_filter_state_t::iir_filter_state_t(unsigned int channels,std::vector<float> cf_A,std::vector<float> cf_B,bool use_sos)
     : MHAFilter::filter_t(channels,cf_A.size(),cf_B.size())
 {
     unsigned int k;
@@ -367,18 +719,40 @@ MHAFilter::iir_filter_state_t::iir_filter_state_t(unsigned int channels,std::vec
         A[k] = cf_A[k] / A0;
     for( k=0;k<cf_B.size();k++)
         B[k] = cf_B[k] / A0;
+    if( use_sos )
+        sos = std::make_unique<sos_filter_t>(channels,cf_A,cf_B);
+}
+
+void MHAFilter::iir_filter_state_t::filter(mha_wave_t* y,const mha_wave_t* x)
+{
+    if( sos )
+        sos->filter(y,x);
+    else
+        filter_t::filter(y,x);
+}
+
+mha_real_t MHAFilter::iir_filter_state_t::filter(mha_real_t x,unsigned int ch)
+{
+    if( sos )
+        return sos->filter(x,ch);
+    return filter_t::filter(x,ch);
 }
 
 MHAFilter::iir_filter_t::iir_filter_t(std::string help,std::string def_A,std::string def_B,unsigned int channels)
     : MHAParser::parser_t(help),
       A("recursive filter coefficients",def_A),
       B("non-recursive filter coefficients",def_B),
+      engine("Filter structure: direct form II (df2) or cascade of\n"
+             "second order sections in transposed direct form II (sos)",
+             "df2","[df2 sos]"),
       nchannels(channels)
 {
     insert_item("A",&A);
     insert_item("B",&B);
+    insert_item("engine",&engine);
     connector.connect(&A.writeaccess,this,&iir_filter_t::update_filter);
     connector.connect(&B.writeaccess,this,&iir_filter_t::update_filter);
+    connector.connect(&engine.writeaccess,this,&iir_filter_t::update_filter);
     update_filter();
 }
 
@@ -402,7 +776,8 @@ void MHAFilter::iir_filter_t::resize(unsigned int channels)
 
 void MHAFilter::iir_filter_t::update_filter()
 {
-    push_config(new iir_filter_state_t(nchannels,A.data,B.data));
+    push_config(new iir_filter_state_t(nchannels,A.data,B.data,
+                                       engine.data.get_index() == 1));
 }
 
 
@@ -633,6 +1008,45 @@ void MHAFilter::o1_ar_filter_t::set_tau_release(unsigned int ch,mha_real_t tau)
     MHAFilter::o1_lp_coeffs(tau,fs,c1_r[ch],c2_r[ch]);
 }
 
+void MHAFilter::o1_ar_filter_t::process_frame(const mha_real_t* x,mha_real_t* y)
+{
+    const mha_real_t fmin = std::numeric_limits<mha_real_t>::min();
+    const mha_real_t fmax = std::numeric_limits<mha_real_t>::max();
+    mha_real_t* __restrict state = buf;
+    const mha_real_t* __restrict a1 = c1_a.buf;
+    const mha_real_t* __restrict a2 = c2_a.buf;
+    const mha_real_t* __restrict r1 = c1_r.buf;
+    const mha_real_t* __restrict r2 = c2_r.buf;
+    const unsigned int n = num_channels;
+    for(unsigned int ch=0;ch<n;ch++){
+        const mha_real_t xv = x[ch];
+        const mha_real_t sv = state[ch];
+        // load both coefficient sets unconditionally, then select
+        const mha_real_t ca1 = a1[ch], ca2 = a2[ch];
+        const mha_real_t cr1 = r1[ch], cr2 = r2[ch];
+        const mha_real_t c1 = (xv >= sv) ? ca1 : cr1;
+        const mha_real_t c2 = (xv >= sv) ? ca2 : cr2;
+        state[ch] = c1 * sv + c2 * xv;
+    }
+    // Branch-free equivalent of make_friendly_number, kept in a
+    // separate loop so that both loops are vectorizable.
+    for(unsigned int ch=0;ch<n;ch++){
+        const mha_real_t av = std::fabs(state[ch]);
+        y[ch] = state[ch] =
+            ((av >= fmin) & (av <= fmax)) ? state[ch] : 0.0f;
+    }
+}
+
+void MHAFilter::o1_ar_filter_t::process(const mha_wave_t& in,mha_wave_t& out)
+{
+    MHA_assert_equal(in.num_channels,num_channels);
+    MHA_assert_equal(in.num_channels,out.num_channels);
+    MHA_assert_equal(in.num_frames,out.num_frames);
+    for(unsigned int k=0;k<in.num_frames;k++)
+        process_frame(in.buf + k*num_channels,
+                      out.buf + k*num_channels);
+}
+
 MHASignal::waveform_t* MHAFilter::spec2fir(const mha_spec_t* spec,const unsigned int fftlen,const MHAWindow::base_t& window,const bool minphase)
 {
     CHECK_VAR(spec);
@@ -1084,6 +1498,11 @@ MHAFilter::polyphase_resampling_t::polyphase_resampling_t
       downsampling_factor(n_down),
       now_index(n_up * n_prefill-1), underflow(false),
       impulse_response(n_irs),
+      bank_length(((n_irs + n_up - 1) / n_up + tap_block - 1)
+                  / tap_block * tap_block),
+      phase_taps(n_up),
+      history(size_t(n_channels) * (bank_length + n_ringbuffer), 0.0f),
+      history_stride(bank_length + n_ringbuffer),
       ringbuffer(n_ringbuffer, n_channels, n_prefill)
 {
     // The remaining code in constructor computes the coefficients of the 
@@ -1105,6 +1524,33 @@ MHAFilter::polyphase_resampling_t::polyphase_resampling_t
         // normalize filter output. Account for the fact that only
         // one in n_up samples is present at the interpolation rate.
         impulse_response.value(k,0) *= n_up / sum;
+
+    // Rearrange the impulse response into one bank per phase, so that
+    // each output sample is a dot product of contiguous coefficients
+    // with contiguous input samples.
+    for (unsigned phase = 0; phase < n_up; ++phase)
+        phase_taps[phase] = phase < n_irs ? (n_irs - phase - 1) / n_up + 1 : 0;
+    coefficient_banks.resize(size_t(n_up) * bank_length, 0.0f);
+    for (unsigned phase = 0; phase < n_up; ++phase)
+        for (unsigned tap = 0; tap < phase_taps[phase]; ++tap)
+            coefficient_banks[size_t(phase) * bank_length + bank_length - 1
+                              - tap] =
+                impulse_response.value(phase + tap * n_up, 0);
+}
+
+/** Dot product of n coefficients with n samples, n a multiple of 8.
+ * Uses two four-lane accumulators, which compilers map to SIMD registers. */
+static inline mha_real_t polyphase_dot(const mha_real_t * coefficients,
+                                       const mha_real_t * samples,
+                                       unsigned n)
+{
+    using namespace MHASimd;
+    v4_t acc0 = broadcast(0.0f), acc1 = acc0;
+    for (unsigned k = 0; k < n; k += 8) {
+        acc0 += load(coefficients + k) * load(samples + k);
+        acc1 += load(coefficients + k + 4) * load(samples + k + 4);
+    }
+    return sum(acc0 + acc1);
 }
 void MHAFilter::polyphase_resampling_t::write(mha_wave_t & signal) {
     if (underflow)
@@ -1120,59 +1566,75 @@ void MHAFilter::polyphase_resampling_t::read(mha_wave_t & signal) {
                         "MHAFilter::polyphase_resampling_t::write: This"
                         " polyphase resampling instance has experienced an"
                         " underflow and may not be used anymore.");
+    if (signal.num_frames == 0U)
+        return;
+
+    // Input frames up to the newest one needed for the last output frame.
+    const unsigned contained_frames = ringbuffer.contained_frames();
+    const unsigned needed_frames =
+        std::min((now_index + (signal.num_frames - 1U) * downsampling_factor)
+                 / upsampling_factor + 1U, contained_frames);
+    if (signal.num_channels > history.size() / history_stride)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::polyphase_resampling_t::read: %u"
+                        " channels requested, only %u present",
+                        signal.num_channels,
+                        unsigned(history.size() / history_stride));
+
+    // Copy the input frames needed for this block into one contiguous
+    // row per channel, after bank_length leading zeros.
+    for (unsigned channel = 0; channel < signal.num_channels; ++channel) {
+        mha_real_t * row = &history[size_t(channel) * history_stride
+                                    + bank_length];
+        for (unsigned frame = 0; frame < needed_frames; ++frame)
+            row[frame] = ringbuffer.value(frame, channel);
+    }
 
-    assign(signal, 0.0f);
-
-    unsigned input_index = unsigned(-1); // initializer needed if loop is empty
-
-    for   (unsigned output_index = 0;
-           output_index < signal.num_frames;
-           ++output_index, now_index += downsampling_factor) {
+    unsigned input_index = 0U, phase = 0U;
+    for (unsigned output_index = 0;
+         output_index < signal.num_frames;
+         ++output_index, now_index += downsampling_factor) {
 
         // latest interpolated signal index at which input signal is != 0
         // is at (now_index / upsampling_factor) * upsampling_factor
         input_index = now_index / upsampling_factor;
 
-
-        // The corresponding index into the impulse response is
-        // now_index - ((now_index / upsampling_factor) * upsampling_factor)
-        unsigned convolution_index = now_index - input_index*upsampling_factor;
-        for (;
-             convolution_index < impulse_response.num_frames;
-             --input_index, convolution_index += upsampling_factor) {
-            if (input_index == (unsigned)(-1)) {
-                underflow = true;
-                throw MHA_Error(__FILE__,__LINE__,
-                                "MHAFilter::polyphase_resampling_t::read: Not"
-                                " enough input data: underflow detected when"
-                                " producing output for"
-                                " frame=%u convolution_index=%u",
-                                output_index, convolution_index);
-            }
-            for (unsigned channel = 0; channel < signal.num_channels; ++channel)
-            {
-                float & input = ringbuffer.value(input_index, channel);
-                float & filter_tap =
-                    impulse_response.value(convolution_index, 0);
-                float & accumulator = value(signal,output_index,channel);
-                accumulator += input * filter_tap;
-            }
-        
-          // input_index now contains one lower than the lowest ringbuffer index
-          // in the input signal that was needed to produce this output frame.
+        // The corresponding index into the impulse response
+        phase = now_index - input_index * upsampling_factor;
+        if (input_index >= contained_frames)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "MHAFilter::polyphase_resampling_t::read: Not"
+                            " enough input data: input frame %u needed for"
+                            " output frame %u, only %u present",
+                            input_index, output_index, contained_frames);
+        if (input_index + 1U < phase_taps[phase]) {
+            underflow = true;
+            throw MHA_Error(__FILE__,__LINE__,
+                            "MHAFilter::polyphase_resampling_t::read: Not"
+                            " enough input data: underflow detected when"
+                            " producing output for"
+                            " frame=%u convolution_index=%u",
+                            output_index,
+                            phase + (input_index + 1U) * upsampling_factor);
         }
+        const mha_real_t * bank =
+            &coefficient_banks[size_t(phase) * bank_length];
+        for (unsigned channel = 0; channel < signal.num_channels; ++channel)
+            value(signal, output_index, channel) =
+                polyphase_dot(bank,
+                              &history[size_t(channel) * history_stride
+                                       + input_index + 1U],
+                              bank_length);
     }
-    // input_index  now contains one lower than the lowest ringbuffer index
-    // in the input signal that was needed to produce the last output frame.
-    // it may be unsigned(-1), in which case we do not discard anything.
-    // To produce the next sample, we may need the input sample at input_index
+    // Oldest input frame needed to produce the last output frame.  To
+    // produce the next sample, we may need the input sample before it,
     // since the slice of the impulse response may be one tap longer and
-    // the input signal index may not have advanced. (It may be possible that it
-    // can be proven that this cannot happen, but I do not have time to
-    // investigate. Therefore, better safe than sorry.)
-    if (input_index != unsigned(-1)) {
-        ringbuffer.discard(input_index);
-        now_index -= (input_index) * upsampling_factor;
+    // the input signal index may not have advanced.  Discard everything
+    // older.
+    const unsigned discardable = input_index + 1U - phase_taps[phase];
+    if (discardable > 0U) {
+        ringbuffer.discard(discardable - 1U);
+        now_index -= (discardable - 1U) * upsampling_factor;
     }
 }
 MHAFilter::blockprocessing_polyphase_resampling_t::
@@ -1295,6 +1757,284 @@ read(mha_wave_t & signal) {
 }   
             
 
+MHAFilter::adaptive_resampling_t::
+adaptive_resampling_t(double ratio_, unsigned n_channels_,
+                      unsigned capacity, unsigned half_length_,
+                      unsigned n_phases_, mha_real_t nyquist_ratio)
+    : n_channels(n_channels_),
+      half_length((std::max(half_length_, 1U) + 3U) / 4U * 4U),
+      n_phases(n_phases_),
+      history_stride(capacity + half_length),
+      contained_frames(half_length - 1U),
+      base_index(half_length - 1U),
+      fraction(0.0),
+      ratio(ratio_),
+      target_ratio(ratio_)
+{
+    if (!(ratio > 0.0) || n_channels == 0U || n_phases == 0U ||
+        capacity <= half_length || !(nyquist_ratio > 0.0f) ||
+        nyquist_ratio > 1.0f)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t: invalid"
+                        " parameters ratio=%g channels=%u capacity=%u"
+                        " phases=%u nyquist_ratio=%g",
+                        ratio, n_channels, capacity, n_phases,
+                        nyquist_ratio);
+    history.assign(size_t(n_channels) * history_stride, 0.0f);
+
+    // Windowed sinc with the cutoff below the nyquist frequency of the
+    // smaller sampling rate, in units of the input sampling rate.
+    const double cutoff = nyquist_ratio * std::min(1.0, 1.0 / ratio);
+    const unsigned taps = 2U * half_length;
+    banks.resize(size_t(n_phases + 1U) * taps);
+    for (unsigned phase = 0; phase <= n_phases; ++phase) {
+        mha_real_t * bank = &banks[size_t(phase) * taps];
+        double sum = 0;
+        for (unsigned tap = 0; tap < taps; ++tap) {
+            // distance of the interpolation position from this input frame
+            double t = double(phase) / n_phases + half_length - 1.0 - tap;
+            double window = 0.5 + 0.5 * cos(M_PI * t / half_length);
+            sum += bank[tap] = window * cutoff * sinc(M_PI * cutoff * t);
+        }
+        // unit gain at DC for every phase
+        for (unsigned tap = 0; tap < taps; ++tap)
+            bank[tap] /= sum;
+    }
+}
+
+void MHAFilter::adaptive_resampling_t::set_ratio(double new_ratio)
+{
+    if (!(new_ratio > 0.0))
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t::set_ratio:"
+                        " ratio %g is not positive", new_ratio);
+    target_ratio = new_ratio;
+}
+
+void MHAFilter::adaptive_resampling_t::write(const mha_wave_t & signal)
+{
+    if (signal.num_channels != n_channels)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t::write: signal"
+                        " has %u channels, expected %u",
+                        signal.num_channels, n_channels);
+    write(signal.buf, signal.num_frames);
+}
+
+void MHAFilter::adaptive_resampling_t::write(const mha_real_t * samples,
+                                             unsigned frames)
+{
+    if (frames > available_space())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t::write: %u frames"
+                        " exceed available space of %u frames",
+                        frames, available_space());
+    for (unsigned channel = 0; channel < n_channels; ++channel) {
+        mha_real_t * row =
+            &history[size_t(channel) * history_stride + contained_frames];
+        for (unsigned frame = 0; frame < frames; ++frame)
+            row[frame] = samples[frame * n_channels + channel];
+    }
+    contained_frames += frames;
+}
+
+unsigned
+MHAFilter::adaptive_resampling_t::last_base_index(unsigned frames) const
+{
+    unsigned base = base_index;
+    double position = fraction;
+    for (unsigned m = 0; m + 1U < frames; ++m) {
+        position += ramped_ratio(m, frames);
+        const double step = floor(position);
+        base += unsigned(step);
+        position -= step;
+    }
+    return base;
+}
+
+unsigned
+MHAFilter::adaptive_resampling_t::frames_needed(unsigned out_frames) const
+{
+    if (out_frames == 0U)
+        return 0U;
+    const unsigned required = last_base_index(out_frames) + half_length + 1U;
+    return required > contained_frames ? required - contained_frames : 0U;
+}
+
+/** Two dot products of the same samples with adjacent kernel phases, n a
+ * multiple of 8. */
+static inline void adaptive_dot2(const mha_real_t * bank0,
+                                 const mha_real_t * bank1,
+                                 const mha_real_t * samples,
+                                 unsigned n,
+                                 mha_real_t & result0, mha_real_t & result1)
+{
+    using namespace MHASimd;
+    v4_t acc0 = broadcast(0.0f), acc1 = acc0;
+    for (unsigned k = 0; k < n; k += 4) {
+        const v4_t x = load(samples + k);
+        acc0 += load(bank0 + k) * x;
+        acc1 += load(bank1 + k) * x;
+    }
+    result0 = sum(acc0);
+    result1 = sum(acc1);
+}
+
+void MHAFilter::adaptive_resampling_t::read(mha_wave_t & signal)
+{
+    if (signal.num_channels != n_channels)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t::read: signal"
+                        " has %u channels, expected %u",
+                        signal.num_channels, n_channels);
+    if (signal.num_frames == 0U)
+        return;
+    const unsigned missing = frames_needed(signal.num_frames);
+    if (missing > 0U)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::adaptive_resampling_t::read: %u more"
+                        " input frames needed to produce %u frames",
+                        missing, signal.num_frames);
+    const unsigned taps = 2U * half_length;
+    for (unsigned m = 0; m < signal.num_frames; ++m) {
+        const double phase_position = fraction * n_phases;
+        const unsigned phase = std::min(unsigned(phase_position),
+                                        n_phases - 1U);
+        const mha_real_t weight = mha_real_t(phase_position - phase);
+        const mha_real_t * bank0 = &banks[size_t(phase) * taps];
+        const mha_real_t * bank1 = bank0 + taps;
+        for (unsigned channel = 0; channel < n_channels; ++channel) {
+            mha_real_t y0, y1;
+            adaptive_dot2(bank0, bank1,
+                          &history[size_t(channel) * history_stride
+                                   + base_index + 1U - half_length],
+                          taps, y0, y1);
+            value(signal, m, channel) = y0 + weight * (y1 - y0);
+        }
+        fraction += ramped_ratio(m, signal.num_frames);
+        const double step = floor(fraction);
+        base_index += unsigned(step);
+        fraction -= step;
+    }
+    ratio = target_ratio;
+    // Keep the input frames needed by the next interpolation position.
+    const unsigned discard = base_index + 1U - half_length;
+    if (discard > 0U) {
+        for (unsigned channel = 0; channel < n_channels; ++channel) {
+            mha_real_t * row = &history[size_t(channel) * history_stride];
+            std::copy(row + discard, row + contained_frames, row);
+        }
+        contained_frames -= discard;
+        base_index -= discard;
+    }
+}
+
+MHAFilter::drift_compensating_fifo_t::
+drift_compensating_fifo_t(unsigned n_channels_, mha_real_t srate_,
+                          unsigned desired_fill_count_,
+                          unsigned max_fill_count,
+                          mha_real_t adaptation_time,
+                          double max_deviation_,
+                          double nominal_ratio_)
+    : n_channels(n_channels_),
+      srate(srate_),
+      desired_fill_count(desired_fill_count_),
+      nominal_ratio(nominal_ratio_),
+      max_deviation(max_deviation_),
+      // The fill count changes by srate * nominal_ratio * (drift -
+      // deviation) frames per second.  This gain makes the proportional
+      // part alone settle with time constant adaptation_time.
+      gain(1.0 / (srate_ * nominal_ratio_ * adaptation_time)),
+      // critically damped together with the proportional part
+      integral_time(4.0 * adaptation_time),
+      smoothing_time(0.25 * adaptation_time),
+      fifo(std::max(max_fill_count, 1U) * std::max(n_channels_, 1U)),
+      resampler(nominal_ratio_, std::max(n_channels_, 1U),
+                max_fill_count + 64U),
+      transfer_buffer(size_t(256U) * std::max(n_channels_, 1U)),
+      smoothed_fill(0.0),
+      integral(0.0),
+      deviation(0.0),
+      started(false),
+      writer_xruns(0U),
+      reader_xruns(0U)
+{
+    if (n_channels == 0U || !(srate > 0.0f) || !(adaptation_time > 0.0f) ||
+        !(max_deviation >= 0.0) || !(nominal_ratio > 0.0) ||
+        desired_fill_count_ == 0U || desired_fill_count_ >= max_fill_count)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::drift_compensating_fifo_t: invalid"
+                        " parameters channels=%u srate=%g desired=%u max=%u"
+                        " adaptation_time=%g max_deviation=%g"
+                        " nominal_ratio=%g",
+                        n_channels, srate, desired_fill_count_,
+                        max_fill_count, adaptation_time, max_deviation,
+                        nominal_ratio);
+}
+
+void MHAFilter::drift_compensating_fifo_t::write(const mha_wave_t & signal)
+{
+    if (signal.num_channels != n_channels)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::drift_compensating_fifo_t::write: signal"
+                        " has %u channels, expected %u",
+                        signal.num_channels, n_channels);
+    const unsigned samples = signal.num_frames * n_channels;
+    if (samples > fifo.get_available_space())
+        ++writer_xruns;
+    else
+        fifo.write(signal.buf, samples);
+}
+
+void MHAFilter::drift_compensating_fifo_t::transfer(unsigned frames)
+{
+    const unsigned chunk = transfer_buffer.size() / n_channels;
+    frames = std::min(frames, resampler.available_space());
+    while (frames > 0U) {
+        const unsigned n = std::min(frames, chunk);
+        fifo.read(transfer_buffer.data(), n * n_channels);
+        resampler.write(transfer_buffer.data(), n);
+        frames -= n;
+    }
+}
+
+void MHAFilter::drift_compensating_fifo_t::read(mha_wave_t & signal)
+{
+    if (signal.num_channels != n_channels)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "MHAFilter::drift_compensating_fifo_t::read: signal"
+                        " has %u channels, expected %u",
+                        signal.num_channels, n_channels);
+    const unsigned fifo_frames = fifo.get_fill_count() / n_channels;
+    const double fill = fifo_frames + resampler.buffered_frames();
+    if (!started) {
+        if (fill < desired_fill_count) {
+            assign(signal, 0.0f);
+            return;
+        }
+        started = true;
+        smoothed_fill = fill;
+    }
+    const double dt = signal.num_frames / srate;
+    smoothed_fill += (fill - smoothed_fill) * (1.0 - exp(-dt / smoothing_time));
+    const double error = gain * (smoothed_fill - desired_fill_count);
+    integral = std::clamp(integral + error * dt / integral_time,
+                          -max_deviation, max_deviation);
+    deviation = std::clamp(error + integral, -max_deviation, max_deviation);
+    resampler.set_ratio(nominal_ratio * (1.0 + deviation));
+
+    transfer(std::min(resampler.frames_needed(signal.num_frames),
+                      fifo_frames));
+    if (!resampler.can_read(signal.num_frames)) {
+        // underrun: deliver silence until the fill count has recovered
+        assign(signal, 0.0f);
+        ++reader_xruns;
+        started = false;
+        return;
+    }
+    resampler.read(signal);
+}
+
 MHAFilter::iir_ord1_real_t::iir_ord1_real_t(std::vector<mha_real_t> A,std::vector<mha_real_t> B)
     : A_(A),B_(B),Yn(std::vector<mha_complex_t>(A.size(),mha_complex(0.0,0.0)))
 {
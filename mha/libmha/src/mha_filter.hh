@@ -2,6 +2,7 @@
 // Copyright © 2003 2004 2005 2006 2007 2008 2009 2010 HörTech gGmbH
 // Copyright © 2011 2012 2013 2014 2016 2017 2018 2019 HörTech gGmbH
 // Copyright © 2020
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -21,8 +22,11 @@
 #include "mha_toolbox.h"
 #include "mha_plugin.hh"
 #include "mha_windowparser.h"
+#include "mha_fifo.h"
 #include <valarray>
 #include <type_traits>
+#include <memory>
+#include <atomic>
 /**
     \ingroup mhatoolbox
     \file mha_filter.hh
@@ -217,12 +221,38 @@ namespace MHAFilter {
             The number of channels must match the number of filter bands.
         */
         inline void operator()(const mha_wave_t& in,mha_wave_t& out){
-            MHA_assert_equal(in.num_channels,num_channels);
-            MHA_assert_equal(in.num_channels,out.num_channels);
-            MHA_assert_equal(in.num_frames,out.num_frames);
-            for(unsigned int k=0;k<in.num_frames;k++)
-                for(unsigned int ch=0;ch<in.num_channels;ch++)
-                    ::value(out,k,ch) = operator()(ch,::value(in,k,ch));
+            process(in,out);
+        };
+        /**
+           \brief Apply filter to one frame of all channels simultaneously.
+
+           Filter states and coefficients are stored as one contiguous
+           array per quantity (structure of arrays).  The loop over
+           channels contains neither range checks nor branches, which
+           allows the compiler to process several channels in the lanes
+           of one SIMD register.
+           \param x Input values, one for each channel.
+           \param y Output values, one for each channel.  May be
+                    identical to x for in-place processing.
+        */
+        void process_frame(const mha_real_t* x,mha_real_t* y);
+        /**
+           \brief Apply filter to all channels of a block of signal.
+
+           The block is processed frame by frame, with all channels
+           of each frame updated together, see process_frame().
+           \param in Input signal
+           \param out Output signal, may be the same object as in.
+
+           The number of channels must match the number of filter bands.
+        */
+        void process(const mha_wave_t& in,mha_wave_t& out);
+        /**
+           \brief Apply filter in place to all channels of a block of signal.
+           \param s Input and output signal
+        */
+        inline void process(mha_wave_t& s){
+            process(s,s);
         };
     protected:
         MHASignal::waveform_t c1_a;
@@ -263,9 +293,93 @@ namespace MHAFilter {
         void set_tau(mha_real_t tau);//!< set time constant in all channels to tau
     };
 
+    /**
+       \brief Factorize a transfer function into second order sections.
+
+       The recursive and non-recursive polynomials (in powers of
+       \f$z^{-1}\f$) are factorized into real first and second order
+       factors.  Each pole pair is combined with the closest zero pair.
+       Sections are ordered by increasing pole radius, the overall
+       gain is applied to the first section.
+
+       \param A Recursive filter coefficients, A[0] must not be zero.
+       \param B Non-recursive filter coefficients.
+       \return One row per section, each row containing the six
+               coefficients [b0 b1 b2 a0 a1 a2] with a0=1, as in the
+               second-order-sections matrix of \Matlab{}.
+    */
+    std::vector<std::vector<mha_real_t> >
+    tf2sos(const std::vector<mha_real_t>& A,const std::vector<mha_real_t>& B);
+
+    /**
+       \brief Cascade of second order IIR sections (biquads).
+
+       Each section is realized in transposed direct form II, which is
+       numerically much more robust than a single high order direct
+       form filter.  All channels are filtered with the same
+       coefficients.  Filter states are stored per section as one
+       contiguous array over channels, and the innermost loop runs over
+       channels, so that several channels are processed in the lanes
+       of one SIMD register.
+    */
+    class sos_filter_t {
+    public:
+        /**
+           \brief Constructor from second order sections.
+           \param channels Number of independent audio channels
+           \param sos One row per section with coefficients
+                      [b0 b1 b2 a0 a1 a2], see tf2sos().
+        */
+        sos_filter_t(unsigned int channels,
+                     const std::vector<std::vector<mha_real_t> >& sos);
+        /**
+           \brief Constructor from transfer function coefficients.
+           \param channels Number of independent audio channels
+           \param A Recursive filter coefficients
+           \param B Non-recursive filter coefficients
+        */
+        sos_filter_t(unsigned int channels,
+                     const std::vector<mha_real_t>& A,
+                     const std::vector<mha_real_t>& B);
+        /** \brief Filter all channels in a waveform structure.
+            \param y Output signal, may be identical to x.
+            \param x Input signal
+        */
+        void filter(mha_wave_t* y,const mha_wave_t* x);
+        /**
+           \brief Filter one sample
+           \param x Input value
+           \param ch Channel number to use in filter state
+        */
+        mha_real_t filter(mha_real_t x,unsigned int ch);
+        /** \brief Return number of second order sections */
+        unsigned int get_num_sections() const {return nsections;};
+    private:
+        unsigned int channels;
+        unsigned int nsections;
+        std::vector<mha_real_t> b0, b1, b2, a1, a2;
+        /** First state variable, one row (frame) per section. */
+        MHASignal::waveform_t z1;
+        /** Second state variable, one row (frame) per section. */
+        MHASignal::waveform_t z2;
+    };
+
     class iir_filter_state_t : public filter_t {
     public:
-        iir_filter_state_t(unsigned int channels,std::vector<float> cf_A,std::vector<float> cf_B);
+        /**
+           \param channels Number of independent audio channels
+           \param cf_A Recursive filter coefficients
+           \param cf_B Non-recursive filter coefficients
+           \param use_sos If true, signals are filtered by a cascade of
+                          second order sections computed from cf_A and
+                          cf_B instead of the direct form II filter.
+        */
+        iir_filter_state_t(unsigned int channels,std::vector<float> cf_A,std::vector<float> cf_B,bool use_sos = false);
+        using filter_t::filter;
+        void filter(mha_wave_t* y,const mha_wave_t* x);
+        mha_real_t filter(mha_real_t x,unsigned int ch);
+    private:
+        std::unique_ptr<sos_filter_t> sos;
     };
 
     /** \brief IIR filter class wrapper for integration into parser structure.
@@ -284,6 +398,12 @@ namespace MHAFilter {
         Simply add this subparser to your parser
         items and use the "filter" member function.
         Filter states are reset to all 0 on update.
+
+        The configuration variable "engine" selects the filter
+        structure: "df2" uses a single direct form II filter of the
+        full order, "sos" factorizes the coefficients into a cascade of
+        second order sections (see sos_filter_t), which is recommended
+        for filters of higher order.
     */
     class iir_filter_t : public MHAParser::parser_t, private MHAPlugin::config_t<iir_filter_state_t>
     {
@@ -338,6 +458,7 @@ namespace MHAFilter {
         void update_filter();
         MHAParser::vfloat_t A;
         MHAParser::vfloat_t B;
+        MHAParser::kw_t engine;
         MHAEvents::patchbay_t<iir_filter_t> connector;
         unsigned int nchannels;
     };
@@ -966,12 +1087,41 @@ namespace MHAFilter {
          * future).  And the samples inside an MHAWindow::hanning_t
          * can be altered with *=, which our constructor does. */
         MHAWindow::hanning_t impulse_response;
-        
+
+        /** Number of filter taps per phase, rounded up to a multiple of
+         * #tap_block.  Equals the length of each coefficient bank. */
+        unsigned bank_length;
+
+        /** Number of non-zero filter taps for each phase.  The phase of
+         * an output sample is its index at the interpolation rate
+         * modulo the upsampling factor. */
+        std::vector<unsigned> phase_taps;
+
+        /** Impulse response rearranged into one contiguous coefficient
+         * bank per phase.  Bank p starts at p * #bank_length and contains
+         * the taps impulse_response[p + j * upsampling_factor] in reverse
+         * order, preceded by zeros, so that it can be applied to
+         * #bank_length consecutive input samples ending with the newest
+         * one. */
+        std::vector<mha_real_t> coefficient_banks;
+
+        /** Copy of the input signal needed by one #read, one contiguous
+         * row per channel.  Each row starts with #bank_length zeros so
+         * that the zero padding of the banks never reads outside. */
+        std::vector<mha_real_t> history;
+
+        /** Distance between channel rows in #history. */
+        unsigned history_stride;
+
         /** Storage of input signal.  Part of the polyphase resampling
          * optimization is that apart from the FIR impulse response,
          * nothing is stored at the interpolation rate, saving memory
          * and computation cycles. */
         MHASignal::ringbuffer_t ringbuffer;
+
+        /** Taps are processed in blocks of this size by the dot product
+         * kernel. */
+        static constexpr unsigned tap_block = 8U;
     public:
         /** Construct a polyphase resampler instance.
 
@@ -1120,6 +1270,210 @@ namespace MHAFilter {
             
     };
 
+    /**
+     * Resampler with an arbitrary, time-varying ratio.
+     *
+     * Each output sample is interpolated at a fractional position of
+     * the input signal with a windowed sinc kernel.  The kernel is
+     * tabulated for a number of equally spaced fractional phases, and
+     * the result for the actual phase is interpolated linearly between
+     * the two neighbouring tabulated phases.  In contrast to
+     * polyphase_resampling_t, the ratio does not need to be rational and
+     * can be changed between reads, e.g. for clock drift compensation.
+     * Ratio changes are ramped linearly over the next read block.
+     *
+     * The resampler delays the signal by half_length input frames.
+     */
+    class adaptive_resampling_t {
+    public:
+        /** Construct an adaptive resampler.
+         * @param ratio Initial ratio, input frames consumed per output
+         *              frame, i.e. source rate divided by target rate.
+         * @param n_channels Number of audio channels.
+         * @param capacity Maximum number of input frames that can be
+         *                 buffered.
+         * @param half_length Number of kernel taps on each side of the
+         *                    interpolation position, rounded up to a
+         *                    multiple of 4.
+         * @param n_phases Number of tabulated fractional phases.
+         * @param nyquist_ratio Low pass filter cutoff frequency relative
+         *                      to the nyquist frequency of the smaller of
+         *                      the two sampling rates at the initial
+         *                      ratio.
+         * @throw MHA_Error if a parameter is out of range. */
+        adaptive_resampling_t(double ratio, unsigned n_channels,
+                              unsigned capacity,
+                              unsigned half_length = 16U,
+                              unsigned n_phases = 256U,
+                              mha_real_t nyquist_ratio = 0.9f);
+
+        /** Set the ratio reached at the end of the next #read.
+         * @param ratio Input frames consumed per output frame.
+         * @throw MHA_Error if ratio is not positive. */
+        void set_ratio(double ratio);
+
+        /** The ratio reached at the end of the next #read. */
+        double get_ratio() const {return target_ratio;}
+
+        /** Append a block of input signal.
+         * @throw MHA_Error if there is not enough space or the number of
+         *        channels does not match. */
+        void write(const mha_wave_t & signal);
+
+        /** Append frames of interleaved input signal.
+         * @param samples frames * number of channels samples.
+         * @param frames Number of frames.
+         * @throw MHA_Error if there is not enough space. */
+        void write(const mha_real_t * samples, unsigned frames);
+
+        /** Produce resampled output.  All channels of signal are filled.
+         * @throw MHA_Error if more frames are requested than
+         *        #readable_frames or the number of channels does not
+         *        match.  Nothing is consumed in that case. */
+        void read(mha_wave_t & signal);
+
+        /** Check if enough input is buffered to read out_frames frames. */
+        bool can_read(unsigned out_frames) const {
+            return frames_needed(out_frames) == 0U;
+        }
+
+        /** Number of input frames that have to be written before the
+         * next #read can produce out_frames output frames. */
+        unsigned frames_needed(unsigned out_frames) const;
+
+        /** Input frames not yet consumed, counted from the current
+         * interpolation position.  Includes the fractional part. */
+        double buffered_frames() const {
+            return contained_frames - base_index - fraction;
+        }
+
+        /** Free space for input frames. */
+        unsigned available_space() const {
+            return history_stride - contained_frames;
+        }
+    private:
+        /** Ratio used to advance from output frame m of a read of
+         * frames frames. */
+        double ramped_ratio(unsigned m, unsigned frames) const {
+            return ratio + (target_ratio - ratio) * (m + 1.0) / frames;
+        }
+        /** Integer part of the interpolation position of the last frame
+         * of a read of frames > 0 frames. */
+        unsigned last_base_index(unsigned frames) const;
+        unsigned n_channels;
+        /** Kernel taps on each side of the interpolation position. */
+        unsigned half_length;
+        /** Number of tabulated phases.  n_phases + 1 banks are stored. */
+        unsigned n_phases;
+        /** Kernels for fractional phases 0, 1/n_phases, ..., 1.  Bank p
+         * holds 2 * half_length taps for the input frames
+         * base_index - half_length + 1 ... base_index + half_length. */
+        std::vector<mha_real_t> banks;
+        /** Input signal, one contiguous row of history_stride frames per
+         * channel. */
+        std::vector<mha_real_t> history;
+        unsigned history_stride;
+        /** Number of valid frames in each row of #history. */
+        unsigned contained_frames;
+        /** Integer part of the current interpolation position. */
+        unsigned base_index;
+        /** Fractional part of the current interpolation position. */
+        double fraction;
+        /** Ratio used for the first frame of the next read. */
+        double ratio;
+        /** Ratio reached at the end of the next read. */
+        double target_ratio;
+    };
+
+    /**
+     * FIFO between two audio threads with independent clocks that
+     * compensates the clock drift by resampling instead of dropping or
+     * inserting samples.
+     *
+     * The writer thread calls #write with blocks at its own rate.  The
+     * reader thread calls #read, which controls the resampling ratio
+     * with a PI controller so that the number of buffered frames
+     * converges to the desired fill count.  Like mha_drifter_fifo_t,
+     * the reader receives silence until the desired fill count has been
+     * reached for the first time and after each underrun.  The
+     * transfer through the FIFO is lock-free; one writer thread and one
+     * reader thread are supported.
+     */
+    class drift_compensating_fifo_t {
+    public:
+        /** Construct a drift compensating FIFO.
+         * @param n_channels Number of audio channels.
+         * @param srate Sampling rate of the reader / Hz, used for the
+         *              controller time constant.
+         * @param desired_fill_count Number of frames to keep buffered.
+         *              This is the delay of the FIFO.
+         * @param max_fill_count Capacity in frames.
+         * @param adaptation_time Time constant / s of the fill level
+         *              control.  Longer times make ratio changes smaller
+         *              and slower.
+         * @param max_deviation Maximum relative deviation of the ratio
+         *              from nominal_ratio, e.g. 1e-3 for 1000 ppm.
+         * @param nominal_ratio Writer sampling rate divided by reader
+         *              sampling rate.
+         * @throw MHA_Error if a parameter is out of range. */
+        drift_compensating_fifo_t(unsigned n_channels, mha_real_t srate,
+                                  unsigned desired_fill_count,
+                                  unsigned max_fill_count,
+                                  mha_real_t adaptation_time = 2.0f,
+                                  double max_deviation = 1e-3,
+                                  double nominal_ratio = 1.0);
+
+        /** Writer thread: append a block.  If there is not enough space,
+         * the block is dropped and the writer xrun counter is
+         * incremented.
+         * @throw MHA_Error if the number of channels does not match. */
+        void write(const mha_wave_t & signal);
+
+        /** Reader thread: produce a block of resampled signal.
+         * @throw MHA_Error if the number of channels does not match. */
+        void read(mha_wave_t & signal);
+
+        /** Current ratio relative to nominal_ratio, minus one.  After
+         * settling, this is the relative clock deviation of the writer
+         * compared to the reader. */
+        double get_deviation() const {return deviation;}
+
+        /** Smoothed number of buffered frames, as seen by the reader. */
+        double get_fill_count() const {return smoothed_fill;}
+
+        /** Number of times the writer had to drop a block. */
+        unsigned get_writer_xruns() const {return writer_xruns;}
+
+        /** Number of times the reader did not find enough data. */
+        unsigned get_reader_xruns() const {return reader_xruns;}
+    private:
+        /** Move frames from the FIFO to the resampler. */
+        void transfer(unsigned frames);
+        unsigned n_channels;
+        mha_real_t srate;
+        double desired_fill_count;
+        double nominal_ratio;
+        double max_deviation;
+        /** Proportional gain of the fill level controller. */
+        double gain;
+        /** Time constant of the integral part / s. */
+        double integral_time;
+        /** Time constant of the fill level smoothing / s. */
+        double smoothing_time;
+        mha_fifo_lf_t<mha_real_t> fifo;
+        adaptive_resampling_t resampler;
+        /** Interleaved buffer for transfers from fifo to resampler. */
+        std::vector<mha_real_t> transfer_buffer;
+        double smoothed_fill;
+        double integral;
+        double deviation;
+        /** Reader delivers silence until the desired fill count is
+         * reached. */
+        bool started;
+        std::atomic<unsigned> writer_xruns;
+        unsigned reader_xruns;
+    };
+
     /**
        \brief First order recursive filter
      */
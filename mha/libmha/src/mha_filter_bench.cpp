@@ -0,0 +1,74 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost of the direct form II and the second order sections
+// engine of the IIR filter.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "mha_signal.hh"
+#include "mha_filter.hh"
+
+namespace {
+  // [B,A] = butter(4,0.2) in Matlab
+  const std::vector<mha_real_t> butter4_B =
+    {0.004824343357716f, 0.019297373430865f, 0.028946060146297f,
+     0.019297373430865f, 0.004824343357716f};
+  const std::vector<mha_real_t> butter4_A =
+    {1.0f, -2.369513007182038f, 2.313988414415880f,
+     -1.054665405878567f, 0.187379492368185f};
+
+  std::vector<mha_real_t> conv(const std::vector<mha_real_t>& a,
+                               const std::vector<mha_real_t>& b) {
+    std::vector<mha_real_t> c(a.size() + b.size() - 1, 0.0f);
+    for (unsigned i = 0; i < a.size(); ++i)
+      for (unsigned j = 0; j < b.size(); ++j)
+        c[i+j] += a[i] * b[j];
+    return c;
+  }
+}
+
+int main()
+{
+  const auto A = conv(butter4_A, butter4_A), B = conv(butter4_B, butter4_B);
+  const unsigned channels = 16, frames = 64, blocks = 20000;
+  MHAFilter::filter_t df2(channels, A, B);
+  MHAFilter::sos_filter_t sos(channels, A, B);
+  MHASignal::waveform_t x(frames, channels);
+  for (unsigned k = 0; k < x.num_frames * channels; ++k)
+    x.buf[k] = std::sin(0.01f * k);
+  MHASignal::waveform_t y(x);
+  auto measure = [&](auto && process) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      process();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+    return t.count() / blocks * 1e6;
+  };
+  const double t_df2 = measure([&]{df2.filter(&y, &x);});
+  const double t_sos = measure([&]{sos.filter(&y, &x);});
+  std::cout << "8th order, " << channels << " channels, " << frames
+            << " frames: df2 " << t_df2 << " us/block, sos " << t_sos
+            << " us/block (speedup " << t_df2 / t_sos << ")" << std::endl;
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
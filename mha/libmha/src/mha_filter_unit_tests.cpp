@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2019 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -154,3 +155,329 @@ TEST(o1flt_maxtrack_t, decay_many_samples) {
     maxtrack(0,0);
   ASSERT_NEAR(1/expf(1), maxtrack(0,0), 0.001);
 }
+
+TEST(o1_ar_filter_t, block_process_equals_sample_process) {
+  // Block processing of all channels at once must produce the same
+  // output and leave the same state as sample-by-sample processing
+  const std::vector<mha_real_t> tau_a = {0.001f, 0.0f, 0.01f, 0.002f, 0.5f};
+  const std::vector<mha_real_t> tau_r = {0.05f, 0.1f, 0.0f, 0.002f, 0.01f};
+  const unsigned channels = tau_a.size(), frames = 64;
+  MHAFilter::o1_ar_filter_t per_sample(channels, 16000, tau_a, tau_r);
+  MHAFilter::o1_ar_filter_t blocked(channels, 16000, tau_a, tau_r);
+  MHASignal::waveform_t in(frames, channels), out(frames, channels);
+  for (unsigned k = 0; k < frames; ++k)
+    for (unsigned ch = 0; ch < channels; ++ch)
+      in(k, ch) = std::sin(0.1f * k * (ch + 1)) + 0.1f * ch;
+  blocked.process(in, out);
+  for (unsigned k = 0; k < frames; ++k)
+    for (unsigned ch = 0; ch < channels; ++ch)
+      EXPECT_FLOAT_EQ(per_sample(ch, in(k, ch)), out(k, ch));
+  for (unsigned ch = 0; ch < channels; ++ch)
+    EXPECT_FLOAT_EQ(per_sample.buf[ch], blocked.buf[ch]);
+  // in-place processing continues from the same state
+  blocked.process(in);
+  for (unsigned k = 0; k < frames; ++k)
+    for (unsigned ch = 0; ch < channels; ++ch)
+      EXPECT_FLOAT_EQ(per_sample(ch, std::sin(0.1f * k * (ch + 1)) + 0.1f*ch),
+                      in(k, ch));
+}
+
+TEST(o1_ar_filter_t, block_process_flushes_unfriendly_numbers) {
+  MHAFilter::o1flt_lowpass_t lp({0.0f, 0.0f, 0.0f}, 1000, 0);
+  mha_real_t x[3] = {std::numeric_limits<mha_real_t>::denorm_min(),
+                     std::numeric_limits<mha_real_t>::infinity(),
+                     std::numeric_limits<mha_real_t>::quiet_NaN()};
+  mha_real_t y[3] = {1, 1, 1};
+  lp.process_frame(x, y);
+  for (unsigned ch = 0; ch < 3; ++ch) {
+    EXPECT_EQ(0.0f, y[ch]);
+    EXPECT_EQ(0.0f, lp.get_last_output(ch));
+  }
+}
+
+TEST(o1_ar_filter_t, block_process_checks_dimensions) {
+  MHAFilter::o1flt_maxtrack_t maxtrack({1.0f, 1.0f}, 48000, 0);
+  MHASignal::waveform_t in(10, 3), out(10, 2);
+  EXPECT_THROW(maxtrack.process(in, out), MHA_Error);
+  MHASignal::waveform_t in2(10, 2), out2(9, 2);
+  EXPECT_THROW(maxtrack.process(in2, out2), MHA_Error);
+}
+
+namespace {
+  // [B,A] = butter(4,0.2) in Matlab
+  const std::vector<mha_real_t> butter4_B =
+    {0.004824343357716f, 0.019297373430865f, 0.028946060146297f,
+     0.019297373430865f, 0.004824343357716f};
+  const std::vector<mha_real_t> butter4_A =
+    {1.0f, -2.369513007182038f, 2.313988414415880f,
+     -1.054665405878567f, 0.187379492368185f};
+
+  std::vector<mha_real_t> conv(const std::vector<mha_real_t>& a,
+                               const std::vector<mha_real_t>& b) {
+    std::vector<mha_real_t> c(a.size() + b.size() - 1, 0.0f);
+    for (unsigned i = 0; i < a.size(); ++i)
+      for (unsigned j = 0; j < b.size(); ++j)
+        c[i+j] += a[i] * b[j];
+    return c;
+  }
+
+  // Multiply the polynomials of all sections, column offset 0 for the
+  // numerator, 3 for the denominator
+  std::vector<mha_real_t>
+  sos_poly(const std::vector<std::vector<mha_real_t>>& sos, unsigned offset) {
+    std::vector<mha_real_t> p = {1.0f};
+    for (const auto & row : sos)
+      p = conv(p, {row[offset], row[offset+1], row[offset+2]});
+    return p;
+  }
+
+  void expect_same_response(const std::vector<mha_real_t>& A,
+                            const std::vector<mha_real_t>& B,
+                            unsigned channels, float tolerance) {
+    MHAFilter::filter_t df2(channels, A, B);
+    MHAFilter::sos_filter_t sos(channels, A, B);
+    MHASignal::waveform_t x(200, channels), y_df2(200, channels),
+      y_sos(200, channels);
+    for (unsigned ch = 0; ch < channels; ++ch) {
+      x(ch, ch) = 1.0f; // shifted impulses
+      x(100 + ch, ch) = -0.5f;
+    }
+    df2.filter(&y_df2, &x);
+    sos.filter(&y_sos, &x);
+    for (unsigned k = 0; k < x.num_frames; ++k)
+      for (unsigned ch = 0; ch < channels; ++ch)
+        ASSERT_NEAR(y_df2(k, ch), y_sos(k, ch), tolerance)
+          << "frame " << k << " channel " << ch;
+  }
+}
+
+TEST(tf2sos, reconstructs_transfer_function) {
+  auto sos = MHAFilter::tf2sos(butter4_A, butter4_B);
+  ASSERT_EQ(2U, sos.size());
+  for (const auto & row : sos) {
+    ASSERT_EQ(6U, row.size());
+    EXPECT_EQ(1.0f, row[3]);
+  }
+  auto B = sos_poly(sos, 0), A = sos_poly(sos, 3);
+  ASSERT_EQ(butter4_B.size(), B.size());
+  for (unsigned k = 0; k < B.size(); ++k) {
+    EXPECT_NEAR(butter4_B[k], B[k], 1e-6);
+    EXPECT_NEAR(butter4_A[k], A[k], 1e-5);
+  }
+}
+
+TEST(tf2sos, odd_order_delay_and_fir) {
+  // third order with a pure delay of one sample in the numerator
+  auto sos = MHAFilter::tf2sos({2.0f, -1.0f, 0.5f, -0.125f},
+                               {0.0f, 1.0f, 0.5f});
+  ASSERT_EQ(2U, sos.size());
+  auto B = sos_poly(sos, 0), A = sos_poly(sos, 3);
+  const std::vector<mha_real_t> expected_B = {0.0f, 0.5f, 0.25f, 0.0f, 0.0f};
+  const std::vector<mha_real_t> expected_A = {1.0f,-0.5f,0.25f,-0.0625f,0.0f};
+  for (unsigned k = 0; k < B.size(); ++k) {
+    EXPECT_NEAR(expected_B[k], B[k], 1e-6);
+    EXPECT_NEAR(expected_A[k], A[k], 1e-6);
+  }
+  // FIR filter yields sections with trivial denominators
+  sos = MHAFilter::tf2sos({1.0f}, {1.0f, 2.0f, 3.0f, 4.0f});
+  ASSERT_EQ(2U, sos.size());
+  B = sos_poly(sos, 0);
+  EXPECT_NEAR(1.0f, B[0], 1e-5);
+  EXPECT_NEAR(2.0f, B[1], 1e-5);
+  EXPECT_NEAR(3.0f, B[2], 1e-5);
+  EXPECT_NEAR(4.0f, B[3], 1e-5);
+  for (const auto & row : sos) {
+    EXPECT_EQ(0.0f, row[4]);
+    EXPECT_EQ(0.0f, row[5]);
+  }
+  EXPECT_THROW(MHAFilter::tf2sos({0.0f, 1.0f}, {1.0f}), MHA_Error);
+}
+
+TEST(sos_filter_t, same_response_as_direct_form) {
+  expect_same_response(butter4_A, butter4_B, 3, 1e-5f);
+  expect_same_response({1.0f, -0.5f, 0.25f, -0.0625f}, {0.0f, 0.5f, 0.25f},
+                       2, 1e-5f);
+  expect_same_response({1.0f}, {0.5f, 0.25f, 0.125f}, 5, 1e-6f);
+}
+
+TEST(sos_filter_t, sample_and_block_processing_agree) {
+  MHAFilter::sos_filter_t block(2, butter4_A, butter4_B);
+  MHAFilter::sos_filter_t sample(2, butter4_A, butter4_B);
+  MHASignal::waveform_t x(64, 2);
+  for (unsigned k = 0; k < x.num_frames; ++k) {
+    x(k, 0) = std::sin(0.3f * k);
+    x(k, 1) = (k % 7) ? 0.0f : 1.0f;
+  }
+  MHASignal::waveform_t y(x);
+  block.filter(&y, &y); // in place
+  for (unsigned k = 0; k < x.num_frames; ++k)
+    for (unsigned ch = 0; ch < 2; ++ch)
+      EXPECT_FLOAT_EQ(sample.filter(x(k, ch), ch), y(k, ch));
+  EXPECT_THROW(sample.filter(0.0f, 2), MHA_Error);
+  MHASignal::waveform_t wrong(64, 3);
+  EXPECT_THROW(block.filter(&wrong, &wrong), MHA_Error);
+}
+
+TEST(iir_filter_t, sos_engine_selectable) {
+  const std::string A = "[1 -2.369513007182038 2.313988414415880 "
+    "-1.054665405878567 0.187379492368185]";
+  const std::string B = "[0.004824343357716 0.019297373430865 "
+    "0.028946060146297 0.019297373430865 0.004824343357716]";
+  MHAFilter::iir_filter_t df2("", A, B, 1), sos("", A, B, 1);
+  sos.parse("engine = sos");
+  EXPECT_EQ("sos", sos.parse("engine?val"));
+  MHASignal::waveform_t x(100, 1), y_df2(100, 1), y_sos(100, 1);
+  x(0, 0) = 1.0f;
+  df2.filter(&y_df2, &x);
+  sos.filter(&y_sos, &x);
+  for (unsigned k = 0; k < x.num_frames; ++k)
+    EXPECT_NEAR(y_df2(k, 0), y_sos(k, 0), 1e-6f);
+}
+
+namespace {
+  /// Feed a sine through an adaptive resampler with the given ratios per
+  /// block and return the largest deviation from the ideal sine evaluated
+  /// at the interpolation positions.
+  double adaptive_resampling_error(const std::vector<double> & ratios,
+                                   unsigned fragsize, double omega) {
+    const unsigned channels = 2;
+    MHAFilter::adaptive_resampling_t resampler(ratios[0], channels, 4096);
+    MHASignal::waveform_t out(fragsize, channels);
+    unsigned written = 0;
+    double position = 0, ratio = ratios[0], max_error = 0;
+    auto feed = [&](unsigned frames) {
+      MHASignal::waveform_t in(frames, channels);
+      for (unsigned k = 0; k < frames; ++k, ++written) {
+        in.value(k, 0) = std::sin(omega * written);
+        in.value(k, 1) = -0.5 * std::cos(omega * written);
+      }
+      resampler.write(in);
+    };
+    for (double target : ratios) {
+      resampler.set_ratio(target);
+      feed(resampler.frames_needed(fragsize));
+      EXPECT_TRUE(resampler.can_read(fragsize));
+      resampler.read(out);
+      for (unsigned m = 0; m < fragsize; ++m) {
+        // skip the start, where the kernel reaches into silence
+        if (position > 32) {
+          max_error = std::max(max_error, std::abs(out.value(m, 0) - std::sin(omega * position)));
+          max_error = std::max(max_error, std::abs(out.value(m, 1) + 0.5 * std::cos(omega * position)));
+        }
+        position += ratio + (target - ratio) * (m + 1.0) / fragsize;
+      }
+      ratio = target;
+    }
+    return max_error;
+  }
+}
+
+TEST(adaptive_resampling_t, interpolates_at_fractional_positions) {
+  const double omega = 2 * M_PI * 1000.0 / 48000.0;
+  EXPECT_LT(adaptive_resampling_error(std::vector<double>(40, 1.0), 64, omega), 2e-3);
+  EXPECT_LT(adaptive_resampling_error(std::vector<double>(40, 44100.0/48000.0), 64, omega), 2e-3);
+  EXPECT_LT(adaptive_resampling_error(std::vector<double>(40, 48000.0/44100.0), 64, omega), 2e-3);
+  EXPECT_LT(adaptive_resampling_error(std::vector<double>(40, 3.0), 20, omega), 2e-3);
+}
+
+TEST(adaptive_resampling_t, ratio_changes_are_ramped) {
+  const double omega = 2 * M_PI * 500.0 / 16000.0;
+  std::vector<double> ratios;
+  for (unsigned b = 0; b < 100; ++b)
+    ratios.push_back(1.0 + 0.01 * std::sin(0.3 * b));
+  EXPECT_LT(adaptive_resampling_error(ratios, 48, omega), 2e-3);
+}
+
+TEST(adaptive_resampling_t, read_needs_enough_input) {
+  MHAFilter::adaptive_resampling_t resampler(1.5, 1, 100, 8);
+  MHASignal::waveform_t out(10, 1), wrong_channels(10, 2);
+  // 10 outputs at ratio 1.5 reach input frame 13.5, plus 8 lookahead
+  EXPECT_EQ(22U, resampler.frames_needed(10));
+  EXPECT_FALSE(resampler.can_read(10));
+  EXPECT_THROW(resampler.read(out), MHA_Error);
+  MHASignal::waveform_t in(21, 1);
+  resampler.write(in);
+  EXPECT_EQ(1U, resampler.frames_needed(10));
+  EXPECT_THROW(resampler.read(out), MHA_Error);
+  EXPECT_DOUBLE_EQ(21.0, resampler.buffered_frames());
+  resampler.write(MHASignal::waveform_t(1, 1));
+  EXPECT_THROW(resampler.read(wrong_channels), MHA_Error);
+  resampler.read(out);
+  EXPECT_DOUBLE_EQ(7.0, resampler.buffered_frames());
+  EXPECT_THROW(resampler.write(MHASignal::waveform_t(101, 1)), MHA_Error);
+  EXPECT_THROW(resampler.set_ratio(0), MHA_Error);
+  EXPECT_THROW(MHAFilter::adaptive_resampling_t(-1, 1, 100), MHA_Error);
+}
+
+namespace {
+  /// Simulate a writer whose sampling clock deviates by drift from the
+  /// reader clock.  Both transmit a 440 Hz sine in their own time base.
+  /// Returns the largest deviation of the reader output from the sine
+  /// recursion during the last 10 seconds.
+  double simulate_drift(MHAFilter::drift_compensating_fifo_t & fifo,
+                        double drift, double seconds) {
+    const double srate = 48000, omega = 2 * M_PI * 440 / srate;
+    const unsigned writer_fragsize = 100, reader_fragsize = 64;
+    MHASignal::waveform_t in(writer_fragsize, 1), out(reader_fragsize, 1);
+    double writer_time = 0, reader_time = 0, max_residual = 0;
+    unsigned long written = 0;
+    double y1 = 0, y2 = 0;
+    while (reader_time < seconds) {
+      if (writer_time <= reader_time) {
+        for (unsigned k = 0; k < writer_fragsize; ++k, ++written)
+          in.value(k, 0) = std::sin(omega * written / (1 + drift));
+        fifo.write(in);
+        writer_time += writer_fragsize / (srate * (1 + drift));
+      } else {
+        fifo.read(out);
+        for (unsigned k = 0; k < reader_fragsize; ++k) {
+          double y = out.value(k, 0);
+          if (reader_time > seconds - 10)
+            max_residual = std::max(max_residual,
+                                    std::abs(y - 2 * std::cos(omega) * y1 + y2));
+          y2 = y1;
+          y1 = y;
+        }
+        reader_time += reader_fragsize / srate;
+      }
+    }
+    return max_residual;
+  }
+}
+
+TEST(drift_compensating_fifo_t, tracks_clock_drift) {
+  for (double drift : {200e-6, -200e-6, 0.0}) {
+    MHAFilter::drift_compensating_fifo_t fifo(1, 48000, 512, 4096, 2.0f);
+    const double residual = simulate_drift(fifo, drift, 60);
+    EXPECT_NEAR(drift, fifo.get_deviation(), 10e-6) << drift;
+    EXPECT_NEAR(512, fifo.get_fill_count(), 16) << drift;
+    EXPECT_EQ(0U, fifo.get_reader_xruns()) << drift;
+    EXPECT_EQ(0U, fifo.get_writer_xruns()) << drift;
+    // the sine recursion holds for a continuous sine without glitches
+    EXPECT_LT(residual, 1e-4) << drift;
+  }
+}
+
+TEST(drift_compensating_fifo_t, silence_until_desired_fill_and_after_underrun) {
+  MHAFilter::drift_compensating_fifo_t fifo(2, 16000, 100, 400);
+  MHASignal::waveform_t in(60, 2), out(50, 2);
+  in.assign(1.0f);
+  out.assign(2.0f);
+  fifo.write(in);
+  fifo.read(out);
+  EXPECT_EQ(0.0f, MHASignal::maxabs(out));
+  fifo.write(in);
+  fifo.read(out);
+  EXPECT_NEAR(1.0f, value(out, 49, 1), 0.01f);
+  fifo.read(out);
+  EXPECT_EQ(0U, fifo.get_reader_xruns());
+  fifo.read(out);
+  EXPECT_EQ(1U, fifo.get_reader_xruns());
+  EXPECT_EQ(0.0f, MHASignal::maxabs(out));
+  for (unsigned k = 0; k < 10; ++k)
+    fifo.write(in);
+  EXPECT_EQ(4U, fifo.get_writer_xruns());
+  MHASignal::waveform_t mono(50, 1);
+  EXPECT_THROW(fifo.read(mono), MHA_Error);
+  EXPECT_THROW(MHAFilter::drift_compensating_fifo_t(1, 16000, 400, 400), MHA_Error);
+}
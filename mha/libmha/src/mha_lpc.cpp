@@ -0,0 +1,270 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_lpc.hh"
+#include "mha_error.hh"
+#include "mha_simd.hh"
+#include <cmath>
+#include <algorithm>
+
+using MHASimd::v4_t;
+using MHASimd::load;
+using MHASimd::store;
+using MHASimd::sum;
+using MHASimd::broadcast;
+
+namespace {
+    /// Inner product of n contiguous elements
+    mha_real_t dot(const mha_real_t * x, const mha_real_t * y, unsigned n)
+    {
+        v4_t acc = broadcast(0.0f);
+        unsigned k = 0;
+        for (; k + 4 <= n; k += 4)
+            acc += load(x + k) * load(y + k);
+        mha_real_t s = sum(acc);
+        for (; k < n; ++k)
+            s += x[k] * y[k];
+        return s;
+    }
+
+    /// Smallest power of two not less than n
+    unsigned next_pow2(unsigned n)
+    {
+        unsigned p = 1;
+        while (p < n)
+            p *= 2;
+        return p;
+    }
+}
+
+void MHALPC::autocorrelation(const mha_real_t * x, unsigned len,
+                             mha_real_t * r, unsigned order)
+{
+    for (unsigned i = 0; i <= order; ++i)
+        r[i] = i < len ? dot(x, x + i, len - i) : 0.0f;
+}
+
+bool MHALPC::autocorrelation_t::fft_is_cheaper(unsigned len, unsigned order)
+{
+    // Multiply-adds of the direct sums against the rough cost of a
+    // forward and an inverse real FFT plus the power spectrum.  The
+    // constant was measured with the benchmark in mha_lpc_unit_tests.
+    const double n = next_pow2(len + order);
+    const double direct = double(len) * (order + 1) - 0.5 * order * (order + 1);
+    return direct > 3.0 * n * std::log2(n);
+}
+
+MHALPC::autocorrelation_t::autocorrelation_t(unsigned len_, unsigned order_)
+    : len(len_),
+      order(order_),
+      fft(nullptr),
+      padded(fft_is_cheaper(len_, order_) ? next_pow2(len_ + order_) : 0U, 1),
+      power(padded.num_frames / 2U + 1U, 1)
+{
+    // Zero padding to len+order avoids circular wrap around for all
+    // lags up to order.
+    if (padded.num_frames)
+        fft = mha_fft_new(padded.num_frames);
+}
+
+MHALPC::autocorrelation_t::~autocorrelation_t()
+{
+    if (fft)
+        mha_fft_free(fft);
+}
+
+void MHALPC::autocorrelation_t::operator()(const mha_real_t * x, mha_real_t * r)
+{
+    if (!fft) {
+        autocorrelation(x, len, r, order);
+        return;
+    }
+    std::copy(x, x + len, padded.buf);
+    mha_fft_wave2spec_scale(fft, &padded, &power);
+    for (unsigned k = 0; k < power.num_frames; ++k)
+        power.buf[k] = mha_complex(abs2(power.buf[k]), 0.0f);
+    mha_fft_spec2wave_scale(fft, &power, &padded);
+    std::copy(padded.buf, padded.buf + order + 1, r);
+    // the inverse transform overwrote the zero padding
+    std::fill(padded.buf + len, padded.buf + padded.num_frames, 0.0f);
+}
+
+MHALPC::levinson_durbin_t::levinson_durbin_t(unsigned order_)
+    : order(order_),
+      r_rev(order_ + 1, 0.0f),
+      a_rev(order_ + 1, 0.0f)
+{}
+
+mha_real_t MHALPC::levinson_durbin_t::operator()(const mha_real_t * r,
+                                                 mha_real_t * a)
+{
+    const unsigned P = order;
+    for (unsigned i = 0; i <= P; ++i) {
+        r_rev[P - i] = r[i];
+        a[i] = i == 0 ? 1.0f : 0.0f;
+        a_rev[P - i] = a[i];
+    }
+    double err = r[0];
+    // Raise the order from k to k+1.  With a(k+1) = 0, a(k+1-j) is
+    // a_rev[P-k-1+j] and r(k+1-j) is r_rev[P-k-1+j], so both the inner
+    // product and the update run forward through contiguous memory.
+    for (unsigned k = 0; k < P; ++k) {
+        if (!(err > 0.0))
+            break;
+        const unsigned offset = P - k - 1;
+        const double reflection = -dot(a, &r_rev[offset], k + 1) / err;
+        const mha_real_t lambda = reflection;
+        const v4_t lambda4 = broadcast(lambda);
+        mha_real_t * ar = &a_rev[offset];
+        const unsigned n = k + 2;
+        unsigned j = 0;
+        for (; j + 4 <= n; j += 4) {
+            const v4_t x = load(a + j), y = load(ar + j);
+            store(a + j, x + lambda4 * y);
+            store(ar + j, y + lambda4 * x);
+        }
+        for (; j < n; ++j) {
+            const mha_real_t x = a[j], y = ar[j];
+            a[j] = x + lambda * y;
+            ar[j] = y + lambda * x;
+        }
+        err *= 1.0 - reflection * reflection;
+    }
+    return err;
+}
+
+MHALPC::burg_lattice_t::burg_lattice_t(unsigned order_, unsigned channels_)
+    : order(order_),
+      channels(channels_),
+      lanes((channels_ + 3U) / 4U * 4U),
+      backward(order_ * lanes, 1e-10f),
+      kappa_state(order_ * lanes, 0.0f),
+      den(order_ * lanes, 1e-10f),
+      num(order_ * lanes, 1e-10f)
+{
+    if (order == 0)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "burg_lattice_t: The lattice needs at least one stage.");
+}
+
+void MHALPC::burg_lattice_t::check(const mha_wave_t & f_in,
+                                   const mha_wave_t & b_in,
+                                   const mha_wave_t & kappa,
+                                   const char * method) const
+{
+    if (f_in.num_channels != channels || b_in.num_channels != channels ||
+        kappa.num_channels != channels)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "burg_lattice_t::%s: Expected %u channels, got %u"
+                        " (forward), %u (backward), %u (kappa).", method,
+                        channels, f_in.num_channels, b_in.num_channels,
+                        kappa.num_channels);
+    if (b_in.num_frames != f_in.num_frames ||
+        kappa.num_frames != order * f_in.num_frames)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "burg_lattice_t::%s: %u forward and %u backward"
+                        " samples need %u reflection coefficients of order %u,"
+                        " got %u.", method, f_in.num_frames, b_in.num_frames,
+                        order * f_in.num_frames, order, kappa.num_frames);
+}
+
+namespace {
+    /// Gathers sample k of channels ch0..ch0+3, the lanes beyond the
+    /// last channel repeat it to keep the unused state well scaled
+    inline v4_t gather(const mha_wave_t & s, unsigned k, unsigned ch0)
+    {
+        v4_t v;
+        for (unsigned l = 0; l < 4; ++l)
+            v[l] = value(s, k, std::min(ch0 + l, s.num_channels - 1));
+        return v;
+    }
+
+    inline void scatter(mha_wave_t & s, unsigned k, unsigned ch0, v4_t v)
+    {
+        for (unsigned l = 0; l < 4 && ch0 + l < s.num_channels; ++l)
+            value(s, k, ch0 + l) = v[l];
+    }
+}
+
+void MHALPC::burg_lattice_t::estimate(const mha_wave_t & f_in,
+                                      const mha_wave_t & b_in,
+                                      mha_real_t lambda,
+                                      mha_wave_t & kappa)
+{
+    check(f_in, b_in, kappa, "estimate");
+    const v4_t l4 = broadcast(lambda);
+    const mha_real_t g = -2.0f * (1.0f - lambda);
+    const v4_t one_minus_l4 = 1.0f - l4, g4 = broadcast(g);
+    for (unsigned ch0 = 0; ch0 < channels; ch0 += 4)
+        for (unsigned k = 0; k < f_in.num_frames; ++k) {
+            v4_t f = gather(f_in, k, ch0);
+            v4_t b_prev = load(&backward[ch0]);
+            store(&backward[ch0], gather(b_in, k, ch0));
+            scatter(kappa, k * order, ch0, load(&kappa_state[ch0]));
+            for (unsigned m = 1; m < order; ++m) {
+                const unsigned i = m * lanes + ch0;
+                const unsigned i_prev = i - lanes;
+                const v4_t b_old = load(&backward[i]);
+                v4_t kap = load(&kappa_state[i]);
+                scatter(kappa, k * order + m, ch0, kap);
+                const v4_t d = l4 * load(&den[i_prev])
+                    + one_minus_l4 * (f * f + b_prev * b_prev);
+                const v4_t n = l4 * load(&num[i_prev]) + g4 * (f * b_prev);
+                store(&den[i_prev], d);
+                store(&num[i_prev], n);
+                kap = n / d;
+                store(&kappa_state[i], kap);
+                store(&backward[i], b_prev + kap * f);
+                f += kap * b_prev;
+                b_prev = b_old;
+            }
+        }
+}
+
+void MHALPC::burg_lattice_t::predict(const mha_wave_t & kappa,
+                                     const mha_wave_t & f_in,
+                                     const mha_wave_t & b_in,
+                                     mha_wave_t & f_out, mha_wave_t & b_out)
+{
+    check(f_in, b_in, kappa, "predict");
+    if (f_out.num_frames != f_in.num_frames || f_out.num_channels != channels ||
+        b_out.num_frames != f_in.num_frames || b_out.num_channels != channels)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "burg_lattice_t::predict: The outputs need %u frames"
+                        " and %u channels.", f_in.num_frames, channels);
+    for (unsigned ch0 = 0; ch0 < channels; ch0 += 4)
+        for (unsigned k = 0; k < f_in.num_frames; ++k) {
+            v4_t f = gather(f_in, k, ch0);
+            v4_t b_prev = load(&backward[ch0]);
+            store(&backward[ch0], gather(b_in, k, ch0));
+            for (unsigned m = 1; m < order; ++m) {
+                const unsigned i = m * lanes + ch0;
+                const v4_t b_old = load(&backward[i]);
+                const v4_t kap = gather(kappa, k * order + m, ch0);
+                store(&backward[i], b_prev + kap * f);
+                f += kap * b_prev;
+                b_prev = b_old;
+            }
+            scatter(f_out, k, ch0, f);
+            scatter(b_out, k, ch0, load(&backward[(order - 1) * lanes + ch0]));
+        }
+}
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
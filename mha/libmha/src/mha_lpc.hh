@@ -0,0 +1,187 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_LPC_HH
+#define MHA_LPC_HH
+
+#include "mha.hh"
+#include "mha_signal.hh"
+#include <vector>
+
+/**
+    \ingroup mhatoolbox
+    \file mha_lpc.hh
+    \brief Linear prediction kernels shared by the lpc plugins
+*/
+
+/** \ingroup mhatoolbox
+    \brief Namespace for linear predictive coding (LPC) analysis
+*/
+namespace MHALPC {
+
+    /** Direct computation of the autocorrelation of a signal block.
+     *
+     * \f$r(i) = \sum_{j=0}^{len-1-i} x(j) x(j+i)\f$ for \f$0 \le i \le order\f$,
+     * lags at or beyond the block length are zero.  The result is not
+     * normalized.
+     * @param x    Block of len contiguous samples
+     * @param len  Number of samples in x
+     * @param r    Output, order+1 lags
+     * @param order Highest lag to compute
+     */
+    void autocorrelation(const mha_real_t * x, unsigned len,
+                         mha_real_t * r, unsigned order);
+
+    /** Autocorrelation of signal blocks of a fixed length for lags 0
+     * to order.
+     *
+     * The direct sums cost len*(order+1) multiplications.  When the
+     * number of lags makes this more expensive than two real FFTs of
+     * the zero padded block, the autocorrelation is computed as the
+     * inverse transform of the power spectrum instead.  The method is
+     * chosen once in the constructor, both produce the result of
+     * #MHALPC::autocorrelation within single precision rounding.
+     */
+    class autocorrelation_t {
+    public:
+        /** @param len   Number of samples in each block
+         *  @param order Highest lag to compute */
+        autocorrelation_t(unsigned len, unsigned order);
+        ~autocorrelation_t();
+        autocorrelation_t(const autocorrelation_t &) = delete;
+        autocorrelation_t & operator=(const autocorrelation_t &) = delete;
+
+        /** Computes the unnormalized autocorrelation.
+         * @param x Block of len contiguous samples
+         * @param r Output, order+1 lags */
+        void operator()(const mha_real_t * x, mha_real_t * r);
+
+        /// True if the FFT method is used for these dimensions
+        bool uses_fft() const {return fft != nullptr;}
+
+        /// Estimated cost comparison used by the constructor
+        static bool fft_is_cheaper(unsigned len, unsigned order);
+    private:
+        unsigned len;
+        unsigned order;
+        mha_fft_t fft;
+        /// Zero padded block, only the first len samples are overwritten
+        MHASignal::waveform_t padded;
+        MHASignal::spectrum_t power;
+    };
+
+    /** Levinson-Durbin recursion for the prediction error filter of
+     * a given order.
+     *
+     * Solves the normal equations of the autocorrelation method for
+     * the coefficients \f$a(0)=1, a(1), \ldots, a(order)\f$ of the
+     * prediction error filter \f$e(n) = \sum_k a(k) x(n-k)\f$.  The
+     * inner products and the order updates work on contiguous
+     * reversed copies of the autocorrelation and the coefficients,
+     * four elements at a time.  If the prediction error power drops
+     * to zero, e.g. for a silent block, the recursion stops and the
+     * remaining coefficients are zero.
+     */
+    class levinson_durbin_t {
+    public:
+        /// @param order Order of the prediction error filter
+        explicit levinson_durbin_t(unsigned order);
+
+        /** @param r Autocorrelation, order+1 lags
+         *  @param a Output, order+1 filter coefficients
+         *  @return Prediction error power of the final order */
+        mha_real_t operator()(const mha_real_t * r, mha_real_t * a);
+
+        unsigned get_order() const {return order;}
+    private:
+        unsigned order;
+        /// r_rev[order-i] = r(i)
+        std::vector<mha_real_t> r_rev;
+        /// a_rev[order-i] = a(i) of the current order
+        std::vector<mha_real_t> a_rev;
+    };
+
+    /** Adaptive Burg lattice of lpc_burg-lattice and lpc_bl_predictor.
+     *
+     * The lattice has order stages, stage 0 takes the input samples
+     * and stage m>0 is coupled by the reflection coefficient
+     * \f$\kappa(m)\f$:
+     * \f{eqnarray*}{
+     * f(m) &=& f(m-1) + \kappa(m) b'(m-1)\\
+     * b(m) &=& b'(m-1) + \kappa(m) f(m-1)
+     * \f}
+     * where \f$b'\f$ is the backward error of the previous sample.
+     * The stages of one sample depend on each other, so the state of
+     * four channels is kept side by side and processed as one vector.
+     *
+     * Reflection coefficients are exchanged as waveforms with
+     * order*frames frames: frame k*order+m holds \f$\kappa(m)\f$
+     * for sample k, and \f$\kappa(0)\f$ is always zero.
+     */
+    class burg_lattice_t {
+    public:
+        /** @param order    Number of lattice stages
+         *  @param channels Number of independent channels */
+        burg_lattice_t(unsigned order, unsigned channels);
+
+        /** Adapts the reflection coefficients sample by sample.
+         *
+         * \f{eqnarray*}{
+         * d(m) &=& \lambda d(m) + (1-\lambda) (f(m-1)^2 + b'(m-1)^2)\\
+         * n(m) &=& \lambda n(m) - (1-\lambda) 2 f(m-1) b'(m-1)\\
+         * \kappa(m) &=& n(m) / d(m)
+         * \f}
+         * @param f_in  Input of the forward path
+         * @param b_in  Input of the backward path
+         * @param lambda Forgetting factor
+         * @param kappa Output, the reflection coefficients in effect
+         *              before the update of each sample
+         * @throw MHA_Error if the dimensions do not match */
+        void estimate(const mha_wave_t & f_in, const mha_wave_t & b_in,
+                      mha_real_t lambda, mha_wave_t & kappa);
+
+        /** Runs the lattice with given reflection coefficients.
+         * @param kappa Reflection coefficients for each sample
+         * @param f_in  Input of the forward path
+         * @param b_in  Input of the backward path
+         * @param f_out Output, forward error of the last stage
+         * @param b_out Output, backward error of the last stage
+         * @throw MHA_Error if the dimensions do not match */
+        void predict(const mha_wave_t & kappa,
+                     const mha_wave_t & f_in, const mha_wave_t & b_in,
+                     mha_wave_t & f_out, mha_wave_t & b_out);
+
+        unsigned get_order() const {return order;}
+    private:
+        void check(const mha_wave_t & f_in, const mha_wave_t & b_in,
+                   const mha_wave_t & kappa, const char * method) const;
+        unsigned order;
+        unsigned channels;
+        /// Channels rounded up to a multiple of four
+        unsigned lanes;
+        /// Lattice state, element m*lanes+ch
+        std::vector<mha_real_t> backward;
+        std::vector<mha_real_t> kappa_state, den, num;
+    };
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,115 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the autocorrelation and Levinson-Durbin kernels with the
+// loops the lpc plugin used before, for one channel.
+
+#include "mha_lpc.hh"
+#include "mha_signal.hh"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    /// Second order autoregressive process driven by reproducible noise
+    std::vector<mha_real_t> ar2_signal(unsigned len, unsigned channel = 0)
+    {
+        std::vector<mha_real_t> x(len);
+        uint32_t state = 4711U + channel;
+        double x1 = 0, x2 = 0;
+        for (unsigned k = 0; k < len; ++k) {
+            state = state * 1664525U + 1013904223U;
+            const double e = (state >> 8) / double(1 << 23) - 1.0;
+            x[k] = 1.2 * x1 - 0.5 * x2 + e;
+            x2 = x1;
+            x1 = x[k];
+        }
+        return x;
+    }
+
+    /// Levinson2 of the lpc plugin before it used this module
+    void reference_levinson(unsigned P, const std::vector<mha_real_t> & R,
+                            std::vector<mha_real_t> & A)
+    {
+        for (unsigned k = 0; k < P + 1; ++k)
+            A[k] = (k == 0) ? 1.0 : 0.0;
+        double Ek = R[0];
+        for (unsigned k = 0; k < P; ++k) {
+            double lambda = 0;
+            for (unsigned j = 0; j < k + 1; ++j)
+                lambda += A[j] * R[k + 1 - j];
+            lambda /= -Ek;
+            for (unsigned j = 0; j <= (k + 1) / 2; j++) {
+                double temp = A[k + 1 - j] + lambda * A[j];
+                A[j] = A[j] + lambda * A[k + 1 - j];
+                A[k + 1 - j] = temp;
+            }
+            Ek = (1.0 - lambda * lambda) * Ek;
+        }
+    }
+}
+
+int main()
+{
+    const unsigned blocks = 20000;
+    auto measure = [&](auto && process) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned b = 0; b < blocks; ++b)
+            process();
+        std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        return t.count() / blocks * 1e6;
+    };
+    for (unsigned len : {160U, 512U, 2048U})
+        for (unsigned order : {10U, 20U, 32U, 48U, 64U, 128U}) {
+            const std::vector<mha_real_t> x = ar2_signal(len);
+            std::vector<mha_real_t> r(order + 1), a(order + 1);
+            MHASignal::ringbuffer_t buffer(len + 1, 1, len);
+            for (unsigned k = 0; k < len; ++k)
+                buffer.value(k, 0) = x[k];
+            const double t_loops = measure([&]{
+                for (unsigned i = 0; i < order + 1; ++i) {
+                    r[i] = 0;
+                    for (unsigned j = 0; j < len - i; ++j)
+                        r[i] += buffer.value(j, 0) * buffer.value(j + i, 0);
+                }
+                reference_levinson(order, r, a);
+            });
+            MHALPC::autocorrelation_t autocorrelation(len, order);
+            MHALPC::levinson_durbin_t levinson(order);
+            std::vector<mha_real_t> block(len);
+            const double t_kernels = measure([&]{
+                for (unsigned k = 0; k < len; ++k)
+                    block[k] = buffer.value(k, 0);
+                autocorrelation(block.data(), r.data());
+                levinson(r.data(), a.data());
+            });
+            const double t_levinson_ref = measure([&]{reference_levinson(order, r, a);});
+            const double t_levinson = measure([&]{levinson(r.data(), a.data());});
+            std::cout << len << " samples, order " << order << ": loops "
+                      << t_loops << " us, kernels " << t_kernels << " us ("
+                      << (autocorrelation.uses_fft() ? "fft" : "direct")
+                      << ", speedup " << t_loops / t_kernels << "), levinson "
+                      << t_levinson_ref << " -> " << t_levinson << " us"
+                      << std::endl;
+        }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,233 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_lpc.hh"
+#include "mha_error.hh"
+#include <cmath>
+
+namespace {
+    /// Second order autoregressive process driven by reproducible noise
+    std::vector<mha_real_t> ar2_signal(unsigned len, unsigned channel = 0)
+    {
+        std::vector<mha_real_t> x(len);
+        uint32_t state = 4711U + channel;
+        double x1 = 0, x2 = 0;
+        for (unsigned k = 0; k < len; ++k) {
+            state = state * 1664525U + 1013904223U;
+            const double e = (state >> 8) / double(1 << 23) - 1.0;
+            x[k] = 1.2 * x1 - 0.5 * x2 + e;
+            x2 = x1;
+            x1 = x[k];
+        }
+        return x;
+    }
+
+    std::vector<double> reference_autocorrelation(const std::vector<mha_real_t> & x,
+                                                  unsigned order)
+    {
+        std::vector<double> r(order + 1, 0.0);
+        for (unsigned i = 0; i <= order; ++i)
+            for (unsigned j = 0; j + i < x.size(); ++j)
+                r[i] += double(x[j]) * x[j + i];
+        return r;
+    }
+
+    /// Levinson2 of the lpc plugin before it used this module
+    void reference_levinson(unsigned P, const std::vector<mha_real_t> & R,
+                            std::vector<mha_real_t> & A)
+    {
+        for (unsigned k = 0; k < P + 1; ++k)
+            A[k] = (k == 0) ? 1.0 : 0.0;
+        double Ek = R[0];
+        for (unsigned k = 0; k < P; ++k) {
+            double lambda = 0;
+            for (unsigned j = 0; j < k + 1; ++j)
+                lambda += A[j] * R[k + 1 - j];
+            lambda /= -Ek;
+            for (unsigned j = 0; j <= (k + 1) / 2; j++) {
+                double temp = A[k + 1 - j] + lambda * A[j];
+                A[j] = A[j] + lambda * A[k + 1 - j];
+                A[k + 1 - j] = temp;
+            }
+            Ek = (1.0 - lambda * lambda) * Ek;
+        }
+    }
+
+    /// Lattice loops of the lpc_burg-lattice and lpc_bl_predictor plugins
+    class reference_lattice_t {
+    public:
+        reference_lattice_t(unsigned order, unsigned channels)
+            : P(order), forward(order, channels), backward(order, 2 * channels),
+              kappa(order, channels), dm(order, channels), nm(order, channels)
+        {
+            forward.assign(1e-10f);
+            backward.assign(1e-10f);
+            dm.assign(1e-10f);
+            nm.assign(1e-10f);
+        }
+        void step(mha_real_t f, mha_real_t b, unsigned ch, mha_real_t lambda,
+                  mha_real_t * kb, const mha_real_t * km) {
+            forward(0, ch) = f;
+            backward(0, ch * 2 + 1) = backward(0, ch * 2);
+            backward(0, ch * 2) = b;
+            if (kb)
+                kb[0] = kappa(0, ch);
+            for (unsigned m = 1; m < P; m++) {
+                backward(m, ch * 2 + 1) = backward(m, ch * 2);
+                mha_real_t k;
+                if (kb) {
+                    kb[m] = kappa(m, ch);
+                    dm(m-1, ch) = lambda * dm(m-1, ch) + (1-lambda) *
+                        (pow(forward(m-1, ch), 2) + pow(backward(m-1, ch * 2 + 1), 2));
+                    nm(m-1, ch) = lambda * nm(m-1, ch) + (1-lambda) * (-2) *
+                        (forward(m-1, ch) * backward(m-1, ch * 2 + 1));
+                    kappa(m, ch) = nm(m-1, ch) / dm(m-1, ch);
+                    k = kappa(m, ch);
+                }
+                else
+                    k = km[m];
+                forward(m, ch) = forward(m-1, ch) + k * backward(m-1, ch * 2 + 1);
+                backward(m, ch * 2) = backward(m-1, ch * 2 + 1) + k * forward(m-1, ch);
+            }
+        }
+        unsigned P;
+        MHASignal::waveform_t forward, backward, kappa, dm, nm;
+    };
+}
+
+TEST(MHALPC, autocorrelation_matches_direct_sums)
+{
+    for (unsigned len : {1U, 7U, 33U, 160U})
+        for (unsigned order : {0U, 3U, 10U, 40U}) {
+            const std::vector<mha_real_t> x = ar2_signal(len);
+            const std::vector<double> expected = reference_autocorrelation(x, order);
+            std::vector<mha_real_t> r(order + 1, -1.0f);
+            MHALPC::autocorrelation(x.data(), len, r.data(), order);
+            for (unsigned i = 0; i <= order; ++i)
+                EXPECT_NEAR(expected[i], r[i], 1e-5 * expected[0])
+                    << "len " << len << " order " << order << " lag " << i;
+        }
+}
+
+TEST(MHALPC, fft_autocorrelation_matches_direct_sums)
+{
+    EXPECT_FALSE(MHALPC::autocorrelation_t(160, 10).uses_fft());
+    for (auto [len, order] : {std::pair{256U, 64U}, {300U, 64U}, {1024U, 200U}}) {
+        MHALPC::autocorrelation_t autocorrelation(len, order);
+        EXPECT_TRUE(autocorrelation.uses_fft()) << len;
+        // two different blocks, the zero padding is restored in between
+        for (unsigned channel : {0U, 1U}) {
+            const std::vector<mha_real_t> x = ar2_signal(len, channel);
+            const std::vector<double> expected = reference_autocorrelation(x, order);
+            std::vector<mha_real_t> r(order + 1);
+            autocorrelation(x.data(), r.data());
+            for (unsigned i = 0; i <= order; ++i)
+                EXPECT_NEAR(expected[i], r[i], 1e-5 * expected[0])
+                    << "len " << len << " lag " << i;
+        }
+    }
+}
+
+TEST(MHALPC, levinson_durbin_matches_original_recursion)
+{
+    const std::vector<mha_real_t> x = ar2_signal(2000);
+    for (unsigned order : {1U, 2U, 5U, 10U, 20U, 37U, 64U}) {
+        std::vector<mha_real_t> r(order + 1), a(order + 1), expected(order + 1);
+        MHALPC::autocorrelation(x.data(), x.size(), r.data(), order);
+        reference_levinson(order, r, expected);
+        MHALPC::levinson_durbin_t levinson(order);
+        const mha_real_t err = levinson(r.data(), a.data());
+        for (unsigned i = 0; i <= order; ++i)
+            EXPECT_NEAR(expected[i], a[i], 1e-4f) << "order " << order << " i " << i;
+        if (order >= 2) {
+            // the AR(2) process that generated x, driven by noise with
+            // variance 1/3
+            EXPECT_NEAR(-1.2f, a[1], 0.05f);
+            EXPECT_NEAR(0.5f, a[2], 0.05f);
+            EXPECT_NEAR(1.0 / 3.0, err / x.size(), 0.02);
+        }
+    }
+}
+
+TEST(MHALPC, levinson_durbin_of_silence_is_identity_filter)
+{
+    MHALPC::levinson_durbin_t levinson(8);
+    std::vector<mha_real_t> r(9, 0.0f), a(9, 2.0f);
+    EXPECT_EQ(0.0f, levinson(r.data(), a.data()));
+    EXPECT_EQ(1.0f, a[0]);
+    for (unsigned i = 1; i <= 8; ++i)
+        EXPECT_EQ(0.0f, a[i]);
+}
+
+TEST(MHALPC, burg_lattice_matches_plugin_loops)
+{
+    for (unsigned channels : {1U, 2U, 5U})
+        for (unsigned order : {1U, 2U, 21U}) {
+            const unsigned frames = 16, blocks = 20;
+            const mha_real_t lambda = 0.99375f;
+            MHALPC::burg_lattice_t estimator(order, channels), predictor(order, channels);
+            reference_lattice_t ref_estimator(order, channels), ref_predictor(order, channels);
+            MHASignal::waveform_t f(frames, channels), b(frames, channels),
+                kappa(order * frames, channels), f_est(frames, channels),
+                b_est(frames, channels), other(frames, channels);
+            std::vector<mha_real_t> kb(order);
+            for (unsigned block = 0; block < blocks; ++block) {
+                for (unsigned ch = 0; ch < channels; ++ch) {
+                    const std::vector<mha_real_t> x =
+                        ar2_signal(frames * (block + 1), ch);
+                    for (unsigned k = 0; k < frames; ++k) {
+                        f(k, ch) = b(k, ch) = x[block * frames + k];
+                        other(k, ch) = 0.5f * x[block * frames + k] - 0.1f * ch;
+                    }
+                }
+                estimator.estimate(f, b, lambda, kappa);
+                predictor.predict(kappa, other, other, f_est, b_est);
+                for (unsigned ch = 0; ch < channels; ++ch)
+                    for (unsigned k = 0; k < frames; ++k) {
+                        ref_estimator.step(f(k, ch), b(k, ch), ch, lambda,
+                                           kb.data(), nullptr);
+                        for (unsigned m = 0; m < order; ++m)
+                            ASSERT_NEAR(kb[m], kappa(k * order + m, ch), 1e-4f)
+                                << channels << " channels, order " << order
+                                << ", block " << block << ", m " << m;
+                        ref_predictor.step(other(k, ch), other(k, ch), ch,
+                                           lambda, nullptr, kb.data());
+                        ASSERT_NEAR(ref_predictor.forward(order - 1, ch),
+                                    f_est(k, ch), 1e-4f);
+                        ASSERT_NEAR(ref_predictor.backward(order - 1, 2 * ch),
+                                    b_est(k, ch), 1e-4f);
+                    }
+            }
+        }
+}
+
+TEST(MHALPC, burg_lattice_checks_dimensions)
+{
+    EXPECT_THROW(MHALPC::burg_lattice_t(0, 1), MHA_Error);
+    MHALPC::burg_lattice_t lattice(4, 2);
+    MHASignal::waveform_t s(8, 2), kappa(32, 2), wrong_kappa(24, 2), mono(8, 1);
+    EXPECT_NO_THROW(lattice.estimate(s, s, 0.9f, kappa));
+    EXPECT_THROW(lattice.estimate(s, s, 0.9f, wrong_kappa), MHA_Error);
+    EXPECT_THROW(lattice.estimate(mono, s, 0.9f, kappa), MHA_Error);
+    EXPECT_THROW(lattice.predict(kappa, s, s, s, mono), MHA_Error);
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,581 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_recfile.hh"
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const char file_magic[8] = {'M','H','A','R','E','C','0','1'};
+    const char index_magic[8] = {'M','H','A','I','D','X','0','1'};
+    const size_t block_header_size = 32;
+    const size_t index_entry_size = 32;
+    const size_t trailer_size = 24;
+
+    // LZ4 block format constraints: the last 5 bytes are always
+    // literals, and the last match starts at least 12 bytes before the
+    // end of the input.
+    const size_t lz_min_match = 4;
+    const size_t lz_last_literals = 5;
+    const size_t lz_match_limit = 12;
+    const unsigned lz_hash_log = 14;
+    const size_t lz_max_offset = 65535;
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        uint32_t v;
+        memcpy(&v,p,sizeof(v));
+        return v;
+    }
+
+    inline uint32_t lz_hash(uint32_t v)
+    {
+        return (v * 2654435761U) >> (32 - lz_hash_log);
+    }
+
+    /// Append a length extension in LZ4 encoding
+    inline uint8_t* put_length(uint8_t* op, size_t len)
+    {
+        while( len >= 255 ){
+            *op++ = 255;
+            len -= 255;
+        }
+        *op++ = len;
+        return op;
+    }
+
+    /// Group the bytes of n doubles by significance
+    void shuffle(const double* src, size_t n, uint8_t* dst)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+        for(size_t b=0;b<sizeof(double);b++)
+            for(size_t k=0;k<n;k++)
+                dst[b*n+k] = bytes[k*sizeof(double)+b];
+    }
+
+    /// Inverse of shuffle()
+    void unshuffle(const uint8_t* src, size_t n, double* dst)
+    {
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(dst);
+        for(size_t k=0;k<n;k++)
+            for(size_t b=0;b<sizeof(double);b++)
+                bytes[k*sizeof(double)+b] = src[b*n+k];
+    }
+
+    template <class T> void put(uint8_t*& p, T v)
+    {
+        memcpy(p,&v,sizeof(v));
+        p += sizeof(v);
+    }
+
+    template <class T> T get(const uint8_t*& p)
+    {
+        T v;
+        memcpy(&v,p,sizeof(v));
+        p += sizeof(v);
+        return v;
+    }
+
+    int seek64(FILE* fh, uint64_t pos)
+    {
+#ifdef _WIN32
+        return _fseeki64(fh,pos,SEEK_SET);
+#else
+        return fseeko(fh,pos,SEEK_SET);
+#endif
+    }
+
+    uint64_t file_size(FILE* fh)
+    {
+#ifdef _WIN32
+        _fseeki64(fh,0,SEEK_END);
+        return _ftelli64(fh);
+#else
+        fseeko(fh,0,SEEK_END);
+        return ftello(fh);
+#endif
+    }
+}
+
+MHARecFile::lz_compressor_t::lz_compressor_t()
+    : table(1U << lz_hash_log)
+{
+}
+
+size_t MHARecFile::lz_compressor_t::compress(const uint8_t* src, size_t n,
+                                             uint8_t* dst)
+{
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    if( n > lz_match_limit ){
+        std::fill(table.begin(),table.end(),0U);
+        const size_t mflimit = n - lz_match_limit;
+        const size_t matchlimit = n - lz_last_literals;
+        size_t ip = 1;
+        // skip faster through incompressible data
+        unsigned misses = 0;
+        while( ip < mflimit ){
+            const uint32_t seq = read32(src+ip);
+            const uint32_t h = lz_hash(seq);
+            const size_t ref = table[h];
+            table[h] = ip;
+            if( (ip - ref > lz_max_offset) || (read32(src+ref) != seq) ){
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            size_t len = lz_min_match;
+            while( (ip + len < matchlimit) && (src[ref+len] == src[ip+len]) )
+                len++;
+            const size_t literals = ip - anchor;
+            const size_t matchcode = len - lz_min_match;
+            uint8_t* token = op++;
+            *token = (std::min(literals,size_t(15)) << 4) |
+                std::min(matchcode,size_t(15));
+            if( literals >= 15 )
+                op = put_length(op,literals-15);
+            memcpy(op,src+anchor,literals);
+            op += literals;
+            const size_t offset = ip - ref;
+            *op++ = offset & 0xff;
+            *op++ = offset >> 8;
+            if( matchcode >= 15 )
+                op = put_length(op,matchcode-15);
+            ip += len;
+            anchor = ip;
+            if( ip < mflimit )
+                table[lz_hash(read32(src+ip-2))] = ip-2;
+        }
+    }
+    const size_t literals = n - anchor;
+    *op++ = std::min(literals,size_t(15)) << 4;
+    if( literals >= 15 )
+        op = put_length(op,literals-15);
+    memcpy(op,src+anchor,literals);
+    op += literals;
+    return op - dst;
+}
+
+size_t MHARecFile::lz_decompress(const uint8_t* src, size_t n,
+                                 uint8_t* dst, size_t capacity)
+{
+    size_t ip = 0, op = 0;
+    while( ip < n ){
+        const uint8_t token = src[ip++];
+        size_t literals = token >> 4;
+        if( literals == 15 ){
+            uint8_t b;
+            do {
+                if( ip >= n )
+                    throw MHA_ErrorMsg("Corrupt compressed data:"
+                                       " truncated literal length.");
+                b = src[ip++];
+                literals += b;
+            } while( b == 255 );
+        }
+        if( (literals > n - ip) || (literals > capacity - op) )
+            throw MHA_ErrorMsg("Corrupt compressed data: literals exceed"
+                               " buffer.");
+        memcpy(dst+op,src+ip,literals);
+        ip += literals;
+        op += literals;
+        if( ip == n )
+            break;
+        if( n - ip < 2 )
+            throw MHA_ErrorMsg("Corrupt compressed data: truncated offset.");
+        const size_t offset = src[ip] | (size_t(src[ip+1]) << 8);
+        ip += 2;
+        if( (offset == 0) || (offset > op) )
+            throw MHA_ErrorMsg("Corrupt compressed data: invalid offset.");
+        size_t len = token & 15;
+        if( len == 15 ){
+            uint8_t b;
+            do {
+                if( ip >= n )
+                    throw MHA_ErrorMsg("Corrupt compressed data:"
+                                       " truncated match length.");
+                b = src[ip++];
+                len += b;
+            } while( b == 255 );
+        }
+        len += lz_min_match;
+        if( len > capacity - op )
+            throw MHA_ErrorMsg("Corrupt compressed data: match exceeds"
+                               " buffer.");
+        // byte-wise copy, source and destination may overlap
+        const uint8_t* match = dst + op - offset;
+        for(size_t k=0;k<len;k++)
+            dst[op+k] = match[k];
+        op += len;
+    }
+    return op;
+}
+
+MHARecFile::writer_t::writer_t(const std::string& filename,
+                               const std::vector<stream_info_t>& istreams,
+                               bool icompress)
+    : fh(NULL),
+      streams(istreams),
+      compress(icompress),
+      offset(0)
+{
+    if( streams.empty() )
+        throw MHA_ErrorMsg("A recording file needs at least one stream.");
+    if( !(fh = fopen(filename.c_str(),"wb")) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Unable to create file \"%s\".",filename.c_str());
+    try {
+        write(file_magic,sizeof(file_magic));
+        const uint32_t nstreams = streams.size();
+        write(&nstreams,sizeof(nstreams));
+        for(const auto& stream : streams){
+            const uint32_t head[2] = {stream.ndim,stream.is_complex};
+            const uint32_t namelen = stream.name.size();
+            write(head,sizeof(head));
+            write(&stream.rate,sizeof(stream.rate));
+            write(&namelen,sizeof(namelen));
+            write(stream.name.data(),namelen);
+        }
+    }
+    catch(...){
+        fclose(fh);
+        throw;
+    }
+}
+
+MHARecFile::writer_t::~writer_t()
+{
+    try {
+        close();
+    }
+    catch(MHA_Error&){
+        // a destructor must not throw; the file is closed in any case
+    }
+}
+
+void MHARecFile::writer_t::write(const void* data, size_t bytes)
+{
+    if( fwrite(data,1,bytes,fh) != bytes )
+        throw MHA_ErrorMsg("Unable to write to recording file.");
+    offset += bytes;
+}
+
+void MHARecFile::writer_t::write_block(unsigned stream, uint64_t first_frame,
+                                       unsigned nframes, double timestamp,
+                                       const double* frames)
+{
+    if( !fh )
+        throw MHA_ErrorMsg("Recording file is already closed.");
+    if( stream >= streams.size() )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Invalid stream number %u (file has %zu streams).",
+                        stream,streams.size());
+    if( nframes == 0 )
+        return;
+    const size_t values = size_t(nframes) * streams[stream].frame_size();
+    const size_t raw_bytes = values * sizeof(double);
+    uint32_t codec = CODEC_RAW;
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(frames);
+    size_t payload_size = raw_bytes;
+    if( compress ){
+        if( shuffled.size() < raw_bytes )
+            shuffled.resize(raw_bytes);
+        if( packed.size() < lz_compressor_t::bound(raw_bytes) )
+            packed.resize(lz_compressor_t::bound(raw_bytes));
+        shuffle(frames,values,shuffled.data());
+        const size_t packed_size =
+            lz.compress(shuffled.data(),raw_bytes,packed.data());
+        if( packed_size < raw_bytes ){
+            codec = CODEC_SHUFFLE_LZ;
+            payload = packed.data();
+            payload_size = packed_size;
+        }
+    }
+    index.push_back({offset,stream,nframes,first_frame,timestamp});
+    uint8_t head[block_header_size];
+    uint8_t* p = head;
+    put<uint32_t>(p,stream);
+    put<uint32_t>(p,nframes);
+    put<uint64_t>(p,first_frame);
+    put<double>(p,timestamp);
+    put<uint32_t>(p,codec);
+    put<uint32_t>(p,payload_size);
+    write(head,sizeof(head));
+    write(payload,payload_size);
+}
+
+void MHARecFile::writer_t::close()
+{
+    if( !fh )
+        return;
+    FILE* f = fh;
+    try {
+        const uint64_t index_offset = offset;
+        for(const auto& block : index){
+            uint8_t entry[index_entry_size];
+            uint8_t* p = entry;
+            put<uint64_t>(p,block.offset);
+            put<uint32_t>(p,block.stream);
+            put<uint32_t>(p,block.nframes);
+            put<uint64_t>(p,block.first_frame);
+            put<double>(p,block.timestamp);
+            write(entry,sizeof(entry));
+        }
+        const uint64_t trailer[2] = {index_offset,index.size()};
+        write(trailer,sizeof(trailer));
+        write(index_magic,sizeof(index_magic));
+    }
+    catch(...){
+        fh = NULL;
+        fclose(f);
+        throw;
+    }
+    fh = NULL;
+    if( fclose(f) != 0 )
+        throw MHA_ErrorMsg("Unable to close recording file.");
+}
+
+MHARecFile::reader_t::reader_t(const std::string& filename)
+    : fh(NULL),
+      index_found(false)
+{
+    if( !(fh = fopen(filename.c_str(),"rb")) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Unable to open file \"%s\".",filename.c_str());
+    try {
+        char magic[sizeof(file_magic)];
+        read(magic,sizeof(magic));
+        if( memcmp(magic,file_magic,sizeof(magic)) != 0 )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "\"%s\" is not an MHA recording file.",
+                            filename.c_str());
+        uint32_t nstreams;
+        read(&nstreams,sizeof(nstreams));
+        for(uint32_t k=0;k<nstreams;k++){
+            uint32_t head[2];
+            uint32_t namelen;
+            stream_info_t stream;
+            read(head,sizeof(head));
+            read(&stream.rate,sizeof(stream.rate));
+            read(&namelen,sizeof(namelen));
+            stream.name.resize(namelen);
+            if( namelen )
+                read(&stream.name[0],namelen);
+            stream.ndim = head[0];
+            stream.is_complex = head[1];
+            streams.push_back(stream);
+        }
+        const uint64_t header_end = ftell(fh);
+        const uint64_t size = file_size(fh);
+        index_found = read_index(size);
+        if( !index_found ){
+            index.clear();
+            seek64(fh,header_end);
+            scan_blocks(size);
+        }
+    }
+    catch(...){
+        fclose(fh);
+        throw;
+    }
+    stream_blocks.resize(streams.size());
+    for(size_t k=0;k<index.size();k++)
+        stream_blocks[index[k].stream].push_back(k);
+    for(auto& blocks : stream_blocks)
+        std::stable_sort(blocks.begin(),blocks.end(),
+                         [this](size_t a, size_t b)
+                         {return index[a].first_frame < index[b].first_frame;});
+}
+
+MHARecFile::reader_t::~reader_t()
+{
+    fclose(fh);
+}
+
+void MHARecFile::reader_t::read(void* data, size_t bytes)
+{
+    if( fread(data,1,bytes,fh) != bytes )
+        throw MHA_ErrorMsg("Unexpected end of recording file.");
+}
+
+bool MHARecFile::reader_t::read_index(uint64_t size)
+{
+    if( size < trailer_size )
+        return false;
+    seek64(fh,size-trailer_size);
+    uint8_t trailer[trailer_size];
+    if( fread(trailer,1,trailer_size,fh) != trailer_size )
+        return false;
+    if( memcmp(trailer+16,index_magic,sizeof(index_magic)) != 0 )
+        return false;
+    const uint8_t* p = trailer;
+    const uint64_t index_offset = get<uint64_t>(p);
+    const uint64_t entries = get<uint64_t>(p);
+    if( (index_offset > size) ||
+        (entries != (size - trailer_size - index_offset) / index_entry_size) )
+        return false;
+    std::vector<uint8_t> buf(entries*index_entry_size);
+    seek64(fh,index_offset);
+    if( fread(buf.data(),1,buf.size(),fh) != buf.size() )
+        return false;
+    p = buf.data();
+    for(uint64_t k=0;k<entries;k++){
+        block_info_t block;
+        block.offset = get<uint64_t>(p);
+        block.stream = get<uint32_t>(p);
+        block.nframes = get<uint32_t>(p);
+        block.first_frame = get<uint64_t>(p);
+        block.timestamp = get<double>(p);
+        if( block.stream >= streams.size() )
+            return false;
+        index.push_back(block);
+    }
+    return true;
+}
+
+void MHARecFile::reader_t::scan_blocks(uint64_t size)
+{
+    uint64_t pos = ftell(fh);
+    uint8_t head[block_header_size];
+    while( (pos + block_header_size <= size) &&
+           (fread(head,1,block_header_size,fh) == block_header_size) ){
+        const uint8_t* p = head;
+        block_info_t block;
+        block.offset = pos;
+        block.stream = get<uint32_t>(p);
+        block.nframes = get<uint32_t>(p);
+        block.first_frame = get<uint64_t>(p);
+        block.timestamp = get<double>(p);
+        const uint32_t codec = get<uint32_t>(p);
+        const uint32_t payload_size = get<uint32_t>(p);
+        // stop at the first incomplete or invalid block
+        if( (block.stream >= streams.size()) || (codec > CODEC_SHUFFLE_LZ) ||
+            (payload_size > size - pos - block_header_size) )
+            break;
+        if( (codec == CODEC_RAW) &&
+            (payload_size != uint64_t(block.nframes) *
+             streams[block.stream].frame_size() * sizeof(double)) )
+            break;
+        index.push_back(block);
+        pos += block_header_size + payload_size;
+        seek64(fh,pos);
+    }
+}
+
+void MHARecFile::reader_t::check_stream(unsigned stream) const
+{
+    if( stream >= streams.size() )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Invalid stream number %u (file has %zu streams).",
+                        stream,streams.size());
+}
+
+uint64_t MHARecFile::reader_t::get_end_frame(unsigned stream) const
+{
+    check_stream(stream);
+    uint64_t end = 0;
+    for(size_t k : stream_blocks[stream])
+        end = std::max(end,index[k].first_frame + index[k].nframes);
+    return end;
+}
+
+void MHARecFile::reader_t::read_frames(unsigned stream, uint64_t first_frame,
+                                       uint64_t count,
+                                       std::vector<uint64_t>& frame_indices,
+                                       std::vector<double>& data)
+{
+    check_stream(stream);
+    frame_indices.clear();
+    data.clear();
+    const unsigned frame_size = streams[stream].frame_size();
+    const uint64_t end_frame = first_frame + count;
+    const std::vector<size_t>& blocks = stream_blocks[stream];
+    // first block that may contain first_frame
+    auto it = std::upper_bound(blocks.begin(),blocks.end(),first_frame,
+                               [this](uint64_t frame, size_t k)
+                               {return frame < index[k].first_frame;});
+    if( it != blocks.begin() )
+        --it;
+    for(; it != blocks.end() && index[*it].first_frame < end_frame; ++it){
+        const block_info_t& block = index[*it];
+        if( block.first_frame + block.nframes <= first_frame )
+            continue;
+        seek64(fh,block.offset);
+        uint8_t head[block_header_size];
+        read(head,sizeof(head));
+        const uint8_t* p = head + 24;
+        const uint32_t codec = get<uint32_t>(p);
+        const uint32_t payload_size = get<uint32_t>(p);
+        const size_t values = size_t(block.nframes) * frame_size;
+        const size_t raw_bytes = values * sizeof(double);
+        decoded.resize(values);
+        if( codec == CODEC_RAW ){
+            if( payload_size != raw_bytes )
+                throw MHA_ErrorMsg("Corrupt recording file: block size"
+                                   " mismatch.");
+            read(decoded.data(),raw_bytes);
+        }else if( codec == CODEC_SHUFFLE_LZ ){
+            packed.resize(payload_size);
+            shuffled.resize(raw_bytes);
+            read(packed.data(),payload_size);
+            if( lz_decompress(packed.data(),payload_size,
+                              shuffled.data(),raw_bytes) != raw_bytes )
+                throw MHA_ErrorMsg("Corrupt recording file: block size"
+                                   " mismatch.");
+            unshuffle(shuffled.data(),values,decoded.data());
+        }else
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Unknown codec %u in recording file.",codec);
+        const uint64_t from = std::max(first_frame,block.first_frame);
+        const uint64_t to = std::min(end_frame,
+                                     block.first_frame + block.nframes);
+        for(uint64_t frame=from;frame<to;frame++){
+            frame_indices.push_back(frame);
+            const double* src =
+                decoded.data() + (frame - block.first_frame) * frame_size;
+            data.insert(data.end(),src,src+frame_size);
+        }
+    }
+}
+
+uint64_t MHARecFile::reader_t::frame_at_time(unsigned stream, double t) const
+{
+    check_stream(stream);
+    const std::vector<size_t>& blocks = stream_blocks[stream];
+    // first block that starts after t
+    auto it = std::upper_bound(blocks.begin(),blocks.end(),t,
+                               [this](double time, size_t k)
+                               {return time < index[k].timestamp;});
+    if( it != blocks.begin() ){
+        const block_info_t& block = index[*(it-1)];
+        const double rate = streams[stream].rate;
+        const double offset = (rate > 0) ?
+            std::ceil((t - block.timestamp) * rate - 1e-9) :
+            (t > block.timestamp);
+        if( offset < block.nframes )
+            return block.first_frame + uint64_t(offset);
+    }
+    if( it == blocks.end() )
+        return get_end_frame(stream);
+    return index[*it].first_frame;
+}
+
+// Local Variables:
+// compile-command: "make -C .."
+// coding: utf-8-unix
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// End:
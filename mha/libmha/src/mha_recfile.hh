@@ -0,0 +1,229 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_RECFILE_HH
+#define MHA_RECFILE_HH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "mha_error.hh"
+
+/**
+    \ingroup mhatoolbox
+    \file mha_recfile.hh
+    \brief Chunked, indexed recording file format shared by the recorder
+    plugins.
+*/
+
+/** \ingroup mhatoolbox
+    \brief Reading and writing of MHA recording files (.mhrec).
+
+    A recording file contains one or more synchronized streams.  Each
+    stream has a fixed number of values per frame and stores its frames
+    in blocks.  Every block carries the index of its first frame and a
+    timestamp, so that gaps caused by dropped frames are visible, and
+    can optionally be compressed.  When the file is closed, an index of
+    all blocks is appended, which allows readers to seek directly to a
+    frame range or point in time.  Files without index (e.g. after a
+    crash) can still be read by scanning the blocks sequentially.
+
+    File layout, all numbers in host byte order:
+    - File header: 8 bytes "MHAREC01", uint32 number of streams, then
+      for each stream uint32 ndim, uint32 is_complex, double frame
+      rate in Hz (0: unknown), uint32 name length and the name without
+      terminating zero.
+    - Blocks: uint32 stream number, uint32 number of frames n, uint64
+      index of first frame, double timestamp in seconds, uint32 codec,
+      uint32 payload size in bytes, payload.  The decoded payload
+      consists of n frames, each with ndim doubles (2*ndim for complex
+      streams, alternating real and imaginary parts).
+    - Index: one entry per block: uint64 file offset of the block,
+      uint32 stream, uint32 number of frames, uint64 first frame,
+      double timestamp.
+    - Trailer: uint64 file offset of the index, uint64 number of index
+      entries, 8 bytes "MHAIDX01".
+
+    Codec 0 stores the doubles uncompressed.  Codec 1 first groups the
+    bytes of all doubles by significance (byte shuffle) and then
+    compresses them in the LZ4 block format.
+*/
+namespace MHARecFile {
+
+    /// Payload encodings of blocks
+    enum codec_t {
+        CODEC_RAW = 0,        ///< Uncompressed doubles
+        CODEC_SHUFFLE_LZ = 1  ///< Byte shuffle followed by LZ4 block format
+    };
+
+    /// Description of one stream of a recording file
+    struct stream_info_t {
+        /// Name of the stream, e.g. the AC variable name
+        std::string name;
+        /// Number of values per frame
+        unsigned ndim = 0;
+        /// Whether values are complex
+        bool is_complex = false;
+        /// Frames per second, 0 if unknown
+        double rate = 0;
+        /// Number of doubles per frame
+        unsigned frame_size() const {return is_complex ? 2*ndim : ndim;}
+    };
+
+    /// Index entry of one block
+    struct block_info_t {
+        /// File offset of the block header
+        uint64_t offset;
+        /// Stream number
+        unsigned stream;
+        /// Number of frames in this block
+        unsigned nframes;
+        /// Index of the first frame in this block
+        uint64_t first_frame;
+        /// Timestamp of the first frame in seconds
+        double timestamp;
+    };
+
+    /** Fast LZ compressor producing the LZ4 block format.  Keeps its
+     * hash table between calls to avoid memory allocation. */
+    class lz_compressor_t {
+    public:
+        lz_compressor_t();
+        /** Compress n bytes.
+         * @param src Source data.
+         * @param n Number of source bytes.
+         * @param dst Destination, must have room for bound(n) bytes.
+         * @return Number of bytes written to dst. */
+        size_t compress(const uint8_t* src, size_t n, uint8_t* dst);
+        /// Maximum compressed size of n bytes
+        static size_t bound(size_t n) {return n + n / 255 + 16;}
+    private:
+        std::vector<uint32_t> table;
+    };
+
+    /** Decompress data in the LZ4 block format.
+     * @param src Compressed data.
+     * @param n Number of compressed bytes.
+     * @param dst Destination buffer.
+     * @param capacity Size of dst in bytes.
+     * @return Number of decompressed bytes.
+     * @throw MHA_Error if the data is corrupt or does not fit into dst. */
+    size_t lz_decompress(const uint8_t* src, size_t n,
+                         uint8_t* dst, size_t capacity);
+
+    /** Writer of recording files.  Not real-time safe: used by the disk
+     * writer threads of the recorder plugins. */
+    class writer_t {
+    public:
+        /** Create the file and write the file header.
+         * @param filename Output file name.
+         * @param streams Streams stored in this file.
+         * @param compress Compress blocks with CODEC_SHUFFLE_LZ.  Blocks
+         *                 that do not get smaller are stored raw. */
+        writer_t(const std::string& filename,
+                 const std::vector<stream_info_t>& streams,
+                 bool compress);
+        /// Closes the file if close() has not been called.
+        ~writer_t();
+        writer_t(const writer_t&) = delete;
+        writer_t& operator=(const writer_t&) = delete;
+        /** Append one block of frames.
+         * @param stream Stream number.
+         * @param first_frame Index of the first frame of this block.
+         * @param nframes Number of frames.
+         * @param timestamp Time of the first frame in seconds.
+         * @param frames nframes frames of streams[stream].frame_size()
+         *               doubles each. */
+        void write_block(unsigned stream, uint64_t first_frame,
+                         unsigned nframes, double timestamp,
+                         const double* frames);
+        /// Write the index and the trailer and close the file.
+        void close();
+        /// Number of bytes written to the file so far
+        uint64_t get_bytes_written() const {return offset;}
+    private:
+        void write(const void* data, size_t bytes);
+        FILE* fh;
+        std::vector<stream_info_t> streams;
+        bool compress;
+        uint64_t offset;
+        std::vector<block_info_t> index;
+        std::vector<uint8_t> shuffled;
+        std::vector<uint8_t> packed;
+        lz_compressor_t lz;
+    };
+
+    /** Random-access reader of recording files. */
+    class reader_t {
+    public:
+        /** Open a recording file and read or reconstruct the index.
+         * @throw MHA_Error if the file cannot be opened or is not a
+         *                  recording file. */
+        explicit reader_t(const std::string& filename);
+        ~reader_t();
+        reader_t(const reader_t&) = delete;
+        reader_t& operator=(const reader_t&) = delete;
+        /// The streams of this file
+        const std::vector<stream_info_t>& get_streams() const {return streams;}
+        /// All blocks in file order
+        const std::vector<block_info_t>& get_index() const {return index;}
+        /// False if the file was not closed properly and the index was
+        /// reconstructed by scanning the blocks.
+        bool has_index() const {return index_found;}
+        /// One past the index of the last frame of a stream
+        uint64_t get_end_frame(unsigned stream) const;
+        /** Read the stored frames of one stream in a frame range.
+         * Frames that were not recorded are omitted.
+         * @param stream Stream number.
+         * @param first_frame First frame index of the range.
+         * @param count Number of frame indices in the range.
+         * @param frame_indices Receives the index of each frame read.
+         * @param data Receives frame_size() doubles per frame read. */
+        void read_frames(unsigned stream, uint64_t first_frame,
+                         uint64_t count,
+                         std::vector<uint64_t>& frame_indices,
+                         std::vector<double>& data);
+        /** Index of the first frame of a stream recorded at or after
+         * time t.  Timestamps within blocks are interpolated with the
+         * frame rate of the stream.  Returns get_end_frame() if no such
+         * frame exists. */
+        uint64_t frame_at_time(unsigned stream, double t) const;
+    private:
+        void read(void* data, size_t bytes);
+        bool read_index(uint64_t file_size);
+        void scan_blocks(uint64_t file_size);
+        void check_stream(unsigned stream) const;
+        FILE* fh;
+        std::vector<stream_info_t> streams;
+        std::vector<block_info_t> index;
+        /// Per stream: positions in index, sorted by first frame
+        std::vector<std::vector<size_t> > stream_blocks;
+        bool index_found;
+        std::vector<uint8_t> packed;
+        std::vector<uint8_t> shuffled;
+        std::vector<double> decoded;
+    };
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
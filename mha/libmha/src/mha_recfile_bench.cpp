@@ -0,0 +1,87 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the write and read throughput of mhrec files with the raw
+// doubles that acrec writes.
+
+#include "mha_recfile.hh"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+using namespace MHARecFile;
+
+int main()
+{
+  const std::string filename = "mha_recfile_bench.mhrec";
+  // 64 channel level meter at 48 kHz / 64 samples per block,
+  // written in blocks of 256 frames as the disk writer threads do
+  const unsigned ndim = 64, frames = 256, blocks = 400;
+  std::vector<double> data(ndim * frames);
+  for (size_t k = 0; k < data.size(); ++k)
+    data[k] = float(65.0 + 20.0 * sin(0.0002 * k + 0.3 * (k % ndim)));
+  const double mbytes = blocks * data.size() * sizeof(double) / 1e6;
+  auto report = [&](const char * name, double seconds, uint64_t bytes) {
+    std::cout << name << ": " << mbytes / seconds << " MB/s, file size "
+              << bytes / 1e6 << " MB" << std::endl;
+  };
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    FILE * fh = fopen(filename.c_str(), "wb");
+    for (unsigned b = 0; b < blocks; ++b)
+      fwrite(data.data(), sizeof(double), data.size(), fh);
+    fclose(fh);
+    auto t1 = std::chrono::steady_clock::now();
+    report("raw doubles (acrec .dat)",
+           std::chrono::duration<double>(t1 - t0).count(),
+           uint64_t(blocks) * data.size() * sizeof(double));
+  }
+  std::vector<stream_info_t> streams(1);
+  streams[0].name = "level";
+  streams[0].ndim = ndim;
+  streams[0].rate = 750;
+  for (bool compress : {false, true}) {
+    auto t0 = std::chrono::steady_clock::now();
+    writer_t writer(filename, streams, compress);
+    for (unsigned b = 0; b < blocks; ++b)
+      writer.write_block(0, uint64_t(b) * frames, frames, b * frames / 750.0,
+                         data.data());
+    writer.close();
+    auto t1 = std::chrono::steady_clock::now();
+    report(compress ? "mhrec compressed" : "mhrec raw",
+           std::chrono::duration<double>(t1 - t0).count(),
+           writer.get_bytes_written());
+    auto t2 = std::chrono::steady_clock::now();
+    reader_t reader(filename);
+    std::vector<uint64_t> indices;
+    std::vector<double> out;
+    for (unsigned b = 0; b < blocks; ++b)
+      reader.read_frames(0, uint64_t(b) * frames, frames, indices, out);
+    auto t3 = std::chrono::steady_clock::now();
+    report(compress ? "mhrec compressed read" : "mhrec raw read",
+           std::chrono::duration<double>(t3 - t2).count(),
+           writer.get_bytes_written());
+  }
+  remove(filename.c_str());
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,240 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_recfile.hh"
+#include <unistd.h>
+#include <cmath>
+
+using namespace MHARecFile;
+
+namespace {
+  const std::string filename = "mha_recfile_unit_test.mhrec";
+
+  std::vector<uint8_t> roundtrip(const std::vector<uint8_t> & in,
+                                 size_t * compressed_size = nullptr)
+  {
+    lz_compressor_t lz;
+    std::vector<uint8_t> packed(lz_compressor_t::bound(in.size()));
+    size_t n = lz.compress(in.data(), in.size(), packed.data());
+    EXPECT_LE(n, packed.size());
+    if (compressed_size)
+      *compressed_size = n;
+    std::vector<uint8_t> out(in.size() + 16);
+    out.resize(lz_decompress(packed.data(), n, out.data(), out.size()));
+    return out;
+  }
+
+  std::vector<stream_info_t> two_streams()
+  {
+    stream_info_t level, spec;
+    level.name = "level";
+    level.ndim = 3;
+    level.rate = 100;
+    spec.name = "spec";
+    spec.ndim = 2;
+    spec.is_complex = true;
+    spec.rate = 100;
+    return {level, spec};
+  }
+
+  /// frame of stream 0 or 1 with frame index k
+  std::vector<double> frame_values(unsigned stream, uint64_t k)
+  {
+    if (stream == 0)
+      return {double(k), 0.25 * k, -1.0};
+    return {double(k), 1.0, 2.0, double(k) * k};
+  }
+
+  /// write blocks of 10 frames of both streams, frames 50..59 missing
+  void write_test_file(bool compress)
+  {
+    writer_t writer(filename, two_streams(), compress);
+    for (uint64_t first = 0; first < 100; first += 10) {
+      if (first == 50)
+        continue;
+      for (unsigned stream = 0; stream < 2; ++stream) {
+        std::vector<double> frames;
+        for (uint64_t k = first; k < first + 10; ++k) {
+          std::vector<double> f = frame_values(stream, k);
+          frames.insert(frames.end(), f.begin(), f.end());
+        }
+        writer.write_block(stream, first, 10, first / 100.0, frames.data());
+      }
+    }
+    writer.close();
+  }
+
+  void check_test_file(reader_t & reader)
+  {
+    ASSERT_EQ(2U, reader.get_streams().size());
+    EXPECT_EQ("level", reader.get_streams()[0].name);
+    EXPECT_EQ(3U, reader.get_streams()[0].ndim);
+    EXPECT_FALSE(reader.get_streams()[0].is_complex);
+    EXPECT_EQ(100.0, reader.get_streams()[0].rate);
+    EXPECT_EQ("spec", reader.get_streams()[1].name);
+    EXPECT_TRUE(reader.get_streams()[1].is_complex);
+    EXPECT_EQ(18U, reader.get_index().size());
+    EXPECT_EQ(100U, reader.get_end_frame(1));
+    std::vector<uint64_t> indices;
+    std::vector<double> data;
+    // range across the gap
+    reader.read_frames(1, 45, 20, indices, data);
+    std::vector<uint64_t> expected_indices = {45, 46, 47, 48, 49,
+                                              60, 61, 62, 63, 64};
+    EXPECT_EQ(expected_indices, indices);
+    ASSERT_EQ(40U, data.size());
+    for (unsigned k = 0; k < indices.size(); ++k) {
+      std::vector<double> f = frame_values(1, indices[k]);
+      std::vector<double> actual(data.begin() + 4 * k,
+                                 data.begin() + 4 * k + 4);
+      EXPECT_EQ(f, actual);
+    }
+    reader.read_frames(0, 98, 10, indices, data);
+    ASSERT_EQ(2U, indices.size());
+    EXPECT_EQ(0.25 * 99, data[4]);
+    reader.read_frames(0, 200, 10, indices, data);
+    EXPECT_TRUE(indices.empty());
+    EXPECT_TRUE(data.empty());
+    // timestamp of block k*10 is k/10 s, frame rate 100 Hz
+    EXPECT_EQ(0U, reader.frame_at_time(0, -1.0));
+    EXPECT_EQ(23U, reader.frame_at_time(0, 0.225));
+    EXPECT_EQ(30U, reader.frame_at_time(0, 0.3));
+    EXPECT_EQ(60U, reader.frame_at_time(0, 0.55));
+    EXPECT_EQ(100U, reader.frame_at_time(0, 2.0));
+    EXPECT_THROW(reader.frame_at_time(2, 0.0), MHA_Error);
+  }
+}
+
+TEST(lz_compressor_t, roundtrip_of_random_repetitive_and_short_data)
+{
+  std::vector<uint8_t> data;
+  unsigned seed = 1;
+  for (size_t n : {0, 1, 5, 12, 13, 17, 100, 70000}) {
+    data.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+      seed = seed * 1664525U + 1013904223U;
+      data[k] = seed >> 24;
+    }
+    EXPECT_EQ(data, roundtrip(data)) << "random, size " << n;
+    for (size_t k = 0; k < n; ++k)
+      data[k] = (k % 7) + ((k / 1000) & 1) * 100;
+    EXPECT_EQ(data, roundtrip(data)) << "repetitive, size " << n;
+  }
+  // long runs need length extensions and compress well
+  data.assign(100000, 42);
+  data[50000] = 1;
+  size_t compressed_size = 0;
+  EXPECT_EQ(data, roundtrip(data, &compressed_size));
+  EXPECT_GT(1000U, compressed_size);
+}
+
+TEST(lz_compressor_t, decompress_rejects_corrupt_data)
+{
+  // token: 1 literal, match of 4 bytes at offset 2 (only 1 byte written)
+  const uint8_t bad_offset[] = {0x10, 'a', 2, 0};
+  uint8_t out[64];
+  EXPECT_THROW(lz_decompress(bad_offset, sizeof(bad_offset), out, 64),
+               MHA_Error);
+  // 3 literals announced, but only 2 present
+  const uint8_t truncated[] = {0x30, 'a', 'b'};
+  EXPECT_THROW(lz_decompress(truncated, sizeof(truncated), out, 64),
+               MHA_Error);
+  // output does not fit
+  const uint8_t literals[] = {0x30, 'a', 'b', 'c'};
+  EXPECT_THROW(lz_decompress(literals, sizeof(literals), out, 2), MHA_Error);
+  EXPECT_EQ(3U, lz_decompress(literals, sizeof(literals), out, 3));
+}
+
+TEST(recfile, roundtrip_with_gap_uncompressed_and_compressed)
+{
+  for (bool compress : {false, true}) {
+    write_test_file(compress);
+    reader_t reader(filename);
+    EXPECT_TRUE(reader.has_index());
+    check_test_file(reader);
+  }
+  remove(filename.c_str());
+}
+
+TEST(recfile, compression_reduces_size_of_smooth_data)
+{
+  std::vector<stream_info_t> streams(1);
+  streams[0].name = "level";
+  streams[0].ndim = 16;
+  std::vector<double> frames(16 * 256);
+  for (size_t k = 0; k < frames.size(); ++k)
+    frames[k] = std::round(60.0 + 10.0 * sin(0.001 * k));
+  uint64_t sizes[2];
+  for (bool compress : {false, true}) {
+    writer_t writer(filename, streams, compress);
+    writer.write_block(0, 0, 256, 0.0, frames.data());
+    writer.close();
+    sizes[compress] = writer.get_bytes_written();
+    reader_t reader(filename);
+    std::vector<uint64_t> indices;
+    std::vector<double> data;
+    reader.read_frames(0, 0, 256, indices, data);
+    EXPECT_EQ(frames, data);
+  }
+  remove(filename.c_str());
+  EXPECT_LT(sizes[1] * 4, sizes[0]);
+}
+
+TEST(recfile, reader_reconstructs_index_of_unclosed_file)
+{
+  write_test_file(true);
+  FILE * fh = fopen(filename.c_str(), "rb");
+  ASSERT_NE(nullptr, fh);
+  std::vector<char> content(1 << 16);
+  content.resize(fread(content.data(), 1, content.size(), fh));
+  fclose(fh);
+  // drop index, trailer, and a part of the last block
+  const size_t index_size = 18 * 32 + 24;
+  content.resize(content.size() - index_size - 3);
+  fh = fopen(filename.c_str(), "wb");
+  fwrite(content.data(), 1, content.size(), fh);
+  fclose(fh);
+  reader_t reader(filename);
+  EXPECT_FALSE(reader.has_index());
+  EXPECT_EQ(17U, reader.get_index().size());
+  EXPECT_EQ(100U, reader.get_end_frame(0));
+  EXPECT_EQ(90U, reader.get_end_frame(1));
+  remove(filename.c_str());
+}
+
+TEST(recfile, rejects_invalid_files_and_arguments)
+{
+  EXPECT_THROW(reader_t("no_such_file.mhrec"), MHA_Error);
+  FILE * fh = fopen(filename.c_str(), "wb");
+  fputs("RIFF and more", fh);
+  fclose(fh);
+  EXPECT_THROW(reader_t reader(filename), MHA_Error);
+  std::vector<stream_info_t> none;
+  EXPECT_THROW(writer_t(filename, none, false), MHA_Error);
+  writer_t writer(filename, two_streams(), false);
+  double frame[4] = {0, 0, 0, 0};
+  EXPECT_THROW(writer.write_block(2, 0, 1, 0.0, frame), MHA_Error);
+  writer.close();
+  EXPECT_THROW(writer.write_block(0, 0, 1, 0.0, frame), MHA_Error);
+  remove(filename.c_str());
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
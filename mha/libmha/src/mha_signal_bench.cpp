@@ -0,0 +1,59 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Measures the cost of resampling stereo audio with 4 ms polyphase
+// filters.
+
+#include "mha_signal.hh"
+#include "mha_filter.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+int main()
+{
+  const std::pair<float,float> conversions[] = {
+    {44100, 48000}, {48000, 44100}, {16000, 48000}, {48000, 16000}};
+  const unsigned nchannels = 2U, seconds = 20U;
+  for (auto [source, target] : conversions) {
+    const unsigned in_fragsize = unsigned(source) / 100U;
+    const unsigned out_fragsize = unsigned(target) / 100U;
+    MHAFilter::blockprocessing_polyphase_resampling_t
+      resampler(source, in_fragsize, target, out_fragsize, 0.85f, 0.004f,
+                nchannels, true);
+    MHASignal::waveform_t in(in_fragsize, nchannels);
+    MHASignal::waveform_t out(out_fragsize, nchannels);
+    for (unsigned k = 0; k < in.num_frames * nchannels; ++k)
+      in.buf[k] = std::sin(0.01f * k);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < seconds * 100U; ++b) {
+      resampler.write(in);
+      while (resampler.can_read())
+        resampler.read(out);
+    }
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+    std::cout << source << " -> " << target << " Hz, 4 ms filter, "
+              << nchannels << " channels: " << t.count() / seconds * 1e3
+              << " ms per second of audio" << std::endl;
+  }
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
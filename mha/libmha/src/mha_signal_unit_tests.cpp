@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2017 2018 2019 HörTech gGmbH
-// Copyright © 2024 Hörzentrum Oldenburg gGmbH
+// Copyright © 2024 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -600,6 +600,54 @@ TEST(blockprocessing_polyphase_resampling_t, test_48k_16k_64_20_roundtrip)
   ASSERT_NEAR(0.0f, zero, 0.017);
 }
 
+TEST(polyphase_resampling_t, equals_filtering_at_interpolation_rate)
+{
+  // Compare with zero-stuffing, FIR filtering and decimation at the
+  // interpolation rate, using the same windowed sinc impulse response.
+  const unsigned n_up = 3U, n_down = 4U, n_channels = 3U, n_irs = 101U;
+  const unsigned n_prefill = (n_irs - 1U) / n_up + 1U;
+  const unsigned n_in = 200U, n_out = 100U, n_read = 7U;
+  const mha_real_t nyquist_ratio = 0.85f;
+  MHAFilter::polyphase_resampling_t resampler(n_up, n_down, nyquist_ratio,
+                                              n_irs, n_prefill + n_in,
+                                              n_channels, n_prefill);
+  MHASignal::waveform_t input(n_in, n_channels);
+  for (unsigned frame = 0U; frame < n_in; ++frame)
+    for (unsigned channel = 0U; channel < n_channels; ++channel)
+      input.value(frame, channel) =
+        sinf(0.05f * (channel + 1U) * frame) + 0.01f * channel;
+  resampler.write(input);
+
+  std::vector<double> h(n_irs);
+  MHAWindow::hanning_t window(n_irs);
+  double sum = 0;
+  const double q = nyquist_ratio / std::max(n_up, n_down);
+  for (unsigned k = 0U; k < n_irs; ++k)
+    sum += (h[k] = window.value(k, 0) * MHAFilter::sinc(M_PI * q * (k - (n_irs - 1.0) / 2.0)));
+  // input signal including prefill at the interpolation rate
+  auto x = [&](int frame, unsigned channel) {
+    frame -= n_prefill;
+    return frame < 0 ? 0.0 : double(input.value(frame, channel));
+  };
+
+  MHASignal::waveform_t output(n_read, n_channels);
+  unsigned out_frame = 0U;
+  while (out_frame + n_read <= n_out) {
+    resampler.read(output);
+    for (unsigned frame = 0U; frame < n_read; ++frame, ++out_frame)
+      for (unsigned channel = 0U; channel < n_channels; ++channel) {
+        // first output corresponds to interpolated index n_up*n_prefill-1
+        const int now = int(n_up * n_prefill - 1U + out_frame * n_down);
+        double expected = 0;
+        for (unsigned k = 0U; k < n_irs; ++k)
+          if ((now - int(k)) >= 0 && (now - int(k)) % n_up == 0)
+            expected += h[k] * n_up / sum * x((now - int(k)) / n_up, channel);
+        ASSERT_NEAR(expected, output.value(frame, channel), 2e-6)
+          << "frame " << out_frame << " channel " << channel;
+      }
+  }
+}
+
 TEST(mha_signal_helper_functions,for_each) {
   unsigned sig_len{5U};
   unsigned nchan{2U};
@@ -0,0 +1,41 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_simd.hh"
+
+void MHASimd::exp(const mha_real_t * x, mha_real_t * y, unsigned n)
+{
+    unsigned k = 0;
+    for (; k + 4 <= n; k += 4)
+        store(y + k, exp(load(x + k)));
+    if (k < n)
+        store(y + k, exp(load(x + k, n - k, 0.0f)), n - k);
+}
+
+void MHASimd::log(const mha_real_t * x, mha_real_t * y, unsigned n)
+{
+    unsigned k = 0;
+    for (; k + 4 <= n; k += 4)
+        store(y + k, log(load(x + k)));
+    if (k < n)
+        store(y + k, log(load(x + k, n - k, 1.0f)), n - k);
+}
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
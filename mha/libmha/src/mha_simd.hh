@@ -0,0 +1,197 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_SIMD_HH
+#define MHA_SIMD_HH
+
+#include "mha.hh"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/**
+    \ingroup mhatoolbox
+    \file mha_simd.hh
+    \brief Four-lane single precision vectors and elementary functions
+*/
+
+/** \ingroup mhatoolbox
+    \brief Four-lane vectors of mha_real_t for elementwise kernels
+
+    The vector type uses the GCC vector extension, which is compiled to
+    SSE instructions on x86 and to NEON on ARM.  Loads and stores do
+    not require any alignment.
+*/
+namespace MHASimd {
+
+    typedef float v4_t __attribute__ ((vector_size(4*sizeof(float))));
+    typedef int32_t v4i_t __attribute__ ((vector_size(4*sizeof(int32_t))));
+
+#if defined(__AVX__)
+    /// Number of floats in the widest vector registers of the target
+    constexpr unsigned native_width = 8U;
+#else
+    /// Number of floats in the widest vector registers of the target
+    constexpr unsigned native_width = 4U;
+#endif
+
+    /** Vector of native_width floats, for kernels that work with any
+     * number of lanes.  Maps to AVX registers when compiled for AVX. */
+    typedef float vnative_t
+    __attribute__ ((vector_size(native_width*sizeof(float))));
+
+    inline v4_t load(const mha_real_t * p) {
+        v4_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline void store(mha_real_t * p, v4_t v) {
+        std::memcpy(p, &v, sizeof(v));
+    }
+
+    /** Loads count < 4 elements, the remaining lanes are set to fill */
+    inline v4_t load(const mha_real_t * p, unsigned count, mha_real_t fill) {
+        mha_real_t lanes[4] = {fill, fill, fill, fill};
+        std::memcpy(lanes, p, count * sizeof(mha_real_t));
+        return load(lanes);
+    }
+
+    /** Stores the first count < 4 lanes */
+    inline void store(mha_real_t * p, v4_t v, unsigned count) {
+        mha_real_t lanes[4];
+        store(lanes, v);
+        std::memcpy(p, lanes, count * sizeof(mha_real_t));
+    }
+
+    inline v4_t broadcast(mha_real_t x) {
+        return v4_t{x, x, x, x};
+    }
+
+    /** Sum of the four lanes */
+    inline mha_real_t sum(v4_t v) {
+        return (v[0] + v[1]) + (v[2] + v[3]);
+    }
+
+    inline v4_t min(v4_t a, v4_t b) {
+        return a < b ? a : b;
+    }
+
+    inline v4_t max(v4_t a, v4_t b) {
+        return a > b ? a : b;
+    }
+
+    /** Natural exponential of four values.
+     *
+     * Range reduction to \f$x = n \ln 2 + r\f$, \f$|r| \le \ln(2)/2\f$,
+     * with a degree 6 polynomial for \f$e^r\f$ (Cephes expf) and the
+     * factor \f$2^n\f$ built in the exponent bits.  The relative error
+     * is below \f$2 \cdot 10^{-7}\f$.  Arguments are limited to
+     * [-87.3, 88.7], so the result is a normal number: very small
+     * arguments give about \f$10^{-38}\f$ instead of 0, very large
+     * ones about \f$3 \cdot 10^{38}\f$ instead of infinity.  NaN
+     * arguments give unspecified results.
+     */
+    inline v4_t exp(v4_t x) {
+        x = max(min(x, broadcast(88.7f)), broadcast(-87.3f));
+        // round x/ln(2) to the nearest integer n
+        const v4_t shifter = broadcast(12582912.0f); // 1.5 * 2^23
+        const v4_t n = (x * 1.44269504088896341f + shifter) - shifter;
+        x -= n * 0.693359375f;
+        x -= n * -2.12194440e-4f;
+        v4_t p = 1.9875691500e-4f * x + 1.3981999507e-3f;
+        p = p * x + 8.3334519073e-3f;
+        p = p * x + 4.1665795894e-2f;
+        p = p * x + 1.6666665459e-1f;
+        p = p * x + 5.0000001201e-1f;
+        p = p * x * x + x + 1.0f;
+        // 2^n, n in [-126, 128], the largest n is scaled in two steps
+        v4i_t e = __builtin_convertvector(n, v4i_t);
+        const v4i_t large = e > 127;
+        e -= large & 1;
+        v4_t scale;
+        const v4i_t bits = (e + 127) << 23;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        p *= scale;
+        return large ? p + p : p;
+    }
+
+    /** Natural exponential of n values, y may be the same as x */
+    void exp(const mha_real_t * x, mha_real_t * y, unsigned n);
+
+    /** Natural logarithm of four values.
+     *
+     * Splits \f$x = m \cdot 2^e\f$ with \f$\sqrt{0.5} \le m < \sqrt{2}\f$
+     * and evaluates a degree 9 polynomial for \f$\ln(m)\f$ (Cephes
+     * logf).  The absolute error is below \f$10^{-7}\f$ for \f$x\f$
+     * near 1, the relative error below \f$2 \cdot 10^{-7}\f$ elsewhere.
+     * Subnormal arguments are supported, 0 gives -infinity, negative
+     * arguments and NaN give NaN and infinity gives infinity.
+     */
+    inline v4_t log(v4_t x) {
+        const v4_t x_in = x;
+        // scale subnormal numbers into the normal range
+        const v4i_t subnormal = x < std::numeric_limits<mha_real_t>::min();
+        x = subnormal ? x * 8388608.0f : x; // 2^23
+        v4i_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        // x = m * 2^e with m in [0.5, 1)
+        v4_t e = __builtin_convertvector(((bits >> 23) & 0xff) - 126, v4_t);
+        e = subnormal ? e - 23.0f : e;
+        bits = (bits & 0x007fffff) | 0x3f000000;
+        v4_t m;
+        std::memcpy(&m, &bits, sizeof(m));
+        const v4i_t below = m < 0.707106781186547524f;
+        e = below ? e - 1.0f : e;
+        m = (below ? m + m : m) - 1.0f;
+        const v4_t z = m * m;
+        v4_t p = 7.0376836292e-2f * m - 1.1514610310e-1f;
+        p = p * m + 1.1676998740e-1f;
+        p = p * m - 1.2420140846e-1f;
+        p = p * m + 1.4249322787e-1f;
+        p = p * m - 1.6668057665e-1f;
+        p = p * m + 2.0000714765e-1f;
+        p = p * m - 2.4999993993e-1f;
+        p = p * m + 3.3333331174e-1f;
+        v4_t y = p * m * z;
+        y += -2.12194440e-4f * e;
+        y += -0.5f * z;
+        y = m + y + 0.693359375f * e;
+        const mha_real_t inf = std::numeric_limits<mha_real_t>::infinity();
+        y = x_in == inf ? broadcast(inf) : y;
+        y = x_in == 0.0f ? broadcast(-inf) : y;
+        return x_in >= 0.0f ? y : broadcast(std::numeric_limits<mha_real_t>::quiet_NaN());
+    }
+
+    /** Natural logarithm of n values, y may be the same as x */
+    void log(const mha_real_t * x, mha_real_t * y, unsigned n);
+
+    /** Replaces infinite, NaN and subnormal values by 0, the four-lane
+     * variant of MHAFilter::make_friendly_number */
+    inline v4_t make_friendly_number(v4_t x) {
+        const v4_t a = x < 0.0f ? -x : x;
+        return (a >= std::numeric_limits<mha_real_t>::min()) &
+            (a <= std::numeric_limits<mha_real_t>::max()) ? x : broadcast(0.0f);
+    }
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make -C .."
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,63 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares MHASimd::exp and MHASimd::log with std::exp and std::log.
+
+#include "mha_simd.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+    const unsigned n = 1026, blocks = 100000;
+    std::vector<mha_real_t> x(n), y(n);
+    for (unsigned k = 0; k < n; ++k)
+        x[k] = std::sin(0.1f * k) * 20.0f;
+    auto measure = [&](auto && process) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned b = 0; b < blocks; ++b)
+            process();
+        std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        return t.count() / blocks * 1e6;
+    };
+    const double t_std = measure([&]{
+        for (unsigned k = 0; k < n; ++k)
+            y[k] = std::exp(x[k]);
+    });
+    const double t_simd = measure([&]{MHASimd::exp(x.data(), y.data(), n);});
+    std::cout << n << " values: std::exp " << t_std << " us, MHASimd::exp "
+              << t_simd << " us (speedup " << t_std / t_simd << ")" << std::endl;
+    for (unsigned k = 0; k < n; ++k)
+        x[k] = std::exp(x[k]);
+    const double t_std_log = measure([&]{
+        for (unsigned k = 0; k < n; ++k)
+            y[k] = std::log(x[k]);
+    });
+    const double t_simd_log = measure([&]{MHASimd::log(x.data(), y.data(), n);});
+    std::cout << n << " values: std::log " << t_std_log << " us, MHASimd::log "
+              << t_simd_log << " us (speedup " << t_std_log / t_simd_log << ")"
+              << std::endl;
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make -C .. benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
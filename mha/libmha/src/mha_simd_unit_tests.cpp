@@ -0,0 +1,130 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "mha_simd.hh"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+TEST(MHASimd, exp_has_single_precision_accuracy)
+{
+    double max_rel_err = 0;
+    for (double x = -87.0; x <= 88.5; x += 0.0137) {
+        const MHASimd::v4_t y = MHASimd::exp(MHASimd::v4_t{float(x), float(-x / 3),
+                                                          float(x / 100), 0.0f});
+        max_rel_err = std::max(max_rel_err, std::abs(y[0] / std::exp(double(float(x))) - 1));
+        max_rel_err = std::max(max_rel_err, std::abs(y[1] / std::exp(double(float(-x / 3))) - 1));
+        max_rel_err = std::max(max_rel_err, std::abs(y[2] / std::exp(double(float(x / 100))) - 1));
+        EXPECT_EQ(1.0f, y[3]);
+    }
+    EXPECT_LT(max_rel_err, 2e-7);
+}
+
+TEST(MHASimd, exp_saturates_to_normal_numbers)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const MHASimd::v4_t y = MHASimd::exp(MHASimd::v4_t{-inf, -1000.0f, 1000.0f, inf});
+    for (unsigned k = 0; k < 2; ++k) {
+        EXPECT_GE(y[k], std::numeric_limits<float>::min());
+        EXPECT_LT(y[k], 2e-38f);
+    }
+    for (unsigned k = 2; k < 4; ++k) {
+        EXPECT_LE(y[k], std::numeric_limits<float>::max());
+        EXPECT_GT(y[k], 3e38f);
+    }
+}
+
+TEST(MHASimd, exp_of_arrays_handles_incomplete_vectors)
+{
+    for (unsigned n : {0U, 1U, 4U, 7U, 9U}) {
+        std::vector<mha_real_t> x(n + 1, 42.0f), y(n + 1, -1.0f);
+        for (unsigned k = 0; k < n; ++k)
+            x[k] = 0.5f * k - 2.0f;
+        MHASimd::exp(x.data(), y.data(), n);
+        for (unsigned k = 0; k < n; ++k)
+            EXPECT_NEAR(std::exp(x[k]), y[k], 1e-6f * std::exp(x[k]));
+        EXPECT_EQ(-1.0f, y[n]);
+        // in place
+        MHASimd::exp(x.data(), x.data(), n);
+        for (unsigned k = 0; k < n; ++k)
+            EXPECT_EQ(y[k], x[k]);
+    }
+}
+
+TEST(MHASimd, log_has_single_precision_accuracy)
+{
+    double max_err = 0;
+    for (double x = 1e-30; x < 1e30; x *= 1.0137) {
+        for (float y : {float(x), 1.0f + float(1.0 / x)}) {
+            const double err = MHASimd::log(MHASimd::broadcast(y))[0] - std::log(double(y));
+            // absolute error near 1, relative error elsewhere
+            max_err = std::max(max_err, std::abs(err) /
+                               std::max(1.0, std::abs(std::log(double(y)))));
+        }
+    }
+    EXPECT_LT(max_err, 2e-7);
+}
+
+TEST(MHASimd, log_of_special_values)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const float denorm = std::numeric_limits<float>::denorm_min();
+    MHASimd::v4_t y = MHASimd::log(MHASimd::v4_t{0.0f, inf, denorm, 1.0f});
+    EXPECT_EQ(-inf, y[0]);
+    EXPECT_EQ(inf, y[1]);
+    EXPECT_NEAR(std::log(double(denorm)), y[2], 1e-5);
+    EXPECT_EQ(0.0f, y[3]);
+    y = MHASimd::log(MHASimd::v4_t{-1.0f, -inf, std::nanf(""), 3e-39f});
+    EXPECT_TRUE(std::isnan(y[0]));
+    EXPECT_TRUE(std::isnan(y[1]));
+    EXPECT_TRUE(std::isnan(y[2]));
+    EXPECT_NEAR(std::log(3e-39), y[3], 1e-5);
+}
+
+TEST(MHASimd, log_of_arrays_handles_incomplete_vectors)
+{
+    for (unsigned n : {0U, 1U, 4U, 7U, 9U}) {
+        std::vector<mha_real_t> x(n + 1, 42.0f), y(n + 1, -1.0f);
+        for (unsigned k = 0; k < n; ++k)
+            x[k] = 0.5f * k + 0.25f;
+        MHASimd::log(x.data(), y.data(), n);
+        for (unsigned k = 0; k < n; ++k)
+            EXPECT_NEAR(std::log(x[k]), y[k], 2e-7f * std::max(1.0f, std::abs(y[k])));
+        EXPECT_EQ(-1.0f, y[n]);
+    }
+}
+
+TEST(MHASimd, make_friendly_number_replaces_non_normal_values)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const float min = std::numeric_limits<float>::min();
+    MHASimd::v4_t y = MHASimd::make_friendly_number(
+        MHASimd::v4_t{inf, -inf, std::nanf(""), min / 4});
+    for (unsigned k = 0; k < 4; ++k)
+        EXPECT_EQ(0.0f, y[k]) << k;
+    y = MHASimd::make_friendly_number(MHASimd::v4_t{-min / 4, min, -3e38f, 0.0f});
+    EXPECT_EQ(0.0f, y[0]);
+    EXPECT_EQ(min, y[1]);
+    EXPECT_EQ(-3e38f, y[2]);
+    EXPECT_EQ(0.0f, y[3]);
+}
+
+// Local Variables:
+// compile-command: "make -C .. unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2009 2013 2016 2017 2018 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -251,6 +252,77 @@ void linear_table_t::clear(void)
     vec_y.clear();
 }
 
+unsigned int uniform_grid_table_t::add_band(const std::vector<mha_real_t>& y,
+                                            mha_real_t xmin,
+                                            mha_real_t xstep)
+{
+    if( !(xstep > 0) )
+        throw MHA_ErrorMsg("invalid x range");
+    if( y.size() < 2 )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "The table is empty.");
+    voffset.push_back(vy.size());
+    vxmin.push_back(xmin);
+    vscale.push_back(1.0f / xstep);
+    vmaxseg.push_back(y.size() - 2);
+    for(unsigned int k=0;k<y.size();k++){
+        vy.push_back(y[k]);
+        vslope.push_back((k+1 < y.size()) ? (y[k+1] - y[k]) : 0.0f);
+    }
+    return vxmin.size() - 1;
+}
+
+void uniform_grid_table_t::interp(const mha_real_t* x, mha_real_t* y) const
+{
+    const unsigned int n = vxmin.size();
+    for(unsigned int band=0;band<n;band++)
+        y[band] = interp(band,x[band]);
+}
+
+void uniform_grid_table_t::clear()
+{
+    vy.clear();
+    vslope.clear();
+    voffset.clear();
+    vxmin.clear();
+    vscale.clear();
+    vmaxseg.clear();
+}
+
+uniform_grid_table2d_t::uniform_grid_table2d_t(const std::vector<std::vector<mha_real_t> >& z,
+                                               mha_real_t xmin_,
+                                               mha_real_t xstep,
+                                               mha_real_t ymin_,
+                                               mha_real_t ystep)
+    : ny(z.size() ? z[0].size() : 0),
+      xmin(xmin_),
+      xscale(1.0f / xstep),
+      maxsegx(z.size() - 2.0f),
+      ymin(ymin_),
+      yscale(1.0f / ystep),
+      maxsegy(ny - 2.0f)
+{
+    if( !(xstep > 0) || !(ystep > 0) )
+        throw MHA_ErrorMsg("invalid x or y range");
+    if( (z.size() < 2) || (ny < 2) )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "At least 2x2 mesh points are required (got %zux%u).",
+                        z.size(),ny);
+    for(unsigned int kx=0;kx<z.size();kx++){
+        if( z[kx].size() != ny )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Mismatching row length (row %u has %zu entries, expected %u).",
+                            kx,z[kx].size(),ny);
+        vz.insert(vz.end(),z[kx].begin(),z[kx].end());
+    }
+}
+
+void uniform_grid_table2d_t::interp(const mha_real_t* x, const mha_real_t* y,
+                                    mha_real_t* z, unsigned int n) const
+{
+    for(unsigned int k=0;k<n;k++)
+        z[k] = interp(x[k],y[k]);
+}
 
 // Local Variables:
 // compile-command: "make -C .."
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2013 2016 2017 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -18,6 +19,8 @@
 
 #include <vector>
 #include <map>
+#include <cmath>
+#include <algorithm>
 #include "mha.hh"
 
 #ifdef __cplusplus
@@ -141,6 +144,118 @@ namespace MHATableLookup {
         mha_real_t scalefac;
     };
 
+    /** Set of linear interpolation tables with equidistant x values,
+        one table for each band.
+
+        The mesh points of all bands are stored in one contiguous
+        array, together with the slope of each segment.  The segment
+        index is computed directly from x, clamped to the valid range
+        without branches, so that values outside of the mesh range are
+        extrapolated from the two nearest mesh points like in
+        linear_table_t::interp.  Interpolating one value for every band
+        is a single loop over bands without data dependent branches.
+
+        Bands are added with add_band() when not processing signal,
+        lookup methods are real-time safe.
+     */
+    class uniform_grid_table_t {
+    public:
+        /** Append a band to the table.
+         * @param y Values at the mesh points, at least two entries.
+         * @param xmin x value of the first mesh point.
+         * @param xstep x distance between mesh points, must be positive.
+         * @return Index of the new band. */
+        unsigned int add_band(const std::vector<mha_real_t>& y,
+                              mha_real_t xmin,
+                              mha_real_t xstep);
+
+        /** Interpolate the value of one band.
+         * @param band Index of the band, not checked.
+         * @param x Position where to interpolate. */
+        mha_real_t interp(unsigned int band, mha_real_t x) const
+        {
+            const mha_real_t ind = (x - vxmin[band]) * vscale[band];
+            const mha_real_t seg = std::max(0.0f,std::min(std::floor(ind),
+                                                          vmaxseg[band]));
+            const unsigned int idx = voffset[band] + (unsigned int)seg;
+            return vy[idx] + (ind - seg) * vslope[idx];
+        }
+
+        /** Interpolate one value for every band.
+         * @param x Positions, one for each band.
+         * @param y Output values, one for each band. */
+        void interp(const mha_real_t* x, mha_real_t* y) const;
+
+        /** Number of bands in the table. */
+        unsigned int nbands() const {return vxmin.size();}
+
+        /** Remove all bands. */
+        void clear();
+    private:
+        /** Mesh point values of all bands, concatenated. */
+        std::vector<mha_real_t> vy;
+        /** Slopes between mesh points vy[k] and vy[k+1]. */
+        std::vector<mha_real_t> vslope;
+        /** Index of the first mesh point of each band in vy. */
+        std::vector<unsigned int> voffset;
+        /** x value of the first mesh point of each band. */
+        std::vector<mha_real_t> vxmin;
+        /** Inverse mesh distance of each band. */
+        std::vector<mha_real_t> vscale;
+        /** Index of the last segment of each band (mesh points - 2). */
+        std::vector<mha_real_t> vmaxseg;
+    };
+
+    /** Bilinear interpolation table with equidistant mesh points in
+        both dimensions, e.g. gains over frequency and input level.
+
+        Indices are computed directly from x and y and clamped without
+        branches, values outside of the mesh are extrapolated linearly
+        from the nearest mesh cell.
+     */
+    class uniform_grid_table2d_t {
+    public:
+        /** Constructor.
+         * @param z Values at the mesh points, z[kx][ky], at least two rows
+         *          with identical length of at least two entries.
+         * @param xmin x value of the first row.
+         * @param xstep x distance between rows, must be positive.
+         * @param ymin y value of the first column.
+         * @param ystep y distance between columns, must be positive. */
+        uniform_grid_table2d_t(const std::vector<std::vector<mha_real_t> >& z,
+                               mha_real_t xmin, mha_real_t xstep,
+                               mha_real_t ymin, mha_real_t ystep);
+
+        /** Interpolate at position (x,y). */
+        mha_real_t interp(mha_real_t x, mha_real_t y) const
+        {
+            const mha_real_t ix = (x - xmin) * xscale;
+            const mha_real_t iy = (y - ymin) * yscale;
+            const mha_real_t sx = std::max(0.0f,std::min(std::floor(ix),maxsegx));
+            const mha_real_t sy = std::max(0.0f,std::min(std::floor(iy),maxsegy));
+            const mha_real_t fx = ix - sx;
+            const mha_real_t fy = iy - sy;
+            const mha_real_t* z0 = vz.data() + (unsigned int)sx * ny + (unsigned int)sy;
+            const mha_real_t* z1 = z0 + ny;
+            const mha_real_t zy0 = z0[0] + (z1[0] - z0[0]) * fx;
+            const mha_real_t zy1 = z0[1] + (z1[1] - z0[1]) * fx;
+            return zy0 + (zy1 - zy0) * fy;
+        }
+
+        /** Interpolate n values at positions (x[k],y[k]).
+         * @param x First coordinates.
+         * @param y Second coordinates.
+         * @param z Output values.
+         * @param n Number of values. */
+        void interp(const mha_real_t* x, const mha_real_t* y,
+                    mha_real_t* z, unsigned int n) const;
+    private:
+        std::vector<mha_real_t> vz;
+        unsigned int ny;
+        mha_real_t xmin, xscale, maxsegx;
+        mha_real_t ymin, yscale, maxsegy;
+    };
+
     /** 
         \brief Class for interpolation with non-equidistant x values
         
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2017 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -14,6 +15,7 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mha_tablelookup.hh"
+#include "mha_error.hh"
 #include <gtest/gtest.h>
 #include <math.h>
 // Test linear interpolation between 3 mesh points
@@ -132,6 +134,76 @@ TEST_F(MHATableLookup_linear_table, table_extrapolates) {
   EXPECT_FLOAT_EQ(  50.0f,  t.lookup(128));
 }
 
+// The uniform grid table has to produce the same values as a
+// linear_table_t with the same mesh, including extrapolation
+TEST_F(MHATableLookup_linear_table, uniform_grid_table_matches) {
+  MHATableLookup::uniform_grid_table_t u;
+  std::vector<float> y0 = {points[0].y, points[1].y, points[2].y};
+  std::vector<float> y1 = {1, 2};
+  EXPECT_EQ(0U, u.add_band(y0,100,7));
+  EXPECT_EQ(1U, u.add_band(y1,0,1));
+  EXPECT_EQ(2U, u.nbands());
+  for (float x = 80.0f; x < 140.0f; x += 0.25f)
+    EXPECT_NEAR(t.interp(x), u.interp(0,x), 1e-4f) << "x=" << x;
+  EXPECT_FLOAT_EQ(-1.0f, u.interp(1,-2.0f));
+  EXPECT_FLOAT_EQ(1.5f, u.interp(1,0.5f));
+  EXPECT_FLOAT_EQ(5.0f, u.interp(1,4.0f));
+  // batch interpolation over all bands
+  float x[2] = {103.5f, 3.0f};
+  float y[2] = {0.0f, 0.0f};
+  u.interp(x,y);
+  EXPECT_FLOAT_EQ(50.0f, y[0]);
+  EXPECT_FLOAT_EQ(4.0f, y[1]);
+  u.clear();
+  EXPECT_EQ(0U, u.nbands());
+}
+
+TEST(uniform_grid_table_t, rejects_invalid_bands) {
+  MHATableLookup::uniform_grid_table_t u;
+  std::vector<float> y1 = {1}, y2 = {1, 2};
+  EXPECT_THROW(u.add_band(y1,0,1), MHA_Error);
+  EXPECT_THROW(u.add_band(y2,0,0), MHA_Error);
+  EXPECT_THROW(u.add_band(y2,0,-1), MHA_Error);
+  EXPECT_EQ(0U, u.nbands());
+}
+
+TEST(uniform_grid_table2d_t, bilinear_interpolation_and_extrapolation) {
+  // z = 2x + 3y + xy is reproduced exactly by bilinear interpolation
+  // inside each cell, and by extrapolation from the border cells
+  std::vector<std::vector<float> > z(4,std::vector<float>(5));
+  for (unsigned kx = 0; kx < 4; ++kx)
+    for (unsigned ky = 0; ky < 5; ++ky) {
+      float x = 1.0f + 0.5f * kx, y = -10.0f + 5.0f * ky;
+      z[kx][ky] = 2*x + 3*y + x*y;
+    }
+  MHATableLookup::uniform_grid_table2d_t t(z, 1.0f, 0.5f, -10.0f, 5.0f);
+  auto f = [](float x, float y){return 2*x + 3*y + x*y;};
+  for (float x : {1.0f, 1.2f, 1.75f, 2.5f})
+    for (float y : {-10.0f, -3.0f, 0.0f, 7.5f, 10.0f})
+      EXPECT_NEAR(f(x,y), t.interp(x,y), 1e-4f) << x << "," << y;
+  // outside: linear extrapolation along the border cell
+  EXPECT_NEAR(f(0.5f,-10.0f), t.interp(0.5f,-10.0f), 1e-4f);
+  EXPECT_NEAR(f(1.0f,20.0f), t.interp(1.0f,20.0f), 1e-4f);
+  float x[2] = {1.2f, 2.5f}, y[2] = {0.0f, 10.0f}, out[2];
+  t.interp(x,y,out,2);
+  EXPECT_NEAR(f(1.2f,0.0f), out[0], 1e-4f);
+  EXPECT_NEAR(f(2.5f,10.0f), out[1], 1e-4f);
+}
+
+TEST(uniform_grid_table2d_t, rejects_invalid_mesh) {
+  using MHATableLookup::uniform_grid_table2d_t;
+  std::vector<std::vector<float> > z22 = {{1,2},{3,4}};
+  std::vector<std::vector<float> > z12 = {{1,2}};
+  std::vector<std::vector<float> > z21 = {{1},{2}};
+  std::vector<std::vector<float> > ragged = {{1,2},{3}};
+  EXPECT_THROW(uniform_grid_table2d_t(z12,0,1,0,1), MHA_Error);
+  EXPECT_THROW(uniform_grid_table2d_t(z21,0,1,0,1), MHA_Error);
+  EXPECT_THROW(uniform_grid_table2d_t(ragged,0,1,0,1), MHA_Error);
+  EXPECT_THROW(uniform_grid_table2d_t(z22,0,0,0,1), MHA_Error);
+  EXPECT_THROW(uniform_grid_table2d_t(z22,0,1,0,-1), MHA_Error);
+  EXPECT_NO_THROW(uniform_grid_table2d_t(z22,0,1,0,1));
+}
+
 // =================================================
 
 // Older tests translated from cppunit to googletest
@@ -0,0 +1,408 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2018 2019 2020 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_plugin.hh"
+#include "mha_os.h"
+#include "mha_events.h"
+#include "mha_defs.h"
+#include "mha_fifo.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#include "lsl_cpp.h"
+#pragma GCC diagnostic pop
+
+#include <memory>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+/** All types for the ac2lsl plugins live in this namespace. */
+namespace ac2lsl{
+
+    struct type_info{
+        const std::string name;
+        const lsl::channel_format_t format;
+    };
+
+    const std::map<int, type_info>
+    types={
+        {MHA_AC_INT,{"MHA_AC_INT",lsl::cf_int32}},
+        {MHA_AC_FLOAT,{"MHA_AC_FLOAT",lsl::cf_float32}},
+        {MHA_AC_DOUBLE,{"MHA_AC_DOUBLE",lsl::cf_double64}},
+        {MHA_AC_MHAREAL,{"MHA_AC_MHAREAL",lsl::cf_float32}},
+        {MHA_AC_MHACOMPLEX,{"MHA_AC_MHACOMPLEX",lsl::cf_float32}}
+    };
+
+    /** Lock-free buffer for frames of one AC variable that are copied by
+     * the processing thread and pushed to LSL by the send thread.
+     * @tparam T Type of the values sent to LSL. */
+    template<typename T>
+    class send_buffer_t {
+    public:
+        /** Allocate the buffer.
+         * @param capacity Maximum number of buffered values. */
+        explicit send_buffer_t(unsigned capacity)
+            : values(capacity), frames(capacity), sendbuf(capacity)
+        {}
+        /** Copy one frame into the buffer.  Called by the processing thread.
+         * Real-time safe.
+         * @param data Values of the frame.
+         * @param count Number of values.
+         * @param timestamp LSL time of the frame.
+         * @return false if the frame was discarded because the buffer is
+         *         full. */
+        bool store(const T* data, unsigned count, double timestamp) {
+            if (values.get_available_space() < count ||
+                frames.get_available_space() < 1U)
+                return false;
+            values.write(data, count);
+            const frame_t frame = {count, timestamp};
+            frames.write(&frame, 1U);
+            return true;
+        }
+        /** Push all buffered frames to an LSL outlet.  Called by the send
+         * thread.  Streams with nominal rate receive all frames in one
+         * chunk stamped with the time of the last frame, LSL derives the
+         * timestamps of earlier samples.  Streams with irregular rate
+         * receive one chunk per frame with its own timestamp.  Transmission
+         * is triggered only once per call.
+         * @tparam outlet_t lsl::stream_outlet, or a replacement in tests.
+         * @param stream The LSL outlet.
+         * @param nominal_rate Whether the stream has a nominal rate. */
+        template<typename outlet_t>
+        void send(outlet_t& stream, bool nominal_rate) {
+            const unsigned count = frames.get_fill_count();
+            unsigned batch = 0U;
+            frame_t frame = {0U, 0.0};
+            for (unsigned k = 0U; k < count; ++k) {
+                frames.read(&frame, 1U);
+                if (!nominal_rate)
+                    batch = 0U;
+                values.read(sendbuf.data() + batch, frame.count);
+                batch += frame.count;
+                if (!nominal_rate)
+                    stream.push_chunk_multiplexed(sendbuf.data(), batch,
+                                                  frame.timestamp,
+                                                  k + 1U == count);
+            }
+            if (nominal_rate && batch)
+                stream.push_chunk_multiplexed(sendbuf.data(), batch,
+                                              frame.timestamp, true);
+        }
+    private:
+        /** Number of values and timestamp of one buffered frame */
+        struct frame_t {
+            unsigned count;
+            double timestamp;
+        };
+        /** Values of all buffered frames */
+        mha_fifo_lf_t<T> values;
+        /** Sizes and timestamps of the buffered frames */
+        mha_fifo_lf_t<frame_t> frames;
+        /** Contiguous copy of the frames sent in one batch */
+        std::vector<T> sendbuf;
+    };
+
+    /** Interface for ac to lsl bridge variable*/
+    class save_var_base_t{
+    public:
+        virtual void send_frame(unsigned num_entries)=0;
+        /** Copy a frame into the send buffer for the send thread.
+         * Real-time safe.  Only valid if created with a send buffer.
+         * @param data Data buffer of the ac variable
+         * @param num_entries Number of entries in the ac variable
+         * @param timestamp LSL time of the frame
+         * @return false if the frame was discarded because the send
+         *         buffer is full. */
+        virtual bool store_frame(const void* data, unsigned num_entries,
+                                 double timestamp)=0;
+        /** Push all frames in the send buffer to LSL.  Called by the send
+         * thread. */
+        virtual void send_stored()=0;
+        /** Number of channels of the ac variable (stride, at least 1) */
+        virtual unsigned num_channels() const noexcept = 0;
+        virtual void* get_buf_address() const noexcept = 0;
+        virtual void set_buf_address(void* data) = 0;
+        virtual lsl::stream_info info() const noexcept = 0;
+        virtual unsigned data_type() const noexcept = 0;
+        virtual ~save_var_base_t()=default;
+    };
+
+    /** Implementation for all ac to lsl bridges except complex types. */
+    template<typename T>
+    class save_var_t : public save_var_base_t {
+    public:
+        /** C'tor of generic ac to lsl bridge.
+         * @param info LSL stream info object containing metadata
+         * @param data Pointer to data buffer of the ac variable
+         * @param data_type Type id of the stream, in mha convention.
+         Should be set to one if not a vector.
+         * @param fifolen Capacity of the send buffer in values, 0 for
+         *                sending from the processing thread.
+        */
+        save_var_t(const std::string& name_,const std::string& type_, unsigned num_channels_,
+                   const mha_real_t rate_, const lsl::channel_format_t format_, const std::string& source_id_,
+                   void* data_, const unsigned data_type_, unsigned fifolen = 0):
+            stream(lsl::stream_info(name_, type_, num_channels_, rate_, format_, source_id_)),
+            //AC variables hold the addresses as void ptr, we find out the type from
+            //metadata and call templated constructor.
+            buf(static_cast<T*>(data_)),
+            data_type_(data_type_),
+            channels(num_channels_),
+            nominal_rate(rate_ > 0),
+            sendbuffer(fifolen ? std::make_unique<send_buffer_t<T>>(fifolen)
+                       : nullptr)
+        {};
+        /** Get buffer address as void pointer
+         * @returns Adress of the data buffer
+         */
+        virtual void* get_buf_address() const noexcept override {
+            return static_cast<void*>(buf);
+        };
+        /** Cast the input pointer to the appropriate type and set the buffer address
+         * @param data New buffer address
+         */
+        virtual void set_buf_address(void* data) override {
+            buf=static_cast<decltype(buf)>(data);
+        };
+        /** Get stream info object from stream outlet */
+        virtual lsl::stream_info info() const noexcept override {
+            return stream.info();
+        };
+        /** Get data type id according MHA convention*/
+        virtual unsigned data_type() const noexcept override{
+            return data_type_;
+        }
+        virtual unsigned num_channels() const noexcept override {
+            return channels;
+        }
+        virtual ~save_var_t()=default;
+        /** Send a frame to lsl. */
+        virtual void send_frame(unsigned num_entries) override {stream.push_chunk_multiplexed(buf,num_entries);};
+        virtual bool store_frame(const void* data, unsigned num_entries,
+                                 double timestamp) override {
+            return sendbuffer->store(static_cast<const T*>(data),
+                                     num_entries, timestamp);
+        }
+        virtual void send_stored() override {
+            sendbuffer->send(stream, nominal_rate);
+        }
+    private:
+        /** LSL stream outlet. Interface to lsl */
+        lsl::stream_outlet stream;
+        /** Pointer to data buffer of the ac variable. */
+        T* buf;
+        /** Data type id according to MHA convention. */
+        const unsigned data_type_;
+        /** Number of channels of the ac variable */
+        const unsigned channels;
+        /** Whether the stream has a nominal sampling rate */
+        const bool nominal_rate;
+        /** Frames waiting for the send thread, nullptr if frames are sent
+         * from the processing thread. */
+        std::unique_ptr<send_buffer_t<T>> sendbuffer;
+    };
+
+
+    /** Template specialization of the ac2lsl bridge to take care of complex
+     * numbers. This specialization is needed because lsl does not support
+     * complex numbers.
+     * Order is [re(0), im(0), re(1), im(1), ....]
+     */
+    template<>
+    class save_var_t<mha_complex_t> : public save_var_base_t {
+    public:
+        /** C'tor of specialization for complex types.
+         * See generic c'tor for details. */
+        save_var_t(const std::string& name_,const std::string& type_, unsigned num_channels_,
+                   const mha_real_t rate_, const lsl::channel_format_t format_, const std::string& source_id_,
+                   void* data_, unsigned fifolen = 0):
+            stream(lsl::stream_info(name_, type_, num_channels_*2, rate_, format_, source_id_)),
+            //AC variables hold the addresses as void ptr, we find out the type from
+            //metadata and call templated constructor.
+            buf(static_cast<mha_complex_t*>(data_)),
+            channels(num_channels_),
+            nominal_rate(rate_ > 0),
+            sendbuffer(fifolen ?
+                       std::make_unique<send_buffer_t<mha_real_t>>(fifolen)
+                       : nullptr)
+        {};
+        virtual void* get_buf_address() const noexcept override {
+            return static_cast<void*>(buf);
+        };
+        virtual void set_buf_address(void* data) override {
+            buf=static_cast<mha_complex_t*>(data);
+        };
+        /** Get buffer address as void pointer
+         * @returns Adress of the data buffer
+         */
+        virtual lsl::stream_info info() const noexcept override {
+            return stream.info();
+        };
+        /** Cast the input pointer to the appropriate type and set the buffer address
+         * @param data New buffer address
+         */
+        virtual unsigned data_type() const noexcept override {
+            return MHA_AC_MHACOMPLEX;
+        }
+        virtual ~save_var_t()=default;
+        /** Send a frame of complex types.
+         * Complex numbers are stored as alternating real and imaginary parts.
+         * An array of complex numbers in memory can be reinterpreted as a
+         * vector of real numbers that correspond to real and imaginary parts.
+         * LSL does not support complex types directly. Send one vector
+         * containing {buf[0].re,buf[0].im,buf[1].re,buf[1].im,...} instead. */
+        virtual void send_frame(unsigned num_entries) override {
+            stream.push_chunk_multiplexed(&buf[0].re,num_entries*2);
+        };
+        /** Copy a frame of complex types into the send buffer as
+         * alternating real and imaginary parts. */
+        virtual bool store_frame(const void* data, unsigned num_entries,
+                                 double timestamp) override {
+            return sendbuffer->
+                store(&static_cast<const mha_complex_t*>(data)[0].re,
+                      num_entries*2, timestamp);
+        }
+        virtual void send_stored() override {
+            sendbuffer->send(stream, nominal_rate);
+        }
+        virtual unsigned num_channels() const noexcept override {
+            return channels;
+        }
+    private:
+        /** LSL stream outlet. Interface to lsl */
+        lsl::stream_outlet stream;
+        /** Pointer to data buffer of the ac variable. */
+        mha_complex_t* buf;
+        /** Number of complex channels of the ac variable */
+        const unsigned channels;
+        /** Whether the stream has a nominal sampling rate */
+        const bool nominal_rate;
+        /** Frames waiting for the send thread, nullptr if frames are sent
+         * from the processing thread. */
+        std::unique_ptr<send_buffer_t<mha_real_t>> sendbuffer;
+    };
+
+    /** Runtime configuration class of the ac2lsl plugin */
+    class cfg_t {
+        void create_or_replace_var(const std::string& name,
+                                   const MHA_AC::comm_var_t& v);
+        void check_and_send();
+        /** Copy the current values of all variables into their send
+         * buffers.  Used instead of check_and_send() in async mode. */
+        void check_and_store();
+        /** Main loop of the send thread. */
+        void send_thread();
+        /** Maps variable name to unique ptr's of ac to lsl bridges. */
+        std::map<std::string, std::unique_ptr<save_var_base_t>> varlist;
+        /** Counter of frames to skip */
+        unsigned skipcnt;
+        /** Number of frames to skip after each send */
+        const unsigned skip;
+        /** Sampling rate of the stream */
+        const double srate;
+        /** User configurable source id. */
+        const std::string source_id;
+        /** Handle to the ac space*/
+        const MHA_AC::algo_comm_t & ac;
+        /** Capacity of the send buffer of each variable in values, 0 if
+         * frames are sent from the processing thread. */
+        const unsigned fifolen;
+        /** Waiting time of the send thread between batches in ms */
+        const unsigned send_period_ms;
+        /** Number of frames discarded because a send buffer was full */
+        std::atomic<uint64_t> dropped;
+        /** Tells the send thread to terminate */
+        std::atomic<bool> stop_request;
+        /** Wakes up the send thread early when it has to terminate */
+        mha_fifo_wakeup_t wakeup;
+        /** Pushes the buffered frames to LSL in async mode */
+        std::thread sender;
+    public:
+
+        /** C'tor of ac2lsl run time configuration
+         * @param ac_         AC space, source of data to send over LSL
+         * @param skip_       Number of frames to skip after each send
+         * @param source_id_  LSL identifier for this data stream
+         * @param varnames_   Names of AC variables to send over LSL
+         * @param rate        Rate with wich chunks of data are sent to the LSL
+         *                    stream.  Usually the rate with which process calls
+         *                    happen, but may be lower due to the subsampling
+         *                    caused by skip_
+         * @param fifolen_    Capacity of the send buffer of each variable in
+         *                    values.  0: push to LSL from the processing
+         *                    thread.  Otherwise, the processing thread only
+         *                    copies the data, and a background thread pushes
+         *                    them to LSL.
+         * @param send_rate   Number of batched pushes per second of the
+         *                    background thread */
+        cfg_t(MHA_AC::algo_comm_t & ac_,
+              unsigned skip_,
+              const std::string& source_id,
+              const std::vector<std::string>& varnames_,
+              double rate,
+              unsigned fifolen_ = 0,
+              double send_rate = 100);
+        /** Terminates the send thread after pushing the remaining frames */
+        ~cfg_t();
+        void process();
+        /** Number of frames discarded because a send buffer was full */
+        uint64_t get_dropped() const {return dropped.load();}
+
+    };
+
+    /** Plugin class of ac2lsl */
+    class ac2lsl_t : public MHAPlugin::plugin_t<cfg_t>
+    {
+    public:
+        ac2lsl_t(MHA_AC::algo_comm_t & iac,
+                 const std::string & configured_name);
+        /** Prepare constructs the vector of bridge variables and locks
+         * the configuration, then calls update(). */
+        void prepare(mhaconfig_t&);
+        /** Processing fct for waveforms. Calls process(void). */
+        mha_wave_t* process(mha_wave_t* s) {process();return s;};
+        /** Processing fct for spectra. Calls process(void). */
+        mha_spec_t* process(mha_spec_t* s) {process();return s;};
+        /** Process function. Checks once if the plugin is run in a
+         * real-time thread and throws if rt_strict is true and async
+         * is false, then forwards to cfg_t::process(). */
+        void process();
+        /** Release fct. Unlocks variable name list, rt_strict and
+         * async */
+        void release();
+    private:
+        /** Construct new runtime configuration */
+        void update();
+        /** Copy the number of discarded frames to the monitor variable */
+        void update_dropped();
+        MHAParser::vstring_t vars;
+        MHAParser::string_t source_id;
+        MHAParser::bool_t rt_strict;
+        MHAParser::bool_t activate;
+        MHAParser::int_t skip;
+        MHAParser::float_t nominal_srate;
+        MHAParser::bool_t async;
+        MHAParser::int_t fifolen;
+        MHAParser::float_t send_rate;
+        MHAParser::int_mon_t dropped;
+        MHAEvents::patchbay_t<ac2lsl_t> patchbay;
+        bool is_first_run;
+    };
+}
@@ -0,0 +1,101 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ac2lsl.hh"
+#include <gtest/gtest.h>
+
+namespace {
+    /** Replaces the LSL outlet, records the pushed chunks */
+    struct outlet_t {
+        struct chunk_t {
+            std::vector<float> values;
+            double timestamp;
+            bool pushthrough;
+        };
+        template<typename T>
+        void push_chunk_multiplexed(const T* data, std::size_t count,
+                                    double timestamp, bool pushthrough) {
+            chunks.push_back({std::vector<float>(data, data + count),
+                              timestamp, pushthrough});
+        }
+        std::vector<chunk_t> chunks;
+    };
+
+    /** Store frames {k, k+1, k+2} with timestamp k for k = first..last,
+     * return the number of frames discarded because the buffer was full */
+    unsigned store_frames(ac2lsl::send_buffer_t<float>& buffer,
+                          unsigned first, unsigned last) {
+        unsigned dropped = 0U;
+        for (unsigned k = first; k <= last; ++k) {
+            const float frame[3] = {float(k), k + 1.0f, k + 2.0f};
+            if (not buffer.store(frame, 3U, k))
+                ++dropped;
+        }
+        return dropped;
+    }
+}
+
+TEST(send_buffer_t, discards_frames_that_do_not_fit)
+{
+    // Room for two frames of three values
+    ac2lsl::send_buffer_t<float> buffer(7U);
+    outlet_t outlet;
+    EXPECT_EQ(2U, store_frames(buffer, 1U, 4U));
+    buffer.send(outlet, true);
+    ASSERT_EQ(1U, outlet.chunks.size());
+    EXPECT_EQ((std::vector<float>{1, 2, 3, 2, 3, 4}), outlet.chunks[0].values);
+    // Sending frees the buffer for new frames
+    EXPECT_EQ(0U, store_frames(buffer, 5U, 6U));
+    EXPECT_EQ(1U, store_frames(buffer, 7U, 7U));
+}
+
+TEST(send_buffer_t, nominal_rate_sends_one_chunk_with_last_timestamp)
+{
+    ac2lsl::send_buffer_t<float> buffer(64U);
+    outlet_t outlet;
+    EXPECT_EQ(0U, store_frames(buffer, 1U, 3U));
+    buffer.send(outlet, true);
+    ASSERT_EQ(1U, outlet.chunks.size());
+    EXPECT_EQ((std::vector<float>{1, 2, 3, 2, 3, 4, 3, 4, 5}),
+              outlet.chunks[0].values);
+    EXPECT_EQ(3.0, outlet.chunks[0].timestamp);
+    EXPECT_TRUE(outlet.chunks[0].pushthrough);
+    // An empty buffer sends nothing
+    buffer.send(outlet, true);
+    EXPECT_EQ(1U, outlet.chunks.size());
+}
+
+TEST(send_buffer_t, irregular_rate_sends_each_frame_with_its_timestamp)
+{
+    ac2lsl::send_buffer_t<float> buffer(64U);
+    outlet_t outlet;
+    EXPECT_EQ(0U, store_frames(buffer, 1U, 3U));
+    buffer.send(outlet, false);
+    ASSERT_EQ(3U, outlet.chunks.size());
+    for (unsigned k = 0U; k < 3U; ++k) {
+        EXPECT_EQ((std::vector<float>{k + 1.0f, k + 2.0f, k + 3.0f}),
+                  outlet.chunks[k].values);
+        EXPECT_EQ(k + 1.0, outlet.chunks[k].timestamp);
+        // Transmission is triggered only after the last frame
+        EXPECT_EQ(k == 2U, outlet.chunks[k].pushthrough);
+    }
+}
+
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * compile-command: "make unit-tests"
+ * End:
+ */
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -16,6 +16,7 @@
 
 #include "acrec.hh"
 #include <ctime>
+#include <cstdio>
 #include <atomic>
 #include <vector>
 
@@ -39,27 +40,37 @@ acrec_t::acrec_t(MHA_AC::algo_comm_t & iac, const std::string & )
     insert_member(prefix);
     insert_member(use_date);
     insert_member(varname);
+    insert_member(varnames);
+    insert_member(fileformat);
+    insert_member(compress);
     insert_member(record);
+    insert_member(fifo_high_water);
+    insert_member(dropped_frames);
     patchbay.connect(&record.writeaccess,this,&acrec_t::start_new_session);
+    patchbay.connect(&fifo_high_water.prereadaccess,this,
+                     &acrec_t::update_monitors);
+    patchbay.connect(&dropped_frames.prereadaccess,this,
+                     &acrec_t::update_monitors);
 }
 
 template <class mha_signal_t> mha_signal_t* acrec_t::process(mha_signal_t* s)
 {
     poll_config();
-    cv = ac.get_var(cfg->get_varname());
-    cfg->process(&cv);
+    cfg->process(ac);
     return s;
 }
 
-void acrec_t::prepare(mhaconfig_t&)
+void acrec_t::prepare(mhaconfig_t& cf)
 {
     // Need to ensure there's a valid configuration after prepare()
     // If record has not been set, there is no configuration, so create one.
     // This can not cause spurious creation of new files because setting record
     // to true would have caused the creation of a new config.
-    if(!peek_config())
-        push_config(new acwriter_t(record.data, fifolen.data, minwrite.data,
-                                   prefix.data, use_date.data, varname.data));
+    auto latest_cfg=peek_config();
+    if(!latest_cfg)
+        push_config(create_writer());
+    else
+        latest_cfg->set_block_rate(cf.srate / cf.fragsize);
 }
 
 void acrec_t::release()
@@ -74,32 +85,77 @@ void acrec_t::start_new_session()
     auto latest_cfg=peek_config();
     if(latest_cfg)
         latest_cfg->exit_request();
-    push_config(new acwriter_t(record.data, fifolen.data, minwrite.data,
-                               prefix.data, use_date.data, varname.data));
+    push_config(create_writer());
+}
+
+void acrec_t::update_monitors()
+{
+    auto latest_cfg=peek_config();
+    if(latest_cfg){
+        fifo_high_water.data = latest_cfg->get_fifo_high_water();
+        dropped_frames.data = latest_cfg->get_dropped_frames();
+    }
+}
+
+acwriter_t* acrec_t::create_writer()
+{
+    const double block_rate =
+        is_prepared() ? input_cfg().srate / input_cfg().fragsize : 0.0;
+    return new acwriter_t(record.data, fifolen.data, minwrite.data,
+                          prefix.data, use_date.data,
+                          varnames.data.empty()
+                          ? std::vector<std::string>{varname.data}
+                          : varnames.data,
+                          fileformat.data.get_index() == 1,
+                          compress.data, block_rate);
 }
 
 void acwriter_t::create_datafile(const std::string& prefix, bool use_date)
 {
     std::string fname;
+    const std::string extension = mhrec ? ".mhrec" : ".dat";
     if( use_date ){
-        fname = prefix+"-"+to_iso8601(std::time(nullptr))+".dat";
+        fname = prefix+"-"+to_iso8601(std::time(nullptr))+extension;
     }
     else{
-        fname=prefix+".dat";
+        fname=prefix+extension;
     }
     outfile=std::fstream(fname, std::ios::out | std::ios::binary);
     if( !outfile.good() )
         throw MHA_Error(__FILE__,__LINE__,"Unable to create file %s.",fname.c_str());
+    if( mhrec ){
+        // The recording file is created by the writer thread when the
+        // first data arrive.  The file name is checked here, but an empty
+        // file would not be a valid recording file and is removed again.
+        outfile.close();
+        std::remove(fname.c_str());
+        recfilename = fname;
+    }
 }
 
 acwriter_t::acwriter_t(bool active,unsigned fifosize,unsigned minwrite,
                        const std::string& prefix, bool use_date,
-                       const std::string& varname)
+                       const std::vector<std::string>& varnames,
+                       bool mhrec, bool compress, double block_rate)
     : close_session(false),
       active(active),
       disk_write_threshold_min_num_samples(minwrite),
-      varname(varname)
+      fifo_high_water(0U),
+      dropped_frames(0U),
+      mhrec(mhrec),
+      compress(compress),
+      block_rate(block_rate),
+      session_start(std::chrono::steady_clock::now()),
+      vars(varnames.size()),
+      current(varnames.size()),
+      staging(varnames.size()),
+      varnames(varnames)
 {
+    if (varnames.size() > 1U && !mhrec)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Recording %zu AC variables into one file requires"
+                        " the MHA recording file format",
+                        varnames.size());
     if (active) {
         if (disk_write_threshold_min_num_samples >= fifosize) {
             throw MHA_Error(__FILE__,__LINE__,
@@ -116,78 +172,139 @@ acwriter_t::acwriter_t(bool active,unsigned fifosize,unsigned minwrite,
         // When inactive, sizes do not need to be checked, no output file,
         // no fifo, no disk buffer, and no thread needs to be created.
     }
-    // std::string implementations may allocate memory on first invocation
-    // of c_str() after a change.  Avoid allocation during processing:
-    (void)get_varname();
 }
 
-void acwriter_t::process(MHA_AC::comm_var_t* s)
+void acwriter_t::process(MHA_AC::algo_comm_t & ac)
 {
     if( active ) {
-        if (not is_num_channels_known) {
-            num_channels = s->stride;
-            is_complex = (s->data_type == MHA_AC_MHACOMPLEX);
-            is_num_channels_known = true;
-        }
-        if (num_channels != s->stride) {
-            throw MHA_Error(__FILE__,__LINE__,"Number of channels of AC"
-                            " variable %s has changed from %u to %u",
-                            get_varname().c_str(), num_channels, s->stride);
+        // Check all variables before pushing any data, so that the
+        // writer thread knows the layout of all variables once it has
+        // received the first record.
+        for (unsigned var = 0U; var < varnames.size(); ++var) {
+            current[var] = ac.get_var(varnames[var]);
+            check_var(var, current[var]);
         }
-        if (is_complex != (s->data_type == MHA_AC_MHACOMPLEX)) {
-            throw MHA_Error(__FILE__,__LINE__,"AC variable %s has changed from"
-                            " %s numeric type to %s numeric type",
-                            get_varname().c_str(),
-                            is_complex ? "complex" : "real",
-                            (s->data_type==MHA_AC_MHACOMPLEX)?"complex":"real");
-        }
-        // We save complex values as alternating real and imaginary part, i.e.
-        // each complex is stored as two values.
-        const unsigned complex_factor = is_complex ? 2U : 1U;
-        // Allow saving AC vars with stride zero, interpret as stride one.
-        const unsigned num_ch_effective =
-            std::max(num_channels, 1U) * complex_factor;
+        for (unsigned var = 0U; var < varnames.size(); ++var)
+            push_var(var, current[var]);
+        ++block;
+        const unsigned fill =
+            fifo->get_max_fill_count() - fifo->get_available_space();
+        if (fill > fifo_high_water.load(std::memory_order_relaxed))
+            fifo_high_water.store(fill, std::memory_order_relaxed);
+        if (fill > disk_write_threshold_min_num_samples)
+            wakeup.notify();
+    }
+}
+
+void acwriter_t::check_var(unsigned var, const MHA_AC::comm_var_t& s)
+{
+    var_state_t & state = vars[var];
+    if (not state.is_num_channels_known) {
+        state.num_channels = s.stride;
+        state.is_complex = (s.data_type == MHA_AC_MHACOMPLEX);
+        state.rows_per_block =
+            s.num_entries / std::max(state.num_channels, 1U);
+        state.is_num_channels_known = true;
+    }
+    if (state.num_channels != s.stride) {
+        throw MHA_Error(__FILE__,__LINE__,"Number of channels of AC"
+                        " variable %s has changed from %u to %u",
+                        varnames[var].c_str(), state.num_channels, s.stride);
+    }
+    if (state.is_complex != (s.data_type == MHA_AC_MHACOMPLEX)) {
+        throw MHA_Error(__FILE__,__LINE__,"AC variable %s has changed from"
+                        " %s numeric type to %s numeric type",
+                        varnames[var].c_str(),
+                        state.is_complex ? "complex" : "real",
+                        (s.data_type==MHA_AC_MHACOMPLEX)?"complex":"real");
+    }
+}
+
+void acwriter_t::push_var(unsigned var, const MHA_AC::comm_var_t& s)
+{
+    var_state_t & state = vars[var];
+    // We save complex values as alternating real and imaginary part, i.e.
+    // each complex is stored as two values.
+    const unsigned complex_factor = state.is_complex ? 2U : 1U;
+    const unsigned num_ch_effective = state.row_size();
+    if (!mhrec) {
         const unsigned number_of_values_to_push_to_fifo =
             std::min(fifo->get_available_space() / num_ch_effective
                      * num_ch_effective, // only write multiples of num_channels
-                     s->num_entries * complex_factor);
-        constexpr unsigned PUSH_ARRAY_SIZE = 32U;
-        static_assert(PUSH_ARRAY_SIZE % 2U == 0U,
-                      "Needs to be even for the complex numbers");
+                     s.num_entries * complex_factor);
+        write_values(s, number_of_values_to_push_to_fifo);
+        const unsigned dropped = (s.num_entries * complex_factor
+                                  - number_of_values_to_push_to_fifo)
+            / num_ch_effective;
+        if (dropped)
+            dropped_frames.fetch_add(dropped, std::memory_order_relaxed);
+        return;
+    }
+    const unsigned rows = s.num_entries * complex_factor / num_ch_effective;
+    if (rows == 0U)
+        return;
+    const unsigned values = rows * num_ch_effective;
+    // Records that do not fit completely are dropped.  The row counter
+    // still advances, so that the gap is visible in the recording file.
+    if (fifo->get_available_space() >= record_header_size + values) {
+        const output_type header[record_header_size] =
+            {static_cast<output_type>(var),
+             static_cast<output_type>(rows),
+             static_cast<output_type>(state.next_row),
+             static_cast<output_type>(block)};
+        fifo->write(header, record_header_size);
+        write_values(s, values);
+    }
+    else
+        dropped_frames.fetch_add(rows, std::memory_order_relaxed);
+    state.next_row += rows;
+}
 
-        output_type value_to_push[PUSH_ARRAY_SIZE];
-        for (unsigned index = 0;
-             index < number_of_values_to_push_to_fifo;
-             index += PUSH_ARRAY_SIZE) {
-            const unsigned num_values_to_copy =
-                std::min(PUSH_ARRAY_SIZE,
-                         number_of_values_to_push_to_fifo - index);
-            for (unsigned subindex = 0; subindex<num_values_to_copy; ++subindex)
-                switch (s->data_type) {
-                case MHA_AC_INT:
-                    value_to_push[subindex] =
-                        static_cast<int*>(s->data)[index + subindex];
-                    break;
-                case MHA_AC_FLOAT:
-                    value_to_push[subindex] =
-                        static_cast<float*>(s->data)[index + subindex];
-                    break;
-                case MHA_AC_DOUBLE:
-                    value_to_push[subindex] =
-                        static_cast<double*>(s->data)[index + subindex];
-                    break;
-                case MHA_AC_MHAREAL:
-                case MHA_AC_MHACOMPLEX: // alternating real and imag mha_real_t
-                    value_to_push[subindex] =
-                        static_cast<mha_real_t*>(s->data)[index + subindex];
-                    break;
-                default:
-                    throw MHA_Error(__FILE__,__LINE__,
-                                    "Data type not supported: %u",
-                                    s->data_type);
-                }
-            fifo->write(value_to_push, num_values_to_copy);
-        }
+void acwriter_t::write_values(const MHA_AC::comm_var_t& s, unsigned count)
+{
+    constexpr unsigned PUSH_ARRAY_SIZE = 32U;
+    static_assert(PUSH_ARRAY_SIZE % 2U == 0U,
+                  "Needs to be even for the complex numbers");
+
+    output_type value_to_push[PUSH_ARRAY_SIZE];
+    for (unsigned index = 0; index < count; index += PUSH_ARRAY_SIZE) {
+        const unsigned num_values_to_copy =
+            std::min(PUSH_ARRAY_SIZE, count - index);
+        for (unsigned subindex = 0; subindex<num_values_to_copy; ++subindex)
+            switch (s.data_type) {
+            case MHA_AC_INT:
+                value_to_push[subindex] =
+                    static_cast<int*>(s.data)[index + subindex];
+                break;
+            case MHA_AC_FLOAT:
+                value_to_push[subindex] =
+                    static_cast<float*>(s.data)[index + subindex];
+                break;
+            case MHA_AC_DOUBLE:
+                value_to_push[subindex] =
+                    static_cast<double*>(s.data)[index + subindex];
+                break;
+            case MHA_AC_MHAREAL:
+            case MHA_AC_MHACOMPLEX: // alternating real and imag mha_real_t
+                value_to_push[subindex] =
+                    static_cast<mha_real_t*>(s.data)[index + subindex];
+                break;
+            default:
+                throw MHA_Error(__FILE__,__LINE__,
+                                "Data type not supported: %u",
+                                s.data_type);
+            }
+        fifo->write(value_to_push, num_values_to_copy);
+    }
+}
+
+acwriter_t::~acwriter_t()
+{
+    try {
+        exit_request();
+    }
+    catch(MHA_Error&){
+        // Errors on closing the file cannot be reported from here.
     }
 }
 
@@ -195,8 +312,13 @@ void acwriter_t::exit_request(){
     if(!close_session.load()){
         close_session.store(true);
         if( active ){
+            wakeup.signal();
             writethread.join();
             outfile.close();
+            if( recfile ){
+                recfile->close();
+                recfile = nullptr;
+            }
             // Deallocate disk buffer.
             diskbuffer = nullptr;
             // We cannot deallocate the fifo here because process() may still
@@ -206,29 +328,106 @@ void acwriter_t::exit_request(){
     return;
 }
 
+void acwriter_t::flush()
+{
+    if (mhrec) {
+        flush_records();
+        return;
+    }
+    // Allow saving AC vars with stride zero, interpret as stride one.
+    unsigned num_ch_effective = vars[0].row_size();
+    unsigned frames = fifo->get_fill_count() / num_ch_effective;
+    if (frames == 0U)
+        return;
+    if (outfile.good()) {
+        fifo->read(diskbuffer.get(),frames*num_ch_effective);
+        outfile.write(reinterpret_cast<const char *>(diskbuffer.get()),
+                      frames*num_ch_effective*sizeof(output_type));
+    }
+}
+
+void acwriter_t::flush_records()
+{
+    for (;;) {
+        // The header of a record may become visible before its data
+        if (!have_pending_header) {
+            if (fifo->get_fill_count() < record_header_size)
+                break;
+            fifo->read(pending_header, record_header_size);
+            have_pending_header = true;
+        }
+        const unsigned var = static_cast<unsigned>(pending_header[0]);
+        const unsigned rows = static_cast<unsigned>(pending_header[1]);
+        const uint64_t first_row = static_cast<uint64_t>(pending_header[2]);
+        const unsigned values = rows * vars[var].row_size();
+        if (fifo->get_fill_count() < values)
+            break;
+        staging_t & st = staging[var];
+        const size_t staged = st.rows.size();
+        const size_t staged_rows = staged / vars[var].row_size();
+        if (staged_rows && st.first_row + staged_rows != first_row)
+            write_staged(var); // a gap starts a new block
+        if (st.rows.empty()) {
+            st.first_row = first_row;
+            st.first_block = static_cast<uint64_t>(pending_header[3]);
+        }
+        st.rows.resize(st.rows.size() + values);
+        fifo->read(st.rows.data() + st.rows.size() - values, values);
+        have_pending_header = false;
+    }
+    for (unsigned var = 0U; var < staging.size(); ++var)
+        write_staged(var);
+}
+
+void acwriter_t::write_staged(unsigned var)
+{
+    staging_t & st = staging[var];
+    if (st.rows.empty())
+        return;
+    const double rate = block_rate.load();
+    if (!recfile) {
+        std::vector<MHARecFile::stream_info_t> streams(varnames.size());
+        for (unsigned k = 0U; k < varnames.size(); ++k) {
+            streams[k].name = varnames[k];
+            streams[k].ndim = std::max(vars[k].num_channels, 1U);
+            streams[k].is_complex = vars[k].is_complex;
+            streams[k].rate = rate * vars[k].rows_per_block;
+        }
+        recfile = std::make_unique<MHARecFile::writer_t>(recfilename, streams,
+                                                         compress);
+    }
+    double timestamp;
+    if (rate > 0)
+        timestamp = st.first_block / rate;
+    else
+        timestamp = std::chrono::duration<double>
+            (std::chrono::steady_clock::now() - session_start).count();
+    recfile->write_block(var, st.first_row,
+                         st.rows.size() / vars[var].row_size(),
+                         timestamp, st.rows.data());
+    st.rows.clear();
+}
+
 void acwriter_t::write_thread()
 {
-    auto flush = // Writes fifo content to disk.
-        [&]()
-        {
-            // Allow saving AC vars with stride zero, interpret as stride one.
-            unsigned num_ch_effective =
-                std::max(num_channels, 1U) * (is_complex ? 2U : 1U);
-            unsigned frames = fifo->get_fill_count() / num_ch_effective;
-            if (outfile.good() && frames > 0U) {
-                fifo->read(diskbuffer.get(),frames*num_ch_effective);
-                outfile.write(reinterpret_cast<const char *>(diskbuffer.get()),
-                              frames*num_ch_effective*sizeof(output_type));
+    try {
+        while(!close_session.load()){
+            // Arm before checking, so that a notification from the
+            // processing thread between check and wait is not lost.
+            wakeup.arm();
+            if (fifo->get_fill_count() <= disk_write_threshold_min_num_samples
+                && !close_session.load())
+                wakeup.wait();
+            if (fifo->get_fill_count() > disk_write_threshold_min_num_samples) {
+                flush();
             }
-        };
-
-    while(!close_session.load()){
-        mha_msleep(1);
-        if (fifo->get_fill_count() > disk_write_threshold_min_num_samples) {
-            flush();
         }
+        flush();
+    }
+    catch (MHA_Error &) {
+        // Recording file cannot be written.  Stop writing; the fifo
+        // fills up and further data are discarded.
     }
-    flush();
 }
 
 MHAPLUGIN_CALLBACKS(acrec,acrec_t,wave,wave)
@@ -253,7 +452,28 @@ MHAPLUGIN_DOCUMENTATION\
  " Regardless of the data type of the AC variable, the data is converted to "
  " data type double and stored as binary data in host byte order.\n"
  " Complex data are stored storing real part and imaginary part consecutively."
- " No metadata is stored in the file.\n\n"
+ " With \"fileformat=dat\", no metadata is stored in the file.\n\n"
+ " With \"fileformat=mhrec\", the data are stored in the MHA recording file"
+ " format with file name extension \".mhrec\" instead, which contains the"
+ " variable name, the number of channels, and the numeric type, and can be"
+ " read with random access by the functions in"
+ " mha/tools/python/openMHA/mhrec.py and mha/tools/mfiles/mha\\_read\\_mhrec.m."
+ " Each row of the AC variable (one value per channel) is one frame of the"
+ " recording file, which is created when the first data arrive, so that a"
+ " session without process callbacks leaves no file behind."
+ " Each block of frames written to disk carries the index"
+ " of its first frame and the signal time in seconds since the start of the"
+ " recording session at which its first frame was recorded.  Frames that"
+ " had to be discarded leave a gap in the frame indices.  Setting"
+ " \"compress\" to yes compresses the blocks with a fast LZ-type"
+ " compression.\n\n"
+ " With \"fileformat=mhrec\", several AC variables can be recorded into the"
+ " same file by listing their names in \"varnames\", which takes precedence"
+ " over \"varname\".  Each variable is stored as a separate stream of the"
+ " recording file.  All variables share a single fifo and a single disk"
+ " writer thread, so that the number of threads and open files does not"
+ " grow with the number of recorded variables.  The fifo must be large"
+ " enough for the data of all variables.\n\n"
  " The AC variable may change the number of elements that it contains from"
  " one process call to the next, but its stride (e.g. number of channels or"
  " number of bins) must remain constant.\n\n"
@@ -262,7 +482,10 @@ MHAPLUGIN_DOCUMENTATION\
  " discarded before writing to disk continues.\n"
  " This may e.g. happen with slow disks like network drives or SD cards, or"
  " with very high data rates.\n\n"
- "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged.")
+ "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged."
+ " The disk writer thread sleeps until more than \"minwrite\" samples are waiting in the fifo."
+ " The monitor variables \"fifo\\_high\\_water\" and \"dropped\\_frames\" report the maximum fifo fill count"
+ " and the number of discarded rows of the current recording session.")
 
 /*
  * Local Variables:
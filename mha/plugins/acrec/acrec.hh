@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -17,8 +17,10 @@
 
 #include "mha_plugin.hh"
 #include "mha_fifo.h"
+#include "mha_recfile.hh"
 #include <thread>
 #include <fstream>
+#include <chrono>
 
 namespace plugins { namespace hoertech { namespace acrec {
 /// acwriter_t decouples signal processing from writing to disk.
@@ -26,15 +28,30 @@ namespace plugins { namespace hoertech { namespace acrec {
 /// placed into a fifo pipeline to transport the data from the signal
 /// processing thread to the disk writing thread, and finally written to
 /// disk in chunks of at least minwrite numbers.  All numbers are written to
-/// disk as binary doubles (8 bytes) in host byte order.
+/// disk as binary doubles (8 bytes) in host byte order, either as raw
+/// numbers without metadata (.dat, one AC variable only) or in the MHA
+/// recording file format (.mhrec, see MHARecFile).
+///
+/// Any number of AC variables can be recorded into one MHA recording file
+/// by a single writer thread.  All variables share one fifo, in which the
+/// data of each variable and process callback form one record: a header
+/// of record_header_size numbers (variable number, number of rows, index
+/// of the first row, index of the process callback) followed by the rows.
+/// The writer thread collects the rows of each variable and appends one
+/// block per variable and disk write to the file.
+///
+/// The writer thread sleeps until the processing thread notifies it that
+/// the fifo fill count has exceeded minwrite numbers.
 class acwriter_t {
 public:
     /// The numeric data type used for outputting the data to disk.
     typedef double output_type;
+    /// Number of fifo entries preceding the data of each record in the
+    /// MHA recording file format.
+    static constexpr unsigned record_header_size = 4U;
     /// Constructor allocates fifo and disk output buffer.  It spawns a new
-    /// thread for writing data to disk when active==true.  In order to
-    /// terminate the thread, method exit_request <b>must</b> be called
-    /// before this object is destroyed.
+    /// thread for writing data to disk when active==true.  The thread is
+    /// terminated by exit_request, or by the destructor at the latest.
     /// @param active Only write data to disk when this is true.
     /// @param fifosize Capacity of both the fifo pipeline and of the
     ///                 disk buffer.
@@ -42,34 +59,74 @@ public:
     ///                 before flushing the contents of the fifo to disk.
     ///                 Fifo is also flushed before this object is destroyed.
     /// @param prefix   Path and start of output file name.  Will be extended
-    ///                 with file name extension ".dat".
+    ///                 with file name extension ".dat" or ".mhrec".
     /// @param use_date When true, the current date and time will be appended
     ///                 to the output file name before the file name extension.
-    /// @param varname  Name of AC variable to save into file.  Can be accessed
-    ///                 through getter method get_varname().  Stored here
-    ///                 to avoid races between processing thread and
+    /// @param varnames Names of AC variables to save into file.  Can be
+    ///                 accessed through getter method get_varnames().  Stored
+    ///                 here to avoid races between processing thread and
     ///                 configuration thread.
+    /// @param mhrec    Write an MHA recording file instead of raw doubles.
+    ///                 Required for more than one variable.
+    /// @param compress Compress the blocks of the MHA recording file.
+    /// @param block_rate Process callbacks per second, used for the
+    ///                 timestamps of the MHA recording file.  0 if unknown,
+    ///                 can be set later with set_block_rate.
     acwriter_t(bool active, unsigned fifosize, unsigned minwrite,
                const std::string& prefix, bool use_date,
-               const std::string& varname);
-    /// Deallocates memory but does not terminate the write_thread.
-    /// write_thread must be terminated before the destructor executes by
-    /// calling exit_request.
-    ~acwriter_t() = default;
-    /// Place the data present in the algorithm communication variable into the
-    /// fifo for output to disk.
-    void process(MHA_AC::comm_var_t*);
+               const std::vector<std::string>& varnames,
+               bool mhrec = false, bool compress = false,
+               double block_rate = 0);
+    /// Calls exit_request, then deallocates memory.
+    ~acwriter_t();
+    /// Place the data present in all recorded algorithm communication
+    /// variables into the fifo for output to disk.  Called once per
+    /// process callback.
+    void process(MHA_AC::algo_comm_t & ac);
     /// Terminate output thread.
     void exit_request();
-    /// getter for ac variable name @return name as char* as needed by get_var
-    const std::string & get_varname() const {return varname;}
+    /// getter for ac variable names
+    const std::vector<std::string> & get_varnames() const {return varnames;}
+    /// Maximum fifo fill count in numbers after any process callback of
+    /// this session.  May be called from any thread.
+    unsigned get_fifo_high_water() const {return fifo_high_water.load();}
+    /// Number of rows (frames) of the AC variables that were discarded
+    /// because the fifo was full.  May be called from any thread.
+    uint64_t get_dropped_frames() const {return dropped_frames.load();}
+    /// Set the number of process callbacks per second.  Must be called
+    /// before the first process callback.
+    void set_block_rate(double rate) {block_rate.store(rate);}
 private:
-    /// Main method of the disk writer thread.  Periodically wakes up and checks
-    /// if data needs to be written to disk.
+    /// Determine or check number of channels and numeric type of one AC
+    /// variable.
+    /// @param var Index of the variable in get_varnames().
+    /// @param s The current value of the variable.
+    void check_var(unsigned var, const MHA_AC::comm_var_t& s);
+    /// Place the data present in one algorithm communication variable into
+    /// the fifo for output to disk.
+    /// @param var Index of the variable in get_varnames().
+    /// @param s The current value of the variable.
+    void push_var(unsigned var, const MHA_AC::comm_var_t& s);
+    /// Convert values of an AC variable to output_type and write them to
+    /// the fifo.
+    /// @param s The AC variable.
+    /// @param count Number of values to write, complex values count twice.
+    void write_values(const MHA_AC::comm_var_t& s, unsigned count);
+    /// Main method of the disk writer thread.  Sleeps until the processing
+    /// thread signals that enough data is waiting in the fifo, then writes
+    /// it to disk.
     void write_thread();
-    /// Open data file for output. Combine prefix, date, and file name extension
+    /// Write the frames in the fifo to disk.
+    void flush();
+    /// Move complete records from the fifo to the per-variable staging
+    /// buffers and write them to the MHA recording file.
+    void flush_records();
+    /// Write the staged rows of one variable as one block.
+    void write_staged(unsigned var);
+    /// Open data file for output. Combine prefix, date, and file name extension.
+    /// In mhrec mode, only check that the file can be created.
     /// @param prefix   Path and start of output file name.  Will be extended
-    ///                 with file name extension ".dat".
+    ///                 with file name extension ".dat" or ".mhrec".
     /// @param use_date When true, the current date and time will be appended
     ///                 to the output file name before the file name extension.
     void create_datafile(const std::string& prefix, bool use_date);
@@ -84,29 +141,91 @@ private:
     /// Minimum number of samples that need to be waiting in the fifo before
     /// the disk writer thread writes them to disk.
     const unsigned int disk_write_threshold_min_num_samples;
+    /// Wakes up the writer thread when the fifo fill count exceeds
+    /// disk_write_threshold_min_num_samples.
+    mha_fifo_wakeup_t wakeup;
+    /// Maximum fifo fill count seen by the processing thread.
+    std::atomic<unsigned> fifo_high_water;
+    /// Number of discarded rows, counted by the processing thread.
+    std::atomic<uint64_t> dropped_frames;
     /// The thread that writes to disk.
     std::thread writethread;
     /// Intermediate buffer to receive data from fifo and store on disk.
     std::unique_ptr<output_type[]> diskbuffer;
-    /// Ouput file.
+    /// Ouput file in raw format.
     std::fstream outfile;
-    /// Number of channels of AC variable using stride.  If the number of
-    /// channels changes during processing, an exception is thrown.
-    unsigned num_channels = 0U;
-    /// The number of channels is determined during the first process callback.
-    /// is_num_channels_known is set to true after the first process callback.
-    bool is_num_channels_known = false;
-    /// If the AC variable is of complex valued type or not.  If this changes
-    /// during processing, then an exception is thrown.
-    bool is_complex = false;
-    /// The name of the ac variable to publish.
-    const std::string varname;
+    /// Write an MHA recording file instead of raw doubles.
+    const bool mhrec;
+    /// Compress the MHA recording file.
+    const bool compress;
+    /// Process callbacks per second, 0 if unknown.
+    std::atomic<double> block_rate;
+    /// Time of object creation, used for the timestamps of the MHA
+    /// recording file when the block rate is unknown.
+    const std::chrono::steady_clock::time_point session_start;
+    /// Name of the MHA recording file.
+    std::string recfilename;
+    /// Output file in MHA recording format.  Created by the writer thread
+    /// when the first data arrive, because the number of channels is not
+    /// known before.
+    std::unique_ptr<MHARecFile::writer_t> recfile;
+    /// Per-variable state of the processing thread.  The number of
+    /// channels and the numeric type of all variables are determined
+    /// during the first process callback before any data is pushed into the
+    /// fifo, and are read by the writer thread after it has received the
+    /// first record.
+    struct var_state_t {
+        /// Number of channels of AC variable using stride.  If the number
+        /// of channels changes during processing, an exception is thrown.
+        unsigned num_channels = 0U;
+        /// The number of channels is determined during the first process
+        /// callback.  is_num_channels_known is set to true after the first
+        /// process callback.
+        bool is_num_channels_known = false;
+        /// If the AC variable is of complex valued type or not.  If this
+        /// changes during processing, then an exception is thrown.
+        bool is_complex = false;
+        /// Rows per process callback in the first process callback, used
+        /// for the frame rate of the recording file stream.
+        unsigned rows_per_block = 0U;
+        /// Index of the next row, counting dropped rows.
+        uint64_t next_row = 0U;
+        /// Doubles per row: channels, times 2 for complex values.
+        unsigned row_size() const
+        {
+            // Allow saving AC vars with stride zero, interpret as stride one.
+            return std::max(num_channels, 1U) * (is_complex ? 2U : 1U);
+        }
+    };
+    std::vector<var_state_t> vars;
+    /// The current values of the AC variables, fetched once per process
+    /// callback.
+    std::vector<MHA_AC::comm_var_t> current;
+    /// Index of the current process callback.
+    uint64_t block = 0U;
+    /// Per-variable state of the writer thread.
+    struct staging_t {
+        /// Rows received from the fifo and not yet written.
+        std::vector<output_type> rows;
+        /// Index of the first staged row.
+        uint64_t first_row = 0U;
+        /// Index of the process callback of the first staged row.
+        uint64_t first_block = 0U;
+    };
+    std::vector<staging_t> staging;
+    /// Header of a record whose data has not completely arrived yet.
+    output_type pending_header[record_header_size];
+    /// Whether pending_header is valid.
+    bool have_pending_header = false;
+    /// The names of the ac variables to record.
+    const std::vector<std::string> varnames;
 };
 
 /// Plugin interface class of plugin acrec.
 class acrec_t : public MHAPlugin::plugin_t<acwriter_t> {
 public:
-    /// Process callback.  Pushes the data from one AC variable into the fifo.
+    /// Process callback.  Pushes the data from the AC variables into the
+    /// fifo.
     /// @return the unmodified input signal.
     /// @param s input signal.  The audio signal is not used or modified. 
     template <class mha_signal_t> mha_signal_t* process(mha_signal_t* s);
@@ -122,6 +241,11 @@ private:
     /// Configuration callback called whenever configuaration variable "record"
     /// is written to.
     void start_new_session();
+    /// Create a new writer from the current configuration.
+    acwriter_t* create_writer();
+    /// Copy fifo statistics of the current writer to the monitor variables
+    /// before they are read.
+    void update_monitors();
     MHAParser::bool_t record =
         {"Recording session. Each write access will finalize the previous\n"
          "recording session. Each write access with value \"yes\" will start\n"
@@ -134,10 +258,23 @@ private:
         {"Path (including path delimiter) and file prefix",""};
     MHAParser::string_t varname =
         {"Name of AC variable",""};
+    MHAParser::vstring_t varnames =
+        {"Names of AC variables to record into one MHA recording file.\n"
+         "If not empty, varname is ignored.","[]"};
     MHAParser::bool_t use_date =
         {"Use date and time (yes), or only prefix (no)","yes"};
+    MHAParser::kw_t fileformat =
+        {"Output file format: raw doubles (dat) or MHA recording file (mhrec)",
+         "dat","[dat mhrec]"};
+    MHAParser::bool_t compress =
+        {"Compress MHA recording files","no"};
+    MHAParser::int_mon_t fifo_high_water =
+        {"Maximum fill count of the FIFO in samples during the current\n"
+         "recording session.  Should stay below fifolen."};
+    MHAParser::int_mon_t dropped_frames =
+        {"Number of rows of the AC variables that were discarded during the\n"
+         "current recording session because the FIFO was full."};
     MHAEvents::patchbay_t<acrec_t> patchbay;
-    MHA_AC::comm_var_t cv;
     MHA_AC::algo_comm_t & ac;
 };
 
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -17,6 +18,7 @@
 #include "acrec.hh"
 #include <gtest/gtest.h>
 #include <ctime>
+#include <cstdio>
 using namespace plugins::hoertech::acrec;
 TEST(to_iso8601,epoch){
   // Semi-arbitrary date, the {} ensure zero-initialization
@@ -29,3 +31,116 @@ TEST(to_iso8601,epoch){
   auto actual=to_iso8601(mktime(&tm)) ;
   EXPECT_EQ(expected,actual);
 }
+
+TEST(acwriter_t, writes_mha_recording_file){
+  float data[6] = {1, 2, 3, 4, 5, 6};
+  MHA_AC::algo_comm_class_t ac;
+  // 3 rows with 2 channels
+  ac.insert_var("level", {MHA_AC_FLOAT, 6, 2, data});
+  acwriter_t writer(true, 1000, 100, "acrec_unit_test", false, {"level"},
+                    true, true, 100);
+  writer.process(ac);
+  writer.process(ac);
+  writer.exit_request();
+  MHARecFile::reader_t reader("acrec_unit_test.mhrec");
+  ASSERT_EQ(1U, reader.get_streams().size());
+  EXPECT_EQ("level", reader.get_streams()[0].name);
+  EXPECT_EQ(2U, reader.get_streams()[0].ndim);
+  EXPECT_FALSE(reader.get_streams()[0].is_complex);
+  EXPECT_EQ(300.0, reader.get_streams()[0].rate);
+  std::vector<uint64_t> indices;
+  std::vector<double> values;
+  reader.read_frames(0, 0, reader.get_end_frame(0), indices, values);
+  std::remove("acrec_unit_test.mhrec");
+  std::vector<uint64_t> expected_indices = {0, 1, 2, 3, 4, 5};
+  std::vector<double> expected_values = {1, 2, 3, 4, 5, 6, 1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(expected_indices, indices);
+  EXPECT_EQ(expected_values, values);
+}
+
+TEST(acwriter_t, records_several_variables_into_one_file){
+  float level[2] = {0, 0};
+  mha_complex_t spec[3] = {{0, 0}, {0, 0}, {0, 0}};
+  int count = 0;
+  MHA_AC::algo_comm_class_t ac;
+  ac.insert_var("level", {MHA_AC_FLOAT, 2, 2, level});
+  ac.insert_var("spec", {MHA_AC_MHACOMPLEX, 3, 3, spec});
+  ac.insert_var_int("count", &count);
+  // Fifo too small for all data: some records are discarded
+  acwriter_t writer(true, 200, 100, "acrec_unit_test", false,
+                    {"level", "spec", "count"}, true, false, 10);
+  for (int block = 0; block < 1000; ++block) {
+    level[0] = block; level[1] = -block;
+    for (unsigned k = 0; k < 3; ++k)
+      spec[k] = {float(block), float(k)};
+    count = block;
+    writer.process(ac);
+  }
+  writer.exit_request();
+  EXPECT_LE(writer.get_fifo_high_water(), 200U);
+  EXPECT_GT(writer.get_fifo_high_water(), 100U);
+  MHARecFile::reader_t reader("acrec_unit_test.mhrec");
+  std::remove("acrec_unit_test.mhrec");
+  const auto & streams = reader.get_streams();
+  uint64_t frames_in_file = 0U;
+  ASSERT_EQ(3U, streams.size());
+  EXPECT_EQ("level", streams[0].name);
+  EXPECT_EQ("spec", streams[1].name);
+  EXPECT_EQ("count", streams[2].name);
+  EXPECT_EQ(3U, streams[1].ndim);
+  EXPECT_TRUE(streams[1].is_complex);
+  EXPECT_EQ(1U, streams[2].ndim);
+  for (unsigned stream = 0; stream < 3; ++stream) {
+    std::vector<uint64_t> indices;
+    std::vector<double> values;
+    reader.read_frames(stream, 0, 1000, indices, values);
+    ASSERT_FALSE(indices.empty());
+    const unsigned frame_size = streams[stream].frame_size();
+    ASSERT_EQ(indices.size() * frame_size, values.size());
+    frames_in_file += indices.size();
+    for (size_t i = 0; i < indices.size(); ++i) {
+      // One frame per process callback: frame index equals block index
+      const double block = indices[i];
+      const double * frame = &values[i * frame_size];
+      if (stream == 0) {
+        EXPECT_EQ(block, frame[0]);
+        EXPECT_EQ(-block, frame[1]);
+      } else if (stream == 1) {
+        for (unsigned k = 0; k < 3; ++k) {
+          EXPECT_EQ(block, frame[2*k]);
+          EXPECT_EQ(k, frame[2*k+1]);
+        }
+      } else {
+        EXPECT_EQ(block, frame[0]);
+      }
+    }
+  }
+  // Every row is either in the file or counted as dropped
+  EXPECT_EQ(3000U, frames_in_file + writer.get_dropped_frames());
+  // Timestamps are signal time of the first frame in each block
+  for (const auto & block : reader.get_index())
+    EXPECT_DOUBLE_EQ(block.first_frame / 10.0, block.timestamp);
+}
+
+TEST(acwriter_t, session_without_data_leaves_no_mhrec_file){
+  acwriter_t writer(true, 1000, 100, "acrec_unit_test", false, {"level"},
+                    true);
+  writer.exit_request();
+  std::FILE * file = std::fopen("acrec_unit_test.mhrec", "rb");
+  EXPECT_EQ(nullptr, file);
+  if (file)
+    std::fclose(file);
+  std::remove("acrec_unit_test.mhrec");
+}
+
+TEST(acwriter_t, uncreatable_mhrec_file_is_an_error){
+  EXPECT_THROW(acwriter_t(true, 1000, 100, "no_such_dir/acrec_unit_test",
+                          false, {"level"}, true),
+               MHA_Error);
+}
+
+TEST(acwriter_t, several_variables_require_mhrec_format){
+  EXPECT_THROW(acwriter_t(false, 1000, 100, "acrec_unit_test", false,
+                          {"a", "b"}, false),
+               MHA_Error);
+}
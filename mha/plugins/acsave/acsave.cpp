@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2004 2005 2006 2007 2009 2010 2012 2013 2014 2015 HörTech gGmbH
 // Copyright © 2017 2018 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,91 +15,176 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_signal.hh"
-#include "mha_defs.h"
-#include "mha_events.h"
+#include "acsave.hh"
 #include <math.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
 #include "mha_os.h"
 
-#define ACSAVE_FMT_TXT 0
-#define ACSAVE_SFMT_TXT "txt"
-#define ACSAVE_FMT_MAT4 1
-#define ACSAVE_SFMT_MAT4 "mat4"
-#define ACSAVE_FMT_M 2
-#define ACSAVE_SFMT_M "m"
-
 namespace acsave {
 
-class save_var_t {
-public:
-    save_var_t(const std::string&, int, MHA_AC::algo_comm_t &);
-    ~save_var_t();
-    void store_frame();
-    void save_txt(FILE*,unsigned int);
-    void save_mat4(FILE*,unsigned int);
-    void save_m(FILE*,unsigned int);
-    double* data;
-private:
-    std::string name;
-    unsigned int nframes;
-    unsigned int ndim;
-    unsigned int maxframe;
-    MHA_AC::algo_comm_t & ac;
-    unsigned int framecnt;
-    bool b_complex;
-};
-
-class cfg_t {
-public:
-    cfg_t(MHA_AC::algo_comm_t & iac,
-          unsigned int imax_frames,
-          std::vector<std::string>& var_names);
-    ~cfg_t();
-    void store_frame();
-    void flush_data(const std::string&,unsigned int);
-private:
-    MHA_AC::algo_comm_t & ac;
-    unsigned int nvars;
-    save_var_t** varlist;
-    unsigned int rec_frames;
-    unsigned int max_frames;
-};
-
-class acsave_t : public MHAPlugin::plugin_t<cfg_t> {
-    typedef std::vector<save_var_t*> varlist_t;
-public:
-    acsave_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-    void prepare(mhaconfig_t&);
-    void release();
-    mha_spec_t* process(mha_spec_t*);
-    mha_wave_t* process(mha_wave_t*);
-    void event_start_recording();
-    void event_stop_and_flush();
-private:
-    void process();
-    MHAParser::bool_t bflush;
-    MHAParser::kw_t fileformat;
-    MHAParser::string_t fname;
-    MHAParser::float_t reclen;
-    MHAParser::vstring_t variables;
-    varlist_t varlist;
-    std::string algo;
-    bool b_prepared;
-    bool b_flushed;
-    MHAEvents::patchbay_t<acsave_t> patchbay;
-};
+namespace {
+    /// Number of doubles in one frame of all variables
+    unsigned int frame_size_of(const std::vector<save_var_t*>& vars)
+    {
+        unsigned int size = 0;
+        for(auto var : vars)
+            size += var->get_frame_size();
+        return size;
+    }
+}
+
+stream_writer_t::stream_writer_t(const std::string& filename,
+                                 const std::vector<save_var_t*>& vars,
+                                 unsigned int ififo_frames,
+                                 double iframe_rate,
+                                 bool compress)
+    : frame_size(frame_size_of(vars)),
+      fifo_frames(ififo_frames),
+      min_frames(std::max(1U,ififo_frames / 4)),
+      fifo(ififo_frames * frame_size),
+      index_fifo(ififo_frames),
+      frame_rate(iframe_rate),
+      close_session(false),
+      stopped(false),
+      dropped(0)
+{
+    if( fifo_frames < 2 )
+        throw MHA_Error(__FILE__,__LINE__,
+                        "The streaming fifo needs room for at least 2 frames"
+                        " (got %u).",fifo_frames);
+    std::vector<MHARecFile::stream_info_t> streams(vars.size());
+    for(unsigned int k=0;k<vars.size();k++){
+        streams[k].name = vars[k]->get_name();
+        streams[k].ndim = vars[k]->get_ndim();
+        streams[k].is_complex = vars[k]->is_complex();
+        streams[k].rate = frame_rate;
+        var_sizes.push_back(vars[k]->get_frame_size());
+    }
+    diskbuffer.resize(fifo_frames * frame_size);
+    indexbuffer.resize(fifo_frames);
+    varbuffer.resize(fifo_frames * frame_size);
+    file.reset(new MHARecFile::writer_t(filename,streams,compress));
+}
+
+void stream_writer_t::start()
+{
+    if( !writethread.joinable() && !stopped.load() )
+        writethread = std::thread(&stream_writer_t::write_thread,this);
+}
+
+stream_writer_t::~stream_writer_t()
+{
+    try {
+        stop();
+    }
+    catch(MHA_Error&){
+        // a destructor must not throw, the file is closed anyway
+    }
+}
+
+void stream_writer_t::store(unsigned long long frame_index, const double* frame)
+{
+    if( stopped.load() || (get_available_frames() == 0) ){
+        ++dropped;
+        return;
+    }
+    // the index becomes visible to the writer thread after the frame
+    const uint64_t idx = frame_index;
+    fifo.write(frame,frame_size);
+    index_fifo.write(&idx,1);
+    if( index_fifo.get_max_fill_count() - index_fifo.get_available_space()
+        >= min_frames )
+        wakeup.notify();
+}
+
+unsigned int stream_writer_t::get_available_frames() const
+{
+    const unsigned int frames = index_fifo.get_available_space();
+    if( frame_size == 0 )
+        return frames;
+    return std::min(frames,fifo.get_available_space() / frame_size);
+}
+
+void stream_writer_t::stop()
+{
+    const bool started = writethread.joinable();
+    stopped.store(true);
+    if( started ){
+        close_session.store(true);
+        wakeup.signal();
+        writethread.join();
+    }
+    else if( file )
+        write_chunks(index_fifo.get_fill_count());
+    if( file ){
+        std::unique_ptr<MHARecFile::writer_t> f(std::move(file));
+        f->close();
+    }
+}
+
+void stream_writer_t::write_chunks(unsigned int frames)
+{
+    fifo.read(diskbuffer.data(),frames * frame_size);
+    index_fifo.read(indexbuffer.data(),frames);
+    unsigned int first = 0;
+    while( first < frames ){
+        // frames with consecutive indices form one block per variable
+        unsigned int count = 1;
+        while( (first + count < frames) &&
+               (indexbuffer[first+count] == indexbuffer[first] + count) )
+            ++count;
+        const uint64_t first_index = indexbuffer[first];
+        unsigned int var_offset = 0;
+        for(unsigned int var=0;var<var_sizes.size();var++){
+            const unsigned int size = var_sizes[var];
+            for(unsigned int k=0;k<count;k++)
+                std::copy_n(&diskbuffer[(first+k)*frame_size+var_offset],size,
+                            &varbuffer[k*size]);
+            file->write_block(var,first_index,count,first_index/frame_rate,
+                              varbuffer.data());
+            var_offset += size;
+        }
+        first += count;
+    }
+}
+
+void stream_writer_t::write_thread()
+{
+    try {
+        while( !close_session.load() ){
+            // sleep until store() has collected a few frames
+            wakeup.arm();
+            if( (index_fifo.get_fill_count() < min_frames) &&
+                !close_session.load() )
+                wakeup.wait();
+            const unsigned int frames = index_fifo.get_fill_count();
+            if( frames >= min_frames )
+                write_chunks(frames);
+        }
+        write_chunks(index_fifo.get_fill_count());
+    }
+    catch(MHA_Error&){
+        // The file cannot be written, e.g. because the disk is full.
+        // All further frames are counted as dropped.
+        stopped.store(true);
+    }
+}
 
 cfg_t::cfg_t(MHA_AC::algo_comm_t & iac,
              unsigned int imax_frames,
-             std::vector<std::string>& varnames) :
+             std::vector<std::string>& varnames,
+             const std::string& stream_file,
+             unsigned int fifo_frames,
+             double frame_rate,
+             bool compress) :
     ac(iac),
     nvars(0),
     varlist(NULL),
     rec_frames(0),
     max_frames(imax_frames)
 {
+    const bool b_stream = stream_file.size() > 0;
     if( !varnames.size() ){
         varnames = ac.get_entries();
     }
@@ -109,7 +194,15 @@ cfg_t::cfg_t(MHA_AC::algo_comm_t & iac,
     unsigned int k;
     varlist = new save_var_t*[nvars];
     for(k=0;k<nvars;k++){
-        varlist[k] = new save_var_t(varnames[k],max_frames,ac);
+        // in streaming mode, frames are not kept in memory
+        varlist[k] = new save_var_t(varnames[k],b_stream ? 0 : max_frames,ac);
+    }
+    if( b_stream ){
+        std::vector<save_var_t*> vars(varlist,varlist+nvars);
+        stream.reset(new stream_writer_t(stream_file,vars,fifo_frames,
+                                         frame_rate,compress));
+        stream->start();
+        framebuf.resize(stream->get_frame_size());
     }
 }
 
@@ -131,6 +224,18 @@ This function is called in the processing thread.
 */
 void cfg_t::store_frame()
 {
+    if( stream ){
+        if( max_frames && (rec_frames >= max_frames) )
+            return;
+        double* frame = framebuf.data();
+        for(unsigned int k=0;k<nvars;k++){
+            varlist[k]->get_frame(frame);
+            frame += varlist[k]->get_frame_size();
+        }
+        stream->store(rec_frames,framebuf.data());
+        rec_frames++;
+        return;
+    }
     if( rec_frames >= max_frames )
         return;
     unsigned int k;
@@ -143,11 +248,19 @@ void cfg_t::store_frame()
 /*!
   This function is called in the configuration thread.
 
+  In streaming mode, the writer thread is stopped after writing
+  the remaining frames, and the arguments are ignored.
+
   \param filename       Output file name
   \param fmt            Output file format
 */
 void cfg_t::flush_data(const std::string& filename,unsigned int fmt)
 {
+    if( stream ){
+        // the data is already on disk
+        stream->stop();
+        return;
+    }
     if( !filename.size() )
         return;
     unsigned int tobesaved = rec_frames;
@@ -206,13 +319,22 @@ acsave_t::acsave_t(MHA_AC::algo_comm_t & iac,
         "when sending the flush command. Changing the list of variables\n"
         "also starts the recording with the currently configured recording\n"
         "length (previously recorded data might be overwritten). Issueing\n"
-        "the 'flush' command frees allocated memory.",
+        "the 'flush' command frees allocated memory.\n\n"
+        "In streaming mode, recorded frames are written to the file\n"
+        "continuously by a background thread, in the MHA recording file\n"
+        "format (.mhrec). The file is created when the recording starts, and\n"
+        "\"flush\" closes it. A recording length of zero means no limit.",
         iac),
       bflush("flush the buffers to disk","no"),
       fileformat("file format of output file","txt","[txt mat4 m]"),
       fname("output file name",""),
       reclen("maximal recording length in seconds","10","[0,]"),
       variables("list of variables to be saved (empty: save all)","[]"),
+      streaming("write frames continuously to the file in the binary"
+                " stream format instead of keeping them in memory","no"),
+      fifolen("capacity of the streaming fifo in frames."
+              " Frames are dropped when the fifo is full.","1024","[2,]"),
+      compress("compress the file in streaming mode","no"),
       algo(configured_name),
       b_prepared(false),
       b_flushed(false)
@@ -223,9 +345,13 @@ acsave_t::acsave_t(MHA_AC::algo_comm_t & iac,
     insert_item("reclen",&reclen);
     insert_item("flush",&bflush);
     insert_item("vars",&variables);
+    insert_item("streaming",&streaming);
+    insert_item("fifolen",&fifolen);
+    insert_item("compress",&compress);
     patchbay.connect(&bflush.writeaccess,this,&acsave_t::event_stop_and_flush);
     patchbay.connect(&reclen.writeaccess,this,&acsave_t::event_start_recording);
     patchbay.connect(&variables.writeaccess,this,&acsave_t::event_start_recording);
+    patchbay.connect(&streaming.writeaccess,this,&acsave_t::event_start_recording);
 }
 
 void acsave_t::event_stop_and_flush()
@@ -247,7 +373,23 @@ void acsave_t::event_start_recording()
     unsigned int recframes = mha_min_1(
         (unsigned int)(tftype.srate/(float)tftype.fragsize * (float)reclen.data)
         );
-    push_config(new cfg_t(ac,recframes,variables.data));
+    if( streaming.data ){
+        if( !fname.data.size() )
+            throw MHA_Error(__FILE__,__LINE__,
+                            "acsave: Streaming mode requires an output file"
+                            " name.");
+        if( reclen.data == 0 )
+            recframes = 0;
+        // The previous recording may still be writing to the same
+        // file: write its remaining frames and close it first.
+        cfg_t* previous = peek_config();
+        if( previous && previous->get_stream() )
+            previous->get_stream()->stop();
+        push_config(new cfg_t(ac,recframes,variables.data,
+                              fname.data,fifolen.data,
+                              tftype.srate/tftype.fragsize,compress.data));
+    }else
+        push_config(new cfg_t(ac,recframes,variables.data));
     b_flushed = false;
 }
 
@@ -319,6 +461,42 @@ save_var_t::save_var_t(const std::string& nm, int n, MHA_AC::algo_comm_t & iac)
     }
 }
 
+void save_var_t::get_frame(double* dst) const
+{
+    MHA_AC::comm_var_t v = ac.get_var(name);
+    unsigned int local_ndim = std::min(v.num_entries,ndim);
+    unsigned int k;
+    switch( v.data_type ){
+        case MHA_AC_INT :
+            for( k=0;k<local_ndim;k++)
+                dst[k] = ((int*)v.data)[k];
+            break;
+        case MHA_AC_FLOAT :
+            for( k=0;k<local_ndim;k++)
+                dst[k] = ((float*)v.data)[k];
+            break;
+        case MHA_AC_DOUBLE :
+            for( k=0;k<local_ndim;k++)
+                dst[k] = ((double*)v.data)[k];
+            break;
+        case MHA_AC_MHAREAL :
+            for( k=0;k<local_ndim;k++)
+                dst[k] = ((mha_real_t*)v.data)[k];
+            break;
+        case MHA_AC_MHACOMPLEX :
+            for( k=0;k<local_ndim;k++){
+                dst[2*k] = ((mha_complex_t*)v.data)[k].re;
+                dst[2*k+1] = ((mha_complex_t*)v.data)[k].im;
+            }
+            local_ndim *= 2;
+            break;
+        default:
+            local_ndim = 0;
+    }
+    for( k=local_ndim; k<get_frame_size(); k++)
+        dst[k] = 0;
+}
+
 save_var_t::~save_var_t()
 {
     if( data )
@@ -493,7 +671,25 @@ MHAPLUGIN_DOCUMENTATION\
  "overwrite previously written data.\n"
  "\n"
  "File name and type can be changed at any time and have to be valid\n"
- "when sending the flush command.\n")
+ "when sending the flush command.\n"
+ "\n"
+ "For long recordings, set 'streaming' to yes before the recording\n"
+ "starts. The frames are then passed through a lock-free fifo of\n"
+ "'fifolen' frames to a background thread, which appends them to the\n"
+ "file 'name' while the recording is running, so that the memory usage\n"
+ "does not depend on the recording length. 'fileformat' is ignored in\n"
+ "this mode, the file is written in the MHA recording file format\n"
+ "(.mhrec), which can be read with the functions in\n"
+ "mha/tools/python/openMHA/mhrec.py and mha/tools/mfiles/mha\\_read\\_mhrec.m.\n"
+ "Each variable is stored as one stream. Every block of frames in the\n"
+ "file carries the index of its first frame, counting the signal\n"
+ "blocks since the start of the recording, and its signal time in\n"
+ "seconds. Setting 'compress' to yes compresses the blocks with a\n"
+ "fast LZ-type compression after grouping the bytes of the numbers by\n"
+ "significance. Frames that do not fit into\n"
+ "the fifo because the disk is too slow are dropped, which shows as a\n"
+ "gap in the frame indices of consecutive blocks. A recording length\n"
+ "of zero records until 'flush' is set.\n")
     
 
 // Local Variables:
@@ -0,0 +1,225 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2004 2005 2006 2007 2009 2010 2012 2013 2014 2015 HörTech gGmbH
+// Copyright © 2017 2018 2020 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ACSAVE_HH
+#define ACSAVE_HH
+
+#include "mha_plugin.hh"
+#include "mha_signal.hh"
+#include "mha_defs.h"
+#include "mha_events.h"
+#include "mha_fifo.h"
+#include "mha_recfile.hh"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <stdio.h>
+
+#define ACSAVE_FMT_TXT 0
+#define ACSAVE_SFMT_TXT "txt"
+#define ACSAVE_FMT_MAT4 1
+#define ACSAVE_SFMT_MAT4 "mat4"
+#define ACSAVE_FMT_M 2
+#define ACSAVE_SFMT_M "m"
+
+namespace acsave {
+
+class save_var_t {
+public:
+    save_var_t(const std::string&, int, MHA_AC::algo_comm_t &);
+    ~save_var_t();
+    void store_frame();
+    /// Convert the current value of the AC variable to doubles.
+    /// @param dst Destination, get_frame_size() entries.  Complex values
+    ///            are stored as alternating real and imaginary parts.
+    void get_frame(double* dst) const;
+    void save_txt(FILE*,unsigned int);
+    void save_mat4(FILE*,unsigned int);
+    void save_m(FILE*,unsigned int);
+    const std::string& get_name() const {return name;}
+    unsigned int get_ndim() const {return ndim;}
+    bool is_complex() const {return b_complex;}
+    /// Number of doubles per frame, 2*ndim for complex variables
+    unsigned int get_frame_size() const {return b_complex ? 2*ndim : ndim;}
+    double* data;
+private:
+    std::string name;
+    unsigned int nframes;
+    unsigned int ndim;
+    unsigned int maxframe;
+    MHA_AC::algo_comm_t & ac;
+    unsigned int framecnt;
+    bool b_complex;
+};
+
+/** Background writer of the streaming mode.  Frames are passed from the
+ * processing thread to a disk writer thread through a lock-free fifo of
+ * fixed capacity and appended to an MHA recording file (see
+ * MHARecFile), so that memory usage does not depend on the recording
+ * length.  Each variable is stored as one stream of the recording file,
+ * frame indices count the signal blocks since the start of the
+ * recording, and timestamps are the corresponding signal times.
+ *
+ * Frames that do not fit into the fifo are dropped; consecutive blocks
+ * in the file then have a gap in their frame indices. */
+class stream_writer_t {
+public:
+    /// Open the output file and write the header.  The writer thread is
+    /// started by start().
+    /// @param filename Output file name.
+    /// @param vars Variables to record, used for the file header.
+    /// @param fifo_frames Capacity of the fifo in frames.
+    /// @param frame_rate Signal blocks per second.
+    /// @param compress Compress the blocks written to the file.
+    stream_writer_t(const std::string& filename,
+                    const std::vector<save_var_t*>& vars,
+                    unsigned int fifo_frames,
+                    double frame_rate,
+                    bool compress);
+    /// Calls stop().
+    ~stream_writer_t();
+    /// Start the writer thread.  Frames stored before are kept in the
+    /// fifo and written when the thread starts.
+    void start();
+    /// Pass one frame to the writer thread.  Called in the processing
+    /// thread, does not block or allocate.  The frame is dropped if
+    /// the fifo is full or the writer has been stopped.
+    /// @param frame_index Index of this frame since recording start.
+    /// @param frame get_frame_size() doubles.
+    void store(unsigned long long frame_index, const double* frame);
+    /// Stop the writer thread after writing all frames in the fifo to
+    /// disk and close the file.  Called in the configuration thread.  If
+    /// the writer thread was not started, the frames are written here.
+    void stop();
+    /// Number of doubles in one frame, without the frame index.
+    unsigned int get_frame_size() const {return frame_size;}
+    /// Number of frames that can currently be stored without dropping.
+    /// Must only be called by the thread that calls store().
+    unsigned int get_available_frames() const;
+    /// Number of frames that were dropped because the fifo was full.
+    unsigned long long get_dropped_frames() const {return dropped;}
+private:
+    /// Main method of the disk writer thread.
+    void write_thread();
+    /// Move frames from the fifo to the file.
+    void write_chunks(unsigned int frames);
+    /// Doubles per frame of each variable
+    std::vector<unsigned int> var_sizes;
+    /// Doubles per frame, without frame index.
+    unsigned int frame_size;
+    /// Capacity of the fifo in frames.
+    unsigned int fifo_frames;
+    /// Number of frames that wake up the writer thread.
+    unsigned int min_frames;
+    /// Fifo holding the frames.
+    mha_fifo_lf_t<double> fifo;
+    /// Fifo holding the frame index of each frame in fifo.
+    mha_fifo_lf_t<uint64_t> index_fifo;
+    /// Wakes up the writer thread when min_frames are in the fifo.
+    mha_fifo_wakeup_t wakeup;
+    /// Signal blocks per second, for the timestamps.
+    double frame_rate;
+    /// Intermediate buffer between fifo and file.
+    std::vector<double> diskbuffer;
+    /// Frame indices of the frames in diskbuffer.
+    std::vector<uint64_t> indexbuffer;
+    /// Frames of one variable, passed to the file.
+    std::vector<double> varbuffer;
+    /// Output file, only accessed by the writer thread after construction.
+    std::unique_ptr<MHARecFile::writer_t> file;
+    /// Set by stop() to terminate the writer thread.
+    std::atomic<bool> close_session;
+    /// Set by stop() before the thread is joined, checked by store().
+    std::atomic<bool> stopped;
+    /// Number of dropped frames.
+    std::atomic<unsigned long long> dropped;
+    /// The disk writer thread.
+    std::thread writethread;
+};
+
+class cfg_t {
+public:
+    /// @param iac AC variable space
+    /// @param imax_frames Maximum number of frames to record.  In
+    ///                    streaming mode, 0 means no limit.
+    /// @param var_names Names of AC variables to record, empty: all.
+    /// @param stream_file Output file of streaming mode.  Empty:
+    ///                    record into memory until flush_data().
+    /// @param fifo_frames Capacity of the streaming fifo in frames.
+    /// @param frame_rate Signal blocks per second, streaming mode only.
+    /// @param compress Compress the stream file.
+    cfg_t(MHA_AC::algo_comm_t & iac,
+          unsigned int imax_frames,
+          std::vector<std::string>& var_names,
+          const std::string& stream_file = "",
+          unsigned int fifo_frames = 0,
+          double frame_rate = 0,
+          bool compress = false);
+    ~cfg_t();
+    void store_frame();
+    void flush_data(const std::string&,unsigned int);
+    /// The streaming writer, or nullptr when recording into memory.
+    stream_writer_t* get_stream() {return stream.get();}
+private:
+    MHA_AC::algo_comm_t & ac;
+    unsigned int nvars;
+    save_var_t** varlist;
+    unsigned int rec_frames;
+    unsigned int max_frames;
+    /// Streaming writer, only in streaming mode.
+    std::unique_ptr<stream_writer_t> stream;
+    /// One frame of all variables, only in streaming mode.
+    std::vector<double> framebuf;
+};
+
+class acsave_t : public MHAPlugin::plugin_t<cfg_t> {
+    typedef std::vector<save_var_t*> varlist_t;
+public:
+    acsave_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
+    void prepare(mhaconfig_t&);
+    void release();
+    mha_spec_t* process(mha_spec_t*);
+    mha_wave_t* process(mha_wave_t*);
+    void event_start_recording();
+    void event_stop_and_flush();
+private:
+    void process();
+    MHAParser::bool_t bflush;
+    MHAParser::kw_t fileformat;
+    MHAParser::string_t fname;
+    MHAParser::float_t reclen;
+    MHAParser::vstring_t variables;
+    MHAParser::bool_t streaming;
+    MHAParser::int_t fifolen;
+    MHAParser::bool_t compress;
+    varlist_t varlist;
+    std::string algo;
+    bool b_prepared;
+    bool b_flushed;
+    MHAEvents::patchbay_t<acsave_t> patchbay;
+};
+
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,256 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "acsave.hh"
+#include "mha_algo_comm.hh"
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+
+namespace {
+  /// Frames of one stream of a recording file
+  struct stream_data_t {
+    std::vector<uint64_t> indices;
+    std::vector<double> data;
+  };
+
+  std::vector<stream_data_t> read_all_streams(MHARecFile::reader_t & reader)
+  {
+    std::vector<stream_data_t> streams(reader.get_streams().size());
+    for (unsigned k = 0; k < streams.size(); ++k)
+      reader.read_frames(k, 0, reader.get_end_frame(k),
+                         streams[k].indices, streams[k].data);
+    return streams;
+  }
+
+  const std::string filename = "acsave_unit_test_stream.mhrec";
+
+  /// Gives the test access to the current runtime configuration
+  class testable_acsave_t : public acsave::acsave_t {
+  public:
+    using acsave::acsave_t::acsave_t;
+    using acsave::acsave_t::peek_config;
+  };
+}
+
+TEST(acsave_t, streaming_records_more_frames_than_the_fifo_holds)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  float level[3] = {0, 0, 0};
+  mha_complex_t phase = {0, 0};
+  acspace.insert_var("level", {MHA_AC_FLOAT, 3, 1, level});
+  acspace.insert_var("phase", {MHA_AC_MHACOMPLEX, 1, 1, &phase});
+  testable_acsave_t plugin(acspace, "acsave");
+  plugin.parse("name = " + filename);
+  plugin.parse("streaming = yes");
+  plugin.parse("fifolen = 16");
+  plugin.parse("reclen = 0");
+  plugin.parse("vars = [level phase]");
+  mhaconfig_t cf = {.channels = 1, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  plugin.prepare_(cf);
+  MHASignal::waveform_t s(16, 1);
+  const unsigned total = 400;
+  for (unsigned frame = 0; frame < total; ++frame) {
+    level[0] = frame;
+    level[1] = -0.5f * frame;
+    level[2] = 1.0f;
+    phase = mha_complex(frame, 2.0f * frame);
+    plugin.process(&s);
+    // let the writer thread keep up, the fifo holds 16 frames only
+    for (unsigned wait = 0; wait < 1000 &&
+           plugin.peek_config()->get_stream()->get_available_frames() < 8;
+         ++wait)
+      mha_msleep(1);
+  }
+  EXPECT_EQ(0U, plugin.peek_config()->get_stream()->get_dropped_frames());
+  plugin.parse("flush = yes");
+  plugin.release_();
+
+  MHARecFile::reader_t reader(filename);
+  ASSERT_EQ(2U, reader.get_streams().size());
+  EXPECT_EQ("level", reader.get_streams()[0].name);
+  EXPECT_EQ(3U, reader.get_streams()[0].ndim);
+  EXPECT_FALSE(reader.get_streams()[0].is_complex);
+  EXPECT_EQ(1000.0, reader.get_streams()[0].rate);
+  EXPECT_EQ("phase", reader.get_streams()[1].name);
+  EXPECT_EQ(1U, reader.get_streams()[1].ndim);
+  EXPECT_TRUE(reader.get_streams()[1].is_complex);
+  EXPECT_LT(2U, reader.get_index().size());
+  std::vector<stream_data_t> streams = read_all_streams(reader);
+  remove(filename.c_str());
+  ASSERT_EQ(total, streams[0].indices.size());
+  ASSERT_EQ(3 * total, streams[0].data.size());
+  ASSERT_EQ(total, streams[1].indices.size());
+  ASSERT_EQ(2 * total, streams[1].data.size());
+  for (unsigned frame = 0; frame < total; ++frame) {
+    ASSERT_EQ(frame, streams[0].indices[frame]);
+    ASSERT_EQ(frame, streams[1].indices[frame]);
+    EXPECT_EQ(frame, streams[0].data[3 * frame]);
+    EXPECT_EQ(-0.5 * frame, streams[0].data[3 * frame + 1]);
+    EXPECT_EQ(1.0, streams[0].data[3 * frame + 2]);
+    EXPECT_EQ(frame, streams[1].data[2 * frame]);
+    EXPECT_EQ(2.0 * frame, streams[1].data[2 * frame + 1]);
+  }
+  // signal time of frame 320 at 1000 blocks per second
+  EXPECT_EQ(320U, reader.frame_at_time(1, 0.32));
+}
+
+TEST(acsave_t, streaming_restart_closes_previous_recording)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  float level = 0;
+  acspace.insert_var("level", {MHA_AC_FLOAT, 1, 1, &level});
+  testable_acsave_t plugin(acspace, "acsave");
+  plugin.parse("name = " + filename);
+  plugin.parse("streaming = yes");
+  plugin.parse("reclen = 0");
+  plugin.parse("vars = [level]");
+  mhaconfig_t cf = {.channels = 1, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  plugin.prepare_(cf);
+  MHASignal::waveform_t s(16, 1);
+  for (unsigned frame = 0; frame < 50; ++frame) {
+    level = -1.0f;
+    plugin.process(&s);
+  }
+  // starts a new recording into the same file
+  plugin.parse("reclen = 0");
+  for (unsigned frame = 0; frame < 30; ++frame) {
+    level = frame;
+    plugin.process(&s);
+  }
+  plugin.parse("flush = yes");
+  plugin.release_();
+
+  MHARecFile::reader_t reader(filename);
+  std::vector<stream_data_t> streams = read_all_streams(reader);
+  remove(filename.c_str());
+  ASSERT_EQ(1U, streams.size());
+  ASSERT_EQ(30U, streams[0].indices.size());
+  for (unsigned frame = 0; frame < 30; ++frame) {
+    EXPECT_EQ(frame, streams[0].indices[frame]);
+    EXPECT_EQ(frame, streams[0].data[frame]);
+  }
+}
+
+TEST(acsave_t, streaming_without_file_name_is_an_error)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  float level = 0;
+  acspace.insert_var("level", {MHA_AC_FLOAT, 1, 1, &level});
+  testable_acsave_t plugin(acspace, "acsave");
+  plugin.parse("streaming = yes");
+  mhaconfig_t cf = {.channels = 1, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  EXPECT_THROW(plugin.prepare_(cf), MHA_Error);
+}
+
+TEST(stream_writer_t, drops_frames_when_fifo_is_full_and_marks_gap)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  int counter = 0;
+  acspace.insert_var_int("counter", &counter);
+  acsave::save_var_t var("counter", 0, acspace);
+  acsave::stream_writer_t stream(filename, {&var}, 4, 100.0, true);
+  EXPECT_EQ(1U, stream.get_frame_size());
+  // the writer thread has not started yet: only 4 frames fit into the fifo
+  for (unsigned k = 0; k < 10; ++k) {
+    const double frame = k;
+    stream.store(k, &frame);
+  }
+  EXPECT_EQ(6U, stream.get_dropped_frames());
+  // after the writer has emptied the fifo, frames are stored again
+  stream.start();
+  for (unsigned wait = 0; wait < 10000 && stream.get_available_frames() < 4;
+       ++wait)
+    mha_msleep(1);
+  ASSERT_EQ(4U, stream.get_available_frames());
+  for (unsigned k = 10; k < 12; ++k) {
+    const double frame = k;
+    stream.store(k, &frame);
+  }
+  EXPECT_EQ(6U, stream.get_dropped_frames());
+  stream.stop();
+  // frames after stop() are dropped
+  const double frame = 12;
+  stream.store(12, &frame);
+  EXPECT_EQ(7U, stream.get_dropped_frames());
+
+  MHARecFile::reader_t reader(filename);
+  std::vector<stream_data_t> streams = read_all_streams(reader);
+  remove(filename.c_str());
+  ASSERT_EQ(1U, streams.size());
+  const std::vector<uint64_t> expected = {0, 1, 2, 3, 10, 11};
+  ASSERT_EQ(expected.size(), streams[0].indices.size());
+  for (unsigned k = 0; k < expected.size(); ++k) {
+    EXPECT_EQ(expected[k], streams[0].indices[k]);
+    EXPECT_EQ(double(expected[k]), streams[0].data[k]);
+  }
+  EXPECT_LT(1U, reader.get_index().size());
+  // block timestamps are signal times
+  EXPECT_EQ(10U, reader.frame_at_time(0, 0.1));
+}
+
+TEST(stream_writer_t, stop_writes_frames_if_writer_was_not_started)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  int counter = 0;
+  acspace.insert_var_int("counter", &counter);
+  acsave::save_var_t var("counter", 0, acspace);
+  acsave::stream_writer_t stream(filename, {&var}, 4, 100.0, false);
+  for (unsigned k = 0; k < 3; ++k) {
+    const double frame = k;
+    stream.store(k, &frame);
+  }
+  stream.stop();
+
+  MHARecFile::reader_t reader(filename);
+  std::vector<stream_data_t> streams = read_all_streams(reader);
+  remove(filename.c_str());
+  ASSERT_EQ(1U, streams.size());
+  ASSERT_EQ(3U, streams[0].indices.size());
+  for (unsigned k = 0; k < 3; ++k)
+    EXPECT_EQ(double(k), streams[0].data[k]);
+}
+
+TEST(acsave_t, buffered_mode_records_into_memory)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  int counter = 0;
+  acspace.insert_var_int("counter", &counter);
+  std::vector<std::string> names = {"counter"};
+  acsave::cfg_t cfg(acspace, 3, names);
+  EXPECT_EQ(nullptr, cfg.get_stream());
+  for (counter = 1; counter < 6; ++counter)
+    cfg.store_frame();
+  cfg.flush_data(filename, ACSAVE_FMT_TXT);
+  FILE * fh = fopen(filename.c_str(), "r");
+  ASSERT_NE(nullptr, fh);
+  char text[64] = {0};
+  size_t len = fread(text, 1, sizeof(text) - 1, fh);
+  fclose(fh);
+  remove(filename.c_str());
+  EXPECT_EQ("# counter\n1\n2\n3\n\n\n", std::string(text, len));
+  EXPECT_THROW(acsave::cfg_t(acspace, 0, names, filename, 1), MHA_Error);
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
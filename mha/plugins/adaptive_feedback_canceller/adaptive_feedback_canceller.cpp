@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -49,6 +49,10 @@ adaptive_feedback_canceller_config::adaptive_feedback_canceller_config(algo_comm
       fragsize((afc->fragsize.data == 0) ? frames : afc->fragsize.data),
       stepsize(afc->stepsize.data),
       min_const(afc->min_const.data),
+      pbfdaf(afc->engine.data.get_index() == AFC_ENGINE_FREQUENCY ?
+             new MHAFDAF::pbfdaf_t(ntaps, frames, channels, 2) : nullptr),
+      update_power(std::max(ntaps, frames), channels),
+      estim_err_block(frames, channels),
       forward_sig(frames, channels),
       LSsig_initializer(frames, channels),
       LSsig(&LSsig_initializer),
@@ -56,7 +60,7 @@ adaptive_feedback_canceller_config::adaptive_feedback_canceller_config(algo_comm
       delay_forward_path(afc->delay_forward_path.data, channels),
       forward_path_proc(afc->plugloader),
       delay_roundtrip(calcDelayValues(afc->measured_roundtrip_latency.data, fragsize), channels),
-      delay_update(calcDelayValues(afc->measured_roundtrip_latency.data, 1), channels),
+      delay_update(calcDelayValues(afc->measured_roundtrip_latency.data, pbfdaf ? 0 : 1), channels),
       FBfilter_estim(channels, MHAFilter::filter_t(1,1,ntaps)),
       FBfilter_estim_ac(ac, "FBfilter_estim", ntaps, channels, false),
       FBsig_estim(frames, channels),
@@ -129,49 +133,80 @@ mha_wave_t *adaptive_feedback_canceller_config::process(mha_wave_t *MICsig) {
     /* Add a delay before updating the filter, compensating for the roundtrip delay - 1 */
     delay_update.process(&white_LSsig);
 
-    mha_real_t estim_err;
-    for(unsigned kf{0}; kf < frames; kf++) {
-        for(unsigned ch{0}; ch < channels; ch++) {
-            /* Recalculate power of rb_white_LSsig, starting with the existing buffer state
-             * (updating the buffer first and then computing the power will cause the system to explode) */
-            current_power[ch] = 0.0f;
-            for(unsigned tap{0}; tap < ntaps; tap++)
-                current_power[ch] += std::pow(rb_white_LSsig.value(tap,ch),2);
-            /* Calculate the estimation power in the NLMS fashion. */
-            estim_err = stepsize * value(white_ERRsig,kf,ch) / (current_power[ch] + min_const);
-            /* Updating the filter coefficients */
-            if (no_update_count >= n_no_update_) {
-                for(unsigned tap{0}; tap < ntaps; tap++) {
-                    FBfilter_estim[ch].B[tap] += estim_err * rb_white_LSsig.value(ntaps - tap - 1, ch);
-                    make_friendly_number_by_limiting(FBfilter_estim[ch].B[tap]);
+    if (pbfdaf) {
+        /* Power of the update signal and the NLMS gradient, once per block */
+        pbfdaf->push(0, white_LSsig);
+        update_power.push(white_LSsig);
+        for(unsigned kf{0}; kf < frames; kf++)
+            for(unsigned ch{0}; ch < channels; ch++)
+                estim_err_block(kf,ch) = stepsize * value(white_ERRsig,kf,ch) /
+                    (update_power[ch] + min_const);
+        if (no_update_count >= n_no_update_) {
+            pbfdaf->transform_error(estim_err_block);
+            pbfdaf->adapt(0);
+        }
+        if (debug_mode) {
+            for(unsigned kf{0}; kf < frames; kf++)
+                for(unsigned ch{0}; ch < channels; ch++)
+                    current_power_ac.assign(kf,ch,update_power[ch]);
+            estim_err_ac.copy(estim_err_block);
+        }
+    }
+    else {
+        mha_real_t estim_err;
+        for(unsigned kf{0}; kf < frames; kf++) {
+            for(unsigned ch{0}; ch < channels; ch++) {
+                /* Recalculate power of rb_white_LSsig, starting with the existing buffer state
+                 * (updating the buffer first and then computing the power will cause the system to explode) */
+                current_power[ch] = 0.0f;
+                for(unsigned tap{0}; tap < ntaps; tap++)
+                    current_power[ch] += std::pow(rb_white_LSsig.value(tap,ch),2);
+                /* Calculate the estimation power in the NLMS fashion. */
+                estim_err = stepsize * value(white_ERRsig,kf,ch) / (current_power[ch] + min_const);
+                /* Updating the filter coefficients */
+                if (no_update_count >= n_no_update_) {
+                    for(unsigned tap{0}; tap < ntaps; tap++) {
+                        FBfilter_estim[ch].B[tap] += estim_err * rb_white_LSsig.value(ntaps - tap - 1, ch);
+                        make_friendly_number_by_limiting(FBfilter_estim[ch].B[tap]);
+                    }
                 }
+                /* If you set debug_mode to yes in your configuration this will update AC-variables
+                 * to be monitored later. */
+                if (debug_mode) {
+                    current_power_ac.assign(kf,ch,current_power[ch]);
+                    estim_err_ac.assign(kf,ch,estim_err);
+                }
+                /* Add new value to a one-sample wave_t object that will eventually be written into
+                 * rb_white_LSsig. */
+                white_LSsig_smpl.buf[ch] = white_LSsig.value(kf,ch);
             }
-            /* If you set debug_mode to yes in your configuration this will update AC-variables
-             * to be monitored later. */
-            if (debug_mode) {
-                current_power_ac.assign(kf,ch,current_power[ch]);
-                estim_err_ac.assign(kf,ch,estim_err);
-            }
-            /* Add new value to a one-sample wave_t object that will eventually be written into
-             * rb_white_LSsig. */
-            white_LSsig_smpl.buf[ch] = white_LSsig.value(kf,ch);
+            /* The contents of rb_white_LSsig are updated here because we still needed the oldest value to compute
+             * current_power. */
+            rb_white_LSsig.discard(1);
+            rb_white_LSsig.write(white_LSsig_smpl);
         }
-        /* The contents of rb_white_LSsig are updated here because we still needed the oldest value to compute
-         * current_power. */
-        rb_white_LSsig.discard(1);
-        rb_white_LSsig.write(white_LSsig_smpl);
     }
 
     /* Add a delay before filtering the loudspeaker signal, compensating for the roundtrip delay - fragsize */
     delay_roundtrip.process(LSsig);
 
-    for(unsigned ch{0}; ch < channels; ch++) {
-        /* Applying the filter to the delayed output signal */
-        FBfilter_estim[ch].filter(FBsig_estim.buf,LSsig->buf,LSsig->num_frames,1,1,ch,ch+1);
-        if (debug_mode) {
-            for(unsigned tap{0}; tap < ntaps; tap++) {
-                /* Writing the filter coefficients to the AC variable to be accessible from outside */
-                FBfilter_estim_ac.assign(tap,ch,FBfilter_estim[ch].B[tap]);
+    if (pbfdaf) {
+        /* Applying the partitioned filter to the delayed output signal */
+        pbfdaf->push(1, *LSsig);
+        pbfdaf->filter(1, FBsig_estim);
+        if (debug_mode)
+            FBfilter_estim_ac.copy(pbfdaf->taps());
+    }
+    else {
+        for(unsigned ch{0}; ch < channels; ch++) {
+            /* Applying the filter to the delayed output signal */
+            /* Each filter has one channel, frames of the interleaved signals are channels apart */
+            FBfilter_estim[ch].filter(FBsig_estim.buf+ch,LSsig->buf+ch,LSsig->num_frames,channels,1,0,1);
+            if (debug_mode) {
+                for(unsigned tap{0}; tap < ntaps; tap++) {
+                    /* Writing the filter coefficients to the AC variable to be accessible from outside */
+                    FBfilter_estim_ac.assign(tap,ch,FBfilter_estim[ch].B[tap]);
+                }
             }
         }
     }
@@ -204,6 +239,9 @@ adaptive_feedback_canceller(MHA_AC::algo_comm_t & iac,
       stepsize("Step size","0.01","]0,2]"),
       min_const("Regularization parameter","1e-20","]0,]"),
       filter_length("Length of the feedback path filter in taps","32","]0,]"),
+      engine("Adaptation engine: NLMS in the time domain, sample by sample, or partitioned"
+             " block frequency domain adaptive filter with partitions of one fragment",
+             "time", AFC_ENGINES),
       plugloader(*this,ac),
       fragsize("Fragsize used for internal delay computation, defaults to MHA's fragsize", "0", "[0,["),
       measured_roundtrip_latency("Latency between playback and recording of the same signal", "0", "[0,["),
@@ -220,6 +258,7 @@ adaptive_feedback_canceller(MHA_AC::algo_comm_t & iac,
     INSERT_PATCH(stepsize);
     INSERT_PATCH(min_const);
     INSERT_PATCH(filter_length);
+    INSERT_PATCH(engine);
     INSERT_PATCH(fragsize);
     INSERT_PATCH(measured_roundtrip_latency);
     INSERT_PATCH(delay_forward_path);
@@ -358,6 +397,15 @@ MHAPLUGIN_DOCUMENTATION\
  "to find out what works best, but it is recommended to keep the value below 0.2 (see [2]). "
  "\\emph{min\\_const} is a regularization parameter to avoid division by zero. It should be kept as low as possible to not "
  "interfere with the adaption at low output levels. \n \\\\"
+ "With \\emph{engine} set to \\texttt{frequency}, the feedback path filter is estimated and applied by a "
+ "partitioned block frequency domain adaptive filter (multi-delay filter) instead. The filter is split into "
+ "partitions of one fragment, which are applied by overlap-save with FFTs of two fragments, and the filter is "
+ "updated once per \\texttt{process()} callback with the NLMS gradient of the whole block, constrained to "
+ "\\emph{filter\\_length} taps. The step size is normalized by the power of the update signal over the last "
+ "\\emph{filter\\_length} samples, or over the last fragment if the filter is shorter. The delays and the "
+ "forward path processing are the same for both engines, and no additional latency is introduced. "
+ "For feedback paths of 64 to 256 taps, the frequency domain engine needs only a fraction of the computation "
+ "time of the time domain engine. \n \\\\"
  "This plugin performs feedback cancellation for each channel seperately. A channel here is meant as a loudspeaker-microphone pair. "
  "Therefore, you must have the same number of input and output channels. Please refer to \\textit{openMHA/examples/31-adaptive-feedback-canceller} "
  "for usage examples of the plugin. \n"
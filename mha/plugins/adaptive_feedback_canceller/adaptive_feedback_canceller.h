@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2017 2018 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -17,10 +17,16 @@
 #ifndef ADAPTIVE_FEEDBACK_CANCELLER_H
 #define ADAPTIVE_FEEDBACK_CANCELLER_H
 
+#include "mha_fdaf.hh"
 #include "mha_filter.hh"
 #include "mha_plugin.hh"
 #include "mhapluginloader.h"
+#include <memory>
 
+// Adaptation engines, see adaptive_feedback_canceller::engine
+#define AFC_ENGINES "[time frequency]"
+#define AFC_ENGINE_TIME 0
+#define AFC_ENGINE_FREQUENCY 1
 
 class adaptive_feedback_canceller;
 
@@ -71,6 +77,14 @@ private:
     const mha_real_t stepsize;
     /** Minimum constant to prevent division by zero in the NLMS-Algorithm */
     const mha_real_t min_const;
+    /** Frequency domain adaptation engine, only allocated if selected.
+     *  Input 0 is the update signal, input 1 the loudspeaker signal. */
+    std::unique_ptr<MHAFDAF::pbfdaf_t> pbfdaf;
+    /** Power of the update signal for the frequency domain engine, over the last
+     *  @ref ntaps samples, or over the last block if the filter is shorter */
+    MHAFDAF::power_t update_power;
+    /** Normalized error block of the frequency domain engine */
+    MHASignal::waveform_t estim_err_block;
 
     /** Copy of error signal that is channeled into the forward path processing */
     MHASignal::waveform_t forward_sig;
@@ -99,7 +113,9 @@ private:
      */
     MHASignal::delay_t delay_roundtrip;
     /* Delay line equal to @ref delay_roundtrip + @ref fragsize - 1. It is used on the loudspeaker
-     * signal white_LSsig before using it to update the filter estimation.
+     * signal white_LSsig before using it to update the filter estimation. The frequency domain
+     * engine pairs the error with the update signal of the same sample, it uses one sample more
+     * to match the time domain update.
      */
     MHASignal::delay_t delay_update;
     /* Vector of estimated feedback filters, one filter per audio channel.
@@ -179,6 +195,9 @@ public:
     MHAParser::float_t min_const;
     /* length of the estimated filter */
     MHAParser::int_t filter_length;
+    /** Adaptation engine: time domain NLMS, sample by sample, or
+     *  partitioned block frequency domain adaptive filter (see @ref MHAFDAF::pbfdaf_t) */
+    MHAParser::kw_t engine;
     /** Plugin loader that loads the plugin needed to simulate the hearing aid in the
      *  forward processing path.
      */
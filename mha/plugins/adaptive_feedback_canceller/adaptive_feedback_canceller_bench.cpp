@@ -0,0 +1,207 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Prints the computational load of the backward path of
+// adaptive_feedback_canceller with the time domain and the frequency
+// domain engine, relative to real time at 48 kHz.
+
+#include "adaptive_feedback_canceller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    /// Reproducible white noise in [-1,1]
+    class noise_t {
+    public:
+        mha_real_t operator()() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+    private:
+        uint32_t state = 4711U;
+    };
+
+    /// The backward path of adaptive_feedback_canceller_config::process
+    /// with the time domain engine
+    class time_domain_t {
+    public:
+        time_domain_t(unsigned ntaps, unsigned channels)
+            : ntaps(ntaps), channels(channels),
+              filter(channels, MHAFilter::filter_t(1,1,ntaps)),
+              smpl(1, channels), rb(ntaps, channels, ntaps),
+              power(channels, 0.0f)
+        {
+            for (auto & f : filter)
+                f.B[0] = 0.0;
+        }
+        void update(const mha_wave_t & x, const mha_wave_t & e,
+                    mha_real_t stepsize, mha_real_t min_const) {
+            for (unsigned kf = 0; kf < x.num_frames; kf++) {
+                for (unsigned ch = 0; ch < channels; ch++) {
+                    power[ch] = 0.0f;
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        power[ch] += std::pow(rb.value(tap,ch),2);
+                    const mha_real_t estim_err =
+                        stepsize * value(e,kf,ch) / (power[ch] + min_const);
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        filter[ch].B[tap] += estim_err * rb.value(ntaps - tap - 1, ch);
+                    smpl.buf[ch] = value(x,kf,ch);
+                }
+                rb.discard(1);
+                rb.write(smpl);
+            }
+        }
+        void process(const mha_wave_t & ls, mha_wave_t & fb) {
+            for (unsigned ch = 0; ch < channels; ch++)
+                filter[ch].filter(fb.buf + ch, ls.buf + ch, ls.num_frames,
+                                  channels, 1, 0, 1);
+        }
+        unsigned ntaps, channels;
+        std::vector<MHAFilter::filter_t> filter;
+    private:
+        MHASignal::waveform_t smpl;
+        MHASignal::ringbuffer_t rb;
+        std::vector<mha_real_t> power;
+    };
+
+    /// The backward path of adaptive_feedback_canceller_config::process
+    /// with the frequency domain engine
+    class frequency_domain_t {
+    public:
+        frequency_domain_t(unsigned ntaps, unsigned frames, unsigned channels)
+            : fdaf(ntaps, frames, channels, 2),
+              power(std::max(ntaps, frames), channels),
+              estim_err(frames, channels)
+        {}
+        void update(const mha_wave_t & x, const mha_wave_t & e,
+                    mha_real_t stepsize, mha_real_t min_const, bool adapt) {
+            fdaf.push(0, x);
+            power.push(x);
+            for (unsigned kf = 0; kf < x.num_frames; kf++)
+                for (unsigned ch = 0; ch < x.num_channels; ch++)
+                    estim_err(kf, ch) = stepsize * value(e, kf, ch) /
+                        (power[ch] + min_const);
+            if (adapt) {
+                fdaf.transform_error(estim_err);
+                fdaf.adapt(0);
+            }
+        }
+        void process(const mha_wave_t & ls, mha_wave_t & fb) {
+            fdaf.push(1, ls);
+            fdaf.filter(1, fb);
+        }
+        MHAFDAF::pbfdaf_t fdaf;
+        MHAFDAF::power_t power;
+    private:
+        MHASignal::waveform_t estim_err;
+    };
+
+    /// Feedback path response, ntaps taps, channel ch gets gain ch+1
+    mha_real_t feedback_path(unsigned tap, unsigned ch) {
+        return (ch + 1) * 0.5f * std::exp(-0.15f * tap) * std::sin(0.7f * tap + 0.3f);
+    }
+
+    /** Open loop feedback path identification with the delays of the
+     *  plugin for a roundtrip latency of one block: the loudspeaker
+     *  signal is filtered without delay and the estimate is subtracted
+     *  in the next block.  The update signal is delayed by frames - 1
+     *  for the time domain engine and by frames for the frequency
+     *  domain engine. */
+    class scenario_t {
+    public:
+        scenario_t(unsigned ntaps, unsigned frames, unsigned channels,
+                   unsigned update_delay)
+            : ntaps(ntaps), frames(frames), channels(channels),
+              ls(frames, channels), x(frames, channels), mic(frames, channels),
+              err(frames, channels), fb(frames, channels),
+              delay_update(std::vector<int>(channels, update_delay), channels),
+              history(ntaps + frames, channels)
+        {}
+        /// New loudspeaker block and the microphone signal it causes one
+        /// block later, then the error with the estimate of the last block
+        void next_block() {
+            for (unsigned kf = 0; kf < frames; kf++)
+                for (unsigned ch = 0; ch < channels; ch++) {
+                    for (unsigned k = history.num_frames - 1; k > 0; --k)
+                        history(k, ch) = history(k - 1, ch);
+                    // the loudspeaker sample of one block ago
+                    mha_real_t & s = history(0, ch);
+                    s = ls(kf, ch);
+                    ls(kf, ch) = noise();
+                    mic(kf, ch) = 0;
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        mic(kf, ch) += feedback_path(tap, ch) * history(tap, ch);
+                }
+            // estimate is from the previous block
+            err.copy(mic);
+            err -= fb;
+            x.copy(ls);
+            delay_update.process(&x);
+        }
+        unsigned ntaps, frames, channels;
+        MHASignal::waveform_t ls, x, mic, err, fb;
+    private:
+        MHASignal::delay_t delay_update;
+        MHASignal::waveform_t history;
+        noise_t noise;
+    };
+}
+
+int main()
+{
+    const unsigned channels = 2, blocks = 2000;
+    for (unsigned frames : {16U, 64U})
+        for (unsigned ntaps : {64U, 128U, 256U}) {
+            scenario_t freq(ntaps, frames, channels, frames);
+            scenario_t time(ntaps, frames, channels, frames - 1);
+            freq.next_block();
+            time.next_block();
+            frequency_domain_t fd(ntaps, frames, channels);
+            time_domain_t td(ntaps, channels);
+            auto measure = [&](auto && process) {
+                auto start = std::chrono::steady_clock::now();
+                for (unsigned b = 0; b < blocks; ++b)
+                    process();
+                std::chrono::duration<double> t =
+                    std::chrono::steady_clock::now() - start;
+                return t.count() / blocks * 1e6;
+            };
+            const double t_time = measure([&]{
+                td.update(time.x, time.err, 0.01f, 1e-20f);
+                td.process(time.ls, time.fb);
+            });
+            const double t_freq = measure([&]{
+                fd.update(freq.x, freq.err, 0.01f, 1e-20f, true);
+                fd.process(freq.ls, freq.fb);
+            });
+            const double block_us = frames / 48000.0 * 1e6;
+            std::cout << ntaps << " taps, fragsize " << frames << ", "
+                      << channels << " channels: time domain " << t_time
+                      << " us/block (" << 100 * t_time / block_us
+                      << "% load), frequency domain " << t_freq
+                      << " us/block (" << 100 * t_freq / block_us
+                      << "% load)" << std::endl;
+        }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
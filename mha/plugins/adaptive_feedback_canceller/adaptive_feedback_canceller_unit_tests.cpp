@@ -0,0 +1,229 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "adaptive_feedback_canceller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    /// Reproducible white noise in [-1,1]
+    class noise_t {
+    public:
+        mha_real_t operator()() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+    private:
+        uint32_t state = 4711U;
+    };
+
+    /// The backward path of adaptive_feedback_canceller_config::process
+    /// with the time domain engine
+    class time_domain_t {
+    public:
+        time_domain_t(unsigned ntaps, unsigned channels)
+            : ntaps(ntaps), channels(channels),
+              filter(channels, MHAFilter::filter_t(1,1,ntaps)),
+              smpl(1, channels), rb(ntaps, channels, ntaps),
+              power(channels, 0.0f)
+        {
+            for (auto & f : filter)
+                f.B[0] = 0.0;
+        }
+        void update(const mha_wave_t & x, const mha_wave_t & e,
+                    mha_real_t stepsize, mha_real_t min_const) {
+            for (unsigned kf = 0; kf < x.num_frames; kf++) {
+                for (unsigned ch = 0; ch < channels; ch++) {
+                    power[ch] = 0.0f;
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        power[ch] += std::pow(rb.value(tap,ch),2);
+                    const mha_real_t estim_err =
+                        stepsize * value(e,kf,ch) / (power[ch] + min_const);
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        filter[ch].B[tap] += estim_err * rb.value(ntaps - tap - 1, ch);
+                    smpl.buf[ch] = value(x,kf,ch);
+                }
+                rb.discard(1);
+                rb.write(smpl);
+            }
+        }
+        void process(const mha_wave_t & ls, mha_wave_t & fb) {
+            for (unsigned ch = 0; ch < channels; ch++)
+                filter[ch].filter(fb.buf + ch, ls.buf + ch, ls.num_frames,
+                                  channels, 1, 0, 1);
+        }
+        unsigned ntaps, channels;
+        std::vector<MHAFilter::filter_t> filter;
+    private:
+        MHASignal::waveform_t smpl;
+        MHASignal::ringbuffer_t rb;
+        std::vector<mha_real_t> power;
+    };
+
+    /// The backward path of adaptive_feedback_canceller_config::process
+    /// with the frequency domain engine
+    class frequency_domain_t {
+    public:
+        frequency_domain_t(unsigned ntaps, unsigned frames, unsigned channels)
+            : fdaf(ntaps, frames, channels, 2),
+              power(std::max(ntaps, frames), channels),
+              estim_err(frames, channels)
+        {}
+        void update(const mha_wave_t & x, const mha_wave_t & e,
+                    mha_real_t stepsize, mha_real_t min_const, bool adapt) {
+            fdaf.push(0, x);
+            power.push(x);
+            for (unsigned kf = 0; kf < x.num_frames; kf++)
+                for (unsigned ch = 0; ch < x.num_channels; ch++)
+                    estim_err(kf, ch) = stepsize * value(e, kf, ch) /
+                        (power[ch] + min_const);
+            if (adapt) {
+                fdaf.transform_error(estim_err);
+                fdaf.adapt(0);
+            }
+        }
+        void process(const mha_wave_t & ls, mha_wave_t & fb) {
+            fdaf.push(1, ls);
+            fdaf.filter(1, fb);
+        }
+        MHAFDAF::pbfdaf_t fdaf;
+        MHAFDAF::power_t power;
+    private:
+        MHASignal::waveform_t estim_err;
+    };
+
+    /// Feedback path response, ntaps taps, channel ch gets gain ch+1
+    mha_real_t feedback_path(unsigned tap, unsigned ch) {
+        return (ch + 1) * 0.5f * std::exp(-0.15f * tap) * std::sin(0.7f * tap + 0.3f);
+    }
+
+    /** Open loop feedback path identification with the delays of the
+     *  plugin for a roundtrip latency of one block: the loudspeaker
+     *  signal is filtered without delay and the estimate is subtracted
+     *  in the next block.  The update signal is delayed by frames - 1
+     *  for the time domain engine and by frames for the frequency
+     *  domain engine. */
+    class scenario_t {
+    public:
+        scenario_t(unsigned ntaps, unsigned frames, unsigned channels,
+                   unsigned update_delay)
+            : ntaps(ntaps), frames(frames), channels(channels),
+              ls(frames, channels), x(frames, channels), mic(frames, channels),
+              err(frames, channels), fb(frames, channels),
+              delay_update(std::vector<int>(channels, update_delay), channels),
+              history(ntaps + frames, channels)
+        {}
+        /// New loudspeaker block and the microphone signal it causes one
+        /// block later, then the error with the estimate of the last block
+        void next_block() {
+            for (unsigned kf = 0; kf < frames; kf++)
+                for (unsigned ch = 0; ch < channels; ch++) {
+                    for (unsigned k = history.num_frames - 1; k > 0; --k)
+                        history(k, ch) = history(k - 1, ch);
+                    // the loudspeaker sample of one block ago
+                    mha_real_t & s = history(0, ch);
+                    s = ls(kf, ch);
+                    ls(kf, ch) = noise();
+                    mic(kf, ch) = 0;
+                    for (unsigned tap = 0; tap < ntaps; tap++)
+                        mic(kf, ch) += feedback_path(tap, ch) * history(tap, ch);
+                }
+            // estimate is from the previous block
+            err.copy(mic);
+            err -= fb;
+            x.copy(ls);
+            delay_update.process(&x);
+        }
+        unsigned ntaps, frames, channels;
+        MHASignal::waveform_t ls, x, mic, err, fb;
+    private:
+        MHASignal::delay_t delay_update;
+        MHASignal::waveform_t history;
+        noise_t noise;
+    };
+
+    mha_real_t misalignment(const mha_wave_t & taps, unsigned ch) {
+        mha_real_t num = 0, den = 0;
+        for (unsigned tap = 0; tap < taps.num_frames; tap++) {
+            const mha_real_t h = feedback_path(tap, ch);
+            num += (h - value(taps, tap, ch)) * (h - value(taps, tap, ch));
+            den += h * h;
+        }
+        return 10 * std::log10(num / den);
+    }
+}
+
+TEST(adaptive_feedback_canceller, frequency_engine_identifies_feedback_path_like_time_engine)
+{
+    // 40 taps in partitions of 16, the last partition is incomplete
+    const unsigned ntaps = 40, frames = 16, channels = 2, blocks = 300;
+    scenario_t freq(ntaps, frames, channels, frames);
+    scenario_t time(ntaps, frames, channels, frames - 1);
+    frequency_domain_t fd(ntaps, frames, channels);
+    EXPECT_EQ(3U, fd.fdaf.partitions());
+    time_domain_t td(ntaps, channels);
+    MHASignal::waveform_t td_taps(ntaps, channels);
+    for (unsigned b = 0; b < blocks; ++b) {
+        freq.next_block();
+        fd.update(freq.x, freq.err, 0.1f, 1e-20f, true);
+        fd.process(freq.ls, freq.fb);
+        time.next_block();
+        td.update(time.x, time.err, 0.1f, 1e-20f);
+        td.process(time.ls, time.fb);
+    }
+    for (unsigned ch = 0; ch < channels; ++ch) {
+        for (unsigned tap = 0; tap < ntaps; ++tap)
+            td_taps(tap, ch) = td.filter[ch].B[tap];
+        const mha_real_t m_freq = misalignment(fd.fdaf.taps(), ch);
+        const mha_real_t m_time = misalignment(td_taps, ch);
+        EXPECT_LT(m_time, -30.0f);
+        // block adaptation converges like the sample by sample NLMS
+        EXPECT_NEAR(m_time, m_freq, 3.0f) << "channel " << ch;
+    }
+    // the estimate of the last block cancels the feedback
+    mha_real_t rms_err = 0;
+    for (unsigned k = 0; k < frames * channels; ++k)
+        rms_err += freq.err.buf[k] * freq.err.buf[k];
+    EXPECT_LT(std::sqrt(rms_err / (frames * channels)), 0.02f);
+}
+
+TEST(adaptive_feedback_canceller, frequency_engine_without_update_keeps_filter)
+{
+    // the filter is shorter than a block
+    const unsigned ntaps = 32, frames = 64, channels = 1;
+    scenario_t sc(ntaps, frames, channels, frames);
+    frequency_domain_t fd(ntaps, frames, channels);
+    EXPECT_EQ(1U, fd.fdaf.partitions());
+    for (unsigned b = 0; b < 5; ++b) {
+        sc.next_block();
+        fd.update(sc.x, sc.err, 0.5f, 1e-20f, false);
+        fd.process(sc.ls, sc.fb);
+        for (unsigned kf = 0; kf < frames; ++kf)
+            EXPECT_EQ(0.0f, value(sc.fb, kf, 0));
+    }
+    // the normalization covers one block of the update signal
+    mha_real_t power = 0;
+    for (unsigned kf = 0; kf < frames; ++kf)
+        power += value(sc.x, kf, 0) * value(sc.x, kf, 0);
+    EXPECT_NEAR(power, fd.power[0], 1e-4f);
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2008 2009 2010 2013 2011 2014 2015 HörTech gGmbH
 // Copyright © 2016 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2021 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2021 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -264,33 +264,24 @@ dc_t::dc_t(dc_vars_t vars,
     nch(nch_),
     level_in_db(ac,algo+"_l_in",nbands,naudiochannels,false),
     level_in_db_adjusted(ac,algo+"_l_in_adj",nbands,naudiochannels,false),
+    frame_level_db(1,nch),
+    frame_level_adjusted(1,nch),
+    frame_gain(1,nch),
     fftlen(fftlen_)
 {
     if( nbands * naudiochannels != nch )
         throw MHA_Error(__FILE__,__LINE__,
                         "Mismatching channel configuration (%u bands, %u input channels, %u audio channels)",
                         nbands,nch,naudiochannels);
-    unsigned int k,klev;
-    gt.resize(nch);
-    mha_real_t inlev;
-    for(k=0; k<nch; k++){
-        gt[k].clear();
-        inlev = vars.gtmin.data[k];
-        if (log_interp){
-            for(klev=0;klev<vars.gtdata.data[k].size();klev++){
-                gt[k].add_entry(vars.gtdata.data[k][klev]);
-                inlev += vars.gtstep.data[k];
-            }
-        }
-        else {
-            for(klev=0;klev<vars.gtdata.data[k].size();klev++){
-                gt[k].add_entry(MHASignal::db2lin(vars.gtdata.data[k][klev]));
-                inlev += vars.gtstep.data[k];
-            }
-        }
-        gt[k].set_xmin( vars.gtmin.data[k] );
-        gt[k].set_xmax( inlev );
-        gt[k].prepare();
+    if( offset.empty() )
+        offset.resize(nch,0.0f);
+    std::vector<mha_real_t> gains;
+    for(unsigned int k=0; k<nch; k++){
+        gains = vars.gtdata.data[k];
+        if (!log_interp)
+            for(auto & g : gains)
+                g = MHASignal::db2lin(g);
+        gt.add_band(gains, vars.gtmin.data[k], vars.gtstep.data[k]);
     }
 }
 
@@ -339,29 +330,42 @@ void dc_t::explicit_insert()
 mha_wave_t* dc_t::process(mha_wave_t* s)
 {
     explicit_insert();
-    mha_real_t level_in, gain;
-    unsigned int k, ch, kfb, idx, ch_idx = 0;
-    if( s->num_channels != gt.size() )
+    unsigned int k, ch, kfb, ch_idx = 0;
+    if( s->num_channels != gt.nbands() )
         throw MHA_Error(__FILE__,__LINE__,
-                        "The audio channel number changed from %zu to %u.",
-                        gt.size(), s->num_channels);
+                        "The audio channel number changed from %u to %u.",
+                        gt.nbands(), s->num_channels);
+    mha_real_t * frame_db = frame_level_db.buf;
+    mha_real_t * frame_adj = frame_level_adjusted.buf;
+    mha_real_t * gain = frame_gain.buf;
     for(k=0;k<s->num_frames;k++){
+        // level filters are applied to all bands of this frame together
+        const mha_real_t * x = s->buf + k*nch;
+        for(ch_idx=0;ch_idx<nch;ch_idx++)
+            frame_db[ch_idx] = x[ch_idx]*x[ch_idx];
+        rmslevel.process_frame(frame_db, frame_db);
+        for(ch_idx=0;ch_idx<nch;ch_idx++)
+            frame_db[ch_idx] = MHASignal::pa22dbspl(frame_db[ch_idx]);
+        attack.process_frame(frame_db, frame_adj);
+        decay.process_frame(frame_adj, frame_adj);
         for(kfb=0;kfb<nbands;kfb++){
             for(ch=0;ch<naudiochannels;ch++){
                 ch_idx = kfb + nbands*ch;
-                idx = k*s->num_channels + ch_idx;
-                level_in = rmslevel(ch_idx, s->buf[idx]*s->buf[idx]);
-                level_in_db.value(kfb,ch) = MHASignal::pa22dbspl(level_in);
-                level_in_db_adjusted.value(kfb,ch)=decay(ch_idx,attack(ch_idx, MHASignal::pa22dbspl(level_in)));
-                if (bypass) continue;
-                gain = gt[ch_idx].interp( level_in_db_adjusted.value(kfb,ch) + (offset.size() ? offset[ch_idx] : 0));
-                if(log_interp)
-                    gain = MHASignal::db2lin(gain);
-                if( gain < 0 )
-                    gain = 0;
-                s->buf[idx] *= gain;
+                level_in_db.value(kfb,ch) = frame_db[ch_idx];
+                level_in_db_adjusted.value(kfb,ch) = frame_adj[ch_idx];
             }
         }
+        if (bypass) continue;
+        // gains of all bands of this frame are looked up together
+        for(ch_idx=0;ch_idx<nch;ch_idx++)
+            gain[ch_idx] = frame_adj[ch_idx] + offset[ch_idx];
+        gt.interp(gain, gain);
+        if(log_interp)
+            for(ch_idx=0;ch_idx<nch;ch_idx++)
+                gain[ch_idx] = MHASignal::db2lin(gain[ch_idx]);
+        mha_real_t * y = s->buf + k*nch;
+        for(ch_idx=0;ch_idx<nch;ch_idx++)
+            y[ch_idx] *= std::max(gain[ch_idx], 0.0f);
     }
     return s;
 }
@@ -369,34 +373,40 @@ mha_wave_t* dc_t::process(mha_wave_t* s)
 mha_spec_t* dc_t::process(mha_spec_t* s)
 {
     explicit_insert();
-    mha_real_t level_in, gain;
     unsigned int k, ch, kfb, ch_idx;
-    if( s->num_channels != gt.size() )
+    if( s->num_channels != gt.nbands() )
         throw MHA_Error(__FILE__,__LINE__,
-                        "The audio channel number changed from %zu to %u.",
-                        gt.size(), s->num_channels);
+                        "The audio channel number changed from %u to %u.",
+                        gt.nbands(), s->num_channels);
+    mha_real_t * frame_db = frame_level_db.buf;
+    mha_real_t * frame_adj = frame_level_adjusted.buf;
+    mha_real_t * gain = frame_gain.buf;
+    for(ch_idx=0;ch_idx<nch;ch_idx++)
+        frame_db[ch_idx] = MHASignal::pa22dbspl(
+            MHASignal::colored_intensity(*s, ch_idx, fftlen, 0));
+    attack.process_frame(frame_db, frame_adj);
+    decay.process_frame(frame_adj, frame_adj);
     for(kfb=0;kfb<nbands;kfb++){
         for(ch=0;ch<naudiochannels;ch++){
             ch_idx = kfb + nbands*ch;
-            level_in = MHASignal::colored_intensity(*s, ch_idx, fftlen, 0);
-            level_in_db.value(kfb,ch) = MHASignal::pa22dbspl(level_in);
-            level_in_db_adjusted.value(kfb,ch)=decay(ch_idx,attack(ch_idx,MHASignal::pa22dbspl(level_in)));
+            level_in_db.value(kfb,ch) = frame_db[ch_idx];
+            level_in_db_adjusted.value(kfb,ch) = frame_adj[ch_idx];
         }
     }
     // apply gains:
     if (bypass) return s;
-    for(ch=0;ch<naudiochannels;ch++)
-        for(kfb=0;kfb<nbands;kfb++){
-            ch_idx = kfb + nbands*ch;
-            gain = gt[ch_idx].interp(level_in_db_adjusted.value(kfb,ch) + (offset.size() ? offset[ch_idx] : 0));
-            if (log_interp)
-                gain = MHASignal::db2lin(gain);
-            if( gain < 0 )
-                gain = 0;
-            for(k=0;k<s->num_frames;k++){
-                value(s,k,ch_idx) *= gain;
-            }
+    for(ch_idx=0;ch_idx<nch;ch_idx++)
+        gain[ch_idx] = frame_adj[ch_idx] + offset[ch_idx];
+    gt.interp(gain, gain);
+    for(ch_idx=0;ch_idx<nch;ch_idx++){
+        if (log_interp)
+            gain[ch_idx] = MHASignal::db2lin(gain[ch_idx]);
+        if( gain[ch_idx] < 0 )
+            gain[ch_idx] = 0;
+        for(k=0;k<s->num_frames;k++){
+            value(s,k,ch_idx) *= gain[ch_idx];
         }
+    }
     return s;
 }
 
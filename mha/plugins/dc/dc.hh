@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2008 2009 2010 2013 2011 2014 2015 HörTech gGmbH
 // Copyright © 2016 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2021 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2021 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -186,11 +186,12 @@ namespace dc {
         }
 
     private:
-        /** Dynamic compression gains. If \c log_interp is true, then they are
-         * stored as dB gains, otherwise they are stored as linear gains. */
-        std::vector<MHATableLookup::linear_table_t> gt;
+        /** Dynamic compression gains, one table band for each channel.
+         * If \c log_interp is true, then they are stored as dB gains,
+         * otherwise they are stored as linear gains. */
+        MHATableLookup::uniform_grid_table_t gt;
         /** band-specific dB offsets added to measured input levels before
-         * gain lookup is performed. */
+         * gain lookup is performed.  Zeros if no offsets are configured. */
         std::vector<mha_real_t> offset;
         /** Envelope extraction filters used in waveform processing. */
         MHAFilter::o1flt_lowpass_t rmslevel;
@@ -212,6 +213,15 @@ namespace dc {
         MHA_AC::waveform_t level_in_db;
         /** Matrix of latest input levels after attack/decay filter. */
         MHA_AC::waveform_t level_in_db_adjusted;
+        /** Scratch buffer: input levels of all bands of one frame, in the
+         * channel order of the signal, before attack/decay filter. */
+        MHASignal::waveform_t frame_level_db;
+        /** Scratch buffer: input levels of all bands of one frame, in the
+         * channel order of the signal, after attack/decay filter. */
+        MHASignal::waveform_t frame_level_adjusted;
+        /** Scratch buffer: gains of all bands of one frame, in the
+         * channel order of the signal. */
+        MHASignal::waveform_t frame_gain;
         /** FFT length in samples, required for computing levels correctly. */
         unsigned int fftlen;
     };
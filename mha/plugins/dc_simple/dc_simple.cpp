@@ -1,7 +1,7 @@
 // This file is part of the open HörTech Master Hearing Aid (openMHA)
 // Copyright © 2007 2008 2009 2010 2013 2014 2015 2017 2018 2019 HörTech gGmbH
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -243,10 +243,13 @@ dc_t::dc_t(const dc_vars_t& vars,
 
 mha_wave_t* level_smoother_t::process(mha_wave_t* s)
 {
-    unsigned int t, k;
-    for(k=0;k<nbands;k++)
-        for(t=0;t<s->num_frames;t++)
-            level_wave(t,k) = decay(k,attack(k,MHASignal::pa2dbspl(fabsf(value(s,t,k)),1e-10f)));
+    MHA_assert_equal(s->num_channels,nbands);
+    MHA_assert_equal(s->num_frames,level_wave.num_frames);
+    const unsigned int n = s->num_frames * nbands;
+    for(unsigned int idx=0;idx<n;idx++)
+        level_wave.buf[idx] = MHASignal::pa2dbspl(fabsf(s->buf[idx]),1e-10f);
+    attack.process(level_wave);
+    decay.process(level_wave);
     return &level_wave;
 }
 
@@ -277,8 +280,11 @@ mha_wave_t* dc_t::process(mha_wave_t* s, mha_wave_t* level_db)
 
 mha_wave_t* level_smoother_t::process(mha_spec_t* s)
 {
+    MHA_assert_equal(s->num_channels,nbands);
     for(unsigned int k=0;k<s->num_channels;k++)
-        level_spec.buf[k] = decay(k,attack(k,MHASignal::pa2dbspl(MHASignal::rmslevel(*s,k,fftlen), 1e-10f)));
+        level_spec.buf[k] = MHASignal::pa2dbspl(MHASignal::rmslevel(*s,k,fftlen), 1e-10f);
+    attack.process(level_spec);
+    decay.process(level_spec);
     return &level_spec;
 }
 
@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2009 2010 2013 2014 2015 2018 2019 2020 HörTech gGmbH
 // Copyright © 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,117 +15,116 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_signal.hh"
-#include "mha_parser.hh"
+#include "gtfb_analyzer.hh"
 #include "mha_defs.h"
+#include <limits>
 #include <math.h>
-#include <time.h>
-#include "mha_events.h"
-#include "mha_filter.hh"
-
 
 /**
    \file   gtfb_analyzer.cpp
    \brief  Gammatone Filterbank Analyzer Plugin
 */
 
-namespace gtfb_analyzer {
-/// Configuration for Gammatone Filterbank Analyzer.
-struct gtfb_analyzer_cfg_t {
-
-    /// The order of the gammatone filters.
-    unsigned order;
-
-    /// The complex coefficients of the gammatone filter bands.
-    std::vector<mha_complex_t> coeff;
-
-    /// Combination of normalization and phase correction factor.
-    std::vector<mha_complex_t> norm_phase;
+gtfb_analyzer::gtfb_analyzer_cfg_t::
+gtfb_analyzer_cfg_t(unsigned ch, unsigned frames, unsigned ord,
+                    const std::vector<mha_complex_t> & _coeff,
+                    const std::vector<mha_complex_t> & _norm_phase)
+    : order(ord),
+      coeff(_coeff),
+      norm_phase(_norm_phase),
+      s_out(frames, ch * _coeff.size() * 2),
+      filters(ch * _coeff.size()),
+      rcoeff(filters), icoeff(filters), rnorm(filters), inorm(filters),
+      rstate(filters * ord, 0.0f), istate(filters * ord, 0.0f),
+      rinput(filters), iinput(filters)
+{
+    if (coeff.size() != norm_phase.size())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Number (%zu) of coefficients differs from number "\
+                        "(%zu) of normalization/phase-correction factors",
+                        coeff.size(), norm_phase.size());
+    for (unsigned channel = 0; channel < ch; ++channel)
+        for (unsigned band = 0; band < bands(); ++band) {
+            rcoeff[bands()*channel+band] = coeff[band].re;
+            icoeff[bands()*channel+band] = coeff[band].im;
+            rnorm[bands()*channel+band] = norm_phase[band].re;
+            inorm[bands()*channel+band] = norm_phase[band].im;
+        }
+}
 
-    /** Storage for the (complex) output signal.  Each of the
-     * real input audio channels is split into frequency bands with
-     * complex time signal output.  The split complex time signal is
-     * again stored in a mha_wave_t buffer.  Each complex time signal
-     * is stored as adjacent real and imaginary channels.  Complex
-     * output from one source channel is stored in adjacent complex
-     * output channels.
-     *
-     * Example: If the input has 2 channels ch0 ch1, and gtfb_analyzer
-     * splits into 3 bands b0 b1 b2, then the order of output channels
-     * in s_out is:
-     * ch0_b0_real ch0_b0_imag ch0_b1_real ch0_b1_imag ch0_b2_real ch0_b2_imag
-     * ch1_b0_real ch1_b1_imag ch1_b1_real ch1_b1_imag ch1_b2_real ch1_b2_imag
-     */
-    mha_wave_t s_out;
+/**
+ * Updates one filter stage of all channels and bands with one input
+ * sample: state = state * coeff + input (complex arithmetic, real and
+ * imaginary parts in separate arrays).  The loop has no dependencies
+ * between iterations and is vectorized by the compiler.
+ *
+ * @param n Number of filters (channels * bands)
+ * @param rc, ic Filter coefficients
+ * @param rin, iin Input samples of this stage
+ * @param rs, is Filter states of this stage, updated in place.  The new
+ *   state is the output of this stage.
+ */
+static inline void
+filter_stage(unsigned n,
+             const mha_real_t * __restrict rc, const mha_real_t * __restrict ic,
+             const mha_real_t * __restrict rin, const mha_real_t * __restrict iin,
+             mha_real_t * __restrict rs, mha_real_t * __restrict is)
+{
+    for (unsigned k = 0; k < n; ++k) {
+        const mha_real_t r = rs[k] * rc[k] - is[k] * ic[k] + rin[k];
+        const mha_real_t i = rs[k] * ic[k] + is[k] * rc[k] + iin[k];
+        rs[k] = r;
+        is[k] = i;
+    }
+}
 
-    /** Storage for Filter state.
-     * Holds channels() * bands() * order complex filter states.
-     * Layout: state[(bands()*channel+band)*order+stage]
-     */
-    std::vector<mha_complex_t> state;
-    /// Each band is split into this number of bands.
-    unsigned bands() const {return coeff.size();}
-    /// The number of separate audio channels.
-    unsigned channels() const {return s_out.num_channels / bands() / 2;}
-    /// The number of frames in one chunk.
-    unsigned frames() const {return s_out.num_frames;}
-    /// Returns pointer to filter states for that band
-    mha_complex_t * states(unsigned channel, unsigned band)
-    { return &state[(bands()*channel+band)*order]; }
+/** Vectorizable equivalent of MHAFilter::make_friendly_number:
+ * subnormals, infinities and NaN are replaced by zero. */
+static inline mha_real_t friendly(mha_real_t x)
+{
+    const mha_real_t a = fabsf(x);
+    return ((a >= std::numeric_limits<mha_real_t>::min()) &
+            (a <= std::numeric_limits<mha_real_t>::max())) ? x : 0.0f;
+}
 
-    /**
-     * Create a configuration for Gammatone Filterbank Analyzer.
-     * @param ch     Number of Audio channels.
-     * @param frames Number of Audio frames per chunk.
-     * @param ord    The order of the gammatone filters.
-     * @param _coeff Complex gammatone filter coefficients.
-     * @param _norm_phase Normalization and phase correction factors.
-     */
-    gtfb_analyzer_cfg_t(unsigned ch, unsigned frames, unsigned ord,
-                        const std::vector<mha_complex_t> & _coeff,
-                        const std::vector<mha_complex_t> & _norm_phase)
-        : order(ord),
-          coeff(_coeff),
-          norm_phase(_norm_phase),
-          state(_coeff.size() * ch * ord, mha_complex(0))
-    {
-        if (coeff.size() != norm_phase.size())
-            throw MHA_Error(__FILE__,__LINE__,
-                            "Number (%zu) of coefficients differs from number "\
-                            "(%zu) of normalization/phase-correction factors",
-                            coeff.size(), norm_phase.size());
-        s_out.num_channels = ch * coeff.size() * 2;
-        s_out.num_frames = frames;
-        s_out.channel_info = 0;
-        s_out.buf = new mha_real_t[ch * bands() * frames * 2];
-    }
-    ~gtfb_analyzer_cfg_t()
-    {delete [] s_out.buf; s_out.buf = 0;}
-    mha_complex_t & cvalue(unsigned frame, unsigned channel, unsigned band)
-    {
-        return *(reinterpret_cast<mha_complex_t *>(s_out.buf) +
-                 (frame * channels() * bands() + channel * bands() + band));
+mha_wave_t * gtfb_analyzer::gtfb_analyzer_cfg_t::process(const mha_wave_t * s)
+{
+    const unsigned n = filters;
+    const unsigned nbands = bands();
+    const unsigned nchannels = channels();
+    for (unsigned frame = 0; frame < s->num_frames; ++frame) {
+        // normalized complex input for all channels and bands
+        for (unsigned channel = 0; channel < nchannels; ++channel) {
+            const mha_real_t x = value(s,frame,channel);
+            const mha_real_t * __restrict rn = rnorm.data() + nbands*channel;
+            const mha_real_t * __restrict in = inorm.data() + nbands*channel;
+            mha_real_t * __restrict ri = rinput.data() + nbands*channel;
+            mha_real_t * __restrict ii = iinput.data() + nbands*channel;
+            for (unsigned band = 0; band < nbands; ++band) {
+                ri[band] = x * rn[band];
+                ii[band] = x * in[band];
+            }
+        }
+        // all channels and bands of one filter stage together, the
+        // output of each stage is the input of the next stage
+        const mha_real_t * rin = rinput.data();
+        const mha_real_t * iin = iinput.data();
+        for (unsigned stage = 0; stage < order; ++stage) {
+            mha_real_t * rs = rstate.data() + stage * n;
+            mha_real_t * is = istate.data() + stage * n;
+            filter_stage(n, rcoeff.data(), icoeff.data(), rin, iin, rs, is);
+            rin = rs;
+            iin = is;
+        }
+        mha_real_t * __restrict out = s_out.buf + frame * 2 * n;
+        for (unsigned k = 0; k < n; ++k) {
+            out[2*k] = friendly(rin[k]);
+            out[2*k+1] = friendly(iin[k]);
+        }
     }
-};
-
-/// Gammatone Filterbank Analyzer Plugin
-class gtfb_analyzer_t : public MHAPlugin::plugin_t<gtfb_analyzer_cfg_t> {
-public:
-    gtfb_analyzer_t(MHA_AC::algo_comm_t & iac,
-                    const std::string & configured_name);
-    mha_wave_t* process(mha_wave_t*);
-    void prepare(mhaconfig_t&);
-    void release();
-private:
-    void update_cfg();
-    MHAEvents::patchbay_t<gtfb_analyzer_t> patchbay;
-    bool prepared;
-    MHAParser::int_t order;
-    MHAParser::vcomplex_t coeff;
-    MHAParser::vcomplex_t norm_phase;
-};
+    return &s_out;
 }
+
 /********************************************************************/
 
 using MHAParser::StrCnv::val2str;
@@ -175,86 +174,10 @@ void gtfb_analyzer::gtfb_analyzer_t::release()
 {
     prepared = false;
 }
-/**
- * Filters a complex input sample with the given filter coefficient.
- * No normalization takes place. The implementation is
- * tail-recursive and to exploit compiler optimization.
- *
- * @param input The complex input sample
- *
- * @param coeff The complex filter coefficient
- *
- * @param states Pointer to the array of complex filter states.
- *
- * @param orders The filter order
- *
- * @return A const ref to the filtered sample
- *
- */
-static inline const mha_complex_t &
-filter_complex(const mha_complex_t & input,
-               const mha_complex_t & coeff,
-               mha_complex_t * states,
-               unsigned orders)
-{
-    if (orders == 0) return input;
-    return filter_complex(((*states) *= coeff) += input,
-                          coeff, states+1, orders-1);
-}
-
-/**
- * Filters a real input sample with the given filter coefficient and
- * applies the given normalization with phase correction.
- *
- * @param input The real input sample
- *
- * @param tmp_complex A reference to a mha_complex_t used for intermediate
- * results. No assumptions should be made about the state of tmp_complex
- * after the return of filter_real. This is an optimization to reduce the number
- * of dtor/ctor calls of mha_complex_t
- *
- * @param coeff The complex filter coefficient
- *
- * @param states Pointer to the array of complex filter states.
- *
- * @param orders The filter order
- *
- * @param normphase Normalization coefficient including the phase correction
- *
- * @return A const ref to the filtered sample
- *
- */
-static inline const mha_complex_t &
-filter_real(mha_real_t input,
-            mha_complex_t & tmp_complex,
-            const mha_complex_t & coeff,
-            mha_complex_t * states,
-            unsigned orders,
-            const mha_complex_t & normphase)
-{
-    return filter_complex((tmp_complex = normphase) *= input,
-                          coeff, states, orders);
-}
-
 mha_wave_t* gtfb_analyzer::gtfb_analyzer_t::process(mha_wave_t* s)
 {
     poll_config();
-    mha_complex_t tmp_complex = {0,0};
-    for (unsigned frame = 0; frame < s->num_frames; ++frame) {
-        for (unsigned channel = 0; channel < s->num_channels; ++channel) {
-            for (unsigned band = 0; band < cfg->bands(); ++band) {
-                cfg->cvalue(frame, channel, band) =
-                    filter_real(value(s,frame,channel),
-                                tmp_complex,
-                                cfg->coeff[band],
-                                cfg->states(channel,band),
-                                cfg->order,
-                                cfg->norm_phase[band]);
-                MHAFilter::make_friendly_number(cfg->cvalue(frame, channel, band));
-            }
-        }
-    }
-    return &cfg->s_out;
+    return cfg->process(s);
 }
 
 MHAPLUGIN_CALLBACKS(gtfb_analyzer,gtfb_analyzer::gtfb_analyzer_t,wave,wave)
@@ -302,6 +225,13 @@ MHAPLUGIN_DOCUMENTATION\
  " ch0\\_b0\\_real, ch0\\_b0\\_imag, ch0\\_b1\\_real, ch0\\_b1\\_imag,"
  " ch0\\_b2\\_real, ch0\\_b2\\_imag, ch1\\_b0\\_real, ch1\\_b1\\_imag,"
  " ch1\\_b1\\_real, ch1\\_b1\\_imag, ch1\\_b2\\_real, ch1\\_b2\\_imag"
+ "\n\n"
+ " All channels and bands are filtered together: the states of one"
+ " filter stage of all channels and bands are stored adjacently and"
+ " updated in one vectorized loop for each sample."
+ " The plugin \\texttt{gtfb\\_synthesizer} resynthesizes broadband"
+ " signals from the output of this plugin by delaying, weighting, and"
+ " summing the real parts of all bands of each audio channel."
  "\n\n\n"
  "\\textbf{Attention:}\n\n"
  "The recursive low-pass filters in this plugin have no protection against"
@@ -0,0 +1,139 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2005 2006 2009 2010 2013 2014 2015 2018 2019 2020 HörTech gGmbH
+// Copyright © 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GTFB_ANALYZER_HH
+#define GTFB_ANALYZER_HH
+
+#include "mha_plugin.hh"
+#include "mha_signal.hh"
+#include "mha_parser.hh"
+#include "mha_events.h"
+#include <vector>
+
+/**
+   \file   gtfb_analyzer.hh
+   \brief  Gammatone Filterbank Analyzer Plugin
+*/
+
+namespace gtfb_analyzer {
+/// Configuration for Gammatone Filterbank Analyzer.
+struct gtfb_analyzer_cfg_t {
+
+    /// The order of the gammatone filters.
+    unsigned order;
+
+    /// The complex coefficients of the gammatone filter bands.
+    std::vector<mha_complex_t> coeff;
+
+    /// Combination of normalization and phase correction factor.
+    std::vector<mha_complex_t> norm_phase;
+
+    /** Storage for the (complex) output signal.  Each of the
+     * real input audio channels is split into frequency bands with
+     * complex time signal output.  The split complex time signal is
+     * again stored in a mha_wave_t buffer.  Each complex time signal
+     * is stored as adjacent real and imaginary channels.  Complex
+     * output from one source channel is stored in adjacent complex
+     * output channels.
+     *
+     * Example: If the input has 2 channels ch0 ch1, and gtfb_analyzer
+     * splits into 3 bands b0 b1 b2, then the order of output channels
+     * in s_out is:
+     * ch0_b0_real ch0_b0_imag ch0_b1_real ch0_b1_imag ch0_b2_real ch0_b2_imag
+     * ch1_b0_real ch1_b1_imag ch1_b1_real ch1_b1_imag ch1_b2_real ch1_b2_imag
+     */
+    MHASignal::waveform_t s_out;
+
+    /// Number of filters, i.e. channels() * bands()
+    unsigned filters;
+
+    /// Real parts of coefficients, repeated for every channel,
+    /// index [bands()*channel+band]
+    std::vector<mha_real_t> rcoeff;
+    /// Imaginary parts of coefficients, same layout as rcoeff
+    std::vector<mha_real_t> icoeff;
+    /// Real parts of normalization and phase correction, same layout
+    std::vector<mha_real_t> rnorm;
+    /// Imaginary parts of normalization and phase correction
+    std::vector<mha_real_t> inorm;
+
+    /** Storage for Filter state, real and imaginary parts separated.
+     * Holds channels() * bands() * order filter states.  The states
+     * of all channels and bands of one filter stage are adjacent, so
+     * that one filter stage is updated for all channels and bands in
+     * one vectorizable loop.
+     * Layout: rstate[stage*filters + bands()*channel+band]
+     */
+    std::vector<mha_real_t> rstate;
+    /// Imaginary parts of filter states, same layout as rstate.
+    std::vector<mha_real_t> istate;
+
+    /// Scratch buffers: normalized input of the current frame, one
+    /// complex value per channel and band.
+    std::vector<mha_real_t> rinput, iinput;
+
+    /// Each band is split into this number of bands.
+    unsigned bands() const {return coeff.size();}
+    /// The number of separate audio channels.
+    unsigned channels() const {return s_out.num_channels / bands() / 2;}
+    /// The number of frames in one chunk.
+    unsigned frames() const {return s_out.num_frames;}
+
+    /**
+     * Create a configuration for Gammatone Filterbank Analyzer.
+     * @param ch     Number of Audio channels.
+     * @param frames Number of Audio frames per chunk.
+     * @param ord    The order of the gammatone filters.
+     * @param _coeff Complex gammatone filter coefficients.
+     * @param _norm_phase Normalization and phase correction factors.
+     */
+    gtfb_analyzer_cfg_t(unsigned ch, unsigned frames, unsigned ord,
+                        const std::vector<mha_complex_t> & _coeff,
+                        const std::vector<mha_complex_t> & _norm_phase);
+
+    /** Filter one block of audio with all bands.
+     * @param s Input signal, channels() channels and frames() frames.
+     * @return Pointer to s_out containing the complex band signals. */
+    mha_wave_t * process(const mha_wave_t * s);
+};
+
+/// Gammatone Filterbank Analyzer Plugin
+class gtfb_analyzer_t : public MHAPlugin::plugin_t<gtfb_analyzer_cfg_t> {
+public:
+    gtfb_analyzer_t(MHA_AC::algo_comm_t & iac,
+                    const std::string & configured_name);
+    mha_wave_t* process(mha_wave_t*);
+    void prepare(mhaconfig_t&);
+    void release();
+private:
+    void update_cfg();
+    MHAEvents::patchbay_t<gtfb_analyzer_t> patchbay;
+    bool prepared;
+    MHAParser::int_t order;
+    MHAParser::vcomplex_t coeff;
+    MHAParser::vcomplex_t norm_phase;
+};
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
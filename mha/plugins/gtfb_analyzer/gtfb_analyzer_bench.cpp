@@ -0,0 +1,120 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost of the band-parallel gtfb_analyzer with the serial
+// per-channel, per-band filtering it replaced.
+
+#include "gtfb_analyzer.hh"
+#include "mha_filter.hh"
+#include <chrono>
+#include <iostream>
+
+namespace {
+  /// Gammatone filter coefficients for bands spaced 1 ERB apart
+  void gt_coeff(unsigned bands, unsigned order,
+                std::vector<mha_complex_t> & coeff,
+                std::vector<mha_complex_t> & norm_phase)
+  {
+    const double fs = 16000;
+    coeff.clear();
+    norm_phase.clear();
+    for (unsigned band = 0; band < bands; ++band) {
+      const double f = 100.0 * pow(1.1, band);
+      const double bw = 24.7 + 0.108 * f;
+      const double lambda = exp(-2 * M_PI * 1.019 * bw / fs);
+      coeff.push_back(mha_complex(lambda * cos(2 * M_PI * f / fs),
+                                  lambda * sin(2 * M_PI * f / fs)));
+      const double norm = 2 * pow(1 - lambda, order);
+      norm_phase.push_back(mha_complex(norm * cos(0.1 * band),
+                                       norm * sin(0.1 * band)));
+    }
+  }
+
+  /// The serial per-channel, per-band complex implementation that
+  /// gtfb_analyzer used before the band-parallel layout.
+  class serial_reference_t {
+  public:
+    serial_reference_t(unsigned ch, unsigned frames, unsigned ord,
+                       const std::vector<mha_complex_t> & c,
+                       const std::vector<mha_complex_t> & np)
+      : order(ord), coeff(c), norm_phase(np),
+        state(c.size() * ch * ord, mha_complex(0)),
+        s_out(frames, ch * c.size() * 2)
+    {}
+    mha_wave_t * process(const mha_wave_t * s)
+    {
+      const unsigned bands = coeff.size();
+      for (unsigned frame = 0; frame < s->num_frames; ++frame)
+        for (unsigned channel = 0; channel < s->num_channels; ++channel)
+          for (unsigned band = 0; band < bands; ++band) {
+            mha_complex_t * states = &state[(bands*channel+band)*order];
+            mha_complex_t x = norm_phase[band];
+            x *= value(s, frame, channel);
+            for (unsigned stage = 0; stage < order; ++stage)
+              x = ((states[stage] *= coeff[band]) += x);
+            MHAFilter::make_friendly_number(x);
+            s_out.value(frame, 2*(bands*channel+band)) = x.re;
+            s_out.value(frame, 2*(bands*channel+band)+1) = x.im;
+          }
+      return &s_out;
+    }
+  private:
+    unsigned order;
+    std::vector<mha_complex_t> coeff, norm_phase, state;
+    MHASignal::waveform_t s_out;
+  };
+
+  void fill_noise(MHASignal::waveform_t & s, unsigned seed)
+  {
+    for (unsigned k = 0; k < size(s); ++k) {
+      seed = seed * 1664525U + 1013904223U;
+      s.buf[k] = (seed >> 8) / double(1 << 24) - 0.5;
+    }
+  }
+}
+
+int main()
+{
+  const unsigned bands = 40, frames = 64, order = 4, blocks = 2000;
+  std::vector<mha_complex_t> coeff, norm_phase;
+  gt_coeff(bands, order, coeff, norm_phase);
+  for (unsigned channels : {2U, 4U, 6U}) {
+    gtfb_analyzer::gtfb_analyzer_cfg_t cfg(channels, frames, order,
+                                           coeff, norm_phase);
+    serial_reference_t ref(channels, frames, order, coeff, norm_phase);
+    MHASignal::waveform_t in(frames, channels);
+    fill_noise(in, 1);
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      ref.process(&in);
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      cfg.process(&in);
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << bands << " bands x " << channels << " channels: serial "
+              << std::chrono::duration<double,std::micro>(t1-t0).count()/blocks
+              << " us/block, band-parallel "
+              << std::chrono::duration<double,std::micro>(t2-t1).count()/blocks
+              << " us/block" << std::endl;
+  }
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,143 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "gtfb_analyzer.hh"
+#include "mha_algo_comm.hh"
+#include "mha_filter.hh"
+
+namespace {
+  /// Gammatone filter coefficients for bands spaced 1 ERB apart
+  void gt_coeff(unsigned bands, unsigned order,
+                std::vector<mha_complex_t> & coeff,
+                std::vector<mha_complex_t> & norm_phase)
+  {
+    const double fs = 16000;
+    coeff.clear();
+    norm_phase.clear();
+    for (unsigned band = 0; band < bands; ++band) {
+      const double f = 100.0 * pow(1.1, band);
+      const double bw = 24.7 + 0.108 * f;
+      const double lambda = exp(-2 * M_PI * 1.019 * bw / fs);
+      coeff.push_back(mha_complex(lambda * cos(2 * M_PI * f / fs),
+                                  lambda * sin(2 * M_PI * f / fs)));
+      const double norm = 2 * pow(1 - lambda, order);
+      norm_phase.push_back(mha_complex(norm * cos(0.1 * band),
+                                       norm * sin(0.1 * band)));
+    }
+  }
+
+  /// The serial per-channel, per-band complex implementation that
+  /// gtfb_analyzer used before the band-parallel layout.
+  class serial_reference_t {
+  public:
+    serial_reference_t(unsigned ch, unsigned frames, unsigned ord,
+                       const std::vector<mha_complex_t> & c,
+                       const std::vector<mha_complex_t> & np)
+      : order(ord), coeff(c), norm_phase(np),
+        state(c.size() * ch * ord, mha_complex(0)),
+        s_out(frames, ch * c.size() * 2)
+    {}
+    mha_wave_t * process(const mha_wave_t * s)
+    {
+      const unsigned bands = coeff.size();
+      for (unsigned frame = 0; frame < s->num_frames; ++frame)
+        for (unsigned channel = 0; channel < s->num_channels; ++channel)
+          for (unsigned band = 0; band < bands; ++band) {
+            mha_complex_t * states = &state[(bands*channel+band)*order];
+            mha_complex_t x = norm_phase[band];
+            x *= value(s, frame, channel);
+            for (unsigned stage = 0; stage < order; ++stage)
+              x = ((states[stage] *= coeff[band]) += x);
+            MHAFilter::make_friendly_number(x);
+            s_out.value(frame, 2*(bands*channel+band)) = x.re;
+            s_out.value(frame, 2*(bands*channel+band)+1) = x.im;
+          }
+      return &s_out;
+    }
+  private:
+    unsigned order;
+    std::vector<mha_complex_t> coeff, norm_phase, state;
+    MHASignal::waveform_t s_out;
+  };
+
+  void fill_noise(MHASignal::waveform_t & s, unsigned seed)
+  {
+    for (unsigned k = 0; k < size(s); ++k) {
+      seed = seed * 1664525U + 1013904223U;
+      s.buf[k] = (seed >> 8) / double(1 << 24) - 0.5;
+    }
+  }
+}
+
+TEST(gtfb_analyzer_cfg_t, band_parallel_layout_equals_serial_filtering)
+{
+  for (unsigned channels : {1U, 2U, 5U})
+    for (unsigned order : {0U, 1U, 4U}) {
+      std::vector<mha_complex_t> coeff, norm_phase;
+      gt_coeff(7, order, coeff, norm_phase);
+      gtfb_analyzer::gtfb_analyzer_cfg_t cfg(channels, 16, order,
+                                             coeff, norm_phase);
+      serial_reference_t ref(channels, 16, order, coeff, norm_phase);
+      MHASignal::waveform_t in(16, channels);
+      for (unsigned block = 0; block < 4; ++block) {
+        fill_noise(in, block + 10 * channels);
+        mha_wave_t * expected = ref.process(&in);
+        mha_wave_t * actual = cfg.process(&in);
+        ASSERT_EQ(expected->num_channels, actual->num_channels);
+        for (unsigned k = 0; k < size(expected); ++k)
+          ASSERT_NEAR(expected->buf[k], actual->buf[k], 1e-6f)
+            << channels << " channels, order " << order
+            << ", block " << block << ", index " << k;
+      }
+    }
+}
+
+TEST(gtfb_analyzer_cfg_t, replaces_non_finite_output_with_zero)
+{
+  std::vector<mha_complex_t> coeff = {mha_complex(0.5f, 0.0f)};
+  std::vector<mha_complex_t> norm_phase = {mha_complex(1.0f, 0.0f)};
+  gtfb_analyzer::gtfb_analyzer_cfg_t cfg(1, 2, 1, coeff, norm_phase);
+  MHASignal::waveform_t in(2, 1);
+  in.buf[0] = std::numeric_limits<float>::infinity();
+  in.buf[1] = std::numeric_limits<float>::denorm_min();
+  mha_wave_t * out = cfg.process(&in);
+  EXPECT_EQ(0.0f, out->buf[0]);
+  EXPECT_EQ(0.0f, out->buf[2]);
+}
+
+TEST(gtfb_analyzer_t, output_channels_and_mismatching_parameters)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  gtfb_analyzer::gtfb_analyzer_t plugin(acspace, "gtfb_analyzer");
+  plugin.parse("coeff = [(0.9+0.1i) (0.8+0.3i) (0.5+0.7i)]");
+  plugin.parse("norm_phase = [0.1 0.1]");
+  mhaconfig_t cf = {.channels = 2, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  EXPECT_THROW(plugin.prepare_(cf), MHA_Error);
+  plugin.release_();
+  cf.channels = 2;
+  plugin.parse("norm_phase = [0.1 0.1 0.1]");
+  plugin.prepare_(cf);
+  EXPECT_EQ(12U, cf.channels);
+  plugin.release_();
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2009 2010 2013 2014 2015 2018 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -31,48 +31,46 @@
   (a*b).real==a.real*b.real-a.imag*b.imag,
   (a*b).imag==a.real*b.imag+a.imag*b.real.
 */
-/*
-   State of implementation
-   - The simd code is implemented but untested
-   - ?vectorize rinput filling?
-   - performance testing against gtfb_analyzer and mex function (the latter is 
-     optimized with loop unrolling)
-*/
-
-
-#include "mha_plugin.hh"
-#include "mha_signal.hh"
-#include "mha_parser.hh"
+#include "gtfb_simd.hh"
 #include "mha_defs.h"
 #include <math.h>
-#include <time.h>
-#include "mha_events.h"
-
-// The clang documentation (https://clang.llvm.org/compatibility.html#vector_builtins)
-// suggests using these api calls instead of the builtins and links to a script to 
-// perform the migration. Use the replacements that would be done by the script.
-#ifdef __clang__
-#include <xmmintrin.h>
-// abbreviations for SIMD arithmetic operations
-#define add4f(a,b) _mm_add_ps(a,b)
-#define sub4f(a,b) _mm_sub_ps(a,b)
-#define mul4f(a,b) _mm_mul_ps(a,b)
-#else
-#define add4f(a,b) __builtin_ia32_addps(a,b)
-#define sub4f(a,b) __builtin_ia32_subps(a,b)
-#define mul4f(a,b) __builtin_ia32_mulps(a,b)
-#endif
 
+#if defined(__SSE__)
 // Setting these bits in the MXCSR register avoids problems with denormals
 #define MXCSR_DAZ (1 << 6)      /* Enable denormals are zero mode */
 #define MXCSR_FTZ (1 << 15)     /* Enable flush to zero mode */
+#elif defined(__aarch64__)
+// Setting this bit in the FPCR register flushes denormals to zero
+#define FPCR_FZ (1 << 24)
+#endif
+
+gtfb_simd::denormal_guard_t::denormal_guard_t()
+    : saved(0)
+{
+#if defined(__SSE__)
+    saved = _mm_getcsr();
+    _mm_setcsr(saved | MXCSR_DAZ | MXCSR_FTZ);
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (saved));
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (saved | FPCR_FZ));
+#endif
+}
+
+gtfb_simd::denormal_guard_t::~denormal_guard_t()
+{
+#if defined(__SSE__)
+    _mm_setcsr(saved);
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (saved));
+#endif
+}
 
 /** Filters one sample per band, using SISD operations and the mha_complex
  * operations.  To process more than one sample, the function must be
  * called repeatedly in correct order (from oldest sample to newest sample),
  * and the calling function must preserve the filter state (parameter states).
  *
- * This function is not actually used in this plugin, but can be used for
+ * This function is not actually used in this plugin, but is used for
  * testing.  It implements the Hohmann 2002 filtering in the most readable
  * form, and is translated towards a SIMD implementation in the following
  * functions.
@@ -94,7 +92,7 @@
  *   next sample, this function needs the filter state array from filtering the
  *   previous sample again, unmodified.
  *   The filter state of band b, order o can be found at index [b+o*bands] */
-void filter_sisd_complex(const unsigned bands, const unsigned order,
+void gtfb_simd::filter_sisd_complex(const unsigned bands, const unsigned order,
                          const mha_complex_t * inputs, mha_complex_t * outputs,
                          const mha_complex_t * coefficients,
                          mha_complex_t * states)
@@ -181,275 +179,161 @@ void filter_sisd_real(const unsigned bands, const unsigned order,
   }
 } 
 
-/** Checks alignment of pointer address.
- * @param ptr pointer to check
- * @param alignment required alignment
- * @throw MHA_Error if ptr is not aligned as required. */
-#define check_alignment(ptr,alignment) do { \
-  if (((size_t)(ptr)) % (alignment)) \
-      throw MHA_Error(__FILE__,__LINE__,"Incorrect alignment of %s", #ptr); \
-} while(0)
-
-/** Filters one sample per band, using simd operations on float32
- * To process more than one sample, the function must be
- * called repeatedly in correct order (from oldest sample to newest sample),
- * and the calling function must preserve the filter state (parameters
- * rstates and istates).
+/** Filters one block of samples for all bands, using simd operations on
+ * float32 vectors.  The filter state is preserved between calls in the
+ * parameters rstates and istates.
  *
  * This reimplements filter_sisd_real, but uses the CPU's vector registers
- * for the arithmetics, and is actually used by this plugin.
- * @param bands
- *   Number of total bands to compute (i.e. input_channels * num_frequencies)
- *   bands is also the size of the arrays pointed to by rinputs, iinputs,
- *   routputs, ioutputs, rcoefficients, icoefficients.
+ * for the arithmetics, and is actually used by this plugin.  In addition,
+ * the multiplication of the real input signal with the normalization and
+ * phase correction factor is included, and the loop over frames is inside
+ * the loop over band vectors so that coefficients stay in registers.
+ * @param vectors
+ *   Number of band vectors to compute, i.e. the total number of bands
+ *   (input_channels * num_frequencies) divided by simd_width, rounded up.
+ *   vectors is also the size of the arrays pointed to by rnorm, inorm,
+ *   rcoefficients, icoefficients.
  * @param order
  *   Gammatone filter order
- * @param rinputs
- *   Pointer to array of the real part of input samples
- * @param iinputs
- *   Pointer to array of the imaginary part of input samples
- * @param routputs
- *   Pointer to array with space for the real parts of the output samples
- * @param routputs
- *   Pointer to array with space for the real parts of the output samples
+ * @param frames
+ *   Number of samples per band to filter
+ * @param inputs
+ *   Pointer to array of real input samples, layout [frame*vectors+vector].
+ *   Each lane contains the input sample of the audio channel of that band.
+ * @param rnorm
+ *   Pointer to array of the real parts of normalization and phase
+ *   correction factors
+ * @param inorm
+ *   Pointer to array of the imaginary parts of normalization and phase
+ *   correction factors
  * @param rcoefficients
  *   Pointer to array of the real parts of the recursive filter coefficients
  * @param icoefficients
  *   Pointer to array of the imaginary parts of the filter coefficients
  * @param rstates
  *   Pointer to array of real parts of filter states. Array size is
- *   bands*order.  Initialize all elements with zeros before filtering the
- *   first sample.
- *   Filter state values will be modified by the function.  For filtering the
- *   next sample, this function needs the filter state arrays from filtering the
- *   previous sample again, unmodified. The real part of the filter state of
- *   band b, order o can be found at index [b+o*bands]
+ *   vectors*order.  Initialize all elements with zeros before filtering the
+ *   first block.  The real part of the filter state of
+ *   band vector v, order o can be found at index [v+o*vectors]
  * @param istates
- *   Pointer to array of imaginary parts of filter states. Array size is
- *   bands*order.  Initialize all elements with zeros before filtering the
- *   first sample.
- *   Filter state values will be modified by the function.  For filtering the
- *   next sample, this function needs the filter state arrays from filtering the
- *   previous sample again, unmodified. The imaginary part of the filter state
- *   of band b, order o can be found at index [b+o*bands] */
-inline
-void filter_simd(const unsigned bands, const unsigned order,
-                 const mha_real_t * rinputs, const mha_real_t * iinputs,
-                 mha_real_t * routputs, mha_real_t * ioutputs,
-                 const mha_real_t * rcoefficients,
-                 const mha_real_t * icoefficients,
-                 mha_real_t * rstates, mha_real_t * istates)
+ *   Pointer to array of imaginary parts of filter states, same layout as
+ *   rstates.
+ * @param routputs
+ *   Pointer to array with space for the real parts of the output samples,
+ *   same layout as inputs.
+ * @param ioutputs
+ *   Pointer to array with space for the imaginary parts of the output
+ *   samples, same layout as inputs. */
+void gtfb_simd::filter_simd(const unsigned vectors, const unsigned order,
+                            const unsigned frames,
+                            const vfloat_t * inputs,
+                            const vfloat_t * rnorm, const vfloat_t * inorm,
+                            const vfloat_t * rcoefficients,
+                            const vfloat_t * icoefficients,
+                            vfloat_t * rstates, vfloat_t * istates,
+                            vfloat_t * routputs, vfloat_t * ioutputs)
 {
-  // check alignment
-  check_alignment(rinputs,16); check_alignment(iinputs,16);
-  check_alignment(routputs,16); check_alignment(ioutputs,16);
-  check_alignment(rcoefficients,16); check_alignment(icoefficients,16);
-  check_alignment(rstates,16); check_alignment(istates,16);
-  if (bands % 4)
-    throw MHA_ErrorMsg("number of bands must be multiple of 4");
-
-  // data type grouping 4 floats for SIMD operations
-  typedef float v4sf __attribute__ ((vector_size(4*sizeof(float))));
-
-  // SIMD data used during computation
-  v4sf rtmp, itmp, *rstate, *istate;
-  for (unsigned band = 0; band < bands; band += 4) {
-    // copy input data
-    auto rplus = reinterpret_cast<const v4sf*>(&rinputs[band]);
-    auto iplus = reinterpret_cast<const v4sf*>(&iinputs[band]);
-    auto rcoeff = reinterpret_cast<const v4sf*>(&rcoefficients[band]);
-    auto icoeff = reinterpret_cast<const v4sf*>(&icoefficients[band]);
-    for (unsigned stage = 0; stage < order; ++stage) {
-      rstate = reinterpret_cast<v4sf*>(&rstates[band + stage*bands]);
-      istate = reinterpret_cast<v4sf*>(&istates[band + stage*bands]);
-
-      // computes: rtmp = *rstate * *rcoeff - *istate * *icoeff + *rplus;
-      rtmp = add4f(sub4f(mul4f(*rstate, *rcoeff),
-                         mul4f(*istate, *icoeff)),
-                   *rplus);
-      // computes: itmp = *rstate * *icoeff + *istate * *rcoeff + *iplus;
-      itmp = add4f(add4f(mul4f(*rstate, *icoeff),
-                         mul4f(*istate, *rcoeff)),
-                   *iplus);
-      *rstate = rtmp;
-      *istate = itmp;
-
-      // summand for next order is this order's output
-      rplus = rstate;
-      iplus = istate;
+    for (unsigned v = 0; v < vectors; ++v) {
+        const vfloat_t rcoeff = rcoefficients[v];
+        const vfloat_t icoeff = icoefficients[v];
+        const vfloat_t rn = rnorm[v];
+        const vfloat_t in = inorm[v];
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            const vfloat_t x = inputs[frame * vectors + v];
+            vfloat_t rplus = x * rn;
+            vfloat_t iplus = x * in;
+            for (unsigned stage = 0; stage < order; ++stage) {
+                vfloat_t & rstate = rstates[v + stage * vectors];
+                vfloat_t & istate = istates[v + stage * vectors];
+                // cstate = cstate * ccoeff + cplus
+                const vfloat_t rtmp = rstate * rcoeff - istate * icoeff + rplus;
+                istate = rstate * icoeff + istate * rcoeff + iplus;
+                rstate = rtmp;
+                // summand for next order is this order's output
+                rplus = rstate;
+                iplus = istate;
+            }
+            routputs[frame * vectors + v] = rplus;
+            ioutputs[frame * vectors + v] = iplus;
+        }
     }
-    // copy output data
-    *reinterpret_cast<v4sf*>(&routputs[band]) = *rplus;
-    *reinterpret_cast<v4sf*>(&ioutputs[band]) = *iplus;
-  }
-} 
-
-
-
-/**\internal
- * Configuration for Gammatone Filterbank SIMD Analyzer.
- */
-class gtfb_simd_cfg_t {
-
-    unsigned order;             /**<  The order of the gammatone filters.*/
-    unsigned bands;             /**<  Number of frequency bands per channel */
-    unsigned channels;          /**< Number of input audio channels */
-    unsigned bandsXchannels;    /**< Product of bands and channels */
-
-    /// Combination of normalization and phase correction factor.
-    std::vector<mha_complex_t> norm_phase;
-
-    /// input signal (1 sample) multiplied with norm_phase
-    float * rinputs; // bandsXchannels entries
-    float * iinputs;
-    
-    /// The complex coefficients of the gammatone filter bands.
-    float * rcoefficients; // bandsXchannels entries
-    float * icoefficients; 
-
-    /**\internal Storage for Filter state.
-     * Holds channels() * bands() * order complex filter states.
-     * Layout: state[stage * bandsXchannels + bands()*channel+band]
-     */
-    float * rstates;
-    float * istates;
-
-    /// output signal buffer, used by s_out.  Contains bandsXchannels * fragsize
-    /// *2 entries.  all real parts come before all complex parts.  Order is:
-    /// channel 0 band 0 real, channel 0 band 1 real, ..., channel 1 band 0 real
-    /// channel 1 band 1 real, ... channel 0 band 0 imag ... then next sample
-    float * sout_buf;
-
-    /// Large float array. All previous pointers point into this array.
-    /// Contains 3 unused entries to be able to adjust for alignment.
-    float * large_array; // bandsXchannels*(fragsize + order + 2)*2 + 3 entries
-    
-    /**\internal Storage for the (complex) output signal.  Each of the
-     * real input audio channels is split into frequency bands with
-     * complex time signal output.  The split complex time signal is
-     * again stored in a mha_wave_t buffer.  Each complex time signal
-     * is stored as adjacent real and imaginary channels.  Complex
-     * output from one source channel is stored in adjacent complex
-     * output channels.
-     */
-    mha_wave_t s_out;
-public:
-    /// Each band is split into this number of bands.
-    unsigned get_bands() const {return bands;}
-    /// The number of separate audio channels.
-    unsigned get_channels() const {return channels;}
-    /// The number of frames in one chunk.
-    unsigned get_frames() const {return s_out.num_frames;}
-
-    // Delete (move)-assignment operators, copy and move constructors
-    // As gtfb_simd_cfg_t has manual memory management, these special
-    // functions should either be provided or disabled 
-    gtfb_simd_cfg_t(gtfb_simd_cfg_t&&)=delete;
-    gtfb_simd_cfg_t& operator=(gtfb_simd_cfg_t&&)=delete;
-    gtfb_simd_cfg_t(const gtfb_simd_cfg_t&)=delete;
-    gtfb_simd_cfg_t& operator=(const gtfb_simd_cfg_t&)=delete;
-
-    /**\internal
-     * Create a configuration for Gammatone Filterbank Analyzer.
-     * @param ch     Number of Audio channels.
-     * @param frames Number of Audio frames per chunk.
-     * @param ord    The order of the gammatone filters.
-     * @param _coeff Complex gammatone filter coefficients.
-     * @param _norm_phase Normalization and phase correction factors.
-     */
-    gtfb_simd_cfg_t(unsigned ch, unsigned frames, unsigned ord,
-                    const std::vector<mha_complex_t> & _coeff,
-                    const std::vector<mha_complex_t> & _norm_phase)
-        : order(ord),
-          bands(_coeff.size()),
-          channels(ch),
-          bandsXchannels(bands*channels),
-          norm_phase(_norm_phase)
-    {
-        if (bandsXchannels % 4)
-            throw MHA_Error(__FILE__,__LINE__,
-                            "Product of channels and bands has to be a multiple"
-                            " of 4, is %u", bandsXchannels);
-        if (_coeff.size() != norm_phase.size())
-            throw MHA_Error(__FILE__,__LINE__,
-                            "Number (%zu) of coefficients differs from number "\
-                            "(%zu) of normalization/phase-correction factors",
-                            _coeff.size(), norm_phase.size());
-        large_array = new float[bandsXchannels*(frames + order + 2)*2 + 3];
-        rinputs = (float*)((size_t(large_array+3) / 16) * 16);
-        iinputs = rinputs + bandsXchannels;
-        rcoefficients = iinputs + bandsXchannels;
-        icoefficients = rcoefficients + bandsXchannels; 
-        rstates = icoefficients + bandsXchannels;
-        istates = rstates + bandsXchannels * order;
-        sout_buf = istates + bandsXchannels * order;
+}
 
-        s_out.num_channels = bandsXchannels * 2;
-        s_out.num_frames = frames;
-        s_out.channel_info = 0;
-        s_out.buf = sout_buf;
+gtfb_simd::gtfb_simd_cfg_t::gtfb_simd_cfg_t(unsigned ch, unsigned frames,
+                                            unsigned ord,
+                                            const std::vector<mha_complex_t> & _coeff,
+                                            const std::vector<mha_complex_t> & _norm_phase)
+    : order(ord),
+      bands(_coeff.size()),
+      channels(ch),
+      bandsXchannels(bands*channels),
+      vectors((bandsXchannels + simd_width - 1) / simd_width),
+      rnorm(vectors, vfloat_t{}),
+      inorm(vectors, vfloat_t{}),
+      rcoefficients(vectors, vfloat_t{}),
+      icoefficients(vectors, vfloat_t{}),
+      rstates(vectors * order, vfloat_t{}),
+      istates(vectors * order, vfloat_t{}),
+      inputs(vectors * frames, vfloat_t{}),
+      routputs(vectors * frames, vfloat_t{}),
+      ioutputs(vectors * frames, vfloat_t{}),
+      s_out(frames, bandsXchannels * 2)
+{
+    if (_coeff.size() != _norm_phase.size())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Number (%zu) of coefficients differs from number "\
+                        "(%zu) of normalization/phase-correction factors",
+                        _coeff.size(), _norm_phase.size());
+    float * rc = reinterpret_cast<float*>(rcoefficients.data());
+    float * ic = reinterpret_cast<float*>(icoefficients.data());
+    float * rn = reinterpret_cast<float*>(rnorm.data());
+    float * in = reinterpret_cast<float*>(inorm.data());
+    for (unsigned channel = 0; channel < channels; ++channel)
+        for (unsigned band = 0; band < bands; ++band) {
+            rc[channel * bands + band] = _coeff[band].re;
+            ic[channel * bands + band] = _coeff[band].im;
+            rn[channel * bands + band] = _norm_phase[band].re;
+            in[channel * bands + band] = _norm_phase[band].im;
+        }
+}
 
-        for (unsigned channel = 0; channel < channels; ++channel)
-            for (unsigned band = 0; band < bands; ++band) {
-                rcoefficients[channel * bands + band] = _coeff[band].re;
-                icoefficients[channel * bands + band] = _coeff[band].im;
-            }
-                
-    }
-    ~gtfb_simd_cfg_t()
-    {
-        delete [] large_array;
-        s_out.buf = sout_buf = istates = rstates = large_array = 
-            rinputs = iinputs = rcoefficients = icoefficients = 0;
-    }
-    inline mha_wave_t * process(mha_wave_t *s_in)
-    {
-        if (s_in->num_channels != channels || s_in->num_frames != get_frames())
-            throw MHA_ErrorMsg("Input signal: unexpected frame or channel count");
-        unsigned outband;
-        float * input_sample;
-        float * routputs = sout_buf;
-        float * ioutputs = sout_buf + bandsXchannels;
-        for (unsigned frame = 0; frame < get_frames();
-             ++frame,
-                 (routputs += bandsXchannels * 2),
-                 (ioutputs += bandsXchannels * 2)) {
-            for (unsigned channel = outband = 0; channel < channels; ++channel){
-                input_sample = &value(s_in, frame, channel);
-                for (unsigned band = 0; band < bands; ++band, ++outband) {
-                    rinputs[outband] = *input_sample * norm_phase[band].re;
-                    iinputs[outband] = *input_sample * norm_phase[band].im;
-                }
-            }
-            filter_simd(bandsXchannels, order,
-                        rinputs, iinputs,
-                        routputs, ioutputs,
-                        rcoefficients, icoefficients,
-                        rstates, istates);
+mha_wave_t * gtfb_simd::gtfb_simd_cfg_t::process(const mha_wave_t *s_in)
+{
+    if (s_in->num_channels != channels || s_in->num_frames != get_frames())
+        throw MHA_ErrorMsg("Input signal: unexpected frame or channel count");
+    const unsigned frames = get_frames();
+    const unsigned stride = vectors * simd_width;
+    // distribute each input sample to all bands of its channel, the
+    // padding lanes keep their zero input
+    float * x = reinterpret_cast<float*>(inputs.data());
+    for (unsigned frame = 0; frame < frames; ++frame)
+        for (unsigned channel = 0; channel < channels; ++channel) {
+            const mha_real_t sample = value(s_in, frame, channel);
+            float * xb = x + frame * stride + channel * bands;
+            for (unsigned band = 0; band < bands; ++band)
+                xb[band] = sample;
+        }
+    filter_simd(vectors, order, frames, inputs.data(),
+                rnorm.data(), inorm.data(),
+                rcoefficients.data(), icoefficients.data(),
+                rstates.data(), istates.data(),
+                routputs.data(), ioutputs.data());
+    // interleave real and imaginary parts in gtfb_analyzer's layout
+    const float * re = reinterpret_cast<const float*>(routputs.data());
+    const float * im = reinterpret_cast<const float*>(ioutputs.data());
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        mha_real_t * out = s_out.buf + frame * bandsXchannels * 2;
+        for (unsigned k = 0; k < bandsXchannels; ++k) {
+            out[2 * k] = re[frame * stride + k];
+            out[2 * k + 1] = im[frame * stride + k];
         }
-        return &s_out;
     }
-};
-
-class gtfb_simd_t : public MHAPlugin::plugin_t<gtfb_simd_cfg_t> {
-public:
-    gtfb_simd_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-    mha_wave_t* process(mha_wave_t*);
-    void prepare(mhaconfig_t&);
-private:
-    void update_cfg();
-    MHAEvents::patchbay_t<gtfb_simd_t> patchbay;
-    bool prepared;
-    MHAParser::int_t order;
-    MHAParser::vcomplex_t coeff;
-    MHAParser::vcomplex_t norm_phase;
-};
+    return &s_out;
+}
 
 /********************************************************************/
 
-using MHAParser::StrCnv::val2str;
-
-void gtfb_simd_t::update_cfg()
+void gtfb_simd::gtfb_simd_t::update_cfg()
 {
     if (prepared) {
         gtfb_simd_cfg_t * c =
@@ -462,9 +346,10 @@ void gtfb_simd_t::update_cfg()
     }
 }
 
-gtfb_simd_t::gtfb_simd_t(MHA_AC::algo_comm_t & iac, const std::string &)
+gtfb_simd::gtfb_simd_t::gtfb_simd_t(MHA_AC::algo_comm_t & iac,
+                                    const std::string &)
     : MHAPlugin::plugin_t<gtfb_simd_cfg_t>("Gammatone Filterbank Analyzer",
-                                               iac),
+                                           iac),
       prepared(false),
       order("Order of gammatone filters", "4", "[0,["),
       coeff("Filter coefficients of gammatone filters", "[]"),
@@ -478,42 +363,51 @@ gtfb_simd_t::gtfb_simd_t(MHA_AC::algo_comm_t & iac, const std::string &)
     patchbay.connect(&order.writeaccess,this,&gtfb_simd_t::update_cfg);
 }
 
-void gtfb_simd_t::prepare(mhaconfig_t& tf)
+void gtfb_simd::gtfb_simd_t::prepare(mhaconfig_t& tf)
 {
     if (prepared) 
         throw MHA_ErrorMsg("gtfb_simd_t::prepare is called a second time");
     if( tf.domain != MHA_WAVEFORM)
-        throw MHA_ErrorMsg("gtfb_analyzer: Only waveform input can be processed.");
+        throw MHA_ErrorMsg("gtfb_simd: Only waveform input can be processed.");
     tftype = tf;
     tf.channels *= coeff.data.size() * 2;
     prepared = true;
-
-    // treat subnormals as zero
-    unsigned int mxcsr = __builtin_ia32_stmxcsr ();
-    mxcsr |= MXCSR_DAZ | MXCSR_FTZ;
-    __builtin_ia32_ldmxcsr (mxcsr);
-
     update_cfg();
 }
 
-mha_wave_t* gtfb_simd_t::process(mha_wave_t* s)
+void gtfb_simd::gtfb_simd_t::release()
+{
+    prepared = false;
+}
+
+mha_wave_t* gtfb_simd::gtfb_simd_t::process(mha_wave_t* s)
 {
     poll_config();
+    // treat subnormals as zero while this plugin filters
+    denormal_guard_t denormal_guard;
     return cfg->process(s);
 }
 
-MHAPLUGIN_CALLBACKS(gtfb_simd,gtfb_simd_t,wave,wave)
+MHAPLUGIN_CALLBACKS(gtfb_simd,gtfb_simd::gtfb_simd_t,wave,wave)
 MHAPLUGIN_DOCUMENTATION
 (gtfb_simd,"filterbank",
- "gtfb\\_simd implements the same gammatone filterbank as plugin gtfb\\_analyzer.\n"
- "The gammatone filtering is performed using built-in vector operations of x86."
- "The total number of bands (audio channels x filterbank frequencies) has to be"
- "a multiple of 4."
+ "gtfb\\_simd implements the same gammatone filterbank as plugin"
+ " gtfb\\_analyzer, with the same parameters and the same layout of"
+ " output channels, and can be used as a replacement for gtfb\\_analyzer."
+ " The gammatone filtering is performed using the generic vector"
+ " extensions of the compiler, which translate to SSE or AVX"
+ " instructions on x86 and to NEON instructions on ARM."
+ " All bands of all audio channels are filtered in vectors of 4 or 8"
+ " bands (depending on the instruction set enabled at compile time);"
+ " if the total number of bands is not a multiple of the vector width,"
+ " the last vector is padded with unused bands."
  "\n\n"
- "This plugin should be regarded as a proof-of-concept how Single-Instruction-"
- "Multiple-Data (SIMD) can be used inside openMHA.  For practical gammatone "
- "filtering applications, the plugins gtfb\\_analyzer and "
- "gtfb\\_simple\\_bridge should be used instead." )
+ "While processing, the floating point unit is switched to"
+ " flush-to-zero and denormals-are-zero mode, so that the recursive"
+ " filters do not produce subnormal numbers during silence.  The previous"
+ " mode is restored before the plugin returns, other plugins are not"
+ " affected.  Results may therefore differ from gtfb\\_analyzer by"
+ " rounding errors and in the range of subnormal numbers.\n" )
 
 // Local Variables:
 // compile-command: "make"
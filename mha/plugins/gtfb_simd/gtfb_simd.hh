@@ -0,0 +1,163 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2009 2010 2013 2014 2015 2018 2020 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GTFB_SIMD_HH
+#define GTFB_SIMD_HH
+
+#include "mha_plugin.hh"
+#include "mha_signal.hh"
+#include "mha_parser.hh"
+#include "mha_events.h"
+#include "mha_simd.hh"
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace gtfb_simd {
+
+    /// Number of float values processed with one vector operation
+    constexpr unsigned simd_width = MHASimd::native_width;
+
+    /** Vector of simd_width floats, SSE, AVX or NEON depending on the
+     * target architecture. */
+    typedef MHASimd::vnative_t vfloat_t;
+
+    /** Enables flush-to-zero and denormals-are-zero mode of the
+     * floating point unit for the lifetime of the object, and restores
+     * the previous mode on destruction.  The mode is a property of the
+     * calling thread, therefore the guard has to be created in the
+     * signal processing thread.  Does nothing on architectures without
+     * known control register. */
+    class denormal_guard_t {
+    public:
+        denormal_guard_t();
+        ~denormal_guard_t();
+        denormal_guard_t(const denormal_guard_t&) = delete;
+        denormal_guard_t& operator=(const denormal_guard_t&) = delete;
+    private:
+        /// Floating point control register content before construction
+        unsigned long long saved;
+    };
+
+    void filter_sisd_complex(const unsigned bands, const unsigned order,
+                             const mha_complex_t * inputs,
+                             mha_complex_t * outputs,
+                             const mha_complex_t * coefficients,
+                             mha_complex_t * states);
+
+    void filter_simd(const unsigned vectors, const unsigned order,
+                     const unsigned frames,
+                     const vfloat_t * inputs,
+                     const vfloat_t * rnorm, const vfloat_t * inorm,
+                     const vfloat_t * rcoefficients,
+                     const vfloat_t * icoefficients,
+                     vfloat_t * rstates, vfloat_t * istates,
+                     vfloat_t * routputs, vfloat_t * ioutputs);
+
+    /**
+     * Configuration for Gammatone Filterbank SIMD Analyzer.
+     */
+    class gtfb_simd_cfg_t {
+
+        unsigned order;             /**< The order of the gammatone filters.*/
+        unsigned bands;             /**< Number of frequency bands per channel */
+        unsigned channels;          /**< Number of input audio channels */
+        unsigned bandsXchannels;    /**< Product of bands and channels */
+        /// Number of vectors needed for bandsXchannels values.  The
+        /// unused lanes of the last vector have zero coefficients.
+        unsigned vectors;
+
+        /// Normalization and phase correction factor, per output band
+        std::vector<vfloat_t> rnorm, inorm;
+
+        /// The complex coefficients of the gammatone filter bands.
+        std::vector<vfloat_t> rcoefficients, icoefficients;
+
+        /** Storage for Filter state.
+         * Holds vectors * order complex filter states.
+         * Layout: state[stage * vectors + vector]
+         */
+        std::vector<vfloat_t> rstates, istates;
+
+        /// Input samples of one block, the sample of each channel is
+        /// repeated for all bands of that channel.  Layout:
+        /// inputs[frame * vectors + vector].
+        std::vector<vfloat_t> inputs;
+
+        /// Filter output of one block, same layout as inputs.
+        std::vector<vfloat_t> routputs, ioutputs;
+
+        /** Storage for the (complex) output signal.  Same layout as the
+         * output of gtfb_analyzer: each complex time signal is stored as
+         * adjacent real and imaginary channels, complex output from one
+         * source channel is stored in adjacent complex output channels.
+         */
+        MHASignal::waveform_t s_out;
+    public:
+        /// Each band is split into this number of bands.
+        unsigned get_bands() const {return bands;}
+        /// The number of separate audio channels.
+        unsigned get_channels() const {return channels;}
+        /// The number of frames in one chunk.
+        unsigned get_frames() const {return s_out.num_frames;}
+
+        /**
+         * Create a configuration for Gammatone Filterbank Analyzer.
+         * @param ch     Number of Audio channels.
+         * @param frames Number of Audio frames per chunk.
+         * @param ord    The order of the gammatone filters.
+         * @param _coeff Complex gammatone filter coefficients.
+         * @param _norm_phase Normalization and phase correction factors.
+         */
+        gtfb_simd_cfg_t(unsigned ch, unsigned frames, unsigned ord,
+                        const std::vector<mha_complex_t> & _coeff,
+                        const std::vector<mha_complex_t> & _norm_phase);
+
+        /** Filter one block of audio.
+         * @param s_in Input signal with get_channels() channels and
+         *             get_frames() frames.
+         * @return Complex band signals. */
+        mha_wave_t * process(const mha_wave_t * s_in);
+    };
+
+    /// Gammatone Filterbank SIMD Analyzer Plugin
+    class gtfb_simd_t : public MHAPlugin::plugin_t<gtfb_simd_cfg_t> {
+    public:
+        gtfb_simd_t(MHA_AC::algo_comm_t & iac,
+                    const std::string & configured_name);
+        mha_wave_t* process(mha_wave_t*);
+        void prepare(mhaconfig_t&);
+        void release();
+    private:
+        void update_cfg();
+        MHAEvents::patchbay_t<gtfb_simd_t> patchbay;
+        bool prepared;
+        MHAParser::int_t order;
+        MHAParser::vcomplex_t coeff;
+        MHAParser::vcomplex_t norm_phase;
+    };
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
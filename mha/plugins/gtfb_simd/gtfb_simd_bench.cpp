@@ -0,0 +1,129 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost of the SIMD gammatone filterbank with the readable
+// complex implementation of gtfb_analyzer.
+
+#include "gtfb_simd.hh"
+#include "mha_filter.hh"
+#include <chrono>
+#include <iostream>
+
+namespace {
+  /// Gammatone filter coefficients for bands spaced 1 ERB apart
+  std::vector<mha_complex_t> gt_coeff(unsigned bands, unsigned order,
+                                      std::vector<mha_complex_t> & norm_phase)
+  {
+    const double fs = 16000;
+    std::vector<mha_complex_t> coeff;
+    norm_phase.clear();
+    for (unsigned band = 0; band < bands; ++band) {
+      const double f = 100.0 * pow(1.1, band);
+      const double bw = 24.7 + 0.108 * f;
+      const double lambda = exp(-2 * M_PI * 1.019 * bw / fs);
+      coeff.push_back(mha_complex(lambda * cos(2 * M_PI * f / fs),
+                                  lambda * sin(2 * M_PI * f / fs)));
+      const double norm = 2 * pow(1 - lambda, order);
+      norm_phase.push_back(mha_complex(norm * cos(0.1 * band),
+                                       norm * sin(0.1 * band)));
+    }
+    return coeff;
+  }
+
+  /// Computes the gtfb_analyzer output for one block with the readable
+  /// complex implementation, states are preserved between calls.
+  class reference_t {
+  public:
+    reference_t(unsigned ch, unsigned frames, unsigned ord,
+                const std::vector<mha_complex_t> & c,
+                const std::vector<mha_complex_t> & np)
+      : order(ord), coeff(), norm_phase(np),
+        bXc(ch * c.size()), inputs(bXc), outputs(bXc),
+        states(bXc * ord, mha_complex(0)), s_out(frames, bXc * 2)
+    {
+      for (unsigned channel = 0; channel < ch; ++channel)
+        coeff.insert(coeff.end(), c.begin(), c.end());
+    }
+    mha_wave_t * process(const mha_wave_t * s)
+    {
+      const unsigned bands = norm_phase.size();
+      for (unsigned frame = 0; frame < s->num_frames; ++frame) {
+        for (unsigned k = 0; k < bXc; ++k)
+          (inputs[k] = norm_phase[k % bands]) *=
+            value(s, frame, k / bands);
+        gtfb_simd::filter_sisd_complex(bXc, order, inputs.data(),
+                                       outputs.data(), coeff.data(),
+                                       states.data());
+        for (unsigned k = 0; k < bXc; ++k) {
+          MHAFilter::make_friendly_number(outputs[k]);
+          s_out.value(frame, 2 * k) = outputs[k].re;
+          s_out.value(frame, 2 * k + 1) = outputs[k].im;
+        }
+      }
+      return &s_out;
+    }
+  private:
+    unsigned order;
+    std::vector<mha_complex_t> coeff, norm_phase;
+    unsigned bXc;
+    std::vector<mha_complex_t> inputs, outputs, states;
+    MHASignal::waveform_t s_out;
+  };
+
+  void fill_noise(MHASignal::waveform_t & s, unsigned seed)
+  {
+    for (unsigned k = 0; k < size(s); ++k) {
+      seed = seed * 1664525U + 1013904223U;
+      s.buf[k] = (seed >> 8) / double(1 << 24) - 0.5;
+    }
+  }
+}
+
+int main()
+{
+  const unsigned channels = 2, frames = 64, order = 4, blocks = 2000;
+  for (unsigned bands : {30U, 48U, 64U}) {
+    std::vector<mha_complex_t> norm_phase;
+    auto coeff = gt_coeff(bands, order, norm_phase);
+    gtfb_simd::gtfb_simd_cfg_t simd(channels, frames, order, coeff,
+                                    norm_phase);
+    reference_t ref(channels, frames, order, coeff, norm_phase);
+    MHASignal::waveform_t in(frames, channels);
+    fill_noise(in, 1);
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      ref.process(&in);
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b) {
+      gtfb_simd::denormal_guard_t guard;
+      simd.process(&in);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << bands << " bands x " << channels << " channels, "
+              << gtfb_simd::simd_width << " lanes: complex "
+              << std::chrono::duration<double,std::micro>(t1-t0).count()/blocks
+              << " us/block, simd "
+              << std::chrono::duration<double,std::micro>(t2-t1).count()/blocks
+              << " us/block" << std::endl;
+  }
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,242 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "gtfb_simd.hh"
+#include "mha_algo_comm.hh"
+#include "mha_filter.hh"
+#include "mha_os.h"
+#include "mhapluginloader.h"
+
+namespace {
+  /// Gammatone filter coefficients for bands spaced 1 ERB apart
+  std::vector<mha_complex_t> gt_coeff(unsigned bands, unsigned order,
+                                      std::vector<mha_complex_t> & norm_phase)
+  {
+    const double fs = 16000;
+    std::vector<mha_complex_t> coeff;
+    norm_phase.clear();
+    for (unsigned band = 0; band < bands; ++band) {
+      const double f = 100.0 * pow(1.1, band);
+      const double bw = 24.7 + 0.108 * f;
+      const double lambda = exp(-2 * M_PI * 1.019 * bw / fs);
+      coeff.push_back(mha_complex(lambda * cos(2 * M_PI * f / fs),
+                                  lambda * sin(2 * M_PI * f / fs)));
+      const double norm = 2 * pow(1 - lambda, order);
+      norm_phase.push_back(mha_complex(norm * cos(0.1 * band),
+                                       norm * sin(0.1 * band)));
+    }
+    return coeff;
+  }
+
+  /// Computes the gtfb_analyzer output for one block with the readable
+  /// complex implementation, states are preserved between calls.
+  class reference_t {
+  public:
+    reference_t(unsigned ch, unsigned frames, unsigned ord,
+                const std::vector<mha_complex_t> & c,
+                const std::vector<mha_complex_t> & np)
+      : order(ord), coeff(), norm_phase(np),
+        bXc(ch * c.size()), inputs(bXc), outputs(bXc),
+        states(bXc * ord, mha_complex(0)), s_out(frames, bXc * 2)
+    {
+      for (unsigned channel = 0; channel < ch; ++channel)
+        coeff.insert(coeff.end(), c.begin(), c.end());
+    }
+    mha_wave_t * process(const mha_wave_t * s)
+    {
+      const unsigned bands = norm_phase.size();
+      for (unsigned frame = 0; frame < s->num_frames; ++frame) {
+        for (unsigned k = 0; k < bXc; ++k)
+          (inputs[k] = norm_phase[k % bands]) *=
+            value(s, frame, k / bands);
+        gtfb_simd::filter_sisd_complex(bXc, order, inputs.data(),
+                                       outputs.data(), coeff.data(),
+                                       states.data());
+        for (unsigned k = 0; k < bXc; ++k) {
+          MHAFilter::make_friendly_number(outputs[k]);
+          s_out.value(frame, 2 * k) = outputs[k].re;
+          s_out.value(frame, 2 * k + 1) = outputs[k].im;
+        }
+      }
+      return &s_out;
+    }
+  private:
+    unsigned order;
+    std::vector<mha_complex_t> coeff, norm_phase;
+    unsigned bXc;
+    std::vector<mha_complex_t> inputs, outputs, states;
+    MHASignal::waveform_t s_out;
+  };
+
+  void fill_noise(MHASignal::waveform_t & s, unsigned seed)
+  {
+    for (unsigned k = 0; k < size(s); ++k) {
+      seed = seed * 1664525U + 1013904223U;
+      s.buf[k] = (seed >> 8) / double(1 << 24) - 0.5;
+    }
+  }
+
+  /// Filters some blocks with both implementations and compares.
+  void expect_equal_to_reference(unsigned channels, unsigned bands,
+                                 unsigned order, unsigned frames)
+  {
+    std::vector<mha_complex_t> norm_phase;
+    auto coeff = gt_coeff(bands, order, norm_phase);
+    gtfb_simd::gtfb_simd_cfg_t simd(channels, frames, order, coeff,
+                                    norm_phase);
+    reference_t ref(channels, frames, order, coeff, norm_phase);
+    MHASignal::waveform_t in(frames, channels);
+    for (unsigned block = 0; block < 5; ++block) {
+      fill_noise(in, block);
+      mha_wave_t * expected = ref.process(&in);
+      mha_wave_t * actual = simd.process(&in);
+      ASSERT_EQ(expected->num_channels, actual->num_channels);
+      ASSERT_EQ(expected->num_frames, actual->num_frames);
+      for (unsigned k = 0; k < size(expected); ++k)
+        ASSERT_NEAR(expected->buf[k], actual->buf[k], 2e-6f)
+          << "block " << block << " index " << k
+          << " (" << channels << " channels, " << bands << " bands, order "
+          << order << ")";
+    }
+  }
+}
+
+TEST(gtfb_simd_cfg_t, equals_reference_for_multiple_of_vector_width)
+{
+  expect_equal_to_reference(2, 16, 4, 32);
+}
+
+TEST(gtfb_simd_cfg_t, equals_reference_with_remainder_bands)
+{
+  expect_equal_to_reference(1, 5, 4, 10);
+  expect_equal_to_reference(2, 30, 4, 64);
+  expect_equal_to_reference(3, 1, 3, 7);
+}
+
+TEST(gtfb_simd_cfg_t, equals_reference_for_order_zero)
+{
+  expect_equal_to_reference(2, 3, 0, 8);
+}
+
+TEST(gtfb_simd_cfg_t, checks_dimensions)
+{
+  std::vector<mha_complex_t> norm_phase;
+  auto coeff = gt_coeff(3, 4, norm_phase);
+  norm_phase.pop_back();
+  EXPECT_THROW(gtfb_simd::gtfb_simd_cfg_t(1, 8, 4, coeff, norm_phase),
+               MHA_Error);
+  norm_phase.push_back(norm_phase.back());
+  gtfb_simd::gtfb_simd_cfg_t simd(2, 8, 4, coeff, norm_phase);
+  MHASignal::waveform_t wrong_channels(8, 1), wrong_frames(4, 2);
+  EXPECT_THROW(simd.process(&wrong_channels), MHA_Error);
+  EXPECT_THROW(simd.process(&wrong_frames), MHA_Error);
+}
+
+TEST(gtfb_simd_t, plugin_produces_gtfb_analyzer_layout)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  gtfb_simd::gtfb_simd_t plugin(acspace, "gtfb_simd");
+  plugin.parse("order = 4");
+  plugin.parse("coeff = [(0.9+0.1i) (0.8+0.3i) (0.5+0.7i)]");
+  plugin.parse("norm_phase = [(0.1+0i) (0+0.1i) (0.05+0.05i)]");
+  mhaconfig_t cf = {.channels = 2, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  plugin.prepare_(cf);
+  EXPECT_EQ(12U, cf.channels);
+  std::vector<mha_complex_t> coeff = {mha_complex(0.9f, 0.1f),
+                                      mha_complex(0.8f, 0.3f),
+                                      mha_complex(0.5f, 0.7f)};
+  std::vector<mha_complex_t> norm_phase = {mha_complex(0.1f, 0.0f),
+                                           mha_complex(0.0f, 0.1f),
+                                           mha_complex(0.05f, 0.05f)};
+  reference_t ref(2, 16, 4, coeff, norm_phase);
+  MHASignal::waveform_t in(16, 2);
+  fill_noise(in, 42);
+  mha_wave_t * expected = ref.process(&in);
+  mha_wave_t * actual = plugin.process(&in);
+  ASSERT_EQ(12U, actual->num_channels);
+  for (unsigned k = 0; k < size(expected); ++k)
+    EXPECT_NEAR(expected->buf[k], actual->buf[k], 1e-6f) << k;
+  plugin.release_();
+  EXPECT_NO_THROW(plugin.prepare_(cf));
+  plugin.release_();
+}
+
+TEST(gtfb_simd_t, equals_gtfb_analyzer_plugin)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  std::unique_ptr<PluginLoader::mhapluginloader_t> analyzer;
+  {
+    // Only needed while the plugin library is loaded
+    mha_stash_environment_variable_t library_path("MHA_LIBRARY_PATH",
+                                                  GTFB_ANALYZER_DIR);
+    analyzer = std::make_unique<PluginLoader::mhapluginloader_t>
+      (acspace, "gtfb_analyzer");
+  }
+  gtfb_simd::gtfb_simd_t simd(acspace, "gtfb_simd");
+  std::vector<mha_complex_t> norm_phase;
+  const auto coeff = gt_coeff(30, 4, norm_phase);
+  const std::vector<std::string> cfg =
+    {"order = 4",
+     "coeff = " + MHAParser::StrCnv::val2str(coeff),
+     "norm_phase = " + MHAParser::StrCnv::val2str(norm_phase)};
+  for (const std::string & cmd : cfg) {
+    analyzer->parse(cmd);
+    simd.parse(cmd);
+  }
+  mhaconfig_t cf = {.channels = 2, .domain = MHA_WAVEFORM, .fragsize = 64,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  mhaconfig_t cf_simd = cf;
+  analyzer->prepare(cf);
+  simd.prepare_(cf_simd);
+  EXPECT_EQ(cf.channels, cf_simd.channels);
+  MHASignal::waveform_t in(64, 2);
+  for (unsigned block = 0; block < 5; ++block) {
+    fill_noise(in, block);
+    mha_wave_t * expected = nullptr;
+    analyzer->process(&in, &expected);
+    mha_wave_t * actual = simd.process(&in);
+    ASSERT_EQ(expected->num_channels, actual->num_channels);
+    ASSERT_EQ(expected->num_frames, actual->num_frames);
+    for (unsigned k = 0; k < size(expected); ++k)
+      ASSERT_NEAR(expected->buf[k], actual->buf[k], 2e-6f)
+        << "block " << block << " index " << k;
+  }
+  simd.release_();
+  analyzer->release();
+}
+
+#if defined(__SSE__)
+TEST(denormal_guard_t, sets_and_restores_flush_to_zero)
+{
+  const unsigned int before = _mm_getcsr();
+  {
+    gtfb_simd::denormal_guard_t guard;
+    EXPECT_EQ(0x8040U, _mm_getcsr() & 0x8040U);
+    volatile float tiny = std::numeric_limits<float>::min();
+    volatile float result = tiny * 0.5f;
+    EXPECT_EQ(0.0f, result);
+  }
+  EXPECT_EQ(before, _mm_getcsr());
+}
+#endif
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
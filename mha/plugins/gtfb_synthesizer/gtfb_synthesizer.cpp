@@ -0,0 +1,197 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtfb_synthesizer.hh"
+#include <algorithm>
+
+gtfb_synthesizer::gtfb_synthesizer_cfg_t::
+gtfb_synthesizer_cfg_t(unsigned ch, unsigned frames,
+                       const std::vector<int> & delays,
+                       const std::vector<mha_real_t> & gains)
+    : bands(delays.size()),
+      channels(ch),
+      filters(ch * delays.size()),
+      delay(filters),
+      gain(filters),
+      mask(0),
+      pos(0),
+      s_out(frames, ch)
+{
+    if (delays.size() != gains.size())
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Number (%zu) of delays differs from number "
+                        "(%zu) of gains", delays.size(), gains.size());
+    if (bands == 0)
+        throw MHA_ErrorMsg("gtfb_synthesizer: No bands configured.");
+    int max_delay = 0;
+    for (unsigned band = 0; band < bands; ++band) {
+        if (delays[band] < 0)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "Negative delay %d in band %u",
+                            delays[band], band);
+        max_delay = std::max(max_delay, delays[band]);
+    }
+    unsigned len = 1;
+    while (len <= unsigned(max_delay))
+        len *= 2;
+    mask = len - 1;
+    ring.resize(len * filters, 0.0f);
+    for (unsigned channel = 0; channel < channels; ++channel)
+        for (unsigned band = 0; band < bands; ++band) {
+            delay[bands*channel+band] = delays[band];
+            gain[bands*channel+band] = gains[band];
+        }
+}
+
+mha_wave_t * gtfb_synthesizer::gtfb_synthesizer_cfg_t::process(const mha_wave_t * s)
+{
+    if (s->num_channels != 2 * filters || s->num_frames != s_out.num_frames)
+        throw MHA_ErrorMsg("Input signal: unexpected frame or channel count");
+    const unsigned n = filters;
+    for (unsigned frame = 0; frame < s->num_frames; ++frame) {
+        // store the real parts of all bands of this frame
+        const mha_real_t * in = s->buf + frame * 2 * n;
+        mha_real_t * slot = ring.data() + pos * n;
+        for (unsigned k = 0; k < n; ++k)
+            slot[k] = in[2*k];
+        // sum the delayed and weighted bands of each channel
+        for (unsigned channel = 0; channel < channels; ++channel) {
+            mha_real_t sum = 0.0f;
+            for (unsigned k = bands*channel; k < bands*(channel+1); ++k)
+                sum += gain[k] * ring[((pos - delay[k]) & mask) * n + k];
+            value(s_out, frame, channel) = sum;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return &s_out;
+}
+
+/********************************************************************/
+
+void gtfb_synthesizer::gtfb_synthesizer_t::update_cfg()
+{
+    if (prepared) {
+        if (delay.data.size() != bands)
+            throw MHA_Error(__FILE__,__LINE__,
+                            "gtfb_synthesizer: The number of bands cannot"
+                            " change from %u to %zu while prepared, the"
+                            " input has %u channels.", bands,
+                            delay.data.size(), 2 * bands * tftype.channels);
+        std::vector<mha_real_t> gains = gain.data;
+        if (gains.empty())
+            gains.resize(delay.data.size(), 1.0f);
+        push_config(new gtfb_synthesizer_cfg_t(tftype.channels,
+                                               tftype.fragsize,
+                                               delay.data,
+                                               gains));
+    }
+}
+
+gtfb_synthesizer::gtfb_synthesizer_t::
+gtfb_synthesizer_t(MHA_AC::algo_comm_t & iac, const std::string &)
+    : MHAPlugin::plugin_t<gtfb_synthesizer_cfg_t>("Gammatone Filterbank"
+                                                  " Synthesizer", iac),
+      prepared(false),
+      bands(0),
+      delay("Delay in samples for each band", "[]", "[0,["),
+      gain("Linear gain for each band. Empty: unit gain in all bands.", "[]")
+{
+    insert_item("delay", &delay);
+    patchbay.connect(&delay.writeaccess,this,
+                     &gtfb_synthesizer::gtfb_synthesizer_t::update_cfg);
+    insert_item("gain", &gain);
+    patchbay.connect(&gain.writeaccess,this,
+                     &gtfb_synthesizer::gtfb_synthesizer_t::update_cfg);
+}
+
+void gtfb_synthesizer::gtfb_synthesizer_t::prepare(mhaconfig_t& tf)
+{
+    if (prepared)
+        throw MHA_ErrorMsg("gtfb_synthesizer::gtfb_synthesizer_t::prepare"
+                           " is called a second time");
+    if (tf.domain != MHA_WAVEFORM)
+        throw MHA_ErrorMsg("gtfb_synthesizer: Only waveform input can be processed.");
+    bands = delay.data.size();
+    if (bands == 0)
+        throw MHA_ErrorMsg("gtfb_synthesizer: No bands configured.");
+    if (tf.channels % (2 * bands))
+        throw MHA_Error(__FILE__,__LINE__,
+                        "gtfb_synthesizer: The number of input channels (%u)"
+                        " is not a multiple of 2 * %u bands.",
+                        tf.channels, bands);
+    tf.channels /= 2 * bands;
+    tftype = tf;
+    prepared = true;
+    try {
+        update_cfg();
+    } catch (...) {
+        prepared = false;
+        tf.channels *= 2 * bands;
+        throw;
+    }
+}
+
+void gtfb_synthesizer::gtfb_synthesizer_t::release()
+{
+    prepared = false;
+}
+
+mha_wave_t* gtfb_synthesizer::gtfb_synthesizer_t::process(mha_wave_t* s)
+{
+    poll_config();
+    return cfg->process(s);
+}
+
+MHAPLUGIN_CALLBACKS(gtfb_synthesizer,gtfb_synthesizer::gtfb_synthesizer_t,
+                    wave,wave)
+MHAPLUGIN_DOCUMENTATION\
+(gtfb_synthesizer,
+ "filterbank",
+ "Resynthesizes broadband signals from the complex band signals produced"
+ " by \\texttt{gtfb\\_analyzer} (or \\texttt{gtfb\\_simd}), following the"
+ " delay-and-sum synthesis described in Hohmann(2002)\\footnote{"
+ " Volker Hohmann,"
+ " Frequency analysis and synthesis using a Gammatone"
+ " filterbank."
+ " Acta Acustica united with Acustica 88(3),"
+ " pp. 433-442, 2002."
+ "}."
+ " The real part of each band is delayed by the number of samples given"
+ " in \\texttt{delay} for this band, multiplied with the linear gain given"
+ " in \\texttt{gain}, and all bands of one audio channel are summed."
+ " The phase factors of the synthesis are expected to be included in"
+ " the \\texttt{norm\\_phase} parameter of the analyzer."
+ "\n\n"
+ " The number of bands is the length of \\texttt{delay}.  The input"
+ " signal has to have the channel layout produced by"
+ " \\texttt{gtfb\\_analyzer}: the number of input channels must be a"
+ " multiple of 2 times the number of bands, and each group of"
+ " 2 times bands input channels produces one output channel."
+ " The same delays and gains are applied to all audio channels."
+ " If \\texttt{gain} is empty, all bands are summed with unit gain."
+ " While the plugin is prepared, delays and gains can be changed, but not"
+ " the number of bands."
+ " Replacing the \\texttt{delay} and \\texttt{matrixmixer} plugins"
+ " that would otherwise be used for resynthesis, this plugin only"
+ " delays the real parts, which are the only parts contributing to"
+ " the output."
+ )
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,111 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GTFB_SYNTHESIZER_HH
+#define GTFB_SYNTHESIZER_HH
+
+#include "mha_plugin.hh"
+#include "mha_signal.hh"
+#include "mha_parser.hh"
+#include "mha_events.h"
+#include <vector>
+
+/**
+   \file   gtfb_synthesizer.hh
+   \brief  Gammatone Filterbank Synthesizer Plugin
+*/
+
+namespace gtfb_synthesizer {
+/** Runtime configuration of the Gammatone Filterbank Synthesizer.
+ * Delays the real parts of all bands with band-specific delays,
+ * multiplies them with band-specific gains and sums all bands of each
+ * audio channel. */
+class gtfb_synthesizer_cfg_t {
+public:
+    /**
+     * Create a configuration for Gammatone Filterbank Synthesizer.
+     * @param ch     Number of broadband audio channels to synthesize.
+     * @param frames Number of Audio frames per chunk.
+     * @param delays Delay in samples for each band.
+     * @param gains  Linear gain for each band.  Must have the same size as
+     *               delays.
+     */
+    gtfb_synthesizer_cfg_t(unsigned ch, unsigned frames,
+                           const std::vector<int> & delays,
+                           const std::vector<mha_real_t> & gains);
+
+    /** Resynthesize one block of audio.
+     * @param s Complex band signals in the output layout of gtfb_analyzer,
+     *          with channels*bands*2 channels.
+     * @return Broadband output signal with channels channels. */
+    mha_wave_t * process(const mha_wave_t * s);
+
+    /// Each channel is composed of this number of bands.
+    unsigned get_bands() const {return bands;}
+    /// The number of broadband audio channels.
+    unsigned get_channels() const {return channels;}
+private:
+    /// Number of bands per audio channel
+    unsigned bands;
+    /// Number of broadband audio channels
+    unsigned channels;
+    /// Number of bands of all channels, channels * bands
+    unsigned filters;
+    /// Delay of each band, repeated for every channel,
+    /// index [bands*channel+band]
+    std::vector<unsigned> delay;
+    /// Gain of each band, same layout as delay
+    std::vector<mha_real_t> gain;
+    /// Length of the delay ring buffer minus one. The length is a power
+    /// of two, so that ring indices wrap with a bit mask.
+    unsigned mask;
+    /// Slot in the ring buffer where the current frame is stored
+    unsigned pos;
+    /// Ring buffer of past real parts, layout [slot*filters+filter]
+    std::vector<mha_real_t> ring;
+    /// Output signal
+    MHASignal::waveform_t s_out;
+};
+
+/// Gammatone Filterbank Synthesizer Plugin
+class gtfb_synthesizer_t : public MHAPlugin::plugin_t<gtfb_synthesizer_cfg_t> {
+public:
+    gtfb_synthesizer_t(MHA_AC::algo_comm_t & iac,
+                       const std::string & configured_name);
+    mha_wave_t* process(mha_wave_t*);
+    void prepare(mhaconfig_t&);
+    void release();
+private:
+    /// Create a new runtime configuration if prepared.  Throws if the
+    /// number of bands differs from the one fixed by prepare, so that the
+    /// parser rejects the new value.
+    void update_cfg();
+    MHAEvents::patchbay_t<gtfb_synthesizer_t> patchbay;
+    bool prepared;
+    /// Number of bands of the input signal, fixed while prepared
+    unsigned bands;
+    MHAParser::vint_t delay;
+    MHAParser::vfloat_t gain;
+};
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
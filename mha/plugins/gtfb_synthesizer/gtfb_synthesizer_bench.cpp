@@ -0,0 +1,54 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Measures the cost of the gammatone synthesizer with 40 bands.
+
+#include "gtfb_synthesizer.hh"
+#include <chrono>
+#include <iostream>
+
+using gtfb_synthesizer::gtfb_synthesizer_cfg_t;
+
+int main()
+{
+  const unsigned bands = 40, frames = 64, blocks = 2000;
+  std::vector<int> delays;
+  std::vector<mha_real_t> gains;
+  for (unsigned band = 0; band < bands; ++band) {
+    delays.push_back(band < 12 ? 0 : 9 * band);
+    gains.push_back(1.0f / (band + 1));
+  }
+  for (unsigned channels : {2U, 4U, 6U}) {
+    gtfb_synthesizer_cfg_t cfg(channels, frames, delays, gains);
+    MHASignal::waveform_t in(frames, channels * bands * 2);
+    for (unsigned k = 0; k < size(in); ++k)
+      in.buf[k] = (k % 17) * 0.01f;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      cfg.process(&in);
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << bands << " bands x " << channels << " channels: "
+              << std::chrono::duration<double,std::micro>(t1-t0).count()/blocks
+              << " us/block" << std::endl;
+  }
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,115 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "gtfb_synthesizer.hh"
+#include "mha_algo_comm.hh"
+
+using gtfb_synthesizer::gtfb_synthesizer_cfg_t;
+
+TEST(gtfb_synthesizer_cfg_t, delays_weights_and_sums_real_parts)
+{
+  // 2 channels, 3 bands, block size 4
+  gtfb_synthesizer_cfg_t cfg(2, 4, {0, 1, 5}, {1.0f, 2.0f, -1.0f});
+  MHASignal::waveform_t in(4, 12);
+  // impulse in every band and channel in the first frame, with
+  // band and channel specific amplitude in the real part and an
+  // imaginary part that must not contribute
+  for (unsigned ch = 0; ch < 2; ++ch)
+    for (unsigned band = 0; band < 3; ++band) {
+      in.value(0, 2 * (3 * ch + band)) = 1.0f + band + 10.0f * ch;
+      in.value(0, 2 * (3 * ch + band) + 1) = 100.0f;
+    }
+  std::vector<std::vector<float> > expected(8, std::vector<float>(2, 0.0f));
+  for (unsigned ch = 0; ch < 2; ++ch) {
+    expected[0][ch] += 1.0f * (1.0f + 10.0f * ch);
+    expected[1][ch] += 2.0f * (2.0f + 10.0f * ch);
+    expected[5][ch] += -1.0f * (3.0f + 10.0f * ch);
+  }
+  for (unsigned block = 0; block < 2; ++block) {
+    mha_wave_t * out = cfg.process(&in);
+    ASSERT_EQ(2U, out->num_channels);
+    ASSERT_EQ(4U, out->num_frames);
+    for (unsigned frame = 0; frame < 4; ++frame)
+      for (unsigned ch = 0; ch < 2; ++ch)
+        EXPECT_FLOAT_EQ(expected[4 * block + frame][ch],
+                        value(out, frame, ch))
+          << "block " << block << " frame " << frame << " channel " << ch;
+    in.assign(0.0f);
+  }
+}
+
+TEST(gtfb_synthesizer_cfg_t, checks_parameters_and_dimensions)
+{
+  EXPECT_THROW(gtfb_synthesizer_cfg_t(1, 4, {0, 1}, {1.0f}), MHA_Error);
+  EXPECT_THROW(gtfb_synthesizer_cfg_t(1, 4, {0, -1}, {1.0f, 1.0f}),
+               MHA_Error);
+  EXPECT_THROW(gtfb_synthesizer_cfg_t(1, 4, {}, {}), MHA_Error);
+  gtfb_synthesizer_cfg_t cfg(1, 4, {0, 1}, {1.0f, 1.0f});
+  MHASignal::waveform_t wrong_channels(4, 2), wrong_frames(3, 4);
+  EXPECT_THROW(cfg.process(&wrong_channels), MHA_Error);
+  EXPECT_THROW(cfg.process(&wrong_frames), MHA_Error);
+}
+
+TEST(gtfb_synthesizer_t, prepare_computes_output_channels)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  gtfb_synthesizer::gtfb_synthesizer_t plugin(acspace, "gtfb_synthesizer");
+  mhaconfig_t cf = {.channels = 12, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  EXPECT_THROW(plugin.prepare_(cf), MHA_Error);
+  plugin.parse("delay = [0 4 8 12]");
+  EXPECT_THROW(plugin.prepare_(cf), MHA_Error);
+  plugin.parse("delay = [0 4 8]");
+  plugin.prepare_(cf);
+  EXPECT_EQ(2U, cf.channels);
+  MHASignal::waveform_t in(16, 12);
+  in.value(0, 0) = 1.0f;
+  mha_wave_t * out = plugin.process(&in);
+  EXPECT_EQ(1.0f, value(out, 0, 0)); // unit gain if gain is empty
+  plugin.release_();
+}
+
+TEST(gtfb_synthesizer_t, rejects_different_number_of_bands_while_prepared)
+{
+  MHA_AC::algo_comm_class_t acspace;
+  gtfb_synthesizer::gtfb_synthesizer_t plugin(acspace, "gtfb_synthesizer");
+  mhaconfig_t cf = {.channels = 12, .domain = MHA_WAVEFORM, .fragsize = 16,
+                    .wndlen = 0, .fftlen = 0, .srate = 16000};
+  plugin.parse("delay = [0 4 8]");
+  plugin.prepare_(cf);
+  EXPECT_THROW(plugin.parse("delay = [0 4]"), MHA_Error);
+  EXPECT_EQ("[0 4 8]", plugin.parse("delay?val"));
+  EXPECT_THROW(plugin.parse("gain = [1 2]"), MHA_Error);
+  EXPECT_EQ("[]", plugin.parse("gain?val"));
+  // same number of bands: new delays and gains take effect
+  plugin.parse("delay = [1 4 8]");
+  plugin.parse("gain = [2 1 1]");
+  MHASignal::waveform_t in(16, 12);
+  in.value(0, 0) = 1.0f;
+  mha_wave_t * out = plugin.process(&in);
+  EXPECT_EQ(0.0f, value(out, 0, 0));
+  EXPECT_EQ(2.0f, value(out, 1, 0));
+  plugin.release_();
+  // not prepared: any number of bands
+  EXPECT_NO_THROW(plugin.parse("delay = [0 4]"));
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
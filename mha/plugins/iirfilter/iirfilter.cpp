@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2009 2010 2013 2014 2015 2017 2018 2019 HörTech gGmbH
 // Copyright © 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -52,6 +52,11 @@ MHAPLUGIN_DOCUMENTATION\
  "II). The coefficients have the same names as in \\Matlab{}. Due to\n"
  "different internal implementations and numeric resolutions, filters\n"
  "may be instable with coeffients which are stable in \\Matlab{}.\n"
+ "\n"
+ "Setting the variable {\\tt engine} to {\\tt sos} factorizes the\n"
+ "coefficients into a cascade of second order sections in transposed\n"
+ "direct form II, which is numerically more robust for higher filter\n"
+ "orders and processes all audio channels of one section together.\n"
  )
 
 // Local Variables:
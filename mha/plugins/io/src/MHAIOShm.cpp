@@ -0,0 +1,418 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_io_ifc.h"
+#include "mha_toolbox.h"
+#include "mha_shm_server.hh"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#define ERR_SUCCESS 0
+#define ERR_IHANDLE -1
+#define ERR_USER -1000
+
+#define MAX_USER_ERR 0x500
+static char user_err_msg[MAX_USER_ERR] = "";
+
+/** Timeout in ms after which the processing thread checks for stop
+ * requests while waiting for the client. */
+#define POLL_INTERVAL_MS 100
+
+/** Shared memory sound io library.  Exchanges audio blocks with a client
+ * process on the same host through a shared memory segment, see
+ * mha_shm_client.h for the client side.  Input blocks are processed in
+ * place in the shared memory, output blocks are copied once. */
+class io_shm_t : public MHAParser::parser_t
+{
+public:
+    io_shm_t(unsigned int fragsize,
+             float samplerate,
+             IOProcessEvent_t proc_event,
+             void* proc_handle,
+             IOStartedEvent_t start_event,
+             void* start_handle,
+             IOStoppedEvent_t stop_event,
+             void* stop_handle);
+
+    /** Stops processing and removes the shared memory segment. */
+    ~io_shm_t();
+
+    /** Prepare. Creates the shared memory segment */
+    void prepare(int nch_in, int nch_out);
+
+    /** Release. Removes the shared memory segment */
+    void release();
+
+    /** Start the processing thread, which waits for blocks from the
+     * client */
+    void start();
+
+    /** Send stop request to processing thread and join it */
+    void stop();
+
+private:
+    /** Processing thread: processes each block written by the client
+     * and writes the result back, until stop is requested or the
+     * processing callback fails. */
+    void process_loop();
+
+    /** Copy the state of the shared memory to the monitor variables. */
+    void update_monitors();
+
+    /** Name of the shared memory segment. */
+    MHAParser::string_t name;
+
+    /** Number of blocks in each ring buffer. */
+    MHAParser::int_t slots;
+
+    /** Process id of the attached client. */
+    MHAParser::int_mon_t client_pid;
+
+    /** Number of blocks received. */
+    MHAParser::int_mon_t blocks;
+
+    /** Number of times the output ring buffer was full. */
+    MHAParser::int_mon_t output_stalls;
+
+    /** The framework's sampling rate */
+    float samplerate;
+
+    /** The framework's frag size */
+    unsigned int fragsize;
+
+    /** Pointer to signal processing callback function. */
+    IOProcessEvent_t proc_event;
+
+    /** Pointer to start notification callback function. */
+    IOStartedEvent_t start_event;
+
+    /** Pointer to stop notification callback function. */
+    IOStoppedEvent_t stop_event;
+
+    /** Handles belonging to framework. */
+    void *proc_handle, *start_handle, *stop_handle;
+
+    /** The shared memory segment, exists between prepare and release. */
+    std::unique_ptr<MHA_SHM::Server> server;
+
+    /** Processing thread, runs between start and stop. */
+    std::thread processing;
+
+    /** Stop request flag for the processing thread */
+    std::atomic<bool> stop_request;
+
+    /** Set by the processing thread when it has already called the
+     * stop callback because of an error. */
+    std::atomic<bool> stopped;
+};
+
+io_shm_t::io_shm_t(unsigned int ifragsize,
+                   float isamplerate,
+                   IOProcessEvent_t iproc_event,
+                   void* iproc_handle,
+                   IOStartedEvent_t istart_event,
+                   void* istart_handle,
+                   IOStoppedEvent_t istop_event,
+                   void* istop_handle)
+    : MHAParser::parser_t("Shared memory sound io library: exchanges audio"
+                          " blocks with a client process on the same host,"
+                          " see mha_shm_client.h"),
+      name("Name of the shared memory segment (without leading slash)",
+           "mha_audio"),
+      slots("Number of audio blocks in each ring buffer", "4", "[2,1024]"),
+      client_pid("Process id of the attached client, 0 if none"),
+      blocks("Number of audio blocks received from clients"),
+      output_stalls("Number of times MHA had to wait for the client to"
+                    " read output blocks"),
+      samplerate(isamplerate),
+      fragsize(ifragsize),
+      proc_event(iproc_event),
+      start_event(istart_event),
+      stop_event(istop_event),
+      proc_handle(iproc_handle),
+      start_handle(istart_handle),
+      stop_handle(istop_handle),
+      stop_request(false),
+      stopped(true)
+{
+    insert_member(name);
+    insert_member(slots);
+    insert_member(client_pid);
+    insert_member(blocks);
+    insert_member(output_stalls);
+}
+
+io_shm_t::~io_shm_t()
+{
+    if (processing.joinable()) {
+        stop_request = true;
+        processing.join();
+    }
+}
+
+void io_shm_t::prepare(int nch_in, int nch_out)
+{
+    if (server)
+        throw MHA_ErrorMsg("Prepare called although the shared memory "
+                           "segment already exists");
+    if (nch_in <= 0 || nch_out < 0)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Invalid number of channels: %d in, %d out",
+                        nch_in, nch_out);
+    server = std::make_unique<MHA_SHM::Server>(name.data, fragsize,
+                                               samplerate, nch_in, nch_out,
+                                               slots.data);
+    update_monitors();
+}
+
+void io_shm_t::release()
+{
+    if (processing.joinable())
+        stop();
+    server.reset();
+    client_pid.data = 0;
+}
+
+void io_shm_t::start()
+{
+    if (!server)
+        throw MHA_ErrorMsg("Start called before prepare");
+    if (processing.joinable()) {
+        if (!stopped)
+            return; // already running
+        processing.join();
+    }
+    stop_request = false;
+    stopped = false;
+    if (start_event)
+        start_event(start_handle);
+    processing = std::thread(&io_shm_t::process_loop, this);
+}
+
+void io_shm_t::stop()
+{
+    stop_request = true;
+    if (processing.joinable())
+        processing.join();
+    if (!stopped.exchange(true) && stop_event)
+        stop_event(stop_handle, 0, 0);
+}
+
+void io_shm_t::update_monitors()
+{
+    client_pid.data = server->get_client_pid();
+    blocks.data = server->get_blocks();
+    output_stalls.data = server->get_output_stalls();
+}
+
+void io_shm_t::process_loop()
+{
+    int proc_err = 0, io_err = 0;
+    try {
+        while (!stop_request) {
+            update_monitors();
+            mha_wave_t * s_in = server->wait_input(POLL_INTERVAL_MS);
+            if (s_in == nullptr)
+                continue;
+            mha_wave_t * s_out = nullptr;
+            proc_err = proc_event(proc_handle, s_in, &s_out);
+            if (proc_err != 0)
+                break;
+            while (!server->put_output(s_out, POLL_INTERVAL_MS) &&
+                   !stop_request)
+                update_monitors();
+        }
+    } catch (MHA_Error & e) {
+        strncpy(user_err_msg, Getmsg(e), MAX_USER_ERR - 1);
+        user_err_msg[MAX_USER_ERR - 1] = 0;
+        io_err = ERR_USER;
+    }
+    update_monitors();
+    // on error switch to stopped state
+    if ((proc_err || io_err) && !stopped.exchange(true) && stop_event)
+        stop_event(stop_handle, proc_err, io_err);
+}
+
+extern "C" {
+#ifdef MHA_STATIC_PLUGINS
+#define IOInit               MHA_STATIC_MHAIOShm_IOInit
+#define IOPrepare            MHA_STATIC_MHAIOShm_IOPrepare
+#define IOStart              MHA_STATIC_MHAIOShm_IOStart
+#define IOStop               MHA_STATIC_MHAIOShm_IOStop
+#define IORelease            MHA_STATIC_MHAIOShm_IORelease
+#define IOSetVar             MHA_STATIC_MHAIOShm_IOSetVar
+#define IOStrError           MHA_STATIC_MHAIOShm_IOStrError
+#define IODestroy            MHA_STATIC_MHAIOShm_IODestroy
+#define dummy_interface_test MHA_STATIC_MHAIOShm_dummy_interface_test
+#else
+#define IOInit               MHA_DYNAMIC_IOInit
+#define IOPrepare            MHA_DYNAMIC_IOPrepare
+#define IOStart              MHA_DYNAMIC_IOStart
+#define IOStop               MHA_DYNAMIC_IOStop
+#define IORelease            MHA_DYNAMIC_IORelease
+#define IOSetVar             MHA_DYNAMIC_IOSetVar
+#define IOStrError           MHA_DYNAMIC_IOStrError
+#define IODestroy            MHA_DYNAMIC_IODestroy
+#define dummy_interface_test MHA_DYNAMIC_dummy_interface_test
+#endif
+    int IOInit(int fragsize,
+               float samplerate,
+               IOProcessEvent_t proc_event,
+               void* proc_handle,
+               IOStartedEvent_t start_event,
+               void* start_handle,
+               IOStoppedEvent_t stop_event,
+               void* stop_handle,
+               void** handle)
+    {
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            *handle = new io_shm_t(fragsize,samplerate,
+                                   proc_event,proc_handle,
+                                   start_event,start_handle,
+                                   stop_event,stop_handle);
+            return ERR_SUCCESS;
+        }
+        catch( MHA_Error& e ){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    int IOPrepare(void* handle,int nch_in,int nch_out){
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            static_cast<io_shm_t*>(handle)->prepare(nch_in,nch_out);
+            return ERR_SUCCESS;
+        }
+        catch( MHA_Error& e ){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    int IOStart(void* handle){
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            static_cast<io_shm_t*>(handle)->start();
+            return ERR_SUCCESS;
+        }
+        catch( MHA_Error& e ){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    int IOStop(void* handle){
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            static_cast<io_shm_t*>(handle)->stop();
+            return ERR_SUCCESS;
+        }
+        catch( MHA_Error& e ){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    int IORelease(void* handle){
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            static_cast<io_shm_t*>(handle)->release();
+            return ERR_SUCCESS;
+        }
+        catch( MHA_Error& e ){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    int IOSetVar(void* handle,const char *command,char *retval,unsigned int maxretlen)
+    {
+        if( !handle )
+            return ERR_IHANDLE;
+        try{
+            static_cast<io_shm_t*>(handle)->parse(command,retval,maxretlen);
+            return ERR_SUCCESS;
+        }
+        catch(MHA_Error& e){
+            strncpy( user_err_msg, Getmsg(e), MAX_USER_ERR-1 );
+            user_err_msg[MAX_USER_ERR-1] = 0;
+            return ERR_USER;
+        }
+    }
+
+    const char* IOStrError(void*,int err)
+    {
+        switch( err ){
+        case ERR_SUCCESS :
+            return "Success";
+        case ERR_IHANDLE :
+            return "Invalid handle.";
+        case ERR_USER :
+            return user_err_msg;
+        default :
+            return "Unknown error.";
+        }
+    }
+
+    void IODestroy(void* handle)
+    {
+        delete static_cast<io_shm_t*>(handle);
+    }
+
+    void dummy_interface_test(void){
+#ifdef MHA_STATIC_PLUGINS
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOInit);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOPrepare);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOStart);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOStop);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IORelease);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOSetVar);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IOStrError);
+        MHA_CALLBACK_TEST_PREFIX(MHA_STATIC_MHAIOShm_,IODestroy);
+#else
+        MHA_CALLBACK_TEST(IOInit);
+        MHA_CALLBACK_TEST(IOPrepare);
+        MHA_CALLBACK_TEST(IOStart);
+        MHA_CALLBACK_TEST(IOStop);
+        MHA_CALLBACK_TEST(IORelease);
+        MHA_CALLBACK_TEST(IOSetVar);
+        MHA_CALLBACK_TEST(IOStrError);
+        MHA_CALLBACK_TEST(IODestroy);
+#endif
+    }
+}
+/*
+ * Local Variables:
+ * compile-command: "make -C .."
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
@@ -1,6 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2009 2011 2012 2013 2014 2015 2016 HörTech gGmbH
 // Copyright © 2017 2018 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -16,8 +17,13 @@
 
 #include "mha_tcp.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include "mha_io_ifc.h"
 #include "mha_toolbox.h"
 #include "mha_signal.hh"
@@ -68,6 +74,50 @@ class io_tcp_parser_t : public MHAParser::parser_t
     /** file handle to write debugging info to */
     FILE * debug_file;
 
+    /** Audio data exchange protocol: "stream" sends one block of
+     * big-endian samples per chunk, "framed" sends batches of blocks in
+     * host byte order preceded by a frame header. */
+    MHAParser::kw_t protocol;
+
+    /** Maximum number of blocks that the client may send in one frame. */
+    MHAParser::int_t max_batch;
+
+    /** Disable Nagle's algorithm on the sound data connection. */
+    MHAParser::bool_t nodelay;
+
+    /** Socket send and receive buffer sizes, 0 for system default. */
+    MHAParser::int_t sndbuf, rcvbuf;
+
+    /** Path of a Unix domain socket to listen on instead of TCP. */
+    MHAParser::string_t unix_socket;
+
+    /** Number of frames received on the current connection. */
+    MHAParser::int_mon_t frames;
+
+    /** Number of audio blocks processed on the current connection. */
+    MHAParser::int_mon_t blocks;
+
+    /** Smoothed interarrival jitter of frames in ms. */
+    MHAParser::float_mon_t jitter;
+
+    /** Largest deviation of a frame interarrival time in ms. */
+    MHAParser::float_mon_t jitter_max;
+
+    /** Mean time in ms from receiving a frame to sending the result. */
+    MHAParser::float_mon_t latency;
+
+    /** Largest time in ms from receiving a frame to sending the result. */
+    MHAParser::float_mon_t latency_max;
+
+    /** Arrival time of the previous frame in seconds. */
+    double last_arrival;
+
+    /** Unrounded running jitter estimate in ms. */
+    double jitter_estimate;
+
+    /** Sum of all frame latencies in ms. */
+    double latency_sum;
+
 public:
     /** Read parser variable local_address, this is the address of the
      * network interface that should listen for incoming connections. 
@@ -128,6 +178,44 @@ public:
      * @post @see get_connected returns true. */
     virtual void set_new_peer(unsigned short port,
                               const std::string & host);
+
+    /** @return true if the framed protocol is selected. */
+    virtual bool get_framed() const { return protocol.isval("framed"); }
+
+    /** @return Maximum number of blocks per frame. */
+    virtual unsigned get_max_batch() const { return max_batch.data; }
+
+    /** @return true if Nagle's algorithm should be disabled. */
+    virtual bool get_nodelay() const { return nodelay.data; }
+
+    /** @return Socket send buffer size in bytes, 0 for default. */
+    virtual int get_sndbuf() const { return sndbuf.data; }
+
+    /** @return Socket receive buffer size in bytes, 0 for default. */
+    virtual int get_rcvbuf() const { return rcvbuf.data; }
+
+    /** @return Path of the Unix domain socket, empty for TCP. */
+    virtual const std::string & get_unix_socket() const
+    { return unix_socket.data; }
+
+    /** Reset the frame statistics.  Called for each new connection. */
+    virtual void reset_statistics();
+
+    /** Update the frame count and the interarrival jitter.  The jitter
+     * is estimated like in RFC 3550 from the deviation of the time
+     * between two frames from the duration of the audio in the frame,
+     * and is therefore only meaningful for clients that send audio in
+     * real time.
+     * @param arrival Arrival time of the complete frame in seconds.
+     * @param duration Duration of the audio in the frame in seconds.
+     * @param num_blocks Number of audio blocks in the frame. */
+    virtual void frame_received(double arrival, double duration,
+                                unsigned num_blocks);
+
+    /** Update the latency statistics.
+     * @param delay Time in seconds between receiving the frame and
+     *              handing the processed audio to the socket. */
+    virtual void frame_processed(double delay);
 public:
     /** Constructor initializes parser variables. */
     io_tcp_parser_t();
@@ -219,10 +307,42 @@ void io_tcp_parser_t::set_new_peer(unsigned short port,
     peer_address.data = host;
 }
 
+void io_tcp_parser_t::reset_statistics()
+{
+    frames.data = 0;
+    blocks.data = 0;
+    jitter.data = jitter_max.data = 0;
+    latency.data = latency_max.data = 0;
+    last_arrival = jitter_estimate = latency_sum = 0;
+}
+
+void io_tcp_parser_t::frame_received(double arrival, double duration,
+                                     unsigned num_blocks)
+{
+    if (frames.data > 0) {
+        double deviation = std::fabs(arrival - last_arrival - duration) * 1e3;
+        jitter_estimate += (deviation - jitter_estimate) / 16;
+        jitter.data = jitter_estimate;
+        jitter_max.data = std::max(jitter_max.data, float(deviation));
+    }
+    last_arrival = arrival;
+    ++frames.data;
+    blocks.data += num_blocks;
+}
+
+void io_tcp_parser_t::frame_processed(double delay)
+{
+    latency_sum += delay * 1e3;
+    latency.data = latency_sum / std::max(frames.data, 1);
+    latency_max.data = std::max(latency_max.data, float(delay * 1e3));
+}
+
 io_tcp_parser_t::io_tcp_parser_t()
     : MHAParser::parser_t("TCP IO-lib exchanges sound samples as "      \
                           "interleaved binary float32 data in network-byte-" \
-                          "order (big endian) over a TCP connection"),
+                          "order (big endian) over a TCP connection, or " \
+                          "in batched frames in host byte order when " \
+                          "protocol is \"framed\""),
       local_address("Local address, determines interfaces",
                     "0.0.0.0"),
       local_port("TCP Server Port for sound data exchange",
@@ -232,7 +352,33 @@ io_tcp_parser_t::io_tcp_parser_t()
       peer_address("IP address of remote computer"),
       peer_port("Remote tcp port of connection"),
       debug_filename("debug messages of MHAIOTCP will be written to this file if non-empty",""),
-      debug_file(NULL)
+      debug_file(NULL),
+      protocol("Sound data protocol: stream = one block of big-endian"
+               " samples per chunk, framed = frames of up to max_batch"
+               " blocks in host byte order with frame header",
+               "stream", "[stream framed]"),
+      max_batch("Maximum number of blocks per frame in framed protocol",
+                "16", "[1,1024]"),
+      nodelay("Disable Nagle's algorithm (TCP_NODELAY) on the sound data"
+              " connection", "yes"),
+      sndbuf("Socket send buffer size in bytes (0 = system default)",
+             "0", "[0,]"),
+      rcvbuf("Socket receive buffer size in bytes (0 = system default)",
+             "0", "[0,]"),
+      unix_socket("If non-empty, listen on a Unix domain socket with this"
+                  " path instead of address and port (same-host clients"
+                  " only)", ""),
+      frames("Number of frames received on current connection"),
+      blocks("Number of audio blocks processed on current connection"),
+      jitter("Smoothed interarrival jitter of frames in ms"
+             " (for clients sending in real time)"),
+      jitter_max("Largest deviation of frame interarrival time from"
+                 " frame duration in ms"),
+      latency("Mean time in ms from receiving a frame until its"
+              " result is handed to the socket"),
+      latency_max("Largest time in ms from receiving a frame until its"
+                  " result is handed to the socket"),
+      last_arrival(0), jitter_estimate(0), latency_sum(0)
 {
     server_port_open.data = 0;
     insert_item("server_port_open", &server_port_open);
@@ -245,6 +391,19 @@ io_tcp_parser_t::io_tcp_parser_t()
     insert_item("address", &local_address);
     insert_item("port", &local_port);
     insert_member(debug_filename);
+    insert_member(protocol);
+    insert_member(max_batch);
+    insert_member(nodelay);
+    insert_member(sndbuf);
+    insert_member(rcvbuf);
+    insert_member(unix_socket);
+    reset_statistics();
+    insert_member(frames);
+    insert_member(blocks);
+    insert_member(jitter);
+    insert_member(jitter_max);
+    insert_member(latency);
+    insert_member(latency_max);
 }
 
 /* ========================================================================= */
@@ -280,6 +439,19 @@ private:
     static void check_sound_data_type();
 
 public:
+    /** Header preceding each frame in the framed protocol, in both
+     * directions.  All fields are in host byte order.  The response
+     * frame repeats sequence and timestamp of the request so that the
+     * client can measure the round trip time. */
+    struct frame_header_t {
+        /** Frame counter chosen by the client. */
+        uint32_t sequence;
+        /** Number of audio blocks following the header. */
+        uint32_t blocks;
+        /** Opaque time stamp chosen by the client. */
+        double timestamp;
+    };
+
     /** Initialize sound data handling.  Checks sound data type by calling
      * @see check_sound_data_type.
      * @param fragsize
@@ -306,8 +478,32 @@ public:
      *          signal processing. */
     virtual int chunkbytes_in() const;
 
-    /** Create the tcp sound header lines. */
-    virtual std::string header() const;
+    /** Create the tcp sound header lines.
+     * @param max_batch Maximum number of blocks per frame if the framed
+     *                  protocol is used, 0 for the stream protocol. */
+    virtual std::string header(unsigned max_batch = 0) const;
+
+    /** Duration of one block of audio in seconds. */
+    virtual double block_duration() const { return fragsize / samplerate; }
+
+    /** Decode and check a frame header of the framed protocol.
+     * @param data sizeof(frame_header_t) bytes received from the client.
+     * @param max_batch Maximum allowed number of blocks in the frame.
+     * @throw MHA_Error if the number of blocks is 0 or exceeds max_batch. */
+    virtual frame_header_t frame_header(const std::string & data,
+                                        unsigned max_batch) const;
+
+    /** Copy one block of audio in host byte order into the input sound
+     * storage.
+     * @param data Pointer to chunkbytes_in() bytes of sound data.
+     * @return Pointer to the sound data storage. */
+    virtual mha_wave_t * copy_in(const char * data);
+
+    /** Append one block of output audio in host byte order to a frame.
+     * @param frame The frame to append to.
+     * @param s_out The output sound of the processing callback.
+     * @throw MHA_Error if s_out does not have the announced dimensions. */
+    virtual void append_out(std::string & frame, const mha_wave_t * s_out);
 
     /** Copy data received from tcp into mha_wave_t structure.  
      * Doing network-to-host byte order swapping in the process.
@@ -379,7 +575,7 @@ int io_tcp_sound_t::chunkbytes_in() const
     return num_inchannels * fragsize * sizeof(mha_real_t);
 }
 
-std::string io_tcp_sound_t::header() const
+std::string io_tcp_sound_t::header(unsigned max_batch) const
 {
     // tcp sound metadata, followed by 1 blank line
     std::ostringstream o;
@@ -387,11 +583,54 @@ std::string io_tcp_sound_t::header() const
       << "nchannels_in=" << num_inchannels << std::endl
       << "nchannels_out=" << num_outchannels << std::endl
       << "fragsize=" << fragsize << std::endl
-      << "srate=" << samplerate << std::endl
-      << std::endl;
+      << "srate=" << samplerate << std::endl;
+    if (max_batch > 0) {
+        const uint16_t probe = 1;
+        o << "protocol=framed" << std::endl
+          << "max_batch=" << max_batch << std::endl
+          << "frame_header=" << sizeof(frame_header_t) << std::endl
+          << "byteorder="
+          << (*reinterpret_cast<const char*>(&probe) ? "little" : "big")
+          << std::endl;
+    }
+    o << std::endl;
     return o.str();
 }
 
+io_tcp_sound_t::frame_header_t
+io_tcp_sound_t::frame_header(const std::string & data,
+                             unsigned max_batch) const
+{
+    frame_header_t h;
+    if (data.size() != sizeof(h))
+        throw MHA_ErrorMsg2("Incomplete frame header (%zu bytes)",
+                            data.size());
+    memcpy(&h, data.data(), sizeof(h));
+    if (h.blocks == 0 || h.blocks > max_batch)
+        throw MHA_ErrorMsg3("Frame %u: invalid number of blocks %u",
+                            h.sequence, h.blocks);
+    return h;
+}
+
+mha_wave_t * io_tcp_sound_t::copy_in(const char * data)
+{
+    memcpy(s_in->buf, data, chunkbytes_in());
+    return s_in;
+}
+
+void io_tcp_sound_t::append_out(std::string & frame, const mha_wave_t * s_out)
+{
+    if (s_out->num_frames != unsigned(fragsize) ||
+        s_out->num_channels != unsigned(num_outchannels))
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Output block has %u frames and %u channels, "
+                        "expected %d frames and %d channels",
+                        s_out->num_frames, s_out->num_channels,
+                        fragsize, num_outchannels);
+    frame.append(reinterpret_cast<const char *>(s_out->buf),
+                 size(s_out) * sizeof(mha_real_t));
+}
+
 mha_wave_t * io_tcp_sound_t::ntoh(const std::string & data)
 {
     assert(chunkbytes_in() >= 0 &&
@@ -567,6 +806,13 @@ private:
     MHA_TCP::Server * server;
     MHA_TCP::Thread * thread;
     MHA_TCP::Async_Notify notify_start, notify_stop, notify_release;
+
+    /** Protocol settings copied from the parser during prepare, so that
+     * the IO thread does not read parser variables that may be changed
+     * concurrently. 0 selects the stream protocol. */
+    unsigned max_batch;
+    bool nodelay;
+    int sndbuf, rcvbuf;
 };
 
 static int copy_error(MHA_Error& e) {
@@ -588,9 +834,17 @@ io_tcp_t::io_tcp_t(int _fragsize, float _samplerate,
     : sound(_fragsize, _samplerate),
       fwcb(proc_event, proc_handle, start_event, start_handle,
            stop_event, stop_handle),
-      server(0), thread(0)
+      server(0), thread(0),
+      max_batch(0), nodelay(true), sndbuf(0), rcvbuf(0)
 {}
 
+/** Monotonic time in seconds for the frame statistics. */
+static double monotonic_time()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /** prepare opens the tcp server socket and starts the io thread that
  *  listens for audio data on the tcp socket after doing some sanity
  *  checks */
@@ -609,10 +863,26 @@ void io_tcp_t::prepare(int num_inchannels, int num_outchannels)
         throw MHA_ErrorMsg("Prepare called although "\
                            "IO thread is already allocated");
     sound.prepare(num_inchannels, num_outchannels);
+    max_batch = parser.get_framed() ? parser.get_max_batch() : 0;
+    nodelay = parser.get_nodelay();
+    sndbuf = parser.get_sndbuf();
+    rcvbuf = parser.get_rcvbuf();
     parser.debug("opening server");
-    server = new MHA_TCP::Server(parser.get_local_port(), parser.get_local_address());
+    try {
+        if (parser.get_unix_socket().size()) {
+            server = new MHA_TCP::Server(
+                MHA_TCP::Local_Address(parser.get_unix_socket()));
+        }
+        else
+            server = new MHA_TCP::Server(parser.get_local_port(),
+                                         parser.get_local_address());
+    } catch (MHA_Error &) {
+        sound.release();
+        throw;
+    }
     parser.set_server_port_open(true);
-    if (parser.get_local_port() != server->get_port())
+    if (server->get_local_path().empty() &&
+        parser.get_local_port() != server->get_port())
         parser.set_local_port(server->get_port());
     parser.debug("starting thread");
     thread = new MHA_TCP::Thread(thread_startup_function, this);
@@ -659,79 +929,130 @@ void io_tcp_t::accept_loop() {
 void io_tcp_t::connection_loop(MHA_TCP::Connection * c) {
     parser.debug("connection_loop()");
     parser.set_new_peer(c->get_peer_port(), c->get_peer_address());
-    fwcb.start();
-    parser.debug("connection_loop writes header");
-    c->try_write(sound.header());
-    for(;;) {
-        Event_Watcher w;
-        w.observe(&notify_start);
-        w.observe(&notify_stop);
-        w.observe(&notify_release);
-        w.observe(c->get_read_event());
-        parser.debug("connection_loop checks if writes are necessary before waiting");
-        if (c->needs_write()) {
-            parser.debug("connection_loop: yes, writes are necessary, observe write event");
-
-            w.observe(c->get_write_event());
-        }
-        else {
-            parser.debug("connection_loop: currently no further writes necessary");
-        }
-        parser.debug("connection_loop waits with buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
-        std::set<Wakeup_Event *> s = w.wait();
-        if (s.find(&notify_release) != s.end()
-            || s.find(&notify_stop) != s.end()) {
-            // close connection and return to accept loop.
-            // don't reset release event,this will be done in accept loop
-            parser.debug("connection_loop received stop or release");
-            notify_stop.reset();
-            goto terminate_connection_cleanly;
-        }
-        if (s.find(&notify_start) != s.end()) {
-            parser.debug("connection_loop received start");
-            notify_start.reset();
-            fwcb.start();
-        }
-        if (s.find(c->get_read_event()) != s.end()) {
-            parser.debug("connection_loop got read event");
-            while (c->eof() || c->can_read_bytes(sound.chunkbytes_in())) {
-                /* Also enter this loop on EOF, because:
-                 * - I need an EOF check somewhere and act on it, obviously,
-                 * - Whenever I check for EOF, the Connection class might
-                 *   already read the next chunk of data.
-                 * - If checking for EOF read in the next chunk, it needs to be
-                 *   processed. I cannot fall back to another wait(), as that
-                 *   might not wake up again. This is also the reason why eof() 
-                                 *   is checked first in while argument.
-                 * - Therefore, the correct location to check for EOF and act
-                 *   on it is within this loop, which processes chunks of data.
-                 * - This loop therefore also needs to be entered in a clear
-                 *   EOF case when there is no chunk of audio data pending.
-                 */
-                if (!(c->eof())) { // means, we have another chunk
-                    parser.debug("connection_loop can read another chunk");
-                    mha_wave_t * s_out = 0;
-                    parser.debug("connection_loop processes chunk");
-                    int status = fwcb.process(sound.ntoh(c->read_bytes(sound.chunkbytes_in())), s_out);
-                    if (status != 0) {
-                        fwcb.set_errnos(status, 0);
-                        goto terminate_connection;
+    parser.reset_statistics();
+    const bool framed = max_batch > 0;
+    const unsigned header_bytes = sizeof(io_tcp_sound_t::frame_header_t);
+    // In the stream protocol, every chunk is one block without header.
+    io_tcp_sound_t::frame_header_t header = {0, 1, 0.0};
+    bool header_pending = framed;
+    unsigned needed = framed ? header_bytes : sound.chunkbytes_in();
+    std::string output;
+    try {
+        c->set_nodelay(nodelay);
+        c->set_buffer_sizes(sndbuf, rcvbuf);
+        fwcb.start();
+        parser.debug("connection_loop writes header");
+        c->try_write(sound.header(max_batch));
+        for(;;) {
+            Event_Watcher w;
+            w.observe(&notify_start);
+            w.observe(&notify_stop);
+            w.observe(&notify_release);
+            w.observe(c->get_read_event());
+            parser.debug("connection_loop checks if writes are necessary before waiting");
+            if (c->needs_write()) {
+                parser.debug("connection_loop: yes, writes are necessary, observe write event");
+
+                w.observe(c->get_write_event());
+            }
+            else {
+                parser.debug("connection_loop: currently no further writes necessary");
+            }
+            parser.debug("connection_loop waits with buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
+            std::set<Wakeup_Event *> s = w.wait();
+            if (s.find(&notify_release) != s.end()
+                || s.find(&notify_stop) != s.end()) {
+                // close connection and return to accept loop.
+                // don't reset release event,this will be done in accept loop
+                parser.debug("connection_loop received stop or release");
+                notify_stop.reset();
+                goto terminate_connection_cleanly;
+            }
+            if (s.find(&notify_start) != s.end()) {
+                parser.debug("connection_loop received start");
+                notify_start.reset();
+                fwcb.start();
+            }
+            if (s.find(c->get_read_event()) != s.end()) {
+                parser.debug("connection_loop got read event");
+                while (c->eof() || c->can_read_bytes(needed)) {
+                    /* Also enter this loop on EOF, because:
+                     * - I need an EOF check somewhere and act on it, obviously,
+                     * - Whenever I check for EOF, the Connection class might
+                     *   already read the next chunk of data.
+                     * - If checking for EOF read in the next chunk, it needs to be
+                     *   processed. I cannot fall back to another wait(), as that
+                     *   might not wake up again. This is also the reason why eof() 
+                     *   is checked first in while argument.
+                     * - Therefore, the correct location to check for EOF and act
+                     *   on it is within this loop, which processes chunks of data.
+                     * - This loop therefore also needs to be entered in a clear
+                     *   EOF case when there is no chunk of audio data pending.
+                     */
+                    if (!(c->eof())) { // means, we have another chunk
+                        std::string data = c->read_bytes(needed);
+                        if (header_pending) {
+                            // framed protocol: the frame header tells how
+                            // many blocks to read next
+                            header = sound.frame_header(data, max_batch);
+                            header_pending = false;
+                            needed = header.blocks * sound.chunkbytes_in();
+                            continue;
+                        }
+                        parser.debug("connection_loop processes chunk");
+                        const double arrival = monotonic_time();
+                        parser.frame_received(arrival,
+                                              header.blocks *
+                                              sound.block_duration(),
+                                              header.blocks);
+                        output.clear();
+                        if (framed)
+                            output.append(reinterpret_cast<const char *>
+                                          (&header), header_bytes);
+                        for (unsigned block = 0; block < header.blocks;
+                             ++block) {
+                            mha_wave_t * s_in = framed
+                                ? sound.copy_in(data.data() + block *
+                                                sound.chunkbytes_in())
+                                : sound.ntoh(data);
+                            mha_wave_t * s_out = 0;
+                            int status = fwcb.process(s_in, s_out);
+                            if (status != 0) {
+                                fwcb.set_errnos(status, 0);
+                                goto terminate_connection;
+                            }
+                            if (framed)
+                                sound.append_out(output, s_out);
+                            else
+                                output = sound.hton(s_out);
+                        }
+                        parser.debug("connection_loop tries to write chunk result");
+                        c->try_write(output);
+                        parser.frame_processed(monotonic_time() - arrival);
+                        if (framed) {
+                            header_pending = true;
+                            needed = header_bytes;
+                        }
                     }
-                    parser.debug("connection_loop tries to write chunk result");
-                    c->try_write(sound.hton(s_out));
-                }
-                parser.debug("connection_loop checks for eof");
-                if (c->eof()) {
-                    parser.debug("connection_loop got eof");
-                    goto terminate_connection_cleanly;
+                    parser.debug("connection_loop checks for eof");
+                    if (c->eof()) {
+                        parser.debug("connection_loop got eof");
+                        goto terminate_connection_cleanly;
+                    }
+                    parser.debug("After EOF check, buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
                 }
-                                parser.debug("After EOF check, buffered_incoming_bytes="+MHAParser::StrCnv::val2str((int)c->buffered_incoming_bytes()));
+            }
+            if (s.find(c->get_write_event()) != s.end()) {
+                parser.debug("connection_loop got write event and tries to write");
+                c->try_write();
             }
         }
-        if (s.find(c->get_write_event()) != s.end()) {
-            parser.debug("connection_loop got write event and tries to write");
-            c->try_write();
-        }
+    } catch (MHA_Error & e) {
+        // protocol violation or socket error: report it through the
+        // stop callback instead of terminating the IO thread
+        parser.debug(std::string("connection_loop error: ") + Getmsg(e));
+        fwcb.set_errnos(0, copy_error(e));
+        goto terminate_connection;
     }
  terminate_connection_cleanly:
     parser.debug("connection_loop resets errnos to clean");
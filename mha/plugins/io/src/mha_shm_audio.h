@@ -0,0 +1,156 @@
+/* This file is part of the HörTech Open Master Hearing Aid (openMHA)
+ * Copyright © 2026 Hörzentrum Oldenburg gGmbH
+ *
+ * openMHA is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * openMHA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License, version 3 for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License,
+ * version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file mha_shm_audio.h
+ * Layout of the shared memory segment used by the sound io library
+ * MHAIOShm and its client library to exchange audio blocks between MHA
+ * and a client process on the same host.  This header is shared by the
+ * C client library and the C++ server and therefore plain C.
+ *
+ * The segment starts with struct mha_shm_audio_header, followed by the
+ * input ring (client to MHA) and the output ring (MHA to client).  Each
+ * ring consists of num_slots slots.  A slot starts with struct
+ * mha_shm_audio_slot, followed by one block of fragsize interleaved
+ * float32 frames in host byte order.
+ *
+ * Both rings are single-producer single-consumer queues indexed by free
+ * running 32 bit counters.  The producer writes a slot and then
+ * increments the write counter with release semantics, the consumer
+ * reads the slot after loading the write counter with acquire semantics
+ * and then increments the read counter.  Waiting sides sleep on the
+ * counters with futexes on Linux and poll elsewhere.
+ */
+
+#ifndef MHA_SHM_AUDIO_H
+#define MHA_SHM_AUDIO_H
+
+#include <stdint.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define MHA_SHM_AUDIO_MAGIC 0x5341484dU /* "MHAS" in little endian */
+#define MHA_SHM_AUDIO_VERSION 1U
+
+/** Segment is being created or has been closed by MHA */
+#define MHA_SHM_STATE_CLOSED 0U
+/** MHA accepts audio blocks */
+#define MHA_SHM_STATE_OPEN 1U
+
+/** Alignment of slots and of the ring counters */
+#define MHA_SHM_AUDIO_ALIGN 64U
+
+struct mha_shm_audio_header {
+    uint32_t magic;         /**< MHA_SHM_AUDIO_MAGIC once initialized */
+    uint32_t version;       /**< MHA_SHM_AUDIO_VERSION */
+    uint32_t fragsize;      /**< frames per block */
+    uint32_t nchannels_in;  /**< channels of input blocks */
+    uint32_t nchannels_out; /**< channels of output blocks */
+    uint32_t num_slots;     /**< slots per ring */
+    float srate;            /**< sampling rate in Hz */
+    uint32_t server_pid;    /**< process id of MHA */
+    uint32_t client_pid;    /**< process id of attached client, or 0 */
+    uint32_t state;         /**< MHA_SHM_STATE_* */
+    uint64_t in_slot_bytes; /**< size of one input slot incl. slot header */
+    uint64_t out_slot_bytes;/**< size of one output slot incl. header */
+    uint64_t in_offset;     /**< offset of input ring from segment start */
+    uint64_t out_offset;    /**< offset of output ring from segment start */
+    uint32_t reserved[14];
+    /* ring counters, each on its own cache line */
+    uint32_t in_write;      /**< input blocks written by the client */
+    uint32_t pad_in_write[15];
+    uint32_t in_read;       /**< input blocks consumed by MHA */
+    uint32_t pad_in_read[15];
+    uint32_t out_write;     /**< output blocks written by MHA */
+    uint32_t pad_out_write[15];
+    uint32_t out_read;      /**< output blocks consumed by the client */
+    uint32_t pad_out_read[15];
+};
+
+struct mha_shm_audio_slot {
+    /** Input slots: value of in_write before the block was published.
+     * Output slots: sequence of the input block this block answers. */
+    uint32_t sequence;
+    uint32_t reserved[15];
+};
+
+/** Size in bytes of one slot holding a block of the given dimensions. */
+static inline uint64_t mha_shm_audio_slot_bytes(uint32_t fragsize,
+                                                uint32_t nchannels)
+{
+    uint64_t bytes = sizeof(struct mha_shm_audio_slot)
+        + (uint64_t)fragsize * nchannels * sizeof(float);
+    return (bytes + MHA_SHM_AUDIO_ALIGN - 1) / MHA_SHM_AUDIO_ALIGN
+        * MHA_SHM_AUDIO_ALIGN;
+}
+
+static inline uint32_t mha_shm_audio_load(const uint32_t * counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+}
+
+static inline void mha_shm_audio_store(uint32_t * counter, uint32_t value)
+{
+    __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+}
+
+/** Sleep until *counter may differ from expected, or until the timeout.
+ * Spurious wakeups are possible, callers check the counter again.
+ * @param timeout_ms Timeout in milliseconds, negative waits forever. */
+static inline void mha_shm_audio_wait(uint32_t * counter, uint32_t expected,
+                                      int timeout_ms)
+{
+#ifdef __linux__
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    /* shared (not private) futex: the peer is another process */
+    syscall(SYS_futex, counter, FUTEX_WAIT, expected,
+            timeout_ms < 0 ? (struct timespec *)0 : &ts, (uint32_t *)0, 0);
+#else
+    struct timespec ts = {0, 100000L};
+    int waited_us = 0;
+    while (mha_shm_audio_load(counter) == expected &&
+           (timeout_ms < 0 || waited_us < timeout_ms * 1000)) {
+        nanosleep(&ts, (struct timespec *)0);
+        waited_us += 100;
+    }
+#endif
+}
+
+/** Wake all processes sleeping on counter. */
+static inline void mha_shm_audio_wake(uint32_t * counter)
+{
+#ifdef __linux__
+    syscall(SYS_futex, counter, FUTEX_WAKE, 0x7fffffff,
+            (struct timespec *)0, (uint32_t *)0, 0);
+#else
+    (void)counter;
+#endif
+}
+
+#endif
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
@@ -0,0 +1,341 @@
+/* This file is part of the HörTech Open Master Hearing Aid (openMHA)
+ * Copyright © 2026 Hörzentrum Oldenburg gGmbH
+ *
+ * openMHA is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * openMHA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License, version 3 for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License,
+ * version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mha_shm_client.h"
+#include "mha_shm_audio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct mha_shm_client {
+    struct mha_shm_audio_header * header;
+    size_t size;
+    unsigned char * in_ring;
+    unsigned char * out_ring;
+    /** in_write at attach time: older output blocks are skipped */
+    uint32_t first_sequence;
+    /** process id stored in header->client_pid */
+    uint32_t pid;
+    /** an input slot has been handed out and not yet submitted */
+    int input_pending;
+    /** an output slot has been handed out and not yet released */
+    int output_pending;
+};
+
+static void set_error(int * error, int value)
+{
+    if (error)
+        *error = value;
+}
+
+static struct timespec deadline_after(int timeout_ms)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    if (timeout_ms > 0) {
+        t.tv_sec += timeout_ms / 1000;
+        t.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (t.tv_nsec >= 1000000000L) {
+            t.tv_sec += 1;
+            t.tv_nsec -= 1000000000L;
+        }
+    }
+    return t;
+}
+
+/* Milliseconds left until deadline (at least 1 if not yet reached),
+ * 0 if the deadline has passed, -1 for infinite timeouts. */
+static int remaining_ms(const struct timespec * deadline, int timeout_ms)
+{
+    struct timespec now;
+    long long ms;
+    if (timeout_ms < 0)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (long long)(deadline->tv_sec - now.tv_sec) * 1000
+        + (deadline->tv_nsec - now.tv_nsec) / 1000000L;
+    if (deadline->tv_sec < now.tv_sec ||
+        (deadline->tv_sec == now.tv_sec && deadline->tv_nsec <= now.tv_nsec))
+        return 0;
+    return ms < 1 ? 1 : (int)ms;
+}
+
+/* Waits are split into intervals of at most this length to notice when
+ * MHA closes the segment between the state check and the wait. */
+#define STATE_POLL_MS 100
+
+static int wait_ms(int remaining)
+{
+    return (remaining < 0 || remaining > STATE_POLL_MS)
+        ? STATE_POLL_MS : remaining;
+}
+
+static int is_open(const mha_shm_client_t * client)
+{
+    return mha_shm_audio_load(&client->header->state) == MHA_SHM_STATE_OPEN;
+}
+
+static int attach(struct mha_shm_audio_header * header, uint32_t pid)
+{
+    uint32_t owner = 0;
+    if (__atomic_compare_exchange_n(&header->client_pid, &owner, pid, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return MHA_SHM_OK;
+    /* take over from a client that terminated without detaching */
+    if (owner != pid && kill((pid_t)owner, 0) == -1 && errno == ESRCH &&
+        __atomic_compare_exchange_n(&header->client_pid, &owner, pid, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return MHA_SHM_OK;
+    return MHA_SHM_EBUSY;
+}
+
+mha_shm_client_t * mha_shm_client_open(const char * name, int * error)
+{
+    char path[256];
+    struct stat st;
+    struct mha_shm_audio_header * header;
+    mha_shm_client_t * client;
+    void * map;
+    int fd, err;
+
+    if (name == NULL || strlen(name) + 2 > sizeof(path)) {
+        set_error(error, MHA_SHM_EINVAL);
+        return NULL;
+    }
+    path[0] = '/';
+    strcpy(path + (name[0] != '/'), name);
+    fd = shm_open(path, O_RDWR, 0);
+    if (fd < 0) {
+        set_error(error, errno == ENOENT ? MHA_SHM_ENOENT : MHA_SHM_ESYSTEM);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(struct mha_shm_audio_header)) {
+        close(fd);
+        set_error(error, MHA_SHM_ENOENT);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_error(error, MHA_SHM_ESYSTEM);
+        return NULL;
+    }
+    header = (struct mha_shm_audio_header *)map;
+    err = MHA_SHM_OK;
+    if (mha_shm_audio_load(&header->magic) != MHA_SHM_AUDIO_MAGIC ||
+        header->version != MHA_SHM_AUDIO_VERSION || header->num_slots == 0 ||
+        header->in_offset + header->num_slots * header->in_slot_bytes
+        > (uint64_t)st.st_size ||
+        header->out_offset + header->num_slots * header->out_slot_bytes
+        > (uint64_t)st.st_size)
+        err = MHA_SHM_ENOENT;
+    else if (mha_shm_audio_load(&header->state) != MHA_SHM_STATE_OPEN)
+        err = MHA_SHM_ECLOSED;
+    else
+        err = attach(header, (uint32_t)getpid());
+    client = err ? NULL : (mha_shm_client_t *)calloc(1, sizeof(*client));
+    if (client == NULL) {
+        if (err == MHA_SHM_OK) {
+            __atomic_store_n(&header->client_pid, 0, __ATOMIC_RELEASE);
+            err = MHA_SHM_ESYSTEM;
+        }
+        munmap(map, (size_t)st.st_size);
+        set_error(error, err);
+        return NULL;
+    }
+    client->header = header;
+    client->size = (size_t)st.st_size;
+    client->in_ring = (unsigned char *)map + header->in_offset;
+    client->out_ring = (unsigned char *)map + header->out_offset;
+    client->pid = (uint32_t)getpid();
+    client->first_sequence = mha_shm_audio_load(&header->in_write);
+    set_error(error, MHA_SHM_OK);
+    return client;
+}
+
+void mha_shm_client_close(mha_shm_client_t * client)
+{
+    uint32_t pid;
+    if (client == NULL)
+        return;
+    pid = client->pid;
+    __atomic_compare_exchange_n(&client->header->client_pid, &pid, 0, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    munmap(client->header, client->size);
+    free(client);
+}
+
+unsigned mha_shm_client_fragsize(const mha_shm_client_t * client)
+{ return client->header->fragsize; }
+unsigned mha_shm_client_nchannels_in(const mha_shm_client_t * client)
+{ return client->header->nchannels_in; }
+unsigned mha_shm_client_nchannels_out(const mha_shm_client_t * client)
+{ return client->header->nchannels_out; }
+float mha_shm_client_srate(const mha_shm_client_t * client)
+{ return client->header->srate; }
+
+float * mha_shm_client_input_block(mha_shm_client_t * client,
+                                   int timeout_ms, int * error)
+{
+    struct mha_shm_audio_header * h = client->header;
+    uint32_t write = h->in_write;
+    struct timespec deadline = deadline_after(timeout_ms);
+    struct mha_shm_audio_slot * slot;
+    for (;;) {
+        uint32_t read = mha_shm_audio_load(&h->in_read);
+        int ms;
+        if (write - read < h->num_slots)
+            break;
+        if (!is_open(client)) {
+            set_error(error, MHA_SHM_ECLOSED);
+            return NULL;
+        }
+        ms = remaining_ms(&deadline, timeout_ms);
+        if (ms == 0) {
+            set_error(error, MHA_SHM_ETIMEOUT);
+            return NULL;
+        }
+        mha_shm_audio_wait(&h->in_read, read, wait_ms(ms));
+    }
+    slot = (struct mha_shm_audio_slot *)
+        (client->in_ring + (write % h->num_slots) * h->in_slot_bytes);
+    slot->sequence = write;
+    client->input_pending = 1;
+    set_error(error, MHA_SHM_OK);
+    return (float *)(slot + 1);
+}
+
+int mha_shm_client_submit(mha_shm_client_t * client)
+{
+    struct mha_shm_audio_header * h = client->header;
+    if (!client->input_pending)
+        return MHA_SHM_EINVAL;
+    client->input_pending = 0;
+    mha_shm_audio_store(&h->in_write, h->in_write + 1);
+    mha_shm_audio_wake(&h->in_write);
+    return is_open(client) ? MHA_SHM_OK : MHA_SHM_ECLOSED;
+}
+
+const float * mha_shm_client_output_block(mha_shm_client_t * client,
+                                          int timeout_ms, int * error)
+{
+    struct mha_shm_audio_header * h = client->header;
+    struct timespec deadline = deadline_after(timeout_ms);
+    for (;;) {
+        uint32_t read = h->out_read;
+        struct mha_shm_audio_slot * slot;
+        uint32_t write = mha_shm_audio_load(&h->out_write);
+        if (write == read) {
+            int ms;
+            if (!is_open(client)) {
+                set_error(error, MHA_SHM_ECLOSED);
+                return NULL;
+            }
+            ms = remaining_ms(&deadline, timeout_ms);
+            if (ms == 0) {
+                set_error(error, MHA_SHM_ETIMEOUT);
+                return NULL;
+            }
+            mha_shm_audio_wait(&h->out_write, write, wait_ms(ms));
+            continue;
+        }
+        slot = (struct mha_shm_audio_slot *)
+            (client->out_ring + (read % h->num_slots) * h->out_slot_bytes);
+        if ((int32_t)(slot->sequence - client->first_sequence) < 0) {
+            /* answer to an input block of a previous client */
+            mha_shm_audio_store(&h->out_read, read + 1);
+            mha_shm_audio_wake(&h->out_read);
+            continue;
+        }
+        client->output_pending = 1;
+        set_error(error, MHA_SHM_OK);
+        return (const float *)(slot + 1);
+    }
+}
+
+int mha_shm_client_release_output(mha_shm_client_t * client)
+{
+    struct mha_shm_audio_header * h = client->header;
+    if (!client->output_pending)
+        return MHA_SHM_EINVAL;
+    client->output_pending = 0;
+    mha_shm_audio_store(&h->out_read, h->out_read + 1);
+    mha_shm_audio_wake(&h->out_read);
+    return MHA_SHM_OK;
+}
+
+int mha_shm_client_write(mha_shm_client_t * client, const float * samples,
+                         int timeout_ms)
+{
+    int error;
+    float * block = mha_shm_client_input_block(client, timeout_ms, &error);
+    if (block == NULL)
+        return error;
+    memcpy(block, samples, sizeof(float) * client->header->fragsize
+           * client->header->nchannels_in);
+    return mha_shm_client_submit(client);
+}
+
+int mha_shm_client_read(mha_shm_client_t * client, float * samples,
+                        int timeout_ms)
+{
+    int error;
+    const float * block =
+        mha_shm_client_output_block(client, timeout_ms, &error);
+    if (block == NULL)
+        return error;
+    memcpy(samples, block, sizeof(float) * client->header->fragsize
+           * client->header->nchannels_out);
+    return mha_shm_client_release_output(client);
+}
+
+const char * mha_shm_client_strerror(int error)
+{
+    switch (error) {
+    case MHA_SHM_OK:
+        return "Success";
+    case MHA_SHM_ETIMEOUT:
+        return "Timeout";
+    case MHA_SHM_ENOENT:
+        return "No MHAIOShm segment with this name";
+    case MHA_SHM_EBUSY:
+        return "Another client is attached";
+    case MHA_SHM_ECLOSED:
+        return "MHA has released the segment";
+    case MHA_SHM_EINVAL:
+        return "Invalid argument or call sequence";
+    case MHA_SHM_ESYSTEM:
+        return "System call failed";
+    default:
+        return "Unknown error";
+    }
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
@@ -0,0 +1,128 @@
+/* This file is part of the HörTech Open Master Hearing Aid (openMHA)
+ * Copyright © 2026 Hörzentrum Oldenburg gGmbH
+ *
+ * openMHA is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * openMHA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License, version 3 for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License,
+ * version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file mha_shm_client.h
+ * C client library for the shared memory sound io library MHAIOShm.
+ *
+ * A client attaches to the shared memory segment that a prepared MHA
+ * with iolib=MHAIOShm has created, writes input blocks and reads the
+ * processed output blocks.  Only one client can be attached at a time.
+ * Blocks are fragsize interleaved float32 frames with nchannels_in or
+ * nchannels_out channels, as announced by the segment.
+ *
+ * Zero-copy usage:
+ *   float * in = mha_shm_client_input_block(c, timeout);  fill in ...
+ *   mha_shm_client_submit(c);
+ *   const float * out = mha_shm_client_output_block(c, timeout);  use ...
+ *   mha_shm_client_release_output(c);
+ *
+ * mha_shm_client_write and mha_shm_client_read do the same with one copy.
+ * MHA stops consuming input when the client does not read the output,
+ * so clients have to read one output block for each input block.
+ */
+
+#ifndef MHA_SHM_CLIENT_H
+#define MHA_SHM_CLIENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Success */
+#define MHA_SHM_OK 0
+/** The timeout expired before a slot became available */
+#define MHA_SHM_ETIMEOUT -1
+/** The segment does not exist or is not an MHAIOShm segment */
+#define MHA_SHM_ENOENT -2
+/** Another client is attached */
+#define MHA_SHM_EBUSY -3
+/** MHA has released the segment */
+#define MHA_SHM_ECLOSED -4
+/** Invalid argument or call sequence */
+#define MHA_SHM_EINVAL -5
+/** A system call failed */
+#define MHA_SHM_ESYSTEM -6
+
+typedef struct mha_shm_client mha_shm_client_t;
+
+/** Attach to the segment of a prepared MHA.
+ * @param name  Segment name, the value of MHAIOShm variable "name".
+ * @param error If not NULL, receives an MHA_SHM_* error code.
+ * @return The client handle, or NULL on error. */
+mha_shm_client_t * mha_shm_client_open(const char * name, int * error);
+
+/** Detach from the segment and free the handle. */
+void mha_shm_client_close(mha_shm_client_t * client);
+
+unsigned mha_shm_client_fragsize(const mha_shm_client_t * client);
+unsigned mha_shm_client_nchannels_in(const mha_shm_client_t * client);
+unsigned mha_shm_client_nchannels_out(const mha_shm_client_t * client);
+float mha_shm_client_srate(const mha_shm_client_t * client);
+
+/** Wait for a free input slot and return a pointer to its samples.
+ * @param timeout_ms Timeout in milliseconds, negative waits forever.
+ * @param error If not NULL, receives an MHA_SHM_* error code.
+ * @return fragsize * nchannels_in interleaved samples to fill in, or
+ *         NULL on error.  Calling it again before submit returns the
+ *         same slot. */
+float * mha_shm_client_input_block(mha_shm_client_t * client,
+                                   int timeout_ms, int * error);
+
+/** Hand the input block returned by mha_shm_client_input_block to MHA.
+ * @return MHA_SHM_OK or an error code. */
+int mha_shm_client_submit(mha_shm_client_t * client);
+
+/** Wait for the next output block and return a pointer to its samples.
+ * Output blocks that answer input blocks of a previous client are
+ * skipped.
+ * @param timeout_ms Timeout in milliseconds, negative waits forever.
+ * @param error If not NULL, receives an MHA_SHM_* error code.
+ * @return fragsize * nchannels_out interleaved samples, valid until
+ *         mha_shm_client_release_output, or NULL on error. */
+const float * mha_shm_client_output_block(mha_shm_client_t * client,
+                                          int timeout_ms, int * error);
+
+/** Give the output slot returned by mha_shm_client_output_block back
+ * to MHA.
+ * @return MHA_SHM_OK or an error code. */
+int mha_shm_client_release_output(mha_shm_client_t * client);
+
+/** Copy one block of input samples to MHA.
+ * @return MHA_SHM_OK or an error code. */
+int mha_shm_client_write(mha_shm_client_t * client, const float * samples,
+                         int timeout_ms);
+
+/** Copy the next output block from MHA.
+ * @return MHA_SHM_OK or an error code. */
+int mha_shm_client_read(mha_shm_client_t * client, float * samples,
+                        int timeout_ms);
+
+/** Text for an MHA_SHM_* error code. */
+const char * mha_shm_client_strerror(int error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
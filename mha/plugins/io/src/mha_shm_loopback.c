@@ -0,0 +1,129 @@
+/* This file is part of the HörTech Open Master Hearing Aid (openMHA)
+ * Copyright © 2026 Hörzentrum Oldenburg gGmbH
+ *
+ * openMHA is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * openMHA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License, version 3 for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License,
+ * version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Test harness for MHAIOShm: sends blocks of a sine signal through a
+ * prepared MHA with iolib=MHAIOShm and reports throughput and round
+ * trip times.
+ *
+ * Usage: mha_shm_loopback [name [blocks [depth]]]
+ *   name   segment name, default mha_audio
+ *   blocks number of blocks to send, default 10000
+ *   depth  blocks in flight before the first read, default 1.  With
+ *          depth 1 every block is a round trip; larger values measure
+ *          throughput. */
+
+#include "mha_shm_client.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec * 1e-6;
+}
+
+static int compare_double(const void * a, const void * b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char ** argv)
+{
+    const char * name = argc > 1 ? argv[1] : "mha_audio";
+    long blocks = argc > 2 ? atol(argv[2]) : 10000;
+    long depth = argc > 3 ? atol(argv[3]) : 1;
+    int err = MHA_SHM_OK;
+    mha_shm_client_t * c;
+    unsigned frames, nch_in, nch_out, k;
+    float * in, * out;
+    float srate;
+    double * sent, * rtt, start, elapsed;
+    long written = 0, received = 0;
+
+    if (blocks < 1 || depth < 1) {
+        fprintf(stderr, "usage: %s [name [blocks [depth]]]\n", argv[0]);
+        return 1;
+    }
+    c = mha_shm_client_open(name, &err);
+    if (c == NULL) {
+        fprintf(stderr, "%s: %s\n", name, mha_shm_client_strerror(err));
+        return 1;
+    }
+    frames = mha_shm_client_fragsize(c);
+    nch_in = mha_shm_client_nchannels_in(c);
+    nch_out = mha_shm_client_nchannels_out(c);
+    srate = mha_shm_client_srate(c);
+    in = malloc(sizeof(float) * frames * nch_in);
+    out = malloc(sizeof(float) * frames * (nch_out ? nch_out : 1));
+    sent = malloc(sizeof(double) * blocks);
+    rtt = malloc(sizeof(double) * blocks);
+    if (!in || !out || !sent || !rtt) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (k = 0; k < frames * nch_in; ++k)
+        in[k] = 0.1f * sinf(2.0f * 3.14159265f * 1000.0f
+                            * (float)(k / nch_in) / srate);
+    printf("%s: fragsize %u, %u in, %u out channels, %g Hz\n", name,
+           frames, nch_in, nch_out, srate);
+
+    start = now_ms();
+    while (received < blocks && err == MHA_SHM_OK) {
+        if (written < blocks && written - received < depth) {
+            sent[written] = now_ms();
+            err = mha_shm_client_write(c, in, 1000);
+            written += err == MHA_SHM_OK;
+        } else {
+            err = mha_shm_client_read(c, out, 1000);
+            if (err == MHA_SHM_OK) {
+                rtt[received] = now_ms() - sent[received];
+                ++received;
+            }
+        }
+    }
+    elapsed = now_ms() - start;
+    mha_shm_client_close(c);
+    if (err != MHA_SHM_OK)
+        fprintf(stderr, "after %ld blocks: %s\n", received,
+                mha_shm_client_strerror(err));
+    if (received > 0) {
+        qsort(rtt, (size_t)received, sizeof(double), compare_double);
+        printf("%ld blocks in %.1f ms: %.0f blocks/s, %.1f x real time\n",
+               received, elapsed, received / elapsed * 1e3,
+               received * frames / srate / elapsed * 1e3);
+        printf("round trip ms: median %.4f, p99 %.4f, max %.4f\n",
+               rtt[received / 2], rtt[received * 99 / 100],
+               rtt[received - 1]);
+    }
+    free(in);
+    free(out);
+    free(sent);
+    free(rtt);
+    return err != MHA_SHM_OK;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * coding: utf-8-unix
+ * End:
+ */
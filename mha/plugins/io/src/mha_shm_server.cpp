@@ -0,0 +1,218 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_shm_server.hh"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(mha_real_t) == sizeof(float),
+              "shared memory blocks hold float32 samples");
+static_assert(sizeof(mha_shm_audio_header) % MHA_SHM_AUDIO_ALIGN == 0,
+              "ring counters must fill whole cache lines");
+static_assert(offsetof(mha_shm_audio_header, in_write)
+              % MHA_SHM_AUDIO_ALIGN == 0,
+              "ring counters must start a cache line");
+static_assert(sizeof(mha_shm_audio_slot) == MHA_SHM_AUDIO_ALIGN,
+              "slot header must fill one cache line");
+
+using MHA_SHM::Server;
+
+/** Check if an existing segment was left behind by a terminated MHA. */
+static bool is_stale_segment(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        size_t(st.st_size) < sizeof(mha_shm_audio_header))
+        return true;
+    void * map = mmap(nullptr, sizeof(mha_shm_audio_header), PROT_READ,
+                      MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    const mha_shm_audio_header * h =
+        static_cast<const mha_shm_audio_header *>(map);
+    bool stale = h->magic != MHA_SHM_AUDIO_MAGIC
+        || h->state != MHA_SHM_STATE_OPEN
+        || (kill(pid_t(h->server_pid), 0) == -1 && errno == ESRCH);
+    munmap(map, sizeof(mha_shm_audio_header));
+    return stale;
+}
+
+Server::Server(const std::string & name,
+               unsigned fragsize, float srate,
+               unsigned nchannels_in, unsigned nchannels_out,
+               unsigned num_slots)
+    : path(name.size() && name[0] == '/' ? name : "/" + name),
+      size(0),
+      header(nullptr),
+      in_ring(nullptr),
+      out_ring(nullptr),
+      s_in(),
+      sequence(0),
+      input_pending(false),
+      output_stalls(0)
+{
+    if (path.size() < 2 || path.find('/', 1) != std::string::npos)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Invalid shared memory name \"%s\" (must be "
+                        "non-empty and must not contain '/')", name.c_str());
+    if (fragsize == 0 || nchannels_in == 0 || num_slots == 0)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Invalid shared memory audio dimensions: fragsize %u,"
+                        " %u input channels, %u slots",
+                        fragsize, nchannels_in, num_slots);
+    const uint64_t in_slot_bytes =
+        mha_shm_audio_slot_bytes(fragsize, nchannels_in);
+    const uint64_t out_slot_bytes =
+        mha_shm_audio_slot_bytes(fragsize, nchannels_out);
+    const uint64_t in_offset = sizeof(mha_shm_audio_header);
+    const uint64_t out_offset = in_offset + num_slots * in_slot_bytes;
+    size = out_offset + num_slots * out_slot_bytes;
+
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        int old = shm_open(path.c_str(), O_RDONLY, 0);
+        bool stale = old >= 0 && is_stale_segment(old);
+        if (old >= 0)
+            close(old);
+        if (!stale)
+            throw MHA_Error(__FILE__, __LINE__,
+                            "Shared memory \"%s\" is used by another MHA",
+                            path.c_str());
+        shm_unlink(path.c_str());
+        fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (fd < 0)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Cannot create shared memory \"%s\": %s",
+                        path.c_str(), strerror(errno));
+    void * map = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Cannot map shared memory \"%s\" of %zu bytes: %s",
+                        path.c_str(), size, strerror(err));
+    }
+    // Touch all pages now instead of in the signal processing thread.
+    memset(map, 0, size);
+    header = static_cast<mha_shm_audio_header *>(map);
+    header->version = MHA_SHM_AUDIO_VERSION;
+    header->fragsize = fragsize;
+    header->nchannels_in = nchannels_in;
+    header->nchannels_out = nchannels_out;
+    header->num_slots = num_slots;
+    header->srate = srate;
+    header->server_pid = uint32_t(getpid());
+    header->in_slot_bytes = in_slot_bytes;
+    header->out_slot_bytes = out_slot_bytes;
+    header->in_offset = in_offset;
+    header->out_offset = out_offset;
+    header->state = MHA_SHM_STATE_OPEN;
+    in_ring = static_cast<unsigned char *>(map) + in_offset;
+    out_ring = static_cast<unsigned char *>(map) + out_offset;
+    s_in.num_frames = fragsize;
+    s_in.num_channels = nchannels_in;
+    // clients check the magic number last
+    mha_shm_audio_store(&header->magic, MHA_SHM_AUDIO_MAGIC);
+}
+
+Server::~Server()
+{
+    mha_shm_audio_store(&header->state, MHA_SHM_STATE_CLOSED);
+    mha_shm_audio_wake(&header->in_read);
+    mha_shm_audio_wake(&header->out_write);
+    shm_unlink(path.c_str());
+    munmap(header, size);
+}
+
+mha_wave_t * Server::wait_input(int timeout_ms)
+{
+    if (input_pending)
+        return &s_in;
+    const uint32_t read = header->in_read;
+    uint32_t write = mha_shm_audio_load(&header->in_write);
+    if (write == read) {
+        mha_shm_audio_wait(&header->in_write, write, timeout_ms);
+        write = mha_shm_audio_load(&header->in_write);
+        if (write == read)
+            return nullptr;
+    }
+    mha_shm_audio_slot * slot = reinterpret_cast<mha_shm_audio_slot *>
+        (in_ring + (read % header->num_slots) * header->in_slot_bytes);
+    sequence = slot->sequence;
+    s_in.buf = reinterpret_cast<mha_real_t *>(slot + 1);
+    input_pending = true;
+    return &s_in;
+}
+
+bool Server::put_output(const mha_wave_t * s_out, int timeout_ms)
+{
+    if (!input_pending)
+        throw MHA_ErrorMsg("put_output called without pending input block");
+    if (s_out->num_frames != header->fragsize ||
+        s_out->num_channels != header->nchannels_out)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Output block has %u frames and %u channels, "
+                        "expected %u frames and %u channels",
+                        s_out->num_frames, s_out->num_channels,
+                        header->fragsize, header->nchannels_out);
+    const uint32_t write = header->out_write;
+    uint32_t read = mha_shm_audio_load(&header->out_read);
+    if (write - read >= header->num_slots) {
+        ++output_stalls;
+        mha_shm_audio_wait(&header->out_read, read, timeout_ms);
+        read = mha_shm_audio_load(&header->out_read);
+        if (write - read >= header->num_slots)
+            return false;
+    }
+    mha_shm_audio_slot * slot = reinterpret_cast<mha_shm_audio_slot *>
+        (out_ring + (write % header->num_slots) * header->out_slot_bytes);
+    slot->sequence = sequence;
+    memcpy(slot + 1, s_out->buf,
+           sizeof(mha_real_t) * s_out->num_frames * s_out->num_channels);
+    mha_shm_audio_store(&header->out_write, write + 1);
+    mha_shm_audio_wake(&header->out_write);
+    // s_out may point into the input slot: release it only after copying
+    mha_shm_audio_store(&header->in_read, header->in_read + 1);
+    mha_shm_audio_wake(&header->in_read);
+    input_pending = false;
+    return true;
+}
+
+unsigned Server::get_client_pid() const
+{
+    return mha_shm_audio_load(&header->client_pid);
+}
+
+unsigned Server::get_blocks() const
+{
+    return mha_shm_audio_load(&header->in_read);
+}
+
+// Local Variables:
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,118 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MHA_SHM_SERVER_HH
+#define MHA_SHM_SERVER_HH
+
+#include <string>
+#include "mha.hh"
+#include "mha_error.hh"
+#include "mha_shm_audio.h"
+
+/** Shared memory audio transport between MHA and a client process on
+ * the same host, see mha_shm_audio.h for the memory layout. */
+namespace MHA_SHM {
+
+    /**
+     * MHA side of the shared memory audio transport.  Creates the shared
+     * memory segment and exchanges audio blocks with the client.  All
+     * methods except the constructor and destructor must be called from
+     * one thread.
+     */
+    class Server {
+        /** Name of the segment including the leading slash. */
+        std::string path;
+        /** Size of the mapping in bytes. */
+        size_t size;
+        struct mha_shm_audio_header * header;
+        unsigned char * in_ring;
+        unsigned char * out_ring;
+        /** Input signal, buf points into the current input slot. */
+        mha_wave_t s_in;
+        /** Sequence number of the current input block. */
+        uint32_t sequence;
+        /** An input block has been returned by wait_input and not yet
+         * been answered by put_output. */
+        bool input_pending;
+        /** Number of times put_output had to wait for the client. */
+        unsigned output_stalls;
+    public:
+        /**
+         * Create and initialize the shared memory segment.  A segment
+         * with the same name is replaced if the process that created it
+         * no longer exists.
+         * @param name Segment name, a leading slash is added if missing.
+         * @param fragsize Frames per audio block.
+         * @param srate Sampling rate in Hz.
+         * @param nchannels_in Channels of input blocks.
+         * @param nchannels_out Channels of output blocks.
+         * @param num_slots Number of blocks in each ring.
+         * @throw MHA_Error if the segment exists and is used by another
+         *        process, or if a system call fails.
+         */
+        Server(const std::string & name,
+               unsigned fragsize, float srate,
+               unsigned nchannels_in, unsigned nchannels_out,
+               unsigned num_slots);
+
+        /** Close the segment, wake a waiting client and remove the
+         * segment name.  The client keeps its mapping until it detaches. */
+        ~Server();
+
+        Server(const Server &) = delete;
+        Server & operator=(const Server &) = delete;
+
+        /**
+         * Wait for the next input block from the client.
+         * @param timeout_ms Timeout in milliseconds.
+         * @return The input signal, which points directly into the shared
+         *         memory and remains valid until put_output succeeds, or
+         *         nullptr on timeout.
+         */
+        mha_wave_t * wait_input(int timeout_ms);
+
+        /**
+         * Copy an output block into the output ring and release the
+         * current input block.  Waits while the output ring is full.
+         * @param s_out Output signal of the processing callback.
+         * @param timeout_ms Timeout in milliseconds.
+         * @return false on timeout.  The input block is still pending
+         *         then, and put_output has to be called again.
+         * @throw MHA_Error if no input block is pending or s_out does not
+         *        have fragsize frames and nchannels_out channels.
+         */
+        bool put_output(const mha_wave_t * s_out, int timeout_ms);
+
+        /** Process id of the attached client, 0 if none. */
+        unsigned get_client_pid() const;
+
+        /** Number of blocks received from clients. */
+        unsigned get_blocks() const;
+
+        /** Number of times the output ring was full. */
+        unsigned get_output_stalls() const { return output_stalls; }
+
+        /** Name of the segment including the leading slash. */
+        const std::string & get_path() const { return path; }
+    };
+}
+
+#endif
+
+// Local Variables:
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -0,0 +1,225 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+#include <gtest/gtest.h>
+#include "mha_shm_server.hh"
+#include "mha_shm_client.h"
+#include "mha_signal.hh"
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using MHA_SHM::Server;
+
+namespace {
+    /// unique segment name for this test process
+    std::string segment_name() {
+        return "mha_shm_unit_test_" + std::to_string(getpid());
+    }
+
+    /// attach a client, fail the test on error
+    std::unique_ptr<mha_shm_client_t, void(*)(mha_shm_client_t*)>
+    open_client(const std::string & name) {
+        int err = MHA_SHM_EINVAL;
+        mha_shm_client_t * c = mha_shm_client_open(name.c_str(), &err);
+        EXPECT_EQ(MHA_SHM_OK, err) << mha_shm_client_strerror(err);
+        return {c, mha_shm_client_close};
+    }
+
+    /// MHA side: answer each input block with twice its first channel
+    void serve_blocks(Server & server, unsigned blocks) {
+        MHASignal::waveform_t s_out(4, 1);
+        for (unsigned b = 0; b < blocks; ++b) {
+            mha_wave_t * s_in = nullptr;
+            while ((s_in = server.wait_input(100)) == nullptr)
+                ;
+            for (unsigned k = 0; k < s_in->num_frames; ++k)
+                s_out.value(k, 0) = 2 * value(s_in, k, 0);
+            while (!server.put_output(&s_out, 100))
+                ;
+        }
+    }
+}
+
+TEST(mha_shm_server, announces_dimensions_to_client)
+{
+    Server server(segment_name(), 4, 16000, 2, 1, 3);
+    EXPECT_EQ("/" + segment_name(), server.get_path());
+    EXPECT_EQ(0U, server.get_client_pid());
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    EXPECT_EQ(4U, mha_shm_client_fragsize(client.get()));
+    EXPECT_EQ(2U, mha_shm_client_nchannels_in(client.get()));
+    EXPECT_EQ(1U, mha_shm_client_nchannels_out(client.get()));
+    EXPECT_EQ(16000.0f, mha_shm_client_srate(client.get()));
+    EXPECT_EQ(unsigned(getpid()), server.get_client_pid());
+    client.reset();
+    EXPECT_EQ(0U, server.get_client_pid());
+}
+
+TEST(mha_shm_server, round_trip_through_both_rings)
+{
+    Server server(segment_name(), 4, 16000, 2, 1, 2);
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    const unsigned blocks = 50;
+    std::thread mha(serve_blocks, std::ref(server), blocks);
+    std::vector<float> in(8), out(4);
+    for (unsigned b = 0; b < blocks; ++b) {
+        for (unsigned k = 0; k < 4; ++k) {
+            in[2 * k] = b + 0.25f * k;
+            in[2 * k + 1] = -1.0f;
+        }
+        ASSERT_EQ(MHA_SHM_OK,
+                  mha_shm_client_write(client.get(), in.data(), 1000));
+        ASSERT_EQ(MHA_SHM_OK,
+                  mha_shm_client_read(client.get(), out.data(), 1000));
+        for (unsigned k = 0; k < 4; ++k)
+            EXPECT_EQ(2 * (b + 0.25f * k), out[k]);
+    }
+    mha.join();
+    EXPECT_EQ(blocks, server.get_blocks());
+}
+
+TEST(mha_shm_server, input_is_processed_in_place)
+{
+    Server server(segment_name(), 4, 16000, 1, 1, 2);
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    EXPECT_EQ(nullptr, server.wait_input(0));
+    int err = MHA_SHM_EINVAL;
+    float * in = mha_shm_client_input_block(client.get(), 0, &err);
+    ASSERT_NE(nullptr, in);
+    for (unsigned k = 0; k < 4; ++k)
+        in[k] = k;
+    ASSERT_EQ(MHA_SHM_OK, mha_shm_client_submit(client.get()));
+    mha_wave_t * s_in = server.wait_input(0);
+    ASSERT_NE(nullptr, s_in);
+    EXPECT_EQ(2.0f, s_in->buf[2]);
+    // same memory, mapped separately by server and client
+    s_in->buf[3] = 42.0f;
+    EXPECT_EQ(42.0f, in[3]);
+    // pending block is returned again until output has been written
+    EXPECT_EQ(s_in, server.wait_input(0));
+    ASSERT_TRUE(server.put_output(s_in, 0));
+    const float * out = mha_shm_client_output_block(client.get(), 0, &err);
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(42.0f, out[3]);
+    EXPECT_EQ(MHA_SHM_OK, mha_shm_client_release_output(client.get()));
+    EXPECT_EQ(MHA_SHM_EINVAL, mha_shm_client_release_output(client.get()));
+}
+
+TEST(mha_shm_server, rejects_wrong_output_dimensions)
+{
+    Server server(segment_name(), 4, 16000, 1, 2, 2);
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    MHASignal::waveform_t wrong(4, 1);
+    EXPECT_THROW(server.put_output(&wrong, 0), MHA_Error);
+    std::vector<float> in(4);
+    ASSERT_EQ(MHA_SHM_OK, mha_shm_client_write(client.get(), in.data(), 0));
+    ASSERT_NE(nullptr, server.wait_input(0));
+    EXPECT_THROW(server.put_output(&wrong, 0), MHA_Error);
+}
+
+TEST(mha_shm_server, full_rings_time_out)
+{
+    Server server(segment_name(), 4, 16000, 1, 1, 2);
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    std::vector<float> in(4), out(4);
+    EXPECT_EQ(MHA_SHM_ETIMEOUT,
+              mha_shm_client_read(client.get(), out.data(), 1));
+    for (unsigned b = 0; b < 2; ++b)
+        ASSERT_EQ(MHA_SHM_OK,
+                  mha_shm_client_write(client.get(), in.data(), 0));
+    EXPECT_EQ(MHA_SHM_ETIMEOUT,
+              mha_shm_client_write(client.get(), in.data(), 1));
+    // client does not read: the second output block cannot be written
+    for (unsigned b = 0; b < 2; ++b) {
+        mha_wave_t * s_in = server.wait_input(0);
+        ASSERT_NE(nullptr, s_in);
+        EXPECT_TRUE(server.put_output(s_in, 1));
+        ASSERT_EQ(MHA_SHM_OK,
+                  mha_shm_client_write(client.get(), in.data(), 0));
+    }
+    EXPECT_NE(nullptr, server.wait_input(0));
+    EXPECT_FALSE(server.put_output(server.wait_input(0), 1));
+    EXPECT_EQ(1U, server.get_output_stalls());
+}
+
+TEST(mha_shm_server, second_client_is_rejected)
+{
+    Server server(segment_name(), 4, 16000, 1, 1, 2);
+    auto first = open_client(segment_name());
+    ASSERT_TRUE(first);
+    int err = MHA_SHM_OK;
+    EXPECT_EQ(nullptr, mha_shm_client_open(segment_name().c_str(), &err));
+    EXPECT_EQ(MHA_SHM_EBUSY, err);
+    first.reset();
+    auto second = open_client(segment_name());
+    EXPECT_TRUE(second);
+}
+
+TEST(mha_shm_server, new_client_skips_output_of_previous_client)
+{
+    Server server(segment_name(), 4, 16000, 1, 1, 4);
+    std::vector<float> in(4, 1.0f), out(4);
+    {
+        auto first = open_client(segment_name());
+        ASSERT_TRUE(first);
+        ASSERT_EQ(MHA_SHM_OK, mha_shm_client_write(first.get(), in.data(), 0));
+        // first client detaches without reading its answer
+    }
+    mha_wave_t * s_in = server.wait_input(0);
+    ASSERT_NE(nullptr, s_in);
+    auto second = open_client(segment_name());
+    ASSERT_TRUE(second);
+    ASSERT_TRUE(server.put_output(s_in, 0));
+    EXPECT_EQ(MHA_SHM_ETIMEOUT,
+              mha_shm_client_read(second.get(), out.data(), 0));
+    in.assign(4, 5.0f);
+    ASSERT_EQ(MHA_SHM_OK, mha_shm_client_write(second.get(), in.data(), 0));
+    s_in = server.wait_input(0);
+    ASSERT_NE(nullptr, s_in);
+    ASSERT_TRUE(server.put_output(s_in, 0));
+    ASSERT_EQ(MHA_SHM_OK, mha_shm_client_read(second.get(), out.data(), 0));
+    EXPECT_EQ(5.0f, out[0]);
+}
+
+TEST(mha_shm_server, client_sees_closed_segment)
+{
+    int err = MHA_SHM_OK;
+    EXPECT_EQ(nullptr, mha_shm_client_open(segment_name().c_str(), &err));
+    EXPECT_EQ(MHA_SHM_ENOENT, err);
+    auto server = std::make_unique<Server>(segment_name(), 4, 16000, 1, 1, 2);
+    EXPECT_THROW(Server(segment_name(), 4, 16000, 1, 1, 2), MHA_Error);
+    auto client = open_client(segment_name());
+    ASSERT_TRUE(client);
+    std::vector<float> out(4);
+    std::thread reader([&]{
+        EXPECT_EQ(MHA_SHM_ECLOSED,
+                  mha_shm_client_read(client.get(), out.data(), -1));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    server.reset();
+    reader.join();
+}
+
+// Local Variables:
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
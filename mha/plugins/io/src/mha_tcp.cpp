@@ -1,6 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2004 2008 2009 2011 2012 2013 2015 2016 2017 2018 HörTech gGmbH
 // Copyright © 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -25,6 +26,9 @@
 #else
 # include <sys/select.h>
 # include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# include <netinet/tcp.h>
 # include <unistd.h>
 # include <signal.h>
 # include <fcntl.h>
@@ -599,6 +603,11 @@ void Server::initialize(const std::string & iface, unsigned short port)
         throw MHA_ErrorMsg("The did not properly replace port number 0");
     }
 
+    start_listening();
+}
+
+void Server::start_listening()
+{
     // limit backlog to 1 pending connection
     if (listen(serversocket, 1) == SOCKET_ERROR) {
         std::string err = STRERROR(N_ERRNO());
@@ -641,6 +650,101 @@ void Server::initialize(const std::string & iface, unsigned short port)
         throw;
     }
 }
+#ifndef _WIN32
+static sockaddr_un local_sock_addr(const std::string & path)
+{
+    sockaddr_un sock_addr;
+    memset(&sock_addr, 0, sizeof(sock_addr));
+    sock_addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(sock_addr.sun_path))
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Invalid path \"%s\" for Unix domain socket "
+                        "(must be non-empty and shorter than %zu characters)",
+                        path.c_str(), sizeof(sock_addr.sun_path));
+    memcpy(sock_addr.sun_path, path.c_str(), path.size());
+    return sock_addr;
+}
+
+/** Remove a socket file left over from a server that has terminated.
+ * Other kinds of files and the sockets of running servers are kept, so
+ * that bind() fails with "Address already in use". */
+static void remove_stale_socket(const sockaddr_un & sock_addr)
+{
+    struct stat st;
+    if (lstat(sock_addr.sun_path, &st) != 0 || !S_ISSOCK(st.st_mode))
+        return;
+    SOCKET probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe == INVALID_SOCKET)
+        return;
+    // A server with a full backlog must not block the probe
+    fcntl(probe, F_SETFL, fcntl(probe, F_GETFL) | O_NONBLOCK);
+    const bool refused =
+        connect(probe, reinterpret_cast<const struct sockaddr *>(&sock_addr),
+                sizeof(sock_addr)) == SOCKET_ERROR &&
+        N_ERRNO() == ECONNREFUSED;
+    closesocket(probe);
+    // Nobody listens on this socket anymore
+    if (refused)
+        unlink(sock_addr.sun_path);
+}
+#endif
+
+Server::Server(const Local_Address & address)
+    : serversocket(INVALID_SOCKET),
+      port(0),
+      local_dev(0),
+      local_ino(0),
+      accept_event(0)
+{
+    memset(&sock_addr, 0, sizeof(sock_addr));
+#ifdef _WIN32
+    throw MHA_Error(__FILE__, __LINE__,
+                    "Unix domain socket \"%s\": not supported on Windows",
+                    address.path.c_str());
+#else
+    sockaddr_un local_addr = local_sock_addr(address.path);
+    serversocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serversocket == INVALID_SOCKET)
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Unable to open Unix domain server socket: %s",
+                        STRERROR(N_ERRNO()).c_str());
+    remove_stale_socket(local_addr);
+    if (bind(serversocket,
+             reinterpret_cast<struct sockaddr *>(&local_addr),
+             sizeof(local_addr)) == SOCKET_ERROR) {
+        std::string err = STRERROR(N_ERRNO());
+        closesocket(serversocket);
+        serversocket = INVALID_SOCKET;
+        throw MHA_Error(__FILE__,__LINE__,
+                        "Binding the server socket to \"%s\": %s",
+                        address.path.c_str(), err.c_str());
+    }
+    local_path = address.path;
+    struct stat st;
+    if (lstat(local_path.c_str(), &st) == 0) {
+        local_dev = st.st_dev;
+        local_ino = st.st_ino;
+    }
+    try {
+        start_listening();
+    } catch(...) {
+        remove_local_socket();
+        throw;
+    }
+#endif
+}
+
+void Server::remove_local_socket()
+{
+#ifndef _WIN32
+    // The file may have been removed and replaced by another server
+    struct stat st;
+    if (lstat(local_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) &&
+        st.st_dev == local_dev && st.st_ino == local_ino)
+        unlink(local_path.c_str());
+#endif
+}
+
 Server::~Server()
 {
     delete accept_event;
@@ -649,9 +753,12 @@ Server::~Server()
         closesocket(serversocket);
         serversocket = INVALID_SOCKET;
     }
+    if (!local_path.empty())
+        remove_local_socket();
 }
 std::string Server::get_interface() const {return iface;}
 unsigned short Server::get_port() const {return port;}
+std::string Server::get_local_path() const {return local_path;}
 Sockaccept_Event * Server::get_accept_event() {return accept_event;}
 
 Connection * Server::accept()
@@ -773,10 +880,43 @@ Client::Client(const std::string & host, unsigned short port,
     : Connection(tcp_connect_to_with_timeout(host, port, timeout_watcher))
 {}
 
+static SOCKET local_connect_to(const std::string & path)
+{
+#ifdef _WIN32
+    throw MHA_Error(__FILE__, __LINE__,
+                    "Unix domain socket \"%s\": not supported on Windows",
+                    path.c_str());
+#else
+    sockaddr_un sock_addr = local_sock_addr(path);
+    SOCKET fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET)
+         throw MHA_Error(__FILE__, __LINE__,
+                         "Cannot allocate Unix domain socket: %s",
+                         STRERROR(N_ERRNO()).c_str());
+    if (connect(fd,
+                reinterpret_cast<struct sockaddr *>(&sock_addr),
+                sizeof(sock_addr)) == SOCKET_ERROR) {
+        std::string err = STRERROR(N_ERRNO());
+        closesocket(fd);
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Cannot connect to Unix domain socket \"%s\": %s",
+                        path.c_str(), err.c_str());
+    }
+    return fd;
+#endif
+}
+
+Client::Client(const Local_Address & address)
+    : Connection(local_connect_to(address.path))
+{}
+
 std::string Connection::get_peer_address()
 {
+    if (is_local())
+        return "local";
     std::ostringstream o;
-    const unsigned int n_ip = peer_addr.sin_addr.s_addr;
+    const unsigned int n_ip =
+        reinterpret_cast<const sockaddr_in &>(peer_addr).sin_addr.s_addr;
     o << ( n_ip & 0x000000FFU)        << "."
       << ((n_ip & 0x0000FF00U) >>  8) << "."
       << ((n_ip & 0x00FF0000U) >> 16) << "."
@@ -785,7 +925,48 @@ std::string Connection::get_peer_address()
 }
 unsigned short Connection::get_peer_port()
 {
-    return ntohs(peer_addr.sin_port);
+    if (is_local())
+        return 0;
+    return ntohs(reinterpret_cast<const sockaddr_in &>(peer_addr).sin_port);
+}
+bool Connection::is_local() const
+{
+#ifdef _WIN32
+    return false;
+#else
+    return peer_addr.ss_family == AF_UNIX;
+#endif
+}
+
+void Connection::set_nodelay(bool nodelay)
+{
+    if (is_local())
+        return;
+    int flag = nodelay;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<const char*>(&flag),
+                   sizeof(flag)) == SOCKET_ERROR)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Setting socket option TCP_NODELAY: %s",
+                        STRERROR(N_ERRNO()).c_str());
+}
+
+void Connection::set_buffer_sizes(int sndbuf, int rcvbuf)
+{
+    if (sndbuf > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&sndbuf),
+                   sizeof(sndbuf)) == SOCKET_ERROR)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Setting socket option SO_SNDBUF to %d: %s",
+                        sndbuf, STRERROR(N_ERRNO()).c_str());
+    if (rcvbuf > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
+                   reinterpret_cast<const char*>(&rcvbuf),
+                   sizeof(rcvbuf)) == SOCKET_ERROR)
+        throw MHA_Error(__FILE__, __LINE__,
+                        "Setting socket option SO_RCVBUF to %d: %s",
+                        rcvbuf, STRERROR(N_ERRNO()).c_str());
 }
 
 MHA_TCP::Connection::Connection(SOCKET _fd)
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2004 2008 2009 2011 2012 2013 2015 2016 2017 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -28,6 +29,7 @@ namespace MHA_TCP {
 #else
 # include <sys/time.h>
 # include <netinet/in.h>
+# include <sys/socket.h>
 # include <netdb.h>
 # define Sleep(x) usleep((x)*1000);
 namespace MHA_TCP {
@@ -206,6 +208,16 @@ namespace MHA_TCP {
         Sockaccept_Event(SOCKET);
     };
 
+    /**
+     * File system path of a Unix domain socket.  Used to select the
+     * local transport instead of TCP when constructing a Server or
+     * Client.  Not available on Windows.
+     */
+    struct Local_Address {
+        explicit Local_Address(const std::string & _path) : path(_path) {}
+        std::string path;
+    };
+
     class Server;
     /**
      * Connection handles Communication between client and server,
@@ -217,7 +229,7 @@ namespace MHA_TCP {
         Sockread_Event * read_event;
         Sockwrite_Event * write_event;
         bool closed;
-        struct sockaddr_in peer_addr;
+        struct sockaddr_storage peer_addr;
 
         /**
          * determine peer address and port
@@ -272,13 +284,37 @@ namespace MHA_TCP {
         Sockwrite_Event * get_write_event();
 
         /**
-         * Get peer's IP Address
+         * Get peer's IP Address, or "local" for Unix domain sockets
          */
         std::string get_peer_address();
         /**
-         * Get peer's TCP port
+         * Get peer's TCP port, 0 for Unix domain sockets
          */
         unsigned short get_peer_port();
+        /**
+         * Checks if this connection uses a Unix domain socket.
+         */
+        bool is_local() const;
+
+        /**
+         * Enable or disable Nagle's algorithm (TCP_NODELAY).  Without
+         * Nagle's algorithm, small writes are sent immediately instead of
+         * waiting for the acknowledgement of previous data.  Has no effect
+         * on Unix domain sockets.
+         * @param nodelay true disables Nagle's algorithm.
+         * @throw MHA_Error if the socket option cannot be set.
+         */
+        void set_nodelay(bool nodelay);
+
+        /**
+         * Set the sizes of the kernel's send and receive buffers of the
+         * socket.  Smaller buffers limit the amount of audio that can queue
+         * up between peer and MHA, larger buffers tolerate more jitter.
+         * @param sndbuf Send buffer size in bytes, 0 keeps the default.
+         * @param rcvbuf Receive buffer size in bytes, 0 keeps the default.
+         * @throw MHA_Error if a socket option cannot be set.
+         */
+        void set_buffer_sizes(int sndbuf, int rcvbuf);
         /**
          * Return the (protected) file descriptor of the connection. 
          * Will be required for SSL.
@@ -376,8 +412,17 @@ namespace MHA_TCP {
         SOCKET serversocket;
         std::string iface;
         unsigned short port;
+        /** Path of the Unix domain socket, empty for TCP servers. */
+        std::string local_path;
+        /** Device and inode number of the socket file at local_path. */
+        unsigned long long local_dev, local_ino;
         Sockaccept_Event * accept_event;
         void initialize(const std::string & iface, unsigned short port);
+        /** Common part of initialization: listen and set nonblocking. */
+        void start_listening();
+        /** Remove the socket file at local_path if it is still the one
+         * created by this server. */
+        void remove_local_socket();
     public:
         /**
          * Create a TCP server socket.
@@ -392,7 +437,16 @@ namespace MHA_TCP {
          */
         Server(const std::string & iface, unsigned short port = 0);
         /**
-         * Close the TCP server socket.
+         * Create a Unix domain server socket for clients on the same host.
+         * A stale socket file left at the path by a previous server is
+         * replaced.  The socket of a running server is not: its clients
+         * would silently lose the connection to new servers.
+         * @param address The file system path to listen on.
+         */
+        explicit Server(const Local_Address & address);
+        /**
+         * Close the TCP server socket.  The file of a Unix domain server
+         * socket is removed.
          */
         ~Server();
         /**
@@ -401,8 +455,13 @@ namespace MHA_TCP {
         std::string get_interface() const;
         /**
          * Get the port that the TCP server socket currently listens to.
+         * Returns 0 for Unix domain server sockets.
          */
         unsigned short get_port() const;
+        /**
+         * Get the path of a Unix domain server socket, empty for TCP.
+         */
+        std::string get_local_path() const;
         /**
          * Produces an event that can be observed by an Event_Watcher. This
          * event signals incoming connections that can be accepted.
@@ -445,6 +504,12 @@ namespace MHA_TCP {
         Client(const std::string & host,
                unsigned short port,
                Timeout_Watcher & timeout_watcher);
+
+        /**
+         * Constructor connects to a Unix domain server socket.
+         * @param address The file system path of the server socket.
+         */
+        explicit Client(const Local_Address & address);
     };
 
     /**
@@ -0,0 +1,99 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+#include <gtest/gtest.h>
+#include "mha_tcp.hh"
+#include <memory>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace MHA_TCP;
+
+namespace {
+    /// unique socket path in the temporary directory
+    std::string socket_path() {
+        return "/tmp/mha_tcp_unit_test_" + std::to_string(getpid())
+            + ".sock";
+    }
+}
+
+TEST(mha_tcp_server, tcp_connection_accepts_socket_options)
+{
+    Server server(0, "127.0.0.1");
+    ASSERT_NE(0U, server.get_port());
+    EXPECT_EQ("", server.get_local_path());
+    Client client("127.0.0.1", server.get_port());
+    std::unique_ptr<Connection> connection(server.accept());
+    EXPECT_FALSE(connection->is_local());
+    EXPECT_EQ("127.0.0.1", connection->get_peer_address());
+    EXPECT_NO_THROW(connection->set_nodelay(true));
+    EXPECT_NO_THROW(connection->set_buffer_sizes(16384, 16384));
+    client.write("ping\n");
+    EXPECT_EQ("ping\n", connection->read_line());
+}
+
+TEST(mha_tcp_server, unix_domain_socket_exchanges_data)
+{
+    const std::string path = socket_path();
+    {
+        Server server((Local_Address(path)));
+        EXPECT_EQ(0U, server.get_port());
+        EXPECT_EQ(path, server.get_local_path());
+        Client client((Local_Address(path)));
+        std::unique_ptr<Connection> connection(server.accept());
+        EXPECT_TRUE(connection->is_local());
+        EXPECT_EQ("local", connection->get_peer_address());
+        EXPECT_EQ(0U, connection->get_peer_port());
+        // TCP_NODELAY does not apply to unix sockets and is ignored
+        EXPECT_NO_THROW(connection->set_nodelay(true));
+        EXPECT_NO_THROW(connection->set_buffer_sizes(0, 8192));
+        connection->write(std::string(4, '\x7f'));
+        EXPECT_EQ(std::string(4, '\x7f'), client.read_bytes(4));
+    }
+    // server removes its socket file
+    struct stat st;
+    EXPECT_NE(0, lstat(path.c_str(), &st));
+}
+
+TEST(mha_tcp_server, unix_domain_socket_replaces_only_stale_socket)
+{
+    const std::string path = socket_path();
+    {
+        // a socket file without a listening server is replaced
+        int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        ASSERT_EQ(0, bind(stale, reinterpret_cast<sockaddr *>(&addr),
+                          sizeof(addr)));
+        close(stale);
+        Server server((Local_Address(path)));
+        // the socket of a running server is not taken over
+        EXPECT_THROW(Server((Local_Address(path))), MHA_Error);
+        Client client((Local_Address(path)));
+        std::unique_ptr<Connection> connection(server.accept());
+        EXPECT_TRUE(connection->is_local());
+    }
+    // regular files are not deleted
+    FILE * file = fopen(path.c_str(), "w");
+    ASSERT_NE(nullptr, file);
+    fclose(file);
+    EXPECT_THROW(Server((Local_Address(path))), MHA_Error);
+    EXPECT_EQ(0, unlink(path.c_str()));
+    EXPECT_THROW(Server((Local_Address(""))), MHA_Error);
+    EXPECT_THROW(Client((Local_Address(path))), MHA_Error);
+}
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2014 2015 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -20,6 +20,7 @@
  */
 
 #include "lpc.h"
+#include <algorithm>
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &lpc::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
@@ -45,7 +46,10 @@ lpc_config::lpc_config(MHA_AC::algo_comm_t & ac,
            in_cfg.channels,
            0),
     lpc_out(ac, algo_name, _order + 1, in_cfg.channels, false),
-    corr_out(ac, algo_name + "_corr", _order + 1, in_cfg.channels, false)
+    corr_out(ac, algo_name + "_corr", _order + 1, in_cfg.channels, false),
+    block(std::max(_order + 1, _lpc_buffer_size), 0.0f),
+    autocorrelation(block.size(), _order),
+    levinson(_order)
 {
     //initialize plugin state for a new configuration    
     sample.buf = new mha_real_t[1 * in_cfg.channels];
@@ -75,8 +79,6 @@ void lpc_config::insert()
     corr_out.insert();
 }
 
-void Levinson2(unsigned int P, const std::vector<mha_real_t> &R, std::vector<mha_real_t> &A);
-
 //the actual processing implementation
 mha_wave_t *lpc_config::process(mha_wave_t *wave)
 {
@@ -116,20 +118,19 @@ mha_wave_t *lpc_config::process(mha_wave_t *wave)
 
     //step 1: estimate the autocorrelation for this frame
     for (unsigned int ch = 0; ch < wave->num_channels; ch++) {
-        for (unsigned int i=0; i < order + 1; ++i) //over all lags within order+1
-        {
-            R[i] = 0;
-            for (unsigned int j=0; j < lpc_buffer_size - i; ++j) //all samples minus lag
-            {
-                R[i] += inwave.value(j,ch) * inwave.value(j+i,ch);
-            }
-
-            if (norm)
+        //a buffer that is not filled yet is padded with zeros
+        const unsigned int filled = std::min(inwave.contained_frames(), lpc_buffer_size);
+        for (unsigned int j=0; j < filled; ++j)
+            block[j] = inwave.value(j,ch);
+        std::fill(block.begin() + filled, block.end(), 0.0f);
+        autocorrelation(block.data(), R.data());
+
+        if (norm)
+            for (unsigned int i=0; i < order + 1; ++i)
                 R[i] /= (mha_real_t) lpc_buffer_size; //divide by blocksize
-        }
 
         //step 2: find IIR coefficients to invert the system
-        Levinson2(order, R, A);
+        levinson(R.data(), A.data());
 
         //step 3: copy coefficients to AC space
         for (unsigned int i=0; i<=order; i++)
@@ -221,58 +222,6 @@ mha_wave_t * lpc::process(mha_wave_t * signal)
     return poll_config()->process( signal );
 }
 
-//rewritten code, based on tutorial by Cedrick Collomb
-void Levinson2(unsigned int P, const std::vector<mha_real_t> &R, std::vector<mha_real_t> &A)
-{
-    //step 1: initialize A to be a unit vector
-    //the rest of the coefficients will be computed from the main recursion
-    for (unsigned int k=0; k<P+1; ++k)
-    {
-        A[k] = (k==0) ? 1.0 : 0.0;
-    }
-
-    //step 2: set E0 to R0-
-    //each error component comes from explaining components of the autocorrelation
-    double Ek = R[0];
-
-//    std::vector<mha_real_t> Atemp(P+1,0); //temp for A recursion
-
-    //step 3: Levinson recursion.
-    //This uses coefficients of order k to compute order k+1
-    for (unsigned int k=0; k<P; ++k)
-    {
-        //step 4: update lambda given equation (4)
-        double lambda = 0;
-        for (unsigned int j=0; j<k+1; ++j)
-        {
-            lambda += A[j] * R[k+1-j];
-        }
-        lambda /= -Ek; //change sign and divide by Ek
-
-        //step 5: update Ak[k+1 coeffs] to Ak+1[k+2 coeffs] by summing extensions
-        //these are Uk+1, from expanding Ak with a zero
-        //and Vk+1, which is just Uk+1 flipped
-//        Atemp = A; //copy prev values
-//        for (unsigned int j=0; j<k+2; ++j)
-//        {
-//            //for each new element of Ak+1
-//            //Ak+1 = Uk+1 + lambda * Vk+1
-//            A[j] = Atemp[j] + lambda * Atemp[k+1-j];
-//        }
-
-        for (unsigned int j = 0; j <= (k + 1) / 2; j++)
-        {
-            double temp = A[k + 1 - j] + lambda * A[j];
-            A[j] = A[j] + lambda * A[k + 1 - j];
-            A[k + 1 - j] = temp;
-        }
-
-        //step 6: update Ek given equation (6)
-        Ek = (1.0 - lambda*lambda) * Ek;
-
-    } //end of levinson recursion
-} //end of Levinson2
-
 /*
  * This macro connects the plugin1_t class with the MHA plugin C interface
  * The first argument is the class name, the other arguments define the
@@ -293,7 +242,10 @@ MHAPLUGIN_DOCUMENTATION\
 (lpc,
  "feedback-suppression adaptive",
  "This plugin estimates the autocorrelation of each block. "
- "It then produces the inverse filter using the Levinson-Durbin recursion."
+ "It then produces the inverse filter using the Levinson-Durbin recursion. "
+ "When the LPC buffer is long compared to the FFT length needed for the "
+ "requested order, the autocorrelation is computed with an FFT instead of "
+ "direct sums."
  )
 
 // Local Variables:
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2014 2017 2018 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -18,6 +18,7 @@
 #define LPC_H
 
 #include "mha_plugin.hh"
+#include "mha_lpc.hh"
 #include <vector>
 
 //runtime config
@@ -52,6 +53,10 @@ private:
     MHASignal::ringbuffer_t inwave;
     MHA_AC::waveform_t lpc_out;
     MHA_AC::waveform_t corr_out;
+    /// Contiguous copy of one channel of the LPC buffer
+    std::vector<mha_real_t> block;
+    MHALPC::autocorrelation_t autocorrelation;
+    MHALPC::levinson_durbin_t levinson;
 
 };
 
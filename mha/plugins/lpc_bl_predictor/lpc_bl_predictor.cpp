@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2016 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -27,16 +27,12 @@ lpc_bl_predictor_config::lpc_bl_predictor_config(MHA_AC::algo_comm_t & iac,
     : ac(iac)
     , f_est(ac, _lpc->name_lpc_f.data, in_cfg.fragsize, in_cfg.channels, true)
     , b_est(ac, _lpc->name_lpc_b.data, in_cfg.fragsize, in_cfg.channels, true)
-    , forward( _lpc->lpc_order.data, in_cfg.channels)
-    , backward(_lpc->lpc_order.data, in_cfg.channels * 2)
+    , lattice(_lpc->lpc_order.data, in_cfg.channels)
     , lpc_order(_lpc->lpc_order.data)
     , name_km(_lpc->name_kappa.data)
     , name_f(_lpc->name_f.data)
     , name_b(_lpc->name_b.data)
 {
-    //initialize plugin state for a new configuration
-    forward.assign(EPSILON);
-    backward.assign(EPSILON);
 }
 
 lpc_bl_predictor_config::~lpc_bl_predictor_config()
@@ -47,7 +43,6 @@ lpc_bl_predictor_config::~lpc_bl_predictor_config()
 mha_wave_t *lpc_bl_predictor_config::process(mha_wave_t *wave)
 {
     //do actual processing here using configuration state
-    static int k = 0;
 
     // Get the kappa value from the AC space
     km = MHA_AC::get_var_waveform(ac, name_km);
@@ -57,35 +52,7 @@ mha_wave_t *lpc_bl_predictor_config::process(mha_wave_t *wave)
     s_b = MHA_AC::get_var_waveform(ac, name_b);
 
     // perform filtering using the km from last iteration
-    for (unsigned int chan = 0; chan < wave->num_channels; chan++) {
-        for (unsigned int sample = 0; sample < wave->num_frames; sample++) {
-
-            forward(0, chan)    = value(s_f, sample, chan);
-
-            backward(0, chan * 2 + 1)  = backward(0, chan * 2);
-            backward(0, chan * 2)  = value(s_b, sample, chan);
-
-            for (int m = 1; m < lpc_order; m++) {
-
-                backward(m, chan * 2 + 1)  = backward(m, chan * 2);
-
-                if (k >= 1) {
-                    // Weighted Lattice Predictor for Updating Input Vector
-                    forward(m, chan)    = forward(m-1, chan) + value(km, sample * lpc_order + m, chan) * backward(m-1, chan * 2 + 1);
-                    backward(m, chan * 2)  = backward(m-1, chan * 2 + 1) + value(km, sample * lpc_order + m, chan) * forward(m-1, chan);
-
-                } else {
-                    forward(m, chan)    = forward(m-1, chan);
-                    backward(m,chan * 2)  = backward(m-1, chan * 2 + 1);
-
-                    k++;
-                }
-            }
-
-            f_est(sample, chan) = forward(lpc_order - 1, chan);
-            b_est(sample, chan) = backward(lpc_order - 1, chan);
-        }
-    }
+    lattice.predict(km, s_f, s_b, f_est, b_est);
 
     //return current fragment
     return wave;
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2016 2017 2018 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -18,8 +18,7 @@
 #define LPC_BL_PREDICTOR_H
 
 #include "mha_plugin.hh"
-
-#define EPSILON 1e-10
+#include "mha_lpc.hh"
 
 class lpc_bl_predictor;
 
@@ -31,8 +30,7 @@ class lpc_bl_predictor_config {
     MHA_AC::waveform_t f_est;
     MHA_AC::waveform_t b_est;
 
-    MHASignal::waveform_t forward;
-    MHASignal::waveform_t backward;
+    MHALPC::burg_lattice_t lattice;
 
     int lpc_order;
     std::string name_km;
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2016 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -19,7 +19,6 @@
  * that sample wise signal processing occurs
  */
 
-#include <cmath>
 #include "lpc_burg-lattice.h"
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &lpc_burglattice::update_cfg)
@@ -29,22 +28,13 @@ lpc_burglattice_config::lpc_burglattice_config(MHA_AC::algo_comm_t & iac,
                                                const mhaconfig_t in_cfg,
                                                lpc_burglattice *_lpc)
     : ac(iac)
-    , forward(_lpc->lpc_order.data, in_cfg.channels)
-    , backward(_lpc->lpc_order.data, in_cfg.channels * 2)
-    , kappa(_lpc->lpc_order.data, in_cfg.channels)
+    , lattice(_lpc->lpc_order.data, in_cfg.channels)
     , kappa_block(ac, _lpc->name_kappa.data, _lpc->lpc_order.data * in_cfg.fragsize, in_cfg.channels, true)
-    , dm(_lpc->lpc_order.data, in_cfg.channels)
-    , nm(_lpc->lpc_order.data, in_cfg.channels)
     , lambda(_lpc->lambda.data)
     , lpc_order(_lpc->lpc_order.data)
     , name_f(_lpc->name_f.data)
     , name_b(_lpc->name_b.data)
 {
-    //initialize plugin state for a new configuration
-    forward.assign(EPSILON);
-    backward.assign(EPSILON);
-    dm.assign(EPSILON);
-    nm.assign(EPSILON);
 }
 
 lpc_burglattice_config::~lpc_burglattice_config()
@@ -60,35 +50,9 @@ mha_wave_t *lpc_burglattice_config::process(mha_wave_t *wave)
     s_f = MHA_AC::get_var_waveform(ac, name_f);
     s_b = MHA_AC::get_var_waveform(ac, name_b);
 
-    // Compute the lattice filter coefficients for each channel of the input signal
-    for (unsigned int chan = 0; chan < wave->num_channels; chan++) {
-
-        for (unsigned int sample = 0; sample < wave->num_frames; sample++) {
-
-            forward(0, chan) = value(s_f, sample, chan);
-
-            backward(0, chan * 2 + 1) = backward(0, chan * 2);
-            backward(0,chan * 2) = value(s_b, sample, chan);
-
-            kappa_block(sample * lpc_order, chan) = kappa(0, chan);
-
-            // Computation of the lattice filter coefficients, kappa will be saved in the AC space for the linear prediction
-            for (int m = 1; m < lpc_order; m++) {
-
-                backward(m, chan * 2 + 1)  = backward(m, chan * 2);
-                kappa_block(sample * lpc_order + m, chan) = kappa(m, chan);
-
-                // Burg Lattice Algorithm
-                dm(m-1, chan) = lambda * dm(m-1, chan) + (1-lambda) * (pow(forward(m-1, chan), 2) + pow(backward(m-1,chan * 2 + 1), 2));
-                nm(m-1, chan) = lambda * nm(m-1, chan) + (1-lambda) * (-2)*(forward(m-1, chan) * backward(m-1, chan * 2 + 1));
-                kappa(m, chan) = nm(m-1, chan) / (dm(m-1, chan));
-
-                // Adaptive Lattice Predictor
-                forward(m, chan)    = forward(m-1, chan) + kappa(m, chan) * backward(m-1, chan * 2 + 1);
-                backward(m, chan * 2)  = backward(m-1, chan * 2 + 1) + kappa(m, chan) * forward(m-1, chan);
-            }
-        }
-    }
+    // Compute the lattice filter coefficients for each channel of the input
+    // signal, kappa will be saved in the AC space for the linear prediction
+    lattice.estimate(s_f, s_b, lambda, kappa_block);
 
     //return current fragment
     return wave;
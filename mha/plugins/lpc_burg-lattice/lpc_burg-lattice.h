@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2016 2017 2018 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -18,8 +18,7 @@
 #define LPC_BURGLATTICE_H
 
 #include "mha_plugin.hh"
-
-#define EPSILON 1e-10
+#include "mha_lpc.hh"
 
 class lpc_burglattice;
 
@@ -28,13 +27,8 @@ class lpc_burglattice_config {
 
     MHA_AC::algo_comm_t & ac;
 
-    MHASignal::waveform_t forward;
-    MHASignal::waveform_t backward;
-
-    MHASignal::waveform_t kappa;
+    MHALPC::burg_lattice_t lattice;
     MHA_AC::waveform_t kappa_block;
-    MHASignal::waveform_t dm;
-    MHASignal::waveform_t nm;
     mha_real_t lambda;
     int lpc_order;
     std::string name_f;
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -32,8 +32,16 @@ lsl2ac::lsl2ac_t::lsl2ac_t(MHA_AC::algo_comm_t & iac, const std::string &)
     insert_member(buffersize);
     insert_member(chunksize);
     insert_member(nsamples);
+    insert_member(receiver_thread);
+    insert_member(ringsize);
     insert_item("available_streams", &available_streams);
+    insert_member(age);
+    insert_member(max_age);
+    insert_member(ring_overflows);
     patchbay.connect(&available_streams.prereadaccess,this,&lsl2ac_t::get_all_stream_names);
+    patchbay.connect(&age.prereadaccess,this,&lsl2ac_t::update_stats);
+    patchbay.connect(&max_age.prereadaccess,this,&lsl2ac_t::update_stats);
+    patchbay.connect(&ring_overflows.prereadaccess,this,&lsl2ac_t::update_stats);
 }
 
 void lsl2ac::lsl2ac_t::prepare(mhaconfig_t&)
@@ -57,7 +65,8 @@ void lsl2ac::lsl2ac_t::process()
 void lsl2ac::lsl2ac_t::update(){
     if(is_prepared()){
         auto c=new cfg_t(ac, static_cast<lsl2ac::overrun_behavior>(overrun_behavior.data.get_index()),
-                         buffersize.data, chunksize.data, streams.data, nchannels.data, nsamples.data);
+                         buffersize.data, chunksize.data, streams.data, nchannels.data, nsamples.data,
+                         receiver_thread.data ? ringsize.data : 0);
         push_config(c);
     }
 }
@@ -69,6 +78,15 @@ void lsl2ac::lsl2ac_t::setlock(bool lock_){
     streams.setlock(lock_);
     nchannels.setlock(lock_);
     nsamples.setlock(lock_);
+    receiver_thread.setlock(lock_);
+    ringsize.setlock(lock_);
+}
+
+void lsl2ac::lsl2ac_t::update_stats()
+{
+    auto latest_cfg=peek_config();
+    if(latest_cfg)
+        latest_cfg->get_stats(age.data,max_age.data,ring_overflows.data);
 }
 
 void lsl2ac::lsl2ac_t::get_all_stream_names()
@@ -86,7 +104,9 @@ lsl2ac::cfg_t::cfg_t(MHA_AC::algo_comm_t & ac_,
                      int chunksize_,
                      const std::vector<std::string>& streamnames_,
                      int nchannels_,
-                     int nsamples_)
+                     int nsamples_,
+                     int ringsize_)
+    : streamnames(streamnames_)
 {
     for(auto& name : streamnames_) {
         //Find all streams with matching name and take the first one, throw if none found
@@ -103,7 +123,8 @@ lsl2ac::cfg_t::cfg_t(MHA_AC::algo_comm_t & ac_,
                                                                           bufsize_,
                                                                           chunksize_,
                                                                           nchannels_,
-                                                                          nsamples_));
+                                                                          nsamples_,
+                                                                          ringsize_));
             break;
         case lsl::channel_format_t::cf_double64:
             varlist.emplace(name,std::make_unique<save_var_t<double>>(matching_streams[0],
@@ -113,7 +134,8 @@ lsl2ac::cfg_t::cfg_t(MHA_AC::algo_comm_t & ac_,
                                                                       bufsize_,
                                                                       chunksize_,
                                                                       nchannels_,
-                                                                      nsamples_));
+                                                                      nsamples_,
+                                                                      ringsize_));
             break;
             // LSL takes care of type conversion from short integers to ints
         case lsl::channel_format_t::cf_int8:
@@ -126,7 +148,8 @@ lsl2ac::cfg_t::cfg_t(MHA_AC::algo_comm_t & ac_,
                                                                    bufsize_,
                                                                    chunksize_,
                                                                    nchannels_,
-                                                                   nsamples_));
+                                                                   nsamples_,
+                                                                   ringsize_));
             break;
         case lsl::channel_format_t::cf_string:
             // char arrays and marker streams both use cf_string - distinguish by type meta data
@@ -145,7 +168,8 @@ lsl2ac::cfg_t::cfg_t(MHA_AC::algo_comm_t & ac_,
                                                                         bufsize_,
                                                                         chunksize_,
                                                                         nchannels_,
-                                                                        nsamples_));
+                                                                        nsamples_,
+                                                                        ringsize_));
             break;
         case lsl::channel_format_t::cf_int64:
             throw MHA_Error(__FILE__,__LINE__,"Stream %s: Channel format int64 is not supported.",matching_streams[0].name().c_str());
@@ -163,6 +187,22 @@ void lsl2ac::cfg_t::process(){
     }
 }
 
+void lsl2ac::cfg_t::get_stats(std::vector<float>& ages,
+                              std::vector<float>& max_ages,
+                              std::vector<int>& overflows) const {
+    ages.clear();
+    max_ages.clear();
+    overflows.clear();
+    for(auto& name : streamnames){
+        auto var=varlist.find(name);
+        if(var==varlist.end())
+            continue;
+        ages.push_back(var->second->get_age());
+        max_ages.push_back(var->second->get_max_age());
+        overflows.push_back(static_cast<int>(var->second->get_ring_overflows()));
+    }
+}
+
 MHAPLUGIN_CALLBACKS(lsl2ac,lsl2ac::lsl2ac_t,wave,wave)
 MHAPLUGIN_PROC_CALLBACK(lsl2ac,lsl2ac::lsl2ac_t,spec,spec)
 MHAPLUGIN_DOCUMENTATION(
@@ -201,7 +241,18 @@ MHAPLUGIN_DOCUMENTATION(
                         " Longer marker strings are cut off memory safe, they may however cause memory allocations within lsl, so the size should not be chosen"
                         " too small.\n"
                         " The configuration regarding the AC variable size and the LSL stream inlet applies plugin wide. To use per-stream"
-                        " configuration this plugin must be instantiated multiple times.\n")
+                        " configuration this plugin must be instantiated multiple times.\n"
+                        " With receiver\\_thread=yes, each numeric stream gets a background thread that waits for"
+                        " chunks from LSL and appends them to a preallocated lock-free ring of ringsize samples per channel."
+                        " The process callback then only moves samples from the ring into the AC variables, with the"
+                        " same overrun behavior, and makes no LSL calls; discarding the overrun can then no longer hang"
+                        " the processing thread. The time correction is refreshed by the receiver thread."
+                        " When the ring is full because the process callback does not keep up, the receiver discards"
+                        " the newest samples and counts them in the monitor variable ring\\_overflows."
+                        " An additional AC variable NAME\\_age contains the age in seconds of the newest sample in NAME,"
+                        " i.e. the local LSL clock minus the corrected time stamp; the monitor variables age and max\\_age"
+                        " report the current and maximum age of each stream. Marker streams are always received by the"
+                        " processing thread.\n")
 /*
  * Local variables:
  * c-basic-offset: 4
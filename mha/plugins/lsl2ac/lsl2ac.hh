@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -19,6 +19,7 @@
 #include "mha_os.h"
 #include "mha_events.h"
 #include "mha_defs.h"
+#include "mha_fifo.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-compare"
@@ -31,6 +32,8 @@
 #include <exception>
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <thread>
 
 namespace lsl2ac{
 
@@ -43,6 +46,15 @@ namespace lsl2ac{
     virtual lsl::stream_info info()=0;
     /** Receive a samples from lsl and copy to AC space. Handling of underrun is configuration-dependent */
     virtual void receive_frame()=0;
+    /** Age in seconds of the newest sample published to AC space in the
+     * last process callback with new samples: local time minus the
+     * corrected LSL timestamp.  0 if not measured. May be called from any thread. */
+    virtual double get_age() const {return 0.0;}
+    /** Maximum of get_age() since the stream was opened */
+    virtual double get_max_age() const {return 0.0;}
+    /** Number of samples per channel that the receiver thread discarded
+     * because the receive ring was full */
+    virtual uint64_t get_ring_overflows() const {return 0U;}
   };
 
   /** LSL to AC bridge variable */
@@ -52,7 +64,13 @@ namespace lsl2ac{
     // Do not allow copies or moves to avoid reasoning about copies or moves of streams and ac vars
     save_var_t(const save_var_t&)=delete;
     save_var_t(save_var_t&&)=delete;
-    virtual ~save_var_t()=default;
+    /** Terminates the receiver thread */
+    virtual ~save_var_t(){
+      if(receiver.joinable()){
+        stop_receiver.store(true);
+        receiver.join();
+      }
+    }
     save_var_t& operator=(const save_var_t&)=delete;
     save_var_t& operator=(save_var_t&&)=delete;
     /** C'tor of lsl to ac bridge.
@@ -65,6 +83,9 @@ namespace lsl2ac{
      * @param chunksize_ LSL chunk size
      * @param nchannels_ Number of channels in the AC variable must be zero or equal to number of channels in LSL stream
      * @param nsamples_ Number of samples per channel in the AC variable. Zero means resize as needed
+     * @param ringsize_ Capacity of the receive ring in samples per channel. Zero means samples are
+     *                  pulled from LSL by the processing thread. Otherwise, a receiver thread pulls
+     *                  chunks from LSL into the ring, and the processing thread only reads the ring.
      */
     // This is a function try block. Really ugly syntax but the only way to handle exceptions
     // in the ctor initializer list. See http://www.gotw.ca/gotw/066.htm
@@ -75,7 +96,8 @@ namespace lsl2ac{
                int buflen_,
                int chunksize_,
                int nchannels_,
-               int nsamples_) try
+               int nsamples_,
+               int ringsize_=0) try
       : stream(info_, buflen_, chunksize_),
           ac(ac_),
           ts_name(info_.name() + "_ts"),
@@ -88,7 +110,9 @@ namespace lsl2ac{
           nsamples(nsamples_),   /* Parser only accepts values>0, so no problems b/c of signedness */
           chunksize(chunksize_), /* Parser only accepts values>0, so no problems b/c of signedness */
           bufsize(0),
-          n_new_samples(0)
+          n_new_samples(0),
+          age_name(info_.name() + "_age"),
+          ringsize(ringsize_)
           {
             if (nchannels != 0 && nchannels != info_.channel_count())
               throw MHA_Error(__FILE__, __LINE__,
@@ -127,7 +151,17 @@ namespace lsl2ac{
 
             initialize(tc_buf,tc,stream.time_correction());
             initialize(ts_buf,ts,0.0);
+            if(ringsize){
+              ring=std::make_unique<mha_fifo_lf_t<T>>(ringsize*nchannels);
+              ts_ring=std::make_unique<mha_fifo_lf_t<double>>(ringsize);
+              chunkbuf.resize(bufsize);
+              chunk_ts.resize(bufsize / nchannels);
+              time_correction.store(tc_buf.empty() ? 0.0 : tc_buf[0]);
+            }
             insert_vars();
+            // Start last: nothing may throw after the thread was started
+            if(ringsize)
+              receiver=std::thread(&save_var_t::receive_thread,this);
           } catch (MHA_Error &e) {
       // The framework can handle MHA_Errors. Just re-throw
       throw;
@@ -150,6 +184,10 @@ namespace lsl2ac{
       if(skip){
         return;
       }
+      else if (ring) {
+        read_ring();
+        insert_vars();
+      }
       else {
         n_new_samples=0;
         if (ob == overrun_behavior::Ignore) {
@@ -164,6 +202,9 @@ namespace lsl2ac{
         get_time_correction();
         insert_vars();
       }};
+    double get_age() const override {return age_last.load();}
+    double get_max_age() const override {return age_max.load();}
+    uint64_t get_ring_overflows() const override {return ring_overflows.load();}
   private:
     /** LSL stream outlet. Interface to lsl */
     lsl::stream_inlet stream;
@@ -209,6 +250,113 @@ namespace lsl2ac{
     std::size_t bufsize;
     /** Number of most recently pulled samples per channel */
     int n_new_samples;
+    /** Age AC variable name */
+    std::string age_name;
+    /** Age of the newest sample in the AC variable in seconds */
+    double age=0.0;
+    /** Capacity of the receive ring in samples per channel, zero if there
+     * is no receiver thread */
+    std::size_t ringsize;
+    /** Samples received by the receiver thread */
+    std::unique_ptr<mha_fifo_lf_t<T>> ring;
+    /** Timestamps of the samples in ring */
+    std::unique_ptr<mha_fifo_lf_t<double>> ts_ring;
+    /** Receiver thread buffer for one chunk of samples */
+    std::vector<T> chunkbuf;
+    /** Receiver thread buffer for the timestamps of one chunk */
+    std::vector<double> chunk_ts;
+    /** Pulls chunks from LSL into the ring */
+    std::thread receiver;
+    /** Tells the receiver thread to terminate */
+    std::atomic<bool> stop_receiver{false};
+    /** Set by the receiver thread when the stream fails permanently */
+    std::atomic<bool> receiver_failed{false};
+    /** Time correction, refreshed every 5s by the receiver thread */
+    std::atomic<double> time_correction{0.0};
+    /** Samples per channel discarded by the receiver thread */
+    std::atomic<uint64_t> ring_overflows{0U};
+    /** Copy of age for readers in other threads */
+    std::atomic<double> age_last{0.0};
+    /** Maximum age since the stream was opened */
+    std::atomic<double> age_max{0.0};
+    /** Main loop of the receiver thread. Waits for chunks from LSL and
+     * appends them to the ring. When the ring is full, the newest samples
+     * of the chunk are discarded and counted, because only the processing
+     * thread may remove samples from the ring. */
+    void receive_thread() {
+      try{
+        auto last_correction=std::chrono::steady_clock::now();
+        while(!stop_receiver.load()){
+          std::size_t n = stream.pull_chunk_multiplexed(chunkbuf.data(), chunk_ts.data(),
+                                                        chunkbuf.size(), chunk_ts.size(),
+                                                        /*timeout =*/0.1);
+          std::size_t samples = n / nchannels;
+          std::size_t fits = std::min<std::size_t>(samples, ts_ring->get_available_space());
+          if(fits){
+            // Samples before timestamps: the processing thread reads the
+            // timestamp fill count first
+            ring->write(chunkbuf.data(), fits * nchannels);
+            ts_ring->write(chunk_ts.data(), fits);
+          }
+          if(fits < samples)
+            ring_overflows.fetch_add(samples - fits);
+          auto now=std::chrono::steady_clock::now();
+          if(now-last_correction>std::chrono::seconds(5)){
+            time_correction.store(stream.time_correction());
+            last_correction=now;
+          }
+        }
+      }
+      // If the stream is recoverable, lsl does not throw, instead tries to
+      // recover.
+      // Handle any other exception as a permanent underrun
+      catch (...) {
+        receiver_failed.store(true);
+      }
+    };
+    /** Move samples from the ring into the AC variable buffers without any
+     * LSL call. Leaves the buffers in the same state as pull_samples_ignore()
+     * (Ignore: oldest waiting samples) or pull_samples_discard() (Discard:
+     * newest samples, older samples are removed from the ring). */
+    void read_ring() {
+      if(receiver_failed.load()){
+        n_new_samples = 0;
+        skip = true;
+        return;
+      }
+      const std::size_t capacity = bufsize / nchannels;
+      std::size_t available = ts_ring->get_fill_count();
+      n_new_samples = (ob == overrun_behavior::Discard)
+        ? available : std::min(available, capacity);
+      if(ob == overrun_behavior::Discard){
+        while(available > capacity){
+          std::size_t drop = std::min(available - capacity, capacity);
+          ring->read(buf.data(), drop * nchannels);
+          ts_ring->read(ts_buf.data(), drop);
+          available -= drop;
+        }
+      }
+      std::size_t n = std::min(available, capacity);
+      ring->read(buf.data(), n * nchannels);
+      ts_ring->read(ts_buf.data(), n);
+      double newest = n ? ts_buf[n-1] : 0.0;
+      if (n < capacity and nsamples != 0) {
+        std::rotate(buf.begin(), buf.begin() + n * nchannels, buf.end());
+        std::rotate(ts_buf.begin(), ts_buf.begin() + n, ts_buf.end());
+      } else {
+        cv.num_entries = n * nchannels;
+        ts.num_entries = n;
+        tc.num_entries = n;
+      }
+      const double correction = time_correction.load();
+      std::fill(tc_buf.begin(), tc_buf.end(), correction);
+      if(n){
+        age = lsl::local_clock() - (newest + correction);
+        age_last.store(age);
+        if(age > age_max.load())
+          age_max.store(age);
+      }
+    };
     /** Pull new samples, ignore overrun. If nsamples=0, leaves the buffers in a state
      * where the newest samples are at the beginning of the buffers, the state of the older
      * samples is undefined and n_new_samples contains the number of new samples per channel.
@@ -288,6 +436,8 @@ namespace lsl2ac{
       ac.insert_var(ts_name.c_str(), ts);
       ac.insert_var(tc_name.c_str(), tc);
       ac.insert_var_int(new_name.c_str(), &n_new_samples);
+      if(ringsize)
+        ac.insert_var_double(age_name, &age);
     };
   };
 
@@ -494,6 +644,8 @@ namespace lsl2ac{
   class cfg_t {
     /** Maps variable name to unique ptr's of lsl to ac bridges. */
     std::map<std::string, std::unique_ptr<save_var_base_t>> varlist;
+    /** Stream names in configuration order */
+    const std::vector<std::string> streamnames;
   public:
     /** C'tor of lsl2ac run time configuration
      * @param ac_          AC space, data from LSL will be inserted as AC variables
@@ -503,14 +655,25 @@ namespace lsl2ac{
      * @param streamnames_ Names of LSL streams to be subscribed to
      * @param nchannels_   Number of channels to expect in the the LSL streams. Zero means accept any.
      * @param nsamples_    Number of samples per channel in the AC variable. Zero means resize as needed.
+     * @param ringsize_    Capacity of the receive ring of each stream in samples per channel.
+     *                     Zero means samples are pulled from LSL in the processing thread.
      */
     cfg_t(MHA_AC::algo_comm_t & ac_,
           overrun_behavior overrun_,
           int bufsize_, int chunksize_,
           const std::vector<std::string>& streamnames_,
           int nchannels_,
-          int nsamples_);
+          int nsamples_,
+          int ringsize_=0);
     void process();
+    /** Collect the receive statistics of all streams in configuration order.
+     * May be called from the configuration thread.
+     * @param ages        Receives the current age of each stream in seconds
+     * @param max_ages    Receives the maximum age of each stream in seconds
+     * @param overflows   Receives the number of samples per channel discarded
+     *                    by the receiver thread of each stream */
+    void get_stats(std::vector<float>& ages, std::vector<float>& max_ages,
+                   std::vector<int>& overflows) const;
 
   };
 
@@ -541,6 +704,9 @@ namespace lsl2ac{
      * @param lock_ True to lock, False for unlock
      */
     void setlock(bool lock_);
+    /** Copy the receive statistics of the current configuration to the
+     * monitor variables. */
+    void update_stats();
     /** Config variable for list of streams to be saved. */
     MHAParser::vstring_t streams={"List of LSL streams to be saved, empty for all.","[]"};
     /** Config variable for activation/deactivation of plugin. */
@@ -567,6 +733,27 @@ namespace lsl2ac{
         " Default means the AC variable will be resized as needed "
         " to accommodate the samples received, up to a maximum of chunksize.",
         "0", "[0,]"};
+    /** Config variable for the receiver threads */
+    MHAParser::bool_t receiver_thread = {
+        "Receive from LSL in a background thread per stream, so that the"
+        " processing thread only reads preallocated lock-free rings"
+        " (numeric streams only).", "no"};
+    /** Config variable for the size of the receive rings */
+    MHAParser::int_t ringsize = {
+        "Capacity of the receive ring of each stream in samples per channel"
+        " (receiver_thread=yes).", "4096", "[1,]"};
+    /** Monitor variable with the age of the newest samples */
+    MHAParser::vfloat_mon_t age = {
+        "Age in seconds of the newest sample of each stream published to AC"
+        " space in the last callback with new samples (receiver_thread=yes)."};
+    /** Monitor variable with the maximum age */
+    MHAParser::vfloat_mon_t max_age = {
+        "Maximum age in seconds of each stream since it was opened"
+        " (receiver_thread=yes)."};
+    /** Monitor variable with the ring overflows */
+    MHAParser::vint_mon_t ring_overflows = {
+        "Number of samples per channel of each stream discarded because the"
+        " receive ring was full (receiver_thread=yes)."};
     /** Patchbay for configuration callbacks. */
     MHAEvents::patchbay_t<lsl2ac_t> patchbay;
     /** Monitor variable containing all available streams. */
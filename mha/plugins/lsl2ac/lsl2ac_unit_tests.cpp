@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -54,7 +54,7 @@ namespace{
     return s;
   }
 }
-class Test_save_var_t : public TestWithParam<::std::tuple<lsl2ac::overrun_behavior,int,int> > {
+class Test_save_var_t : public TestWithParam<::std::tuple<lsl2ac::overrun_behavior,int,int,int> > {
 protected:
   Test_save_var_t():
     /*  We need to use a unique name for the stream as sometimes the lsl background process does not close the
@@ -93,7 +93,7 @@ protected:
     lsl2ac::overrun_behavior ob;
     int nchannels;
     int nsamples;
-    std::tie(ob,nchannels,nsamples)=GetParam();
+    std::tie(ob,nchannels,nsamples,ringsize)=GetParam();
     // Resolving and using that info is much faster than reusing the info from the outlet construction
     auto infos=lsl::resolve_stream("name",name);
     // Lambda trickery needed b/c fatal ASSERTions can only be placed in
@@ -103,7 +103,7 @@ protected:
     }();
     info=infos[0];
     var =  std::make_unique<lsl2ac::save_var_t<mha_real_t>>(info, ac, ob, MHA_AC_FLOAT, 1, 1, nchannels,
-                                             nsamples);
+                                             nsamples, ringsize);
   }
   ~Test_save_var_t(){
     var.reset();
@@ -113,6 +113,9 @@ protected:
   virtual void SetUp() override {
     while(!outlet_done)
       std::this_thread::sleep_for(0.01s);
+    // Give the receiver thread time to move the samples into its ring
+    if(ringsize)
+      std::this_thread::sleep_for(0.2s);
   }
   // Creates an outlet stream. Sends the samples as fast as possible once a
   // consumer connects. Synchronization through the atomic bools.
@@ -126,6 +129,7 @@ protected:
   lsl::stream_info info;
   MHA_AC::algo_comm_class_t acspace;
   MHA_AC::algo_comm_t & ac;
+  int ringsize = 0;
   std::vector<std::vector<float>> expected;
   std::unique_ptr<lsl2ac::save_var_base_t> var;
 };
@@ -159,7 +163,7 @@ using Test_save_var_t_fixed_size=Test_save_var_t;
 TEST_P(Test_save_var_t_fixed_size,ThrowOnWrongChannelNo){
   lsl2ac::overrun_behavior ob;
   int nchannels;
-  std::tie(ob, nchannels, std::ignore) = GetParam();
+  std::tie(ob, nchannels, std::ignore, std::ignore) = GetParam();
   /// Try to construct new save_var_t with wrong number of channels
   EXPECT_THROW(var.reset(new lsl2ac::save_var_t<mha_real_t>(info,ac,ob, MHA_AC_FLOAT, 1,1,nchannels+1,0)),MHA_Error);
 }
@@ -167,7 +171,8 @@ TEST_P(Test_save_var_t_fixed_size,ThrowOnWrongChannelNo){
 INSTANTIATE_TEST_SUITE_P(ThrowOnResize,Test_save_var_t_fixed_size,
                          Combine(Values(lsl2ac::overrun_behavior::Discard),
                                  Values(12),
-                                 Values(1)),
+                                 Values(1),
+                                 Values(0)),
                          [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
                            std::string name = to_string(std::get<0>(info.param));
                            return name;
@@ -176,6 +181,7 @@ INSTANTIATE_TEST_SUITE_P(ThrowOnResize,Test_save_var_t_fixed_size,
 INSTANTIATE_TEST_SUITE_P(ThrowOnWrongChannelNo,Test_save_var_t,
                          Combine(Values(lsl2ac::overrun_behavior::Discard),
                                  Values(12),
+                                 Values(0),
                                  Values(0)),
                          [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
                            std::string name = to_string(std::get<0>(info.param));
@@ -184,7 +190,7 @@ INSTANTIATE_TEST_SUITE_P(ThrowOnWrongChannelNo,Test_save_var_t,
 
 INSTANTIATE_TEST_SUITE_P(DiscardOverrun,Test_save_var_t_discard,
                          Combine(Values(lsl2ac::overrun_behavior::Discard),
-                                 Values(12),Values(0)),
+                                 Values(12),Values(0),Values(0)),
                          [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
                            std::string name = to_string(std::get<0>(info.param));
                            return name;
@@ -193,12 +199,53 @@ INSTANTIATE_TEST_SUITE_P(DiscardOverrun,Test_save_var_t_discard,
 INSTANTIATE_TEST_SUITE_P(IgnoreOverrun,Test_save_var_t_ignore,
                          Combine(Values(lsl2ac::overrun_behavior::Ignore),
                                  Values(12),
+                                 Values(0),
                                  Values(0)),
                          [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
                            std::string name = to_string(std::get<0>(info.param));
                            return name;
                          });
 
+using Test_save_var_t_receiver=Test_save_var_t;
+TEST_P(Test_save_var_t_receiver,PublishesAge){
+  var->receive_frame();
+  MHA_AC::comm_var_t age;
+  ASSERT_NO_THROW(age = ac.get_var(name+"_age"));
+  double value=*static_cast<double*>(age.data);
+  // Samples were sent before the 0.2s wait in SetUp
+  EXPECT_GT(value, 0.1);
+  EXPECT_LT(value, 10.0);
+  EXPECT_DOUBLE_EQ(value, var->get_age());
+  EXPECT_GE(var->get_max_age(), value);
+  EXPECT_EQ(0U, var->get_ring_overflows());
+}
+
+INSTANTIATE_TEST_SUITE_P(ReceiverThread,Test_save_var_t_receiver,
+                         Combine(Values(lsl2ac::overrun_behavior::Discard),
+                                 Values(12),Values(0),Values(64)),
+                         [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
+                           std::string name = to_string(std::get<0>(info.param));
+                           return name;
+                         });
+
+INSTANTIATE_TEST_SUITE_P(DiscardOverrunReceiverThread,Test_save_var_t_discard,
+                         Combine(Values(lsl2ac::overrun_behavior::Discard),
+                                 Values(12),Values(0),Values(64)),
+                         [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
+                           std::string name = to_string(std::get<0>(info.param));
+                           return name;
+                         });
+
+INSTANTIATE_TEST_SUITE_P(IgnoreOverrunReceiverThread,Test_save_var_t_ignore,
+                         Combine(Values(lsl2ac::overrun_behavior::Ignore),
+                                 Values(12),
+                                 Values(0),
+                                 Values(64)),
+                         [](const testing::TestParamInfo<Test_save_var_t::ParamType>& info) {
+                           std::string name = to_string(std::get<0>(info.param));
+                           return name;
+                         });
+
 
 template<lsl2ac::overrun_behavior ob>
 class Test_save_var_string_t : public ::testing::Test {
@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2010 2012 2013 2014 2015 2017 2018 2019 HörTech gGmbH
 // Copyright © 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,41 +15,165 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_signal.hh"
-#include "mha_defs.h"
-#include "mha_events.h"
+#include "matrixmixer.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace matrixmixer {
 
-class cfg_t {
-    public:
-        cfg_t(std::vector<std::vector<float> > imixer,
-              unsigned int ci,
-              unsigned int co,
-              unsigned int fragsize,
-          unsigned int nfft);
-    mha_wave_t* process(mha_wave_t*);
-    mha_spec_t* process(mha_spec_t*);
-private:
-    MHASignal::waveform_t m;
-    MHASignal::waveform_t wout;
-    MHASignal::spectrum_t sout;
-};
+namespace {
+    /** Accumulate NB output vectors of one frame over all input
+     * channels and store the first n floats to y. */
+    template <unsigned NB>
+    inline void mix_group(const v4_t * xv, unsigned ci,
+                          const v4_t * w, unsigned stride,
+                          mha_real_t * y, unsigned n)
+    {
+        v4_t acc[NB] = {};
+        for (unsigned ki = 0; ki < ci; ++ki, w += stride)
+            for (unsigned j = 0; j < NB; ++j)
+                acc[j] += xv[ki] * w[j];
+        std::memcpy(y, acc, std::min(n, 4U * NB) * sizeof(mha_real_t));
+    }
+}
+
+dense_t::dense_t(unsigned ci_, unsigned co_)
+    : ci(ci_),
+      co(co_),
+      wave_stride((co + 3U) / 4U),
+      wave_weights(ci * wave_stride, v4_t{}),
+      row_weights(ci * co, 0.0f),
+      xv(ci, v4_t{})
+{
+}
+
+void dense_t::assign(const matrix_t & m)
+{
+    for (unsigned ki = 0; ki < ci; ++ki) {
+        mha_real_t * w =
+            reinterpret_cast<mha_real_t*>(&wave_weights[ki * wave_stride]);
+        for (unsigned ko = 0; ko < co; ++ko)
+            w[ko] = row_weights[ko * ci + ki] = m[ko][ki];
+    }
+}
+
+void dense_t::assign(const dense_t & src)
+{
+    std::copy(src.wave_weights.begin(), src.wave_weights.end(),
+              wave_weights.begin());
+    std::copy(src.row_weights.begin(), src.row_weights.end(),
+              row_weights.begin());
+}
+
+void dense_t::interpolate(const dense_t & dst, mha_real_t g)
+{
+    for (unsigned k = 0; k < wave_weights.size(); ++k)
+        wave_weights[k] += g * (dst.wave_weights[k] - wave_weights[k]);
+    for (unsigned k = 0; k < row_weights.size(); ++k)
+        row_weights[k] += g * (dst.row_weights[k] - row_weights[k]);
+}
+
+mha_real_t dense_t::weight(unsigned ki, unsigned ko) const
+{
+    return wave_weights[ki * wave_stride + ko / 4U][ko % 4U];
+}
+
+void dense_t::mix_frame(const v4_t * w, unsigned stride,
+                        mha_real_t * y, unsigned n) const
+{
+    // four vectors per group keep the accumulators in registers
+    unsigned b = 0;
+    for (; b + 4U <= stride; b += 4U, y += 16U, n -= std::min(n, 16U))
+        mix_group<4>(xv.data(), ci, w + b, stride, y, n);
+    switch (stride - b) {
+    case 3: mix_group<3>(xv.data(), ci, w + b, stride, y, n); break;
+    case 2: mix_group<2>(xv.data(), ci, w + b, stride, y, n); break;
+    case 1: mix_group<1>(xv.data(), ci, w + b, stride, y, n); break;
+    }
+}
+
+void dense_t::process(const mha_wave_t & s, mha_wave_t & y)
+{
+    for (unsigned kfr = 0; kfr < s.num_frames; ++kfr) {
+        const mha_real_t * x = s.buf + kfr * ci;
+        for (unsigned ki = 0; ki < ci; ++ki)
+            xv[ki] = MHASimd::broadcast(x[ki]);
+        mix_frame(wave_weights.data(), wave_stride, y.buf + kfr * co, co);
+    }
+}
+
+void dense_t::process(const mha_spec_t & s, mha_spec_t & y)
+{
+    // Spectra are stored channel by channel: one output channel is a
+    // weighted sum of whole input channels, viewed as arrays of floats.
+    const unsigned n = 2U * s.num_frames;
+    for (unsigned ko = 0; ko < co; ++ko) {
+        const mha_real_t * w = &row_weights[ko * ci];
+        mha_real_t * out = &y.buf[ko * y.num_frames].re;
+        unsigned k = 0;
+        for (; k + 16U <= n; k += 16U) {
+            v4_t acc[4] = {};
+            for (unsigned ki = 0; ki < ci; ++ki) {
+                const mha_real_t * x = &s.buf[ki * s.num_frames].re + k;
+                for (unsigned j = 0; j < 4U; ++j)
+                    acc[j] += w[ki] * MHASimd::load(x + 4U * j);
+            }
+            for (unsigned j = 0; j < 4U; ++j)
+                MHASimd::store(out + k + 4U * j, acc[j]);
+        }
+        for (; k < n; ++k) {
+            mha_real_t acc = 0;
+            for (unsigned ki = 0; ki < ci; ++ki)
+                acc += w[ki] * (&s.buf[ki * s.num_frames].re)[k];
+            out[k] = acc;
+        }
+    }
+}
+
+sparse_t::sparse_t(const matrix_t & m)
+    : ci(m.empty() ? 0U : m[0].size()),
+      row_start(1U, 0U)
+{
+    for (const auto & row : m) {
+        for (unsigned ki = 0; ki < row.size(); ++ki)
+            if (row[ki] != 0) {
+                inputs.push_back(ki);
+                outputs.push_back(row_start.size() - 1U);
+                weights.push_back(row[ki]);
+            }
+        row_start.push_back(weights.size());
+    }
+}
+
+void sparse_t::process(const mha_wave_t & s, mha_wave_t & y) const
+{
+    const unsigned co = row_start.size() - 1U;
+    const unsigned nnz = weights.size();
+    for (unsigned kfr = 0; kfr < s.num_frames; ++kfr) {
+        const mha_real_t * x = s.buf + kfr * ci;
+        mha_real_t * out = y.buf + kfr * co;
+        std::fill(out, out + co, 0.0f);
+        for (unsigned k = 0; k < nnz; ++k)
+            out[outputs[k]] += x[inputs[k]] * weights[k];
+    }
+}
 
-class matmix_t : public MHAPlugin::plugin_t<cfg_t> {
-public:
-    matmix_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-    void prepare(mhaconfig_t&);
-    mha_wave_t* process(mha_wave_t*);
-    mha_spec_t* process(mha_spec_t*);
-private:
-    void update_m();
-    MHAEvents::patchbay_t<matmix_t> patchbay;
-    MHAParser::mfloat_t mixer;
-    unsigned int ci;
-    unsigned int co;
-};
+void sparse_t::process(const mha_spec_t & s, mha_spec_t & y) const
+{
+    const unsigned co = row_start.size() - 1U;
+    const unsigned n = 2U * s.num_frames;
+    for (unsigned ko = 0; ko < co; ++ko) {
+        mha_real_t * out = &y.buf[ko * y.num_frames].re;
+        std::fill(out, out + n, 0.0f);
+        for (unsigned k = row_start[ko]; k < row_start[ko + 1]; ++k) {
+            const mha_real_t * x = &s.buf[inputs[k] * s.num_frames].re;
+            const mha_real_t w = weights[k];
+            for (unsigned f = 0; f < n; ++f)
+                out[f] += w * x[f];
+        }
+    }
+}
 
 matmix_t::matmix_t(MHA_AC::algo_comm_t & iac, const std::string &)
     : MHAPlugin::plugin_t<cfg_t>("Matrix mixer plugin, can mix multiple input"
@@ -59,11 +183,18 @@ matmix_t::matmix_t(MHA_AC::algo_comm_t & iac, const std::string &)
       mixer("Mixer matrix, one row vector for each output channel.\n"
             "The number of columns must match the number of input channels.",
             "[[1 0];[0 1]]"),
+      ramplen("Length of hanning ramp at matrix changes in seconds","0","[0,]"),
       ci(0),
-      co(0)
+      co(0),
+      active(nullptr),
+      fade_from(0,0),
+      fade_to(0,0),
+      fade_pos(0)
 {
     insert_item("m",&mixer);
+    insert_item("ramplen",&ramplen);
     patchbay.connect(&mixer.writeaccess,this,&matmix_t::update_m);
+    patchbay.connect(&ramplen.writeaccess,this,&matmix_t::update_m);
 }
 
 void matmix_t::prepare(mhaconfig_t& tf)
@@ -76,75 +207,140 @@ void matmix_t::prepare(mhaconfig_t& tf)
                         ci,tf.channels);
     tf.channels = co;
     tftype = tf;
+    active = nullptr;
+    fade_from = dense_t(ci,co);
+    fade_to = dense_t(ci,co);
     update_m();
 }
 
-mha_wave_t* matmix_t::process(mha_wave_t* s)
+void matmix_t::poll_and_fade()
 {
+    // Read the state of the running crossfade before polling: once a
+    // newer configuration is polled, the previous one is released and
+    // may be deleted by the configuration thread at any time.
+    bool fade_done = true;
+    mha_real_t fade_gain = 0;
+    if( active ){
+        const std::vector<mha_real_t> & ramp = active->get_ramp();
+        fade_done = fade_pos >= ramp.size();
+        if( !fade_done && fade_pos > 0 )
+            fade_gain = ramp[fade_pos-1];
+    }
+    cfg_t * previous = active;
     poll_config();
-    return cfg->process(s);
+    if( cfg == previous )
+        return;
+    if( previous ){
+        // The matrix currently in effect is the start of the new
+        // crossfade, also when the previous one has not finished.
+        if( fade_done )
+            fade_from.assign(fade_to);
+        else if( fade_pos > 0 )
+            fade_from.interpolate(fade_to,fade_gain);
+        fade_pos = 0;
+    }else{
+        fade_from.assign(cfg->get_dense());
+        fade_pos = cfg->get_ramp().size();
+    }
+    fade_to.assign(cfg->get_dense());
+    active = cfg;
+}
+
+mha_wave_t* matmix_t::process(mha_wave_t* s)
+{
+    poll_and_fade();
+    mha_wave_t* y = cfg->process(s);
+    if( fade_pos < cfg->get_ramp().size() )
+        cfg->crossfade(*s,fade_from,fade_pos);
+    return y;
 }
 
 mha_spec_t* matmix_t::process(mha_spec_t* s)
 {
-    poll_config();
-    return cfg->process(s);
+    poll_and_fade();
+    mha_spec_t* y = cfg->process(s);
+    if( fade_pos < cfg->get_ramp().size() )
+        cfg->crossfade(*s,fade_from,fade_pos);
+    return y;
 }
 
-mha_wave_t* cfg_t::process(mha_wave_t* s)
+void cfg_t::check_dimensions(unsigned num_frames, unsigned num_channels,
+                             unsigned expected_frames) const
 {
-    unsigned int ki,ko,kfr;
-    if( s->num_frames != wout.num_frames )
+    if( num_frames != expected_frames )
         throw MHA_Error(__FILE__,__LINE__,
                         "matrixmixer: Invalid input fragment size (%u, expected %u).",
-                        s->num_frames,wout.num_frames);
-    if( s->num_channels != m.num_frames )
+                        num_frames,expected_frames);
+    if( num_channels != dense.inputs() )
         throw MHA_Error(__FILE__,__LINE__,
                         "matrixmixer: Invalid input channel count (%u, expected %u).",
-                        s->num_channels,m.num_frames);
-    clear(wout);
-    for(ko=0; ko<m.num_channels; ko++)
-        for(ki=0; ki<m.num_frames; ki++)
-            if( m(ki,ko) != 0 )
-                for(kfr=0; kfr<wout.num_frames;kfr++)
-                    wout(kfr,ko) += value(s,kfr,ki) * m(ki,ko);
+                        num_channels,dense.inputs());
+}
+
+mha_wave_t* cfg_t::process(mha_wave_t* s)
+{
+    check_dimensions(s->num_frames,s->num_channels,wout.num_frames);
+    if( sparse_selected )
+        sparse.process(*s,wout);
+    else
+        dense.process(*s,wout);
     return &wout;
 }
 
 mha_spec_t* cfg_t::process(mha_spec_t* s)
 {
-    mha_complex_t temp;
-    unsigned int ki,ko,kfr;
-    if( s->num_frames != sout.num_frames )
-        throw MHA_Error(__FILE__,__LINE__,
-                        "matrixmixer: Invalid input fragment size (%u, expected %u).",
-                        s->num_frames,wout.num_frames);
-    if( s->num_channels != m.num_frames )
-        throw MHA_Error(__FILE__,__LINE__,
-                        "matrixmixer: Invalid input channel count (%u, expected %u).",
-                        s->num_channels,m.num_frames);
-    clear(sout);
-    for(ko=0; ko<m.num_channels; ko++)
-        for(ki=0; ki<m.num_frames; ki++)
-            if( m(ki,ko) != 0 )
-                for(kfr=0; kfr<sout.num_frames;kfr++){
-        temp = value(s,kfr,ki);
-        temp *= m(ki,ko);
-                    sout(kfr,ko) += temp;
-    }
+    check_dimensions(s->num_frames,s->num_channels,sout.num_frames);
+    if( sparse_selected )
+        sparse.process(*s,sout);
+    else
+        dense.process(*s,sout);
     return &sout;
 }
 
-cfg_t::cfg_t(std::vector<std::vector<float> > imixer,
+void cfg_t::crossfade(const mha_wave_t & s, dense_t & from, unsigned & pos)
+{
+    from.process(s,fade_wout);
+    const unsigned last = ramp.size()-1;
+    for(unsigned kfr=0; kfr<wout.num_frames; kfr++){
+        const mha_real_t g = ramp[std::min(pos+kfr,last)];
+        for(unsigned ko=0; ko<wout.num_channels; ko++){
+            const mha_real_t a = fade_wout(kfr,ko);
+            wout(kfr,ko) = a + g * (wout(kfr,ko) - a);
+        }
+    }
+    pos = std::min(pos+wout.num_frames,last+1);
+}
+
+void cfg_t::crossfade(const mha_spec_t & s, dense_t & from, unsigned & pos)
+{
+    from.process(s,fade_sout);
+    const unsigned last = ramp.size()-1;
+    // one gain for the block, the one of its last sample
+    const mha_real_t g = ramp[std::min(pos+wout.num_frames-1,last)];
+    for(unsigned k=0; k<sout.num_frames*sout.num_channels; k++){
+        const mha_complex_t a = fade_sout.buf[k];
+        sout.buf[k].re = a.re + g * (sout.buf[k].re - a.re);
+        sout.buf[k].im = a.im + g * (sout.buf[k].im - a.im);
+    }
+    pos = std::min(pos+wout.num_frames,last+1);
+}
+
+cfg_t::cfg_t(const matrix_t & imixer,
              unsigned int ci,
              unsigned int co,
              unsigned int fragsize,
-             unsigned int nfft)
-    : m(ci,co),
+             unsigned int nfft,
+             unsigned int ramplen)
+    : dense(ci,co),
+      sparse(imixer),
+      sparse_selected(false),
+      ramp(ramplen),
       wout(fragsize,co),
-      sout(nfft/2+1,co)
+      sout(nfft/2+1,co),
+      fade_wout(fragsize,co),
+      fade_sout(nfft/2+1,co)
 {
-    unsigned int ki, ko;
+    unsigned int ko;
     if( co != imixer.size() ){
         throw MHA_Error(__FILE__,__LINE__,
                         "Mismatching number of input channels (co:%u, m:%zu).",
@@ -156,9 +352,13 @@ cfg_t::cfg_t(std::vector<std::vector<float> > imixer,
                             "Mismatching number of input channels (ci:%u, m[%u]:%zu).",
                             ci,ko,imixer[ko].size());
         }
-    for(ko=0;ko<co;ko++)
-        for(ki=0;ki<ci;ki++)
-            m(ki,ko) = imixer[ko][ki];
+    dense.assign(imixer);
+    // One scalar multiply-add per nonzero weight in the sparse kernel
+    // costs about three times as much as one vector multiply-add per
+    // four weights in the dense kernel.
+    sparse_selected = 3U * sparse.nonzeros() <= ci * ((co + 3U) / 4U);
+    for(unsigned k=0; k<ramplen; k++)
+        ramp[k] = 0.5f - 0.5f * cosf(M_PI * (k + 1) / ramplen);
 }
 
 void matmix_t::update_m(void)
@@ -172,7 +372,8 @@ void matmix_t::update_m(void)
         lci = ci;
         lco = co;
     }
-    push_config(new cfg_t(mixer.data,lci,lco,tftype.fragsize,tftype.fftlen));
+    push_config(new cfg_t(mixer.data,lci,lco,tftype.fragsize,tftype.fftlen,
+                          (unsigned)(tftype.srate*ramplen.data+0.5f)));
 }
 
 }
@@ -245,6 +446,17 @@ MHAPLUGIN_DOCUMENTATION\
  "receives input channels, and as many rows as you want \\texttt{matrixmixer} "
  "to produce output channels."
  "\n\n"
+ "When the matrix is changed during processing, the new weights take "
+ "effect immediately.  Setting \\texttt{ramplen} to a duration in seconds "
+ "crossfades from the previous to the new matrix with a hanning ramp "
+ "instead.  A change during a running crossfade starts a new crossfade "
+ "from the weights in effect at that moment.  "
+ "In the spectral domain, the crossfade gain changes once per block."
+ "\n\n"
+ "Matrices with few nonzero weights, like pure routing matrices, are "
+ "processed with a sparse kernel which only visits the nonzero weights.  "
+ "The kernel is selected automatically whenever the matrix is changed."
+ "\n\n"
  "Example configurations and example input files are contained in the "
  "matrixmixer examples directory.  "
  "Please refer to the README file in this directory for an explanation of "
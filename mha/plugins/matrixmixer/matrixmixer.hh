@@ -0,0 +1,186 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2005 2006 2010 2012 2013 2014 2015 2017 2018 2019 HörTech gGmbH
+// Copyright © 2020 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_plugin.hh"
+#include "mha_signal.hh"
+#include "mha_defs.h"
+#include "mha_events.h"
+#include "mha_simd.hh"
+
+namespace matrixmixer {
+
+    using MHASimd::v4_t;
+
+    typedef std::vector<std::vector<float> > matrix_t;
+
+    /** Dense mixing kernel.  For interleaved waveforms, the weights are
+     * stored input-major: for each input channel, the weights towards
+     * all output channels are packed into consecutive 4-float vectors,
+     * so that one frame of output is the sum over the input channels
+     * of a broadcast input sample times one row of weight vectors.
+     * Spectra are stored channel by channel, there each output channel
+     * is the sum of whole input channels times one broadcast weight.
+     * In both cases, output vectors are accumulated in registers in
+     * groups of four. */
+    class dense_t {
+    public:
+        /** Create a zero matrix.
+         * @param ci Number of input channels
+         * @param co Number of output channels */
+        dense_t(unsigned ci, unsigned co);
+        /** Set all weights.
+         * @param m Mixer matrix, one row for each output channel */
+        void assign(const matrix_t & m);
+        /** Set all weights to a copy of those of another kernel of the
+         * same dimensions.  Does not allocate memory. */
+        void assign(const dense_t & src);
+        /** Move the weights towards those of another kernel of the
+         * same dimensions, w += g * (dst.w - w).  Does not allocate. */
+        void interpolate(const dense_t & dst, mha_real_t g);
+        /** Number of input channels */
+        unsigned inputs() const {return ci;}
+        /** Weight from input channel ki to output channel ko */
+        mha_real_t weight(unsigned ki, unsigned ko) const;
+        /** Mix input waveform s into output waveform y */
+        void process(const mha_wave_t & s, mha_wave_t & y);
+        /** Mix input spectrum s into output spectrum y */
+        void process(const mha_spec_t & s, mha_spec_t & y);
+    private:
+        /** Compute the n floats of one output frame y from the
+         * broadcast input samples in xv and weight rows w with stride
+         * vectors per input channel */
+        void mix_frame(const v4_t * w, unsigned stride,
+                       mha_real_t * y, unsigned n) const;
+        unsigned ci;
+        unsigned co;
+        /// Number of weight vectors per input channel, waveform layout
+        unsigned wave_stride;
+        /// Weights, each weight in one float
+        std::vector<v4_t> wave_weights;
+        /// Weights, output-major, for spectra
+        std::vector<mha_real_t> row_weights;
+        /// Broadcast input samples of the current frame
+        std::vector<v4_t> xv;
+    };
+
+    /** Sparse mixing kernel for routing-like matrices.  Stores only the
+     * nonzero weights in compressed sparse row format, one row for each
+     * output channel.  The entries carry their output channel, so that
+     * one waveform frame is mixed in a single loop over all entries. */
+    class sparse_t {
+    public:
+        /** @param m Mixer matrix, one row for each output channel */
+        explicit sparse_t(const matrix_t & m);
+        /** Number of nonzero weights */
+        unsigned nonzeros() const {return weights.size();}
+        /** Mix input waveform s into output waveform y */
+        void process(const mha_wave_t & s, mha_wave_t & y) const;
+        /** Mix input spectrum s into output spectrum y */
+        void process(const mha_spec_t & s, mha_spec_t & y) const;
+    private:
+        unsigned ci;
+        /// Index of the first entry of each output channel, co+1 entries
+        std::vector<unsigned> row_start;
+        /// Output channel of each entry
+        std::vector<unsigned> outputs;
+        /// Input channel of each entry
+        std::vector<unsigned> inputs;
+        /// Weight of each entry
+        std::vector<mha_real_t> weights;
+    };
+
+    /** Runtime configuration of the matrix mixer.  Selects the sparse
+     * kernel when at most one in twelve weights is nonzero. */
+    class cfg_t {
+    public:
+        cfg_t(const matrix_t & imixer,
+              unsigned int ci,
+              unsigned int co,
+              unsigned int fragsize,
+              unsigned int nfft,
+              unsigned int ramplen = 0U);
+        mha_wave_t* process(mha_wave_t*);
+        mha_spec_t* process(mha_spec_t*);
+        /** True if the sparse kernel is used */
+        bool is_sparse() const {return sparse_selected;}
+        /** Dense representation of the mixer matrix */
+        const dense_t & get_dense() const {return dense;}
+        /** Crossfade ramp towards this configuration, one gain per
+         * sample, ending with 1.  Empty if matrix changes are not
+         * crossfaded. */
+        const std::vector<mha_real_t> & get_ramp() const {return ramp;}
+        /** Crossfade the output of the preceding process() call from
+         * the output of another matrix, one ramp gain per sample.
+         * @param s Input signal of the preceding process() call
+         * @param from Matrix at the start of the crossfade
+         * @param pos Position in the ramp, advanced by the block length */
+        void crossfade(const mha_wave_t & s, dense_t & from, unsigned & pos);
+        /** Crossfade the output of the preceding process() call from
+         * the output of another matrix, one ramp gain per block.
+         * @param s Input signal of the preceding process() call
+         * @param from Matrix at the start of the crossfade
+         * @param pos Position in the ramp, advanced by the block length */
+        void crossfade(const mha_spec_t & s, dense_t & from, unsigned & pos);
+    private:
+        void check_dimensions(unsigned num_frames, unsigned num_channels,
+                              unsigned expected_frames) const;
+        dense_t dense;
+        sparse_t sparse;
+        bool sparse_selected;
+        std::vector<mha_real_t> ramp;
+        MHASignal::waveform_t wout;
+        MHASignal::spectrum_t sout;
+        /// Output of the matrix at the start of a crossfade
+        MHASignal::waveform_t fade_wout;
+        MHASignal::spectrum_t fade_sout;
+    };
+
+    class matmix_t : public MHAPlugin::plugin_t<cfg_t> {
+    public:
+        matmix_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
+        void prepare(mhaconfig_t&);
+        mha_wave_t* process(mha_wave_t*);
+        mha_spec_t* process(mha_spec_t*);
+    private:
+        void update_m();
+        /** Poll for a new runtime configuration.  When the matrix has
+         * changed, start a crossfade from the currently effective
+         * matrix. */
+        void poll_and_fade();
+        MHAEvents::patchbay_t<matmix_t> patchbay;
+        MHAParser::mfloat_t mixer;
+        MHAParser::float_t ramplen;
+        unsigned int ci;
+        unsigned int co;
+        /// Configuration in use by the signal processing
+        cfg_t * active;
+        /// Matrix at the start of the current crossfade
+        dense_t fade_from;
+        /// Copy of the matrix of the active configuration
+        dense_t fade_to;
+        /// Samples of the current crossfade already processed
+        unsigned fade_pos;
+    };
+
+}
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
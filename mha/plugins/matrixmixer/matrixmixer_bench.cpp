@@ -0,0 +1,112 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the dense and sparse mixing kernels with the loops of the
+// original implementation, 32 channels.
+
+#include "matrixmixer.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+using namespace matrixmixer;
+
+namespace {
+    /// Matrix with co rows and ci columns of reproducible weights,
+    /// every sparsity-th weight nonzero
+    matrix_t test_matrix(unsigned ci, unsigned co, unsigned sparsity = 1) {
+        matrix_t m(co, std::vector<float>(ci, 0.0f));
+        for (unsigned ko = 0; ko < co; ++ko)
+            for (unsigned ki = 0; ki < ci; ++ki)
+                if ((ko * ci + ki) % sparsity == 0)
+                    m[ko][ki] = std::sin(1.0f + ko * 0.7f + ki * 0.3f);
+        return m;
+    }
+
+    /// Routing matrix: output channel ko is input channel (ko+1)%n
+    matrix_t routing_matrix(unsigned n) {
+        matrix_t m(n, std::vector<float>(n, 0.0f));
+        for (unsigned ko = 0; ko < n; ++ko)
+            m[ko][(ko + 1) % n] = 1.0f;
+        return m;
+    }
+
+    MHASignal::waveform_t test_signal(unsigned frames, unsigned channels) {
+        MHASignal::waveform_t s(frames, channels);
+        for (unsigned k = 0; k < frames * channels; ++k)
+            s.buf[k] = std::cos(0.37f * k);
+        return s;
+    }
+}
+
+int main()
+{
+    const unsigned channels = 32, frames = 64, blocks = 20000;
+    MHASignal::waveform_t s = test_signal(frames, channels);
+    auto measure = [&](auto && process) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned b = 0; b < blocks; ++b)
+            process();
+        std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        return t.count() / blocks * 1e6;
+    };
+    for (const matrix_t & m : {test_matrix(channels, channels),
+                               routing_matrix(channels)}) {
+        cfg_t cfg(m, channels, channels, frames, 2 * frames);
+        MHASignal::waveform_t y(frames, channels);
+        const double t_ref = measure([&]{
+            clear(y);
+            for (unsigned ko = 0; ko < channels; ++ko)
+                for (unsigned ki = 0; ki < channels; ++ki)
+                    if (m[ko][ki] != 0)
+                        for (unsigned k = 0; k < frames; ++k)
+                            y(k, ko) += s(k, ki) * m[ko][ki];
+        });
+        const double t_cfg = measure([&]{cfg.process(&s);});
+        std::cout << (cfg.is_sparse() ? "routing" : "dense") << " "
+                  << channels << "x" << channels << ", " << frames
+                  << " frames: loops " << t_ref << " us/block, kernel "
+                  << t_cfg << " us/block (speedup " << t_ref / t_cfg
+                  << ")" << std::endl;
+        MHASignal::spectrum_t x(frames + 1, channels), z(frames + 1, channels);
+        for (unsigned k = 0; k < x.num_frames * channels; ++k)
+            x.buf[k] = {s.buf[k % (frames * channels)], 0.5f};
+        const double t_ref_spec = measure([&]{
+            clear(z);
+            for (unsigned ko = 0; ko < channels; ++ko)
+                for (unsigned ki = 0; ki < channels; ++ki)
+                    if (m[ko][ki] != 0)
+                        for (unsigned k = 0; k < x.num_frames; ++k) {
+                            mha_complex_t temp = x(k, ki);
+                            temp *= m[ko][ki];
+                            z(k, ko) += temp;
+                        }
+        });
+        const double t_cfg_spec = measure([&]{cfg.process(&x);});
+        std::cout << "  spectrum, " << x.num_frames << " bins: loops "
+                  << t_ref_spec << " us/block, kernel " << t_cfg_spec
+                  << " us/block (speedup " << t_ref_spec / t_cfg_spec
+                  << ")" << std::endl;
+    }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
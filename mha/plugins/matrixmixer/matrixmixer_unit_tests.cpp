@@ -0,0 +1,189 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "matrixmixer.hh"
+#include "mha_algo_comm.hh"
+#include <cmath>
+
+using namespace matrixmixer;
+
+namespace {
+    /// Matrix with co rows and ci columns of reproducible weights,
+    /// every sparsity-th weight nonzero
+    matrix_t test_matrix(unsigned ci, unsigned co, unsigned sparsity = 1) {
+        matrix_t m(co, std::vector<float>(ci, 0.0f));
+        for (unsigned ko = 0; ko < co; ++ko)
+            for (unsigned ki = 0; ki < ci; ++ki)
+                if ((ko * ci + ki) % sparsity == 0)
+                    m[ko][ki] = std::sin(1.0f + ko * 0.7f + ki * 0.3f);
+        return m;
+    }
+
+    /// Routing matrix: output channel ko is input channel (ko+1)%n
+    matrix_t routing_matrix(unsigned n) {
+        matrix_t m(n, std::vector<float>(n, 0.0f));
+        for (unsigned ko = 0; ko < n; ++ko)
+            m[ko][(ko + 1) % n] = 1.0f;
+        return m;
+    }
+
+    /// Mix like the original matrixmixer loops
+    MHASignal::waveform_t reference(const matrix_t & m,
+                                    const mha_wave_t & s) {
+        MHASignal::waveform_t y(s.num_frames, m.size());
+        for (unsigned ko = 0; ko < m.size(); ++ko)
+            for (unsigned ki = 0; ki < s.num_channels; ++ki)
+                if (m[ko][ki] != 0)
+                    for (unsigned k = 0; k < s.num_frames; ++k)
+                        y(k, ko) += value(s, k, ki) * m[ko][ki];
+        return y;
+    }
+
+    MHASignal::waveform_t test_signal(unsigned frames, unsigned channels) {
+        MHASignal::waveform_t s(frames, channels);
+        for (unsigned k = 0; k < frames * channels; ++k)
+            s.buf[k] = std::cos(0.37f * k);
+        return s;
+    }
+}
+
+TEST(matrixmixer_cfg_t, dense_and_sparse_kernels_match_reference)
+{
+    for (unsigned co : {1U, 2U, 3U, 5U, 17U, 32U})
+        for (unsigned sparsity : {1U, 7U, 40U}) {
+            const unsigned ci = 3, frames = 9;
+            const matrix_t m = test_matrix(ci, co, sparsity);
+            cfg_t cfg(m, ci, co, frames, 2 * (frames - 1));
+            MHASignal::waveform_t s = test_signal(frames, ci);
+            MHASignal::waveform_t expected = reference(m, s);
+            mha_wave_t * y = cfg.process(&s);
+            ASSERT_EQ(co, y->num_channels);
+            for (unsigned k = 0; k < frames * co; ++k)
+                EXPECT_NEAR(expected.buf[k], y->buf[k], 1e-6f)
+                    << "co=" << co << " sparsity=" << sparsity << " k=" << k;
+            // spectrum: real parts from s, imaginary parts from -2s
+            MHASignal::spectrum_t spec(frames, ci);
+            for (unsigned k = 0; k < frames; ++k)
+                for (unsigned ki = 0; ki < ci; ++ki)
+                    spec(k, ki) = {s(k, ki), -2 * s(k, ki)};
+            mha_spec_t * z = cfg.process(&spec);
+            for (unsigned k = 0; k < frames; ++k)
+                for (unsigned ko = 0; ko < co; ++ko) {
+                    EXPECT_NEAR(expected(k, ko), value(z, k, ko).re, 1e-6f);
+                    EXPECT_NEAR(-2 * expected(k, ko), value(z, k, ko).im,
+                                1e-5f);
+                }
+            if (sparsity != 7U) {
+                EXPECT_EQ(sparsity == 40U, cfg.is_sparse());
+            }
+        }
+}
+
+TEST(matrixmixer_cfg_t, routing_matrix_selects_sparse_kernel)
+{
+    EXPECT_TRUE(cfg_t(routing_matrix(32), 32, 32, 64, 128).is_sparse());
+    EXPECT_FALSE(cfg_t(test_matrix(32, 32), 32, 32, 64, 128).is_sparse());
+    EXPECT_FALSE(cfg_t(routing_matrix(2), 2, 2, 64, 128).is_sparse());
+}
+
+TEST(matrixmixer_cfg_t, rejects_wrong_dimensions)
+{
+    EXPECT_THROW(cfg_t(test_matrix(2, 3), 2, 2, 4, 8), MHA_Error);
+    EXPECT_THROW(cfg_t(test_matrix(2, 3), 3, 3, 4, 8), MHA_Error);
+    cfg_t cfg(test_matrix(2, 3), 2, 3, 4, 8);
+    MHASignal::waveform_t wrong_frames(5, 2), wrong_channels(4, 3);
+    EXPECT_THROW(cfg.process(&wrong_frames), MHA_Error);
+    EXPECT_THROW(cfg.process(&wrong_channels), MHA_Error);
+}
+
+class matrixmixer_testing : public ::testing::Test {
+public:
+    MHA_AC::algo_comm_class_t acspace{};
+    MHA_AC::algo_comm_t & ac {acspace};
+    mhaconfig_t signal_properties = {
+        .channels = 2, .domain = MHA_WAVEFORM, .fragsize = 10,
+        .wndlen = 0, .fftlen = 0, .srate = 1000
+    };
+    matmix_t mixer{ac, "matrixmixer"};
+    /// constant input: 1 in the first, 0 in the second channel
+    MHASignal::waveform_t input{10, 2};
+    /// Process one block and return the first output channel
+    std::vector<mha_real_t> process_block() {
+        mha_wave_t * y = mixer.process(&input);
+        std::vector<mha_real_t> out;
+        for (unsigned k = 0; k < y->num_frames; ++k)
+            out.push_back(value(y, k, 0));
+        return out;
+    }
+    void SetUp() override {
+        for (unsigned k = 0; k < input.num_frames; ++k)
+            input(k, 0) = 1.0f;
+    }
+};
+
+TEST_F(matrixmixer_testing, matrix_changes_are_crossfaded)
+{
+    mixer.parse("ramplen = 0.024"); // 24 samples
+    mixer.prepare_(signal_properties);
+    EXPECT_EQ(std::vector<mha_real_t>(10, 1.0f), process_block());
+    mixer.parse("m = [[0 1];[1 0]]");
+    std::vector<mha_real_t> out;
+    for (unsigned block = 0; block < 3; ++block)
+        for (mha_real_t v : process_block())
+            out.push_back(v);
+    // first output fades from input channel 0 to input channel 1
+    ASSERT_EQ(30U, out.size());
+    EXPECT_GT(out[0], 0.99f);
+    for (unsigned k = 1; k < 24; ++k)
+        EXPECT_LT(out[k], out[k - 1]) << k;
+    EXPECT_NEAR(0.5f, out[11], 1e-6f);
+    for (unsigned k = 23; k < 30; ++k)
+        EXPECT_EQ(0.0f, out[k]);
+    mixer.release_();
+}
+
+TEST_F(matrixmixer_testing, change_during_crossfade_starts_from_current_matrix)
+{
+    mixer.parse("ramplen = 0.04"); // 40 samples
+    mixer.prepare_(signal_properties);
+    process_block();
+    mixer.parse("m = [[0 1];[1 0]]");
+    const mha_real_t last = process_block().back();
+    EXPECT_GT(last, 0.8f);
+    EXPECT_LT(last, 0.95f);
+    // back to the identity while the first crossfade is running: no jump
+    mixer.parse("m = [[1 0];[0 1]]");
+    const std::vector<mha_real_t> out = process_block();
+    EXPECT_NEAR(last, out[0], 0.01f);
+    EXPECT_GT(out[9], out[0]);
+    mixer.release_();
+}
+
+TEST_F(matrixmixer_testing, changes_without_ramp_apply_immediately)
+{
+    mixer.prepare_(signal_properties);
+    process_block();
+    mixer.parse("m = [[0.5 1];[1 0]]");
+    EXPECT_EQ(std::vector<mha_real_t>(10, 0.5f), process_block());
+    mixer.release_();
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
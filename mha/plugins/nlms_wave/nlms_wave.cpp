@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2008 2010 2012 2013 2014 2015 2016 2017 2018 2020 HörTech gGmbH
 // Copyright © 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,94 +15,7 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "mha_plugin.hh"
-#include "mha_events.h"
-
-// add normalization types in string list and in the definitions:
-#define NORMALIZATION_TYPES "[none default sum]"
-#define NORM_NONE 0
-#define NORM_DEFAULT 1
-#define NORM_SUM 2
-
-// Estimation types define whether the current value of the input signal
-// u[k] will be used for estimation of the filter coefficnets or not.
-#define ESTIMATION_TYPES "[previous current]"
-#define ESTIM_PREV 0
-#define ESTIM_CUR 1
-
-class rt_nlms_t 
-{
-public:
-    rt_nlms_t(MHA_AC::algo_comm_t & iac,
-              const std::string& name,
-              const mhaconfig_t& cfg,
-              unsigned int ntaps_,
-              const std::string& name_u,
-              const std::string& name_d,
-              const std::string& name_e,
-              const std::string& name_f,
-              const int n_no_update);
-    ~rt_nlms_t() {}
-
-    mha_wave_t* process(mha_wave_t* sUD, mha_real_t rho, mha_real_t c, unsigned int norm_type, unsigned int estim_type, mha_real_t lambda_smooth);
-    void insert();
-private:
-    MHA_AC::algo_comm_t & ac;
-    unsigned int ntaps;
-    unsigned int frames;
-    unsigned int channels;
-    MHA_AC::waveform_t F;
-    MHASignal::waveform_t U; ///< \brief Input signal cache
-    MHASignal::waveform_t Uflt; ///< \brief Input signal cache (second filter)
-    MHASignal::waveform_t Pu; ///< \brief Power of input signal delayline
-    MHASignal::waveform_t fu; ///< \brief Filtered input signal
-    MHASignal::waveform_t fuflt; ///< \brief Filtered input signal
-    MHASignal::waveform_t fu_previous;
-    MHASignal::waveform_t y_previous;
-    MHASignal::waveform_t P_Sum; //recursively est. power for NORM_SUM
-
-    std::string name_u_;
-    std::string name_d_;
-    std::string name_e_;
-
-    int n_no_update_;
-    int no_iter;
-
-    mha_wave_t s_E;
-};
-
-/*
- * adaptive filter (LMS algorithm)
- *
- * The input signal u[k] and the output signal y[k] are taken from AC
- * variable. The estimated filter f'[k] and the filtered input signal
- * f'[k]*u[k] are stored into an AC variable. The input signal is not
- * touched and can be either waveform or spectrum.
- */
-class nlms_t : public MHAPlugin::plugin_t<rt_nlms_t>
-{
-public:
-    nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-    void prepare(mhaconfig_t&);
-    void release();
-    mha_wave_t* process(mha_wave_t*);
-private:
-    void update();
-    //bool prepared;
-    MHAParser::float_t rho;
-    MHAParser::float_t c;
-    MHAParser::int_t ntaps;
-    MHAParser::string_t name_u;
-    MHAParser::string_t name_d;
-    MHAParser::kw_t normtype;
-    MHAParser::kw_t estimtype;
-    MHAParser::float_t lambda_smoothing_power; //recursive smoothing coefficient for sum normalization rule
-    MHAParser::string_t name_e;
-    MHAParser::string_t name_f;
-    MHAParser::int_t n_no_update;
-    std::string algo;
-    MHAEvents::patchbay_t<nlms_t> patchbay;
-};
+#include "nlms_wave.hh"
 
 nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
     : MHAPlugin::plugin_t<rt_nlms_t>(
@@ -120,6 +33,9 @@ nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
       name_e("Name of error signal E", ""),
       name_f("Name of the AC variable for saving the adapive filter", ""),
       n_no_update("Number of iterations without updating the filter coefficients", "0"),
+      mode("Adaptation mode: sample by sample in the time domain, or block by block in the"
+           " frequency domain (partitioned block frequency domain adaptive filter with partitions"
+           " of one fragment, estimtype has no effect)", "time", ADAPTATION_MODES),
       algo(configured_name)
 {
     insert_member(rho);
@@ -133,16 +49,19 @@ nlms_t::nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name)
     insert_member(name_e);
     insert_member(name_f);
     insert_member(n_no_update);
+    insert_member(mode);
     patchbay.connect(&ntaps.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_u.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_d.writeaccess,this,&nlms_t::update);
     patchbay.connect(&name_e.writeaccess,this,&nlms_t::update);
+    patchbay.connect(&mode.writeaccess,this,&nlms_t::update);
 }
 
 void nlms_t::update()
 {
     if( is_prepared() )
-        push_config(new rt_nlms_t(ac,algo,tftype,ntaps.data,name_u.data,name_d.data, name_e.data,name_f.data,n_no_update.data));
+        push_config(new rt_nlms_t(ac,algo,tftype,ntaps.data,name_u.data,name_d.data, name_e.data,name_f.data,n_no_update.data,
+                                    mode.data.get_index()));
 }
 
 void nlms_t::prepare(mhaconfig_t& cf)
@@ -193,6 +112,13 @@ mha_wave_t* rt_nlms_t::process(mha_wave_t* sUflt, mha_real_t rho, mha_real_t c,
     if(!name_e_.empty())        
         s_E = MHA_AC::get_var_waveform(ac,name_e_);
 
+    if( fdaf ) {
+        if( s_U.num_frames != frames || s_D.num_frames != frames ||
+            (!name_e_.empty() && s_E.num_frames != frames) )
+            throw MHA_Error(__FILE__,__LINE__,"Frequency domain adaptation requires"
+                            " %u frames in name_u, name_d and name_e.", frames);
+    }
+
     //check that AC adaptation variables have same channels as input
     if ( s_U.num_channels != channels )
     {
@@ -206,6 +132,9 @@ mha_wave_t* rt_nlms_t::process(mha_wave_t* sUflt, mha_real_t rho, mha_real_t c,
                         channels, s_U.num_channels, name_d_.c_str());
     }
 
+    if( fdaf )
+        return process_frequency(s_U, s_D, *sUflt, rho, c, norm_type, lambda_smooth);
+
     unsigned int ch, kf, kh, idx, fidx;
     mha_real_t err, u_input, d_desired;
     for(ch=0;ch<channels;ch++)
@@ -374,7 +303,8 @@ rt_nlms_t::rt_nlms_t(MHA_AC::algo_comm_t & iac,
                      const std::string& name_d,
                      const std::string& name_e,
                      const std::string& name_f,
-                     const int n_no_update)
+                     const int n_no_update,
+                     unsigned int mode)
     : ac(iac),
       ntaps(ntaps_),
       frames(cfg.fragsize),
@@ -392,10 +322,58 @@ rt_nlms_t::rt_nlms_t(MHA_AC::algo_comm_t & iac,
       name_d_(name_d),
       name_e_(name_e),
       n_no_update_(n_no_update),
-      no_iter(0)
+      no_iter(0),
+      fdaf(mode == MODE_FREQUENCY ? new MHAFDAF::pbfdaf_t(ntaps, frames, channels, 2) : nullptr),
+      u_power(ntaps, channels),
+      e_block(frames, channels),
+      P_Sum_bins(frames + 1, channels)
 {
 }
 
+mha_wave_t* rt_nlms_t::process_frequency(const mha_wave_t & s_U, const mha_wave_t & s_D,
+                                         const mha_wave_t & sUflt, mha_real_t rho, mha_real_t c,
+                                         unsigned int norm_type, mha_real_t lambda_smooth)
+{
+    fdaf->push(0, s_U);
+    fdaf->push(1, sUflt);
+    u_power.push(s_U);
+    // the error of this block uses the filter of the preceding block
+    fdaf->filter(0, fu);
+    fdaf->filter(1, fuflt);
+    if( no_iter < n_no_update_ )
+        return &fuflt;
+
+    // e = d - f u, scaled with rho as in the time domain
+    for(unsigned int k = 0; k < frames * channels; ++k)
+        e_block.buf[k] = rho * (name_e_.empty() ? s_D.buf[k] - fu.buf[k] : s_E.buf[k]);
+    MHASignal::spectrum_t & E = fdaf->transform_error(e_block);
+
+    // step size per channel (NORM_NONE, NORM_DEFAULT) or per bin (NORM_SUM)
+    switch( norm_type ) {
+    case NORM_DEFAULT :
+        for(unsigned int ch = 0; ch < channels; ++ch)
+            for(unsigned int f = 0; f < E.num_frames; ++f)
+                E(f, ch) *= 1.0f / (u_power[ch] + c);
+        break;
+    case NORM_SUM : {
+        // per sample smoothing constant applied once per block; the bin
+        // powers are scaled to the power per sample of u and of the error
+        const mha_real_t lambda = std::pow(lambda_smooth, (mha_real_t)frames);
+        const MHASignal::spectrum_t & U = fdaf->spectrum(0);
+        for(unsigned int ch = 0; ch < channels; ++ch)
+            for(unsigned int f = 0; f < E.num_frames; ++f) {
+                P_Sum_bins(f, ch) = lambda * P_Sum_bins(f, ch) + (1 - lambda) *
+                    (abs2(value(U, f, ch)) / fdaf->fftlen() + abs2(E(f, ch)) / frames);
+                E(f, ch) *= 1.0f / (P_Sum_bins(f, ch) * ntaps + c);
+            }
+        break;
+    }
+    }
+    fdaf->adapt(0);
+    F.copy(fdaf->taps());
+    return &fuflt;
+}
+
 MHAPLUGIN_CALLBACKS(nlms_wave,nlms_t,wave,wave)
 MHAPLUGIN_DOCUMENTATION\
 (nlms_wave,
@@ -428,6 +406,22 @@ MHAPLUGIN_DOCUMENTATION\
  " \\textbf{estimtype} to the value \\textit{current}. "
  "However in the default case (\\textit{previous}), the previous values"
  " as long as the filter (\\textbf{ntaps}) but the current one are used."
+ "\n"
+ "With \\textbf{mode} set to \\textit{frequency}, the filter is adapted"
+ " once per block in the frequency domain by a partitioned block frequency"
+ " domain adaptive filter: the filter is split into partitions of one"
+ " fragment length, which are applied by overlap-save with an FFT of twice"
+ " the fragment length, and the gradient is constrained to a linear filter"
+ " of \\textbf{ntaps} taps.  The cost per sample grows only"
+ " logarithmically with the fragment size and linearly with the number of"
+ " partitions, which pays off for long filters.  The error signal of a block"
+ " is computed with the filter of the preceding block, and the"
+ " \\textbf{estimtype} setting has no effect.  With the \\textit{default}"
+ " normalization, the step size is divided by the power of the last"
+ " \\textbf{ntaps} input samples once per block; with \\textit{sum}, each"
+ " frequency bin is normalized by its own smoothed power of input and error"
+ " signal.  The signals in \\textbf{name\\_u}, \\textbf{name\\_d} and"
+ " \\textbf{name\\_e} need to have one fragment length in this mode."
  )
 
 /*
@@ -0,0 +1,138 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2008 2010 2012 2013 2014 2015 2016 2017 2018 2020 HörTech gGmbH
+// Copyright © 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mha_plugin.hh"
+#include "mha_events.h"
+#include "mha_signal.hh"
+#include "mha_fdaf.hh"
+#include <memory>
+
+// add normalization types in string list and in the definitions:
+#define NORMALIZATION_TYPES "[none default sum]"
+#define NORM_NONE 0
+#define NORM_DEFAULT 1
+#define NORM_SUM 2
+
+// Estimation types define whether the current value of the input signal
+// u[k] will be used for estimation of the filter coefficnets or not.
+#define ESTIMATION_TYPES "[previous current]"
+#define ESTIM_PREV 0
+#define ESTIM_CUR 1
+
+// Adaptation modes: sample by sample in the time domain, or block by
+// block in the frequency domain.
+#define ADAPTATION_MODES "[time frequency]"
+#define MODE_TIME 0
+#define MODE_FREQUENCY 1
+
+class rt_nlms_t 
+{
+public:
+    rt_nlms_t(MHA_AC::algo_comm_t & iac,
+              const std::string& name,
+              const mhaconfig_t& cfg,
+              unsigned int ntaps_,
+              const std::string& name_u,
+              const std::string& name_d,
+              const std::string& name_e,
+              const std::string& name_f,
+              const int n_no_update,
+              unsigned int mode = MODE_TIME);
+    ~rt_nlms_t() {}
+
+    mha_wave_t* process(mha_wave_t* sUD, mha_real_t rho, mha_real_t c, unsigned int norm_type, unsigned int estim_type, mha_real_t lambda_smooth);
+    void insert();
+private:
+    /// Block by block adaptation with the frequency domain engine
+    mha_wave_t* process_frequency(const mha_wave_t & s_U, const mha_wave_t & s_D,
+                                  const mha_wave_t & sUflt, mha_real_t rho, mha_real_t c,
+                                  unsigned int norm_type, mha_real_t lambda_smooth);
+    MHA_AC::algo_comm_t & ac;
+    unsigned int ntaps;
+    unsigned int frames;
+    unsigned int channels;
+    MHA_AC::waveform_t F;
+    MHASignal::waveform_t U; ///< \brief Input signal cache
+    MHASignal::waveform_t Uflt; ///< \brief Input signal cache (second filter)
+    MHASignal::waveform_t Pu; ///< \brief Power of input signal delayline
+    MHASignal::waveform_t fu; ///< \brief Filtered input signal
+    MHASignal::waveform_t fuflt; ///< \brief Filtered input signal
+    MHASignal::waveform_t fu_previous;
+    MHASignal::waveform_t y_previous;
+    MHASignal::waveform_t P_Sum; //recursively est. power for NORM_SUM
+
+    std::string name_u_;
+    std::string name_d_;
+    std::string name_e_;
+
+    int n_no_update_;
+    int no_iter;
+
+    mha_wave_t s_E;
+
+    /// Frequency domain engine, only allocated in MODE_FREQUENCY.
+    /// Input 0 is the input signal u, input 1 the signal to filter.
+    std::unique_ptr<MHAFDAF::pbfdaf_t> fdaf;
+    /// Power of the last ntaps input samples for NORM_DEFAULT in MODE_FREQUENCY
+    MHAFDAF::power_t u_power;
+    /// Scaled error block in MODE_FREQUENCY
+    MHASignal::waveform_t e_block;
+    /// Recursively estimated power per bin for NORM_SUM in MODE_FREQUENCY
+    MHASignal::waveform_t P_Sum_bins;
+};
+
+/*
+ * adaptive filter (LMS algorithm)
+ *
+ * The input signal u[k] and the output signal y[k] are taken from AC
+ * variable. The estimated filter f'[k] and the filtered input signal
+ * f'[k]*u[k] are stored into an AC variable. The input signal is not
+ * touched and can be either waveform or spectrum.
+ */
+class nlms_t : public MHAPlugin::plugin_t<rt_nlms_t>
+{
+public:
+    nlms_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
+    void prepare(mhaconfig_t&);
+    void release();
+    mha_wave_t* process(mha_wave_t*);
+private:
+    void update();
+    //bool prepared;
+    MHAParser::float_t rho;
+    MHAParser::float_t c;
+    MHAParser::int_t ntaps;
+    MHAParser::string_t name_u;
+    MHAParser::string_t name_d;
+    MHAParser::kw_t normtype;
+    MHAParser::kw_t estimtype;
+    MHAParser::float_t lambda_smoothing_power; //recursive smoothing coefficient for sum normalization rule
+    MHAParser::string_t name_e;
+    MHAParser::string_t name_f;
+    MHAParser::int_t n_no_update;
+    MHAParser::kw_t mode;
+    std::string algo;
+    MHAEvents::patchbay_t<nlms_t> patchbay;
+};
+
+/*
+ * Local Variables:
+ * compile-command: "make"
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,84 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost of the time domain and the frequency domain mode of
+// nlms_wave per block of 64 samples for growing filter lengths.
+
+#include "nlms_wave.hh"
+#include "mha_algo_comm.hh"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    /// Reproducible white noise in [-1,1]
+    class noise_t {
+    public:
+        mha_real_t operator()() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+    private:
+        uint32_t state = 12345U;
+    };
+}
+
+int main()
+{
+    const unsigned frames = 64, blocks = 2000;
+    MHA_AC::algo_comm_class_t acspace{};
+    MHA_AC::algo_comm_t & ac {acspace};
+    MHA_AC::waveform_t u(ac, "u", frames, 1, true);
+    MHA_AC::waveform_t d(ac, "d", frames, 1, true);
+    noise_t noise;
+    for (unsigned k = 0; k < frames; ++k) {
+        u.buf[k] = noise();
+        d.buf[k] = noise();
+    }
+    nlms_t nlms{ac, "nlms"};
+    nlms.parse("name_u = u");
+    nlms.parse("name_d = d");
+    nlms.parse("rho = 0.5");
+    MHASignal::waveform_t s(frames, 1);
+    for (unsigned n : {32U, 128U, 512U, 2048U}) {
+        double t[2];
+        for (unsigned m = 0; m < 2; ++m) {
+            nlms.parse("ntaps = " + std::to_string(n));
+            nlms.parse(m ? "mode = frequency" : "mode = time");
+            mhaconfig_t cf = {.channels = 1, .domain = MHA_WAVEFORM,
+                              .fragsize = frames, .wndlen = 0, .fftlen = 0,
+                              .srate = 16000};
+            nlms.prepare_(cf);
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned b = 0; b < blocks; ++b)
+                nlms.process(&s);
+            std::chrono::duration<double> dt =
+                std::chrono::steady_clock::now() - start;
+            t[m] = dt.count() / blocks * 1e6;
+            nlms.release_();
+        }
+        std::cout << n << " taps: time domain " << t[0]
+                  << " us/block, frequency domain " << t[1]
+                  << " us/block (speedup " << t[0] / t[1] << ")"
+                  << std::endl;
+    }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
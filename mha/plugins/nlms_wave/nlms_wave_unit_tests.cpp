@@ -0,0 +1,183 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "nlms_wave.hh"
+#include "mha_algo_comm.hh"
+#include <cmath>
+
+namespace {
+    /// Reproducible white noise in [-1,1]
+    class noise_t {
+    public:
+        mha_real_t operator()() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+    private:
+        uint32_t state = 12345U;
+    };
+
+    /// Impulse response of the unknown system, n taps
+    std::vector<mha_real_t> system_response(unsigned n) {
+        std::vector<mha_real_t> h(n);
+        for (unsigned k = 0; k < n; ++k)
+            h[k] = std::exp(-0.1f * k) * std::cos(0.9f * k);
+        return h;
+    }
+
+    /// Feeds noise through the unknown system, channel ch gets gain ch+1
+    class system_t {
+    public:
+        system_t(unsigned frames, unsigned channels, unsigned ntaps)
+            : u(frames, channels), d(frames, channels),
+              h(system_response(ntaps)), history(ntaps, channels)
+        {}
+        void next_block() {
+            for (unsigned k = 0; k < u.num_frames; ++k)
+                for (unsigned ch = 0; ch < u.num_channels; ++ch) {
+                    for (unsigned kh = h.size() - 1; kh > 0; --kh)
+                        history(kh, ch) = history(kh - 1, ch);
+                    history(0, ch) = u(k, ch) = noise();
+                    d(k, ch) = 0;
+                    for (unsigned kh = 0; kh < h.size(); ++kh)
+                        d(k, ch) += (ch + 1) * h[kh] * history(kh, ch);
+                }
+        }
+        MHASignal::waveform_t u, d;
+        std::vector<mha_real_t> h;
+    private:
+        MHASignal::waveform_t history;
+        noise_t noise;
+    };
+
+    void expect_identified(const mha_wave_t & taps,
+                           const std::vector<mha_real_t> & h,
+                           mha_real_t tolerance) {
+        for (unsigned ch = 0; ch < taps.num_channels; ++ch)
+            for (unsigned kh = 0; kh < taps.num_frames; ++kh)
+                EXPECT_NEAR((ch + 1) * h[kh], value(taps, kh, ch), tolerance)
+                    << "channel " << ch << " tap " << kh;
+    }
+}
+
+class nlms_wave_testing : public ::testing::Test {
+public:
+    MHA_AC::algo_comm_class_t acspace{};
+    MHA_AC::algo_comm_t & ac {acspace};
+    unsigned frames = 32, ntaps = 48;
+    mhaconfig_t signal_properties() const {
+        return {.channels = 1, .domain = MHA_WAVEFORM, .fragsize = frames,
+                .wndlen = 0, .fftlen = 0, .srate = 16000};
+    }
+    nlms_t nlms{ac, "nlms"};
+    void SetUp() override {
+        nlms.parse("name_u = u");
+        nlms.parse("name_d = d");
+        nlms.parse("ntaps = " + std::to_string(ntaps));
+        nlms.parse("rho = 0.5");
+    }
+    void TearDown() override {
+        if (nlms.is_prepared())
+            nlms.release_();
+    }
+    /// Adapt for the given number of blocks, check the estimated filter
+    void run(unsigned blocks) {
+        system_t sys(frames, 1, ntaps);
+        MHA_AC::waveform_t u(ac, "u", frames, 1, true);
+        MHA_AC::waveform_t d(ac, "d", frames, 1, true);
+        mhaconfig_t cf = signal_properties();
+        nlms.prepare_(cf);
+        for (unsigned b = 0; b < blocks; ++b) {
+            sys.next_block();
+            u.copy(sys.u);
+            d.copy(sys.d);
+            nlms.process(&u);
+        }
+        expect_identified(MHA_AC::get_var_waveform(ac, "nlms"), sys.h, 2e-3f);
+    }
+};
+
+TEST_F(nlms_wave_testing, time_domain_mode_identifies_system)
+{
+    run(200);
+}
+
+TEST_F(nlms_wave_testing, frequency_domain_mode_identifies_system)
+{
+    nlms.parse("mode = frequency");
+    run(200);
+}
+
+TEST_F(nlms_wave_testing, frequency_domain_mode_identifies_system_with_every_normalization)
+{
+    nlms.parse("mode = frequency");
+    for (const char * normtype : {"none", "sum"}) {
+        SCOPED_TRACE(normtype);
+        nlms.parse(std::string("normtype = ") + normtype);
+        nlms.parse(std::string("rho = ") + (normtype[0] == 'n' ? "0.01" : "0.5"));
+        run(400);
+        nlms.release_();
+    }
+}
+
+TEST_F(nlms_wave_testing, frequency_domain_mode_adapts_to_external_error)
+{
+    nlms.parse("mode = frequency");
+    nlms.parse("name_e = e");
+    system_t sys(frames, 1, ntaps);
+    MHA_AC::waveform_t u(ac, "u", frames, 1, true);
+    MHA_AC::waveform_t d(ac, "d", frames, 1, true);
+    MHA_AC::waveform_t e(ac, "e", frames, 1, true);
+    mhaconfig_t cf = signal_properties();
+    nlms.prepare_(cf);
+    std::vector<mha_real_t> u_history(ntaps, 0.0f);
+    for (unsigned b = 0; b < 200; ++b) {
+        sys.next_block();
+        u.copy(sys.u);
+        d.copy(sys.d);
+        // the error signal computed elsewhere with the published filter
+        const mha_wave_t taps = MHA_AC::get_var_waveform(ac, "nlms");
+        for (unsigned k = 0; k < frames; ++k) {
+            u_history.push_back(sys.u(k, 0));
+            const unsigned n = u_history.size() - 1;
+            e(k, 0) = sys.d(k, 0);
+            for (unsigned kh = 0; kh < ntaps; ++kh)
+                e(k, 0) -= value(taps, kh, 0) * u_history[n - kh];
+        }
+        // the desired signal is not used when the error is given
+        d.assign(0.0f);
+        nlms.process(&u);
+    }
+    expect_identified(MHA_AC::get_var_waveform(ac, "nlms"), sys.h, 2e-3f);
+}
+
+TEST_F(nlms_wave_testing, frequency_domain_mode_needs_full_blocks)
+{
+    nlms.parse("mode = frequency");
+    MHA_AC::waveform_t u(ac, "u", frames / 2, 1, true);
+    MHA_AC::waveform_t d(ac, "d", frames / 2, 1, true);
+    mhaconfig_t cf = signal_properties();
+    nlms.prepare_(cf);
+    MHASignal::waveform_t s(frames, 1);
+    EXPECT_THROW(nlms.process(&s), MHA_Error);
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2013 2014 2015 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -14,7 +14,8 @@
 // You should have received a copy of the GNU Affero General Public License,
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 // Also observe the algorithm copyright statement below.
-#include "mha_plugin.hh"
+#include "noise_psd_estimator.hh"
+#include <limits>
 /*
 
   Copyright (c) 2011
@@ -38,51 +39,6 @@
 
 namespace noise_psd_estimator {
 
-    class noise_psd_estimator_t {
-    public:
-        noise_psd_estimator_t(const mhaconfig_t& cf,
-                              MHA_AC::algo_comm_t & ac,
-                              const std::string& name,
-                              float alphaPH1mean,
-                              float alphaPSD,
-                              float q,
-                              float xiOptDb);
-        void process(mha_spec_t* noisyDftFrame);
-        void insert(){
-            noisePow.insert();
-            inputPow.insert();
-            snrPost1Debug.insert();
-            GLRDebug.insert();
-            PH1Debug.insert();
-            estimateDebug.insert();
-            inputSpec.insert();
-        }
-    private:
-        MHASignal::waveform_t noisyPer;
-        MHASignal::waveform_t PH1mean;
-        MHA_AC::waveform_t noisePow;
-
-        // gkc debug:
-        MHA_AC::waveform_t inputPow;
-        MHA_AC::waveform_t snrPost1Debug;
-        MHA_AC::waveform_t GLRDebug;
-        MHA_AC::waveform_t PH1Debug;
-        MHA_AC::waveform_t estimateDebug;
-        MHA_AC::spectrum_t inputSpec;
-
-        // parameters:
-        float alphaPH1mean_;
-        float alphaPSD_;
-        // a priori probability of speech presence:
-        float priorFact;
-        float xiOpt;
-        // optimal fixed a priori SNR for SPP estimation:
-        float logGLRFact;
-        float GLRexp;
-        //count frames for initial estimate
-        int frameno;
-    };
-
     noise_psd_estimator_t::noise_psd_estimator_t(const mhaconfig_t& cf,
                                                  MHA_AC::algo_comm_t & ac,
                                                  const std::string& name,
@@ -116,16 +72,59 @@ namespace noise_psd_estimator {
 
 #define POWSPEC_FACTOR 0.0025
 
+    inline void noise_psd_estimator_t::update(unsigned k, unsigned count)
+    {
+        using namespace MHASimd;
+        // lanes beyond count work on neutral values and are not stored
+        mha_real_t per_[4] = {0, 0, 0, 0}, noise_[4] = {1, 1, 1, 1}, mean_[4] = {0, 0, 0, 0};
+        std::memcpy(per_, noisyPer.buf + k, count * sizeof(mha_real_t));
+        std::memcpy(noise_, noisePow.buf + k, count * sizeof(mha_real_t));
+        std::memcpy(mean_, PH1mean.buf + k, count * sizeof(mha_real_t));
+        const v4_t per = load(per_);
+        v4_t noise = load(noise_), mean = load(mean_);
+
+        // a posteriori SNR based on old noise power estimate:
+        const v4_t snrPost1 = per / noise;
+        // exp(80) keeps GLR finite in single precision, PH1 is 1 long before
+        const v4_t GLR = priorFact *
+            MHASimd::exp(min(logGLRFact + GLRexp * snrPost1, broadcast(80.0f)));
+        // a posteriori speech presence probability:
+        v4_t PH1 = GLR / (1.0f + GLR);
+        PH1 = GLR <= std::numeric_limits<mha_real_t>::max() ? PH1 : broadcast(1.0f);
+        mean = alphaPH1mean_ * mean + (1.0f - alphaPH1mean_) * PH1;
+        PH1 = mean > 0.99f ? min(PH1, broadcast(0.99f)) : PH1;
+        const v4_t estimate = PH1 * noise + (1.0f - PH1) * per;
+        noise = alphaPSD_ * noise + (1.0f - alphaPSD_) * estimate;
+
+        auto put = [&](MHASignal::waveform_t & dest, v4_t v) {
+            mha_real_t lanes[4];
+            store(lanes, v);
+            std::memcpy(dest.buf + k, lanes, count * sizeof(mha_real_t));
+        };
+        put(noisePow, noise);
+        put(PH1mean, mean);
+        //gkc: just saving the spectrum to compare inputs
+        put(inputPow, per);
+        put(snrPost1Debug, snrPost1);
+        put(GLRDebug, GLR);
+        put(PH1Debug, PH1);
+        put(estimateDebug, estimate);
+    }
+
     void noise_psd_estimator_t::process(mha_spec_t* noisyDftFrame)
     {
         insert();
 
         inputSpec.copy(*noisyDftFrame);
-        noisyPer.powspec(*noisyDftFrame);
 
-        for( unsigned int k=0;k<size(noisyPer);k++) {
-            noisyPer[k] = noisyPer[k] * ( 5.2429e+007 );
-        }
+        // periodogram, transposed into the bins x channels layout of the
+        // AC variables:
+        const unsigned int nbins = noisyPer.num_frames;
+        const unsigned int nch = noisyPer.num_channels;
+        const mha_real_t scale = POWSPEC_FACTOR * 5.2429e+007;
+        for( unsigned int ch=0;ch<nch;ch++)
+            for( unsigned int k=0;k<nbins;k++)
+                noisyPer.buf[k*nch+ch] = scale * abs2(noisyDftFrame->buf[ch*nbins+k]);
 
         if ( frameno < 5 ) {
 
@@ -135,48 +134,17 @@ namespace noise_psd_estimator {
             }
         }
 
-        // noise power estimation
-        for( unsigned int k=0;k<size(noisyPer);k++){
-
-            // a posteriori SNR based on old noise power estimate:
-            double snrPost1 = noisyPer[k] / noisePow[k];
-            double GLR = priorFact * exp(std::min(logGLRFact + GLRexp*snrPost1,200.0));
-            // a posteriori speech presence probability:
-            double PH1 = GLR/(1.0f+GLR);
-            PH1mean[k]  = alphaPH1mean_ * PH1mean[k] + (1.0f-alphaPH1mean_) * PH1;
-            if( PH1mean[k] > 0.99 )
-                PH1 = std::min(PH1,0.99);
-            double estimate =  PH1 * noisePow[k] + (1.0f-PH1) * noisyPer[k];
-            noisePow[k] = alphaPSD_ * noisePow[k] + (1.0f-alphaPSD_)*estimate;
-
-            //gkc: just saving the spectrum to compare inputs
-            inputPow[k] = noisyPer[k];
-            snrPost1Debug[k] = snrPost1;
-            GLRDebug[k] = GLR;
-            PH1Debug[k] = PH1;
-            estimateDebug[k] = estimate;
-        }
+        // noise power estimation, all bins of all channels in one pass
+        const unsigned int n = size(noisyPer);
+        unsigned int k=0;
+        for( ;k+4<=n;k+=4)
+            update(k,4);
+        if( k<n )
+            update(k,n-k);
 
         frameno++;
     }
 
-    class noise_psd_estimator_if_t : public MHAPlugin::plugin_t<noise_psd_estimator_t> {
-    public:
-        noise_psd_estimator_if_t(MHA_AC::algo_comm_t & iac,
-                                 const std::string & configured_name);
-        mha_spec_t* process(mha_spec_t*);
-        void prepare(mhaconfig_t&);
-    private:
-        void update_cfg();
-        /* integer variable of MHA-parser: */
-        MHAParser::float_t alphaPH1mean;
-        MHAParser::float_t alphaPSD;
-        MHAParser::float_t q;
-        MHAParser::float_t xiOptDb;
-        std::string name;
-        MHAEvents::patchbay_t<noise_psd_estimator_if_t> patchbay;
-    };
-
     noise_psd_estimator_if_t::
     noise_psd_estimator_if_t(MHA_AC::algo_comm_t & iac,
                              const std::string & configured_name)
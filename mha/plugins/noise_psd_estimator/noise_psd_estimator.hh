@@ -0,0 +1,120 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2013 2014 2015 2017 2018 2019 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+// Also observe the algorithm copyright statement below.
+#ifndef NOISE_PSD_ESTIMATOR_HH
+#define NOISE_PSD_ESTIMATOR_HH
+
+#include "mha_plugin.hh"
+#include "mha_simd.hh"
+/*
+
+  Copyright (c) 2011
+  Author: Timo Gerkmann and Richard Hendriks
+  Royal Institute of Technology (KTH)
+  Delft university of Technology
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  * Redistributions of source code must retain the above copyright
+  notice and this list of conditions.
+
+  * Redistributions in binary form must reproduce the above copyright
+  notice and this list of conditions in the documentation and/or
+  other materials provided with the distribution
+
+
+*/
+
+namespace noise_psd_estimator {
+
+    class noise_psd_estimator_t {
+    public:
+        noise_psd_estimator_t(const mhaconfig_t& cf,
+                              MHA_AC::algo_comm_t & ac,
+                              const std::string& name,
+                              float alphaPH1mean,
+                              float alphaPSD,
+                              float q,
+                              float xiOptDb);
+        void process(mha_spec_t* noisyDftFrame);
+        void insert(){
+            noisePow.insert();
+            inputPow.insert();
+            snrPost1Debug.insert();
+            GLRDebug.insert();
+            PH1Debug.insert();
+            estimateDebug.insert();
+            inputSpec.insert();
+        }
+    private:
+        /** Speech presence probability and noise power update of the
+         *  elements k to k+count-1 of the bins x channels arrays,
+         *  count <= 4 */
+        inline void update(unsigned k, unsigned count);
+
+        MHASignal::waveform_t noisyPer;
+        MHASignal::waveform_t PH1mean;
+        MHA_AC::waveform_t noisePow;
+
+        // gkc debug:
+        MHA_AC::waveform_t inputPow;
+        MHA_AC::waveform_t snrPost1Debug;
+        MHA_AC::waveform_t GLRDebug;
+        MHA_AC::waveform_t PH1Debug;
+        MHA_AC::waveform_t estimateDebug;
+        MHA_AC::spectrum_t inputSpec;
+
+        // parameters:
+        float alphaPH1mean_;
+        float alphaPSD_;
+        // a priori probability of speech presence:
+        float priorFact;
+        float xiOpt;
+        // optimal fixed a priori SNR for SPP estimation:
+        float logGLRFact;
+        float GLRexp;
+        //count frames for initial estimate
+        int frameno;
+    };
+
+    class noise_psd_estimator_if_t : public MHAPlugin::plugin_t<noise_psd_estimator_t> {
+    public:
+        noise_psd_estimator_if_t(MHA_AC::algo_comm_t & iac,
+                                 const std::string & configured_name);
+        mha_spec_t* process(mha_spec_t*);
+        void prepare(mhaconfig_t&);
+    private:
+        void update_cfg();
+        /* integer variable of MHA-parser: */
+        MHAParser::float_t alphaPH1mean;
+        MHAParser::float_t alphaPSD;
+        MHAParser::float_t q;
+        MHAParser::float_t xiOptDb;
+        std::string name;
+        MHAEvents::patchbay_t<noise_psd_estimator_if_t> patchbay;
+    };
+}
+
+#endif
+
+// Local Variables:
+// compile-command: "make"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
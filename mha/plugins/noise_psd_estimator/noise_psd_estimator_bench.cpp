@@ -0,0 +1,138 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost per frame of the vectorized noise power estimator
+// with the scalar double precision implementation, 2 channels.
+
+#include "noise_psd_estimator.hh"
+#include "mha_algo_comm.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+using noise_psd_estimator::noise_psd_estimator_t;
+
+namespace {
+    /// The scalar double precision update of the original implementation
+    class reference_t {
+    public:
+        reference_t(unsigned nbins, unsigned channels, float alphaPH1mean,
+                    float alphaPSD, float q, float xiOptDb)
+            : noisyPer(nbins, channels), PH1mean(nbins, channels),
+              noisePow(nbins, channels), PH1Debug(nbins, channels),
+              alphaPH1mean_(alphaPH1mean), alphaPSD_(alphaPSD),
+              priorFact(q / (1.0f - q)),
+              xiOpt(powf(10.0f, (xiOptDb / 10.0f))),
+              logGLRFact(log(1.0f / (1.0f + xiOpt))),
+              GLRexp(xiOpt / (1.0f + xiOpt))
+        {
+            PH1mean.assign(0.5);
+            noisePow.assign(0.5);
+        }
+        void process(const mha_spec_t & noisyDftFrame) {
+            noisyPer.powspec(noisyDftFrame);
+            for (unsigned int k = 0; k < size(noisyPer); k++)
+                noisyPer[k] = noisyPer[k] * (5.2429e+007);
+            if (frameno < 5)
+                for (unsigned int k = 0; k < size(noisyPer); k++)
+                    noisePow[k] += noisyPer[k] / 5.0;
+            for (unsigned int k = 0; k < size(noisyPer); k++) {
+                double snrPost1 = noisyPer[k] / noisePow[k];
+                double GLR = priorFact * exp(std::min(logGLRFact + GLRexp * snrPost1, 200.0));
+                double PH1 = GLR / (1.0f + GLR);
+                PH1mean[k] = alphaPH1mean_ * PH1mean[k] + (1.0f - alphaPH1mean_) * PH1;
+                if (PH1mean[k] > 0.99)
+                    PH1 = std::min(PH1, 0.99);
+                double estimate = PH1 * noisePow[k] + (1.0f - PH1) * noisyPer[k];
+                noisePow[k] = alphaPSD_ * noisePow[k] + (1.0f - alphaPSD_) * estimate;
+                PH1Debug[k] = PH1;
+            }
+            frameno++;
+        }
+        MHASignal::waveform_t noisyPer, PH1mean, noisePow, PH1Debug;
+    private:
+        float alphaPH1mean_, alphaPSD_, priorFact, xiOpt, logGLRFact, GLRexp;
+        int frameno = 0;
+    };
+
+    /// Noise with a level that differs between bins and channels, and
+    /// loud harmonic bursts in some frames
+    class input_t {
+    public:
+        input_t(unsigned nbins, unsigned channels) : spec(nbins, channels) {}
+        const MHASignal::spectrum_t & next() {
+            for (unsigned ch = 0; ch < spec.num_channels; ++ch)
+                for (unsigned k = 0; k < spec.num_frames; ++k) {
+                    mha_real_t level = 2e-3f * (1.0f + 0.5f * std::sin(0.05f * k + ch));
+                    if ((frame / 20) % 3 == 1 && k % 12 < 3)
+                        level *= 10.0f;
+                    spec(k, ch) = {level * noise(), level * noise()};
+                }
+            ++frame;
+            return spec;
+        }
+    private:
+        mha_real_t noise() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+        MHASignal::spectrum_t spec;
+        uint32_t state = 815U;
+        unsigned frame = 0;
+    };
+
+    mhaconfig_t signal_properties(unsigned channels, unsigned fftlen) {
+        return {.channels = channels, .domain = MHA_SPECTRUM,
+                .fragsize = fftlen / 4, .wndlen = fftlen / 2, .fftlen = fftlen,
+                .srate = 16000};
+    }
+}
+
+int main()
+{
+    const unsigned channels = 2, frames = 20000;
+    for (unsigned fftlen : {256U, 512U, 1024U}) {
+        const unsigned nbins = fftlen / 2 + 1;
+        MHA_AC::algo_comm_class_t acspace{};
+        MHA_AC::algo_comm_t & ac {acspace};
+        noise_psd_estimator_t estimator(signal_properties(channels, fftlen), ac,
+                                        "noisePow", 0.9f, 0.8f, 0.5f, 15.0f);
+        reference_t reference(nbins, channels, 0.9f, 0.8f, 0.5f, 15.0f);
+        input_t input(nbins, channels);
+        MHASignal::spectrum_t s(input.next());
+        auto measure = [&](auto && process) {
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned f = 0; f < frames; ++f)
+                process();
+            std::chrono::duration<double> t =
+                std::chrono::steady_clock::now() - start;
+            return t.count() / frames * 1e6;
+        };
+        const double t_ref = measure([&]{reference.process(s);});
+        const double t_est = measure([&]{estimator.process(&s);});
+        std::cout << "fftlen " << fftlen << ", " << channels
+                  << " channels: original " << t_ref << " us/frame, vectorized "
+                  << t_est << " us/frame (speedup " << t_ref / t_est << ")"
+                  << std::endl;
+    }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2005 2006 2007 2009 2010 2013 2014 2015 2017 2018 HörTech gGmbH
 // Copyright © 2019 2020 2021 HörTech gGmbH
-// Copyright © 2021 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2021 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -183,9 +183,23 @@ namespace rmslevel {
         if (*poll_config() != UNIT::SPL)
             throw MHA_Error(__FILE__, __LINE__, "Internal error: dB unit must "
                             "be dB(SPL) when processing waveform signal");
-        for(unsigned ch=0U; ch<s->num_channels;ch++){
-            level.data[ch] = std::max(MHASignal::rmslevel(*s,ch),2e-10f);
-            peak.data[ch] = std::max(MHASignal::maxabs(*s,ch),2e-10f);
+        // Accumulate squares and peaks of all channels of each frame
+        // together, traversing the interleaved block memory only once.
+        const unsigned nch = s->num_channels;
+        mha_real_t * sumsqr = level.data.data();
+        mha_real_t * maxabs = peak.data.data();
+        std::fill_n(sumsqr, nch, 0.0f);
+        std::fill_n(maxabs, nch, 0.0f);
+        for(unsigned k=0U; k<s->num_frames; k++){
+            const mha_real_t * x = s->buf + k*nch;
+            for(unsigned ch=0U; ch<nch; ch++){
+                sumsqr[ch] += x[ch]*x[ch];
+                maxabs[ch] = std::max(maxabs[ch], std::fabs(x[ch]));
+            }
+        }
+        for(unsigned ch=0U; ch<nch;ch++){
+            level.data[ch] = std::max(mha_real_t(sqrt(sumsqr[ch]/s->num_frames)),2e-10f);
+            peak.data[ch] = std::max(maxabs[ch],2e-10f);
             level_db.data[ch] = MHASignal::pa2dbspl(level.data[ch]);
             peak_db.data[ch] = MHASignal::pa2dbspl(peak.data[ch]);
         }
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2012 2013 2014 2015 2016 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -36,6 +36,213 @@ namespace rohBeam {
 
   auto scalarify=[](auto t){return t(0);};
 
+  batched_cov_t::batched_cov_t(unsigned nchan_, unsigned nfreq_):
+    nchan( nchan_ ),
+    nfreq( nfreq_ ),
+    nfreq_pad( (nfreq_ + 3U) / 4U * 4U ),
+    r_re( nchan_ * (nchan_+1) / 2 * nfreq_pad, 0.0f ),
+    r_im( nchan_ * (nchan_+1) / 2 * nfreq_pad, 0.0f ),
+    p_re( nchan_ * nfreq_pad, 0.0f ),
+    p_im( nchan_ * nfreq_pad, 0.0f ),
+    x_re( nchan_ * nfreq_pad, 0.0f ),
+    x_im( nchan_ * nfreq_pad, 0.0f ),
+    y_re( nfreq_pad, 0.0f ),
+    y_im( nfreq_pad, 0.0f ),
+    work( nchan_ * (nchan_+1) + 6 * nchan_ )
+  {
+    //identity matrices, including the padding bins
+    for (unsigned k=0; k<nchan; k++)
+      std::fill_n(&r_re[tri(k,k)*nfreq_pad], nfreq_pad, 1.0f);
+  }
+
+  std::complex<float> batched_cov_t::cov(unsigned f, unsigned k, unsigned i) const {
+    if ( k >= i )
+      return std::complex<float>( r_re[tri(k,i)*nfreq_pad+f], r_im[tri(k,i)*nfreq_pad+f] );
+    return std::conj( cov(f,i,k) );
+  }
+
+  std::complex<float> batched_cov_t::xcorr(unsigned f, unsigned k) const {
+    return std::complex<float>( p_re[k*nfreq_pad+f], p_im[k*nfreq_pad+f] );
+  }
+
+  namespace {
+    using MHASimd::load;
+    using MHASimd::store;
+    using MHASimd::broadcast;
+
+    /* Exponential filter with the new value a*conj(b) for four bins,
+     * s = alpha * s + (1 - alpha) * a * conj(b) */
+    void update_xcorr(float *s_re, float *s_im,
+                      v4_t ar, v4_t ai, v4_t br, v4_t bi,
+                      float alpha) {
+      const v4_t c = broadcast(alpha);
+      const v4_t d = broadcast(1 - alpha);
+      store(s_re, c * load(s_re) + d * (ar * br + ai * bi));
+      store(s_im, c * load(s_im) + d * (ai * br - ar * bi));
+    }
+
+    /* Wiener filter for four bins.  Decomposes the Hermitian matrices
+     * R = L D L^H in place, with unit lower triangular L, and solves
+     * L D L^H w = p.  Bins where the matrix is not positive definite
+     * get zero weights in the affected directions instead of infinities.
+     * N is the number of channels, or 0 if only known at run time in n.
+     * a_re, a_im: lower triangle of R, overwritten with L
+     * w_re, w_im: p on input, w on output */
+    template<unsigned N>
+    void solve_ldl(unsigned n, v4_t *a_re, v4_t *a_im,
+                   v4_t *w_re, v4_t *w_im, v4_t *d, v4_t *inv_d,
+                   v4_t *t_re, v4_t *t_im) {
+      if ( N )
+        n = N;
+      auto tri = [](unsigned k, unsigned i) {return k*(k+1)/2 + i;};
+      for (unsigned j=0; j<n; j++) {
+        //t_m = L_jm d_m for m < j
+        v4_t dj = a_re[tri(j,j)];
+        for (unsigned m=0; m<j; m++) {
+          t_re[m] = a_re[tri(j,m)] * d[m];
+          t_im[m] = a_im[tri(j,m)] * d[m];
+          dj -= a_re[tri(j,m)] * t_re[m] + a_im[tri(j,m)] * t_im[m];
+        }
+        const v4_t one = broadcast(1.0f);
+        const auto pos = dj > 0;
+        d[j] = pos ? dj : v4_t{};
+        inv_d[j] = pos ? one / dj : v4_t{};
+        for (unsigned i=j+1; i<n; i++) {
+          //L_ij = (R_ij - sum_m L_im conj(L_jm) d_m) / d_j
+          v4_t sr = a_re[tri(i,j)], si = a_im[tri(i,j)];
+          for (unsigned m=0; m<j; m++) {
+            sr -= a_re[tri(i,m)] * t_re[m] + a_im[tri(i,m)] * t_im[m];
+            si -= a_im[tri(i,m)] * t_re[m] - a_re[tri(i,m)] * t_im[m];
+          }
+          a_re[tri(i,j)] = sr * inv_d[j];
+          a_im[tri(i,j)] = si * inv_d[j];
+        }
+      }
+      //L u = p
+      for (unsigned i=1; i<n; i++)
+        for (unsigned m=0; m<i; m++) {
+          w_re[i] -= a_re[tri(i,m)] * w_re[m] - a_im[tri(i,m)] * w_im[m];
+          w_im[i] -= a_re[tri(i,m)] * w_im[m] + a_im[tri(i,m)] * w_re[m];
+        }
+      //D v = u
+      for (unsigned i=0; i<n; i++) {
+        w_re[i] *= inv_d[i];
+        w_im[i] *= inv_d[i];
+      }
+      //L^H w = v
+      for (unsigned i=n; i-- > 0;)
+        for (unsigned m=i+1; m<n; m++) {
+          w_re[i] -= a_re[tri(m,i)] * w_re[m] + a_im[tri(m,i)] * w_im[m];
+          w_im[i] -= a_re[tri(m,i)] * w_im[m] - a_im[tri(m,i)] * w_re[m];
+        }
+    }
+  }
+
+  void batched_cov_t::update(const mha_spec_t & x, const mha_spec_t & y,
+                             float alpha_xx, float alpha_xy) {
+    //split the signals into real and imaginary parts once
+    for (unsigned c=0; c<nchan; c++)
+      for (unsigned f=0; f<nfreq; f++) {
+        x_re[c*nfreq_pad+f] = value(x,f,c).re;
+        x_im[c*nfreq_pad+f] = value(x,f,c).im;
+      }
+    for (unsigned f=0; f<nfreq; f++) {
+      y_re[f] = value(y,f,0).re;
+      y_im[f] = value(y,f,0).im;
+    }
+    for (unsigned f=0; f<nfreq_pad; f+=4) {
+      const v4_t yr = load(&y_re[f]), yi = load(&y_im[f]);
+      for (unsigned k=0; k<nchan; k++) {
+        const v4_t xr = load(&x_re[k*nfreq_pad+f]), xi = load(&x_im[k*nfreq_pad+f]);
+        update_xcorr(&p_re[k*nfreq_pad+f], &p_im[k*nfreq_pad+f],
+                     xr, xi, yr, yi, alpha_xy);
+        for (unsigned i=0; i<=k; i++)
+          update_xcorr(&r_re[tri(k,i)*nfreq_pad+f], &r_im[tri(k,i)*nfreq_pad+f],
+                       xr, xi, load(&x_re[i*nfreq_pad+f]), load(&x_im[i*nfreq_pad+f]),
+                       alpha_xx);
+      }
+    }
+  }
+
+  template<unsigned N>
+  static void filter_bins(unsigned n, unsigned nfreq_pad,
+                          const float *r_re, const float *r_im,
+                          const float *p_re, const float *p_im,
+                          const float *x_re, const float *x_im,
+                          const float *y_re, const float *y_im,
+                          float min_lim, float max_lim,
+                          v4_t *work, mha_spec_t & z) {
+    if ( N )
+      n = N;
+    const unsigned ntri = n*(n+1)/2;
+    //fixed sizes live in registers or on the stack, others in work
+    v4_t fixed[N ? N*(N+1) + 6*N : 1];
+    v4_t *a_re = N ? fixed : work;
+    v4_t *a_im = a_re + ntri;
+    v4_t *w_re = a_im + ntri;
+    v4_t *w_im = w_re + n;
+    v4_t *d = w_im + n;
+    v4_t *inv_d = d + n;
+    v4_t *t_re = inv_d + n;
+    v4_t *t_im = t_re + n;
+    const unsigned nfreq = z.num_frames;
+    for (unsigned f=0; f<nfreq; f+=4) {
+      for (unsigned e=0; e<ntri; e++) {
+        a_re[e] = load(&r_re[e*nfreq_pad+f]);
+        a_im[e] = load(&r_im[e*nfreq_pad+f]);
+      }
+      for (unsigned c=0; c<n; c++) {
+        w_re[c] = load(&p_re[c*nfreq_pad+f]);
+        w_im[c] = load(&p_im[c*nfreq_pad+f]);
+      }
+      solve_ldl<N>(n, a_re, a_im, w_re, w_im, d, inv_d, t_re, t_im);
+      v4_t zr = load(&y_re[f]), zi = load(&y_im[f]);
+      for (unsigned c=0; c<n; c++) {
+        //limit the magnitude of the weights, keep the phase
+        for (unsigned j=0; j<4; j++) {
+          const float mag = std::sqrt( w_re[c][j]*w_re[c][j] + w_im[c][j]*w_im[c][j] );
+          if ( mag > max_lim ) {
+            w_re[c][j] *= max_lim / mag;
+            w_im[c][j] *= max_lim / mag;
+          }
+          else if ( mag == 0 ) {
+            w_re[c][j] = min_lim;
+          }
+          else if ( mag < min_lim ) {
+            w_re[c][j] *= min_lim / mag;
+            w_im[c][j] *= min_lim / mag;
+          }
+        }
+        //z = y - conj(w) x
+        const v4_t xr = load(&x_re[c*nfreq_pad+f]), xi = load(&x_im[c*nfreq_pad+f]);
+        zr -= w_re[c] * xr + w_im[c] * xi;
+        zi -= w_re[c] * xi - w_im[c] * xr;
+      }
+      for (unsigned j=0; j<4 && f+j<nfreq; j++) {
+        z.buf[f+j].re = zr[j];
+        z.buf[f+j].im = zi[j];
+      }
+    }
+  }
+
+  void batched_cov_t::filter(float min_lim, float max_lim, mha_spec_t & z) {
+    auto kernel = &filter_bins<0>;
+    switch ( nchan ) {
+    case 1: kernel = &filter_bins<1>; break;
+    case 2: kernel = &filter_bins<2>; break;
+    case 3: kernel = &filter_bins<3>; break;
+    case 4: kernel = &filter_bins<4>; break;
+    case 5: kernel = &filter_bins<5>; break;
+    case 6: kernel = &filter_bins<6>; break;
+    case 7: kernel = &filter_bins<7>; break;
+    case 8: kernel = &filter_bins<8>; break;
+    }
+    kernel(nchan, nfreq_pad, r_re.data(), r_im.data(), p_re.data(), p_im.data(),
+           x_re.data(), x_im.data(), y_re.data(), y_im.data(),
+           min_lim, max_lim, work.data(), z);
+  }
+
+
   rohConfig::rohConfig(const mhaconfig_t in_cfg,const mhaconfig_t out_cfg,
                        std::unique_ptr<MatrixXcf> headModel_,
                        std::unique_ptr<MHASignal::matrix_t> beamW_,
@@ -53,16 +260,10 @@ namespace rohBeam {
     alpha_postfilter( options.alpha_postfilter ),
     alpha_blocking_XkXi( options.alpha_blocking_XkXi ),
     alpha_blocking_XkY( options.alpha_blocking_XkY ),
-    corrXpXp( nfreq, MatrixXcf::Identity(nchan_block,nchan_block)),
-    corrXpYf( nfreq, VectorXcf::Constant(nchan_block,0) ),
+    corrXp( nchan_block, nfreq ),
     corrZZ( VectorXf::Constant(nfreq, 1/nfreq) ),
     corrLL( VectorXf::Constant(nfreq, 1/nfreq) ),
     corrRR( VectorXf::Constant(nfreq, 1/nfreq) ),
-    hhCorrXpXp( nchan_block, nchan_block  ),
-    nextXpYf( nchan_block ),
-    blockXp( nchan_block ),
-    freqResp( nchan_block ),
-    magResp( nchan_block ),
     minLim( pow( 10.0f, -1 )),
     maxLim( pow( 10.0f, 1 ))
   {
@@ -88,16 +289,13 @@ namespace rohBeam {
     alpha_postfilter( options.alpha_postfilter ),
     alpha_blocking_XkXi( options.alpha_blocking_XkXi ),
     alpha_blocking_XkY( options.alpha_blocking_XkY ),
-    corrXpXp( lastConfig->corrXpXp ),
-    corrXpYf( lastConfig->corrXpYf ),
+    //the estimates only carry over if the dimensions stay the same
+    corrXp( lastConfig->corrXp.channels() == unsigned(nchan_block) &&
+            lastConfig->corrXp.bins() == unsigned(nfreq) ?
+            lastConfig->corrXp : batched_cov_t( nchan_block, nfreq ) ),
     corrZZ( lastConfig->corrZZ ),
     corrLL( lastConfig->corrLL ),
     corrRR( lastConfig->corrRR ),
-    hhCorrXpXp( nchan_block, nchan_block ),
-    nextXpYf( nchan_block ),
-    blockXp( nchan_block ), //state doesn't matter
-    freqResp( nchan_block ),
-    magResp( nchan_block ),
     minLim( lastConfig->minLim ), maxLim( lastConfig->maxLim )
   {
     init_dynamic();
@@ -173,76 +371,14 @@ namespace rohBeam {
       }
     }
 
-    //recursive estimation of noise matrices
-    for (int f=0; f<nfreq; f++) {
-
-      std::complex<float> valYf;
-
-      //copy values to Eigen matrices for slices of blocked noise
-      for (int c=0; c<nchan_block; c++) {
-        blockXp(c) = stdcomplex( value( blockSpec, f, c ) );
-      }
-
-      //copy the most recent value from fixed bf output
-      valYf = stdcomplex( value( beam1, f, 0 ) );
-
-      //these operations are taking too long
-      //nextXpXp = blockXp * blockXp.adjoint();
-      nextXpYf = blockXp * conj( valYf );
-
-      //exponential filters
-      //corrXpXp->at(f) = alpha * corrXpXp->at(f) + (1 - alpha) * nextXpXp;
-      corrXpYf[f] = alpha_blocking_XkY * corrXpYf[f] + (1 - alpha_blocking_XkY) * nextXpYf;
-    }
-
-    //alternate form of recursive estimation for X,X
-    mha_complex_t val = mha_complex(0,0);
-    std::complex<float> valC = std::complex<float>(0,0);
-    for (int k=0; k<nchan_block; k++) {
-      for (int i=0; i<nchan_block; i++) {
-        for (int f=0; f<nfreq; f++) {
-          val = blockSpec->value(f,k) * _conjugate( blockSpec->value(f,i) );
-          valC = stdcomplex( val );
-
-          //update value in matrix
-          corrXpXp[f](k,i) = alpha_blocking_XkXi * corrXpXp[f](k,i) + (1 - alpha_blocking_XkXi) * valC;
-        }
-      }
-    }
+    //recursive estimation of noise matrices, all bins at once
+    corrXp.update( *blockSpec, *beam1, alpha_blocking_XkXi, alpha_blocking_XkY );
 
     //save work for the adaptive step if it is not needed
     if ( enable_adaptive_beam ) {
-
-      mha_complex_t freqRespM = mha_complex(0,0);
-
-      for (int f=0; f<nfreq; f++) {
-
-        //Wiener filter design,
-        //solve the linear system, decomposing the matrix to allocated buffer
-        hhCorrXpXp.compute( corrXpXp[f] ); //unnecessary, should be able to update via Sherman-Morrison
-        freqResp = hhCorrXpXp.solve( corrXpYf[f] );
-
-        magResp = freqResp.array().abs();
-
-        for (int c=0; c<nchan_block; c++) {
-          if ( magResp(c) > maxLim )
-            freqResp(c) = std::polar( maxLim, arg(freqResp(c)) );
-          else if ( magResp(c) < minLim )
-            freqResp(c) = std::polar( minLim, arg(freqResp(c)) );
-        }
-
-        //filter the blocked spectrum directly
-        beamA->value(f,0).re = 0;
-        beamA->value(f,0).im = 0;
-
-        for (int c=0; c<nchan_block; c++) {
-          freqRespM = ::set( freqRespM, freqResp(c) );
-          beamA->value(f,0) += _conjugate(freqRespM) * blockSpec->value(f,c);
-        }
-
-        //in_place: compute Z by subtracting: Yf - Ya
-        beamA->value(f,0) = beam1->value(f,0) - beamA->value(f,0);
-      }
+      //Wiener filter design and filtering of the blocked spectrum,
+      //computes Z by subtracting: Yf - Ya
+      corrXp.filter( minLim, maxLim, *beamA );
     }
 
     MHASignal::spectrum_t *prevSpecPost = enable_adaptive_beam ? beamA : beam1;
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Master Hearing Aid (MHA)
 // Copyright © 2012 2013 2014 2015 2016 2017 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -27,6 +27,7 @@
 
 #include "mha_plugin.hh"
 #include "mhasndfile.h"
+#include "mha_simd.hh"
 #define NDEBUG //supposed to speed up Eigen
 
 #include <eigen3/Eigen/Dense>
@@ -56,6 +57,59 @@ namespace rohBeam {
     float alpha_blocking_XkY;
   };
 
+  using MHASimd::v4_t;
+
+  /** Batched small complex matrix engine for the adaptive stage.
+   *
+   * Keeps the recursive estimates of the covariance matrix of the
+   * blocked spectrum X' and of its cross correlation with the fixed
+   * beamformer output Y_f for all frequency bins, and solves the
+   * Wiener filter equation R w = p for all bins.  Real and imaginary
+   * parts are stored in separate arrays with the frequency bin as the
+   * fastest index, padded to a multiple of four bins, so that each lane
+   * of a 4-float vector works on one bin.  Only the lower triangle of
+   * the Hermitian covariance matrices is stored.  The solver uses an
+   * LDL^H decomposition, fully unrolled for 2 to 8 channels. */
+  class batched_cov_t {
+  public:
+    /** Identity covariance and zero cross correlation.
+     * @param nchan Number of channels of the blocked spectrum
+     * @param nfreq Number of frequency bins */
+    batched_cov_t(unsigned nchan, unsigned nfreq);
+    /** Recursive estimation for one block.
+     * @param x Blocked spectrum, nfreq bins, nchan channels
+     * @param y Fixed beamformer output, nfreq bins, 1 channel
+     * @param alpha_xx Filter coefficient for the covariance matrices
+     * @param alpha_xy Filter coefficient for the cross correlation */
+    void update(const mha_spec_t & x, const mha_spec_t & y,
+                float alpha_xx, float alpha_xy);
+    /** Solve R w = p for every bin, limit the magnitudes of w to
+     * [min_lim,max_lim], and compute z = y - w^H x from the signals
+     * of the preceding update().
+     * @param z Output spectrum, nfreq bins, 1 channel */
+    void filter(float min_lim, float max_lim, mha_spec_t & z);
+    /** Covariance matrix element (k,i) of bin f */
+    std::complex<float> cov(unsigned f, unsigned k, unsigned i) const;
+    /** Cross correlation element k of bin f */
+    std::complex<float> xcorr(unsigned f, unsigned k) const;
+    unsigned channels() const {return nchan;}
+    unsigned bins() const {return nfreq;}
+  private:
+    /** Index of the lower triangle element (k,i), k >= i */
+    static unsigned tri(unsigned k, unsigned i) {return k*(k+1)/2 + i;}
+    unsigned nchan;
+    unsigned nfreq;
+    unsigned nfreq_pad;
+    /// Covariance matrices, lower triangle, [element][bin]
+    std::vector<float> r_re, r_im;
+    /// Cross correlation vectors, [channel][bin]
+    std::vector<float> p_re, p_im;
+    /// Blocked spectrum and fixed beamformer output of the last update
+    std::vector<float> x_re, x_im, y_re, y_im;
+    /// Decomposition workspace for channel counts without unrolled kernel
+    std::vector<v4_t> work;
+  };
+
   class rohConfig {
   public:
     rohConfig(const mhaconfig_t in_cfg,const mhaconfig_t out_cfg,
@@ -109,29 +163,15 @@ namespace rohBeam {
     float alpha_blocking_XkXi;
     float alpha_blocking_XkY;
 
-    /* Eigen matrices for recursive estimation of the noise characteristics
+    /* recursive estimation of the noise characteristics
      * of blocking and fixed beamforming residual output */
-    std::vector<Eigen::MatrixXcf> corrXpXp;
-    std::vector<Eigen::VectorXcf> corrXpYf;
+    batched_cov_t corrXp;
 
     //power spectral densities for binaural postfilter
     Eigen::VectorXf corrZZ;
     Eigen::VectorXf corrLL;
     Eigen::VectorXf corrRR;
 
-    //all below is volatile and not important
-
-    //buffer to allocate (in construction) for matrix decomposition
-    //use a householder QR decomposition,
-    //which seems to be fastest (from Eigen docs) w/o special matrix structure
-    Eigen::HouseholderQR<Eigen::MatrixXcf> hhCorrXpXp;
-
-    Eigen::VectorXcf nextXpYf;
-    Eigen::VectorXcf blockXp;
-
-    Eigen::VectorXcf freqResp;
-    Eigen::ArrayXf magResp;
-
     float minLim;
     float maxLim;
   };
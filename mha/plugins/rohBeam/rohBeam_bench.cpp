@@ -0,0 +1,104 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the batched covariance kernels of rohBeam with the per-bin
+// Eigen implementation, 4 channels.
+
+#include "rohBeam.hh"
+#include <chrono>
+#include <iostream>
+
+namespace {
+  /// Reproducible blocked spectrum and fixed beamformer output for block b
+  void fill_signals(MHASignal::spectrum_t & x, MHASignal::spectrum_t & y,
+                    unsigned b) {
+    for (unsigned f = 0; f < x.num_frames; ++f) {
+      for (unsigned c = 0; c < x.num_channels; ++c)
+        x(f,c) = {std::sin(0.37f*f + 1.3f*c + 0.71f*b + 0.1f*c*b),
+                  std::cos(0.29f*f*c + 0.53f*b + c)};
+      y(f,0) = {std::cos(0.41f*f + 0.67f*b), 0.5f*std::sin(0.23f*f*b)};
+    }
+  }
+
+  /// The per-bin Eigen implementation the batched kernels replace
+  struct eigen_reference_t {
+    std::vector<Eigen::MatrixXcf> corrXpXp;
+    std::vector<Eigen::VectorXcf> corrXpYf;
+    eigen_reference_t(unsigned nchan, unsigned nfreq)
+      : corrXpXp(nfreq, Eigen::MatrixXcf::Identity(nchan,nchan)),
+        corrXpYf(nfreq, Eigen::VectorXcf::Constant(nchan,0))
+    {}
+    void update(const mha_spec_t & x, const mha_spec_t & y, float axx, float axy) {
+      for (unsigned f = 0; f < x.num_frames; ++f)
+        for (unsigned k = 0; k < x.num_channels; ++k) {
+          corrXpYf[f](k) = axy * corrXpYf[f](k) +
+            (1 - axy) * stdcomplex(value(x,f,k)) * std::conj(stdcomplex(value(y,f,0)));
+          for (unsigned i = 0; i < x.num_channels; ++i)
+            corrXpXp[f](k,i) = axx * corrXpXp[f](k,i) +
+              (1 - axx) * stdcomplex(value(x,f,k) * _conjugate(value(x,f,i)));
+        }
+    }
+    std::complex<float> filter(const mha_spec_t & x, const mha_spec_t & y,
+                               unsigned f, float min_lim, float max_lim) {
+      Eigen::VectorXcf w = corrXpXp[f].householderQr().solve(corrXpYf[f]);
+      std::complex<float> z = stdcomplex(value(y,f,0));
+      for (unsigned c = 0; c < x.num_channels; ++c) {
+        if (std::abs(w(c)) > max_lim)
+          w(c) = std::polar(max_lim, std::arg(w(c)));
+        else if (std::abs(w(c)) < min_lim)
+          w(c) = std::polar(min_lim, std::arg(w(c)));
+        z -= std::conj(w(c)) * stdcomplex(value(x,f,c));
+      }
+      return z;
+    }
+  };
+}
+
+int main()
+{
+  const unsigned nchan = 4, nfreq = 257, blocks = 2000;
+  rohBeam::batched_cov_t cov(nchan, nfreq);
+  eigen_reference_t ref(nchan, nfreq);
+  MHASignal::spectrum_t x(nfreq, nchan), y(nfreq, 1), z(nfreq, 1);
+  fill_signals(x, y, 0);
+  auto measure = [&](auto && process) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+      process();
+    std::chrono::duration<double> t =
+      std::chrono::steady_clock::now() - start;
+    return t.count() / blocks * 1e6;
+  };
+  const double t_ref = measure([&]{
+    ref.update(x, y, 0.99f, 0.99f);
+    for (unsigned f = 0; f < nfreq; ++f)
+      z(f,0) = ::set(z(f,0), ref.filter(x, y, f, 0.1f, 10.0f));
+  });
+  const double t_cov = measure([&]{
+    cov.update(x, y, 0.99f, 0.99f);
+    cov.filter(0.1f, 10.0f, z);
+  });
+  std::cout << nchan << " channels, " << nfreq << " bins: Eigen "
+            << t_ref << " us/block, batched " << t_cov
+            << " us/block (speedup " << t_ref / t_cov << ")" << std::endl;
+  return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// coding: utf-8-unix
+// c-basic-offset: 2
+// indent-tabs-mode: nil
+// End:
@@ -1,5 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2020 HörTech gGmbH
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -36,6 +37,113 @@ TEST(j0,compare_to_reference){
   }
 }
 
+namespace {
+  /// Reproducible blocked spectrum and fixed beamformer output for block b
+  void fill_signals(MHASignal::spectrum_t & x, MHASignal::spectrum_t & y,
+                    unsigned b) {
+    for (unsigned f = 0; f < x.num_frames; ++f) {
+      for (unsigned c = 0; c < x.num_channels; ++c)
+        x(f,c) = {std::sin(0.37f*f + 1.3f*c + 0.71f*b + 0.1f*c*b),
+                  std::cos(0.29f*f*c + 0.53f*b + c)};
+      y(f,0) = {std::cos(0.41f*f + 0.67f*b), 0.5f*std::sin(0.23f*f*b)};
+    }
+  }
+
+  /// The per-bin Eigen implementation the batched kernels replace
+  struct eigen_reference_t {
+    std::vector<Eigen::MatrixXcf> corrXpXp;
+    std::vector<Eigen::VectorXcf> corrXpYf;
+    eigen_reference_t(unsigned nchan, unsigned nfreq)
+      : corrXpXp(nfreq, Eigen::MatrixXcf::Identity(nchan,nchan)),
+        corrXpYf(nfreq, Eigen::VectorXcf::Constant(nchan,0))
+    {}
+    void update(const mha_spec_t & x, const mha_spec_t & y, float axx, float axy) {
+      for (unsigned f = 0; f < x.num_frames; ++f)
+        for (unsigned k = 0; k < x.num_channels; ++k) {
+          corrXpYf[f](k) = axy * corrXpYf[f](k) +
+            (1 - axy) * stdcomplex(value(x,f,k)) * std::conj(stdcomplex(value(y,f,0)));
+          for (unsigned i = 0; i < x.num_channels; ++i)
+            corrXpXp[f](k,i) = axx * corrXpXp[f](k,i) +
+              (1 - axx) * stdcomplex(value(x,f,k) * _conjugate(value(x,f,i)));
+        }
+    }
+    std::complex<float> filter(const mha_spec_t & x, const mha_spec_t & y,
+                               unsigned f, float min_lim, float max_lim) {
+      Eigen::VectorXcf w = corrXpXp[f].householderQr().solve(corrXpYf[f]);
+      std::complex<float> z = stdcomplex(value(y,f,0));
+      for (unsigned c = 0; c < x.num_channels; ++c) {
+        if (std::abs(w(c)) > max_lim)
+          w(c) = std::polar(max_lim, std::arg(w(c)));
+        else if (std::abs(w(c)) < min_lim)
+          w(c) = std::polar(min_lim, std::arg(w(c)));
+        z -= std::conj(w(c)) * stdcomplex(value(x,f,c));
+      }
+      return z;
+    }
+  };
+}
+
+TEST(batched_cov_t, matches_eigen_implementation){
+  const unsigned nfreq = 11, blocks = 30;
+  const float min_lim = 0.1f, max_lim = 10.0f;
+  // 2 to 8 channels use fixed-size kernels, 1 and 9 the generic one
+  for (unsigned nchan = 1; nchan <= 9; ++nchan) {
+    rohBeam::batched_cov_t cov(nchan, nfreq);
+    eigen_reference_t ref(nchan, nfreq);
+    MHASignal::spectrum_t x(nfreq, nchan), y(nfreq, 1), z(nfreq, 1);
+    for (unsigned b = 0; b < blocks; ++b) {
+      fill_signals(x, y, b);
+      cov.update(x, y, 0.9f, 0.8f);
+      ref.update(x, y, 0.9f, 0.8f);
+    }
+    cov.filter(min_lim, max_lim, z);
+    for (unsigned f = 0; f < nfreq; ++f) {
+      for (unsigned k = 0; k < nchan; ++k) {
+        EXPECT_NEAR(0, std::abs(ref.corrXpYf[f](k) - cov.xcorr(f,k)), 1e-5f);
+        for (unsigned i = 0; i < nchan; ++i)
+          EXPECT_NEAR(0, std::abs(ref.corrXpXp[f](k,i) - cov.cov(f,k,i)), 1e-5f)
+            << "nchan=" << nchan << " f=" << f << " k=" << k << " i=" << i;
+      }
+      const std::complex<float> expected = ref.filter(x, y, f, min_lim, max_lim);
+      EXPECT_NEAR(0, std::abs(expected - stdcomplex(z(f,0))),
+                  1e-3f * std::max(1.0f, std::abs(expected)))
+        << "nchan=" << nchan << " f=" << f;
+    }
+  }
+}
+
+TEST(batched_cov_t, weights_are_limited){
+  // identity covariance, the weights equal the cross correlation
+  rohBeam::batched_cov_t cov(2, 3);
+  MHASignal::spectrum_t x(3, 2), y(3, 1), z(3, 1);
+  x(0,0) = {100, 0};    // |w| = 50, limited to 2
+  x(1,1) = {0, 0.002f}; // |w| = 0.001, raised to 0.5
+  y(0,0) = y(1,0) = y(2,0) = {1, 0};
+  cov.update(x, y, 1.0f, 0.5f);
+  cov.filter(0.5f, 2.0f, z);
+  // bin 0: w = (2, 0.5), z = 1 - 2 * 100
+  EXPECT_NEAR(-199.0f, z(0,0).re, 1e-3f);
+  EXPECT_NEAR(0.0f, z(0,0).im, 1e-6f);
+  // bin 1: w = (0.5, 0.5j), z = 1 - conj(0.5j) * 0.002j
+  EXPECT_NEAR(0.999f, z(1,0).re, 1e-6f);
+  EXPECT_NEAR(0.0f, z(1,0).im, 1e-6f);
+  // bin 2: zero correlation, w = (0.5, 0.5), z = y
+  EXPECT_EQ(1.0f, z(2,0).re);
+}
+
+TEST(batched_cov_t, singular_covariance_gives_finite_output){
+  rohBeam::batched_cov_t cov(3, 5);
+  MHASignal::spectrum_t x(5, 3), y(5, 1), z(5, 1);
+  fill_signals(x, y, 0);
+  // forget the identity initialisation: rank one matrices
+  cov.update(x, y, 0.0f, 0.0f);
+  cov.filter(0.1f, 10.0f, z);
+  for (unsigned f = 0; f < 5; ++f) {
+    EXPECT_TRUE(std::isfinite(z(f,0).re)) << f;
+    EXPECT_TRUE(std::isfinite(z(f,0).im)) << f;
+  }
+}
+
 // Local Variables:
 // compile-command: "make unit-tests"
 // coding: utf-8-unix
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2013 2014 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -33,7 +33,8 @@ namespace smooth_cepstrum {
                       std::vector<float> &_winF0,
                       std::vector<float> &_alpha_const_vals,
                       std::vector<float> &_alpha_const_limits_hz,
-                      std::string &_noisePow_name) :
+                      std::string &_noisePow_name,
+                      bool _batched) :
             in_cfg(_in_cfg),
             xi_min_db(_xi_min_db),
             f0_low(_f0_low), f0_high(_f0_high),
@@ -44,7 +45,8 @@ namespace smooth_cepstrum {
             winF0( _winF0),
             alpha_const_vals( _alpha_const_vals ),
             alpha_const_limits_hz( _alpha_const_limits_hz ),
-            noisePow_name(_noisePow_name)
+            noisePow_name(_noisePow_name),
+            batched(_batched)
         {
         }
 
@@ -65,6 +67,8 @@ namespace smooth_cepstrum {
         std::vector<float> alpha_const_vals;
         std::vector<float> alpha_const_limits_hz;
         std::string noisePow_name;
+        /// Real-valued transforms and vectorized gains, see mode
+        bool batched;
     };
 
     class smooth_cepstrum_t {
@@ -77,6 +81,14 @@ namespace smooth_cepstrum {
         mha_spec_t* process(mha_spec_t*);
 
     private:
+        /** Log of the maximum likelihood estimate of the speech power
+         *  for the elements k to k+count-1 of the bins x channels
+         *  arrays, count <= 4 (batched mode) */
+        inline void ml_log(unsigned k, unsigned count);
+        /** Speech power from the smoothed log spectrum, a priori SNR,
+         *  Wiener gain and GLR for the elements k to k+count-1, count
+         *  <= 4 (batched mode) */
+        inline void gain(unsigned k, unsigned count);
 
         MHA_AC::algo_comm_t & ac;
         smooth_params params;
@@ -109,8 +121,16 @@ namespace smooth_cepstrum {
         MHASignal::waveform_t xi_ml;
         MHASignal::spectrum_t lambda_ml_full;
         MHASignal::spectrum_t lambda_ml_ceps;
+        /// Real cepstrum of all channels, fftlen x nchan
+        MHASignal::waveform_t cepstrum;
         MHASignal::waveform_t lambda_ml_smooth;
 
+        // batched mode: log spectra in the bins x channels layout and
+        // in the channel-major layout of the real transforms
+        MHASignal::waveform_t log_lambda_ml;
+        MHASignal::spectrum_t log_spec_ml;
+        MHASignal::spectrum_t log_spec_smooth;
+
         MHASignal::waveform_t alpha_hat;
         MHASignal::waveform_t alpha_frame;
 
@@ -167,6 +187,7 @@ namespace smooth_cepstrum {
         MHAParser::vfloat_t alpha_const_limits_hz;
 
         MHAParser::string_t noisePow_name;
+        MHAParser::kw_t mode;
 
         //here is a subparser
         MHAParser::parser_t spp;
@@ -0,0 +1,106 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the cost per frame of the full and the batched mode of
+// smooth_cepstrum, 2 channels.
+
+#include "smooth_cepstrum.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+using smooth_cepstrum::smooth_cepstrum_if_t;
+
+namespace {
+    /// Noise spectra with a harmonic tone complex in some of the frames,
+    /// and the matching noise power for the noisePow AC variable
+    class input_t {
+    public:
+        input_t(unsigned fftlen, unsigned channels)
+            : spec(fftlen / 2 + 1, channels), noise_pow(fftlen / 2 + 1, channels)
+        {
+            // periodogram scale of the plugin times the variance of
+            // re and im of the uniform noise
+            noise_pow.assign(level * level * 2.0f / 3.0f * fftlen * fftlen / 2.0f);
+        }
+        const MHASignal::spectrum_t & next() {
+            const unsigned f0_bin = 6 * spec.num_frames / 257;
+            for (unsigned ch = 0; ch < spec.num_channels; ++ch)
+                for (unsigned k = 0; k < spec.num_frames; ++k) {
+                    spec(k, ch) = {level * noise(), level * noise()};
+                    if ((frame / 10) % 2 == 1 && k > 0 && k % (f0_bin + ch) == 0)
+                        spec(k, ch) += mha_complex(0.0f, 20.0f * level);
+                }
+            ++frame;
+            return spec;
+        }
+        MHASignal::spectrum_t spec;
+        MHASignal::waveform_t noise_pow;
+    private:
+        mha_real_t noise() {
+            state = state * 1664525U + 1013904223U;
+            return (state >> 8) / mha_real_t(1 << 23) - 1.0f;
+        }
+        const mha_real_t level = 1e-3f;
+        uint32_t state = 4711U;
+        unsigned frame = 0;
+    };
+
+    mhaconfig_t signal_properties(unsigned channels, unsigned fftlen) {
+        return {.channels = channels, .domain = MHA_SPECTRUM,
+                .fragsize = fftlen / 4, .wndlen = fftlen / 2, .fftlen = fftlen,
+                .srate = 16000};
+    }
+}
+
+int main()
+{
+    const unsigned channels = 2, frames = 5000;
+    for (unsigned fftlen : {256U, 512U, 1024U}) {
+        double t[2];
+        for (unsigned m = 0; m < 2; ++m) {
+            MHA_AC::algo_comm_class_t acspace{};
+            MHA_AC::algo_comm_t & ac {acspace};
+            input_t input(fftlen, channels);
+            MHA_AC::waveform_t noise_pow(ac, "noise_psd_estimator",
+                                         fftlen / 2 + 1, channels, true);
+            noise_pow.copy(input.noise_pow);
+            smooth_cepstrum_if_t plugin(ac, "smooth_cepstrum");
+            plugin.parse(m ? "mode = batched" : "mode = full");
+            mhaconfig_t cf = signal_properties(channels, fftlen);
+            plugin.prepare_(cf);
+            MHASignal::spectrum_t s(input.next());
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned f = 0; f < frames; ++f)
+                plugin.process(&s);
+            std::chrono::duration<double> dt =
+                std::chrono::steady_clock::now() - start;
+            t[m] = dt.count() / frames * 1e6;
+            plugin.release_();
+        }
+        std::cout << "fftlen " << fftlen << ", " << channels
+                  << " channels: full " << t[0] << " us/frame, batched "
+                  << t[1] << " us/frame (speedup " << t[0] / t[1] << ")"
+                  << std::endl;
+    }
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2014 2015 2016 2017 2018 2019 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,6 +15,8 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "steerbf.h"
+#include "mha_simd.hh"
+#include <algorithm>
 
 #define PATCH_VAR(var) patchbay.connect(&var.valuechanged, this, &steerbf::update_cfg)
 #define INSERT_PATCH(var) insert_member(var); PATCH_VAR(var)
@@ -24,50 +26,158 @@ steerbf_config::steerbf_config(MHA_AC::algo_comm_t & ac,
                                steerbf *steerbf) :
   nchan( in_cfg.channels ),
     nfreq( in_cfg.fftlen/2 + 1 ),
-    outSpec( nfreq, 1 ), //mono output
-    bf_vec(  ),
+    nfreq_pad( (nfreq + 3U) / 4U * 4U ),
+    nbeams( std::max(size_t(1), steerbf->beams.data.size()) ),
+    outSpec( nfreq, nbeams ), //one output channel per beam
+    bf_vec( MHA_AC::get_var_spectrum(ac, steerbf->bf_src.data) ),
     //set nangle by counting/inferring number of blocks
     nangle( bf_vec.num_channels / nchan ),
     _steerbf( steerbf ), ac(ac),
-  bf_src_copy( steerbf->bf_src.data )
+  bf_src_copy( steerbf->bf_src.data ),
+  angle_src_copy( steerbf->angle_src.data ),
+  beams_copy( steerbf->beams.data ),
+  interpolate( steerbf->interpolate.data ),
+  table_src( nullptr ),
+  table_re( nangle * nchan * nfreq_pad, 0.0f ),
+  table_im( nangle * nchan * nfreq_pad, 0.0f ),
+  beam_re( nbeams * nchan * nfreq_pad, 0.0f ),
+  beam_im( nbeams * nchan * nfreq_pad, 0.0f ),
+  w_re( nbeams, nullptr ),
+  w_im( nbeams, nullptr ),
+  steered( nbeams, -1.0f ),
+  x_re( nchan * nfreq_pad, 0.0f ),
+  x_im( nchan * nfreq_pad, 0.0f )
 {
+    if ( bf_vec.num_frames != nfreq )
+        throw MHA_Error(__FILE__, __LINE__,
+                        "steerbf: The filters in \"%s\" have %u bins, expected %u.",
+                        bf_src_copy.c_str(), bf_vec.num_frames, nfreq);
+    if ( nangle == 0 || nangle * nchan != bf_vec.num_channels )
+        throw MHA_Error(__FILE__, __LINE__,
+                        "steerbf: The filters in \"%s\" have %u channels,"
+                        " not a multiple of the %u input channels.",
+                        bf_src_copy.c_str(), bf_vec.num_channels, nchan);
+    fill_tables(bf_vec);
     //set the correct upper limit given data
     steerbf->angle_ind.set_max_angle_ind( nangle-1 );
 }
 
 steerbf_config::~steerbf_config() {}
 
+void steerbf_config::fill_tables(const mha_spec_t & bf)
+{
+    for (unsigned int row=0; row<nangle*nchan; ++row)
+        for (unsigned int f=0; f<nfreq; ++f) {
+            table_re[row*nfreq_pad + f] = bf.buf[row*nfreq + f].re;
+            table_im[row*nfreq_pad + f] = bf.buf[row*nfreq + f].im;
+        }
+    table_src = bf.buf;
+    //beams have to select their filters again
+    std::fill(steered.begin(), steered.end(), -1.0f);
+}
+
+void steerbf_config::steer(unsigned int b, mha_real_t angle)
+{
+    if ( angle == steered[b] )
+        return;
+    unsigned int a;
+    mha_real_t frac = 0;
+    if ( interpolate ) {
+        if ( !(angle >= 0 && angle <= nangle-1) )
+            throw MHA_Error(__FILE__, __LINE__,
+                            "steerbf: Steering index %g of beam %u is out of"
+                            " range [0,%u].", angle, b, nangle-1);
+        a = std::min((unsigned int)angle, nangle-1);
+        frac = angle - a;
+    }
+    else {
+        if ( !(angle >= 0 && angle < nangle) )
+            throw MHA_Error(__FILE__, __LINE__,
+                            "steerbf: Steering index %g of beam %u is out of"
+                            " range [0,%u].", angle, b, nangle-1);
+        a = (unsigned int)angle;
+    }
+    const unsigned int n = nchan * nfreq_pad;
+    const mha_real_t * re = &table_re[a * n];
+    const mha_real_t * im = &table_im[a * n];
+    if ( frac == 0 ) {
+        w_re[b] = re;
+        w_im[b] = im;
+    }
+    else {
+        //the filters of the next angle follow directly in the table
+        mha_real_t * bre = &beam_re[b * n];
+        mha_real_t * bim = &beam_im[b * n];
+        for (unsigned int k=0; k<n; ++k) {
+            bre[k] = re[k] + frac * (re[n+k] - re[k]);
+            bim[k] = im[k] + frac * (im[n+k] - im[k]);
+        }
+        w_re[b] = bre;
+        w_im[b] = bim;
+    }
+    steered[b] = angle;
+}
+
 /* live processing class */
 mha_spec_t *steerbf_config::process(mha_spec_t *inSpec)
 {
     bf_vec = MHA_AC::get_var_spectrum(ac, bf_src_copy );
+    if ( bf_vec.buf != table_src ) {
+        //the producer has replaced its filters
+        if ( bf_vec.num_frames != nfreq || bf_vec.num_channels != nangle*nchan )
+            throw MHA_Error(__FILE__, __LINE__,
+                            "steerbf: The dimensions of \"%s\" have changed"
+                            " (%u bins, %u channels), set bf_src to reconfigure.",
+                            bf_src_copy.c_str(), bf_vec.num_frames,
+                            bf_vec.num_channels);
+        fill_tables(bf_vec);
+    }
     //if angle_src is set, then retrieve steering from AC variable
-    //otherwise use the configuration variable
-    int angle_ind;
-    if ( _steerbf->angle_src.data.compare("") != 0 ) {
-        // angle_ind = MHA_AC::get_var_int(ac, _steerbf->angle_src.data );
-        const mha_wave_t angle_ind_wave = MHA_AC::get_var_waveform(ac, _steerbf->angle_src.data);
-        angle_ind = (int)value(angle_ind_wave, 0, 0);
+    //otherwise use the configuration variables
+    if ( angle_src_copy.compare("") != 0 ) {
+        const mha_wave_t angle_ind_wave = MHA_AC::get_var_waveform(ac, angle_src_copy );
+        const unsigned int nind = angle_ind_wave.num_frames * angle_ind_wave.num_channels;
+        if ( nind < nbeams )
+            throw MHA_Error(__FILE__, __LINE__,
+                            "steerbf: \"%s\" provides %u steering indices, but"
+                            " there are %u beams.", angle_src_copy.c_str(),
+                            nind, nbeams);
+        for (unsigned int b=0; b<nbeams; ++b)
+            steer(b, angle_ind_wave.buf[b]);
+    }
+    else if ( beams_copy.size() ) {
+        for (unsigned int b=0; b<nbeams; ++b)
+            steer(b, beams_copy[b]);
     }
     else {
-        angle_ind = _steerbf->angle_ind.data;
+        steer(0, _steerbf->angle_ind.data);
     }
-    int block_ind = angle_ind*nchan;
-
-    // std::cout << _steerbf->bf_src.data << std::endl;
 
-    //do the filtering and summing
-    for (unsigned int f=0; f<nfreq; f++) {
-
-        // std::cout << "freq: " << f << std::endl;
-        //init output to zero
-        outSpec(f,0).re = 0;
-        outSpec(f,0).im = 0;
+    //split the input into real and imaginary parts, shared by all beams
+    for (unsigned int m=0; m<nchan; ++m)
+        for (unsigned int f=0; f<nfreq; ++f) {
+            x_re[m*nfreq_pad + f] = value(inSpec,f,m).re;
+            x_im[m*nfreq_pad + f] = value(inSpec,f,m).im;
+        }
 
-        for (unsigned int m=0; m<nchan; ++m) {
-            //outSpec(f,0) += _conjugate((*beamW)(f,m)) * value(inSpec,f,m);
-            outSpec(f,0) += _conjugate(value(bf_vec,f,m+block_ind)) * value(inSpec,f,m);
-            // std::cout << "c: " << m << ": " << value(bf_vec,f,m+block_ind).re << " " << value(bf_vec,f,m+block_ind).im << std::endl;
+    //do the filtering and summing, conj(w) * x, four bins at a time
+    for (unsigned int f=0; f<nfreq; f+=4U) {
+        const unsigned int nbins = std::min(4U, nfreq - f);
+        for (unsigned int b=0; b<nbeams; ++b) {
+            MHASimd::v4_t yr = {}, yi = {};
+            for (unsigned int m=0; m<nchan; ++m) {
+                const unsigned int k = m*nfreq_pad + f;
+                const MHASimd::v4_t xr = MHASimd::load(&x_re[k]);
+                const MHASimd::v4_t xi = MHASimd::load(&x_im[k]);
+                const MHASimd::v4_t wr = MHASimd::load(w_re[b] + k);
+                const MHASimd::v4_t wi = MHASimd::load(w_im[b] + k);
+                yr += wr * xr + wi * xi;
+                yi += wr * xi - wi * xr;
+            }
+            for (unsigned int j=0; j<nbins; ++j) {
+                outSpec(f+j,b).re = yr[j];
+                outSpec(f+j,b).im = yi[j];
+            }
         }
     }
 
@@ -79,14 +189,23 @@ steerbf::steerbf(MHA_AC::algo_comm_t & iac, const std::string &)
     : MHAPlugin::plugin_t<steerbf_config>("Steerable Beamformer",iac),
       bf_src("Provides the beamforming filters encoded as a block matrix: [chanXnangle,nfreq].", ""),
       angle_ind("Sets the steering angle in filtering.", "0", "[0,1000]"),
-      angle_src("If initialized, provides an int-AC variable of steering index.","")
+      angle_src("If initialized, provides an int-AC variable of steering index.",""),
+      beams("Steering indices of simultaneous beams, one output channel each.\n"
+            "If empty, a single beam is steered by angle_ind or angle_src.\n"
+            "With angle_src, the AC variable provides one index per beam.",
+            "[]"),
+      interpolate("Interpolate between the filters of neighbouring angles\n"
+                  "for fractional steering indices, otherwise truncate them.",
+                  "no")
 {
     //only make a new configuration when bf_src changes
     INSERT_PATCH(bf_src);
 
     //otherwise, the processing plugins query for the current angles
     insert_member(angle_ind);
-    insert_member(angle_src);
+    INSERT_PATCH(angle_src);
+    INSERT_PATCH(beams);
+    INSERT_PATCH(interpolate);
 }
 
 steerbf::~steerbf() {}
@@ -110,8 +229,8 @@ void steerbf::prepare(mhaconfig_t & signal_info)
         throw MHA_Error(__FILE__, __LINE__,
                         "This plugin can only process spectrum signals.");
 
-    //set output dimension
-    signal_info.channels = 1;
+    //set output dimension: one channel per beam
+    signal_info.channels = std::max(size_t(1), beams.data.size());
 
     /* make sure that a valid runtime configuration exists: */
     update_cfg();
@@ -120,6 +239,11 @@ void steerbf::prepare(mhaconfig_t & signal_info)
 void steerbf::update_cfg()
 {
     if ( is_prepared() ) {
+        if ( std::max(size_t(1), beams.data.size()) != output_cfg().channels )
+            throw MHA_Error(__FILE__, __LINE__,
+                            "steerbf: The number of beams cannot change while"
+                            " prepared (%zu beams, prepared for %u).",
+                            beams.data.size(), output_cfg().channels);
 
         //when necessary, make a new configuration instance
         //possibly based on changes in parser variables
@@ -172,6 +296,19 @@ MHAPLUGIN_DOCUMENTATION\
  " AC variable for the estimated steering direction. "
  "The steering angle can also be fixed in the configuration time using the"
  " configuration variable \\textbf{angle\\_ind}."
+ "\n\n"
+ "Several beams can be computed from the same input in one pass by setting"
+ " \\textbf{beams} to a vector of steering indices, one output channel is"
+ " produced for each beam.  With \\textbf{angle\\_src}, the AC variable then"
+ " has to provide one steering index per beam."
+ " If \\textbf{interpolate} is set, fractional steering indices select"
+ " filters interpolated linearly between the two neighbouring angles,"
+ " otherwise fractional indices are truncated."
+ "\n\n"
+ "The filters of all angles are copied from the AC variable into internal"
+ " tables when the configuration is created and whenever the AC variable"
+ " is replaced by a new buffer, e.g.\\ after a reconfiguration of"
+ " {\\tt acSteer}.  Filters which are modified in place are not noticed."
  )
 
 
@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2014 2017 2018 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -32,6 +32,16 @@ public:
     }
 };
 
+/** Runtime configuration of steerbf.
+ *
+ * The filters of all steering angles are copied from the AC variable
+ * into angle tables with separate real and imaginary parts (structure
+ * of arrays), one row of bins for each angle and microphone.  The
+ * input spectrum is split the same way once per block, then all
+ * beams are computed in one pass over groups of four bins.  Beams
+ * steered to fractional angle indices use filters interpolated from
+ * the two neighbouring angle tables into preallocated per-beam
+ * tables, recomputed only when the index changes. */
 class steerbf_config {
 
 public:
@@ -42,14 +52,36 @@ public:
     mha_spec_t* process(mha_spec_t*);
 
 private:
+    /** Copy the filters from the AC variable into the angle tables */
+    void fill_tables(const mha_spec_t & bf);
+    /** Select the filters of beam b for steering index angle */
+    void steer(unsigned int b, mha_real_t angle);
     unsigned int nchan;
     unsigned int nfreq;
+    /// Number of bins rounded up to a multiple of 4
+    unsigned int nfreq_pad;
+    unsigned int nbeams;
     MHASignal::spectrum_t outSpec;
     mha_spec_t bf_vec;
     unsigned int nangle;
     steerbf *_steerbf;
     MHA_AC::algo_comm_t & ac;
     std::string bf_src_copy;
+    std::string angle_src_copy;
+    std::vector<float> beams_copy;
+    bool interpolate;
+    /// Buffer of the AC variable the angle tables were filled from
+    const mha_complex_t * table_src;
+    /// Real and imaginary parts of the filters, [angle][mic][bin]
+    std::vector<mha_real_t> table_re, table_im;
+    /// Interpolated filters, [beam][mic][bin]
+    std::vector<mha_real_t> beam_re, beam_im;
+    /// Filters used for each beam: rows of the angle or beam tables
+    std::vector<const mha_real_t*> w_re, w_im;
+    /// Steering index each beam was last steered to
+    std::vector<mha_real_t> steered;
+    /// Real and imaginary parts of the input, [mic][bin]
+    std::vector<mha_real_t> x_re, x_im;
 };
 
 //this plugin does its own real-time processing
@@ -66,6 +98,8 @@ public:
     MHAParser::string_t bf_src;
     parser_int_dyn angle_ind;
     MHAParser::string_t angle_src;
+    MHAParser::vfloat_t beams;
+    MHAParser::bool_t interpolate;
 
 private:
     void update_cfg();
@@ -0,0 +1,77 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares one pass of steerbf over all beams with the original scalar
+// loop once per beam, 8 microphones and 8 beams.
+
+#include "steerbf.h"
+#include "mha_algo_comm.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+int main()
+{
+    const unsigned nchan = 8, nangle = 16, fftlen = 512;
+    const unsigned nfreq = fftlen / 2 + 1, nbeams = 8, blocks = 20000;
+    MHA_AC::algo_comm_class_t acspace{};
+    MHA_AC::algo_comm_t & ac {acspace};
+    MHA_AC::spectrum_t filters(ac, "filters", nfreq, nchan * nangle, true);
+    for (unsigned k = 0; k < nfreq * nchan * nangle; ++k)
+        filters.buf[k] = {std::sin(0.3f * k), std::cos(0.7f * k)};
+    MHASignal::spectrum_t input(nfreq, nchan);
+    for (unsigned k = 0; k < nfreq * nchan; ++k)
+        input.buf[k] = {std::cos(0.11f * k), std::sin(0.5f * k)};
+    steerbf bf{ac, "steerbf"};
+    bf.parse("bf_src = filters");
+    bf.parse("beams = [0 2 4 6 8 10 12 14]");
+    mhaconfig_t cf = {.channels = nchan, .domain = MHA_SPECTRUM,
+                      .fragsize = fftlen / 2, .wndlen = fftlen,
+                      .fftlen = fftlen, .srate = 16000};
+    bf.prepare_(cf);
+    MHASignal::spectrum_t y(nfreq, nbeams);
+    auto measure = [&](auto && process) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned b = 0; b < blocks; ++b)
+            process();
+        std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        return t.count() / blocks * 1e6;
+    };
+    const double t_ref = measure([&]{
+        for (unsigned b = 0; b < nbeams; ++b)
+            for (unsigned f = 0; f < nfreq; ++f) {
+                y(f, b).re = 0;
+                y(f, b).im = 0;
+                for (unsigned m = 0; m < nchan; ++m)
+                    y(f, b) += _conjugate(filters(f, 2 * b * nchan + m))
+                        * input(f, m);
+            }
+    });
+    const double t_bf = measure([&]{bf.process(&input);});
+    bf.release_();
+    std::cout << nchan << " mics, " << nbeams << " beams, " << nfreq
+              << " bins: scalar loops " << t_ref << " us/block, steerbf "
+              << t_bf << " us/block (speedup " << t_ref / t_bf << ")"
+              << std::endl;
+    return 0;
+}
+
+// Local Variables:
+// compile-command: "make benchmarks"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
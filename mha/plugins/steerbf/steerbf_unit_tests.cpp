@@ -0,0 +1,171 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include "steerbf.h"
+#include "mha_algo_comm.hh"
+#include <cmath>
+#include <memory>
+
+class steerbf_testing : public ::testing::Test {
+public:
+    MHA_AC::algo_comm_class_t acspace{};
+    MHA_AC::algo_comm_t & ac {acspace};
+    unsigned nchan = 3, nangle = 4, fftlen = 18;
+    unsigned nfreq = fftlen / 2 + 1;
+    std::unique_ptr<MHA_AC::spectrum_t> filters;
+    std::unique_ptr<MHASignal::spectrum_t> input;
+    steerbf bf{ac, "steerbf"};
+
+    /// Insert reproducible filters and input with the current dimensions
+    void create_signals(float seed = 0.0f) {
+        filters = std::make_unique<MHA_AC::spectrum_t>(ac, "filters", nfreq,
+                                                       nchan * nangle, true);
+        for (unsigned k = 0; k < nfreq * nchan * nangle; ++k)
+            filters->buf[k] = {std::sin(0.3f * k + seed),
+                               std::cos(0.7f * k + seed)};
+        input = std::make_unique<MHASignal::spectrum_t>(nfreq, nchan);
+        for (unsigned k = 0; k < nfreq * nchan; ++k)
+            input->buf[k] = {std::cos(0.11f * k), std::sin(0.5f * k)};
+        bf.parse("bf_src = filters");
+    }
+
+    mhaconfig_t signal_properties() const {
+        return {.channels = nchan, .domain = MHA_SPECTRUM, .fragsize = 8,
+                .wndlen = 16, .fftlen = fftlen, .srate = 16000};
+    }
+
+    /// Filter and sum like the original scalar loop, angle index a
+    mha_complex_t reference(unsigned f, unsigned a) const {
+        mha_complex_t y = {0, 0};
+        for (unsigned m = 0; m < nchan; ++m)
+            y += _conjugate((*filters)(f, a * nchan + m)) * (*input)(f, m);
+        return y;
+    }
+
+    void expect_beam(const mha_spec_t * out, unsigned b, unsigned a) {
+        for (unsigned f = 0; f < nfreq; ++f) {
+            EXPECT_NEAR(reference(f, a).re, value(out, f, b).re, 1e-5f);
+            EXPECT_NEAR(reference(f, a).im, value(out, f, b).im, 1e-5f);
+        }
+    }
+
+    void TearDown() override {
+        if (bf.is_prepared())
+            bf.release_();
+    }
+};
+
+TEST_F(steerbf_testing, single_beam_matches_reference)
+{
+    create_signals();
+    bf.parse("angle_ind = 2");
+    mhaconfig_t cf = signal_properties();
+    bf.prepare_(cf);
+    EXPECT_EQ(1U, cf.channels);
+    mha_spec_t * out = bf.process(input.get());
+    expect_beam(out, 0, 2);
+    // the angle index is read in every block
+    bf.parse("angle_ind = 3");
+    expect_beam(bf.process(input.get()), 0, 3);
+    EXPECT_THROW(bf.parse("angle_ind = 4"), MHA_Error);
+}
+
+TEST_F(steerbf_testing, several_beams_in_one_pass)
+{
+    nchan = 8;
+    fftlen = 30;
+    nfreq = fftlen / 2 + 1;
+    create_signals();
+    bf.parse("beams = [0 3 1 1]");
+    mhaconfig_t cf = signal_properties();
+    bf.prepare_(cf);
+    EXPECT_EQ(4U, cf.channels);
+    mha_spec_t * out = bf.process(input.get());
+    ASSERT_EQ(4U, out->num_channels);
+    expect_beam(out, 0, 0);
+    expect_beam(out, 1, 3);
+    expect_beam(out, 2, 1);
+    expect_beam(out, 3, 1);
+    bf.parse("beams = [2 2 2 0]");
+    expect_beam(bf.process(input.get()), 1, 2);
+    EXPECT_THROW(bf.parse("beams = [1 2]"), MHA_Error);
+}
+
+TEST_F(steerbf_testing, fractional_indices_interpolate_filters)
+{
+    create_signals();
+    bf.parse("beams = [1.25 3]");
+    bf.parse("interpolate = yes");
+    mhaconfig_t cf = signal_properties();
+    bf.prepare_(cf);
+    mha_spec_t * out = bf.process(input.get());
+    for (unsigned f = 0; f < nfreq; ++f) {
+        const mha_complex_t expected =
+            reference(f, 1) * 0.75f + reference(f, 2) * 0.25f;
+        EXPECT_NEAR(expected.re, value(out, f, 0).re, 1e-5f);
+        EXPECT_NEAR(expected.im, value(out, f, 0).im, 1e-5f);
+    }
+    expect_beam(out, 1, 3);
+    bf.parse("interpolate = no");
+    out = bf.process(input.get());
+    expect_beam(out, 0, 1);
+    // truncated index 3 is valid, but 3.5 is beyond the last angle
+    bf.parse("beams = [1.25 3.5]");
+    expect_beam(bf.process(input.get()), 1, 3);
+    bf.parse("interpolate = yes");
+    EXPECT_THROW(bf.process(input.get()), MHA_Error);
+}
+
+TEST_F(steerbf_testing, angle_src_provides_one_index_per_beam)
+{
+    create_signals();
+    MHA_AC::waveform_t angles(ac, "angles", 1, 2, true);
+    angles.buf[0] = 3;
+    angles.buf[1] = 0;
+    bf.parse("angle_src = angles");
+    bf.parse("beams = [0 0]");
+    mhaconfig_t cf = signal_properties();
+    bf.prepare_(cf);
+    mha_spec_t * out = bf.process(input.get());
+    expect_beam(out, 0, 3);
+    expect_beam(out, 1, 0);
+    angles.buf[1] = 2;
+    expect_beam(bf.process(input.get()), 1, 2);
+    angles.buf[1] = 4;
+    EXPECT_THROW(bf.process(input.get()), MHA_Error);
+}
+
+TEST_F(steerbf_testing, replaced_filters_are_read_again)
+{
+    create_signals();
+    bf.parse("angle_ind = 1");
+    mhaconfig_t cf = signal_properties();
+    bf.prepare_(cf);
+    bf.process(input.get());
+    // the producer replaces its AC variable by a new buffer
+    create_signals(1.0f);
+    expect_beam(bf.process(input.get()), 0, 1);
+    nangle = 2;
+    create_signals();
+    EXPECT_THROW(bf.process(input.get()), MHA_Error);
+}
+
+// Local Variables:
+// compile-command: "make unit-tests"
+// c-basic-offset: 4
+// indent-tabs-mode: nil
+// coding: utf-8-unix
+// End:
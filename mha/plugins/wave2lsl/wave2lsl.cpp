@@ -1,6 +1,6 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2018 2019 2020 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,12 +15,16 @@
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mha_plugin.hh"
+#include "mha_fifo.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-compare"
 #include "lsl_cpp.h"
 #pragma GCC diagnostic pop
 
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <pthread.h>
 #include <sched.h>
 
@@ -38,6 +42,30 @@ namespace wave2lsl{
         lsl::stream_info info;
         /** LSL stream outlet. Interface to lsl */
         lsl::stream_outlet stream;
+
+        /** Number of samples of all channels in one block */
+        const unsigned block_size;
+        /** Audio samples waiting for the send thread, nullptr if blocks
+         * are sent from the processing thread */
+        std::unique_ptr<mha_fifo_lf_t<mha_real_t>> samples;
+        /** LSL time of each block waiting for the send thread */
+        std::unique_ptr<mha_fifo_lf_t<double>> timestamps;
+        /** Contiguous buffer for one block in the send thread */
+        std::vector<mha_real_t> sendbuf;
+        /** Waiting time of the send thread between batches in ms */
+        const unsigned send_period_ms;
+        /** Number of blocks discarded because the send buffer was full */
+        std::atomic<uint64_t> dropped;
+        /** Tells the send thread to terminate */
+        std::atomic<bool> stop_request;
+        /** Wakes up the send thread early when it has to terminate */
+        mha_fifo_wakeup_t wakeup;
+        /** Pushes the buffered blocks to LSL in async mode */
+        std::thread sender;
+        /** Main loop of the send thread */
+        void send_thread();
+        /** Push all buffered blocks to LSL.  Called by the send thread. */
+        void send_stored();
     public:
 
         /** C'tor of wave2lsl run time configuration
@@ -49,11 +77,22 @@ namespace wave2lsl{
          * @param rate           Rate with wich chunks of data are sent to the LSL
          *                       stream.  Usually the rate with which process calls
          *                       happen, but may be lower due to the subsampling
-         *                       caused by skip_ */
+         *                       caused by skip_
+         * @param fifolen        Capacity of the send buffer in blocks.
+         *                       0: push to LSL from the processing thread.
+         *                       Otherwise, the processing thread only copies
+         *                       the audio, and a background thread pushes
+         *                       it to LSL.
+         * @param send_rate      Number of batched pushes per second of the
+         *                       background thread */
         cfg_t(unsigned skip_, unsigned num_channels_, unsigned num_samples_,
               const std::string& source_id, const std::string varname_,
-              double rate);
+              double rate, unsigned fifolen = 0, double send_rate = 100);
+        /** Terminates the send thread after pushing the remaining blocks */
+        ~cfg_t();
         void process(mha_wave_t *s);
+        /** Number of blocks discarded because the send buffer was full */
+        uint64_t get_dropped() const {return dropped.load();}
 
     };
 
@@ -71,11 +110,17 @@ namespace wave2lsl{
     private:
         /** Construct new runtime configuration */
         void update();
+        /** Copy the number of discarded blocks to the monitor variable */
+        void update_dropped();
         MHAParser::string_t name;
         MHAParser::string_t source_id;
         MHAParser::bool_t rt_strict;
         MHAParser::bool_t activate;
         MHAParser::int_t skip;
+        MHAParser::bool_t async;
+        MHAParser::int_t fifolen;
+        MHAParser::float_t send_rate;
+        MHAParser::int_mon_t dropped;
         MHAEvents::patchbay_t<wave2lsl_t> patchbay;
         bool is_first_run;
     };
@@ -88,6 +133,13 @@ wave2lsl::wave2lsl_t::wave2lsl_t(MHA_AC::algo_comm_t & iac, const std::string &)
     rt_strict("Abort if used in real-time thread?","yes"),
     activate("Send frames to network?","yes"),
     skip("Number of frames to skip after sending","0","[0,]"),
+    async("Copy blocks into a lock-free buffer and push them to LSL\n"
+          "from a background thread instead of the processing thread.","no"),
+    fifolen("Capacity of the send buffer in blocks (async mode).","64","[1,]"),
+    send_rate("Number of batched pushes to LSL per second (async mode).",
+              "100","[0.01,1000]"),
+    dropped("Number of blocks discarded in async mode because the send\n"
+            "buffer was full."),
     is_first_run(true)
 {
     insert_member(name);
@@ -95,6 +147,10 @@ wave2lsl::wave2lsl_t::wave2lsl_t(MHA_AC::algo_comm_t & iac, const std::string &)
     insert_member(rt_strict);
     insert_member(activate);
     insert_member(skip);
+    insert_member(async);
+    insert_member(fifolen);
+    insert_member(send_rate);
+    insert_member(dropped);
     //Nota bene: Activate should not be connected to the patchbay because we skip processing
     //in the plugin class when necessary. If activate used update() as callback, streams
     //would get recreated everytime activate is toggled.
@@ -102,6 +158,9 @@ wave2lsl::wave2lsl_t::wave2lsl_t(MHA_AC::algo_comm_t & iac, const std::string &)
     patchbay.connect(&rt_strict.writeaccess,this,&wave2lsl_t::update);
     patchbay.connect(&skip.writeaccess,this,&wave2lsl_t::update);
     patchbay.connect(&name.writeaccess,this,&wave2lsl_t::update);
+    patchbay.connect(&fifolen.writeaccess,this,&wave2lsl_t::update);
+    patchbay.connect(&send_rate.writeaccess,this,&wave2lsl_t::update);
+    patchbay.connect(&dropped.prereadaccess,this,&wave2lsl_t::update_dropped);
 }
 
 void wave2lsl::wave2lsl_t::prepare(mhaconfig_t&)
@@ -109,12 +168,14 @@ void wave2lsl::wave2lsl_t::prepare(mhaconfig_t&)
     try {
         name.setlock(true);
         rt_strict.setlock(true);
+        async.setlock(true);
 
         update();
     }
     catch(MHA_Error& e){
         name.setlock(false);
         rt_strict.setlock(false);
+        async.setlock(false);
         throw;
     }
 }
@@ -123,13 +184,15 @@ void wave2lsl::wave2lsl_t::release()
 {
     is_first_run=true;
     rt_strict.setlock(false);
+    async.setlock(false);
     name.setlock(false);
 }
 
 mha_wave_t* wave2lsl::wave2lsl_t::process(mha_wave_t* s)
 {
     if(is_first_run){
-        if(rt_strict.data)
+        // In async mode, the processing thread does not call LSL
+        if(rt_strict.data and not async.data)
             {
                 is_first_run=false;
                 pthread_t this_thread=pthread_self();
@@ -161,27 +224,86 @@ void wave2lsl::wave2lsl_t::update(){
                          input_cfg().fragsize,
                          source_id.data,
                          name.data,
-                         input_cfg().srate/input_cfg().fragsize/(skip.data+1.0f));
+                         input_cfg().srate/input_cfg().fragsize/(skip.data+1.0f),
+                         async.data ? fifolen.data : 0,
+                         send_rate.data);
 
         push_config(c);
     }
 }
 
+void wave2lsl::wave2lsl_t::update_dropped(){
+    auto latest_cfg=peek_config();
+    if(latest_cfg)
+        dropped.data=latest_cfg->get_dropped();
+}
+
 
 wave2lsl::cfg_t::cfg_t(unsigned skip_, unsigned num_channels_,
                        unsigned num_samples_, const std::string& source_id_,
-                       const std::string varname_, double rate_):
+                       const std::string varname_, double rate_,
+                       unsigned fifolen_, double send_rate_):
     skipcnt(skip_),
     skip(skip_),
     info(varname_, "MHA_AC_MHAREAL", num_channels_, rate_, lsl::cf_float32, source_id_),
-    stream(info, num_samples_)
+    stream(info, num_samples_),
+    block_size(num_channels_*num_samples_),
+    send_period_ms(std::max(1U, static_cast<unsigned>(1000 / send_rate_))),
+    dropped(0U),
+    stop_request(false)
 {
+    if(fifolen_){
+        samples=std::make_unique<mha_fifo_lf_t<mha_real_t>>(fifolen_*block_size);
+        timestamps=std::make_unique<mha_fifo_lf_t<double>>(fifolen_);
+        sendbuf.resize(block_size);
+        sender=std::thread(&cfg_t::send_thread,this);
+    }
+}
+
+wave2lsl::cfg_t::~cfg_t(){
+    if(sender.joinable()){
+        stop_request.store(true);
+        wakeup.signal();
+        sender.join();
+    }
+}
+
+void wave2lsl::cfg_t::send_thread(){
+    while(!stop_request.load()){
+        wakeup.wait(send_period_ms);
+        send_stored();
+    }
+    // Push blocks stored before the configuration was replaced
+    send_stored();
+}
+
+void wave2lsl::cfg_t::send_stored(){
+    const unsigned count=timestamps->get_fill_count();
+    for(unsigned k=0; k<count; ++k){
+        double timestamp;
+        timestamps->read(&timestamp,1);
+        samples->read(sendbuf.data(),block_size);
+        // Transmit once per batch
+        stream.push_chunk_multiplexed(sendbuf.data(),block_size,timestamp,
+                                      k+1==count);
+    }
 }
 
 void wave2lsl::cfg_t::process(mha_wave_t *s){
 
     if(!skipcnt){
-        stream.push_chunk_multiplexed(s->buf, s->num_frames * s->num_channels, 0.0, true);
+        if(samples){
+            if(samples->get_available_space()>=block_size and
+               timestamps->get_available_space()>=1U){
+                const double timestamp=lsl::local_clock();
+                samples->write(s->buf,block_size);
+                timestamps->write(&timestamp,1);
+            }
+            else
+                dropped.fetch_add(1U,std::memory_order_relaxed);
+        }
+        else
+            stream.push_chunk_multiplexed(s->buf, s->num_frames * s->num_channels, 0.0, true);
 
         skipcnt=skip;
     }
@@ -204,7 +326,16 @@ MHAPLUGIN_DOCUMENTATION\
  " data type, or any configuration variable is not possible.\n"
  " Sending data over the network is not real-time safe and\n"
  " processing will be aborted if this plugin is used in a\n"
- " real-time thread without user override.")
+ " real-time thread without user override.\n"
+ " With async=yes, the processing thread only copies each block into"
+ " a lock-free send buffer (capacity fifolen blocks) together with the"
+ " current LSL time, and a background thread pushes the buffered blocks"
+ " to LSL send\\_rate times per second, triggering network transmission"
+ " once per batch.  Pushing to LSL can block or take locks; in async mode"
+ " this no longer affects the processing thread, and async mode may be"
+ " used in a real-time thread.  Blocks that do not fit into the send"
+ " buffer are discarded and counted in the monitor variable"
+ " \"dropped\".")
 
 /*
  * Local variables:
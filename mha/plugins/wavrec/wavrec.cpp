@@ -1,7 +1,7 @@
 // This file is part of the HörTech Open Master Hearing Aid (openMHA)
 // Copyright © 2010 2011 2012 2013 2014 2015 2016 2018 2019 2020 HörTech gGmbH
 // Copyright © 2021 HörTech gGmbH
-// Copyright © 2022 Hörzentrum Oldenburg gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
 //
 // openMHA is free software: you can redistribute it and/or modify
 // it under the terms of the GNU Affero General Public License as published by
@@ -15,59 +15,7 @@
 // You should have received a copy of the GNU Affero General Public License, 
 // version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <time.h>
-#include <pthread.h>
-#include "mha_plugin.hh"
-#include "mha_fifo.h"
-#include <sndfile.h>
-#include <sys/time.h>
-#include <atomic>
-
-class wavwriter_t {
-public:
-    wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
-                const std::string& prefix,bool use_date, const std::string& format_name_);
-    ~wavwriter_t();
-    void process(mha_wave_t*);
-    void exit_request();
-private:
-    static void* write_thread(void* this_){((wavwriter_t*)this_)->write_thread();return NULL;};
-    void write_thread();
-    void create_soundfile(const std::string& prefix, bool use_date);
-    /** Converts the format_name string to the corresponding int according to libsndfile and
-     *  writes it into the format field of sf_info
-     *  throws if no format of this name is available
-     * @param sf_info Destination sf_info struct for the format
-     * @throw MHA_Error If no sample format of name format_name is offered by libsndfile
-     */
-    void set_format(SF_INFO& sf_info);
-    std::atomic<bool> close_session;
-    bool act_;
-    mhaconfig_t cf_;
-    SNDFILE* sf;
-    mha_fifo_lf_t<mha_real_t> fifo;
-    unsigned int minw_;
-    pthread_t writethread;
-    float* data;
-    std::string format_name;
-};
-
-class wavrec_t : public MHAPlugin::plugin_t<wavwriter_t> {
-public:
-    mha_wave_t* process(mha_wave_t*);
-    void prepare(mhaconfig_t& cf);
-    void release();
-    wavrec_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
-private:
-    void start_new_session();
-    MHAParser::bool_t record;
-    MHAParser::int_t fifolen;
-    MHAParser::int_t minwrite;
-    MHAParser::string_t prefix;
-    MHAParser::bool_t use_date;
-    MHAParser::kw_t output_sample_format;
-    MHAEvents::patchbay_t<wavrec_t> patchbay;
-};
+#include "wavrec.hh"
 
 wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
                    const std::string & configured_name)
@@ -82,7 +30,15 @@ wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
       prefix("Path (including path delimiter) and file prefix", ""),
       use_date("Use date and time (yes), or only prefix (no)", "yes"),
       output_sample_format("Output sample format", "32_bit_float",
-                           "[32_bit_float]")
+                           "[32_bit_float]"),
+      fileformat("Output file format: sound file (wav) or MHA recording"
+                 " file (mhrec)", "wav", "[wav mhrec]"),
+      compress("Compress MHA recording files", "no"),
+      fifo_high_water("Maximum fill count of the FIFO in samples during the"
+                      " current\nrecording session.  Should stay below"
+                      " fifolen."),
+      dropped_frames("Number of audio frames that were discarded during the"
+                     "\ncurrent recording session because the FIFO was full.")
 {
   // make the plug-in findable via "?listid"
   set_node_id(configured_name);
@@ -93,7 +49,15 @@ wavrec_t::wavrec_t(MHA_AC::algo_comm_t & iac,
   insert_member(use_date);
   insert_member(record);
   insert_member(output_sample_format);
+  insert_member(fileformat);
+  insert_member(compress);
+  insert_member(fifo_high_water);
+  insert_member(dropped_frames);
   patchbay.connect(&record.writeaccess, this, &wavrec_t::start_new_session);
+  patchbay.connect(&fifo_high_water.prereadaccess, this,
+                   &wavrec_t::update_monitors);
+  patchbay.connect(&dropped_frames.prereadaccess, this,
+                   &wavrec_t::update_monitors);
   int count(0);
   sf_command(NULL, SFC_GET_FORMAT_SUBTYPE_COUNT, &count, sizeof(int));
   for (int k = 0; k < count; k++) {
@@ -124,12 +88,22 @@ void wavrec_t::release()
         latest_cfg->exit_request();
 }
 
+void wavrec_t::update_monitors()
+{
+    auto latest_cfg=peek_config();
+    if(latest_cfg){
+        fifo_high_water.data = latest_cfg->get_fifo_high_water();
+        dropped_frames.data = latest_cfg->get_dropped_frames();
+    }
+}
+
 void wavrec_t::start_new_session()
 {
     auto latest_cfg=peek_config();
     if(latest_cfg)
         latest_cfg->exit_request();
-    push_config(new wavwriter_t(record.data,input_cfg(),fifolen.data,minwrite.data,prefix.data,use_date.data,output_sample_format.data.get_value()));
+    push_config(new wavwriter_t(record.data,input_cfg(),fifolen.data,minwrite.data,prefix.data,use_date.data,output_sample_format.data.get_value(),
+                                fileformat.data.get_index() == 1,compress.data));
 }
 
 void wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
@@ -154,6 +128,15 @@ void wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
         MHAParser::strreplace(fname,"Sun "," ");
         MHAParser::strreplace(fname," ","_");
     }
+    if( mhrec ){
+        MHARecFile::stream_info_t stream;
+        stream.name = "audio";
+        stream.ndim = cf_.channels;
+        stream.rate = cf_.srate;
+        recfile.reset(new MHARecFile::writer_t(prefix+fname+".mhrec",
+                                               {stream},compress));
+        return;
+    }
     fname = prefix+fname+".wav";
     SF_INFO sfinfo;
     memset(&sfinfo,0,sizeof(sfinfo));
@@ -168,16 +151,72 @@ void wavwriter_t::create_soundfile(const std::string& prefix, bool use_date)
         throw MHA_Error(__FILE__,__LINE__,"Unable to create sound file %s: %s",fname.c_str(),sf_strerror(sf));
 }
 
+frame_index_t::frame_index_t(unsigned capacity)
+    : gaps(capacity),
+      pending{0U,0U},
+      stored_frames(0U),
+      next_gap{0U,0U},
+      has_next_gap(false),
+      read_frames(0U),
+      skipped_frames(0U)
+{
+}
+
+void frame_index_t::stored(unsigned frames)
+{
+    if( frames == 0U )
+        return;
+    // If the writer thread lags behind by more gaps than fit into the
+    // fifo, the pending gap is passed on later and takes effect a few
+    // frames too late.
+    if( pending.frames && gaps.get_available_space() ){
+        gaps.write(&pending,1U);
+        pending.frames = 0U;
+    }
+    stored_frames += frames;
+}
+
+void frame_index_t::dropped(unsigned frames)
+{
+    if( pending.frames == 0U )
+        pending.position = stored_frames;
+    pending.frames += frames;
+}
+
+unsigned frame_index_t::next_block(unsigned frames, uint64_t & index)
+{
+    for(;;){
+        if( !has_next_gap && gaps.get_fill_count() ){
+            gaps.read(&next_gap,1U);
+            has_next_gap = true;
+        }
+        if( !has_next_gap || (next_gap.position > read_frames) )
+            break;
+        skipped_frames += next_gap.frames;
+        has_next_gap = false;
+    }
+    if( has_next_gap && (next_gap.position < read_frames + frames) )
+        frames = next_gap.position - read_frames;
+    index = read_frames + skipped_frames;
+    read_frames += frames;
+    return frames;
+}
+
 wavwriter_t::wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
-                         const std::string& prefix, bool use_date, const std::string& format_name_)
+                         const std::string& prefix, bool use_date, const std::string& format_name_,
+                         bool mhrec_, bool compress_)
     : close_session(false),
       act_(active),
       cf_(cf),
       sf(NULL),
       fifo(fifosize),
       minw_(minwrite),
+      fifo_high_water(0U),
+      dropped_frames(0U),
       data(new float[fifosize]),
-      format_name(format_name_)
+      format_name(format_name_),
+      mhrec(mhrec_),
+      compress(compress_)
 {
     if(minw_ >= fifosize )
         throw MHA_Error(__FILE__,__LINE__,"minwrite must be less then fifosize (minwrite: %u, fifosize: %u)",minw_,fifosize);
@@ -191,6 +230,12 @@ wavwriter_t::wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize
 
 wavwriter_t::~wavwriter_t()
 {
+    try {
+        exit_request();
+    }
+    catch(MHA_Error&){
+        // A destructor cannot report a failure to close the file.
+    }
     delete [] data;
 }
 
@@ -198,7 +243,22 @@ void wavwriter_t::process(mha_wave_t* s)
 {
     if( act_ ){
         auto nSamps=(fifo.get_available_space()/cf_.channels)*cf_.channels; // only write multiples of channels
-        fifo.write(s->buf,std::min(nSamps,size(s)));
+        nSamps=std::min(nSamps,size(s));
+        if( mhrec )
+            frame_index.stored(nSamps/cf_.channels);
+        fifo.write(s->buf,nSamps);
+        if( nSamps < size(s) ){
+            const unsigned dropped = (size(s)-nSamps)/cf_.channels;
+            dropped_frames.fetch_add(dropped, std::memory_order_relaxed);
+            if( mhrec )
+                frame_index.dropped(dropped);
+        }
+        const unsigned fill =
+            fifo.get_max_fill_count() - fifo.get_available_space();
+        if( fill > fifo_high_water.load(std::memory_order_relaxed) )
+            fifo_high_water.store(fill, std::memory_order_relaxed);
+        if( fill > minw_ )
+            wakeup.notify();
     }
 }
 
@@ -206,30 +266,62 @@ void wavwriter_t::exit_request(){
     if(!close_session.load()){
         close_session.store(true);
         if( act_ ){
+            wakeup.signal();
             pthread_join(writethread,NULL);
         }
         if( sf ){
             sf_close(sf);
             sf=nullptr;
         }
+        if( recfile ){
+            recfile->close();
+            recfile=nullptr;
+        }
     }
     return;
 }
 
+void wavwriter_t::write_frames(unsigned int frames)
+{
+    if( sf )
+        sf_writef_float(sf,data,frames);
+    if( recfile ){
+        recdata.assign(data,data+frames*cf_.channels);
+        // Blocks end at gaps, the next block starts at a higher index
+        for( unsigned offset = 0; offset < frames; ){
+            uint64_t index = 0;
+            const unsigned n = frame_index.next_block(frames-offset,index);
+            recfile->write_block(0,index,n,index/(double)cf_.srate,
+                                 recdata.data()+offset*cf_.channels);
+            offset += n;
+        }
+    }
+}
+
 void wavwriter_t::write_thread()
 {
-    while(!close_session.load()){
-        mha_msleep(1);
-        if( sf && (fifo.get_fill_count() > minw_) ){
+    try {
+        while(!close_session.load()){
+            // Arm before checking, so that a notification from the
+            // processing thread between check and wait is not lost.
+            wakeup.arm();
+            if( (fifo.get_fill_count() <= minw_) && !close_session.load() )
+                wakeup.wait();
+            if( (sf || recfile) && (fifo.get_fill_count() > minw_) ){
+                unsigned int frames = fifo.get_fill_count()/cf_.channels;
+                fifo.read(data,frames*cf_.channels);
+                write_frames(frames);
+            }
+        }
+        if( (sf || recfile) && fifo.get_fill_count() ){
             unsigned int frames = fifo.get_fill_count()/cf_.channels;
             fifo.read(data,frames*cf_.channels);
-            sf_writef_float(sf,data,frames);
+            write_frames(frames);
         }
     }
-    if( sf && fifo.get_fill_count() ){
-        unsigned int frames = fifo.get_fill_count()/cf_.channels;
-        fifo.read(data,frames*cf_.channels);
-        sf_writef_float(sf,data,frames);
+    catch(MHA_Error&){
+        // The recording file cannot be written.  Stop writing; the fifo
+        // fills up and further audio is discarded.
     }
 }
 
@@ -265,7 +357,17 @@ MHAPLUGIN_DOCUMENTATION\
  " amount of time until the file is actually closed and ready for further processing. \n"
  " The name (and path) of the output file is chosen by the prefix configuration variable. By default the current"
  " date and time are appended to the file name, this behaviour can be controlled by the \"use\\_date\" variable.\n"
- "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged.")
+ "With \"fileformat=mhrec\", the audio signal is written to an MHA recording file with file name extension"
+ " \".mhrec\" instead of a wave file. The recording file stores the samples as doubles in blocks, each with"
+ " the index of its first sample and the corresponding time in seconds since the start of the recording,"
+ " and can be read with random access by the functions in mha/tools/python/openMHA/mhrec.py and"
+ " mha/tools/mfiles/mha\\_read\\_mhrec.m. Audio frames discarded because the fifo was full leave a"
+ " gap in the indices of consecutive blocks. Setting \"compress\" to yes compresses the blocks with a fast"
+ " LZ-type compression.\n"
+ "The \"fifolen\" and \"minwrite\" variables control the behaviour of the fifo buffer and should usually remain unchanged."
+ " The disk writer thread sleeps until more than \"minwrite\" samples are waiting in the fifo."
+ " The monitor variables \"fifo\\_high\\_water\" and \"dropped\\_frames\" report the maximum fifo fill count"
+ " and the number of discarded audio frames of the current recording session.")
 
 /*
  * Local Variables:
@@ -0,0 +1,142 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2010 2011 2012 2013 2014 2015 2016 2018 2019 2020 HörTech gGmbH
+// Copyright © 2021 HörTech gGmbH
+// Copyright © 2022 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License, 
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <time.h>
+#include <pthread.h>
+#include "mha_plugin.hh"
+#include "mha_fifo.h"
+#include "mha_recfile.hh"
+#include <sndfile.h>
+#include <sys/time.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Positions of the audio frames discarded by the processing thread.
+ * The writer thread uses them to advance the frame index of the blocks in
+ * an MHA recording file, so that the gaps are visible in the file. */
+class frame_index_t {
+public:
+    /// @param capacity Maximum number of gaps not yet seen by the writer
+    explicit frame_index_t(unsigned capacity = 16U);
+    /** Processing thread: frames are about to be written to the fifo.
+     * Must be called before the fifo write, so that the writer thread
+     * sees preceding gaps before the frames.  Real-time safe. */
+    void stored(unsigned frames);
+    /// Processing thread: frames were discarded.  Real-time safe.
+    void dropped(unsigned frames);
+    /** Writer thread: determine the index of the next frames read from
+     * the fifo.
+     * @param frames Number of frames read from the fifo and not yet
+     *               written.
+     * @param index  Receives the frame index of the first frame in the
+     *               recording file.
+     * @return Number of frames that can be written as one block at index,
+     *         at least 1 if frames is not 0. */
+    unsigned next_block(unsigned frames, uint64_t & index);
+private:
+    struct gap_t {
+        /// Number of frames stored before the gap
+        uint64_t position;
+        /// Number of frames discarded at this position
+        uint64_t frames;
+    };
+    mha_fifo_lf_t<gap_t> gaps;
+    /// Processing thread: gap not yet passed to the writer thread
+    gap_t pending;
+    /// Processing thread: number of frames stored in the fifo
+    uint64_t stored_frames;
+    /// Writer thread: next gap, read from gaps before it is reached
+    gap_t next_gap;
+    /// Writer thread: whether next_gap is valid
+    bool has_next_gap;
+    /// Writer thread: number of frames read from the fifo
+    uint64_t read_frames;
+    /// Writer thread: number of frames discarded before read_frames
+    uint64_t skipped_frames;
+};
+
+class wavwriter_t {
+public:
+    wavwriter_t(bool active,const mhaconfig_t& cf,unsigned int fifosize,unsigned int minwrite,
+                const std::string& prefix,bool use_date, const std::string& format_name_,
+                bool mhrec_ = false, bool compress_ = false);
+    ~wavwriter_t();
+    void process(mha_wave_t*);
+    void exit_request();
+    /// Maximum fifo fill count in samples after any process callback
+    unsigned get_fifo_high_water() const {return fifo_high_water.load();}
+    /// Number of audio frames discarded because the fifo was full
+    uint64_t get_dropped_frames() const {return dropped_frames.load();}
+private:
+    static void* write_thread(void* this_){((wavwriter_t*)this_)->write_thread();return NULL;};
+    void write_thread();
+    /// Write frames from data to the sound file or recording file
+    void write_frames(unsigned int frames);
+    void create_soundfile(const std::string& prefix, bool use_date);
+    /** Converts the format_name string to the corresponding int according to libsndfile and
+     *  writes it into the format field of sf_info
+     *  throws if no format of this name is available
+     * @param sf_info Destination sf_info struct for the format
+     * @throw MHA_Error If no sample format of name format_name is offered by libsndfile
+     */
+    void set_format(SF_INFO& sf_info);
+    std::atomic<bool> close_session;
+    bool act_;
+    mhaconfig_t cf_;
+    SNDFILE* sf;
+    mha_fifo_lf_t<mha_real_t> fifo;
+    unsigned int minw_;
+    /// Wakes up the writer thread when more than minw_ samples are waiting
+    mha_fifo_wakeup_t wakeup;
+    std::atomic<unsigned> fifo_high_water;
+    std::atomic<uint64_t> dropped_frames;
+    pthread_t writethread;
+    float* data;
+    std::string format_name;
+    /// Write an MHA recording file instead of a sound file
+    bool mhrec;
+    bool compress;
+    /// Output file in MHA recording format
+    std::unique_ptr<MHARecFile::writer_t> recfile;
+    /// Conversion buffer for the MHA recording file
+    std::vector<double> recdata;
+    /// Frame indices of the MHA recording file
+    frame_index_t frame_index;
+};
+
+class wavrec_t : public MHAPlugin::plugin_t<wavwriter_t> {
+public:
+    mha_wave_t* process(mha_wave_t*);
+    void prepare(mhaconfig_t& cf);
+    void release();
+    wavrec_t(MHA_AC::algo_comm_t & iac, const std::string & configured_name);
+private:
+    void start_new_session();
+    void update_monitors();
+    MHAParser::bool_t record;
+    MHAParser::int_t fifolen;
+    MHAParser::int_t minwrite;
+    MHAParser::string_t prefix;
+    MHAParser::bool_t use_date;
+    MHAParser::kw_t output_sample_format;
+    MHAParser::kw_t fileformat;
+    MHAParser::bool_t compress;
+    MHAParser::int_mon_t fifo_high_water;
+    MHAParser::int_mon_t dropped_frames;
+    MHAEvents::patchbay_t<wavrec_t> patchbay;
+};
@@ -0,0 +1,93 @@
+// This file is part of the HörTech Open Master Hearing Aid (openMHA)
+// Copyright © 2026 Hörzentrum Oldenburg gGmbH
+//
+// openMHA is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published by
+// the Free Software Foundation, version 3 of the License.
+//
+// openMHA is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License, version 3 for more details.
+//
+// You should have received a copy of the GNU Affero General Public License,
+// version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wavrec.hh"
+#include <gtest/gtest.h>
+
+TEST(frame_index_t, counts_read_frames_without_gaps)
+{
+    frame_index_t frame_index;
+    uint64_t index = 99U;
+    frame_index.stored(15U);
+    EXPECT_EQ(10U, frame_index.next_block(10U, index));
+    EXPECT_EQ(0U, index);
+    EXPECT_EQ(5U, frame_index.next_block(5U, index));
+    EXPECT_EQ(10U, index);
+}
+
+TEST(frame_index_t, splits_blocks_at_gaps_and_skips_dropped_frames)
+{
+    frame_index_t frame_index;
+    uint64_t index = 99U;
+    frame_index.stored(4U);
+    frame_index.stored(4U);
+    frame_index.dropped(2U);
+    frame_index.dropped(1U);
+    frame_index.stored(2U);
+    EXPECT_EQ(8U, frame_index.next_block(10U, index));
+    EXPECT_EQ(0U, index);
+    EXPECT_EQ(2U, frame_index.next_block(2U, index));
+    EXPECT_EQ(11U, index);
+}
+
+TEST(frame_index_t, skips_frames_dropped_before_the_first_block)
+{
+    frame_index_t frame_index;
+    uint64_t index = 99U;
+    frame_index.dropped(5U);
+    frame_index.stored(4U);
+    EXPECT_EQ(4U, frame_index.next_block(4U, index));
+    EXPECT_EQ(5U, index);
+}
+
+TEST(frame_index_t, gap_after_last_read_frame_advances_next_block)
+{
+    frame_index_t frame_index;
+    uint64_t index = 99U;
+    frame_index.stored(4U);
+    frame_index.dropped(2U);
+    EXPECT_EQ(4U, frame_index.next_block(4U, index));
+    EXPECT_EQ(0U, index);
+    frame_index.stored(3U);
+    EXPECT_EQ(3U, frame_index.next_block(3U, index));
+    EXPECT_EQ(6U, index);
+}
+
+TEST(frame_index_t, gap_that_did_not_fit_is_skipped_late)
+{
+    // Room for one gap only: the second gap reaches the writer after the
+    // frames that follow it, but still before later frames.
+    frame_index_t frame_index(1U);
+    uint64_t index = 99U;
+    frame_index.stored(1U);
+    frame_index.dropped(1U);
+    frame_index.stored(1U);
+    frame_index.dropped(1U);
+    frame_index.stored(1U);
+    EXPECT_EQ(1U, frame_index.next_block(3U, index));
+    EXPECT_EQ(0U, index);
+    EXPECT_EQ(2U, frame_index.next_block(2U, index));
+    EXPECT_EQ(2U, index);
+    frame_index.stored(1U);
+    EXPECT_EQ(1U, frame_index.next_block(1U, index));
+    EXPECT_EQ(5U, index);
+}
+
+/*
+ * Local Variables:
+ * compile-command: "make unit-tests"
+ * c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,246 @@
+function [data, info] = mha_read_mhrec( filename, stream, first_frame, count )
+% MHA_READ_MHREC - read frames from an MHA recording file (.mhrec)
+%
+% MHA recording files are written by the plugins acsave (streaming mode),
+% acrec and wavrec (fileformat=mhrec). Only the blocks containing the
+% requested frames are read from the file.
+%
+% Usage:
+% [data, info] = mha_read_mhrec( filename )
+% [data, info] = mha_read_mhrec( filename, stream [, first_frame, count ] )
+%
+% - filename    : name of the recording file
+% - stream      : stream name (e.g. AC variable name) or stream number
+%                 starting at 1
+% - first_frame : index of first frame to read, as stored in the file,
+%                 starting at 0 (default: 0)
+% - count       : number of frame indices to read (default: inf)
+%
+% - data        : structure with the fields
+%                 index - frame indices of the frames read (column)
+%                 time  - time of each frame in seconds (column)
+%                 value - frames, one row per frame
+%                 Frames that were not recorded (dropped) are omitted.
+%                 Without stream argument, data contains one such
+%                 structure per stream, with the stream names as fields.
+% - info        : structure with the fields streams (name, ndim,
+%                 is_complex, rate) and blocks (offset, stream, nframes,
+%                 first_frame, timestamp), and has_index (0 if the file
+%                 was not closed properly and the blocks were scanned).
+
+% This file is part of the HörTech Open Master Hearing Aid (openMHA)
+% Copyright © 2022 Hörzentrum Oldenburg gGmbH
+%
+% openMHA is free software: you can redistribute it and/or modify
+% it under the terms of the GNU Affero General Public License as published by
+% the Free Software Foundation, version 3 of the License.
+%
+% openMHA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU Affero General Public License, version 3 for more details.
+%
+% You should have received a copy of the GNU Affero General Public License,
+% version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+  if nargin < 3
+    first_frame = 0;
+  end
+  if nargin < 4
+    count = inf;
+  end
+  fid = fopen(filename, 'r', 'native');
+  if fid < 0
+    error('Unable to open file %s', filename);
+  end
+  try
+    info = read_info(fid);
+    if nargin < 2
+      data = struct;
+      for k=1:numel(info.streams)
+        data.(info.streams(k).name) = ...
+            read_stream(fid, info, k, first_frame, count);
+      end
+    else
+      if ischar(stream)
+        stream = strmatch(stream, {info.streams.name}, 'exact');
+        if isempty(stream)
+          error('No such stream in %s', filename);
+        end
+      end
+      data = read_stream(fid, info, stream, first_frame, count);
+    end
+  catch err
+    fclose(fid);
+    rethrow(err);
+  end
+  fclose(fid);
+
+function info = read_info( fid )
+  if ~strcmp(fread(fid, [1 8], '*char'), 'MHAREC01')
+    error('Not an MHA recording file');
+  end
+  nstreams = fread(fid, 1, 'uint32');
+  info.streams = struct('name', {}, 'ndim', {}, 'is_complex', {}, ...
+                        'rate', {});
+  for k=1:nstreams
+    ndim = fread(fid, 1, 'uint32');
+    is_complex = fread(fid, 1, 'uint32');
+    rate = fread(fid, 1, 'double');
+    namelen = fread(fid, 1, 'uint32');
+    name = fread(fid, [1 namelen], '*char');
+    info.streams(k) = struct('name', name, 'ndim', ndim, ...
+                             'is_complex', is_complex, 'rate', rate);
+  end
+  header_end = ftell(fid);
+  fseek(fid, 0, 'eof');
+  file_size = ftell(fid);
+  info.has_index = 0;
+  if file_size >= header_end + 24
+    fseek(fid, file_size - 24, 'bof');
+    index_offset = double(fread(fid, 1, '*uint64'));
+    entries = double(fread(fid, 1, '*uint64'));
+    magic = fread(fid, [1 8], '*char');
+    if strcmp(magic, 'MHAIDX01') && ...
+          (entries * 32 + 24 + index_offset == file_size)
+      fseek(fid, index_offset, 'bof');
+      raw = fread(fid, [32 entries], '*uint8');
+      info.blocks = struct( ...
+          'offset', num2cell(field(raw, 1:8, 'uint64')), ...
+          'stream', num2cell(field(raw, 9:12, 'uint32') + 1), ...
+          'nframes', num2cell(field(raw, 13:16, 'uint32')), ...
+          'first_frame', num2cell(field(raw, 17:24, 'uint64')), ...
+          'timestamp', num2cell(field(raw, 25:32, 'double')));
+      info.has_index = 1;
+    end
+  end
+  if ~info.has_index
+    info.blocks = scan_blocks(fid, info, header_end, file_size);
+  end
+
+function values = field( raw, rows, type )
+  % extract one numeric field from the columns of raw bytes
+  values = double(typecast(reshape(raw(rows,:), [], 1), type))';
+
+function blocks = scan_blocks( fid, info, pos, file_size )
+  blocks = struct('offset', {}, 'stream', {}, 'nframes', {}, ...
+                  'first_frame', {}, 'timestamp', {});
+  while pos + 32 <= file_size
+    fseek(fid, pos, 'bof');
+    head = fread(fid, [32 1], '*uint8');
+    stream = double(typecast(head(1:4), 'uint32')) + 1;
+    nframes = double(typecast(head(5:8), 'uint32'));
+    codec = double(typecast(head(25:28), 'uint32'));
+    payload = double(typecast(head(29:32), 'uint32'));
+    if (stream > numel(info.streams)) || (codec > 1) || ...
+          (payload > file_size - pos - 32)
+      break;
+    end
+    if (codec == 0) && (payload ~= 8 * nframes * frame_size(info, stream))
+      break;
+    end
+    blocks(end+1) = struct('offset', pos, 'stream', stream, ...
+                           'nframes', nframes, ...
+                           'first_frame', ...
+                           double(typecast(head(9:16), 'uint64')), ...
+                           'timestamp', typecast(head(17:24), 'double'));
+    pos = pos + 32 + payload;
+  end
+
+function n = frame_size( info, stream )
+  n = info.streams(stream).ndim * (1 + (info.streams(stream).is_complex ~= 0));
+
+function data = read_stream( fid, info, stream, first_frame, count )
+  last_frame = first_frame + count;
+  n = frame_size(info, stream);
+  rate = info.streams(stream).rate;
+  data = struct('index', zeros(0,1), 'time', zeros(0,1), ...
+                'value', zeros(0,info.streams(stream).ndim));
+  blocks = info.blocks([info.blocks.stream] == stream);
+  [tmp, order] = sort([blocks.first_frame]);
+  blocks = blocks(order);
+  for block=blocks
+    if (block.first_frame >= last_frame) || ...
+          (block.first_frame + block.nframes <= first_frame)
+      continue;
+    end
+    fseek(fid, block.offset, 'bof');
+    head = fread(fid, [32 1], '*uint8');
+    codec = double(typecast(head(25:28), 'uint32'));
+    payload = double(typecast(head(29:32), 'uint32'));
+    bytes = fread(fid, [payload 1], '*uint8');
+    values = block.nframes * n;
+    if codec == 1
+      shuffled = lz_decompress(bytes, 8 * values);
+      % undo the byte shuffle
+      bytes = reshape(reshape(shuffled, values, 8)', [], 1);
+    end
+    frames = reshape(typecast(bytes, 'double'), n, block.nframes)';
+    if info.streams(stream).is_complex
+      frames = frames(:,1:2:end) + 1i * frames(:,2:2:end);
+    end
+    idx = (max(first_frame, block.first_frame) : ...
+           min(last_frame, block.first_frame + block.nframes) - 1)';
+    offsets = idx - block.first_frame;
+    if rate > 0
+      time = block.timestamp + offsets / rate;
+    else
+      time = block.timestamp * ones(size(idx));
+    end
+    data.index = [data.index; idx];
+    data.time = [data.time; time];
+    data.value = [data.value; frames(offsets+1,:)];
+  end
+
+function dst = lz_decompress( src, size )
+  % decoder for the LZ4 block format
+  dst = zeros(size, 1, 'uint8');
+  ip = 1;
+  op = 0;
+  n = numel(src);
+  while ip <= n
+    token = double(src(ip));
+    ip = ip + 1;
+    literals = bitshift(token, -4);
+    if literals == 15
+      b = 255;
+      while b == 255
+        b = double(src(ip));
+        ip = ip + 1;
+        literals = literals + b;
+      end
+    end
+    dst(op+1:op+literals) = src(ip:ip+literals-1);
+    ip = ip + literals;
+    op = op + literals;
+    if ip > n
+      break;
+    end
+    offset = double(src(ip)) + 256 * double(src(ip+1));
+    ip = ip + 2;
+    len = bitand(token, 15);
+    if len == 15
+      b = 255;
+      while b == 255
+        b = double(src(ip));
+        ip = ip + 1;
+        len = len + b;
+      end
+    end
+    len = len + 4;
+    if (offset == 0) || (offset > op)
+      error('Corrupt compressed data: invalid offset');
+    end
+    if offset >= len
+      dst(op+1:op+len) = dst(op-offset+1:op-offset+len);
+    else
+      % overlapping copy repeats the last offset bytes
+      for k=1:len
+        dst(op+k) = dst(op-offset+k);
+      end
+    end
+    op = op + len;
+  end
+  if op ~= size
+    error('Corrupt compressed data: size mismatch');
+  end
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# This file is part of the HörTech Open Master Hearing Aid (openMHA)
+# Copyright © 2026 Hörzentrum Oldenburg gGmbH
+#
+# openMHA is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# openMHA is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License, version 3 for more details.
+#
+# You should have received a copy of the GNU Affero General Public License,
+# version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Load test for the TCP control interface of a running MHA.
+
+Simulates many clients that poll values (e.g. level monitors) as fast as
+possible, optionally together with one client that repeatedly issues a
+long-running command, and reports the query rate and response latency
+percentiles of the polling clients.  Compare an MHA started with and
+without --query-threads to see the effect of the query snapshot.
+
+Example:
+  mha_query_load_test.py --port 33337 --clients 32 --duration 10 \\
+      --query mha.transducers.mhaconfig_in?val \\
+      --slow-command '?save:/dev/null'
+"""
+
+import argparse
+import socket
+import threading
+import time
+
+
+def connect(host, port):
+    """Open a connection to the MHA and return a file-like object."""
+    sock = socket.create_connection((host, port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return sock, sock.makefile('rb')
+
+
+def command(sock, reader, line):
+    """Send one command line and read the response up to the acknowledgement.
+
+    Returns True if MHA acknowledged success."""
+    sock.sendall(line.encode() + b'\n')
+    while True:
+        response = reader.readline()
+        if not response:
+            raise ConnectionError('MHA closed the connection')
+        if response.startswith(b'(MHA:success)'):
+            return True
+        if response.startswith(b'(MHA:failure)'):
+            return False
+
+
+def poll(args, queries, stop, latencies, failures):
+    sock, reader = connect(args.host, args.port)
+    k = 0
+    try:
+        while not stop.is_set():
+            start = time.perf_counter()
+            if not command(sock, reader, queries[k % len(queries)]):
+                failures.append(queries[k % len(queries)])
+            latencies.append(time.perf_counter() - start)
+            k += 1
+    finally:
+        sock.close()
+
+
+def run_slow_command(args, stop, durations):
+    sock, reader = connect(args.host, args.port)
+    try:
+        while not stop.is_set():
+            start = time.perf_counter()
+            command(sock, reader, args.slow_command)
+            durations.append(time.perf_counter() - start)
+    finally:
+        sock.close()
+
+
+def percentile(values, p):
+    values = sorted(values)
+    if not values:
+        return float('nan')
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Load test for the MHA TCP control interface')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=33337)
+    parser.add_argument('--clients', type=int, default=16,
+                        help='number of polling clients')
+    parser.add_argument('--duration', type=float, default=5.0,
+                        help='test duration in seconds')
+    parser.add_argument('--query', action='append',
+                        help='query polled by the clients (repeatable, '
+                        'default: nchannels_in?val)')
+    parser.add_argument('--slow-command',
+                        help='command issued repeatedly by an additional '
+                        'client, e.g. "?save:/dev/null"')
+    args = parser.parse_args()
+    queries = args.query or ['nchannels_in?val']
+
+    stop = threading.Event()
+    latencies = [[] for _ in range(args.clients)]
+    failures = []
+    slow_durations = []
+    threads = [threading.Thread(target=poll,
+                                args=(args, queries, stop, latencies[k],
+                                      failures))
+               for k in range(args.clients)]
+    if args.slow_command:
+        threads.append(threading.Thread(target=run_slow_command,
+                                        args=(args, stop, slow_durations)))
+    for thread in threads:
+        thread.start()
+    time.sleep(args.duration)
+    stop.set()
+    for thread in threads:
+        thread.join()
+
+    all_latencies = [l for client in latencies for l in client]
+    print('clients: {}  queries: {}  rate: {:.0f} queries/s  failed: {}'
+          .format(args.clients, len(all_latencies),
+                  len(all_latencies) / args.duration, len(failures)))
+    print('latency [ms]: median {:.2f}  p99 {:.2f}  max {:.2f}'
+          .format(1e3 * percentile(all_latencies, 50),
+                  1e3 * percentile(all_latencies, 99),
+                  1e3 * max(all_latencies, default=float('nan'))))
+    print('slowest client: {} queries'
+          .format(min(len(client) for client in latencies)))
+    if args.slow_command:
+        print('slow command: {} executions, median {:.2f} ms'
+              .format(len(slow_durations),
+                      1e3 * percentile(slow_durations, 50)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# This file is part of the HörTech Open Master Hearing Aid (openMHA)
+# Copyright © 2026 Hörzentrum Oldenburg gGmbH
+#
+# openMHA is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# openMHA is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License, version 3 for more details.
+#
+# You should have received a copy of the GNU Affero General Public License,
+# version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Loopback throughput benchmark for the MHAIOTCP sound io library.
+
+Connects to a prepared MHA that uses iolib=MHAIOTCP, sends silent audio
+as fast as the MHA returns it and reports the number of audio blocks
+processed per second, the real-time factor and the round trip times.
+The protocol (stream or framed) is taken from the header sent by the
+MHA.  With the framed protocol, --batch blocks are sent in each frame.
+Up to --depth requests are in flight at the same time.
+
+Example:
+  mha io.protocol=framed io.unix_socket=/tmp/mha.sock ... cmd=start &
+  mha_tcp_audio_benchmark.py --unix /tmp/mha.sock --batch 8 --duration 5
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+FRAME_HEADER = struct.Struct('=IId')
+
+
+def connect(args):
+    if args.unix:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(args.unix)
+    else:
+        sock = socket.create_connection((args.host, args.port))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return sock
+
+
+def read_header(sock):
+    """Read the header lines up to the blank line, return them as dict."""
+    data = b''
+    while b'\n\n' not in data:
+        chunk = sock.recv(1)
+        if not chunk:
+            raise ConnectionError('MHA closed the connection')
+        data += chunk
+    header = {}
+    for line in data.decode().splitlines()[1:]:
+        if '=' in line:
+            key, value = line.split('=', 1)
+            header[key] = value
+    return header
+
+
+def receive(sock, count):
+    buf = bytearray(count)
+    view = memoryview(buf)
+    pos = 0
+    while pos < count:
+        n = sock.recv_into(view[pos:])
+        if n == 0:
+            raise ConnectionError('MHA closed the connection')
+        pos += n
+    return buf
+
+
+def percentile(values, p):
+    values = sorted(values)
+    if not values:
+        return float('nan')
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Loopback throughput benchmark for MHAIOTCP')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=33338)
+    parser.add_argument('--unix', help='path of a Unix domain socket '
+                        '(MHAIOTCP variable unix_socket)')
+    parser.add_argument('--batch', type=int, default=1,
+                        help='blocks per frame (framed protocol only)')
+    parser.add_argument('--depth', type=int, default=1,
+                        help='number of frames in flight')
+    parser.add_argument('--duration', type=float, default=5.0,
+                        help='test duration in seconds')
+    args = parser.parse_args()
+
+    sock = connect(args)
+    header = read_header(sock)
+    fragsize = int(header['fragsize'])
+    nch_in = int(header['nchannels_in'])
+    nch_out = int(header['nchannels_out'])
+    srate = float(header['srate'])
+    framed = header.get('protocol') == 'framed'
+    batch = args.batch if framed else 1
+    if framed and batch > int(header['max_batch']):
+        parser.error('--batch exceeds max_batch={}'.format(
+            header['max_batch']))
+    payload_in = bytes(4 * fragsize * nch_in * batch)
+    bytes_out = 4 * fragsize * nch_out * batch
+    if framed:
+        bytes_out += FRAME_HEADER.size
+
+    sent_times = {}
+    rtts = []
+    sequence = 0
+    received = 0
+    start = time.perf_counter()
+    end = start + args.duration
+    while True:
+        now = time.perf_counter()
+        while now < end and len(sent_times) < args.depth:
+            if framed:
+                sock.sendall(FRAME_HEADER.pack(sequence, batch, now)
+                             + payload_in)
+            else:
+                sock.sendall(payload_in)
+            sent_times[sequence] = now
+            sequence += 1
+        if not sent_times:
+            break
+        frame = receive(sock, bytes_out)
+        if framed:
+            reply, blocks, _ = FRAME_HEADER.unpack_from(frame)
+            if blocks != batch:
+                raise ValueError('unexpected block count {}'.format(blocks))
+        else:
+            reply = received
+        rtts.append(time.perf_counter() - sent_times.pop(reply))
+        received += 1
+    elapsed = time.perf_counter() - start
+    sock.close()
+
+    blocks = received * batch
+    print('protocol: {}  transport: {}  fragsize: {}  channels: {}/{}  '
+          'batch: {}  depth: {}'.format(
+              'framed' if framed else 'stream',
+              'unix' if args.unix else 'tcp', fragsize, nch_in, nch_out,
+              batch, args.depth))
+    print('blocks/s: {:.0f}  real-time factor: {:.1f}'.format(
+        blocks / elapsed, blocks * fragsize / srate / elapsed))
+    print('round trip [ms]: median {:.3f}  p99 {:.3f}  max {:.3f}'.format(
+        1e3 * percentile(rtts, 50), 1e3 * percentile(rtts, 99),
+        1e3 * max(rtts, default=float('nan'))))
+
+
+if __name__ == '__main__':
+    main()
@@ -1,3 +1,4 @@
 from . MHAConnection import MHAConnection
+from . mhrec import MHRecReader, read_mhrec
 
-__all__ = ["MHAConnection"]
+__all__ = ["MHAConnection", "MHRecReader", "read_mhrec"]
@@ -0,0 +1,315 @@
+# This file is part of the HörTech Open Master Hearing Aid (openMHA)
+# Copyright © 2026 Hörzentrum Oldenburg gGmbH
+#
+# openMHA is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# openMHA is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License, version 3 for more details.
+#
+# You should have received a copy of the GNU Affero General Public License,
+# version 3 along with openMHA.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Random-access reader for MHA recording files (.mhrec).
+
+MHA recording files are written by the plugins acsave (streaming mode),
+acrec and wavrec (fileformat=mhrec).  See mha_recfile.hh for a description
+of the file layout.  Only the python standard library is required; the
+lz4 package is used for faster decompression if it is installed.
+"""
+
+from array import array
+from bisect import bisect_right
+import math
+import os
+import struct
+
+try:
+    from lz4.block import decompress as _lz4_decompress
+except ImportError:
+    _lz4_decompress = None
+
+_FILE_MAGIC = b'MHAREC01'
+_INDEX_MAGIC = b'MHAIDX01'
+_BLOCK_HEADER = struct.Struct('=IIQdII')
+_INDEX_ENTRY = struct.Struct('=QIIQd')
+_TRAILER = struct.Struct('=QQ8s')
+CODEC_RAW = 0
+CODEC_SHUFFLE_LZ = 1
+
+
+def lz_decompress(src, size):
+    """Decompress data in the LZ4 block format to "size" bytes.
+    """
+
+    if _lz4_decompress is not None:
+        return _lz4_decompress(bytes(src), uncompressed_size=size)
+    dst = bytearray()
+    ip = 0
+    n = len(src)
+    while ip < n:
+        token = src[ip]
+        ip += 1
+        literals = token >> 4
+        if literals == 15:
+            while True:
+                b = src[ip]
+                ip += 1
+                literals += b
+                if b != 255:
+                    break
+        dst += src[ip:ip + literals]
+        ip += literals
+        if ip >= n:
+            break
+        offset = src[ip] | (src[ip + 1] << 8)
+        ip += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                b = src[ip]
+                ip += 1
+                length += b
+                if b != 255:
+                    break
+        length += 4
+        if offset == 0 or offset > len(dst):
+            raise ValueError('Corrupt compressed data: invalid offset')
+        start = len(dst) - offset
+        if offset >= length:
+            dst += dst[start:start + length]
+        else:
+            # overlapping copy repeats the last "offset" bytes
+            for k in range(length):
+                dst.append(dst[start + k])
+    if len(dst) != size:
+        raise ValueError('Corrupt compressed data: size mismatch')
+    return bytes(dst)
+
+
+def _unshuffle(data, values):
+    """Undo the byte shuffle of "values" doubles.
+    """
+
+    out = bytearray(8 * values)
+    for b in range(8):
+        out[b::8] = data[b * values:(b + 1) * values]
+    return out
+
+
+class MHRecReader:
+    """Reader for MHA recording files.
+
+    The streams of the file are available as list of dicts in "streams"
+    (keys name, ndim, is_complex, rate), and all blocks as list of dicts
+    in "blocks" (keys offset, stream, nframes, first_frame, timestamp).
+    Streams can be selected by number or by name.
+    """
+
+    def __init__(self, filename):
+
+        self._file = open(filename, 'rb')
+        try:
+            self._read_header()
+            size = os.fstat(self._file.fileno()).st_size
+            header_end = self._file.tell()
+            self.has_index = self._read_index(size)
+            if not self.has_index:
+                self.blocks = []
+                self._scan_blocks(header_end, size)
+        except Exception:
+            self._file.close()
+            raise
+        self._stream_blocks = [[] for _ in self.streams]
+        for block in self.blocks:
+            self._stream_blocks[block['stream']].append(block)
+        for blocks in self._stream_blocks:
+            blocks.sort(key=lambda block: block['first_frame'])
+
+    def close(self):
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _read_header(self):
+        if self._file.read(8) != _FILE_MAGIC:
+            raise ValueError('Not an MHA recording file')
+        nstreams, = struct.unpack('=I', self._file.read(4))
+        self.streams = []
+        for _ in range(nstreams):
+            ndim, is_complex, rate, namelen = \
+                struct.unpack('=IIdI', self._file.read(20))
+            name = self._file.read(namelen).decode()
+            self.streams.append({'name': name, 'ndim': ndim,
+                                 'is_complex': bool(is_complex),
+                                 'rate': rate})
+
+    def _read_index(self, size):
+        if size < _TRAILER.size:
+            return False
+        self._file.seek(size - _TRAILER.size)
+        index_offset, entries, magic = \
+            _TRAILER.unpack(self._file.read(_TRAILER.size))
+        if magic != _INDEX_MAGIC or index_offset > size or \
+           entries != (size - _TRAILER.size - index_offset) \
+           // _INDEX_ENTRY.size:
+            return False
+        self._file.seek(index_offset)
+        data = self._file.read(entries * _INDEX_ENTRY.size)
+        self.blocks = []
+        for entry in _INDEX_ENTRY.iter_unpack(data):
+            offset, stream, nframes, first_frame, timestamp = entry
+            if stream >= len(self.streams):
+                return False
+            self.blocks.append({'offset': offset, 'stream': stream,
+                                'nframes': nframes,
+                                'first_frame': first_frame,
+                                'timestamp': timestamp})
+        return True
+
+    def _scan_blocks(self, pos, size):
+        while pos + _BLOCK_HEADER.size <= size:
+            self._file.seek(pos)
+            stream, nframes, first_frame, timestamp, codec, payload = \
+                _BLOCK_HEADER.unpack(self._file.read(_BLOCK_HEADER.size))
+            if stream >= len(self.streams) or codec > CODEC_SHUFFLE_LZ or \
+               payload > size - pos - _BLOCK_HEADER.size:
+                break
+            if codec == CODEC_RAW and payload != \
+               8 * nframes * self.frame_size(stream):
+                break
+            self.blocks.append({'offset': pos, 'stream': stream,
+                                'nframes': nframes,
+                                'first_frame': first_frame,
+                                'timestamp': timestamp})
+            pos += _BLOCK_HEADER.size + payload
+
+    def stream_number(self, stream):
+        """Return the number of a stream given by number or name.
+        """
+
+        if isinstance(stream, str):
+            for k, info in enumerate(self.streams):
+                if info['name'] == stream:
+                    return k
+            raise KeyError('No stream named ' + stream)
+        if stream < 0 or stream >= len(self.streams):
+            raise IndexError('Invalid stream number {}'.format(stream))
+        return stream
+
+    def frame_size(self, stream):
+        """Number of doubles per frame of a stream.
+        """
+
+        info = self.streams[self.stream_number(stream)]
+        return info['ndim'] * (2 if info['is_complex'] else 1)
+
+    def end_frame(self, stream):
+        """One past the index of the last frame of a stream.
+        """
+
+        blocks = self._stream_blocks[self.stream_number(stream)]
+        return max((b['first_frame'] + b['nframes'] for b in blocks),
+                   default=0)
+
+    def _decode(self, block, frame_size):
+        self._file.seek(block['offset'])
+        _, _, _, _, codec, payload = \
+            _BLOCK_HEADER.unpack(self._file.read(_BLOCK_HEADER.size))
+        data = self._file.read(payload)
+        values = block['nframes'] * frame_size
+        if codec == CODEC_SHUFFLE_LZ:
+            data = _unshuffle(lz_decompress(data, 8 * values), values)
+        elif codec != CODEC_RAW:
+            raise ValueError('Unknown codec {}'.format(codec))
+        result = array('d')
+        result.frombytes(bytes(data))
+        return result
+
+    def read_frames(self, stream, first_frame=0, count=None):
+        """Read the recorded frames of a stream in a frame range.
+
+        Returns a tuple (indices, frames): the index of each frame that was
+        recorded in the range [first_frame, first_frame + count), and the
+        frames as lists of floats, complex values as python complex
+        numbers.  count=None reads up to the end of the stream.
+        """
+
+        stream = self.stream_number(stream)
+        frame_size = self.frame_size(stream)
+        is_complex = self.streams[stream]['is_complex']
+        if count is None:
+            count = max(self.end_frame(stream) - first_frame, 0)
+        end = first_frame + count
+        blocks = self._stream_blocks[stream]
+        starts = [b['first_frame'] for b in blocks]
+        pos = max(bisect_right(starts, first_frame) - 1, 0)
+        indices, frames = [], []
+        for block in blocks[pos:]:
+            if block['first_frame'] >= end:
+                break
+            if block['first_frame'] + block['nframes'] <= first_frame:
+                continue
+            data = self._decode(block, frame_size)
+            for frame in range(max(first_frame, block['first_frame']),
+                               min(end, block['first_frame']
+                                   + block['nframes'])):
+                k = (frame - block['first_frame']) * frame_size
+                values = data[k:k + frame_size]
+                if is_complex:
+                    values = [complex(values[j], values[j + 1])
+                              for j in range(0, frame_size, 2)]
+                indices.append(frame)
+                frames.append(list(values))
+        return indices, frames
+
+    def frame_at_time(self, stream, t):
+        """Index of the first frame of a stream recorded at or after time t
+        in seconds.
+        """
+
+        stream = self.stream_number(stream)
+        blocks = self._stream_blocks[stream]
+        rate = self.streams[stream]['rate']
+        times = [b['timestamp'] for b in blocks]
+        pos = bisect_right(times, t)
+        if pos > 0:
+            block = blocks[pos - 1]
+            if rate > 0:
+                offset = math.ceil((t - block['timestamp']) * rate - 1e-9)
+            else:
+                offset = 1 if t > block['timestamp'] else 0
+            if offset < block['nframes']:
+                return block['first_frame'] + offset
+        if pos == len(blocks):
+            return self.end_frame(stream)
+        return blocks[pos]['first_frame']
+
+    def read_time_range(self, stream, start, stop):
+        """Read the frames of a stream recorded in [start, stop) seconds.
+
+        Returns (indices, frames) like read_frames.
+        """
+
+        first = self.frame_at_time(stream, start)
+        return self.read_frames(stream, first,
+                                self.frame_at_time(stream, stop) - first)
+
+
+def read_mhrec(filename):
+    """Read all streams of an MHA recording file.
+
+    Returns a dict mapping each stream name to a tuple (indices, frames) as
+    returned by MHRecReader.read_frames.
+    """
+
+    with MHRecReader(filename) as reader:
+        return {info['name']: reader.read_frames(k)
+                for k, info in enumerate(reader.streams)}
@@ -1,5 +1,6 @@
 # This file is part of the HörTech Open Master Hearing Aid (openMHA)
 # Copyright © 2013 2014 2015 2016 2017 2018 2020 HörTech gGmbH
+# Copyright © 2026 Hörzentrum Oldenburg gGmbH
 #
 # openMHA is free software: you can redistribute it and/or modify
 # it under the terms of the GNU Affero General Public License as published by
@@ -91,11 +92,29 @@ $(patsubst %,%-subdir-unit-tests,$(SUBDIRS)):
 execute-unit-tests: $(BUILD_DIR)/unit-test-runner
 	if [ -x $< ]; then $(call EXTEND_DLLPATH_$(PLATFORM),$(GIT_DIR)/mha/libmha/$(BUILD_DIR)) $<; fi
 
-unit_tests_test_files = $(wildcard $(SOURCE_DIR)/*_unit_tests.cpp)
+unit_tests_test_files = $(filter-out $(UNIT_TESTS_EXCLUDE:%=$(SOURCE_DIR)/%), \
+                         $(wildcard $(SOURCE_DIR)/*_unit_tests.cpp))
 
 $(BUILD_DIR)/unit-test-runner: $(BUILD_DIR)/.directory $(unit_tests_test_files) $(patsubst %_unit_tests.cpp, %.cpp , $(unit_tests_test_files))
 	if test -n "$(unit_tests_test_files)"; then $(CXX) $(CXXFLAGS) --coverage -o $@ $(wordlist 2, $(words $^), $^) $(LDFLAGS) $(LDLIBS) -lgmock_main -lgmock -lgtest -lpthread; fi
 
+# Benchmarks are separate programs <name>_bench, built from
+# <name>_bench.cpp and <name>.cpp, and are not part of the unit tests.
+# "make benchmarks" builds and runs them.
+benchmarks: execute-benchmarks $(patsubst %,%-subdir-benchmarks,$(SUBDIRS))
+
+$(patsubst %,%-subdir-benchmarks,$(SUBDIRS)):
+	$(MAKE) -C $(@:-subdir-benchmarks=) benchmarks
+
+benchmark_programs = $(patsubst $(SOURCE_DIR)/%.cpp,$(BUILD_DIR)/%, \
+                       $(wildcard $(SOURCE_DIR)/*_bench.cpp))
+
+execute-benchmarks: $(benchmark_programs)
+	for b in $^; do $(call EXTEND_DLLPATH_$(PLATFORM),$(GIT_DIR)/mha/libmha/$(BUILD_DIR)) $$b || exit 1; done
+
+$(BUILD_DIR)/%_bench: $(BUILD_DIR)/.directory $(SOURCE_DIR)/%_bench.cpp $(SOURCE_DIR)/%.cpp
+	$(CXX) $(CXXFLAGS) -o $@ $(wordlist 2, $(words $^), $^) $(LDFLAGS) $(LDLIBS) -lpthread
+
 # Static Pattern Rule defines standard prerequisites for plugins
 $(PLUGINS:%=$(BUILD_DIR)/%$(PLUGIN_EXT)): %$(PLUGIN_EXT): %.o %_mha_git_commit_hash.o
 